@@ -0,0 +1,24 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+C_SRCS += \
+../src/idmap/idmap.c 
+
+OBJS += \
+./src/idmap/idmap.o 
+
+C_DEPS += \
+./src/idmap/idmap.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+src/idmap/%.o: ../src/idmap/%.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C Compiler'
+	gcc -DDEBUG=1 -I../include -O0 -g3 -Wall $(CFLAGS) -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<" $(LDFLAGS)
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
@@ -8,7 +8,9 @@ C_SRCS += \
 ../src/siri/backup.c \
 ../src/siri/err.c \
 ../src/siri/heartbeat.c \
+../src/siri/ingest.c \
 ../src/siri/optimize.c \
+../src/siri/qpool.c \
 ../src/siri/siri.c \
 ../src/siri/version.c 
 
@@ -17,7 +19,9 @@ OBJS += \
 ./src/siri/backup.o \
 ./src/siri/err.o \
 ./src/siri/heartbeat.o \
+./src/siri/ingest.o \
 ./src/siri/optimize.o \
+./src/siri/qpool.o \
 ./src/siri/siri.o \
 ./src/siri/version.o 
 
@@ -26,7 +30,9 @@ C_DEPS += \
 ./src/siri/backup.d \
 ./src/siri/err.d \
 ./src/siri/heartbeat.d \
+./src/siri/ingest.d \
 ./src/siri/optimize.d \
+./src/siri/qpool.d \
 ./src/siri/siri.d \
 ./src/siri/version.d 
 
@@ -15,11 +15,13 @@ C_DEPS :=
 SUBDIRS := \
 . \
 src/argparse \
+src/art \
 src/cexpr \
 src/cfgparser \
 src/cleri \
 src/ctree \
 src/expr \
+src/idmap \
 src/imap \
 src/iso8601 \
 src/llist \
@@ -29,6 +31,7 @@ src/motd \
 src/owcrypt \
 src/procinfo \
 src/qpack \
+src/roaring \
 src/siri/args \
 src/siri \
 src/siri/cfg \
@@ -0,0 +1,24 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+C_SRCS += \
+../src/roaring/roaring.c 
+
+OBJS += \
+./src/roaring/roaring.o 
+
+C_DEPS += \
+./src/roaring/roaring.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+src/roaring/%.o: ../src/roaring/%.c
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C Compiler'
+	gcc -I../include -O3 -Wall $(CFLAGS) -c -fmessage-length=0 -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@)" -o "$@" "$<" $(LDFLAGS)
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
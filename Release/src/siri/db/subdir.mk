@@ -6,6 +6,7 @@
 C_SRCS += \
 ../src/siri/db/access.c \
 ../src/siri/db/aggregate.c \
+../src/siri/db/arena.c \
 ../src/siri/db/auth.c \
 ../src/siri/db/buffer.c \
 ../src/siri/db/db.c \
@@ -21,6 +22,8 @@ C_SRCS += \
 ../src/siri/db/misc.c \
 ../src/siri/db/nodes.c \
 ../src/siri/db/pcache.c \
+../src/siri/db/pipeline.c \
+../src/siri/db/partial.c \
 ../src/siri/db/points.c \
 ../src/siri/db/pool.c \
 ../src/siri/db/pools.c \
@@ -33,17 +36,21 @@ C_SRCS += \
 ../src/siri/db/series.c \
 ../src/siri/db/server.c \
 ../src/siri/db/servers.c \
+../src/siri/db/simd.c \
+../src/siri/db/sketch.c \
 ../src/siri/db/shard.c \
 ../src/siri/db/shards.c \
 ../src/siri/db/time.c \
 ../src/siri/db/user.c \
 ../src/siri/db/users.c \
 ../src/siri/db/variance.c \
+../src/siri/db/wal.c \
 ../src/siri/db/walker.c 
 
 OBJS += \
 ./src/siri/db/access.o \
 ./src/siri/db/aggregate.o \
+./src/siri/db/arena.o \
 ./src/siri/db/auth.o \
 ./src/siri/db/buffer.o \
 ./src/siri/db/db.o \
@@ -59,6 +66,8 @@ OBJS += \
 ./src/siri/db/misc.o \
 ./src/siri/db/nodes.o \
 ./src/siri/db/pcache.o \
+./src/siri/db/pipeline.o \
+./src/siri/db/partial.o \
 ./src/siri/db/points.o \
 ./src/siri/db/pool.o \
 ./src/siri/db/pools.o \
@@ -71,17 +80,21 @@ OBJS += \
 ./src/siri/db/series.o \
 ./src/siri/db/server.o \
 ./src/siri/db/servers.o \
+./src/siri/db/simd.o \
+./src/siri/db/sketch.o \
 ./src/siri/db/shard.o \
 ./src/siri/db/shards.o \
 ./src/siri/db/time.o \
 ./src/siri/db/user.o \
 ./src/siri/db/users.o \
 ./src/siri/db/variance.o \
+./src/siri/db/wal.o \
 ./src/siri/db/walker.o 
 
 C_DEPS += \
 ./src/siri/db/access.d \
 ./src/siri/db/aggregate.d \
+./src/siri/db/arena.d \
 ./src/siri/db/auth.d \
 ./src/siri/db/buffer.d \
 ./src/siri/db/db.d \
@@ -97,6 +110,8 @@ C_DEPS += \
 ./src/siri/db/misc.d \
 ./src/siri/db/nodes.d \
 ./src/siri/db/pcache.d \
+./src/siri/db/pipeline.d \
+./src/siri/db/partial.d \
 ./src/siri/db/points.d \
 ./src/siri/db/pool.d \
 ./src/siri/db/pools.d \
@@ -109,12 +124,15 @@ C_DEPS += \
 ./src/siri/db/series.d \
 ./src/siri/db/server.d \
 ./src/siri/db/servers.d \
+./src/siri/db/simd.d \
+./src/siri/db/sketch.d \
 ./src/siri/db/shard.d \
 ./src/siri/db/shards.d \
 ./src/siri/db/time.d \
 ./src/siri/db/user.d \
 ./src/siri/db/users.d \
 ./src/siri/db/variance.d \
+./src/siri/db/wal.d \
 ./src/siri/db/walker.d 
 
 
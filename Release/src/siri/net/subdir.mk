@@ -6,6 +6,7 @@
 C_SRCS += \
 ../src/siri/net/bserver.c \
 ../src/siri/net/clserver.c \
+../src/siri/net/lnserver.c \
 ../src/siri/net/pkg.c \
 ../src/siri/net/promise.c \
 ../src/siri/net/promises.c \
@@ -15,6 +16,7 @@ C_SRCS += \
 OBJS += \
 ./src/siri/net/bserver.o \
 ./src/siri/net/clserver.o \
+./src/siri/net/lnserver.o \
 ./src/siri/net/pkg.o \
 ./src/siri/net/promise.o \
 ./src/siri/net/promises.o \
@@ -24,6 +26,7 @@ OBJS += \
 C_DEPS += \
 ./src/siri/net/bserver.d \
 ./src/siri/net/clserver.d \
+./src/siri/net/lnserver.d \
 ./src/siri/net/pkg.d \
 ./src/siri/net/promise.d \
 ./src/siri/net/promises.d \
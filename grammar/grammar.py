@@ -50,6 +50,7 @@ class SiriGrammar(Grammar):
     k_after = Keyword('after')
     k_alter = Keyword('alter')
     k_and = Keyword('and')
+    k_approx_median = Keyword('approx_median')
     k_as = Keyword('as')
     k_backup_mode = Keyword('backup_mode')
     k_before = Keyword('before')
@@ -67,6 +68,7 @@ class SiriGrammar(Grammar):
     k_difference = Keyword('difference')
     k_drop = Keyword('drop')
     k_drop_threshold = Keyword('drop_threshold')
+    k_dropped_points = Keyword('dropped_points')
     k_duration_log = Keyword('duration_log')
     k_duration_num = Keyword('duration_num')
     k_end = Keyword('end')
@@ -85,6 +87,8 @@ class SiriGrammar(Grammar):
     k_info = Keyword('info')
     k_ignore_threshold = Keyword('ignore_threshold')
     k_insert = Keyword('insert')
+    k_insert_queue = Keyword('insert_queue')
+    k_insert_queue_size = Keyword('insert_queue_size')
     k_integer = Keyword('integer')
     k_intersection = Choice(
         Token('&'),
@@ -97,6 +101,7 @@ class SiriGrammar(Grammar):
     k_list = Keyword('list')
     k_log = Keyword('log')
     k_log_level = Keyword('log_level')
+    k_lookup_version = Keyword('lookup_version')
     k_max = Keyword('max')
     k_max_open_files = Keyword('max_open_files')
     k_mean = Keyword('mean')
@@ -114,6 +119,7 @@ class SiriGrammar(Grammar):
     k_open_files = Keyword('open_files')
     k_or = Keyword('or')
     k_password = Keyword('password')
+    k_percentile = Keyword('percentile')
     k_points = Keyword('points')
     k_pool = Keyword('pool')
     k_pools = Keyword('pools')
@@ -410,6 +416,12 @@ class SiriGrammar(Grammar):
     f_median_high = Sequence(
         k_median_high,
         '(', time_expr, ')')
+    f_approx_median = Sequence(
+        k_approx_median,
+        '(', time_expr, ')')
+    f_percentile = Sequence(
+        k_percentile,
+        '(', r_float, ',', time_expr, ')')
     f_sum = Sequence(
         k_sum,
         '(', time_expr, ')')
@@ -465,6 +477,8 @@ class SiriGrammar(Grammar):
         f_median,
         f_median_low,
         f_median_high,
+        f_approx_median,
+        f_percentile,
         f_min,
         f_max,
         f_count,
@@ -492,6 +506,7 @@ class SiriGrammar(Grammar):
     set_expression = Sequence(k_set, k_expression, r_regex)
     set_ignore_threshold = Sequence(k_set, k_ignore_threshold, _boolean)
     set_log_level = Sequence(k_set, k_log_level, log_keywords)
+    set_lookup_version = Sequence(k_set, k_lookup_version, r_uinteger)
     set_name = Sequence(k_set, k_name, string)
     set_password = Sequence(k_set, k_password, string)
     set_port = Sequence(k_set, k_port, r_uinteger)
@@ -499,6 +514,7 @@ class SiriGrammar(Grammar):
 
     alter_database = Sequence(k_database, Choice(
         set_drop_threshold,
+        set_lookup_version,
         set_timezone,
         most_greedy=False))
 
@@ -657,11 +673,15 @@ class SiriGrammar(Grammar):
         k_dbname,
         k_dbpath,
         k_drop_threshold,
+        k_dropped_points,
         k_duration_log,
         k_duration_num,
+        k_insert_queue,
+        k_insert_queue_size,
         k_ip_support,
         k_libuv,
         k_log_level,
+        k_lookup_version,
         k_max_open_files,
         k_mem_usage,
         k_open_files,
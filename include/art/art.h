@@ -0,0 +1,66 @@
+/*
+ * art.h - Adaptive Radix Tree implementation.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * Keys are null terminated strings and the functions follow the ctree
+ * API so the tree can be used as a replacement for ctree. Inner nodes
+ * adapt their size (4, 16, 48 or 256 children) and use path compression.
+ * Items are walked in key order.
+ */
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+enum
+{
+    ART_ERR=-1,
+    ART_OK,
+    ART_EXISTS,
+};
+
+/* art_get_sure() will set a pointer to ART_EMPTY and returns the address so
+ * it can be used for custom data. We do not use NULL since we take NULL as if
+ * the item does not exist. */
+extern void * ART_EMPTY;
+
+typedef struct art_node_s art_node_t;
+
+typedef struct art_s
+{
+    uint32_t len;
+    uint32_t pad0;
+    art_node_t * root;
+} art_t;
+
+typedef int (*art_item_cb)(const char * key, void * data, void * args);
+typedef int (*art_val_cb)(void * data, void * args);
+typedef void (*art_free_cb)(void * data);
+
+art_t * art_new(void);
+void art_free(art_t * art, art_free_cb cb);
+void ** art_get_sure(art_t * art, const char * key);
+int art_add(art_t * art, const char * key, void * data);
+void * art_get(art_t * art, const char * key);
+void ** art_getaddr(art_t * art, const char * key);
+void * art_getn(art_t * art, const char * key, size_t n);
+void * art_pop(art_t * art, const char * key);
+int art_items(art_t * art, art_item_cb cb, void * args);
+int art_items_prefix(
+        art_t * art,
+        const char * prefix,
+        size_t n,
+        art_item_cb cb,
+        void * args);
+int art_values(art_t * art, art_val_cb cb, void * args);
+
+/*
+ * Can be used to check if art_get_sure() has set an ART_EMPTY
+ */
+#define art_is_empty(data) data == ART_EMPTY
@@ -0,0 +1,53 @@
+/*
+ * idmap.h - dense map for uint32_t id keys
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * Use this map when ids are handed out by a counter and therefore are close
+ * to dense. (for example series id's) Items are stored in a growable array
+ * of fixed size chunks so a lookup is O(1) and items are walked by id order.
+ * Chunks without items are freed.
+ */
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <slist/slist.h>
+
+#define IDMAP_CHUNK_BITS 12
+#define IDMAP_CHUNK_SZ (1 << IDMAP_CHUNK_BITS)
+#define IDMAP_CHUNK_MASK (IDMAP_CHUNK_SZ - 1)
+
+typedef struct idmap_chunk_s
+{
+    uint32_t len;
+    uint32_t pad0;
+    void * data[IDMAP_CHUNK_SZ];
+} idmap_chunk_t;
+
+typedef struct idmap_s
+{
+    size_t len;
+    uint32_t n;         /* number of chunk pointers */
+    uint32_t pad0;
+    idmap_chunk_t ** chunks;
+} idmap_t;
+
+typedef int (*idmap_cb)(void * data, void * args);
+typedef int (*idmap_free_cb)(void * data);
+
+idmap_t * idmap_new(void);
+void idmap_free(idmap_t * idmap, idmap_free_cb cb);
+int idmap_add(idmap_t * idmap, uint32_t id, void * data);
+void * idmap_get(idmap_t * idmap, uint32_t id);
+void * idmap_pop(idmap_t * idmap, uint32_t id);
+int idmap_walk(idmap_t * idmap, idmap_cb cb, void * args);
+void idmap_walkn(idmap_t * idmap, size_t * n, idmap_cb cb, void * args);
+slist_t * idmap_2slist(idmap_t * idmap);
+slist_t * idmap_2slist_ref(idmap_t * idmap);
+slist_t * idmap_slice_ref(idmap_t * idmap, uint64_t * id, size_t n);
@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 11-03-2016
+ *  - added qp_packer_extend_data(), 18-10-2026
  *
  */
 #pragma once
@@ -111,6 +112,7 @@ qp_packer_t * qp_packer_new(size_t alloc_size);
 void qp_packer_free(qp_packer_t * packer);
 int qp_packer_extend(qp_packer_t * packer, qp_packer_t * source);
 int qp_packer_extend_fu(qp_packer_t * packer, qp_unpacker_t * unpacker);
+int qp_packer_extend_data(qp_packer_t * packer, const char * data, size_t len);
 
 /* unpacker: create and destroy functions */
 void qp_unpacker_init(qp_unpacker_t * unpacker, char * pt, size_t len);
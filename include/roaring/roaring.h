@@ -0,0 +1,66 @@
+/*
+ * roaring.h - compressed bitmap for uint32_t id's (roaring style)
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * Id's are split in a high and low 16 bit part. For each high part a
+ * container is used which is either a sorted array with low parts (at most
+ * ROARING_ARRAY_MAX values) or a bitset with 65536 bits. Set operations are
+ * performed per container on 64 bit words.
+ */
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#define ROARING_ARRAY_MAX 4096
+#define ROARING_BITSET_WORDS 1024
+
+enum
+{
+    ROARING_ARRAY,
+    ROARING_BITSET
+};
+
+typedef struct roaring_container_s
+{
+    uint16_t key;   /* high 16 bits */
+    uint16_t tp;    /* ROARING_ARRAY or ROARING_BITSET */
+    uint32_t card;  /* number of id's in this container */
+    uint32_t size;  /* allocated size for an array container */
+    uint32_t pad0;
+    union
+    {
+        uint16_t * array;
+        uint64_t * bitset;
+    } via;
+} roaring_container_t;
+
+typedef struct roaring_s
+{
+    size_t len;
+    uint32_t n;     /* number of containers */
+    uint32_t size;  /* allocated containers */
+    roaring_container_t * containers;
+} roaring_t;
+
+typedef int (*roaring_cb)(uint32_t id, void * args);
+typedef int (*roaring_update_cb)(roaring_t * dest, roaring_t * other);
+
+roaring_t * roaring_new(void);
+roaring_t * roaring_copy(roaring_t * roaring);
+void roaring_free(roaring_t * roaring);
+void roaring_clear(roaring_t * roaring);
+int roaring_add(roaring_t * roaring, uint32_t id);
+int roaring_remove(roaring_t * roaring, uint32_t id);
+int roaring_contains(roaring_t * roaring, uint32_t id);
+int roaring_walk(roaring_t * roaring, roaring_cb cb, void * args);
+int roaring_union(roaring_t * dest, roaring_t * other);
+int roaring_intersection(roaring_t * dest, roaring_t * other);
+int roaring_difference(roaring_t * dest, roaring_t * other);
+int roaring_symmetric_difference(roaring_t * dest, roaring_t * other);
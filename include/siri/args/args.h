@@ -10,6 +10,7 @@ typedef struct siri_args_s
 {
     /* true/false props */
     int32_t version;
+    int32_t bench_aggregates;
     int32_t log_colorized;
 
     /* string props */
@@ -2,6 +2,7 @@
 
 #include <inttypes.h>
 #include <limits.h>
+#include <siri/db/db.h>
 #include <siri/siri.h>
 
 typedef struct siri_s siri_t;
@@ -12,12 +13,25 @@ typedef struct siri_cfg_s
 {
     uint16_t listen_client_port;
     uint16_t listen_backend_port;
+    uint16_t listen_graphite_port;      /* 0 when disabled */
+    uint16_t listen_influx_port;        /* 0 when disabled */
+    uint16_t insert_coalesce_window;    /* milliseconds, 0 when disabled */
+    uint32_t insert_coalesce_points;
+    uint32_t max_insert_queue;          /* kilobytes, 0 when unlimited */
+    uint32_t max_insert_queue_client;   /* kilobytes, 0 when unlimited */
+    uint32_t insert_pipeline_depth;     /* batches in flight for each pool */
+    uint32_t insert_pipeline_batch_size;    /* kilobytes */
+    uint32_t wal_checkpoint_interval;   /* milliseconds, 0 when disabled */
+    uint32_t ingest_threads;
+    uint32_t query_threads;             /* 0 when disabled */
+    uint32_t max_query_parallelism;     /* jobs in flight for each query */
     uint16_t heartbeat_interval;
     uint16_t max_open_files;
     uint32_t optimize_interval;
     uint8_t ip_support;
     char server_address[SIRI_CFG_MAX_LEN_ADDRESS];
     char default_db_path[PATH_MAX];
+    char line_protocol_db[SIRIDB_MAX_DBNAME_LEN];
 } siri_cfg_t;
 
 void siri_cfg_init(siri_t * siri);
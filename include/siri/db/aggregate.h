@@ -7,11 +7,15 @@
  *
  * changes
  *  - initial version, 15-04-2016
+ *  - fused aggregation over chunks of points, 18-10-2026
+ *  - approximate percentiles using sketches, 18-10-2026
+ *  - partial aggregates for merged results, 18-10-2026
  *
  */
 #pragma once
 
 #include <siri/db/points.h>
+#include <siri/db/partial.h>
 #include <siri/grammar/gramp.h>
 #include <slist/slist.h>
 #include <cexpr/cexpr.h>
@@ -29,14 +33,43 @@ typedef struct siridb_aggr_s
     uint64_t limit;
     uint64_t offset;
     double timespan;  // used for derivative
+    double quantile;  // used for percentile and approx_median
     qp_via_t filter_via;
 } siridb_aggr_t;
 
+/*
+ * Returns 1 and sets chunk to the next points, 0 when there are no more
+ * points or -1 in case of an error, in which case err_msg is set. The chunk
+ * data must stay valid until the next call.
+ */
+typedef int (*siridb_aggr_next_cb)(
+        void * arg,
+        siridb_points_t * chunk,
+        char * err_msg);
+
 siridb_points_t * siridb_aggregate_run(
         siridb_points_t * source,
         siridb_aggr_t * aggr,
         char * err_msg);
 
+siridb_points_t * siridb_aggregate_stream(
+        slist_t * alist,
+        points_tp tp,
+        siridb_aggr_next_cb next_cb,
+        void * arg,
+        char * err_msg);
+siridb_points_t * siridb_aggregate_list_run(
+        siridb_points_t * points,
+        slist_t * alist,
+        char * err_msg);
+
+siridb_aggr_t * siridb_aggregate_partial(slist_t * alist);
+siridb_partials_t * siridb_aggregate_partials_new(siridb_aggr_t * aggr);
+siridb_points_t * siridb_aggregate_partials_run(
+        siridb_partials_t * partials,
+        slist_t * alist,
+        char * err_msg);
+
 void siridb_init_aggregates(void);
 slist_t * siridb_aggregate_list(cleri_children_t * children, char * err_msg);
 void siridb_aggregate_list_free(slist_t * alist);
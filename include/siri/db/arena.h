@@ -0,0 +1,45 @@
+/*
+ * arena.h - Memory which is released at once when a query is finished.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <uv.h>
+
+#define SIRIDB_ARENA_BLOCK_SZ 262144    /* size of a block for small chunks */
+#define SIRIDB_ARENA_LARGE_SZ 32768     /* larger chunks are allocated alone */
+
+typedef struct siridb_arena_block_s siridb_arena_block_t;
+
+typedef struct siridb_arena_large_s
+{
+    struct siridb_arena_large_s * prev;
+    struct siridb_arena_large_s * next;
+} siridb_arena_large_t;
+
+typedef struct siridb_arena_s
+{
+    uv_mutex_t mutex;
+    siridb_arena_block_t * block;   /* current block, linked to older ones */
+    siridb_arena_large_t large;     /* list with large chunks */
+    size_t size;                    /* bytes allocated by the arena */
+    size_t peak;                    /* highest value for size */
+} siridb_arena_t;
+
+int siridb_arena_init(siridb_arena_t * arena);
+void siridb_arena_destroy(siridb_arena_t * arena);
+void * siridb_arena_malloc(siridb_arena_t * arena, size_t size);
+void * siridb_arena_realloc(void * ptr, size_t size);
+void siridb_arena_free(void * ptr);
+size_t siridb_arena_peak(siridb_arena_t * arena);
+void siridb_arena_enter(siridb_arena_t * arena);
+void siridb_arena_leave(void);
+siridb_arena_t * siridb_arena_current(void);
@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 01-04-2016
+ *  - write a complete buffer for a write-ahead log checkpoint, 18-10-2026
  *
  */
 #pragma once
@@ -37,3 +38,11 @@ int siridb_buffer_write_point(
         siridb_series_t * series,
         uint64_t * ts,
         qp_via_t * val);
+int siridb_buffer_write_series(
+        siridb_t * siridb,
+        siridb_series_t * series,
+        uint32_t checkpoint);
+uint32_t siridb_buffer_read_checkpoint(
+        siridb_t * siridb,
+        siridb_series_t * series);
+int siridb_buffer_sync(siridb_t * siridb);
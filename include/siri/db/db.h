@@ -7,6 +7,12 @@
  *
  * changes
  *  - initial version, 10-03-2016
+ *  - added series stripe locks and a buffer mutex, 18-10-2026
+ *  - added insert_group for coalescing client inserts, 18-10-2026
+ *  - added insert queue counters for admission control, 18-10-2026
+ *  - added lookup version, 18-10-2026
+ *  - added write-ahead log, 18-10-2026
+ *  - added dropped_points for the line protocol listeners, 18-10-2026
  *
  */
 #pragma once
@@ -17,7 +23,9 @@
 #include <qpack/qpack.h>
 #include <siri/db/server.h>
 #include <siri/db/pools.h>
+#include <art/art.h>
 #include <ctree/ctree.h>
+#include <idmap/idmap.h>
 #include <imap/imap.h>
 #include <imap/imap.h>
 #include <iso8601/iso8601.h>
@@ -34,6 +42,12 @@
 
 #define SIRIDB_FLAG_REINDEXING 1
 
+/*
+ * Number of locks protecting series data like the buffer, length, start and
+ * end. A series uses the lock at: series->id % SIRIDB_SERIES_STRIPES.
+ */
+#define SIRIDB_SERIES_STRIPES 16
+
 #define SIRIDB_GET_FN(FN, __path, FILENAME)                         \
     char FN[strlen(__path) + strlen(FILENAME) + 1]; 				\
     sprintf(FN, "%s%s", __path, FILENAME);
@@ -66,6 +80,8 @@ typedef struct siridb_fifo_s siridb_fifo_t;
 typedef struct siridb_replicate_s siridb_replicate_t;
 typedef struct siridb_reindex_s siridb_reindex_t;
 typedef struct siridb_groups_s siridb_groups_t;
+typedef struct siridb_insert_group_s siridb_insert_group_t;
+typedef struct siridb_wal_s siridb_wal_t;
 
 typedef struct siridb_s
 {
@@ -77,10 +93,15 @@ typedef struct siridb_s
     uint16_t insert_tasks;
     uint16_t shard_mask_num;
     uint16_t shard_mask_log;
+    uint8_t lookup_version;           // version of the pool lookup
+    uint8_t prev_lookup_version;      // differs while migrating the lookup
     uuid_t uuid;
     iso8601_tz_t tz;
     size_t buffer_size;
     size_t buffer_len;
+    size_t insert_queue;                // inserts not yet finished
+    size_t insert_queue_size;           // size in bytes of these inserts
+    size_t dropped_points;              // line protocol points not inserted
     time_t start_ts;                  // in seconds, to calculate up-time.
     uint64_t duration_num;              // number duration in s, ms, us or ns
     uint64_t duration_log;              // log duration in s, ms, us or ns
@@ -97,10 +118,12 @@ typedef struct siridb_s
     llist_t * users;
     llist_t * servers;
     siridb_pools_t * pools;
-    ct_t * series;
-    imap_t * series_map;
+    art_t * series;
+    idmap_t * series_map;
     uv_mutex_t series_mutex;
     uv_mutex_t shards_mutex;
+    uv_mutex_t buffer_mutex;
+    uv_mutex_t series_stripes[SIRIDB_SERIES_STRIPES];
     imap_t * shards;
     FILE * buffer_fp;
     FILE * dropped_fp;
@@ -109,6 +132,8 @@ typedef struct siridb_s
     siridb_replicate_t * replicate;
     siridb_reindex_t * reindex;
     siridb_groups_t * groups;
+    siridb_insert_group_t * insert_group;   /* NULL when not coalescing */
+    siridb_wal_t * wal;
 } siridb_t;
 
 int siridb_is_db_path(const char * dbpath);
@@ -128,3 +153,6 @@ void siridb__free(siridb_t * siridb);
 #define siridb_decref(_siridb) if (!--_siridb->ref) siridb__free(_siridb)
 
 #define siridb_is_reindexing(siridb) (siridb->flags & SIRIDB_FLAG_REINDEXING)
+
+#define siridb_series_stripe(siridb, series) \
+    (&(siridb)->series_stripes[(series)->id % SIRIDB_SERIES_STRIPES])
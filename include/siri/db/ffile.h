@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 30-06-2016
+ *  - packages can be kept in the file after they are read, 18-10-2026
  *
  */
 #pragma once
@@ -28,6 +29,7 @@ typedef struct siridb_ffile_s
     FILE * fp;
     int fd;
     long int size;
+    long int pos;  // end of the next package
 } siridb_ffile_t;
 
 void siridb_ffile_open(siridb_ffile_t * ffile, const char * opentype);
@@ -40,6 +42,8 @@ void siridb_ffile_free(siridb_ffile_t * ffile);
 void siridb_ffile_unlink(siridb_ffile_t * ffile);
 sirinet_pkg_t * siridb_ffile_pop(siridb_ffile_t * ffile);
 int siridb_ffile_pop_commit(siridb_ffile_t * ffile);
+int siridb_ffile_pop_next(siridb_ffile_t * ffile);
+int siridb_ffile_truncate(siridb_ffile_t * ffile, long int size);
 siridb_ffile_result_t siridb_ffile_append(
         siridb_ffile_t * ffile,
         sirinet_pkg_t * pkg);
@@ -7,22 +7,42 @@
  *
  * changes
  *  - initial version, 30-06-2016
+ *  - log sequence numbers and packages kept for the write-ahead log,
+ *    18-10-2026
  *
+ * Each package in the fifo buffer has a log sequence number (LSN) which is
+ * higher for packages which are appended later. While 'retain' is set,
+ * packages which are send to the replica are kept until they are removed
+ * using siridb_fifo_truncate() and the position of the replica is saved in
+ * a cursor file.
  */
 #pragma once
+#include <inttypes.h>
 #include <siri/db/db.h>
+#include <siri/db/server.h>
 #include <llist/llist.h>
 #include <siri/db/ffile.h>
 
+typedef struct siridb_server_s siridb_server_t;
+
 typedef struct siridb_fifo_s
 {
     char * path;
     llist_t * fifos;
+    llist_t * done;  // files which are send but not yet removed
     siridb_ffile_t * in;
     siridb_ffile_t * out;
     ssize_t max_id;  // max_id can be -1
+    uint64_t lsn;    // log sequence number of the last appended package
+    int retain;      // keep packages which are send to the replica
+    int cursor_fd;
 } siridb_fifo_t;
 
+typedef int (*siridb_fifo_walk_cb)(
+        sirinet_pkg_t * pkg,
+        uint64_t lsn,
+        void * data);
+
 
 siridb_fifo_t * siridb_fifo_new(siridb_t * siridb);
 void siridb_fifo_free(siridb_fifo_t * fifo);
@@ -32,6 +52,14 @@ int siridb_fifo_commit(siridb_fifo_t * fifo);
 int siridb_fifo_commit_err(siridb_fifo_t * fifo);
 int siridb_fifo_close(siridb_fifo_t * fifo);
 int siridb_fifo_open(siridb_fifo_t * fifo);
+int siridb_fifo_truncate(siridb_fifo_t * fifo, uint64_t lsn);
+void siridb_fifo_set_retain(siridb_fifo_t * fifo, int retain);
+int siridb_fifo_walk(
+        siridb_t * siridb,
+        siridb_server_t * replica,
+        uint64_t lsn,
+        siridb_fifo_walk_cb cb,
+        void * data);
 
 /*
  * Value is greater than 0 when the fifo has data or 0 when empty.
@@ -44,3 +72,21 @@ int siridb_fifo_open(siridb_fifo_t * fifo);
  * Returns 1 if the fifo buffer is open or 0 if closed.
  */
 #define siridb_fifo_is_open(fifo) (fifo->in->fp != NULL)
+
+/*
+ * Log sequence number for the package in 'ffile' which ends at 'end'.
+ * Packages are written from the end to the start of a fifo file.
+ */
+#define siridb_fifo_lsn(ffile, end) \
+    (((uint64_t) (ffile)->id << 32) | (UINT32_MAX - (uint32_t) (end)))
+
+/*
+ * Log sequence number for the next package which will be appended.
+ */
+#define siridb_fifo_head(fifo) siridb_fifo_lsn(fifo->in, fifo->in->free_space)
+
+/*
+ * Log sequence number for the next package which will be send to the
+ * replica. All packages with a lower number are send.
+ */
+#define siridb_fifo_cursor(fifo) siridb_fifo_lsn(fifo->out, fifo->out->pos)
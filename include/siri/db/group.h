@@ -7,13 +7,15 @@
  *
  * changes
  *  - initial version, 16-08-2016
+ *  - added a bitmap with the series id's, 18-10-2026
  *
  */
 #pragma once
 
+#include <roaring/roaring.h>
 #include <slist/slist.h>
 #include <siri/db/series.h>
-#include <pcre.h>
+#include <siri/db/re.h>
 
 #define GROUP_FLAG_INIT 1
 #define GROUP_FLAG_DROPPED 2
@@ -28,8 +30,8 @@ typedef struct siridb_group_s
     char * name;
     char * source;  /* pattern/flags representation */
     slist_t * series;
-    pcre * regex;
-    pcre_extra * regex_extra;
+    roaring_t * ids;    /* series id's, same series as in the list */
+    siridb_re_t * re;
 } siridb_group_t;
 
 siridb_group_t * siridb_group_new(
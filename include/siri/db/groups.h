@@ -26,6 +26,9 @@ typedef enum
 
 
 #define GROUPS_FLAG_DROPPED_SERIES 1
+#define GROUPS_FLAG_REBUILD_MATCHER 2
+
+typedef struct groups_matcher_s groups_matcher_t;
 
 typedef struct siridb_groups_s
 {
@@ -36,7 +39,10 @@ typedef struct siridb_groups_s
     ct_t * groups;
     slist_t * nseries;  /* list of series we need to assign to groups */
     slist_t * ngroups;  /* list of groups which need initialization */
+    groups_matcher_t * matcher;  /* used for matching new series (group
+                                    thread only) */
     uv_mutex_t mutex;
+    uv_cond_t cond;     /* wakes up the group thread */
     uv_work_t work;
 } siridb_groups_t;
 
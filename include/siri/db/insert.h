@@ -7,6 +7,12 @@
  *
  * changes
  *  - initial version, 24-03-2016
+ *  - points for local series are applied by worker threads, 18-10-2026
+ *  - points for the local pool are read once into a batch, 18-10-2026
+ *  - columnar bulk insert package, 18-10-2026
+ *  - inserts without a client for the line protocol listeners, 18-10-2026
+ *  - coalescing inserts from different clients, 18-10-2026
+ *  - insert queue for admission control, 18-10-2026
  *
  */
 #pragma once
@@ -16,15 +22,19 @@
 #include <siri/db/forward.h>
 #include <uv.h>
 #include <siri/db/pcache.h>
+#include <siri/ingest.h>
+#include <slist/slist.h>
 
 #define INSERT_FLAG_TEST 1
 #define INSERT_FLAG_TESTED 2
 #define INSERT_FLAG_POOL 4
 #define INSERT_FLAG_INIT_REPL 8
+#define INSERT_FLAG_JOBS 16     /* jobs are queued on worker threads */
 
 typedef enum
 {
-    ERR_EXPECTING_ARRAY=-9,
+    ERR_INVALID_BULK=-10,
+    ERR_EXPECTING_ARRAY,
     ERR_EXPECTING_SERIES_NAME,
     ERR_EXPECTING_MAP_OR_ARRAY,
     ERR_EXPECTING_INTEGER_TS,
@@ -47,6 +57,19 @@ typedef struct qp_unpacker_s qp_unpacker_t;
 typedef struct qp_packer_s qp_packer_t;
 typedef struct qp_obj_s qp_obj_t;
 typedef struct siridb_forward_s siridb_forward_t;
+typedef struct siridb_series_s siridb_series_t;
+
+/*
+ * Points for one series which is assigned to the local pool. The points are
+ * read directly from the client package so they do not need to be packed
+ * and parsed again before they can be added to the series.
+ */
+typedef struct siridb_insert_batch_s
+{
+    siridb_pcache_t * pcache;   /* points, sorted by timestamp */
+    uint16_t len;               /* length of name including terminator */
+    char name[];
+} siridb_insert_batch_t;
 
 typedef struct siridb_insert_s
 {
@@ -54,30 +77,85 @@ typedef struct siridb_insert_s
     uint8_t ref;
     uint8_t flags;
     uint16_t pid;
-    uv_stream_t * client;
+    uv_stream_t * client;  /* can be NULL */
+    siridb_t * siridb;
     size_t npoints;        /* number of points */
+    size_t size;           /* size in the insert queue, 0 when not queued */
+    slist_t * batch;       /* series for the local pool or NULL */
+    slist_t * merged;      /* inserts coalesced into this insert or NULL */
     uint16_t packer_size; /* number of packers (one for each pool) */
     qp_packer_t * packer[];
 } siridb_insert_t;
 
+/*
+ * Client inserts which are received within a short window are combined into
+ * one insert so each pool receives a single package. The first insert carries
+ * the points and keeps the other inserts so every client gets a response.
+ */
+typedef struct siridb_insert_group_s
+{
+    uv_timer_t timer;           /* must be on top */
+    siridb_insert_t * insert;   /* carries the points of all inserts */
+    size_t npoints;             /* total number of points */
+} siridb_insert_group_t;
+
+typedef struct siridb_insert_local_s siridb_insert_local_t;
+
+typedef struct siridb_insert_item_s
+{
+    siridb_series_t * series;
+    char * pt;              /* points for the series in the package */
+    siridb_pcache_t * pcache;   /* points from a batch, pt is NULL */
+} siridb_insert_item_t;
+
+typedef struct siridb_insert_job_s
+{
+    siri_ingest_job_t job;  /* must be on top */
+    siridb_insert_local_t * ilocal;
+    uv_async_t * handle;
+    uint32_t stripe;        /* all series in this job use this stripe */
+    int8_t status;
+    size_t len;
+    size_t size;
+    siridb_insert_item_t * items;
+} siridb_insert_job_t;
+
 typedef struct siridb_insert_local_s
 {
     uv_close_cb free_cb;    /* must be on top */
     uint8_t ref;
     uint8_t flags;
     int8_t status;
+    uint16_t pending;       /* number of jobs not yet finished */
     qp_unpacker_t unpacker;
     qp_obj_t qp_series_name;
     siridb_t * siridb;
     sirinet_promise_t * promise;
     siridb_forward_t * forward;
     siridb_pcache_t * pcache;
+    siridb_insert_job_t * jobs;     /* one job for each series stripe */
+    slist_t * batch;                /* used instead of the unpacker */
+    size_t next;                    /* next series in batch */
+    uv_mutex_t mutex;               /* protects 'pending' */
+    uint64_t lsn;                   /* package in the write-ahead log or 0 */
 } siridb_insert_local_t;
 
 ssize_t siridb_insert_assign_pools(
         siridb_t * siridb,
         qp_unpacker_t * unpacker,
-        qp_packer_t * packer[]);
+        siridb_insert_t * insert);
+
+ssize_t siridb_insert_assign_bulk(
+        siridb_t * siridb,
+        qp_unpacker_t * unpacker,
+        siridb_insert_t * insert);
+
+int siridb_insert_assign_pcache(
+        siridb_t * siridb,
+        siridb_insert_t * insert,
+        const char * name,
+        size_t len,
+        siridb_pcache_t * pcache);
 
 const char * siridb_insert_err_msg(siridb_insert_err_t err);
 
@@ -86,9 +164,16 @@ siridb_insert_t * siridb_insert_new(
         uint16_t pid,
         uv_stream_t * client);
 void siridb_insert_free(siridb_insert_t * insert);
+void siridb_insert_enqueue(siridb_insert_t * insert, size_t size);
 int siridb_insert_points_to_pools(siridb_insert_t * insert, size_t npoints);
 int insert_init_backend_local(
         siridb_t * siridb,
         uv_stream_t * client,
         sirinet_pkg_t * pkg,
         uint8_t flags);
+int siridb_insert_local_points(
+        siridb_t * siridb,
+        siridb_series_t * series,
+        qp_unpacker_t * unpacker,
+        qp_obj_t * qp_obj,
+        siridb_pcache_t ** pcache);
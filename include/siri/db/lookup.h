@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 29-07-2016
+ *  - versioned lookup with a wyhash based version, 18-10-2026
  *
  */
 #pragma once
@@ -16,12 +17,36 @@
 
 #define SIRIDB_LOOKUP_SZ 8192
 
-typedef uint_fast16_t siridb_lookup_t[SIRIDB_LOOKUP_SZ];
+/*
+ * Warning: do not change the order since the version is saved in the
+ * database file and must be equal on all servers.
+ */
+typedef enum
+{
+    SIRIDB_LOOKUP_V0,   /* sum of the bytes in the series name */
+    SIRIDB_LOOKUP_V1,   /* wyhash of the series name */
+    SIRIDB_LOOKUP_END   /* not a version */
+} siridb_lookup_version_t;
+
+/*
+ * Version for databases without a lookup version in the database file. This
+ * must stay V0 since existing databases are written without a version. A new
+ * database can be started on another version by writing the version in the
+ * database file (see db.c) or with 'alter database set lookup_version'
+ * before any series is inserted.
+ */
+#define SIRIDB_LOOKUP_DEFAULT SIRIDB_LOOKUP_V0
+
+typedef struct siridb_lookup_s
+{
+    uint8_t version;
+    uint_fast16_t pool[SIRIDB_LOOKUP_SZ];
+} siridb_lookup_t;
 
 uint16_t siridb_lookup_sn(siridb_lookup_t * lookup, const char * sn);
 uint16_t siridb_lookup_sn_raw(
         siridb_lookup_t * lookup,
         const char * sn,
         size_t len);
-siridb_lookup_t * siridb_lookup_new(uint_fast16_t num_pools);
+siridb_lookup_t * siridb_lookup_new(uint_fast16_t num_pools, uint8_t version);
 void siridb_lookup_free(siridb_lookup_t * lookup);
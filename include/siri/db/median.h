@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 16-04-2016
+ *  - median, median_high and median_low share an introselect, 18-10-2026
  *
  */
 #pragma once
@@ -17,7 +18,7 @@
 struct siridb_point_s;
 struct siridb_points_s;
 
-/* sets point int64 or real depending on the given points */
+/* sets point int64 or real to the n-th smallest value (starting at 0) */
 int siridb_median_find_n(
 		siridb_point_t * point,
 		siridb_points_t * points,
@@ -0,0 +1,62 @@
+/*
+ * partial.h - Partial aggregates which can be merged.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * When a merge starts with an aggregate which can be calculated from partial
+ * results, each pool keeps the state of this aggregate for each time window
+ * and only this state is send to the server processing the query.
+ */
+#pragma once
+
+#include <inttypes.h>
+#include <qpack/qpack.h>
+#include <siri/db/points.h>
+#include <siri/db/sketch.h>
+
+typedef struct siridb_partial_s
+{
+    uint64_t ts;
+    uint64_t n;         /* number of values */
+    qp_via_t acc;       /* sum, min or max, a double sum for mean */
+    double mean;        /* mean and sum of squared deviations from the */
+    double m2;          /* mean, only used for variance and pvariance */
+} siridb_partial_t;
+
+/* partial results for windows of time, sorted by timestamp */
+typedef struct siridb_partials_s
+{
+    uint32_t gid;
+    points_tp tp;       /* type of acc, TP_INT until a double is added */
+    uint64_t group_by;
+    double quantile;
+    siridb_sketches_t * sketches;   /* percentile and approx_median only */
+    size_t len;
+    size_t size;
+    siridb_partial_t * windows;
+} siridb_partials_t;
+
+int siridb_partials_supported(uint32_t gid);
+siridb_partials_t * siridb_partials_new(
+        uint32_t gid,
+        uint64_t group_by,
+        double quantile);
+void siridb_partials_free(siridb_partials_t * partials);
+int siridb_partials_add_points(
+        siridb_partials_t * partials,
+        siridb_points_t * points,
+        char * err_msg);
+int siridb_partials_merge_packed(
+        siridb_partials_t * partials,
+        const char * data,
+        size_t len,
+        char * err_msg);
+siridb_points_t * siridb_partials_points(
+        siridb_partials_t * partials,
+        char * err_msg);
+int siridb_partials_pack(siridb_partials_t * partials, qp_packer_t * packer);
@@ -7,6 +7,9 @@
  *
  * changes
  *  - initial version, 08-10-2016
+ *  - added functions for adding points in batches, 18-10-2026
+ *  - added flags like points, 18-10-2026
+ *  - added siridb_pcache_reserve(), 18-10-2026
  *
  */
 #pragma once
@@ -17,6 +20,7 @@ typedef struct siridb_pcache_s
 {
     size_t len;
     points_tp tp;
+    uint8_t flags;      /* always 0, a pcache is never in an arena */
     char * content;     /* string content */
     siridb_point_t * data;
     size_t size;   /* addition to normal points type */
@@ -29,6 +33,15 @@ int siridb_pcache_add_point(
         siridb_pcache_t * pcache,
         uint64_t * ts,
         qp_via_t * val);
+int siridb_pcache_append_point(
+        siridb_pcache_t * pcache,
+        uint64_t * ts,
+        qp_via_t * val);
+int siridb_pcache_add_points(
+        siridb_pcache_t * pcache,
+        siridb_point_t * pts,
+        size_t n);
+int siridb_pcache_reserve(siridb_pcache_t * pcache, size_t n);
 
 #define siridb_pcache_free(pcache) \
     siridb_points_free((siridb_points_t *) pcache)
@@ -0,0 +1,43 @@
+/*
+ * pipeline.h - Outbound insert pipeline for a pool.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * Insert packages for another pool are sent as batches. At most
+ * 'insert_pipeline_depth' batches are in flight for a pool. While all slots
+ * are in use, new packages are appended to the last queued batch. The
+ * response on a batch is passed to the call-back of each package in the
+ * batch.
+ */
+#pragma once
+
+#include <inttypes.h>
+#include <llist/llist.h>
+#include <siri/db/db.h>
+#include <siri/net/pkg.h>
+#include <siri/net/promise.h>
+
+typedef struct siridb_s siridb_t;
+
+typedef struct siridb_pipeline_s
+{
+    uint16_t pool;
+    uint16_t inflight;      /* number of batches waiting for a response */
+    uint32_t ref;           /* one for the pool and one for each batch */
+    siridb_t * siridb;      /* NULL when the pipeline is closed */
+    llist_t * queue;        /* batches which are not send yet */
+} siridb_pipeline_t;
+
+int siridb_pipeline_send_pkg(
+        siridb_t * siridb,
+        uint16_t pool,
+        sirinet_pkg_t * pkg,
+        uint64_t timeout,
+        sirinet_promise_cb cb,
+        void * data);
+void siridb_pipeline_close(siridb_pipeline_t * pipeline);
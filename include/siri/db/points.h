@@ -7,6 +7,9 @@
  *
  * changes
  *  - initial version, 04-04-2016
+ *  - batch functions for adding, sorting and merging points, 18-10-2026
+ *  - pack points which are read in chunks, 18-10-2026
+ *  - points can be allocated in a query arena, 18-10-2026
  *
  */
 #pragma once
@@ -15,6 +18,8 @@
 #include <qpack/qpack.h>
 #include <slist/slist.h>
 
+#define SIRIDB_POINTS_FLAG_ARENA 1     /* allocated in a query arena */
+
 typedef enum
 {
     TP_INT,
@@ -32,6 +37,7 @@ typedef struct siridb_points_s
 {
     size_t len;
     points_tp tp;
+    uint8_t flags;
     char * content;     /* string content */
     siridb_point_t * data;
 } siridb_points_t;
@@ -42,6 +48,17 @@ void siridb_points_add_point(
         siridb_points_t *__restrict points,
         uint64_t * ts,
         qp_via_t * val);
+int siridb_points_resize(siridb_points_t * points, size_t size);
+int siridb_points_sort(siridb_points_t * points);
+int siridb_points_add_points(
+        siridb_points_t *__restrict points,
+        siridb_point_t *__restrict pts,
+        size_t n);
+int siridb_points_merge_runs(
+        siridb_points_t * points,
+        size_t * runs,
+        size_t n);
 int siridb_points_pack(siridb_points_t * points, qp_packer_t * packer);
+int siridb_points_pack_items(siridb_points_t * points, qp_packer_t * packer);
 int siridb_points_raw_pack(siridb_points_t * points, qp_packer_t * packer);
 siridb_points_t * siridb_points_merge(slist_t * plist, char * err_msg);
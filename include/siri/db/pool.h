@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 25-03-2016
+ *  - outbound insert pipeline for each pool, 18-10-2026
  *
  */
 #pragma once
@@ -23,6 +24,7 @@ typedef struct siridb_s siridb_t;
 typedef struct siridb_server_s siridb_server_t;
 typedef struct cexpr_condition_s cexpr_condition_t;
 typedef struct sirinet_promise_s sirinet_promise_t;
+typedef struct siridb_pipeline_s siridb_pipeline_t;
 
 typedef void (* sirinet_promise_cb)(
         sirinet_promise_t * promise,
@@ -33,6 +35,7 @@ typedef struct siridb_pool_s
 {
     uint16_t len;
     siridb_server_t * server[2];
+    siridb_pipeline_t * pipeline;   /* NULL until inserts are send */
 } siridb_pool_t;
 
 typedef struct siridb_pool_walker_s
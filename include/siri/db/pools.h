@@ -37,6 +37,7 @@ typedef struct siridb_pools_s
 } siridb_pools_t;
 
 void siridb_pools_init(siridb_t * siridb);
+void siridb_pools_close(siridb_pools_t * pools);
 void siridb_pools_free(siridb_pools_t * pools);
 siridb_pool_t * siridb_pools_append(
         siridb_pools_t * pools,
@@ -7,6 +7,8 @@
  *
  * changes
  *  - initial version, 10-03-2016
+ *  - added SIRIDB_QUERY_FLAG_STREAM, 18-10-2026
+ *  - added an arena for memory used by the query, 18-10-2026
  *
  */
 #pragma once
@@ -15,6 +17,7 @@
 #define SIRIDB_QUERY_FLAG_REBUILD 2
 #define SIRIDB_QUERY_FLAG_UPDATE_REPLICA 4
 #define SIRIDB_QUERY_FLAG_ERR 8
+#define SIRIDB_QUERY_FLAG_STREAM 16
 
 /*
  * Note(*) : servers must be 'accessible' unless FLAG_ONLY_CHECK_ONLINE is used
@@ -33,6 +36,7 @@ typedef enum
 #include <sys/time.h>
 #include <cleri/parse.h>
 #include <qpack/qpack.h>
+#include <siri/db/arena.h>
 #include <siri/db/time.h>
 #include <siri/db/nodes.h>
 #include <siri/db/series.h>
@@ -70,6 +74,7 @@ typedef struct siridb_query_s
     cleri_parse_t * pr;
     siridb_nodes_t * nodes;
     struct timespec start;
+    siridb_arena_t arena;   /* released when the query is destroyed */
 } siridb_query_t;
 
 void siridb_query_run(
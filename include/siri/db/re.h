@@ -7,12 +7,44 @@
  *
  * changes
  *  - initial version, 04-08-2016
+ *  - added JIT compilation and a compiled expression cache, 18-10-2026
  *
  */
 #pragma once
 
 #include <pcre.h>
 #include <stddef.h>
+#include <inttypes.h>
+
+/* maximum number of compiled expressions we keep in the cache */
+#define SIRIDB_RE_CACHE_SZ 512
+
+/* JIT stack size which is used by each thread (start and max size) */
+#define SIRIDB_RE_JIT_STACK_START 32768
+#define SIRIDB_RE_JIT_STACK_MAX 524288
+
+/* expression is compiled with PCRE_CASELESS */
+#define SIRIDB_RE_FLAG_CASELESS 1
+
+/* expression has no other meta characters than the prefix */
+#define SIRIDB_RE_FLAG_LITERAL 2
+
+typedef struct siridb_re_s siridb_re_t;
+
+typedef struct siridb_re_s
+{
+    uint32_t ref;
+    uint16_t flags;
+    uint16_t prefix_len;
+    uint32_t source_len;
+    uint32_t pad0;
+    char * source;          /* pattern/flags representation (cache key) */
+    char * prefix;          /* literal prefix of every possible match */
+    pcre * regex;
+    pcre_extra * regex_extra;
+    siridb_re_t * prev;     /* more recently used */
+    siridb_re_t * next;     /* less recently used */
+} siridb_re_t;
 
 int siridb_re_compile(
         pcre ** regex,
@@ -20,3 +52,12 @@ int siridb_re_compile(
         const char * source,
         size_t len,
         char * err_msg);
+void siridb_re_free_compiled(pcre * regex, pcre_extra * regex_extra);
+siridb_re_t * siridb_re_get(
+        const char * source,
+        size_t len,
+        char * err_msg);
+int siridb_re_exec(siridb_re_t * re, const char * str, size_t len);
+void siridb_re_incref(siridb_re_t * re);
+void siridb_re_decref(siridb_re_t * re);
+void siridb_re_cache_free(void);
@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 27-07-2016
+ *  - series are sent to their pool in the new lookup, 18-10-2026
  *
  */
 #pragma once
@@ -29,7 +30,7 @@ typedef struct siridb_reindex_s
     uint32_t * next_series_id;
     sirinet_pkg_t * pkg;
     siridb_series_t * series;
-    siridb_server_t * server;
+    uint16_t pool;          /* pool for 'series' in the new lookup */
     uv_timer_t * timer;
 } siridb_reindex_t;
 
@@ -40,3 +41,4 @@ void siridb_reindex_status_update(siridb_t * siridb);
 void siridb_reindex_close(siridb_reindex_t * reindex);
 void siridb_reindex_start(uv_timer_t * timer);
 const char * siridb_reindex_progress(siridb_t * siridb);
+int siridb_reindex_lookup(siridb_t * siridb, uint8_t version);
@@ -7,6 +7,9 @@
  *
  * changes
  *  - initial version, 29-03-2016
+ *  - flush a buffer which is kept in memory by the write-ahead log,
+ *    18-10-2026
+ *  - iterator for reading points in chunks, 18-10-2026
  *
  */
 #pragma once
@@ -18,6 +21,7 @@
 #include <siri/db/buffer.h>
 #include <qpack/qpack.h>
 #include <cexpr/cexpr.h>
+#include <roaring/roaring.h>
 
 typedef struct siridb_s siridb_t;
 typedef struct siridb_buffer_s siridb_buffer_t;
@@ -75,6 +79,26 @@ typedef struct siridb_series_s
     siridb_t * siridb;
 } siridb_series_t;
 
+/*
+ * Reads the points for a series in chunks. Chunks are read from the shards
+ * only when needed and each chunk returned is in time order and starts
+ * after the previous one, also when shard chunks overlap. The series must
+ * not change while iterating so the series stripe and series_mutex must be
+ * locked from init till destroy.
+ */
+typedef struct siridb_series_run_s siridb_series_run_t;
+
+typedef struct siridb_series_iter_s
+{
+    siridb_series_t * series;
+    uint64_t * start_ts;
+    uint64_t * end_ts;
+    uint32_t pos;                   /* next index to read */
+    uint32_t n;                     /* number of runs with points */
+    uint32_t sz;                    /* allocated runs */
+    siridb_series_run_t * runs;
+} siridb_series_iter_t;
+
 int siridb_series_load(siridb_t * siridb);
 
 siridb_series_t * siridb_series_new(
@@ -101,11 +125,30 @@ int siridb_series_add_pcache(
         siridb_series_t *__restrict series,
         siridb_pcache_t *__restrict pcache);
 
+int siridb_series_flush_buffer(
+        siridb_t *__restrict siridb,
+        siridb_series_t *__restrict series,
+        uint32_t checkpoint);
+
 siridb_points_t * siridb_series_get_points(
         siridb_series_t *__restrict series,
         uint64_t *__restrict start_ts,
         uint64_t *__restrict end_ts);
 
+int siridb_series_iter_init(
+        siridb_series_iter_t *__restrict iter,
+        siridb_series_t *__restrict series,
+        uint64_t *__restrict start_ts,
+        uint64_t *__restrict end_ts);
+int siridb_series_iter_next(
+        siridb_series_iter_t *__restrict iter,
+        siridb_points_t *__restrict chunk,
+        char * err_msg);
+void siridb_series_iter_destroy(siridb_series_iter_t * iter);
+int siridb_series_pack_points(
+        siridb_series_t *__restrict series,
+        qp_packer_t *__restrict packer);
+
 void siridb_series_remove_shard(
         siridb_t *__restrict siridb,
         siridb_series_t *__restrict series,
@@ -126,6 +169,9 @@ int siridb_series_drop_commit(siridb_t * siridb, siridb_series_t * series);
 int siridb_series_flush_dropped(siridb_t * siridb);
 uint8_t siridb_series_server_id_by_name(const char * name);
 int siridb_series_open_store(siridb_t * siridb);
+slist_t * siridb_series_slist_ref(siridb_t * siridb, roaring_t * ids);
+void siridb_series_lock_stripes(siridb_t * siridb);
+void siridb_series_unlock_stripes(siridb_t * siridb);
 void siridb__series_free(siridb_series_t *__restrict series);
 void siridb__series_decref(siridb_series_t * series);
 /*
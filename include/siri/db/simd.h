@@ -0,0 +1,73 @@
+/*
+ * simd.h - Vector kernels for aggregating points.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * Kernels work on an array of points. Timestamps and values are separated
+ * in registers so the arithmetic runs on packed values. The kernels for the
+ * best instruction set of the CPU are selected by siridb_simd_init(), with
+ * a scalar fallback.
+ *
+ * All kernels give the same result as the scalar versions, except for sums
+ * of doubles in larger arrays. These are added in more than one lane so the
+ * last bits may differ from a sequential sum.
+ */
+#pragma once
+
+#include <cexpr/cexpr.h>
+#include <inttypes.h>
+#include <siri/db/points.h>
+
+/*
+ * Sums of doubles with less points are calculated sequential so results for
+ * small groups are exactly the same as before vector kernels were used.
+ */
+#define SIRIDB_SIMD_REAL_MIN 64
+
+typedef struct siridb_simd_s
+{
+    const char * name;
+
+    /* number of leading points with a timestamp less than or equal to ts */
+    size_t (*bucket_end)(siridb_point_t * pts, size_t n, uint64_t ts);
+
+    /* returns 0 or -1 in case of an integer overflow */
+    int (*sum_int)(siridb_point_t * pts, size_t n, int64_t * sum);
+    double (*sum_real)(siridb_point_t * pts, size_t n);
+
+    /* minimum and maximum, n must be at least one */
+    int64_t (*min_int)(siridb_point_t * pts, size_t n);
+    int64_t (*max_int)(siridb_point_t * pts, size_t n);
+    double (*min_real)(siridb_point_t * pts, size_t n);
+    double (*max_real)(siridb_point_t * pts, size_t n);
+
+    /* sum of squared deviations from mean */
+    double (*sqdev_int)(siridb_point_t * pts, size_t n, double mean);
+    double (*sqdev_real)(siridb_point_t * pts, size_t n, double mean);
+
+    /* copy matching points to dest and return the number of copied points */
+    size_t (*filter_int)(
+            siridb_point_t * pts,
+            size_t n,
+            cexpr_operator_t opr,
+            int64_t val,
+            siridb_point_t * dest);
+    size_t (*filter_real)(
+            siridb_point_t * pts,
+            size_t n,
+            cexpr_operator_t opr,
+            double val,
+            siridb_point_t * dest);
+} siridb_simd_t;
+
+extern const siridb_simd_t * siridb_simd;
+
+void siridb_simd_init(void);
+const siridb_simd_t * siridb_simd_get(const char * name);
+double siridb_simd_mean(siridb_points_t * points);
+int siridb_simd_bench(void);
@@ -0,0 +1,85 @@
+/*
+ * sketch.h - Mergeable sketch for approximate percentiles.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * The sketch is a DDSketch: values are counted in buckets with
+ * logarithmic bounds so any percentile has a relative error of at most
+ * SIRIDB_SKETCH_ALPHA. Sketches are merged by adding the bucket counts which
+ * gives exactly the same sketch as when all values were added to one.
+ */
+#pragma once
+
+#include <inttypes.h>
+#include <qpack/qpack.h>
+#include <siri/db/points.h>
+
+/* relative accuracy */
+#define SIRIDB_SKETCH_ALPHA 0.01
+
+typedef struct siridb_sketch_store_s
+{
+    int32_t offset;             /* bucket index of counts[0] */
+    uint32_t len;               /* number of buckets in counts */
+    uint64_t * counts;
+} siridb_sketch_store_t;
+
+typedef struct siridb_sketch_s
+{
+    uint64_t count;
+    uint64_t zero;              /* values too close to zero for a bucket */
+    double min;
+    double max;
+    siridb_sketch_store_t pos;
+    siridb_sketch_store_t neg;  /* buckets for the absolute values */
+} siridb_sketch_t;
+
+typedef struct siridb_sketch_window_s
+{
+    uint64_t ts;
+    siridb_sketch_t sketch;
+} siridb_sketch_window_t;
+
+/* sketches for windows of time, sorted by timestamp */
+typedef struct siridb_sketches_s
+{
+    size_t len;
+    size_t size;
+    uint64_t group_by;
+    siridb_sketch_window_t * windows;
+} siridb_sketches_t;
+
+void siridb_sketch_init(siridb_sketch_t * sketch);
+void siridb_sketch_reset(siridb_sketch_t * sketch);
+void siridb_sketch_destroy(siridb_sketch_t * sketch);
+int siridb_sketch_add(siridb_sketch_t * sketch, double val);
+int siridb_sketch_add_points(
+        siridb_sketch_t * sketch,
+        siridb_point_t * pts,
+        size_t n,
+        points_tp tp);
+int siridb_sketch_merge(siridb_sketch_t * sketch, siridb_sketch_t * other);
+double siridb_sketch_quantile(siridb_sketch_t * sketch, double q);
+
+siridb_sketches_t * siridb_sketches_new(uint64_t group_by);
+void siridb_sketches_free(siridb_sketches_t * sketches);
+int siridb_sketches_add_points(
+        siridb_sketches_t * sketches,
+        siridb_points_t * points,
+        char * err_msg);
+int siridb_sketches_merge(
+        siridb_sketches_t * sketches,
+        siridb_sketches_t * other);
+siridb_points_t * siridb_sketches_quantile(
+        siridb_sketches_t * sketches,
+        double q);
+int siridb_sketches_pack(siridb_sketches_t * sketches, qp_packer_t * packer);
+siridb_sketches_t * siridb_sketches_unpack(
+        const char * data,
+        size_t len,
+        uint64_t group_by);
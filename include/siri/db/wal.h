@@ -0,0 +1,87 @@
+/*
+ * wal.h - Write-ahead log for a server with a replica.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * A server with a replica writes each insert to the fifo buffer for the
+ * replica. While the write-ahead log is on, this fifo buffer is also the log
+ * for local inserts: points are only added to the series buffers in memory
+ * and are written to the buffer file at a checkpoint. Inserts which are
+ * received from the replica are written to the fifo buffer too, but these
+ * packages are never send back to the replica.
+ *
+ * At a checkpoint, new insert tasks are held until running insert tasks are
+ * finished. The buffers of changed series are then written and the log
+ * sequence number (LSN) of the first package which is not yet applied is
+ * saved. Packages in the fifo buffer are kept until they are both send to
+ * the replica and passed by a checkpoint. When the database is loaded, the
+ * packages after the last checkpoint are applied again.
+ *
+ * Each buffer has the checkpoint which has written the buffer so a series
+ * can tell where it must continue when a checkpoint was interrupted. The
+ * log is replayed only for series which exist when the database is loaded.
+ * For dropped series, an epoch is saved so points for a series which is
+ * created again after a drop are not replayed from packages before the drop.
+ */
+#pragma once
+
+#include <inttypes.h>
+#include <imap/imap.h>
+#include <llist/llist.h>
+#include <siri/db/db.h>
+#include <siri/db/series.h>
+#include <stdio.h>
+#include <uv.h>
+
+typedef struct siridb_s siridb_t;
+typedef struct siridb_series_s siridb_series_t;
+
+typedef enum
+{
+    SIRIDB_WAL_OFF,
+    SIRIDB_WAL_ON
+} siridb_wal_status_t;
+
+typedef struct siridb_wal_epoch_s
+{
+    uint64_t lsn;               /* first package after the drop */
+    uint32_t max_series_id;     /* series with a higher id are created later */
+} siridb_wal_epoch_t;
+
+typedef struct siridb_wal_s
+{
+    siridb_wal_status_t status;
+    uint8_t hold;               /* new insert tasks wait for a checkpoint */
+    uint32_t checkpoint;        /* last checkpoint */
+    uint32_t inserts;           /* running insert tasks */
+    uint64_t base;              /* replay start for older checkpoints */
+    uint64_t lsn;               /* replay start for the last checkpoint */
+    size_t n;                   /* number of epochs */
+    size_t sz;                  /* allocated epochs */
+    siridb_wal_epoch_t * epochs;
+    llist_t * held;             /* insert tasks waiting for a checkpoint */
+    imap_t * dirty[SIRIDB_SERIES_STRIPES];  /* protected by the stripe */
+    FILE * fp;
+    uv_timer_t * timer;
+} siridb_wal_t;
+
+int siridb_wal_load(siridb_t * siridb);
+void siridb_wal_start(siridb_t * siridb);
+void siridb_wal_close(siridb_t * siridb);
+void siridb_wal_free(siridb_t * siridb);
+int siridb_wal_enabled(siridb_t * siridb);
+void siridb_wal_stop(siridb_t * siridb);
+void siridb_wal_insert_start(siridb_t * siridb, uv_async_t * handle);
+void siridb_wal_insert_done(siridb_t * siridb);
+int siridb_wal_dirty(siridb_t * siridb, siridb_series_t * series);
+void siridb_wal_drop(siridb_t * siridb);
+
+/*
+ * Returns 1 when points are only added to the buffers in memory.
+ */
+#define siridb_wal_is_on(siridb) ((siridb)->wal->status == SIRIDB_WAL_ON)
@@ -7,18 +7,21 @@
  *
  * changes
  *  - initial version, 08-04-2016
+ *  - lock for using files from more than one thread, 18-10-2026
  *
  */
 #pragma once
 
 #include <inttypes.h>
 #include <siri/file/pointer.h>
+#include <uv.h>
 
 typedef struct siri_fh_s
 {
     uint16_t size;
     uint16_t idx;
     siri_fp_t ** fpointers;
+    uv_mutex_t lock;    /* must be locked while using files of the handler */
 } siri_fh_t;
 
 siri_fh_t * siri_fh_new(uint16_t size);
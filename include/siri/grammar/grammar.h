@@ -49,6 +49,7 @@ enum cleri_grammar_ids {
     CLERI_GID_DROP_SHARDS,
     CLERI_GID_DROP_STMT,
     CLERI_GID_DROP_USER,
+    CLERI_GID_F_APPROX_MEDIAN,
     CLERI_GID_F_COUNT,
     CLERI_GID_F_DERIVATIVE,
     CLERI_GID_F_DIFFERENCE,
@@ -60,6 +61,7 @@ enum cleri_grammar_ids {
     CLERI_GID_F_MEDIAN_HIGH,
     CLERI_GID_F_MEDIAN_LOW,
     CLERI_GID_F_MIN,
+    CLERI_GID_F_PERCENTILE,
     CLERI_GID_F_POINTS,
     CLERI_GID_F_PVARIANCE,
     CLERI_GID_F_SUM,
@@ -116,6 +118,7 @@ enum cleri_grammar_ids {
     CLERI_GID_K_AFTER,
     CLERI_GID_K_ALTER,
     CLERI_GID_K_AND,
+    CLERI_GID_K_APPROX_MEDIAN,
     CLERI_GID_K_AS,
     CLERI_GID_K_BACKUP_MODE,
     CLERI_GID_K_BEFORE,
@@ -133,6 +136,7 @@ enum cleri_grammar_ids {
     CLERI_GID_K_DIFFERENCE,
     CLERI_GID_K_DROP,
     CLERI_GID_K_DROP_THRESHOLD,
+    CLERI_GID_K_DROPPED_POINTS,
     CLERI_GID_K_DURATION_LOG,
     CLERI_GID_K_DURATION_NUM,
     CLERI_GID_K_END,
@@ -151,6 +155,8 @@ enum cleri_grammar_ids {
     CLERI_GID_K_IGNORE_THRESHOLD,
     CLERI_GID_K_INFO,
     CLERI_GID_K_INSERT,
+    CLERI_GID_K_INSERT_QUEUE,
+    CLERI_GID_K_INSERT_QUEUE_SIZE,
     CLERI_GID_K_INTEGER,
     CLERI_GID_K_INTERSECTION,
     CLERI_GID_K_IP_SUPPORT,
@@ -160,6 +166,7 @@ enum cleri_grammar_ids {
     CLERI_GID_K_LIST,
     CLERI_GID_K_LOG,
     CLERI_GID_K_LOG_LEVEL,
+    CLERI_GID_K_LOOKUP_VERSION,
     CLERI_GID_K_MAX,
     CLERI_GID_K_MAX_OPEN_FILES,
     CLERI_GID_K_MEAN,
@@ -177,6 +184,7 @@ enum cleri_grammar_ids {
     CLERI_GID_K_OPEN_FILES,
     CLERI_GID_K_OR,
     CLERI_GID_K_PASSWORD,
+    CLERI_GID_K_PERCENTILE,
     CLERI_GID_K_POINTS,
     CLERI_GID_K_POOL,
     CLERI_GID_K_POOLS,
@@ -261,6 +269,7 @@ enum cleri_grammar_ids {
     CLERI_GID_SET_EXPRESSION,
     CLERI_GID_SET_IGNORE_THRESHOLD,
     CLERI_GID_SET_LOG_LEVEL,
+    CLERI_GID_SET_LOOKUP_VERSION,
     CLERI_GID_SET_NAME,
     CLERI_GID_SET_PASSWORD,
     CLERI_GID_SET_PORT,
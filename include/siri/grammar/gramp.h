@@ -23,7 +23,7 @@
 #define KW_COUNT CLERI_GID_K_WRITE + 1 - KW_OFFSET
 
 /* aggregation functions */
-#define F_OFFSET CLERI_GID_F_COUNT
+#define F_OFFSET CLERI_GID_F_APPROX_MEDIAN
 
 /* help statements */
 #define HELP_OFFSET CLERI_GID_HELP
@@ -0,0 +1,54 @@
+/*
+ * ingest.h - Worker threads for applying points to local series.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *  - number of threads is read from the configuration, 18-10-2026
+ *
+ * Jobs are queued on a partition and each partition is handled by exactly
+ * one worker thread, so jobs for the same partition run in the order they
+ * are queued. The job call-back runs in the worker thread and is responsible
+ * for informing the main thread when finished, for example by using
+ * uv_async_send().
+ */
+#pragma once
+
+#include <inttypes.h>
+#include <uv.h>
+
+#define SIRI_INGEST_MAX_THREADS 64
+
+typedef struct siri_s siri_t;
+typedef struct siri_ingest_job_s siri_ingest_job_t;
+
+typedef void (*siri_ingest_cb)(siri_ingest_job_t * job);
+
+typedef struct siri_ingest_job_s
+{
+    siri_ingest_job_t * next;
+    siri_ingest_cb cb;
+} siri_ingest_job_t;
+
+typedef struct siri_ingest_worker_s
+{
+    uv_thread_t thread;
+    uv_mutex_t mutex;
+    uv_cond_t cond;
+    int stop;
+    siri_ingest_job_t * first;
+    siri_ingest_job_t * last;
+} siri_ingest_worker_t;
+
+typedef struct siri_ingest_s
+{
+    size_t n;               /* number of running worker threads */
+    siri_ingest_worker_t * workers;
+} siri_ingest_t;
+
+int siri_ingest_init(siri_t * siri);
+void siri_ingest_destroy(siri_t * siri);
+void siri_ingest_queue(uint32_t partition, siri_ingest_job_t * job);
@@ -0,0 +1,26 @@
+/*
+ * lnserver.h - TCP and UDP listeners for Graphite and InfluxDB line protocol.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *  - paused connections are resumed when inserts are finished, 18-10-2026
+ *
+ * Lines are parsed straight into points and collected per TCP connection or
+ * UDP socket. Collected points are inserted into the database set by
+ * 'line_protocol_db' when the batch window has passed or when enough points
+ * are collected, whichever comes first.
+ */
+#pragma once
+
+#include <siri/siri.h>
+
+typedef struct siri_s siri_t;
+typedef struct siridb_s siridb_t;
+
+int sirinet_lnserver_init(siri_t * siri);
+void sirinet_lnserver_stop(siri_t * siri);
+void sirinet_lnserver_resume(siridb_t * siridb);
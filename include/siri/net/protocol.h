@@ -7,10 +7,23 @@
  *
  * changes
  *  - initial version, 17-03-2016
+ *  - added CPROTO_REQ_INSERT_BULK, 18-10-2026
+ *  - added BPROTO_INSERT_LOCAL, 18-10-2026
+ *  - added CPROTO_REQ_QUERY_STREAM, 18-10-2026
+ *  - documented the stream mode limits, 18-10-2026
  *
  */
 #pragma once
 
+/*
+ * CPROTO_REQ_QUERY_STREAM: a select query is answered with zero or more
+ * CPROTO_RES_QUERY_CHUNK packages followed by one CPROTO_RES_QUERY package
+ * (or an error package, in which case earlier chunks should be discarded).
+ * Only points from series in the pool receiving the query are streamed.
+ * Points from other pools and merged results are collected and sent with
+ * the final package, so they still count for the maximum number of selected
+ * points (one million).
+ */
 typedef enum
 {
     CPROTO_REQ_QUERY,                           // (query, time_precision)
@@ -23,6 +36,8 @@ typedef enum
     CPROTO_REQ_FILE_SERVERS,                    // empty
     CPROTO_REQ_FILE_USERS,                      // empty
     CPROTO_REQ_FILE_GROUPS,                     // empty
+    CPROTO_REQ_INSERT_BULK,                     // columnar series and points
+    CPROTO_REQ_QUERY_STREAM,                    // (query, time_precision)
 } cproto_client_t;
 
 typedef enum
@@ -34,6 +49,7 @@ typedef enum
     CPROTO_RES_ACK,                             // empty
     CPROTO_RES_INFO,                            // [version, [dnname1, ...]]
     CPROTO_RES_FILE,                            // file content
+    CPROTO_RES_QUERY_CHUNK,                     // {series: points, ...}
 
     /* errors 64-69 are errors with messages */
     CPROTO_ERR_MSG=64,                          // {"error_msg": ...}
@@ -72,6 +88,9 @@ typedef enum
     BPROTO_REQ_GROUPS,                          // empty
     BPROTO_ENABLE_BACKUP_MODE,                  // empty
     BPROTO_DISABLE_BACKUP_MODE,                 // empty
+    BPROTO_INSERT_LOCAL,                        /* {series: points, ...}
+                                                only written to the fifo
+                                                buffer and never send */
 } bproto_client_t;
 
 /*
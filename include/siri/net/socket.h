@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 09-03-2016
+ *  - insert queue size and paused flag for admission control, 18-10-2026
  *
  */
 #pragma once
@@ -41,11 +42,13 @@ typedef struct sirinet_socket_s
 {
     sirinet_socket_tp_t tp;
     uint32_t ref;
+    uint8_t paused;     /* reading is stopped until inserts are finished */
     on_data_cb_t on_data;
     siridb_t * siridb;
     void * origin;  /* can be a user, server or NULL */
     char * buf;
     size_t len;
+    size_t insert_size; /* size in bytes of inserts not yet finished */
     uv_tcp_t tcp;
 } sirinet_socket_t;
 
@@ -7,6 +7,11 @@
  *
  * changes
  *  - initial version, 03-05-2016
+ *  - series sets are bitmaps with series id's, 18-10-2026
+ *  - select jobs for the query worker threads, 18-10-2026
+ *  - streaming select results, 18-10-2026
+ *  - merge using sketches for approximate percentiles, 18-10-2026
+ *  - merge using partial aggregates, 18-10-2026
  *
  */
 #pragma once
@@ -14,12 +19,16 @@
 #include <uv.h>
 #include <inttypes.h>
 #include <imap/imap.h>
+#include <roaring/roaring.h>
 #include <slist/slist.h>
 #include <cexpr/cexpr.h>
 #include <cleri/parse.h>
 #include <ctree/ctree.h>
+#include <qpack/qpack.h>
+#include <siri/db/aggregate.h>
 #include <siri/db/presuf.h>
 #include <siri/db/group.h>
+#include <siri/db/re.h>
 #include <siri/db/series.h>
 #include <siri/db/user.h>
 
@@ -46,15 +55,14 @@ typedef enum
 
 #define QUERY_DEF           \
 uint8_t tp;                 \
-imap_t * series_map;        \
-imap_t * series_tmp;        \
+roaring_t * series_map;     \
+roaring_t * series_tmp;     \
 imap_t * pmap;              \
 slist_t * slist;            \
 size_t slist_index;         \
-imap_update_cb update_cb;   \
+roaring_update_cb update_cb;\
 cexpr_t * where_expr;       \
-pcre * regex;               \
-pcre_extra * regex_extra;
+siridb_re_t * re;
 
 
 /* wrappers */
@@ -100,6 +108,8 @@ typedef struct query_list_s
     size_t limit;
 } query_list_t;
 
+typedef struct query_select_jobs_s query_select_jobs_t;
+
 typedef struct query_select_s
 {
     QUERY_DEF
@@ -112,6 +122,10 @@ typedef struct query_select_s
     imap_t * points_map;    // TODO: use points_map for caching
     slist_t * alist;        // aggregation list (can be used multiple times)
     slist_t * mlist;        // merge aggregation list
+    siridb_aggr_t * partial;    // merge using partial results (in mlist)
+    query_select_jobs_t * jobs;     // running on the query worker threads
+    qp_packer_t * chunk;    // streaming only, points not yet send
+    size_t chunk_n;         // number of points in chunk
 } query_select_t;
 
 query_alter_t * query_alter_new(void);
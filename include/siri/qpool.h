@@ -0,0 +1,60 @@
+/*
+ * qpool.h - Worker threads for running parts of a query.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * Jobs are queued on the worker threads in turn. A worker thread without
+ * jobs in its own queue takes (steals) jobs from the queue of another worker
+ * so jobs for one query spread over all threads, even when some jobs take
+ * much longer than others. The order in which jobs run is not defined. The
+ * job call-back runs in a worker thread and is responsible for informing the
+ * main thread when finished, for example by using uv_async_send().
+ *
+ * The pool is only started when query_threads is set in the configuration,
+ * otherwise siri.qpool is NULL.
+ */
+#pragma once
+
+#include <inttypes.h>
+#include <uv.h>
+
+#define SIRI_QPOOL_MAX_THREADS 64
+
+typedef struct siri_s siri_t;
+typedef struct siri_qpool_job_s siri_qpool_job_t;
+
+typedef void (*siri_qpool_cb)(siri_qpool_job_t * job);
+
+typedef struct siri_qpool_job_s
+{
+    siri_qpool_job_t * next;
+    siri_qpool_cb cb;
+} siri_qpool_job_t;
+
+typedef struct siri_qpool_worker_s
+{
+    uv_thread_t thread;
+    uv_mutex_t mutex;           /* protects the job queue */
+    siri_qpool_job_t * first;
+    siri_qpool_job_t * last;
+} siri_qpool_worker_t;
+
+typedef struct siri_qpool_s
+{
+    size_t n;                   /* number of running worker threads */
+    size_t next;                /* worker for the next job */
+    size_t pending;             /* queued jobs, protected by mutex */
+    int stop;
+    uv_mutex_t mutex;
+    uv_cond_t cond;
+    siri_qpool_worker_t * workers;
+} siri_qpool_t;
+
+int siri_qpool_init(siri_t * siri);
+void siri_qpool_destroy(siri_t * siri);
+void siri_qpool_queue(siri_qpool_job_t * job);
@@ -19,6 +19,8 @@
 #include <siri/optimize.h>
 #include <siri/backup.h>
 #include <siri/heartbeat.h>
+#include <siri/ingest.h>
+#include <siri/qpool.h>
 #include <siri/cfg/cfg.h>
 #include <siri/args/args.h>
 #include <llist/llist.h>
@@ -31,6 +33,8 @@ typedef struct siridb_list_s siridb_list_t;
 typedef struct siri_fh_s siri_fh_t;
 typedef struct siri_optimize_s siri_optimize_t;
 typedef struct siri_heartbeat_s siri_heartbeat_t;
+typedef struct siri_ingest_s siri_ingest_t;
+typedef struct siri_qpool_s siri_qpool_t;
 typedef struct siri_backup_s siri_backup_t;
 typedef struct siri_cfg_s siri_cfg_t;
 typedef struct siri_args_s siri_args_t;
@@ -51,6 +55,8 @@ typedef struct siri_s
     llist_t * siridb_list;
     siri_fh_t * fh;
     siri_optimize_t * optimize;
+    siri_ingest_t * ingest;
+    siri_qpool_t * qpool;
     uv_timer_t * backup;
     uv_timer_t * heartbeat;
     siri_cfg_t * cfg;
@@ -0,0 +1,1299 @@
+/*
+ * art.c - Adaptive Radix Tree implementation.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * Each key is stored including its terminator character so no key can be a
+ * prefix of another key. Leafs are stored as tagged pointers in the inner
+ * nodes. Inner nodes store at most ART_MAX_PREFIX_LEN characters of the
+ * compressed path, the remaining characters are verified at the leaf.
+ */
+#include <art/art.h>
+#include <assert.h>
+#include <logger/logger.h>
+#include <siri/err.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define ART_MAX_PREFIX_LEN 10
+
+#define ART_NODE4 1
+#define ART_NODE16 2
+#define ART_NODE48 3
+#define ART_NODE256 4
+
+#define ART_IS_LEAF(x) (((uintptr_t) (x)) & 1)
+#define ART_SET_LEAF(x) ((art_node_t *) (((uintptr_t) (x)) | 1))
+#define ART_LEAF_RAW(x) ((art_leaf_t *) (((uintptr_t) (x)) & ~(uintptr_t) 1))
+
+/* character at position 'depth' in a key with length 'len' */
+#define ART_KEY_AT(key, len, depth) \
+    ((depth) < (len) ? (unsigned char) (key)[depth] : 0)
+
+#define ART_MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+struct art_node_s
+{
+    uint8_t tp;
+    uint8_t pad0;
+    uint16_t num_children;
+    uint32_t partial_len;
+    unsigned char partial[ART_MAX_PREFIX_LEN];
+};
+
+typedef struct art_node4_s
+{
+    art_node_t n;
+    unsigned char keys[4];
+    art_node_t * children[4];
+} art_node4_t;
+
+typedef struct art_node16_s
+{
+    art_node_t n;
+    unsigned char keys[16];
+    art_node_t * children[16];
+} art_node16_t;
+
+typedef struct art_node48_s
+{
+    art_node_t n;
+    unsigned char keys[256];    /* index + 1 of the child, 0 when unused */
+    art_node_t * children[48];
+} art_node48_t;
+
+typedef struct art_node256_s
+{
+    art_node_t n;
+    art_node_t * children[256];
+} art_node256_t;
+
+typedef struct art_leaf_s
+{
+    void * data;
+    size_t len;     /* key length, excluding the terminator */
+    char key[];
+} art_leaf_t;
+
+static art_node_t * ART_node_new(uint8_t tp);
+static art_leaf_t * ART_leaf_new(const char * key, size_t len, void * data);
+static void ART_free(art_node_t * node, art_free_cb cb);
+static art_leaf_t * ART_get(art_t * art, const char * key, size_t len);
+static void ** ART_insert(
+        art_t * art,
+        art_node_t ** ref,
+        const char * key,
+        size_t len,
+        size_t depth,
+        void * data,
+        int * is_new);
+static art_leaf_t * ART_delete(
+        art_node_t * node,
+        art_node_t ** ref,
+        const char * key,
+        size_t len,
+        size_t depth);
+static art_node_t ** ART_find_child(art_node_t * node, unsigned char c);
+static int ART_add_child(
+        art_node_t * node,
+        art_node_t ** ref,
+        unsigned char c,
+        art_node_t * child);
+static void ART_remove_child(
+        art_node_t * node,
+        art_node_t ** ref,
+        unsigned char c,
+        art_node_t ** child);
+static size_t ART_check_prefix(
+        art_node_t * node,
+        const char * key,
+        size_t len,
+        size_t depth);
+static size_t ART_prefix_mismatch(
+        art_node_t * node,
+        const char * key,
+        size_t len,
+        size_t depth);
+static art_leaf_t * ART_minimum(art_node_t * node);
+static int ART_items(art_node_t * node, art_item_cb cb, void * args);
+static int ART_values(art_node_t * node, art_val_cb cb, void * args);
+
+static char dummy = '\1';
+void * ART_EMPTY = &dummy;
+
+/*
+ * Returns NULL and raises a SIGNAL in case an error has occurred.
+ */
+art_t * art_new(void)
+{
+    art_t * art = (art_t *) malloc(sizeof(art_t));
+    if (art == NULL)
+    {
+        ERR_ALLOC
+    }
+    else
+    {
+        art->len = 0;
+        art->root = NULL;
+    }
+    return art;
+}
+
+/*
+ * Destroy the tree. Parsing NULL is NOT allowed.
+ * Call-back function will be called on each item in the tree.
+ */
+void art_free(art_t * art, art_free_cb cb)
+{
+    if (art->root != NULL)
+    {
+        ART_free(art->root, cb);
+    }
+    free(art);
+}
+
+/*
+ * Returns an item from the tree or ART_EMPTY if the key does not exist.
+ * The address or ART_EMPTY should then be used to set a new value.
+ *
+ * In case of an error, NULL is returned and a SIGNAL is raised.
+ */
+void ** art_get_sure(art_t * art, const char * key)
+{
+    int is_new = 0;
+    void ** data = ART_insert(
+            art,
+            &art->root,
+            key,
+            strlen(key),
+            0,
+            ART_EMPTY,
+            &is_new);
+
+    if (is_new)
+    {
+        art->len++;
+    }
+
+    return data;
+}
+
+/*
+ * Add a new key/value. return ART_EXISTS (1) if the key already
+ * exists and ART_OK (0) if not. When the key exists the value will not
+ * be overwritten.
+ *
+ * In case of an error, ART_ERR (-1) will be returned and a SIGNAL is raised.
+ */
+int art_add(art_t * art, const char * key, void * data)
+{
+    int is_new = 0;
+
+    if (ART_insert(
+            art,
+            &art->root,
+            key,
+            strlen(key),
+            0,
+            data,
+            &is_new) == NULL)
+    {
+        return ART_ERR;
+    }
+
+    if (is_new)
+    {
+        art->len++;
+        return ART_OK;
+    }
+
+    return ART_EXISTS;
+}
+
+/*
+ * Returns an item or NULL if the key does not exist.
+ */
+void * art_get(art_t * art, const char * key)
+{
+    art_leaf_t * leaf = ART_get(art, key, strlen(key));
+    return (leaf == NULL) ? NULL : leaf->data;
+}
+
+/*
+ * Returns the address of an item or NULL if the key does not exist.
+ */
+void ** art_getaddr(art_t * art, const char * key)
+{
+    art_leaf_t * leaf = ART_get(art, key, strlen(key));
+    return (leaf == NULL) ? NULL : &leaf->data;
+}
+
+/*
+ * Returns an item or NULL if the key does not exist. Only the first 'n'
+ * characters of 'key' are used as key.
+ */
+void * art_getn(art_t * art, const char * key, size_t n)
+{
+    art_leaf_t * leaf = ART_get(art, key, n);
+    return (leaf == NULL) ? NULL : leaf->data;
+}
+
+/*
+ * Removes and returns an item from the tree or NULL when not found.
+ */
+void * art_pop(art_t * art, const char * key)
+{
+    void * data;
+    art_leaf_t * leaf;
+
+    if (art->root == NULL)
+    {
+        return NULL;
+    }
+
+    leaf = ART_delete(art->root, &art->root, key, strlen(key), 0);
+
+    if (leaf == NULL)
+    {
+        return NULL;
+    }
+
+    art->len--;
+    data = leaf->data;
+    free(leaf);
+
+    return data;
+}
+
+/*
+ * Loop over all items in the tree, in key order, and perform the call-back
+ * on each item.
+ *
+ * Looping stops on the first call-back returning a non-zero value and this
+ * value is returned. When the call-back is called on all items, 0 is
+ * returned.
+ */
+int art_items(art_t * art, art_item_cb cb, void * args)
+{
+    return (art->root == NULL) ? 0 : ART_items(art->root, cb, args);
+}
+
+/*
+ * Loop over all items in the tree having a key which starts with the first
+ * 'n' characters of 'prefix'. Items are walked in key order.
+ *
+ * Looping stops on the first call-back returning a non-zero value and this
+ * value is returned. When the call-back is called on all matching items, 0
+ * is returned.
+ */
+int art_items_prefix(
+        art_t * art,
+        const char * prefix,
+        size_t n,
+        art_item_cb cb,
+        void * args)
+{
+    art_node_t ** child;
+    art_node_t * node = art->root;
+    art_leaf_t * leaf;
+    size_t depth = 0;
+    size_t prefix_len;
+
+    while (node != NULL)
+    {
+        if (ART_IS_LEAF(node))
+        {
+            leaf = ART_LEAF_RAW(node);
+            return (leaf->len >= n && memcmp(leaf->key, prefix, n) == 0) ?
+                    (*cb)(leaf->key, leaf->data, args) : 0;
+        }
+
+        if (depth == n)
+        {
+            /* all items below this node share the prefix */
+            return ART_items(node, cb, args);
+        }
+
+        if (node->partial_len)
+        {
+            prefix_len = ART_prefix_mismatch(node, prefix, n, depth);
+
+            if (prefix_len + depth >= n)
+            {
+                /* the remaining prefix is part of the compressed path */
+                return ART_items(node, cb, args);
+            }
+
+            if (prefix_len < node->partial_len)
+            {
+                return 0;
+            }
+
+            depth += node->partial_len;
+        }
+
+        child = ART_find_child(
+                node,
+                ART_KEY_AT(prefix, n, depth));
+        node = (child == NULL) ? NULL : *child;
+        depth++;
+    }
+
+    return 0;
+}
+
+/*
+ * Loop over all values in the tree and perform the call-back on each value.
+ *
+ * Returns the sum of all the call-backs.
+ */
+int art_values(art_t * art, art_val_cb cb, void * args)
+{
+    return (art->root == NULL) ? 0 : ART_values(art->root, cb, args);
+}
+
+/*
+ * Returns NULL and raises a SIGNAL in case an error has occurred.
+ */
+static art_node_t * ART_node_new(uint8_t tp)
+{
+    art_node_t * node;
+
+    switch (tp)
+    {
+    case ART_NODE4:
+        node = (art_node_t *) calloc(1, sizeof(art_node4_t));
+        break;
+    case ART_NODE16:
+        node = (art_node_t *) calloc(1, sizeof(art_node16_t));
+        break;
+    case ART_NODE48:
+        node = (art_node_t *) calloc(1, sizeof(art_node48_t));
+        break;
+    case ART_NODE256:
+        node = (art_node_t *) calloc(1, sizeof(art_node256_t));
+        break;
+    default:
+        assert (0);
+        node = NULL;
+    }
+
+    if (node == NULL)
+    {
+        ERR_ALLOC
+    }
+    else
+    {
+        node->tp = tp;
+    }
+
+    return node;
+}
+
+/*
+ * Returns NULL and raises a SIGNAL in case an error has occurred.
+ */
+static art_leaf_t * ART_leaf_new(const char * key, size_t len, void * data)
+{
+    art_leaf_t * leaf = (art_leaf_t *) malloc(sizeof(art_leaf_t) + len + 1);
+    if (leaf == NULL)
+    {
+        ERR_ALLOC
+    }
+    else
+    {
+        leaf->data = data;
+        leaf->len = len;
+        memcpy(leaf->key, key, len);
+        leaf->key[len] = '\0';
+    }
+    return leaf;
+}
+
+static void ART_free(art_node_t * node, art_free_cb cb)
+{
+    int i;
+
+    if (ART_IS_LEAF(node))
+    {
+        art_leaf_t * leaf = ART_LEAF_RAW(node);
+        if (cb != NULL && leaf->data != ART_EMPTY)
+        {
+            (*cb)(leaf->data);
+        }
+        free(leaf);
+        return;
+    }
+
+    switch (node->tp)
+    {
+    case ART_NODE4:
+        for (i = 0; i < node->num_children; i++)
+        {
+            ART_free(((art_node4_t *) node)->children[i], cb);
+        }
+        break;
+    case ART_NODE16:
+        for (i = 0; i < node->num_children; i++)
+        {
+            ART_free(((art_node16_t *) node)->children[i], cb);
+        }
+        break;
+    case ART_NODE48:
+        for (i = 0; i < 48; i++)
+        {
+            if (((art_node48_t *) node)->children[i] != NULL)
+            {
+                ART_free(((art_node48_t *) node)->children[i], cb);
+            }
+        }
+        break;
+    case ART_NODE256:
+        for (i = 0; i < 256; i++)
+        {
+            if (((art_node256_t *) node)->children[i] != NULL)
+            {
+                ART_free(((art_node256_t *) node)->children[i], cb);
+            }
+        }
+        break;
+    }
+
+    free(node);
+}
+
+/*
+ * Returns the leaf for a key with length 'len' or NULL when not found.
+ */
+static art_leaf_t * ART_get(art_t * art, const char * key, size_t len)
+{
+    art_node_t ** child;
+    art_node_t * node = art->root;
+    art_leaf_t * leaf;
+    size_t depth = 0;
+
+    while (node != NULL)
+    {
+        if (ART_IS_LEAF(node))
+        {
+            leaf = ART_LEAF_RAW(node);
+            return (leaf->len == len && memcmp(leaf->key, key, len) == 0) ?
+                    leaf : NULL;
+        }
+
+        if (node->partial_len)
+        {
+            if (ART_check_prefix(node, key, len, depth) !=
+                    ART_MIN(ART_MAX_PREFIX_LEN, node->partial_len))
+            {
+                return NULL;
+            }
+            depth += node->partial_len;
+        }
+
+        if (depth > len)
+        {
+            return NULL;
+        }
+
+        child = ART_find_child(node, ART_KEY_AT(key, len, depth));
+        node = (child == NULL) ? NULL : *child;
+        depth++;
+    }
+
+    return NULL;
+}
+
+/*
+ * Returns the address of the data for the key. When the key did not exist,
+ * a leaf is created with 'data' and 'is_new' is set to 1.
+ *
+ * In case of an error, NULL is returned and a SIGNAL is raised.
+ */
+static void ** ART_insert(
+        art_t * art,
+        art_node_t ** ref,
+        const char * key,
+        size_t len,
+        size_t depth,
+        void * data,
+        int * is_new)
+{
+    art_node_t * node = *ref;
+    art_node_t * new_node;
+    art_node_t ** child;
+    art_leaf_t * leaf;
+    art_leaf_t * new_leaf;
+    size_t prefix_len;
+
+    if (node == NULL)
+    {
+        if ((leaf = ART_leaf_new(key, len, data)) == NULL)
+        {
+            return NULL;
+        }
+        *ref = ART_SET_LEAF(leaf);
+        *is_new = 1;
+        return &leaf->data;
+    }
+
+    if (ART_IS_LEAF(node))
+    {
+        leaf = ART_LEAF_RAW(node);
+
+        if (leaf->len == len && memcmp(leaf->key, key, len) == 0)
+        {
+            return &leaf->data;
+        }
+
+        /* split the leaf into a node with both leafs */
+        if (    (new_node = ART_node_new(ART_NODE4)) == NULL ||
+                (new_leaf = ART_leaf_new(key, len, data)) == NULL)
+        {
+            free(new_node);
+            return NULL;
+        }
+
+        /* keys are not equal so they will differ at least at the terminator */
+        for (   prefix_len = 0;
+                (unsigned char) leaf->key[depth + prefix_len] ==
+                ART_KEY_AT(key, len, depth + prefix_len);
+                prefix_len++);
+
+        new_node->partial_len = prefix_len;
+        memcpy( new_node->partial,
+                key + depth,
+                ART_MIN(ART_MAX_PREFIX_LEN, prefix_len));
+
+        *ref = new_node;
+
+        /* a node4 has enough space for two children so this cannot fail */
+        ART_add_child(
+                new_node,
+                ref,
+                (unsigned char) leaf->key[depth + prefix_len],
+                node);
+        ART_add_child(
+                new_node,
+                ref,
+                ART_KEY_AT(key, len, depth + prefix_len),
+                ART_SET_LEAF(new_leaf));
+
+        *is_new = 1;
+        return &new_leaf->data;
+    }
+
+    if (node->partial_len)
+    {
+        prefix_len = ART_prefix_mismatch(node, key, len, depth);
+
+        if (prefix_len < node->partial_len)
+        {
+            /* the compressed path differs, split the node */
+            if (    (new_node = ART_node_new(ART_NODE4)) == NULL ||
+                    (new_leaf = ART_leaf_new(key, len, data)) == NULL)
+            {
+                free(new_node);
+                return NULL;
+            }
+
+            new_node->partial_len = prefix_len;
+            memcpy( new_node->partial,
+                    node->partial,
+                    ART_MIN(ART_MAX_PREFIX_LEN, prefix_len));
+
+            if (node->partial_len <= ART_MAX_PREFIX_LEN)
+            {
+                ART_add_child(new_node, ref, node->partial[prefix_len], node);
+                node->partial_len -= prefix_len + 1;
+                memmove(node->partial,
+                        node->partial + prefix_len + 1,
+                        ART_MIN(ART_MAX_PREFIX_LEN, node->partial_len));
+            }
+            else
+            {
+                /* the stored path is not complete, use the minimum leaf */
+                leaf = ART_minimum(node);
+                node->partial_len -= prefix_len + 1;
+                ART_add_child(
+                        new_node,
+                        ref,
+                        (unsigned char) leaf->key[depth + prefix_len],
+                        node);
+                memcpy( node->partial,
+                        leaf->key + depth + prefix_len + 1,
+                        ART_MIN(ART_MAX_PREFIX_LEN, node->partial_len));
+            }
+
+            *ref = new_node;
+
+            ART_add_child(
+                    new_node,
+                    ref,
+                    ART_KEY_AT(key, len, depth + prefix_len),
+                    ART_SET_LEAF(new_leaf));
+
+            *is_new = 1;
+            return &new_leaf->data;
+        }
+
+        depth += node->partial_len;
+    }
+
+    child = ART_find_child(node, ART_KEY_AT(key, len, depth));
+
+    if (child != NULL)
+    {
+        return ART_insert(art, child, key, len, depth + 1, data, is_new);
+    }
+
+    if ((new_leaf = ART_leaf_new(key, len, data)) == NULL)
+    {
+        return NULL;
+    }
+
+    if (ART_add_child(
+            node,
+            ref,
+            ART_KEY_AT(key, len, depth),
+            ART_SET_LEAF(new_leaf)))
+    {
+        free(new_leaf);
+        return NULL;
+    }
+
+    *is_new = 1;
+    return &new_leaf->data;
+}
+
+/*
+ * Returns the removed leaf or NULL when the key is not found.
+ */
+static art_leaf_t * ART_delete(
+        art_node_t * node,
+        art_node_t ** ref,
+        const char * key,
+        size_t len,
+        size_t depth)
+{
+    art_node_t ** child;
+    art_leaf_t * leaf;
+
+    if (ART_IS_LEAF(node))
+    {
+        leaf = ART_LEAF_RAW(node);
+        if (leaf->len == len && memcmp(leaf->key, key, len) == 0)
+        {
+            *ref = NULL;
+            return leaf;
+        }
+        return NULL;
+    }
+
+    if (node->partial_len)
+    {
+        if (ART_check_prefix(node, key, len, depth) !=
+                ART_MIN(ART_MAX_PREFIX_LEN, node->partial_len))
+        {
+            return NULL;
+        }
+        depth += node->partial_len;
+    }
+
+    if (depth > len)
+    {
+        return NULL;
+    }
+
+    child = ART_find_child(node, ART_KEY_AT(key, len, depth));
+
+    if (child == NULL)
+    {
+        return NULL;
+    }
+
+    if (ART_IS_LEAF(*child))
+    {
+        leaf = ART_LEAF_RAW(*child);
+        if (leaf->len == len && memcmp(leaf->key, key, len) == 0)
+        {
+            ART_remove_child(node, ref, ART_KEY_AT(key, len, depth), child);
+            return leaf;
+        }
+        return NULL;
+    }
+
+    return ART_delete(*child, child, key, len, depth + 1);
+}
+
+static art_node_t ** ART_find_child(art_node_t * node, unsigned char c)
+{
+    int i;
+
+    switch (node->tp)
+    {
+    case ART_NODE4:
+    {
+        art_node4_t * n = (art_node4_t *) node;
+        for (i = 0; i < node->num_children; i++)
+        {
+            if (n->keys[i] == c)
+            {
+                return &n->children[i];
+            }
+        }
+        return NULL;
+    }
+    case ART_NODE16:
+    {
+        art_node16_t * n = (art_node16_t *) node;
+#ifdef __SSE2__
+        /* compare all 16 keys at once */
+        int bitfield = _mm_movemask_epi8(_mm_cmpeq_epi8(
+                _mm_set1_epi8((char) c),
+                _mm_loadu_si128((__m128i *) n->keys))) &
+                ((1 << node->num_children) - 1);
+
+        return (bitfield) ? &n->children[__builtin_ctz(bitfield)] : NULL;
+#else
+        for (i = 0; i < node->num_children; i++)
+        {
+            if (n->keys[i] == c)
+            {
+                return &n->children[i];
+            }
+        }
+        return NULL;
+#endif
+    }
+    case ART_NODE48:
+    {
+        art_node48_t * n = (art_node48_t *) node;
+        i = n->keys[c];
+        return (i) ? &n->children[i - 1] : NULL;
+    }
+    case ART_NODE256:
+    {
+        art_node256_t * n = (art_node256_t *) node;
+        return (n->children[c] != NULL) ? &n->children[c] : NULL;
+    }
+    }
+
+    assert (0);
+    return NULL;
+}
+
+static void ART_copy_header(art_node_t * dest, art_node_t * source)
+{
+    dest->num_children = source->num_children;
+    dest->partial_len = source->partial_len;
+    memcpy( dest->partial,
+            source->partial,
+            ART_MIN(ART_MAX_PREFIX_LEN, source->partial_len));
+}
+
+/*
+ * Add a child to a node. When the node is full, the node is replaced with a
+ * larger one and 'ref' is updated.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+static int ART_add_child(
+        art_node_t * node,
+        art_node_t ** ref,
+        unsigned char c,
+        art_node_t * child)
+{
+    int i;
+
+    switch (node->tp)
+    {
+    case ART_NODE4:
+    {
+        art_node4_t * n = (art_node4_t *) node;
+
+        if (node->num_children < 4)
+        {
+            for (i = 0; i < node->num_children && c > n->keys[i]; i++);
+
+            memmove(n->keys + i + 1,
+                    n->keys + i,
+                    node->num_children - i);
+            memmove(n->children + i + 1,
+                    n->children + i,
+                    (node->num_children - i) * sizeof(art_node_t *));
+            n->keys[i] = c;
+            n->children[i] = child;
+            node->num_children++;
+            return 0;
+        }
+
+        art_node16_t * new_node = (art_node16_t *) ART_node_new(ART_NODE16);
+        if (new_node == NULL)
+        {
+            return -1;
+        }
+        ART_copy_header((art_node_t *) new_node, node);
+        memcpy(new_node->keys, n->keys, 4);
+        memcpy(new_node->children, n->children, 4 * sizeof(art_node_t *));
+        *ref = (art_node_t *) new_node;
+        free(node);
+        return ART_add_child((art_node_t *) new_node, ref, c, child);
+    }
+    case ART_NODE16:
+    {
+        art_node16_t * n = (art_node16_t *) node;
+
+        if (node->num_children < 16)
+        {
+            for (i = 0; i < node->num_children && c > n->keys[i]; i++);
+
+            memmove(n->keys + i + 1,
+                    n->keys + i,
+                    node->num_children - i);
+            memmove(n->children + i + 1,
+                    n->children + i,
+                    (node->num_children - i) * sizeof(art_node_t *));
+            n->keys[i] = c;
+            n->children[i] = child;
+            node->num_children++;
+            return 0;
+        }
+
+        art_node48_t * new_node = (art_node48_t *) ART_node_new(ART_NODE48);
+        if (new_node == NULL)
+        {
+            return -1;
+        }
+        ART_copy_header((art_node_t *) new_node, node);
+        memcpy(new_node->children, n->children, 16 * sizeof(art_node_t *));
+        for (i = 0; i < 16; i++)
+        {
+            new_node->keys[n->keys[i]] = i + 1;
+        }
+        *ref = (art_node_t *) new_node;
+        free(node);
+        return ART_add_child((art_node_t *) new_node, ref, c, child);
+    }
+    case ART_NODE48:
+    {
+        art_node48_t * n = (art_node48_t *) node;
+
+        if (node->num_children < 48)
+        {
+            for (i = 0; n->children[i] != NULL; i++);
+
+            n->children[i] = child;
+            n->keys[c] = i + 1;
+            node->num_children++;
+            return 0;
+        }
+
+        art_node256_t * new_node =
+                (art_node256_t *) ART_node_new(ART_NODE256);
+        if (new_node == NULL)
+        {
+            return -1;
+        }
+        ART_copy_header((art_node_t *) new_node, node);
+        for (i = 0; i < 256; i++)
+        {
+            if (n->keys[i])
+            {
+                new_node->children[i] = n->children[n->keys[i] - 1];
+            }
+        }
+        *ref = (art_node_t *) new_node;
+        free(node);
+        return ART_add_child((art_node_t *) new_node, ref, c, child);
+    }
+    case ART_NODE256:
+    {
+        art_node256_t * n = (art_node256_t *) node;
+        n->children[c] = child;
+        node->num_children++;
+        return 0;
+    }
+    }
+
+    assert (0);
+    return -1;
+}
+
+/*
+ * Remove a child from a node. A node which becomes too small for its type
+ * is replaced with a smaller one and 'ref' is updated. Shrinking is not
+ * critical so allocation errors are ignored.
+ */
+static void ART_remove_child(
+        art_node_t * node,
+        art_node_t ** ref,
+        unsigned char c,
+        art_node_t ** child)
+{
+    int i, pos;
+
+    switch (node->tp)
+    {
+    case ART_NODE4:
+    {
+        art_node4_t * n = (art_node4_t *) node;
+
+        pos = child - n->children;
+        memmove(n->keys + pos,
+                n->keys + pos + 1,
+                node->num_children - 1 - pos);
+        memmove(n->children + pos,
+                n->children + pos + 1,
+                (node->num_children - 1 - pos) * sizeof(art_node_t *));
+        node->num_children--;
+
+        if (node->num_children == 1)
+        {
+            /* collapse the path into the only child */
+            art_node_t * only = n->children[0];
+
+            if (!ART_IS_LEAF(only))
+            {
+                size_t prefix = node->partial_len;
+
+                if (prefix < ART_MAX_PREFIX_LEN)
+                {
+                    node->partial[prefix] = n->keys[0];
+                    prefix++;
+                }
+
+                if (prefix < ART_MAX_PREFIX_LEN)
+                {
+                    size_t sub_prefix = ART_MIN(
+                            only->partial_len,
+                            ART_MAX_PREFIX_LEN - prefix);
+                    memcpy(node->partial + prefix, only->partial, sub_prefix);
+                    prefix += sub_prefix;
+                }
+
+                memcpy( only->partial,
+                        node->partial,
+                        ART_MIN(prefix, ART_MAX_PREFIX_LEN));
+                only->partial_len += node->partial_len + 1;
+            }
+
+            *ref = only;
+            free(node);
+        }
+        return;
+    }
+    case ART_NODE16:
+    {
+        art_node16_t * n = (art_node16_t *) node;
+
+        pos = child - n->children;
+        memmove(n->keys + pos,
+                n->keys + pos + 1,
+                node->num_children - 1 - pos);
+        memmove(n->children + pos,
+                n->children + pos + 1,
+                (node->num_children - 1 - pos) * sizeof(art_node_t *));
+        node->num_children--;
+
+        if (node->num_children == 3)
+        {
+            art_node4_t * new_node = (art_node4_t *) ART_node_new(ART_NODE4);
+            if (new_node != NULL)
+            {
+                ART_copy_header((art_node_t *) new_node, node);
+                memcpy(new_node->keys, n->keys, 3);
+                memcpy( new_node->children,
+                        n->children,
+                        3 * sizeof(art_node_t *));
+                *ref = (art_node_t *) new_node;
+                free(node);
+            }
+        }
+        return;
+    }
+    case ART_NODE48:
+    {
+        art_node48_t * n = (art_node48_t *) node;
+
+        pos = n->keys[c];
+        n->keys[c] = 0;
+        n->children[pos - 1] = NULL;
+        node->num_children--;
+
+        if (node->num_children == 12)
+        {
+            art_node16_t * new_node =
+                    (art_node16_t *) ART_node_new(ART_NODE16);
+            if (new_node != NULL)
+            {
+                ART_copy_header((art_node_t *) new_node, node);
+                for (i = 0, pos = 0; i < 256; i++)
+                {
+                    if (n->keys[i])
+                    {
+                        new_node->keys[pos] = i;
+                        new_node->children[pos] = n->children[n->keys[i] - 1];
+                        pos++;
+                    }
+                }
+                *ref = (art_node_t *) new_node;
+                free(node);
+            }
+        }
+        return;
+    }
+    case ART_NODE256:
+    {
+        art_node256_t * n = (art_node256_t *) node;
+
+        n->children[c] = NULL;
+        node->num_children--;
+
+        if (node->num_children == 37)
+        {
+            art_node48_t * new_node =
+                    (art_node48_t *) ART_node_new(ART_NODE48);
+            if (new_node != NULL)
+            {
+                ART_copy_header((art_node_t *) new_node, node);
+                for (i = 0, pos = 0; i < 256; i++)
+                {
+                    if (n->children[i] != NULL)
+                    {
+                        new_node->children[pos] = n->children[i];
+                        new_node->keys[i] = pos + 1;
+                        pos++;
+                    }
+                }
+                *ref = (art_node_t *) new_node;
+                free(node);
+            }
+        }
+        return;
+    }
+    }
+
+    assert (0);
+}
+
+/*
+ * Returns the number of stored prefix characters matching the key.
+ */
+static size_t ART_check_prefix(
+        art_node_t * node,
+        const char * key,
+        size_t len,
+        size_t depth)
+{
+    size_t max_cmp = ART_MIN(
+            ART_MIN(node->partial_len, ART_MAX_PREFIX_LEN),
+            len + 1 - depth);
+    size_t idx;
+
+    for (idx = 0; idx < max_cmp; idx++)
+    {
+        if (node->partial[idx] != ART_KEY_AT(key, len, depth + idx))
+        {
+            return idx;
+        }
+    }
+
+    return idx;
+}
+
+/*
+ * Returns the number of characters of the compressed path matching the key.
+ * Unlike ART_check_prefix() this includes the characters which are not
+ * stored in the node.
+ */
+static size_t ART_prefix_mismatch(
+        art_node_t * node,
+        const char * key,
+        size_t len,
+        size_t depth)
+{
+    size_t max_cmp = ART_MIN(
+            ART_MIN(node->partial_len, ART_MAX_PREFIX_LEN),
+            len + 1 - depth);
+    size_t idx;
+
+    for (idx = 0; idx < max_cmp; idx++)
+    {
+        if (node->partial[idx] != ART_KEY_AT(key, len, depth + idx))
+        {
+            return idx;
+        }
+    }
+
+    if (node->partial_len > ART_MAX_PREFIX_LEN)
+    {
+        art_leaf_t * leaf = ART_minimum(node);
+
+        max_cmp = ART_MIN(
+                ART_MIN(leaf->len, len) + 1 - depth,
+                node->partial_len);
+
+        for (; idx < max_cmp; idx++)
+        {
+            if ((unsigned char) leaf->key[depth + idx] !=
+                    ART_KEY_AT(key, len, depth + idx))
+            {
+                return idx;
+            }
+        }
+    }
+
+    return idx;
+}
+
+/*
+ * Returns the left most leaf below a node.
+ */
+static art_leaf_t * ART_minimum(art_node_t * node)
+{
+    int i;
+
+    while (!ART_IS_LEAF(node))
+    {
+        switch (node->tp)
+        {
+        case ART_NODE4:
+            node = ((art_node4_t *) node)->children[0];
+            break;
+        case ART_NODE16:
+            node = ((art_node16_t *) node)->children[0];
+            break;
+        case ART_NODE48:
+            for (i = 0; !((art_node48_t *) node)->keys[i]; i++);
+            node = ((art_node48_t *) node)->children[
+                    ((art_node48_t *) node)->keys[i] - 1];
+            break;
+        case ART_NODE256:
+            for (i = 0; ((art_node256_t *) node)->children[i] == NULL; i++);
+            node = ((art_node256_t *) node)->children[i];
+            break;
+        default:
+            assert (0);
+            return NULL;
+        }
+    }
+
+    return ART_LEAF_RAW(node);
+}
+
+static int ART_items(art_node_t * node, art_item_cb cb, void * args)
+{
+    int i, rc;
+
+    if (ART_IS_LEAF(node))
+    {
+        art_leaf_t * leaf = ART_LEAF_RAW(node);
+        return (*cb)(leaf->key, leaf->data, args);
+    }
+
+    switch (node->tp)
+    {
+    case ART_NODE4:
+        for (i = 0; i < node->num_children; i++)
+        {
+            if ((rc = ART_items(((art_node4_t *) node)->children[i], cb, args)))
+            {
+                return rc;
+            }
+        }
+        break;
+    case ART_NODE16:
+        for (i = 0; i < node->num_children; i++)
+        {
+            if ((rc = ART_items(
+                    ((art_node16_t *) node)->children[i], cb, args)))
+            {
+                return rc;
+            }
+        }
+        break;
+    case ART_NODE48:
+        for (i = 0; i < 256; i++)
+        {
+            int idx = ((art_node48_t *) node)->keys[i];
+            if (idx && (rc = ART_items(
+                    ((art_node48_t *) node)->children[idx - 1], cb, args)))
+            {
+                return rc;
+            }
+        }
+        break;
+    case ART_NODE256:
+        for (i = 0; i < 256; i++)
+        {
+            art_node_t * child = ((art_node256_t *) node)->children[i];
+            if (child != NULL && (rc = ART_items(child, cb, args)))
+            {
+                return rc;
+            }
+        }
+        break;
+    }
+
+    return 0;
+}
+
+static int ART_values(art_node_t * node, art_val_cb cb, void * args)
+{
+    int i, rc = 0;
+
+    if (ART_IS_LEAF(node))
+    {
+        art_leaf_t * leaf = ART_LEAF_RAW(node);
+        return (leaf->data == NULL) ? 0 : (*cb)(leaf->data, args);
+    }
+
+    switch (node->tp)
+    {
+    case ART_NODE4:
+        for (i = 0; i < node->num_children; i++)
+        {
+            rc += ART_values(((art_node4_t *) node)->children[i], cb, args);
+        }
+        break;
+    case ART_NODE16:
+        for (i = 0; i < node->num_children; i++)
+        {
+            rc += ART_values(((art_node16_t *) node)->children[i], cb, args);
+        }
+        break;
+    case ART_NODE48:
+        for (i = 0; i < 256; i++)
+        {
+            int idx = ((art_node48_t *) node)->keys[i];
+            if (idx)
+            {
+                rc += ART_values(
+                        ((art_node48_t *) node)->children[idx - 1], cb, args);
+            }
+        }
+        break;
+    case ART_NODE256:
+        for (i = 0; i < 256; i++)
+        {
+            art_node_t * child = ((art_node256_t *) node)->children[i];
+            if (child != NULL)
+            {
+                rc += ART_values(child, cb, args);
+            }
+        }
+        break;
+    }
+
+    return rc;
+}
@@ -0,0 +1,360 @@
+/*
+ * idmap.c - dense map for uint32_t id keys
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ */
+#include <assert.h>
+#include <idmap/idmap.h>
+#include <logger/logger.h>
+#include <siri/err.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* minimal number of chunk pointers to allocate */
+#define IDMAP_MIN_CHUNKS 8
+
+static int IDMAP_grow(idmap_t * idmap, uint32_t n);
+
+/*
+ * Returns NULL and raises a SIGNAL in case an error has occurred.
+ */
+idmap_t * idmap_new(void)
+{
+    idmap_t * idmap = (idmap_t *) malloc(sizeof(idmap_t));
+    if (idmap == NULL)
+    {
+        ERR_ALLOC
+    }
+    else
+    {
+        idmap->len = 0;
+        idmap->n = 0;
+        idmap->chunks = NULL;
+    }
+    return idmap;
+}
+
+/*
+ * Destroy idmap with optional call-back function.
+ */
+void idmap_free(idmap_t * idmap, idmap_free_cb cb)
+{
+    idmap_chunk_t * chunk;
+
+    for (uint32_t i = 0; i < idmap->n; i++)
+    {
+        if ((chunk = idmap->chunks[i]) == NULL)
+        {
+            continue;
+        }
+
+        if (cb != NULL)
+        {
+            for (uint32_t j = 0; chunk->len && j < IDMAP_CHUNK_SZ; j++)
+            {
+                if (chunk->data[j] != NULL)
+                {
+                    chunk->len--;
+                    (*cb)(chunk->data[j]);
+                }
+            }
+        }
+
+        free(chunk);
+    }
+
+    free(idmap->chunks);
+    free(idmap);
+}
+
+/*
+ * Add data by id to the map.
+ *
+ * Returns 0 when data is overwritten and 1 if a new id/value is set.
+ *
+ * In case of an error we return -1 and a SIGNAL is raised.
+ */
+int idmap_add(idmap_t * idmap, uint32_t id, void * data)
+{
+#ifdef DEBUG
+    /* insert NULL is not allowed */
+    assert (data != NULL);
+#endif
+    int rc;
+    idmap_chunk_t ** chunk;
+    uint32_t pos = id >> IDMAP_CHUNK_BITS;
+
+    if (pos >= idmap->n && IDMAP_grow(idmap, pos + 1))
+    {
+        return -1;  /* signal is raised */
+    }
+
+    chunk = idmap->chunks + pos;
+
+    if (*chunk == NULL)
+    {
+        *chunk = (idmap_chunk_t *) calloc(1, sizeof(idmap_chunk_t));
+        if (*chunk == NULL)
+        {
+            ERR_ALLOC
+            return -1;
+        }
+    }
+
+    pos = id & IDMAP_CHUNK_MASK;
+    rc = ((*chunk)->data[pos] == NULL);
+
+    (*chunk)->data[pos] = data;
+    (*chunk)->len += rc;
+    idmap->len += rc;
+
+    return rc;
+}
+
+/*
+ * Returns data by a given id, or NULL when not found.
+ */
+void * idmap_get(idmap_t * idmap, uint32_t id)
+{
+    idmap_chunk_t * chunk;
+    uint32_t pos = id >> IDMAP_CHUNK_BITS;
+
+    return (pos >= idmap->n || (chunk = idmap->chunks[pos]) == NULL) ?
+            NULL : chunk->data[id & IDMAP_CHUNK_MASK];
+}
+
+/*
+ * Remove and return an item by id or return NULL in case the id is not found.
+ */
+void * idmap_pop(idmap_t * idmap, uint32_t id)
+{
+    void * data;
+    idmap_chunk_t ** chunk;
+    uint32_t pos = id >> IDMAP_CHUNK_BITS;
+
+    if (pos >= idmap->n || *(chunk = idmap->chunks + pos) == NULL)
+    {
+        return NULL;
+    }
+
+    pos = id & IDMAP_CHUNK_MASK;
+
+    if ((data = (*chunk)->data[pos]) != NULL)
+    {
+        (*chunk)->data[pos] = NULL;
+        idmap->len--;
+
+        if (!--(*chunk)->len)
+        {
+            free(*chunk);
+            *chunk = NULL;
+        }
+    }
+
+    return data;
+}
+
+/*
+ * Run the call-back function on all items in the map, ordered by id.
+ *
+ * All the results are added together and are returned as the result of
+ * this function.
+ */
+int idmap_walk(idmap_t * idmap, idmap_cb cb, void * args)
+{
+    int rc = 0;
+    idmap_chunk_t * chunk;
+
+    for (uint32_t i = 0; i < idmap->n; i++)
+    {
+        if ((chunk = idmap->chunks[i]) == NULL)
+        {
+            continue;
+        }
+
+        for (uint32_t j = 0, n = chunk->len; n && j < IDMAP_CHUNK_SZ; j++)
+        {
+            if (chunk->data[j] != NULL)
+            {
+                n--;
+                rc += (*cb)(chunk->data[j], args);
+            }
+        }
+    }
+
+    return rc;
+}
+
+/*
+ * Call-back function will be called on each item, ordered by id.
+ *
+ * Walking stops either when the call-back is called on each value or
+ * when 'n' is zero. 'n' will be decremented by the result of each call-back.
+ */
+void idmap_walkn(idmap_t * idmap, size_t * n, idmap_cb cb, void * args)
+{
+    idmap_chunk_t * chunk;
+
+    for (uint32_t i = 0; *n && i < idmap->n; i++)
+    {
+        if ((chunk = idmap->chunks[i]) == NULL)
+        {
+            continue;
+        }
+
+        for (uint32_t j = 0; *n && j < IDMAP_CHUNK_SZ; j++)
+        {
+            if (chunk->data[j] != NULL)
+            {
+                *n -= (*cb)(chunk->data[j], args);
+            }
+        }
+    }
+}
+
+/*
+ * Returns NULL and raises a SIGNAL in case an error has occurred.
+ *
+ * When successful a NEW slist is returned, ordered by id.
+ */
+slist_t * idmap_2slist(idmap_t * idmap)
+{
+    idmap_chunk_t * chunk;
+    slist_t * slist = slist_new(idmap->len);
+
+    if (slist == NULL)
+    {
+        return NULL;  /* signal is raised */
+    }
+
+    for (uint32_t i = 0; i < idmap->n; i++)
+    {
+        if ((chunk = idmap->chunks[i]) == NULL)
+        {
+            continue;
+        }
+
+        for (uint32_t j = 0, n = chunk->len; n && j < IDMAP_CHUNK_SZ; j++)
+        {
+            if (chunk->data[j] != NULL)
+            {
+                n--;
+                slist_append(slist, chunk->data[j]);
+            }
+        }
+    }
+
+    return slist;
+}
+
+/*
+ * Use this function to create a s-list copy and update the ref count
+ * for each object. We expect each object to have object->ref (uint_xxx_t) on
+ * top of the object definition.
+ *
+ * Returns NULL and raises a SIGNAL in case an error has occurred.
+ */
+slist_t * idmap_2slist_ref(idmap_t * idmap)
+{
+    slist_t * slist = idmap_2slist(idmap);
+
+    if (slist != NULL)
+    {
+        for (size_t i = 0; i < slist->len; i++)
+        {
+            slist_object_incref(slist->data[i]);
+        }
+    }
+
+    return slist;
+}
+
+/*
+ * Returns a NEW slist with at most 'n' items, starting at 'id' and ordered
+ * by id. The ref count for each object is updated, like idmap_2slist_ref().
+ * On return, 'id' is set to the next id to start with so this function can
+ * be used to walk over the map in batches, for example when a lock may be
+ * held only for a short period. An empty list is returned when there are no
+ * more items.
+ *
+ * Returns NULL and raises a SIGNAL in case an error has occurred.
+ */
+slist_t * idmap_slice_ref(idmap_t * idmap, uint64_t * id, size_t n)
+{
+    idmap_chunk_t * chunk;
+    uint64_t i = *id >> IDMAP_CHUNK_BITS;
+    uint32_t j = *id & IDMAP_CHUNK_MASK;
+    slist_t * slist = slist_new((n < idmap->len) ? n : idmap->len);
+
+    if (slist == NULL)
+    {
+        return NULL;  /* signal is raised */
+    }
+
+    for (; i < idmap->n; i++, j = 0)
+    {
+        if ((chunk = idmap->chunks[i]) == NULL)
+        {
+            continue;
+        }
+
+        for (; j < IDMAP_CHUNK_SZ; j++)
+        {
+            if (chunk->data[j] == NULL)
+            {
+                continue;
+            }
+
+            if (slist->len == slist->size)
+            {
+                *id = (i << IDMAP_CHUNK_BITS) | j;
+                return slist;
+            }
+
+            slist_append(slist, chunk->data[j]);
+            slist_object_incref(chunk->data[j]);
+        }
+    }
+
+    *id = (uint64_t) idmap->n << IDMAP_CHUNK_BITS;
+    return slist;
+}
+
+/*
+ * Make sure the map has at least 'n' chunk pointers.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+static int IDMAP_grow(idmap_t * idmap, uint32_t n)
+{
+    idmap_chunk_t ** tmp;
+    uint32_t sz = (idmap->n) ? idmap->n : IDMAP_MIN_CHUNKS;
+
+    while (sz < n)
+    {
+        sz *= 2;
+    }
+
+    tmp = (idmap_chunk_t **) realloc(
+            idmap->chunks,
+            sz * sizeof(idmap_chunk_t *));
+
+    if (tmp == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    memset(tmp + idmap->n, 0, (sz - idmap->n) * sizeof(idmap_chunk_t *));
+
+    idmap->chunks = tmp;
+    idmap->n = sz;
+
+    return 0;
+}
@@ -263,6 +263,19 @@ int qp_packer_extend(qp_packer_t * packer, qp_packer_t * source)
     return 0;
 }
 
+/*
+ * Extend packer with already packed data.
+ *
+ * Returns 0 if successful; -1 and a SIGNAL is raised in case an error occurred.
+ */
+int qp_packer_extend_data(qp_packer_t * packer, const char * data, size_t len)
+{
+    QP_RESIZE(len)
+    memcpy(packer->buffer + packer->len, data, len);
+    packer->len += len;
+    return 0;
+}
+
 /*
  * Extend packer with data from an unpacker.
  * (only the object at the current position will be copied)
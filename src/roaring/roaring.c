@@ -0,0 +1,1036 @@
+/*
+ * roaring.c - compressed bitmap for uint32_t id's (roaring style)
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * The loops over bitset words are kept simple so the compiler can
+ * vectorize them.
+ */
+#include <assert.h>
+#include <logger/logger.h>
+#include <roaring/roaring.h>
+#include <siri/err.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROARING_MIN_ARRAY 4
+#define ROARING_MIN_CONTAINERS 4
+
+#define ROARING_HAS_BIT(bitset, low) \
+    ((bitset)[(low) >> 6] & (1ULL << ((low) & 63)))
+
+static int ROARING_find(roaring_t * roaring, uint16_t key);
+static int ROARING_insert(roaring_t * roaring, int i, uint16_t key);
+static void ROARING_finish(roaring_t * roaring);
+static int RC_find(uint16_t * array, uint32_t card, uint16_t low);
+static int RC_contains(roaring_container_t * c, uint16_t low);
+static int RC_copy(roaring_container_t * dest, roaring_container_t * source);
+static int RC_to_bitset(roaring_container_t * c);
+static void RC_normalize(roaring_container_t * c);
+static uint32_t RC_bitset_card(const uint64_t * bitset);
+static int RC_or(roaring_container_t * c, roaring_container_t * o);
+static int RC_and(roaring_container_t * c, roaring_container_t * o);
+static void RC_andnot(roaring_container_t * c, roaring_container_t * o);
+static int RC_xor(roaring_container_t * c, roaring_container_t * o);
+static int ROARING_merge(
+        roaring_t * dest,
+        roaring_t * other,
+        int (*cb)(roaring_container_t * c, roaring_container_t * o));
+
+static inline uint32_t ROARING_popcount(uint64_t x)
+{
+#ifdef __POPCNT__
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (x * 0x0101010101010101ULL) >> 56;
+#endif
+}
+
+/*
+ * Returns NULL and raises a SIGNAL in case an error has occurred.
+ */
+roaring_t * roaring_new(void)
+{
+    roaring_t * roaring = (roaring_t *) malloc(sizeof(roaring_t));
+    if (roaring == NULL)
+    {
+        ERR_ALLOC
+    }
+    else
+    {
+        roaring->len = 0;
+        roaring->n = 0;
+        roaring->size = 0;
+        roaring->containers = NULL;
+    }
+    return roaring;
+}
+
+/*
+ * Returns a copy or NULL and raises a SIGNAL in case an error has occurred.
+ */
+roaring_t * roaring_copy(roaring_t * roaring)
+{
+    roaring_t * copy = roaring_new();
+
+    if (copy == NULL || !roaring->n)
+    {
+        return copy;  /* signal is raised in case of NULL */
+    }
+
+    copy->containers = (roaring_container_t *) malloc(
+            roaring->n * sizeof(roaring_container_t));
+
+    if (copy->containers == NULL)
+    {
+        ERR_ALLOC
+        roaring_free(copy);
+        return NULL;
+    }
+
+    copy->size = roaring->n;
+
+    for (; copy->n < roaring->n; copy->n++)
+    {
+        if (RC_copy(
+                copy->containers + copy->n,
+                roaring->containers + copy->n))
+        {
+            roaring_free(copy);
+            return NULL;  /* signal is raised */
+        }
+    }
+
+    copy->len = roaring->len;
+
+    return copy;
+}
+
+/*
+ * Destroy the bitmap.
+ */
+void roaring_free(roaring_t * roaring)
+{
+    roaring_clear(roaring);
+    free(roaring->containers);
+    free(roaring);
+}
+
+/*
+ * Remove all id's from the bitmap.
+ */
+void roaring_clear(roaring_t * roaring)
+{
+    for (uint32_t i = 0; i < roaring->n; i++)
+    {
+        free(roaring->containers[i].via.array);
+    }
+    roaring->n = 0;
+    roaring->len = 0;
+}
+
+/*
+ * Add an id to the bitmap.
+ *
+ * Returns 0 when the id was already in the bitmap and 1 if the id is added.
+ *
+ * In case of an error we return -1 and a SIGNAL is raised.
+ */
+int roaring_add(roaring_t * roaring, uint32_t id)
+{
+    roaring_container_t * c;
+    uint16_t low = id & 0xffff;
+    int i = ROARING_find(roaring, id >> 16);
+
+    if (i < 0)
+    {
+        i = -i - 1;
+        if (ROARING_insert(roaring, i, id >> 16))
+        {
+            return -1;  /* signal is raised */
+        }
+    }
+
+    c = roaring->containers + i;
+
+    if (c->tp == ROARING_BITSET)
+    {
+        if (ROARING_HAS_BIT(c->via.bitset, low))
+        {
+            return 0;
+        }
+        c->via.bitset[low >> 6] |= 1ULL << (low & 63);
+    }
+    else
+    {
+        int j = RC_find(c->via.array, c->card, low);
+
+        if (j >= 0)
+        {
+            return 0;
+        }
+
+        j = -j - 1;
+
+        if (c->card == ROARING_ARRAY_MAX)
+        {
+            if (RC_to_bitset(c))
+            {
+                return -1;  /* signal is raised */
+            }
+            c->via.bitset[low >> 6] |= 1ULL << (low & 63);
+        }
+        else
+        {
+            if (c->card == c->size)
+            {
+                uint32_t size = c->size * 2;
+                uint16_t * tmp;
+
+                if (size > ROARING_ARRAY_MAX)
+                {
+                    size = ROARING_ARRAY_MAX;
+                }
+
+                tmp = (uint16_t *) realloc(
+                        c->via.array,
+                        size * sizeof(uint16_t));
+
+                if (tmp == NULL)
+                {
+                    ERR_ALLOC
+                    return -1;
+                }
+
+                c->via.array = tmp;
+                c->size = size;
+            }
+
+            memmove(c->via.array + j + 1,
+                    c->via.array + j,
+                    (c->card - j) * sizeof(uint16_t));
+            c->via.array[j] = low;
+        }
+    }
+
+    c->card++;
+    roaring->len++;
+
+    return 1;
+}
+
+/*
+ * Remove an id from the bitmap.
+ *
+ * Returns 1 when the id is removed or 0 if the id was not in the bitmap.
+ */
+int roaring_remove(roaring_t * roaring, uint32_t id)
+{
+    roaring_container_t * c;
+    uint16_t low = id & 0xffff;
+    int i = ROARING_find(roaring, id >> 16);
+
+    if (i < 0)
+    {
+        return 0;
+    }
+
+    c = roaring->containers + i;
+
+    if (c->tp == ROARING_BITSET)
+    {
+        if (!ROARING_HAS_BIT(c->via.bitset, low))
+        {
+            return 0;
+        }
+        c->via.bitset[low >> 6] &= ~(1ULL << (low & 63));
+    }
+    else
+    {
+        int j = RC_find(c->via.array, c->card, low);
+
+        if (j < 0)
+        {
+            return 0;
+        }
+
+        memmove(c->via.array + j,
+                c->via.array + j + 1,
+                (c->card - j - 1) * sizeof(uint16_t));
+    }
+
+    c->card--;
+    roaring->len--;
+
+    if (c->card)
+    {
+        RC_normalize(c);
+    }
+    else
+    {
+        free(c->via.array);
+        roaring->n--;
+        memmove(roaring->containers + i,
+                roaring->containers + i + 1,
+                (roaring->n - i) * sizeof(roaring_container_t));
+    }
+
+    return 1;
+}
+
+/*
+ * Returns 1 if the id is in the bitmap or 0 if not.
+ */
+int roaring_contains(roaring_t * roaring, uint32_t id)
+{
+    int i = ROARING_find(roaring, id >> 16);
+    return (i < 0) ? 0 : RC_contains(roaring->containers + i, id & 0xffff);
+}
+
+/*
+ * Call the call-back function for each id in the bitmap, ordered by id.
+ *
+ * Walking stops on the first call-back returning a non-zero value and this
+ * value is returned. When the call-back is called on all id's, 0 is
+ * returned.
+ */
+int roaring_walk(roaring_t * roaring, roaring_cb cb, void * args)
+{
+    roaring_container_t * c;
+    uint32_t base;
+    uint64_t word;
+    int rc;
+
+    for (uint32_t i = 0; i < roaring->n; i++)
+    {
+        c = roaring->containers + i;
+        base = (uint32_t) c->key << 16;
+
+        if (c->tp == ROARING_ARRAY)
+        {
+            for (uint32_t j = 0; j < c->card; j++)
+            {
+                if ((rc = (*cb)(base | c->via.array[j], args)))
+                {
+                    return rc;
+                }
+            }
+            continue;
+        }
+
+        for (uint32_t w = 0; w < ROARING_BITSET_WORDS; w++)
+        {
+            for (word = c->via.bitset[w]; word; word &= word - 1)
+            {
+                if ((rc = (*cb)(
+                        base | (w << 6) | __builtin_ctzll(word),
+                        args)))
+                {
+                    return rc;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Bitmap 'dest' will be the union between the two bitmaps.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ * In case of an error 'dest' is still valid but might be incomplete.
+ */
+int roaring_union(roaring_t * dest, roaring_t * other)
+{
+    return ROARING_merge(dest, other, RC_or);
+}
+
+/*
+ * Bitmap 'dest' will be the intersection between the two bitmaps.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ * In case of an error 'dest' is still valid but might be incomplete.
+ */
+int roaring_intersection(roaring_t * dest, roaring_t * other)
+{
+    int rc = 0;
+    uint32_t j = 0;
+    roaring_container_t * c;
+
+    for (uint32_t i = 0; i < dest->n; i++)
+    {
+        c = dest->containers + i;
+
+        while (j < other->n && other->containers[j].key < c->key)
+        {
+            j++;
+        }
+
+        if (j == other->n || other->containers[j].key != c->key)
+        {
+            c->card = 0;
+        }
+        else if (RC_and(c, other->containers + j))
+        {
+            rc = -1;  /* signal is raised */
+        }
+    }
+
+    ROARING_finish(dest);
+
+    return rc;
+}
+
+/*
+ * Bitmap 'dest' will be the difference between the two bitmaps.
+ *
+ * Returns 0 (this function cannot fail but returns an int so it can be used
+ * as a roaring_update_cb).
+ */
+int roaring_difference(roaring_t * dest, roaring_t * other)
+{
+    uint32_t j = 0;
+    roaring_container_t * c;
+
+    for (uint32_t i = 0; i < dest->n && j < other->n; i++)
+    {
+        c = dest->containers + i;
+
+        while (j < other->n && other->containers[j].key < c->key)
+        {
+            j++;
+        }
+
+        if (j < other->n && other->containers[j].key == c->key)
+        {
+            RC_andnot(c, other->containers + j);
+        }
+    }
+
+    ROARING_finish(dest);
+
+    return 0;
+}
+
+/*
+ * Bitmap 'dest' will be the symmetric difference between the two bitmaps.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ * In case of an error 'dest' is still valid but might be incomplete.
+ */
+int roaring_symmetric_difference(roaring_t * dest, roaring_t * other)
+{
+    return ROARING_merge(dest, other, RC_xor);
+}
+
+/*
+ * Returns the index of the container for 'key' or (-insert position - 1)
+ * when the container does not exist.
+ */
+static int ROARING_find(roaring_t * roaring, uint16_t key)
+{
+    int low = 0, high = (int) roaring->n - 1, mid;
+
+    while (low <= high)
+    {
+        mid = (low + high) >> 1;
+        if (roaring->containers[mid].key < key)
+        {
+            low = mid + 1;
+        }
+        else if (roaring->containers[mid].key > key)
+        {
+            high = mid - 1;
+        }
+        else
+        {
+            return mid;
+        }
+    }
+
+    return -low - 1;
+}
+
+/*
+ * Insert a new and empty array container at position 'i'.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+static int ROARING_insert(roaring_t * roaring, int i, uint16_t key)
+{
+    roaring_container_t * c;
+    uint16_t * array = (uint16_t *) malloc(
+            ROARING_MIN_ARRAY * sizeof(uint16_t));
+
+    if (array == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    if (roaring->n == roaring->size)
+    {
+        uint32_t size = (roaring->size) ?
+                roaring->size * 2 : ROARING_MIN_CONTAINERS;
+        roaring_container_t * tmp = (roaring_container_t *) realloc(
+                roaring->containers,
+                size * sizeof(roaring_container_t));
+
+        if (tmp == NULL)
+        {
+            ERR_ALLOC
+            free(array);
+            return -1;
+        }
+
+        roaring->containers = tmp;
+        roaring->size = size;
+    }
+
+    c = roaring->containers + i;
+
+    memmove(c + 1, c, (roaring->n - i) * sizeof(roaring_container_t));
+
+    c->key = key;
+    c->tp = ROARING_ARRAY;
+    c->card = 0;
+    c->size = ROARING_MIN_ARRAY;
+    c->via.array = array;
+
+    roaring->n++;
+
+    return 0;
+}
+
+/*
+ * Remove empty containers and update the length.
+ */
+static void ROARING_finish(roaring_t * roaring)
+{
+    uint32_t n = 0;
+    roaring_container_t * c;
+
+    roaring->len = 0;
+
+    for (uint32_t i = 0; i < roaring->n; i++)
+    {
+        c = roaring->containers + i;
+
+        if (!c->card)
+        {
+            free(c->via.array);
+            continue;
+        }
+
+        roaring->len += c->card;
+        roaring->containers[n++] = *c;
+    }
+
+    roaring->n = n;
+}
+
+/*
+ * Merge all containers from 'other' into 'dest' using a call-back function
+ * for containers which exist in both bitmaps.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+static int ROARING_merge(
+        roaring_t * dest,
+        roaring_t * other,
+        int (*cb)(roaring_container_t * c, roaring_container_t * o))
+{
+    int rc = 0;
+    uint32_t i = 0, j = 0, k = 0;
+    uint32_t size = dest->n + other->n;
+    roaring_container_t * containers;
+
+    if (!other->n)
+    {
+        return 0;
+    }
+
+    containers = (roaring_container_t *) malloc(
+            size * sizeof(roaring_container_t));
+
+    if (containers == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    while (i < dest->n || j < other->n)
+    {
+        if (j == other->n || (
+                i < dest->n &&
+                dest->containers[i].key < other->containers[j].key))
+        {
+            containers[k++] = dest->containers[i++];
+        }
+        else if (i == dest->n ||
+                other->containers[j].key < dest->containers[i].key)
+        {
+            if (RC_copy(containers + k, other->containers + j))
+            {
+                rc = -1;  /* signal is raised */
+            }
+            else
+            {
+                k++;
+            }
+            j++;
+        }
+        else
+        {
+            if ((*cb)(dest->containers + i, other->containers + j))
+            {
+                rc = -1;  /* signal is raised */
+            }
+            containers[k++] = dest->containers[i++];
+            j++;
+        }
+    }
+
+    free(dest->containers);
+
+    dest->containers = containers;
+    dest->n = k;
+    dest->size = size;
+
+    ROARING_finish(dest);
+
+    return rc;
+}
+
+/*
+ * Returns the index of 'low' in a sorted array or (-insert position - 1)
+ * when 'low' is not found.
+ */
+static int RC_find(uint16_t * array, uint32_t card, uint16_t low)
+{
+    int lo = 0, high = (int) card - 1, mid;
+
+    while (lo <= high)
+    {
+        mid = (lo + high) >> 1;
+        if (array[mid] < low)
+        {
+            lo = mid + 1;
+        }
+        else if (array[mid] > low)
+        {
+            high = mid - 1;
+        }
+        else
+        {
+            return mid;
+        }
+    }
+
+    return -lo - 1;
+}
+
+static int RC_contains(roaring_container_t * c, uint16_t low)
+{
+    return (c->tp == ROARING_BITSET) ?
+            ROARING_HAS_BIT(c->via.bitset, low) != 0 :
+            RC_find(c->via.array, c->card, low) >= 0;
+}
+
+/*
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+static int RC_copy(roaring_container_t * dest, roaring_container_t * source)
+{
+    size_t sz;
+
+    *dest = *source;
+
+    if (source->tp == ROARING_BITSET)
+    {
+        sz = ROARING_BITSET_WORDS * sizeof(uint64_t);
+    }
+    else
+    {
+        dest->size = (source->card) ? source->card : 1;
+        sz = dest->size * sizeof(uint16_t);
+    }
+
+    dest->via.array = (uint16_t *) malloc(sz);
+
+    if (dest->via.array == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    memcpy(dest->via.array,
+            source->via.array,
+            (source->tp == ROARING_BITSET) ?
+                    sz : source->card * sizeof(uint16_t));
+
+    return 0;
+}
+
+/*
+ * Convert an array container to a bitset container.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+static int RC_to_bitset(roaring_container_t * c)
+{
+    uint64_t * bitset = (uint64_t *) calloc(
+            ROARING_BITSET_WORDS,
+            sizeof(uint64_t));
+
+    if (bitset == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < c->card; i++)
+    {
+        bitset[c->via.array[i] >> 6] |= 1ULL << (c->via.array[i] & 63);
+    }
+
+    free(c->via.array);
+
+    c->via.bitset = bitset;
+    c->tp = ROARING_BITSET;
+    c->size = 0;
+
+    return 0;
+}
+
+/*
+ * Convert a bitset container to an array container when the array would
+ * be smaller. This is not critical so allocation errors are ignored.
+ */
+static void RC_normalize(roaring_container_t * c)
+{
+    if (c->tp != ROARING_BITSET || c->card > ROARING_ARRAY_MAX)
+    {
+        return;
+    }
+
+    uint32_t n = 0;
+    uint32_t size = (c->card) ? c->card : 1;
+    uint64_t word;
+    uint16_t * array = (uint16_t *) malloc(size * sizeof(uint16_t));
+
+    if (array == NULL)
+    {
+        return;
+    }
+
+    for (uint32_t w = 0; w < ROARING_BITSET_WORDS; w++)
+    {
+        for (word = c->via.bitset[w]; word; word &= word - 1)
+        {
+            array[n++] = (w << 6) | __builtin_ctzll(word);
+        }
+    }
+
+    free(c->via.bitset);
+
+    c->via.array = array;
+    c->tp = ROARING_ARRAY;
+    c->size = size;
+}
+
+static uint32_t RC_bitset_card(const uint64_t * bitset)
+{
+    uint32_t card = 0;
+
+    for (uint32_t w = 0; w < ROARING_BITSET_WORDS; w++)
+    {
+        card += ROARING_popcount(bitset[w]);
+    }
+
+    return card;
+}
+
+/*
+ * Merge two sorted arrays into a new array for 'c'. When 'xor' is set only
+ * values which exist in one of the arrays are kept.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+static int RC_merge_arrays(
+        roaring_container_t * c,
+        roaring_container_t * o,
+        int xor)
+{
+    uint32_t i = 0, j = 0, n = 0;
+    uint32_t size = c->card + o->card;
+    uint16_t * a = c->via.array;
+    uint16_t * b = o->via.array;
+    uint16_t * array = (uint16_t *) malloc(size * sizeof(uint16_t));
+
+    if (array == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    while (i < c->card && j < o->card)
+    {
+        if (a[i] < b[j])
+        {
+            array[n++] = a[i++];
+        }
+        else if (a[i] > b[j])
+        {
+            array[n++] = b[j++];
+        }
+        else
+        {
+            if (!xor)
+            {
+                array[n++] = a[i];
+            }
+            i++;
+            j++;
+        }
+    }
+
+    while (i < c->card)
+    {
+        array[n++] = a[i++];
+    }
+
+    while (j < o->card)
+    {
+        array[n++] = b[j++];
+    }
+
+    free(c->via.array);
+
+    c->via.array = array;
+    c->card = n;
+    c->size = size;
+
+    return 0;
+}
+
+static int RC_or(roaring_container_t * c, roaring_container_t * o)
+{
+    if (    c->tp == ROARING_ARRAY &&
+            o->tp == ROARING_ARRAY &&
+            c->card + o->card <= ROARING_ARRAY_MAX)
+    {
+        return RC_merge_arrays(c, o, 0);
+    }
+
+    if (c->tp == ROARING_ARRAY && RC_to_bitset(c))
+    {
+        return -1;  /* signal is raised */
+    }
+
+    uint64_t * restrict a = c->via.bitset;
+
+    if (o->tp == ROARING_BITSET)
+    {
+        const uint64_t * restrict b = o->via.bitset;
+
+        for (uint32_t w = 0; w < ROARING_BITSET_WORDS; w++)
+        {
+            a[w] |= b[w];
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < o->card; i++)
+        {
+            a[o->via.array[i] >> 6] |= 1ULL << (o->via.array[i] & 63);
+        }
+    }
+
+    c->card = RC_bitset_card(a);
+    RC_normalize(c);
+
+    return 0;
+}
+
+static int RC_and(roaring_container_t * c, roaring_container_t * o)
+{
+    uint32_t i, j, n = 0;
+
+    if (c->tp == ROARING_ARRAY)
+    {
+        /* filter the array in place */
+        if (o->tp == ROARING_BITSET)
+        {
+            for (i = 0; i < c->card; i++)
+            {
+                if (ROARING_HAS_BIT(o->via.bitset, c->via.array[i]))
+                {
+                    c->via.array[n++] = c->via.array[i];
+                }
+            }
+        }
+        else
+        {
+            for (i = 0, j = 0; i < c->card && j < o->card; i++)
+            {
+                while (j < o->card && o->via.array[j] < c->via.array[i])
+                {
+                    j++;
+                }
+                if (j < o->card && o->via.array[j] == c->via.array[i])
+                {
+                    c->via.array[n++] = c->via.array[i];
+                }
+            }
+        }
+        c->card = n;
+        return 0;
+    }
+
+    if (o->tp == ROARING_BITSET)
+    {
+        uint64_t * restrict a = c->via.bitset;
+        const uint64_t * restrict b = o->via.bitset;
+
+        for (uint32_t w = 0; w < ROARING_BITSET_WORDS; w++)
+        {
+            a[w] &= b[w];
+        }
+
+        c->card = RC_bitset_card(a);
+        RC_normalize(c);
+        return 0;
+    }
+
+    /* the result fits in an array with the size of the other array */
+    uint32_t size = (o->card) ? o->card : 1;
+    uint16_t * array = (uint16_t *) malloc(size * sizeof(uint16_t));
+
+    if (array == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    for (i = 0; i < o->card; i++)
+    {
+        if (ROARING_HAS_BIT(c->via.bitset, o->via.array[i]))
+        {
+            array[n++] = o->via.array[i];
+        }
+    }
+
+    free(c->via.bitset);
+
+    c->via.array = array;
+    c->tp = ROARING_ARRAY;
+    c->card = n;
+    c->size = size;
+
+    return 0;
+}
+
+static void RC_andnot(roaring_container_t * c, roaring_container_t * o)
+{
+    uint32_t i, j, n = 0;
+
+    if (c->tp == ROARING_ARRAY)
+    {
+        /* filter the array in place */
+        for (i = 0, j = 0; i < c->card; i++)
+        {
+            if (o->tp == ROARING_BITSET)
+            {
+                if (ROARING_HAS_BIT(o->via.bitset, c->via.array[i]))
+                {
+                    continue;
+                }
+            }
+            else
+            {
+                while (j < o->card && o->via.array[j] < c->via.array[i])
+                {
+                    j++;
+                }
+                if (j < o->card && o->via.array[j] == c->via.array[i])
+                {
+                    continue;
+                }
+            }
+            c->via.array[n++] = c->via.array[i];
+        }
+        c->card = n;
+        return;
+    }
+
+    uint64_t * restrict a = c->via.bitset;
+
+    if (o->tp == ROARING_BITSET)
+    {
+        const uint64_t * restrict b = o->via.bitset;
+
+        for (uint32_t w = 0; w < ROARING_BITSET_WORDS; w++)
+        {
+            a[w] &= ~b[w];
+        }
+    }
+    else
+    {
+        for (i = 0; i < o->card; i++)
+        {
+            a[o->via.array[i] >> 6] &= ~(1ULL << (o->via.array[i] & 63));
+        }
+    }
+
+    c->card = RC_bitset_card(a);
+    RC_normalize(c);
+}
+
+static int RC_xor(roaring_container_t * c, roaring_container_t * o)
+{
+    if (    c->tp == ROARING_ARRAY &&
+            o->tp == ROARING_ARRAY &&
+            c->card + o->card <= ROARING_ARRAY_MAX)
+    {
+        return RC_merge_arrays(c, o, 1);
+    }
+
+    if (c->tp == ROARING_ARRAY && RC_to_bitset(c))
+    {
+        return -1;  /* signal is raised */
+    }
+
+    uint64_t * restrict a = c->via.bitset;
+
+    if (o->tp == ROARING_BITSET)
+    {
+        const uint64_t * restrict b = o->via.bitset;
+
+        for (uint32_t w = 0; w < ROARING_BITSET_WORDS; w++)
+        {
+            a[w] ^= b[w];
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < o->card; i++)
+        {
+            a[o->via.array[i] >> 6] ^= 1ULL << (o->via.array[i] & 63);
+        }
+    }
+
+    c->card = RC_bitset_card(a);
+    RC_normalize(c);
+
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include <siri/args/args.h>
 #include <argparse/argparse.h>
+#include <siri/db/simd.h>
 #include <siri/version.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,6 +17,7 @@
 
 static siri_args_t siri_args = {
         .version=0,
+        .bench_aggregates=0,
         .config="",
         .log_level="",
         .log_colorized=0,
@@ -53,6 +55,19 @@ void siri_args_parse(siri_t * siri, int argc, char *argv[])
             NULL                                        /* choices          */
     };
 
+    argparse_argument_t bench_aggregates = {
+            "bench-aggregates",                         /* name             */
+            0,                                          /* shortcut         */
+            "run a benchmark for the aggregation "      /* help             */
+            "kernels and exit",
+            ARGPARSE_STORE_TRUE,                        /* action           */
+            0,                                          /* default int32_t  */
+            &siri_args.bench_aggregates,                /* value pt_int32_t */
+            NULL,                                       /* default string   */
+            NULL,                                       /* value string     */
+            NULL                                        /* choices          */
+    };
+
     argparse_argument_t log_level = {
             "log-level",                                /* name             */
             'l',                                        /* shortcut         */
@@ -79,6 +94,7 @@ void siri_args_parse(siri_t * siri, int argc, char *argv[])
 
     argparse_add_argument(&parser, &config);
     argparse_add_argument(&parser, &version);
+    argparse_add_argument(&parser, &bench_aggregates);
     argparse_add_argument(&parser, &log_level);
     argparse_add_argument(&parser, &log_colorized);
 
@@ -103,4 +119,9 @@ void siri_args_parse(siri_t * siri, int argc, char *argv[])
 
         exit(EXIT_SUCCESS);
     }
+
+    if (siri_args.bench_aggregates)
+    {
+        exit((siridb_simd_bench()) ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
 }
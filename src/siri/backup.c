@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 27-09-2016
+ *  - stop the write-ahead log in backup mode, 18-10-2026
  *
  */
 #include <assert.h>
@@ -16,6 +17,7 @@
 #include <siri/db/server.h>
 #include <siri/db/servers.h>
 #include <siri/db/shard.h>
+#include <siri/db/wal.h>
 #include <siri/optimize.h>
 #include <siri/siri.h>
 #include <stddef.h>
@@ -75,6 +77,9 @@ int siri_backup_enable(siri_t * siri, siridb_t * siridb)
 
     siridb_servers_send_flags(siridb->servers);
 
+    /* a backup requires all points to be in the buffer file or shards */
+    siridb_wal_stop(siridb);
+
     if (~siridb->server->flags & SERVER_FLAG_SYNCHRONIZING)
     {
         siri_optimize_pause();
@@ -167,6 +172,9 @@ static void BACKUP_walk(siridb_t * siridb, void * args)
         siridb_fifo_close(siridb->fifo);
     }
 
+    /* insert worker threads might use the buffer file */
+    uv_mutex_lock(&siridb->buffer_mutex);
+
     if (siridb->buffer_fp != NULL)
     {
         if (fclose(siridb->buffer_fp) == 0)
@@ -179,6 +187,8 @@ static void BACKUP_walk(siridb_t * siridb, void * args)
         }
     }
 
+    uv_mutex_unlock(&siridb->buffer_mutex);
+
     if (siridb->dropped_fp != NULL)
     {
         if (fclose(siridb->dropped_fp) == 0)
@@ -213,6 +223,9 @@ static void BACKUP_walk(siridb_t * siridb, void * args)
          */
         slist_t * shard_list = imap_2slist(siridb->shards);
 
+        /* queries might still read shard files */
+        uv_mutex_lock(&siri.fh->lock);
+
         for (size_t i = 0; i < shard_list->len; i++)
         {
             shard = (siridb_shard_t *) shard_list->data[i];
@@ -228,6 +241,8 @@ static void BACKUP_walk(siridb_t * siridb, void * args)
             }
         }
 
+        uv_mutex_unlock(&siri.fh->lock);
+
         slist_free(shard_list);
     }
 }
@@ -3,6 +3,8 @@
 #include <limits.h>
 #include <logger/logger.h>
 #include <siri/cfg/cfg.h>
+#include <siri/ingest.h>
+#include <siri/qpool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <strextra/strextra.h>
@@ -21,12 +23,25 @@
 static siri_cfg_t siri_cfg = {
         .listen_client_port=9000,
         .listen_backend_port=9010,
+        .listen_graphite_port=0,
+        .listen_influx_port=0,
+        .insert_coalesce_window=0,
+        .insert_coalesce_points=10000,
+        .max_insert_queue=0,
+        .max_insert_queue_client=0,
+        .insert_pipeline_depth=4,
+        .insert_pipeline_batch_size=1024,
+        .wal_checkpoint_interval=1000,
+        .ingest_threads=4,
+        .query_threads=4,
+        .max_query_parallelism=4,
         .heartbeat_interval=30,
         .max_open_files=DEFAULT_OPEN_FILES_LIMIT,
         .optimize_interval=3600,
         .ip_support=IP_SUPPORT_ALL,
         .server_address="localhost",
-        .default_db_path="/var/lib/siridb/"
+        .default_db_path="/var/lib/siridb/",
+        .line_protocol_db=""
 };
 
 static void SIRI_CFG_read_uint(
@@ -35,6 +50,12 @@ static void SIRI_CFG_read_uint(
         int min,
         int max,
         uint32_t * value);
+static void SIRI_CFG_read_opt_uint(
+        cfgparser_t * cfgparser,
+        const char * option_name,
+        int min,
+        int max,
+        uint32_t * value);
 static void SIRI_CFG_read_address_port(
         cfgparser_t * cfgparser,
         const char * option_name,
@@ -43,6 +64,13 @@ static void SIRI_CFG_read_address_port(
 static void SIRI_CFG_read_default_db_path(cfgparser_t * cfgparser);
 static void SIRI_CFG_read_max_open_files(cfgparser_t * cfgparser);
 static void SIRI_CFG_read_ip_support(cfgparser_t * cfgparser);
+static void SIRI_CFG_read_line_protocol(cfgparser_t * cfgparser);
+static void SIRI_CFG_read_insert_coalesce(cfgparser_t * cfgparser);
+static void SIRI_CFG_read_max_insert_queue(cfgparser_t * cfgparser);
+static void SIRI_CFG_read_insert_pipeline(cfgparser_t * cfgparser);
+static void SIRI_CFG_read_wal(cfgparser_t * cfgparser);
+static void SIRI_CFG_read_ingest_threads(cfgparser_t * cfgparser);
+static void SIRI_CFG_read_query_threads(cfgparser_t * cfgparser);
 
 void siri_cfg_init(siri_t * siri)
 {
@@ -99,6 +127,13 @@ void siri_cfg_init(siri_t * siri)
     SIRI_CFG_read_default_db_path(cfgparser);
     SIRI_CFG_read_max_open_files(cfgparser);
     SIRI_CFG_read_ip_support(cfgparser);
+    SIRI_CFG_read_line_protocol(cfgparser);
+    SIRI_CFG_read_insert_coalesce(cfgparser);
+    SIRI_CFG_read_max_insert_queue(cfgparser);
+    SIRI_CFG_read_insert_pipeline(cfgparser);
+    SIRI_CFG_read_wal(cfgparser);
+    SIRI_CFG_read_ingest_threads(cfgparser);
+    SIRI_CFG_read_query_threads(cfgparser);
 
     cfgparser_free(cfgparser);
 }
@@ -157,6 +192,28 @@ static void SIRI_CFG_read_uint(
     }
 }
 
+/*
+ * Like SIRI_CFG_read_uint() but without a warning when the option is missing.
+ */
+static void SIRI_CFG_read_opt_uint(
+        cfgparser_t * cfgparser,
+        const char * option_name,
+        int min,
+        int max,
+        uint32_t * value)
+{
+    cfgparser_option_t * option;
+
+    if (cfgparser_get_option(
+            &option,
+            cfgparser,
+            "siridb",
+            option_name) == CFGPARSER_SUCCESS)
+    {
+        SIRI_CFG_read_uint(cfgparser, option_name, min, max, value);
+    }
+}
+
 static void SIRI_CFG_read_ip_support(cfgparser_t * cfgparser)
 {
     cfgparser_option_t * option;
@@ -214,6 +271,168 @@ static void SIRI_CFG_read_ip_support(cfgparser_t * cfgparser)
     }
 }
 
+/*
+ * The line protocol listeners are optional so no warnings are logged when
+ * the options are missing.
+ */
+static void SIRI_CFG_read_line_protocol(cfgparser_t * cfgparser)
+{
+    cfgparser_option_t * option;
+    uint32_t tmp;
+
+    tmp = siri_cfg.listen_graphite_port;
+    SIRI_CFG_read_opt_uint(
+            cfgparser,
+            "listen_graphite_port",
+            0,
+            65535,
+            &tmp);
+    siri_cfg.listen_graphite_port = (uint16_t) tmp;
+
+    tmp = siri_cfg.listen_influx_port;
+    SIRI_CFG_read_opt_uint(
+            cfgparser,
+            "listen_influx_port",
+            0,
+            65535,
+            &tmp);
+    siri_cfg.listen_influx_port = (uint16_t) tmp;
+
+    if (!siri_cfg.listen_graphite_port && !siri_cfg.listen_influx_port)
+    {
+        return;
+    }
+
+    if (cfgparser_get_option(
+            &option,
+            cfgparser,
+            "siridb",
+            "line_protocol_db") != CFGPARSER_SUCCESS ||
+            option->tp != CFGPARSER_TP_STRING ||
+            !*option->val->string ||
+            strlen(option->val->string) >= SIRIDB_MAX_DBNAME_LEN)
+    {
+        log_warning(
+                "Error reading '%s' in '%s': "
+                "error: expecting a database name. "
+                "The line protocol listeners are disabled.",
+                "line_protocol_db",
+                siri.args->config);
+        siri_cfg.listen_graphite_port = 0;
+        siri_cfg.listen_influx_port = 0;
+        return;
+    }
+
+    strcpy(siri_cfg.line_protocol_db, option->val->string);
+}
+
+/*
+ * Insert coalescing is optional so no warnings are logged when the options
+ * are missing.
+ */
+static void SIRI_CFG_read_insert_coalesce(cfgparser_t * cfgparser)
+{
+    uint32_t tmp = siri_cfg.insert_coalesce_window;
+
+    SIRI_CFG_read_opt_uint(
+            cfgparser,
+            "insert_coalesce_window",
+            0,
+            1000,
+            &tmp);
+    siri_cfg.insert_coalesce_window = (uint16_t) tmp;
+
+    SIRI_CFG_read_opt_uint(
+            cfgparser,
+            "insert_coalesce_points",
+            1,
+            1000000,
+            &siri_cfg.insert_coalesce_points);
+}
+
+/*
+ * Insert queue limits are optional so no warnings are logged when the
+ * options are missing.
+ */
+static void SIRI_CFG_read_max_insert_queue(cfgparser_t * cfgparser)
+{
+    SIRI_CFG_read_opt_uint(
+            cfgparser,
+            "max_insert_queue",
+            0,
+            4194304,  /* 4 GB */
+            &siri_cfg.max_insert_queue);
+
+    SIRI_CFG_read_opt_uint(
+            cfgparser,
+            "max_insert_queue_client",
+            0,
+            4194304,  /* 4 GB */
+            &siri_cfg.max_insert_queue_client);
+}
+
+/*
+ * The insert pipeline options are optional so no warnings are logged when
+ * the options are missing. The batch size is limited so a batch never
+ * exceeds the maximum package size.
+ */
+static void SIRI_CFG_read_insert_pipeline(cfgparser_t * cfgparser)
+{
+    SIRI_CFG_read_opt_uint(
+            cfgparser,
+            "insert_pipeline_depth",
+            1,
+            1024,
+            &siri_cfg.insert_pipeline_depth);
+
+    SIRI_CFG_read_opt_uint(
+            cfgparser,
+            "insert_pipeline_batch_size",
+            1,
+            16384,  /* 16 MB */
+            &siri_cfg.insert_pipeline_batch_size);
+}
+
+/*
+ * The write-ahead log option is optional so no warning is logged when the
+ * option is missing.
+ */
+static void SIRI_CFG_read_wal(cfgparser_t * cfgparser)
+{
+    SIRI_CFG_read_opt_uint(
+            cfgparser,
+            "wal_checkpoint_interval",
+            0,
+            600000,  /* 10 minutes */
+            &siri_cfg.wal_checkpoint_interval);
+}
+
+static void SIRI_CFG_read_ingest_threads(cfgparser_t * cfgparser)
+{
+    SIRI_CFG_read_opt_uint(
+            cfgparser,
+            "ingest_threads",
+            1,
+            SIRI_INGEST_MAX_THREADS,
+            &siri_cfg.ingest_threads);
+}
+
+static void SIRI_CFG_read_query_threads(cfgparser_t * cfgparser)
+{
+    SIRI_CFG_read_opt_uint(
+            cfgparser,
+            "query_threads",
+            0,
+            SIRI_QPOOL_MAX_THREADS,
+            &siri_cfg.query_threads);
+
+    SIRI_CFG_read_opt_uint(
+            cfgparser,
+            "max_query_parallelism",
+            1,
+            SIRI_QPOOL_MAX_THREADS,
+            &siri_cfg.max_query_parallelism);
+}
 
 static void SIRI_CFG_read_default_db_path(cfgparser_t * cfgparser)
 {
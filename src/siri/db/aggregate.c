@@ -7,19 +7,29 @@
  *
  * changes
  *  - initial version, 15-04-2016
+ *  - limit() does not change the shared aggregate, 18-10-2026
+ *  - fused aggregation over chunks of points, 18-10-2026
+ *  - vector kernels for sum, mean, min, max, filter and groups, 18-10-2026
+ *  - approximate percentiles using sketches, 18-10-2026
+ *  - partial aggregates for merged results, 18-10-2026
+ *  - resize points with siridb_points_resize(), 18-10-2026
  *
  */
 #include <assert.h>
 #include <limits.h>
 #include <logger/logger.h>
+#include <math.h>
 #include <siri/db/aggregate.h>
 #include <siri/db/median.h>
+#include <siri/db/simd.h>
+#include <siri/db/sketch.h>
 #include <siri/db/variance.h>
 #include <siri/err.h>
 #include <siri/grammar/grammar.h>
 #include <slist/slist.h>
 #include <stddef.h>
 #include <strextra/strextra.h>
+#include <string.h>
 
 #define AGGR_NEW                                    \
 if ((aggr = AGGREGATE_new(gid)) == NULL)            \
@@ -51,6 +61,46 @@ typedef int (* AGGR_cb)(
 
 static AGGR_cb AGGREGATES[F_OFFSET];
 
+/*
+ * Points flow one by one through the stages of a pipeline. A stage is
+ * created for each aggregate which can handle one point at a time and the
+ * last stage collects the output.
+ */
+typedef struct aggr_stage_s aggr_stage_t;
+
+typedef int (* AGGR_push_cb)(
+        aggr_stage_t * stage,
+        siridb_point_t * point,
+        char * err_msg);
+
+struct aggr_stage_s
+{
+    AGGR_push_cb push_cb;
+    siridb_aggr_t * aggr;
+    aggr_stage_t * next;        /* NULL for the collecting stage */
+    points_tp tp;               /* type of the incoming points */
+    size_t n;                   /* points in the current group */
+    size_t sz;                  /* allocated size for points */
+    uint64_t group_ts;
+    qp_via_t filter;            /* filter value as incoming type */
+    qp_via_t acc;               /* sum, min or max for the current group */
+    siridb_point_t first;       /* or the previous point when not grouped */
+    siridb_point_t last;
+    siridb_points_t * points;   /* output or raw points of current group */
+};
+
+/* number of points in a chunk when reading from a points array */
+#define AGGR_CHUNK_SZ 4096
+
+/* number of filtered points which are send at once to the next stage */
+#define AGGR_FILTER_SZ 1024
+
+typedef struct aggr_chunks_s
+{
+    siridb_points_t * points;
+    size_t pos;
+} aggr_chunks_t;
+
 static siridb_aggr_t * AGGREGATE_new(uint32_t gid);
 static void AGGREGATE_free(siridb_aggr_t * aggr);
 static int AGGREGATE_init_filter(
@@ -76,6 +126,66 @@ static siridb_points_t * AGGREGATE_group_by(
         siridb_points_t * source,
         siridb_aggr_t * aggr,
         char * err_msg);
+static siridb_points_t * AGGREGATE_run_list(
+        siridb_points_t * points,
+        slist_t * alist,
+        size_t offset,
+        char * err_msg);
+static int AGGREGATE_init_stage(
+        aggr_stage_t * stage,
+        siridb_aggr_t * aggr,
+        points_tp * tp);
+static size_t AGGREGATE_init_stages(
+        aggr_stage_t * stages,
+        slist_t * alist,
+        points_tp tp);
+static int AGGREGATE_stage_flush(aggr_stage_t * stage, char * err_msg);
+static int AGGREGATE_stage_grow(aggr_stage_t * stage);
+static int AGGREGATE_push_collect(
+        aggr_stage_t * stage,
+        siridb_point_t * point,
+        char * err_msg);
+static int AGGREGATE_push_filter(
+        aggr_stage_t * stage,
+        siridb_point_t * point,
+        char * err_msg);
+static int AGGREGATE_push_difference(
+        aggr_stage_t * stage,
+        siridb_point_t * point,
+        char * err_msg);
+static int AGGREGATE_push_derivative(
+        aggr_stage_t * stage,
+        siridb_point_t * point,
+        char * err_msg);
+static int AGGREGATE_push_group(
+        aggr_stage_t * stage,
+        siridb_point_t * point,
+        char * err_msg);
+static int AGGREGATE_emit_group(aggr_stage_t * stage, char * err_msg);
+static int AGGREGATE_push_chunk(
+        aggr_stage_t * stage,
+        siridb_point_t * pts,
+        size_t n,
+        char * err_msg);
+static int AGGREGATE_chunk_filter(
+        aggr_stage_t * stage,
+        siridb_point_t * pts,
+        size_t n,
+        char * err_msg);
+static int AGGREGATE_chunk_group(
+        aggr_stage_t * stage,
+        siridb_point_t * pts,
+        size_t n,
+        char * err_msg);
+static int AGGREGATE_group_range(
+        aggr_stage_t * stage,
+        siridb_point_t * pts,
+        size_t n,
+        char * err_msg);
+static int AGGREGATE_chunks_next(
+        aggr_chunks_t * chunks,
+        siridb_points_t * chunk,
+        char * err_msg);
 
 static int aggr_count(
         siridb_point_t * point,
@@ -131,6 +241,11 @@ static int aggr_min(
         siridb_aggr_t * aggr,
         char * err_msg);
 
+static int aggr_percentile(
+        siridb_point_t * point,
+        siridb_points_t * points,
+        siridb_aggr_t * aggr,
+        char * err_msg);
 static int aggr_pvariance(
         siridb_point_t * point,
         siridb_points_t * points,
@@ -160,6 +275,7 @@ void siridb_init_aggregates(void)
     }
 
     /* filter is not included since we only use these for group_by functions */
+    AGGREGATES[CLERI_GID_F_APPROX_MEDIAN - F_OFFSET] = aggr_percentile;
     AGGREGATES[CLERI_GID_F_COUNT - F_OFFSET] = aggr_count;
     AGGREGATES[CLERI_GID_F_DERIVATIVE - F_OFFSET] = aggr_derivative;
     AGGREGATES[CLERI_GID_F_DIFFERENCE - F_OFFSET] = aggr_difference;
@@ -169,9 +285,12 @@ void siridb_init_aggregates(void)
     AGGREGATES[CLERI_GID_F_MEDIAN_HIGH - F_OFFSET] = aggr_median_high;
     AGGREGATES[CLERI_GID_F_MEDIAN_LOW - F_OFFSET] = aggr_median_low;
     AGGREGATES[CLERI_GID_F_MIN - F_OFFSET] = aggr_min;
+    AGGREGATES[CLERI_GID_F_PERCENTILE - F_OFFSET] = aggr_percentile;
     AGGREGATES[CLERI_GID_F_PVARIANCE - F_OFFSET] = aggr_pvariance;
     AGGREGATES[CLERI_GID_F_SUM - F_OFFSET] = aggr_sum;
     AGGREGATES[CLERI_GID_F_VARIANCE - F_OFFSET] = aggr_variance;
+
+    siridb_simd_init();
 }
 
 /*
@@ -377,6 +496,45 @@ slist_t * siridb_aggregate_list(cleri_children_t * children, char * err_msg)
 
                     break;
 
+                case CLERI_GID_F_PERCENTILE:
+                    AGGR_NEW
+                    {
+                        cleri_node_t * qnode = children->node->children->
+                                node->children->next->next->node;
+
+                        aggr->quantile = strx_to_double(
+                                qnode->str,
+                                qnode->len) / 100.0;
+
+                        if (!(aggr->quantile >= 0.0 && aggr->quantile <= 1.0))
+                        {
+                            sprintf(err_msg,
+                                    "Percentile must be a value between 0 "
+                                    "and 100.");
+                            AGGREGATE_free(aggr);
+                            siridb_aggregate_list_free(slist);
+                            return NULL;
+                        }
+
+                        aggr->group_by = children->node->children->node->
+                                children->next->next->next->next->node->result;
+
+                        if (!aggr->group_by)
+                        {
+                            sprintf(err_msg,
+                                    "Group by time must be an integer value "
+                                    "larger than zero.");
+                            AGGREGATE_free(aggr);
+                            siridb_aggregate_list_free(slist);
+                            return NULL;
+                        }
+                    }
+
+                    SLIST_APPEND
+
+                    break;
+
+                case CLERI_GID_F_APPROX_MEDIAN:
                 case CLERI_GID_F_COUNT:
                 case CLERI_GID_F_MAX:
                 case CLERI_GID_F_MEAN:
@@ -480,6 +638,184 @@ siridb_points_t * siridb_aggregate_run(
     return NULL;
 }
 
+/*
+ * Run the aggregation list on points which are read in chunks. The chunks
+ * must be in time order. Aggregates which can handle one point at a time
+ * run together in a single pass over the chunks so no intermediate points
+ * are created; group accumulators are updated while reading. Only median,
+ * percentile, variance and pvariance keep raw points, and only for the
+ * current group.
+ * The remaining aggregates, starting at the first limit(), run on the
+ * output like siridb_aggregate_run().
+ *
+ * Returns new points or NULL in case of an error, in which case err_msg is
+ * set. (a signal might be raised)
+ */
+siridb_points_t * siridb_aggregate_stream(
+        slist_t * alist,
+        points_tp tp,
+        siridb_aggr_next_cb next_cb,
+        void * arg,
+        char * err_msg)
+{
+    aggr_stage_t stages[alist->len + 1];
+    aggr_stage_t * collect;
+    siridb_points_t chunk;
+    siridb_points_t * points;
+    size_t i, n;
+    int rc;
+
+    n = AGGREGATE_init_stages(stages, alist, tp);
+    collect = stages + n;
+
+    if (AGGREGATE_stage_grow(collect))
+    {
+        sprintf(err_msg, "Memory allocation error.");
+        return NULL;
+    }
+
+    while ((rc = (*next_cb)(arg, &chunk, err_msg)) == 1)
+    {
+        if (AGGREGATE_push_chunk(stages, chunk.data, chunk.len, err_msg))
+        {
+            rc = -1;
+            break;
+        }
+    }
+
+    if (rc == 0)
+    {
+        rc = AGGREGATE_stage_flush(stages, err_msg);
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        if (stages[i].points != NULL)
+        {
+            siridb_points_free(stages[i].points);
+        }
+    }
+
+    points = collect->points;
+
+    if (rc)
+    {
+        siridb_points_free(points);
+        return NULL;
+    }
+
+    if (points->len < collect->sz)
+    {
+        /* shrink allocation size, keep at least one point */
+        if (siridb_points_resize(points, points->len))
+        {
+            log_error("Re-allocation points has failed");
+        }
+    }
+
+    return AGGREGATE_run_list(points, alist, n, err_msg);
+}
+
+/*
+ * Run the aggregation list on points. The given points are destroyed when
+ * other points are returned.
+ *
+ * Returns the aggregated points or NULL in case of an error, in which case
+ * err_msg is set.
+ */
+siridb_points_t * siridb_aggregate_list_run(
+        siridb_points_t * points,
+        slist_t * alist,
+        char * err_msg)
+{
+    aggr_chunks_t chunks;
+    siridb_points_t * aggr_points;
+
+    if (!points->len || !alist->len)
+    {
+        return points;
+    }
+
+    /* string values point to the content of the source points */
+    if (points->tp == TP_STRING)
+    {
+        return AGGREGATE_run_list(points, alist, 0, err_msg);
+    }
+
+    chunks.points = points;
+    chunks.pos = 0;
+
+    aggr_points = siridb_aggregate_stream(
+            alist,
+            points->tp,
+            (siridb_aggr_next_cb) AGGREGATE_chunks_next,
+            &chunks,
+            err_msg);
+
+    siridb_points_free(points);
+
+    return aggr_points;
+}
+
+/*
+ * Returns the first aggregate of the list when this aggregate can be
+ * calculated from partial results, or NULL when this is not the case. Pools
+ * use this aggregate to create partial results for a merged result.
+ * An aggregate with limit() depends on all points and is not supported.
+ */
+siridb_aggr_t * siridb_aggregate_partial(slist_t * alist)
+{
+    siridb_aggr_t * aggr;
+
+    if (!alist->len)
+    {
+        return NULL;
+    }
+
+    aggr = (siridb_aggr_t *) alist->data[0];
+
+    return (!aggr->limit &&
+            aggr->group_by &&
+            siridb_partials_supported(aggr->gid)) ? aggr : NULL;
+}
+
+/*
+ * Returns new partial results for an aggregate or NULL in case of an
+ * allocation error. (a signal is raised in case of an allocation error)
+ */
+siridb_partials_t * siridb_aggregate_partials_new(siridb_aggr_t * aggr)
+{
+    return siridb_partials_new(aggr->gid, aggr->group_by, aggr->quantile);
+}
+
+/*
+ * Run the aggregation list on partial results. The first aggregate in the
+ * list must be the aggregate for the partial results, see
+ * siridb_aggregate_partial(). The other aggregates run on the points which
+ * are returned by the partial results.
+ *
+ * Returns the aggregated points or NULL in case of an error, in which case
+ * err_msg is set. (a signal might be raised)
+ */
+siridb_points_t * siridb_aggregate_partials_run(
+        siridb_partials_t * partials,
+        slist_t * alist,
+        char * err_msg)
+{
+    siridb_points_t * points;
+#ifdef DEBUG
+    assert (siridb_aggregate_partial(alist) != NULL);
+#endif
+
+    points = siridb_partials_points(partials, err_msg);
+    if (points == NULL)
+    {
+        return NULL;  /* error message is set */
+    }
+
+    return AGGREGATE_run_list(points, alist, 1, err_msg);
+}
+
 /*
  * Returns NULL and raises a SIGNAL in case an error has occurred.
  */
@@ -497,6 +833,7 @@ static siridb_aggr_t * AGGREGATE_new(uint32_t gid)
         aggr->limit = 0;
         aggr->offset = 0;
         aggr->timespan = 1.0;
+        aggr->quantile = 0.5;
         aggr->filter_tp = TP_INT;  /* when string we malloc/free
                                                   * aggr->filter_via.raw */
     }
@@ -578,10 +915,16 @@ static siridb_points_t * AGGREGATE_limit(
     uint64_t timespan =
             source->data[source->len - 1].ts - source->data[0].ts;
 
-    aggr->group_by = timespan / aggr->limit + 1;
-    aggr->offset = (source->data[0].ts - 1) % aggr->group_by;
+    /*
+     * Use a copy since the aggregate is shared between series which might
+     * be aggregated at the same time by the query worker threads.
+     */
+    siridb_aggr_t group = *aggr;
 
-    return AGGREGATE_group_by(source, aggr, err_msg);
+    group.group_by = timespan / aggr->limit + 1;
+    group.offset = (source->data[0].ts - 1) % group.group_by;
+
+    return AGGREGATE_group_by(source, &group, err_msg);
 }
 
 static siridb_points_t * AGGREGATE_derivative(
@@ -781,37 +1124,21 @@ static siridb_points_t * AGGREGATE_filter(
             break;
 
         case TP_INT:
-            for (   i = 0, spt = source->data, dpt = points->data;
-                    i < source->len;
-                    i++, spt++)
-            {
-                if (cexpr_int_cmp(
-                        aggr->filter_opr,
-                        spt->val.int64,
-                        value.int64))
-                {
-                    dpt->ts = spt->ts;
-                    dpt->val = spt->val;
-                    dpt++;
-                }
-            }
+            dpt = points->data + (*siridb_simd->filter_int)(
+                    source->data,
+                    source->len,
+                    aggr->filter_opr,
+                    value.int64,
+                    points->data);
             break;
 
         case TP_DOUBLE:
-            for (   i = 0, spt = source->data, dpt = points->data;
-                    i < source->len;
-                    i++, spt++)
-            {
-                if (cexpr_double_cmp(
-                        aggr->filter_opr,
-                        spt->val.real,
-                        value.real))
-                {
-                    dpt->ts = spt->ts;
-                    dpt->val = spt->val;
-                    dpt++;
-                }
-            }
+            dpt = points->data + (*siridb_simd->filter_real)(
+                    source->data,
+                    source->len,
+                    aggr->filter_opr,
+                    value.real,
+                    points->data);
             break;
 
         default:
@@ -823,18 +1150,11 @@ static siridb_points_t * AGGREGATE_filter(
 
         if (source->len > points->len)
         {
-            dpt = (siridb_point_t *) realloc(
-                    points->data,
-                    points->len * sizeof(siridb_point_t));
-            if (dpt == NULL && points->len)
+            if (siridb_points_resize(points, points->len))
             {
                 /* not critical */
                 log_error("Error while re-allocating memory for points");
             }
-            else
-            {
-                points->data = dpt;
-            }
         }
     }
 
@@ -869,8 +1189,10 @@ static siridb_points_t * AGGREGATE_group_by(
     /* create new points with max possible size after re-indexing */
     switch(aggr->gid)
     {
+    case CLERI_GID_F_APPROX_MEDIAN:
     case CLERI_GID_F_MEAN:
     case CLERI_GID_F_MEDIAN:
+    case CLERI_GID_F_PERCENTILE:
     case CLERI_GID_F_PVARIANCE:
     case CLERI_GID_F_VARIANCE:
     case CLERI_GID_F_DERIVATIVE:
@@ -900,24 +1222,33 @@ static siridb_points_t * AGGREGATE_group_by(
 
     goup_ts = GROUP_TS(source->data);
 
-    for(start = end = 0; end < source->len; end++)
+    /* the first point of a group is always part of that group */
+    for(start = 0, end = 1; end < source->len;)
     {
-        if ((source->data + end)->ts > goup_ts)
+        end += (*siridb_simd->bucket_end)(
+                source->data + end,
+                source->len - end,
+                goup_ts);
+
+        if (end == source->len)
         {
-            group.data = (source->data + start);
-            group.len = end - start;
-            point = points->data + points->len;
-            point->ts = goup_ts;
-            if (aggr_cb(point, &group, aggr, err_msg))
-            {
-                /* error occurred, return NULL */
-                siridb_points_free(points);
-                return NULL;
-            }
-            points->len++;
-            start = end;
-            goup_ts = GROUP_TS((source->data + end));
+            break;
+        }
+
+        group.data = (source->data + start);
+        group.len = end - start;
+        point = points->data + points->len;
+        point->ts = goup_ts;
+        if (aggr_cb(point, &group, aggr, err_msg))
+        {
+            /* error occurred, return NULL */
+            siridb_points_free(points);
+            return NULL;
         }
+        points->len++;
+        start = end;
+        goup_ts = GROUP_TS((source->data + end));
+        end++;
     }
 
     group.data = (source->data + start);
@@ -935,17 +1266,11 @@ static siridb_points_t * AGGREGATE_group_by(
     if (points->len < max_sz)
     {
         /* shrink points allocation */
-        point = (siridb_point_t *)
-                realloc(points->data, points->len * sizeof(siridb_point_t));
-        if (point == NULL && points->len)
+        if (siridb_points_resize(points, points->len))
         {
             /* not critical */
             log_error("Re-allocation points failed.");
         }
-        else
-        {
-            points->data = point;
-        }
     }
 #ifdef DEBUG
     else
@@ -958,73 +1283,865 @@ static siridb_points_t * AGGREGATE_group_by(
     return points;
 }
 
-static int aggr_count(
-        siridb_point_t * point,
+/*
+ * Run the aggregation list, starting at a given offset, one aggregate at a
+ * time. The given points are destroyed when other points are returned.
+ */
+static siridb_points_t * AGGREGATE_run_list(
         siridb_points_t * points,
-        siridb_aggr_t * aggr,
+        slist_t * alist,
+        size_t offset,
         char * err_msg)
 {
-    point->val.int64 = points->len;
-    return 0;
+    siridb_points_t * aggr_points;
+
+    for (size_t i = offset; points->len && i < alist->len; i++)
+    {
+        aggr_points = siridb_aggregate_run(
+                points,
+                (siridb_aggr_t *) alist->data[i],
+                err_msg);
+
+        if (aggr_points != points)
+        {
+            siridb_points_free(points);
+        }
+
+        if (aggr_points == NULL)
+        {
+            return NULL;
+        }
+
+        points = aggr_points;
+    }
+
+    return points;
 }
 
-static int aggr_derivative(
-        siridb_point_t * point,
-        siridb_points_t * points,
+/*
+ * Initialize a stage for an aggregate. The type is updated to the type of
+ * the points which are send to the next stage.
+ *
+ * Returns 0 if successful or -1 when the aggregate cannot be used in a
+ * stage, for example limit() which needs to know all points first.
+ */
+static int AGGREGATE_init_stage(
+        aggr_stage_t * stage,
         siridb_aggr_t * aggr,
-        char * err_msg)
+        points_tp * tp)
 {
-#ifdef DEBUG
-    assert (points->len);
-#endif
-
-    if (points->tp == TP_STRING)
+    if (aggr->limit || *tp == TP_STRING)
     {
-        sprintf(err_msg, "Cannot use difference() on string type.");
         return -1;
     }
 
-    if (points->len == 1)
-    {
-        point->val.real = 0.0;
-    }
-    else
+    stage->aggr = aggr;
+    stage->tp = *tp;
+    stage->n = 0;
+    stage->sz = 0;
+    stage->points = NULL;
+    stage->next = stage + 1;
+
+    if (aggr->group_by)
     {
-        double first, last;
+        stage->push_cb = AGGREGATE_push_group;
 
-        switch (points->tp)
+        switch (aggr->gid)
         {
-        case TP_INT:
-            first = (double) points->data->val.int64;
-            last = (double) (points->data + points->len - 1)->val.int64;
+        case CLERI_GID_F_APPROX_MEDIAN:
+        case CLERI_GID_F_MEAN:
+        case CLERI_GID_F_MEDIAN:
+        case CLERI_GID_F_PERCENTILE:
+        case CLERI_GID_F_PVARIANCE:
+        case CLERI_GID_F_VARIANCE:
+        case CLERI_GID_F_DERIVATIVE:
+            *tp = TP_DOUBLE;
             break;
-        case TP_DOUBLE:
-            first = points->data->val.real;
-            last = (points->data + points->len - 1)->val.real;
+        case CLERI_GID_F_COUNT:
+            *tp = TP_INT;
             break;
         default:
-            assert (0);
             break;
         }
 
-        /* time-span is actually a factor when used with group_by */
-        point->val.real = (last- first) * aggr->timespan;
+        return 0;
     }
 
-    return 0;
-}
-
-static int aggr_difference(
-        siridb_point_t * point,
-        siridb_points_t * points,
-        siridb_aggr_t * aggr,
-        char * err_msg)
-{
-#ifdef DEBUG
-    assert (points->len);
-#endif
-
-    switch (points->tp)
+    switch (aggr->gid)
+    {
+    case CLERI_GID_F_DIFFERENCE:
+        stage->push_cb = AGGREGATE_push_difference;
+        return 0;
+
+    case CLERI_GID_F_DERIVATIVE:
+        stage->push_cb = AGGREGATE_push_derivative;
+        *tp = TP_DOUBLE;
+        return 0;
+
+    case CLERI_GID_F_FILTER:
+        /* type errors are left to AGGREGATE_filter() */
+        if (aggr->filter_tp == TP_STRING)
+        {
+            return -1;
+        }
+
+        stage->push_cb = AGGREGATE_push_filter;
+        stage->filter = aggr->filter_via;
+
+        if (aggr->filter_tp != *tp)
+        {
+            if (*tp == TP_INT)
+            {
+                stage->filter.int64 = (int64_t) aggr->filter_via.real;
+            }
+            else
+            {
+                stage->filter.real = (double) aggr->filter_via.int64;
+            }
+        }
+        return 0;
+
+    default:
+        assert (0);
+        break;
+    }
+
+    return -1;
+}
+
+/*
+ * Initialize stages for the aggregation list, followed by the stage which
+ * collects the output.
+ *
+ * Returns the number of aggregates which are handled by the stages.
+ */
+static size_t AGGREGATE_init_stages(
+        aggr_stage_t * stages,
+        slist_t * alist,
+        points_tp tp)
+{
+    aggr_stage_t * collect;
+    size_t n;
+
+    for (n = 0; n < alist->len; n++)
+    {
+        if (AGGREGATE_init_stage(
+                stages + n,
+                (siridb_aggr_t *) alist->data[n],
+                &tp))
+        {
+            break;
+        }
+    }
+
+    collect = stages + n;
+    collect->push_cb = AGGREGATE_push_collect;
+    collect->aggr = NULL;
+    collect->next = NULL;
+    collect->tp = tp;
+    collect->n = 0;
+    collect->sz = 0;
+    collect->points = NULL;
+
+    return n;
+}
+
+/*
+ * Emit the last group for each stage, in order since an emitted point might
+ * start a group in the next stage.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ */
+static int AGGREGATE_stage_flush(aggr_stage_t * stage, char * err_msg)
+{
+    for (; stage->next != NULL; stage = stage->next)
+    {
+        if (    stage->push_cb == AGGREGATE_push_group &&
+                stage->n &&
+                AGGREGATE_emit_group(stage, err_msg))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Create or double the points for a stage.
+ *
+ * Returns 0 if successful or -1 and a signal is raised in case of an error.
+ */
+static int AGGREGATE_stage_grow(aggr_stage_t * stage)
+{
+    size_t sz;
+
+    if (stage->points == NULL)
+    {
+        stage->points = siridb_points_new(AGGR_CHUNK_SZ, stage->tp);
+        if (stage->points == NULL)
+        {
+            return -1;  /* signal is raised */
+        }
+        stage->sz = AGGR_CHUNK_SZ;
+        return 0;
+    }
+
+    sz = stage->sz * 2;
+    if (siridb_points_resize(stage->points, sz))
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    stage->sz = sz;
+
+    return 0;
+}
+
+static int AGGREGATE_push_collect(
+        aggr_stage_t * stage,
+        siridb_point_t * point,
+        char * err_msg)
+{
+    if (stage->points->len == stage->sz && AGGREGATE_stage_grow(stage))
+    {
+        sprintf(err_msg, "Memory allocation error.");
+        return -1;
+    }
+
+    stage->points->data[stage->points->len++] = *point;
+
+    return 0;
+}
+
+static int AGGREGATE_push_filter(
+        aggr_stage_t * stage,
+        siridb_point_t * point,
+        char * err_msg)
+{
+    int match = (stage->tp == TP_INT) ?
+            cexpr_int_cmp(
+                    stage->aggr->filter_opr,
+                    point->val.int64,
+                    stage->filter.int64) :
+            cexpr_double_cmp(
+                    stage->aggr->filter_opr,
+                    point->val.real,
+                    stage->filter.real);
+
+    return (match) ? (*stage->next->push_cb)(stage->next, point, err_msg) : 0;
+}
+
+/*
+ * Difference without group_by. The first point is only used as previous.
+ */
+static int AGGREGATE_push_difference(
+        aggr_stage_t * stage,
+        siridb_point_t * point,
+        char * err_msg)
+{
+    siridb_point_t dpt;
+
+    if (!stage->n++)
+    {
+        stage->first = *point;
+        return 0;
+    }
+
+    dpt.ts = point->ts;
+
+    if (stage->tp == TP_INT)
+    {
+        int64_t first = stage->first.val.int64;
+        int64_t last = point->val.int64;
+
+        if ((first > 0 && last < LLONG_MIN + first) ||
+                (first < 0 && last > LLONG_MAX + first))
+        {
+            sprintf(err_msg, "Overflow detected while using difference().");
+            return -1;
+        }
+
+        dpt.val.int64 = last - first;
+    }
+    else
+    {
+        dpt.val.real = point->val.real - stage->first.val.real;
+    }
+
+    stage->first = *point;
+
+    return (*stage->next->push_cb)(stage->next, &dpt, err_msg);
+}
+
+/*
+ * Derivative without group_by. The first point is only used as previous.
+ */
+static int AGGREGATE_push_derivative(
+        aggr_stage_t * stage,
+        siridb_point_t * point,
+        char * err_msg)
+{
+    siridb_point_t dpt;
+
+    if (!stage->n++)
+    {
+        stage->first = *point;
+        return 0;
+    }
+
+    dpt.ts = point->ts;
+    dpt.val.real = ((stage->tp == TP_INT) ?
+            (double) point->val.int64 - stage->first.val.int64 :
+            point->val.real - stage->first.val.real) /
+            (double) (point->ts - stage->first.ts) * stage->aggr->timespan;
+
+    stage->first = *point;
+
+    return (*stage->next->push_cb)(stage->next, &dpt, err_msg);
+}
+
+/*
+ * Add a point to the current group. The group is emitted when a point for a
+ * next group is received.
+ */
+static int AGGREGATE_push_group(
+        aggr_stage_t * stage,
+        siridb_point_t * point,
+        char * err_msg)
+{
+    siridb_aggr_t * aggr = stage->aggr;
+
+    if (stage->n && point->ts > stage->group_ts)
+    {
+        if (AGGREGATE_emit_group(stage, err_msg))
+        {
+            return -1;
+        }
+    }
+
+    if (!stage->n)
+    {
+        stage->group_ts = GROUP_TS(point);
+        stage->first = *point;
+
+        switch (aggr->gid)
+        {
+        case CLERI_GID_F_MIN:
+        case CLERI_GID_F_MAX:
+            stage->acc = point->val;
+            break;
+        case CLERI_GID_F_SUM:
+            if (stage->tp == TP_INT)
+            {
+                stage->acc.int64 = 0;
+            }
+            else
+            {
+                stage->acc.real = 0.0;
+            }
+            break;
+        case CLERI_GID_F_MEAN:
+            stage->acc.real = 0.0;
+            break;
+        }
+    }
+
+    stage->last = *point;
+    stage->n++;
+
+    switch (aggr->gid)
+    {
+    case CLERI_GID_F_SUM:
+        if (stage->tp == TP_INT)
+        {
+            int64_t tmp = point->val.int64;
+            if ((tmp > 0 && stage->acc.int64 > LLONG_MAX - tmp) ||
+                    (tmp < 0 && stage->acc.int64 < LLONG_MIN - tmp))
+            {
+                sprintf(err_msg, "Overflow detected while using sum().");
+                return -1;
+            }
+            stage->acc.int64 += tmp;
+        }
+        else
+        {
+            stage->acc.real += point->val.real;
+        }
+        break;
+
+    case CLERI_GID_F_MEAN:
+        if (stage->tp == TP_INT)
+        {
+            stage->acc.real += point->val.int64;
+        }
+        else
+        {
+            stage->acc.real += point->val.real;
+        }
+        break;
+
+    case CLERI_GID_F_MIN:
+        if (stage->tp == TP_INT)
+        {
+            if (point->val.int64 < stage->acc.int64)
+            {
+                stage->acc.int64 = point->val.int64;
+            }
+        }
+        else if (point->val.real < stage->acc.real)
+        {
+            stage->acc.real = point->val.real;
+        }
+        break;
+
+    case CLERI_GID_F_MAX:
+        if (stage->tp == TP_INT)
+        {
+            if (point->val.int64 > stage->acc.int64)
+            {
+                stage->acc.int64 = point->val.int64;
+            }
+        }
+        else if (point->val.real > stage->acc.real)
+        {
+            stage->acc.real = point->val.real;
+        }
+        break;
+
+    case CLERI_GID_F_APPROX_MEDIAN:
+    case CLERI_GID_F_MEDIAN:
+    case CLERI_GID_F_MEDIAN_HIGH:
+    case CLERI_GID_F_MEDIAN_LOW:
+    case CLERI_GID_F_PERCENTILE:
+    case CLERI_GID_F_PVARIANCE:
+    case CLERI_GID_F_VARIANCE:
+        /* these functions need all points in the group */
+        if (    (stage->points == NULL ||
+                stage->points->len == stage->sz) &&
+                AGGREGATE_stage_grow(stage))
+        {
+            sprintf(err_msg, "Memory allocation error.");
+            return -1;
+        }
+        stage->points->data[stage->points->len++] = *point;
+        break;
+    }
+
+    return 0;
+}
+
+/*
+ * Send the point for the current group to the next stage and reset the
+ * group.
+ */
+static int AGGREGATE_emit_group(aggr_stage_t * stage, char * err_msg)
+{
+    siridb_aggr_t * aggr = stage->aggr;
+    siridb_point_t point;
+    siridb_point_t pair[2];
+    siridb_points_t group;
+
+    point.ts = stage->group_ts;
+
+    switch (aggr->gid)
+    {
+    case CLERI_GID_F_COUNT:
+        point.val.int64 = stage->n;
+        break;
+
+    case CLERI_GID_F_SUM:
+    case CLERI_GID_F_MIN:
+    case CLERI_GID_F_MAX:
+        point.val = stage->acc;
+        break;
+
+    case CLERI_GID_F_MEAN:
+        point.val.real = stage->acc.real / stage->n;
+        break;
+
+    case CLERI_GID_F_DERIVATIVE:
+    case CLERI_GID_F_DIFFERENCE:
+        /* these functions only use the first and last point */
+        pair[0] = stage->first;
+        pair[1] = stage->last;
+        group.tp = stage->tp;
+        group.len = (stage->n == 1) ? 1 : 2;
+        group.data = pair;
+        if (AGGREGATES[aggr->gid - F_OFFSET](&point, &group, aggr, err_msg))
+        {
+            return -1;
+        }
+        break;
+
+    default:
+        if (AGGREGATES[aggr->gid - F_OFFSET](
+                &point,
+                stage->points,
+                aggr,
+                err_msg))
+        {
+            return -1;
+        }
+        stage->points->len = 0;
+        break;
+    }
+
+    stage->n = 0;
+
+    return (*stage->next->push_cb)(stage->next, &point, err_msg);
+}
+
+/*
+ * Send a chunk of points to a stage. Groups, filters and the collecting
+ * stage handle the chunk at once using the vector kernels, other stages
+ * receive the points one by one.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ */
+static int AGGREGATE_push_chunk(
+        aggr_stage_t * stage,
+        siridb_point_t * pts,
+        size_t n,
+        char * err_msg)
+{
+    if (stage->push_cb == AGGREGATE_push_group)
+    {
+        return AGGREGATE_chunk_group(stage, pts, n, err_msg);
+    }
+
+    if (stage->push_cb == AGGREGATE_push_filter)
+    {
+        return AGGREGATE_chunk_filter(stage, pts, n, err_msg);
+    }
+
+    if (stage->push_cb == AGGREGATE_push_collect)
+    {
+        while (stage->points->len + n > stage->sz)
+        {
+            if (AGGREGATE_stage_grow(stage))
+            {
+                sprintf(err_msg, "Memory allocation error.");
+                return -1;
+            }
+        }
+        memcpy( stage->points->data + stage->points->len,
+                pts,
+                n * sizeof(siridb_point_t));
+        stage->points->len += n;
+        return 0;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if ((*stage->push_cb)(stage, pts + i, err_msg))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Filter a chunk of points and send the matching points to the next stage.
+ */
+static int AGGREGATE_chunk_filter(
+        aggr_stage_t * stage,
+        siridb_point_t * pts,
+        size_t n,
+        char * err_msg)
+{
+    siridb_point_t buf[AGGR_FILTER_SZ];
+    size_t m, k;
+
+    for (; n; n -= m, pts += m)
+    {
+        m = (n < AGGR_FILTER_SZ) ? n : AGGR_FILTER_SZ;
+
+        k = (stage->tp == TP_INT) ?
+                (*siridb_simd->filter_int)(
+                        pts,
+                        m,
+                        stage->aggr->filter_opr,
+                        stage->filter.int64,
+                        buf) :
+                (*siridb_simd->filter_real)(
+                        pts,
+                        m,
+                        stage->aggr->filter_opr,
+                        stage->filter.real,
+                        buf);
+
+        if (k && AGGREGATE_push_chunk(stage->next, buf, k, err_msg))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Add a chunk of points to groups. The first point of a group is added by
+ * AGGREGATE_push_group() and the other points of the group in the chunk are
+ * found with bucket_end and added at once.
+ */
+static int AGGREGATE_chunk_group(
+        aggr_stage_t * stage,
+        siridb_point_t * pts,
+        size_t n,
+        char * err_msg)
+{
+    size_t i, m;
+
+    for (i = 0; i < n; i += m)
+    {
+        if (AGGREGATE_push_group(stage, pts + i, err_msg))
+        {
+            return -1;
+        }
+
+        i++;
+
+        m = (*siridb_simd->bucket_end)(pts + i, n - i, stage->group_ts);
+
+        if (m && AGGREGATE_group_range(stage, pts + i, m, err_msg))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Add points to the current group which has at least one point. All points
+ * must be part of this group.
+ *
+ * Doubles are added one by one for less than SIRIDB_SIMD_REAL_MIN points so
+ * small groups give exactly the same result as before. An integer sum which
+ * overflows is added one by one as well, to raise the same error.
+ */
+static int AGGREGATE_group_range(
+        aggr_stage_t * stage,
+        siridb_point_t * pts,
+        size_t n,
+        char * err_msg)
+{
+    const siridb_simd_t * simd = siridb_simd;
+    siridb_points_t * points;
+    int one_by_one = 0;
+    int64_t isum, ival;
+    double rval;
+
+    switch (stage->aggr->gid)
+    {
+    case CLERI_GID_F_SUM:
+        if (stage->tp == TP_INT)
+        {
+            one_by_one =
+                    (*simd->sum_int)(pts, n, &isum) ||
+                    (isum > 0 && stage->acc.int64 > LLONG_MAX - isum) ||
+                    (isum < 0 && stage->acc.int64 < LLONG_MIN - isum);
+            if (!one_by_one)
+            {
+                stage->acc.int64 += isum;
+            }
+            break;
+        }
+        one_by_one = n < SIRIDB_SIMD_REAL_MIN;
+        if (!one_by_one)
+        {
+            stage->acc.real += (*simd->sum_real)(pts, n);
+        }
+        break;
+
+    case CLERI_GID_F_MEAN:
+        one_by_one = n < SIRIDB_SIMD_REAL_MIN || (
+                stage->tp == TP_INT &&
+                (*simd->sum_int)(pts, n, &isum));
+        if (!one_by_one)
+        {
+            stage->acc.real += (stage->tp == TP_INT) ?
+                    (double) isum : (*simd->sum_real)(pts, n);
+        }
+        break;
+
+    case CLERI_GID_F_MIN:
+        if (stage->tp == TP_INT)
+        {
+            ival = (*simd->min_int)(pts, n);
+            if (ival < stage->acc.int64)
+            {
+                stage->acc.int64 = ival;
+            }
+            break;
+        }
+        /* a NaN result is only possible when the first point is NaN */
+        rval = (*simd->min_real)(pts, n);
+        one_by_one = isnan(rval);
+        if (rval < stage->acc.real)
+        {
+            stage->acc.real = rval;
+        }
+        break;
+
+    case CLERI_GID_F_MAX:
+        if (stage->tp == TP_INT)
+        {
+            ival = (*simd->max_int)(pts, n);
+            if (ival > stage->acc.int64)
+            {
+                stage->acc.int64 = ival;
+            }
+            break;
+        }
+        rval = (*simd->max_real)(pts, n);
+        one_by_one = isnan(rval);
+        if (rval > stage->acc.real)
+        {
+            stage->acc.real = rval;
+        }
+        break;
+
+    case CLERI_GID_F_APPROX_MEDIAN:
+    case CLERI_GID_F_MEDIAN:
+    case CLERI_GID_F_MEDIAN_HIGH:
+    case CLERI_GID_F_MEDIAN_LOW:
+    case CLERI_GID_F_PERCENTILE:
+    case CLERI_GID_F_PVARIANCE:
+    case CLERI_GID_F_VARIANCE:
+        /* the first point of the group has created the points */
+        points = stage->points;
+        while (points->len + n > stage->sz)
+        {
+            if (AGGREGATE_stage_grow(stage))
+            {
+                sprintf(err_msg, "Memory allocation error.");
+                return -1;
+            }
+        }
+        memcpy(points->data + points->len, pts, n * sizeof(siridb_point_t));
+        points->len += n;
+        break;
+    }
+
+    if (one_by_one)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            if (AGGREGATE_push_group(stage, pts + i, err_msg))
+            {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    stage->last = pts[n - 1];
+    stage->n += n;
+
+    return 0;
+}
+
+/*
+ * Returns the next chunk from a points array, see siridb_aggr_next_cb.
+ */
+static int AGGREGATE_chunks_next(
+        aggr_chunks_t * chunks,
+        siridb_points_t * chunk,
+        char * err_msg)
+{
+    size_t n = chunks->points->len - chunks->pos;
+
+    if (!n)
+    {
+        return 0;
+    }
+
+    if (n > AGGR_CHUNK_SZ)
+    {
+        n = AGGR_CHUNK_SZ;
+    }
+
+    chunk->len = n;
+    chunk->tp = chunks->points->tp;
+    chunk->content = chunks->points->content;
+    chunk->data = chunks->points->data + chunks->pos;
+
+    chunks->pos += n;
+
+    return 1;
+}
+
+static int aggr_count(
+        siridb_point_t * point,
+        siridb_points_t * points,
+        siridb_aggr_t * aggr,
+        char * err_msg)
+{
+    point->val.int64 = points->len;
+    return 0;
+}
+
+static int aggr_derivative(
+        siridb_point_t * point,
+        siridb_points_t * points,
+        siridb_aggr_t * aggr,
+        char * err_msg)
+{
+#ifdef DEBUG
+    assert (points->len);
+#endif
+
+    if (points->tp == TP_STRING)
+    {
+        sprintf(err_msg, "Cannot use difference() on string type.");
+        return -1;
+    }
+
+    if (points->len == 1)
+    {
+        point->val.real = 0.0;
+    }
+    else
+    {
+        double first, last;
+
+        switch (points->tp)
+        {
+        case TP_INT:
+            first = (double) points->data->val.int64;
+            last = (double) (points->data + points->len - 1)->val.int64;
+            break;
+        case TP_DOUBLE:
+            first = points->data->val.real;
+            last = (points->data + points->len - 1)->val.real;
+            break;
+        default:
+            assert (0);
+            break;
+        }
+
+        /* time-span is actually a factor when used with group_by */
+        point->val.real = (last- first) * aggr->timespan;
+    }
+
+    return 0;
+}
+
+static int aggr_difference(
+        siridb_point_t * point,
+        siridb_points_t * points,
+        siridb_aggr_t * aggr,
+        char * err_msg)
+{
+#ifdef DEBUG
+    assert (points->len);
+#endif
+
+    switch (points->tp)
     {
     case TP_STRING:
         sprintf(err_msg, "Cannot use difference() on string type.");
@@ -1090,27 +2207,13 @@ static int aggr_max(
 
     if (points->tp == TP_INT)
     {
-        int64_t max = points->data->val.int64;
-        for (size_t i = 1; i < points->len; i++)
-        {
-            if ((points->data + i)->val.int64 > max)
-            {
-                max = (points->data + i)->val.int64;
-            }
-        }
-        point->val.int64 = max;
+        point->val.int64 =
+                (*siridb_simd->max_int)(points->data, points->len);
     }
     else
     {
-        double max = points->data->val.real;
-        for (size_t i = 1; i < points->len; i++)
-        {
-            if ((points->data + i)->val.real > max)
-            {
-                max = (points->data + i)->val.real;
-            }
-        }
-        point->val.real = max;
+        point->val.real =
+                (*siridb_simd->max_real)(points->data, points->len);
     }
 
     return 0;
@@ -1126,8 +2229,6 @@ static int aggr_mean(
     assert (points->len);
 #endif
 
-    double sum = 0.0;
-
     switch (points->tp)
     {
     case TP_STRING:
@@ -1135,17 +2236,8 @@ static int aggr_mean(
         return -1;
 
     case TP_INT:
-        for (size_t i = 0; i < points->len; i++)
-        {
-            sum += (points->data + i)->val.int64;
-        }
-        break;
-
     case TP_DOUBLE:
-        for (size_t i = 0; i < points->len; i++)
-        {
-            sum += (points->data + i)->val.real;
-        }
+        point->val.real = siridb_simd_mean(points);
         break;
 
     default:
@@ -1153,8 +2245,6 @@ static int aggr_mean(
         break;
     }
 
-    point->val.real = sum / points->len;
-
     return 0;
 }
 
@@ -1290,29 +2380,59 @@ static int aggr_min(
 
     if (points->tp == TP_INT)
     {
-        int64_t min = points->data->val.int64;
-        for (size_t i = 1; i < points->len; i++)
-        {
-            if ((points->data + i)->val.int64 < min)
-            {
-                min = (points->data + i)->val.int64;
-            }
-        }
-        point->val.int64 = min;
+        point->val.int64 =
+                (*siridb_simd->min_int)(points->data, points->len);
     }
     else
     {
-        double min = points->data->val.real;
-        for (size_t i = 1; i < points->len; i++)
-        {
-            if ((points->data + i)->val.real < min)
-            {
-                min = (points->data + i)->val.real;
-            }
-        }
-        point->val.real = min;
+        point->val.real =
+                (*siridb_simd->min_real)(points->data, points->len);
+    }
+
+    return 0;
+}
+
+/*
+ * Used for both percentile and approx_median. The value is read from a
+ * sketch so the result is the same as when the group would be merged from
+ * sketches of multiple pools.
+ */
+static int aggr_percentile(
+        siridb_point_t * point,
+        siridb_points_t * points,
+        siridb_aggr_t * aggr,
+        char * err_msg)
+{
+#ifdef DEBUG
+    assert (points->len);
+#endif
+    siridb_sketch_t sketch;
+
+    if (points->tp == TP_STRING)
+    {
+        sprintf(err_msg, "Cannot use %s() on string type.",
+                (aggr->gid == CLERI_GID_F_PERCENTILE) ?
+                        "percentile" : "approx_median");
+        return -1;
     }
 
+    siridb_sketch_init(&sketch);
+
+    if (siridb_sketch_add_points(
+            &sketch,
+            points->data,
+            points->len,
+            points->tp))
+    {
+        sprintf(err_msg, "Memory allocation error in percentile.");
+        siridb_sketch_destroy(&sketch);
+        return -1;
+    }
+
+    point->val.real = siridb_sketch_quantile(&sketch, aggr->quantile);
+
+    siridb_sketch_destroy(&sketch);
+
     return 0;
 }
 
@@ -1362,33 +2482,19 @@ static int aggr_sum(
         return -1;
 
     case TP_INT:
+        if ((*siridb_simd->sum_int)(
+                points->data,
+                points->len,
+                &point->val.int64))
         {
-            int64_t sum = 0;
-            int64_t tmp;
-            for (size_t i = 0; i < points->len; i++)
-            {
-                tmp = (points->data + i)->val.int64;
-                if ((tmp > 0 && sum > LLONG_MAX - tmp) ||
-                        (tmp < 0 && sum < LLONG_MIN - tmp))
-                {
-                    sprintf(err_msg, "Overflow detected while using sum().");
-                    return -1;
-                }
-                sum += tmp;
-            }
-            point->val.int64 = sum;
+            sprintf(err_msg, "Overflow detected while using sum().");
+            return -1;
         }
         break;
 
     case TP_DOUBLE:
-        {
-            double sum = 0.0;
-            for (size_t i = 0; i < points->len; i++)
-            {
-                sum += (points->data + i)->val.real;
-            }
-            point->val.real = sum;
-        }
+        point->val.real =
+                (*siridb_simd->sum_real)(points->data, points->len);
         break;
 
     default:
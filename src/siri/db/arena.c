@@ -0,0 +1,382 @@
+/*
+ * arena.c - Memory which is released at once when a query is finished.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * Small chunks are taken from large blocks and are only released when the
+ * arena is destroyed, except for the last chunk in the current block which
+ * can be released or grown in place. Large chunks are allocated alone and
+ * released when freed so reading a large series does not increase the
+ * memory used by a query until the query is finished.
+ *
+ * Each chunk starts with a header containing the arena so a chunk can be
+ * freed or re-allocated without knowing the arena. The arena can be used by
+ * more than one thread at the same time.
+ */
+#include <logger/logger.h>
+#include <siri/db/arena.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN(sz) (((sz) + 15) & ~((size_t) 15))
+#define ARENA_FLAG_LARGE ((size_t) 1)
+
+struct siridb_arena_block_s
+{
+    siridb_arena_block_t * prev;
+    size_t pos;         /* start of free space in data */
+    size_t last;        /* position of the last chunk in data */
+    size_t size;        /* size of data */
+    char data[];
+};
+
+typedef struct arena_chunk_s
+{
+    siridb_arena_t * arena;
+    size_t size;        /* aligned size, the lowest bit marks a large chunk */
+} arena_chunk_t;
+
+#define ARENA_CHUNK(ptr) (((arena_chunk_t *) (ptr)) - 1)
+#define ARENA_LARGE(chunk) (((siridb_arena_large_t *) (chunk)) - 1)
+#define ARENA_LARGE_TOTAL(sz) \
+    (sizeof(siridb_arena_large_t) + sizeof(arena_chunk_t) + (sz))
+
+static void * ARENA_alloc_large(siridb_arena_t * arena, size_t size);
+static inline void ARENA_grow(siridb_arena_t * arena, size_t size);
+static void ARENA_init(void);
+
+static uv_once_t ARENA_once = UV_ONCE_INIT;
+static uv_key_t ARENA_key;
+static int ARENA_use_key = 0;
+
+/*
+ * Initialize an arena. No memory is allocated until the first chunk is
+ * requested.
+ *
+ * Returns 0 if successful or -1 when the mutex cannot be initialized.
+ */
+int siridb_arena_init(siridb_arena_t * arena)
+{
+    arena->block = NULL;
+    arena->large.prev = &arena->large;
+    arena->large.next = &arena->large;
+    arena->size = 0;
+    arena->peak = 0;
+
+    return uv_mutex_init(&arena->mutex);
+}
+
+/*
+ * Release all memory of an arena. Chunks of the arena may not be used after
+ * calling this function.
+ */
+void siridb_arena_destroy(siridb_arena_t * arena)
+{
+    siridb_arena_block_t * block;
+    siridb_arena_large_t * large;
+
+    while ((block = arena->block) != NULL)
+    {
+        arena->block = block->prev;
+        free(block);
+    }
+
+    while ((large = arena->large.next) != &arena->large)
+    {
+        arena->large.next = large->next;
+        free(large);
+    }
+
+    uv_mutex_destroy(&arena->mutex);
+}
+
+/*
+ * Like malloc() but the chunk is taken from an arena. The chunk is aligned
+ * to 16 bytes.
+ *
+ * Returns the chunk or NULL in case of an allocation error.
+ * (no signal is raised)
+ */
+void * siridb_arena_malloc(siridb_arena_t * arena, size_t size)
+{
+    siridb_arena_block_t * block;
+    arena_chunk_t * chunk;
+
+    size = ARENA_ALIGN(size ? size : 1);
+
+    if (size >= SIRIDB_ARENA_LARGE_SZ)
+    {
+        return ARENA_alloc_large(arena, size);
+    }
+
+    uv_mutex_lock(&arena->mutex);
+
+    block = arena->block;
+
+    if (block == NULL ||
+        block->pos + sizeof(arena_chunk_t) + size > block->size)
+    {
+        block = (siridb_arena_block_t *) malloc(
+                sizeof(siridb_arena_block_t) + SIRIDB_ARENA_BLOCK_SZ);
+        if (block == NULL)
+        {
+            uv_mutex_unlock(&arena->mutex);
+            return NULL;
+        }
+        block->prev = arena->block;
+        block->pos = 0;
+        block->last = 0;
+        block->size = SIRIDB_ARENA_BLOCK_SZ;
+        arena->block = block;
+        ARENA_grow(arena, sizeof(siridb_arena_block_t) + SIRIDB_ARENA_BLOCK_SZ);
+    }
+
+    chunk = (arena_chunk_t *) (block->data + block->pos);
+    chunk->arena = arena;
+    chunk->size = size;
+
+    block->last = block->pos;
+    block->pos += sizeof(arena_chunk_t) + size;
+
+    uv_mutex_unlock(&arena->mutex);
+
+    return chunk + 1;
+}
+
+/*
+ * Like realloc() but for a chunk of an arena. A small chunk is never made
+ * smaller. (ptr may not be NULL)
+ *
+ * Returns the new chunk or NULL in case of an allocation error, in which
+ * case ptr is not changed. (no signal is raised)
+ */
+void * siridb_arena_realloc(void * ptr, size_t size)
+{
+    arena_chunk_t * chunk = ARENA_CHUNK(ptr);
+    siridb_arena_t * arena = chunk->arena;
+    size_t old = chunk->size & ~ARENA_FLAG_LARGE;
+    siridb_arena_block_t * block;
+    void * tmp;
+
+    size = ARENA_ALIGN(size ? size : 1);
+
+    if (chunk->size & ARENA_FLAG_LARGE)
+    {
+        siridb_arena_large_t * large = ARENA_LARGE(chunk);
+
+        uv_mutex_lock(&arena->mutex);
+
+        tmp = realloc(large, ARENA_LARGE_TOTAL(size));
+        if (tmp == NULL)
+        {
+            uv_mutex_unlock(&arena->mutex);
+            return NULL;
+        }
+
+        /* the chunk might be moved so the list must be updated */
+        large = (siridb_arena_large_t *) tmp;
+        large->prev->next = large;
+        large->next->prev = large;
+
+        chunk = (arena_chunk_t *) (large + 1);
+        chunk->size = size | ARENA_FLAG_LARGE;
+
+        arena->size -= ARENA_LARGE_TOTAL(old);
+        ARENA_grow(arena, ARENA_LARGE_TOTAL(size));
+
+        uv_mutex_unlock(&arena->mutex);
+
+        return chunk + 1;
+    }
+
+    if (size <= old)
+    {
+        return ptr;
+    }
+
+    uv_mutex_lock(&arena->mutex);
+
+    block = arena->block;
+
+    if (size < SIRIDB_ARENA_LARGE_SZ &&
+        (char *) chunk == block->data + block->last &&
+        block->last + sizeof(arena_chunk_t) + size <= block->size)
+    {
+        /* this is the last chunk, grow in place */
+        block->pos = block->last + sizeof(arena_chunk_t) + size;
+        chunk->size = size;
+
+        uv_mutex_unlock(&arena->mutex);
+
+        return ptr;
+    }
+
+    uv_mutex_unlock(&arena->mutex);
+
+    tmp = siridb_arena_malloc(arena, size);
+    if (tmp != NULL)
+    {
+        memcpy(tmp, ptr, old);
+        siridb_arena_free(ptr);
+    }
+
+    return tmp;
+}
+
+/*
+ * Free a chunk. A large chunk is released directly and a small chunk only
+ * when it is the last chunk in the current block. Other small chunks are
+ * released when the arena is destroyed. (ptr may be NULL)
+ */
+void siridb_arena_free(void * ptr)
+{
+    arena_chunk_t * chunk;
+    siridb_arena_t * arena;
+    siridb_arena_block_t * block;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    chunk = ARENA_CHUNK(ptr);
+    arena = chunk->arena;
+
+    uv_mutex_lock(&arena->mutex);
+
+    if (chunk->size & ARENA_FLAG_LARGE)
+    {
+        siridb_arena_large_t * large = ARENA_LARGE(chunk);
+
+        large->prev->next = large->next;
+        large->next->prev = large->prev;
+        arena->size -= ARENA_LARGE_TOTAL(chunk->size & ~ARENA_FLAG_LARGE);
+
+        uv_mutex_unlock(&arena->mutex);
+
+        free(large);
+        return;
+    }
+
+    block = arena->block;
+
+    if ((char *) chunk == block->data + block->last &&
+        block->pos == block->last + sizeof(arena_chunk_t) + chunk->size)
+    {
+        block->pos = block->last;
+    }
+
+    uv_mutex_unlock(&arena->mutex);
+}
+
+/*
+ * Returns the highest number of bytes which was allocated by the arena at
+ * the same time.
+ */
+size_t siridb_arena_peak(siridb_arena_t * arena)
+{
+    size_t peak;
+
+    uv_mutex_lock(&arena->mutex);
+    peak = arena->peak;
+    uv_mutex_unlock(&arena->mutex);
+
+    return peak;
+}
+
+/*
+ * Use the arena for allocations made by the calling thread, for example by
+ * siridb_points_new(), until siridb_arena_leave() is called.
+ */
+void siridb_arena_enter(siridb_arena_t * arena)
+{
+    uv_once(&ARENA_once, ARENA_init);
+
+    if (ARENA_use_key)
+    {
+        uv_key_set(&ARENA_key, arena);
+    }
+}
+
+void siridb_arena_leave(void)
+{
+    if (ARENA_use_key)
+    {
+        uv_key_set(&ARENA_key, NULL);
+    }
+}
+
+/*
+ * Returns the arena of the calling thread or NULL when the thread does not
+ * use an arena.
+ */
+siridb_arena_t * siridb_arena_current(void)
+{
+    return (ARENA_use_key) ?
+            (siridb_arena_t *) uv_key_get(&ARENA_key) : NULL;
+}
+
+/*
+ * Returns a large chunk or NULL in case of an allocation error. (size must
+ * be aligned)
+ */
+static void * ARENA_alloc_large(siridb_arena_t * arena, size_t size)
+{
+    siridb_arena_large_t * large;
+    arena_chunk_t * chunk;
+
+    large = (siridb_arena_large_t *) malloc(ARENA_LARGE_TOTAL(size));
+    if (large == NULL)
+    {
+        return NULL;
+    }
+
+    chunk = (arena_chunk_t *) (large + 1);
+    chunk->arena = arena;
+    chunk->size = size | ARENA_FLAG_LARGE;
+
+    uv_mutex_lock(&arena->mutex);
+
+    large->prev = &arena->large;
+    large->next = arena->large.next;
+    large->next->prev = large;
+    arena->large.next = large;
+
+    ARENA_grow(arena, ARENA_LARGE_TOTAL(size));
+
+    uv_mutex_unlock(&arena->mutex);
+
+    return chunk + 1;
+}
+
+/*
+ * Add size bytes to the arena and update the peak. (the arena mutex must be
+ * locked)
+ */
+static inline void ARENA_grow(siridb_arena_t * arena, size_t size)
+{
+    arena->size += size;
+    if (arena->size > arena->peak)
+    {
+        arena->peak = arena->size;
+    }
+}
+
+/*
+ * Called once, by the first thread entering an arena.
+ */
+static void ARENA_init(void)
+{
+    if (uv_key_create(&ARENA_key))
+    {
+        log_error("Cannot create arena key, queries will not use an arena");
+        return;
+    }
+    ARENA_use_key = 1;
+}
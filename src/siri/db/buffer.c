@@ -7,8 +7,17 @@
  *
  * changes
  *  - initial version, 01-04-2016
+ *  - buffer file access is protected by siridb->buffer_mutex, 18-10-2026
+ *  - write a complete buffer for a write-ahead log checkpoint, 18-10-2026
  *
+ * Each series has a fixed space in the buffer file:
+ *
+ *  [series id (uint32)][length (size_t)][points][checkpoint (uint32)]
+ *
+ * The checkpoint is only written by siridb_buffer_write_series() and is
+ * stored in the last four bytes which are not used by points.
  */
+#include <assert.h>
 #include <logger/logger.h>
 #include <siri/db/buffer.h>
 #include <siri/db/db.h>
@@ -26,6 +35,8 @@
 
 static int BUFFER_create_new(siridb_t * siridb, siridb_series_t * series);
 static int BUFFER_use_empty(siridb_t * siridb, siridb_series_t * series);
+static int BUFFER_write_len(siridb_t * siridb, siridb_series_t * series);
+static int BUFFER_open(siridb_t * siridb);
 
 
 /*
@@ -35,17 +46,16 @@ int siridb_buffer_write_len(
         siridb_t * siridb,
         siridb_series_t * series)
 {
-    return (
-        /* go to the series position in buffer */
-        fseeko(  siridb->buffer_fp,
-                series->bf_offset + sizeof(uint32_t),
-                SEEK_SET) ||
+    int rc;
 
-        /* write new length */
-        fwrite( &series->buffer->len,
-                sizeof(size_t),
-                1,
-                siridb->buffer_fp) != 1) ? EOF : 0;
+    uv_mutex_lock(&siridb->buffer_mutex);
+
+    rc = (  BUFFER_open(siridb) ||
+            BUFFER_write_len(siridb, series)) ? EOF : 0;
+
+    uv_mutex_unlock(&siridb->buffer_mutex);
+
+    return rc;
 }
 
 /*
@@ -60,8 +70,14 @@ int siridb_buffer_write_point(
         uint64_t * ts,
         qp_via_t * val)
 {
-    return (
-        siridb_buffer_write_len(siridb, series) ||
+    int rc;
+
+    uv_mutex_lock(&siridb->buffer_mutex);
+
+    rc = (
+        BUFFER_open(siridb) ||
+
+        BUFFER_write_len(siridb, series) ||
 
         /* jump to position where to write the new point */
         fseeko(  siridb->buffer_fp,
@@ -73,6 +89,100 @@ int siridb_buffer_write_point(
 
         /* write value */
         fwrite(val, sizeof(qp_via_t), 1, siridb->buffer_fp) != 1) ? EOF : 0;
+
+    uv_mutex_unlock(&siridb->buffer_mutex);
+
+    return rc;
+}
+
+/*
+ * Write all points in the buffer of a series and the checkpoint which has
+ * written the buffer. The buffer must have less than buffer_len points.
+ *
+ * Returns 0 if success or EOF in case of an error.
+ */
+int siridb_buffer_write_series(
+        siridb_t * siridb,
+        siridb_series_t * series,
+        uint32_t checkpoint)
+{
+    int rc;
+
+#ifdef DEBUG
+    assert (series->buffer->len < siridb->buffer_len);
+#endif
+
+    uv_mutex_lock(&siridb->buffer_mutex);
+
+    rc = (
+        BUFFER_open(siridb) ||
+
+        BUFFER_write_len(siridb, series) ||
+
+        /* points are written directly after the length */
+        (series->buffer->len && fwrite(
+                series->buffer->data,
+                sizeof(siridb_point_t),
+                series->buffer->len,
+                siridb->buffer_fp) != series->buffer->len) ||
+
+        fseeko( siridb->buffer_fp,
+                series->bf_offset + siridb->buffer_size - sizeof(uint32_t),
+                SEEK_SET) ||
+
+        fwrite(&checkpoint, sizeof(uint32_t), 1, siridb->buffer_fp) != 1) ?
+                EOF : 0;
+
+    uv_mutex_unlock(&siridb->buffer_mutex);
+
+    return rc;
+}
+
+/*
+ * Returns the checkpoint which has written the buffer of a series or 0 when
+ * the checkpoint cannot be read.
+ */
+uint32_t siridb_buffer_read_checkpoint(
+        siridb_t * siridb,
+        siridb_series_t * series)
+{
+    uint32_t checkpoint;
+
+    uv_mutex_lock(&siridb->buffer_mutex);
+
+    if (    BUFFER_open(siridb) ||
+            fseeko( siridb->buffer_fp,
+                    series->bf_offset +
+                        siridb->buffer_size - sizeof(uint32_t),
+                    SEEK_SET) ||
+            fread(&checkpoint, sizeof(uint32_t), 1, siridb->buffer_fp) != 1)
+    {
+        checkpoint = 0;
+    }
+
+    uv_mutex_unlock(&siridb->buffer_mutex);
+
+    return checkpoint;
+}
+
+/*
+ * Flush the buffer file and commit changes to disk.
+ *
+ * Returns 0 if success or EOF in case of an error.
+ */
+int siridb_buffer_sync(siridb_t * siridb)
+{
+    int rc;
+
+    uv_mutex_lock(&siridb->buffer_mutex);
+
+    rc = (  BUFFER_open(siridb) ||
+            fflush(siridb->buffer_fp) ||
+            fsync(fileno(siridb->buffer_fp))) ? EOF : 0;
+
+    uv_mutex_unlock(&siridb->buffer_mutex);
+
+    return rc;
 }
 
 /*
@@ -87,9 +197,36 @@ int siridb_buffer_new_series(siridb_t * siridb, siridb_series_t * series)
         return -1;  /* signal is raised */
     }
 
-    return (siridb->empty_buffers->len) ?
-            BUFFER_use_empty(siridb, series) :
-            BUFFER_create_new(siridb, series);
+    int rc;
+
+    uv_mutex_lock(&siridb->buffer_mutex);
+
+    if (BUFFER_open(siridb))
+    {
+        ERR_FILE
+        rc = -1;
+    }
+    else
+    {
+        rc = (siridb->empty_buffers->len) ?
+                BUFFER_use_empty(siridb, series) :
+                BUFFER_create_new(siridb, series);
+
+        /*
+         * The series is flushed to the store so the buffer must be flushed
+         * too, otherwise the series is dropped at start-up when the buffer
+         * is not found. (points might only be written at a checkpoint)
+         */
+        if (!rc && fflush(siridb->buffer_fp))
+        {
+            ERR_FILE
+            rc = -1;
+        }
+    }
+
+    uv_mutex_unlock(&siridb->buffer_mutex);
+
+    return rc;
 }
 
 /*
@@ -163,7 +300,7 @@ int siridb_buffer_load(siridb_t * siridb)
             pt = buffer + i * siridb->buffer_size;
 
             series = (siridb_series_t *)
-                    imap_get(siridb->series_map, *((uint32_t *) pt));
+                    idmap_get(siridb->series_map, *((uint32_t *) pt));
 
             if (series == NULL)
             {
@@ -185,7 +322,7 @@ int siridb_buffer_load(siridb_t * siridb)
 
             pt += sizeof(uint32_t);
 
-            for (   j = (size_t) *pt, pt += sizeof(size_t);
+            for (   j = *((size_t *) pt), pt += sizeof(size_t);
                     j--;
                     pt += 16)
             {
@@ -330,3 +467,34 @@ static int BUFFER_create_new(siridb_t * siridb, siridb_series_t * series)
 
     return 0;
 }
+
+/*
+ * Write the buffer length for a series. (buffer_mutex must be locked)
+ *
+ * Returns 0 if success or EOF in case of an error.
+ */
+static int BUFFER_write_len(siridb_t * siridb, siridb_series_t * series)
+{
+    return (
+        /* go to the series position in buffer */
+        fseeko(  siridb->buffer_fp,
+                series->bf_offset + sizeof(uint32_t),
+                SEEK_SET) ||
+
+        /* write new length */
+        fwrite( &series->buffer->len,
+                sizeof(size_t),
+                1,
+                siridb->buffer_fp) != 1) ? EOF : 0;
+}
+
+/*
+ * Open the buffer file in case the file is closed, for example by the
+ * backup task. (buffer_mutex must be locked)
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ */
+static int BUFFER_open(siridb_t * siridb)
+{
+    return (siridb->buffer_fp == NULL) ? siridb_buffer_open(siridb) : 0;
+}
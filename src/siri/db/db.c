@@ -7,6 +7,10 @@
  *
  * changes
  *  - initial version, 10-03-2016
+ *  - optional lookup versions in database.dat, 18-10-2026
+ *  - load and replay the write-ahead log, 18-10-2026
+ *  - close the insert pipelines before the servers are destroyed,
+ *    18-10-2026
  *
  */
 #define _GNU_SOURCE
@@ -18,12 +22,14 @@
 #include <math.h>
 #include <procinfo/procinfo.h>
 #include <siri/db/db.h>
+#include <siri/db/lookup.h>
 #include <siri/db/series.h>
 #include <siri/db/servers.h>
 #include <siri/db/shard.h>
 #include <siri/db/shards.h>
 #include <siri/db/time.h>
 #include <siri/db/users.h>
+#include <siri/db/wal.h>
 #include <siri/err.h>
 #include <siri/siri.h>
 #include <stdio.h>
@@ -35,13 +41,25 @@
 #define SIRIDB_SHEMA 1
 
 /*
- * database.dat
+ * database.dat (a qpack array)
  *
  * SCHEMA       -> SIRIDB_SHEMA
  * UUID         -> UUID for 'this' server
  * DBNAME       -> Database name
+ * PRECISION    -> Time precision
+ * BUFFER_SIZE  -> Buffer size
+ * DURATION_NUM -> Number duration
+ * DURATION_LOG -> Log duration
+ * TIMEZONE     -> Time zone name
+ * THRESHOLD    -> Drop threshold
+ * LOOKUP       -> Lookup version (optional, SIRIDB_LOOKUP_DEFAULT if missing)
+ * PREV_LOOKUP  -> Previous lookup version, differs from LOOKUP while the
+ *                 series are migrated to the new lookup. (required when
+ *                 LOOKUP is set)
  *
- *
+ * A tool creating a new database can start the database on another lookup
+ * version by writing LOOKUP and PREV_LOOKUP, both set to the version. The
+ * version must be equal on all servers in the database.
  */
 
 static siridb_t * SIRIDB_new(void);
@@ -270,6 +288,16 @@ siridb_t * siridb_new(const char * dbpath, int lock_flags)
         return NULL;
     }
 
+    /* load write-ahead log, this replays points after the last checkpoint */
+    if (siridb_wal_load(siridb))
+    {
+        log_error(
+                "Could not load write-ahead log for database '%s'",
+                siridb->dbname);
+        siridb_decref(siridb);
+        return NULL;
+    }
+
     /* load groups */
     if ((siridb->groups = siridb_groups_new(siridb)) == NULL)
     {
@@ -282,7 +310,7 @@ siridb_t * siridb_new(const char * dbpath, int lock_flags)
     log_info("Updating series properties");
 
     /* create a copy since 'siridb_series_update_props' might drop a series */
-    slist_t * slist = imap_2slist(siridb->series_map);
+    slist_t * slist = idmap_2slist(siridb->series_map);
 
     if (slist == NULL)
     {
@@ -310,6 +338,7 @@ siridb_t * siridb_new(const char * dbpath, int lock_flags)
         {
             siridb_reindex_start(siridb->reindex->timer);
         }
+        siridb_wal_start(siridb);
     }
 
     siridb->start_ts = time(NULL);
@@ -481,6 +510,27 @@ int siridb_from_unpacker(
 
     (*siridb)->drop_threshold = qp_obj.via.real;
 
+    /* read the optional lookup versions */
+    if (qp_next(unpacker, &qp_obj) == QP_INT64)
+    {
+        if (qp_obj.via.int64 < 0 || qp_obj.via.int64 >= SIRIDB_LOOKUP_END)
+        {
+            READ_DB_EXIT_WITH_ERROR("cannot read lookup version.")
+        }
+
+        (*siridb)->lookup_version =
+                (*siridb)->prev_lookup_version = (uint8_t) qp_obj.via.int64;
+
+        if (qp_next(unpacker, &qp_obj) != QP_INT64 ||
+                qp_obj.via.int64 < 0 ||
+                qp_obj.via.int64 >= SIRIDB_LOOKUP_END)
+        {
+            READ_DB_EXIT_WITH_ERROR("cannot read previous lookup version.")
+        }
+
+        (*siridb)->prev_lookup_version = (uint8_t) qp_obj.via.int64;
+    }
+
     return 0;
 }
 
@@ -561,6 +611,8 @@ int siridb_save(siridb_t * siridb)
             qp_fadd_int64(fpacker, siridb->duration_log) ||
             qp_fadd_string(fpacker, iso8601_tzname(siridb->tz)) ||
             qp_fadd_double(fpacker, siridb->drop_threshold) ||
+            qp_fadd_int8(fpacker, siridb->lookup_version) ||
+            qp_fadd_int8(fpacker, siridb->prev_lookup_version) ||
             qp_fadd_type(fpacker, QP_ARRAY_CLOSE) ||
             qp_close(fpacker));
 }
@@ -576,6 +628,12 @@ void siridb__free(siridb_t * siridb)
     log_debug("Free database: '%s'", siridb->dbname);
 #endif
 
+    /* buffers in memory must be written before the buffer file is closed */
+    if (siridb->wal != NULL)
+    {
+        siridb_wal_free(siridb);
+    }
+
     /* first we should close all open files */
     if (siridb->buffer_fp != NULL)
     {
@@ -601,6 +659,12 @@ void siridb__free(siridb_t * siridb)
     /* free buffer positions */
     slist_free(siridb->empty_buffers);
 
+    /* cancel queued inserts for other pools while the servers exist */
+    if (siridb->pools != NULL)
+    {
+        siridb_pools_close(siridb->pools);
+    }
+
     /* we do not need to free server and replica since they exist in
      * this list and therefore will be freed.
      */
@@ -637,16 +701,16 @@ void siridb__free(siridb_t * siridb)
         siridb_pools_free(siridb->pools);
     }
 
-    /* free imap (series) */
+    /* free idmap (series) */
     if (siridb->series_map != NULL)
     {
-        imap_free(siridb->series_map, NULL);
+        idmap_free(siridb->series_map, NULL);
     }
 
-    /* free c-tree lookup and series */
+    /* free radix tree lookup and series */
     if (siridb->series != NULL)
     {
-        ct_free(siridb->series, (ct_free_cb) &siridb__series_decref);
+        art_free(siridb->series, (art_free_cb) &siridb__series_decref);
     }
 
     /* free shards using imap walk an free the imap */
@@ -682,6 +746,12 @@ void siridb__free(siridb_t * siridb)
 
     uv_mutex_destroy(&siridb->series_mutex);
     uv_mutex_destroy(&siridb->shards_mutex);
+    uv_mutex_destroy(&siridb->buffer_mutex);
+
+    for (int i = 0; i < SIRIDB_SERIES_STRIPES; i++)
+    {
+        uv_mutex_destroy(&siridb->series_stripes[i]);
+    }
 
     free(siridb);
 }
@@ -698,7 +768,7 @@ static siridb_t * SIRIDB_new(void)
     }
     else
     {
-        siridb->series = ct_new();
+        siridb->series = art_new();
         if (siridb->series == NULL)
         {
             free(siridb);
@@ -706,10 +776,10 @@ static siridb_t * SIRIDB_new(void)
         }
         else
         {
-            siridb->series_map = imap_new();
+            siridb->series_map = idmap_new();
             if (siridb->series_map == NULL)
             {
-                ct_free(siridb->series, NULL);
+                art_free(siridb->series, NULL);
                 free(siridb);
                 siridb = NULL;  /* signal is raised */
             }
@@ -718,8 +788,8 @@ static siridb_t * SIRIDB_new(void)
                 siridb->shards = imap_new();
                 if (siridb->shards == NULL)
                 {
-                    imap_free(siridb->series_map, NULL);
-                    ct_free(siridb->series, NULL);
+                    idmap_free(siridb->series_map, NULL);
+                    art_free(siridb->series, NULL);
                     free(siridb);
                     siridb = NULL;  /* signal is raised */
                 }
@@ -730,8 +800,8 @@ static siridb_t * SIRIDB_new(void)
                     if (siridb->empty_buffers == NULL)
                     {
                         imap_free(siridb->shards, NULL);
-                        imap_free(siridb->series_map, NULL);
-                        ct_free(siridb->series, NULL);
+                        idmap_free(siridb->series_map, NULL);
+                        art_free(siridb->series, NULL);
                         free(siridb);
                         siridb = NULL;  /* signal is raised */
                     }
@@ -742,6 +812,9 @@ static siridb_t * SIRIDB_new(void)
                         siridb->ref = 1;
                         siridb->active_tasks = 0;
                         siridb->insert_tasks = 0;
+                        siridb->insert_queue = 0;
+                        siridb->insert_queue_size = 0;
+                        siridb->dropped_points = 0;
                         siridb->flags = 0;
                         siridb->buffer_path = NULL;
                         siridb->time = NULL;
@@ -751,6 +824,8 @@ static siridb_t * SIRIDB_new(void)
                         siridb->max_series_id = 0;
                         siridb->received_points = 0;
                         siridb->drop_threshold = 1.0;
+                        siridb->lookup_version = SIRIDB_LOOKUP_DEFAULT;
+                        siridb->prev_lookup_version = SIRIDB_LOOKUP_DEFAULT;
                         siridb->buffer_size = -1;
                         siridb->tz = -1;
                         siridb->server = NULL;
@@ -759,6 +834,8 @@ static siridb_t * SIRIDB_new(void)
                         siridb->replicate = NULL;
                         siridb->reindex = NULL;
                         siridb->groups = NULL;
+                        siridb->insert_group = NULL;
+                        siridb->wal = NULL;
 
                         /* make file pointers are NULL when file is closed */
                         siridb->buffer_fp = NULL;
@@ -767,6 +844,12 @@ static siridb_t * SIRIDB_new(void)
 
                         uv_mutex_init(&siridb->series_mutex);
                         uv_mutex_init(&siridb->shards_mutex);
+                        uv_mutex_init(&siridb->buffer_mutex);
+
+                        for (int i = 0; i < SIRIDB_SERIES_STRIPES; i++)
+                        {
+                            uv_mutex_init(&siridb->series_stripes[i]);
+                        }
                     }
                 }
             }
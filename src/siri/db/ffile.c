@@ -7,7 +7,7 @@
  *
  * changes
  *  - initial version, 30-06-2016
- *
+ *  - packages can be kept in the file after they are read, 18-10-2026
  *
  */
 #define _GNU_SOURCE
@@ -88,7 +88,7 @@ siridb_ffile_t * siridb_ffile_new(
 
         if (pkg == NULL)
         {
-            ffile->size = ffile->free_space = FFILE_DEFAULT_SIZE;
+            ffile->pos = ffile->size = ffile->free_space = FFILE_DEFAULT_SIZE;
         }
         else
         {
@@ -98,6 +98,7 @@ siridb_ffile_t * siridb_ffile_new(
             /* set free space to a value is will always fit */
             ffile->size = ffile->free_space = (size > FFILE_DEFAULT_SIZE) ?
                     size : FFILE_DEFAULT_SIZE;
+            ffile->pos = ffile->size;
 
             /* because we has enough free space, this should always work */
             if (siridb_ffile_append(ffile, pkg) != FFILE_SUCCESS)
@@ -119,7 +120,9 @@ siridb_ffile_t * siridb_ffile_new(
             return NULL;
         }
 
-        if ((ffile->size = ftello(ffile->fp)) >= sizeof(uint32_t))
+        ffile->pos = ffile->size = ftello(ffile->fp);
+
+        if (ffile->size >= sizeof(uint32_t))
         {
             ffile->free_space = 0;
             if (    fseeko(ffile->fp, -(long int) sizeof(uint32_t), SEEK_END) ||
@@ -215,8 +218,8 @@ sirinet_pkg_t * siridb_ffile_pop(siridb_ffile_t * ffile)
 #endif
     if (fseeko(
             ffile->fp,
-            -(long int) (ffile->next_size + sizeof(uint32_t)),
-            SEEK_END))
+            ffile->pos - (long int) (ffile->next_size + sizeof(uint32_t)),
+            SEEK_SET))
     {
         log_critical("Seek error in '%s'", ffile->fn);
         return NULL;
@@ -258,21 +261,65 @@ sirinet_pkg_t * siridb_ffile_pop(siridb_ffile_t * ffile)
  */
 int siridb_ffile_pop_commit(siridb_ffile_t * ffile)
 {
+#ifdef DEBUG
+    assert (ffile->next_size && ffile->fp != NULL);
+    assert (ffile->pos == ffile->size);
+#endif
+
+    if (siridb_ffile_pop_next(ffile))
+    {
+        return -1;
+    }
+
+    ffile->size = ffile->pos;
+
+    return ftruncate(ffile->fd, ffile->size);
+}
+
+/*
+ * Move to the next package but keep the package which is read in the file.
+ *
+ * returns 0 if successful, -1 in case of an error
+ */
+int siridb_ffile_pop_next(siridb_ffile_t * ffile)
+{
 #ifdef DEBUG
     assert (ffile->next_size && ffile->fp != NULL);
 #endif
 
-    ffile->size -= ffile->next_size + sizeof(uint32_t);
+    ffile->pos -= ffile->next_size + sizeof(uint32_t);
 
     return (fseeko(
                 ffile->fp,
-                ffile->size - sizeof(uint32_t),
+                ffile->pos - sizeof(uint32_t),
                 SEEK_SET) ||
-            fread(&ffile->next_size, sizeof(uint32_t), 1, ffile->fp) != 1 ||
-            ftruncate(ffile->fd, ffile->size)) ?
+            fread(&ffile->next_size, sizeof(uint32_t), 1, ffile->fp) != 1) ?
                     -1 : 0;
 }
 
+/*
+ * Remove packages which are read from the file. The file does not need to
+ * be open. Size must be equal to or greater than ffile->pos.
+ *
+ * returns 0 if successful, -1 in case of an error
+ */
+int siridb_ffile_truncate(siridb_ffile_t * ffile, long int size)
+{
+#ifdef DEBUG
+    assert (size >= ffile->pos && size <= ffile->size);
+#endif
+
+    if ((ffile->fp == NULL) ?
+            truncate(ffile->fn, size) : ftruncate(ffile->fd, size))
+    {
+        log_critical("Cannot truncate fifo file: '%s'", ffile->fn);
+        return -1;
+    }
+
+    ffile->size = size;
+
+    return 0;
+}
 
 /*
  * signal can be set in case of file errors
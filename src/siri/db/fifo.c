@@ -7,11 +7,16 @@
  *
  * changes
  *  - initial version, 30-06-2016
+ *  - log sequence numbers and packages kept for the write-ahead log,
+ *    18-10-2026
+ *  - walking skips a corrupt package and the packages after it in the same
+ *    file, 18-10-2026
  *
  */
 #define _GNU_SOURCE
 #include <assert.h>
 #include <ctype.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <logger/logger.h>
 #include <siri/db/fifo.h>
@@ -22,8 +27,19 @@
 #include <unistd.h>
 #include <uuid/uuid.h>
 
+#define FIFO_CURSOR_FN "cursor.dat"
+
 static int FIFO_walk_free(siridb_ffile_t * ffile, void * args);
 static int FIFO_init(siridb_fifo_t * fifo);
+static char * FIFO_path(siridb_t * siridb, siridb_server_t * replica);
+static void FIFO_done(siridb_fifo_t * fifo, siridb_ffile_t * ffile);
+static void FIFO_write_cursor(siridb_fifo_t * fifo);
+static int FIFO_walk_file(
+        const char * fn,
+        uint64_t id,
+        uint64_t lsn,
+        siridb_fifo_walk_cb cb,
+        void * data);
 
 /*
  * Returns NULL and raises a SIGNAL in case an error has occurred.
@@ -41,24 +57,30 @@ siridb_fifo_t * siridb_fifo_new(siridb_t * siridb)
     }
 
     fifo->fifos = llist_new();
+    fifo->done = llist_new();
 
-    if (fifo->fifos == NULL)
+    if (fifo->fifos == NULL || fifo->done == NULL)
     {
+        if (fifo->fifos != NULL)
+        {
+            llist_free_cb(fifo->fifos, (llist_cb) FIFO_walk_free, NULL);
+        }
         free(fifo);
         return NULL;  /* signal is raised */
     }
 
     fifo->in = NULL;
     fifo->out = NULL;
+    fifo->lsn = 0;
+    fifo->retain = 0;
+    fifo->cursor_fd = -1;
+    fifo->max_id = -1;
 
-    char str_uuid[37];
-    uuid_unparse_lower(siridb->replica->uuid, str_uuid);
-
-    if (asprintf(&fifo->path, "%s.%s/", siridb->dbpath, str_uuid) < 0)
+    fifo->path = FIFO_path(siridb, siridb->replica);
+    if (fifo->path == NULL)
     {
-        ERR_ALLOC
         siridb_fifo_free(fifo);
-        return NULL;
+        return NULL;  /* signal is raised */
     }
 
     if (FIFO_init(fifo))
@@ -67,8 +89,12 @@ siridb_fifo_t * siridb_fifo_new(siridb_t * siridb)
         return NULL;
     }
 
-    fifo->max_id = (fifo->fifos->len) ?
-            ((siridb_ffile_t *) fifo->fifos->last->data)->id : -1;
+    if (    fifo->fifos->len &&
+            (ssize_t) ((siridb_ffile_t *) fifo->fifos->last->data)->id >
+                fifo->max_id)
+    {
+        fifo->max_id = ((siridb_ffile_t *) fifo->fifos->last->data)->id;
+    }
 
     fifo->in = siridb_ffile_new(++fifo->max_id, fifo->path, NULL);
     if (fifo->in == NULL)
@@ -131,8 +157,9 @@ int siridb_fifo_append(siridb_fifo_t * fifo, sirinet_pkg_t * pkg)
             /* when the out fifo has no next size, we want to use the new
              * in fifo also as the out fifo.
              */
-            siridb_ffile_unlink(fifo->out);
+            FIFO_done(fifo, fifo->out);
             fifo->out = fifo->in;
+            FIFO_write_cursor(fifo);
         }
         else
         {
@@ -145,6 +172,15 @@ int siridb_fifo_append(siridb_fifo_t * fifo, sirinet_pkg_t * pkg)
         ERR_FILE
         break;
     }
+
+    if (!siri_err)
+    {
+        fifo->lsn = siridb_fifo_lsn(
+                fifo->in,
+                fifo->in->free_space +
+                    pkg->len + sizeof(sirinet_pkg_t) + sizeof(uint32_t));
+    }
+
     return siri_err;
 }
 
@@ -176,7 +212,9 @@ sirinet_pkg_t * siridb_fifo_pop(siridb_fifo_t * fifo)
  */
 int siridb_fifo_commit(siridb_fifo_t * fifo)
 {
-    if (siridb_ffile_pop_commit(fifo->out))
+    if ((fifo->retain) ?
+            siridb_ffile_pop_next(fifo->out) :
+            siridb_ffile_pop_commit(fifo->out))
     {
         log_error("Error occurred when shrinking file: '%s' ",
                 fifo->out->fn);
@@ -198,7 +236,7 @@ int siridb_fifo_commit(siridb_fifo_t * fifo)
 
     if (!fifo->out->next_size && fifo->out != fifo->in)
     {
-        siridb_ffile_unlink(fifo->out);
+        FIFO_done(fifo, fifo->out);
         fifo->out = (siridb_ffile_t *) llist_shift(fifo->fifos);
 
         /* fifo->out->fp can be open in case it is equal to fifo->in */
@@ -217,6 +255,8 @@ int siridb_fifo_commit(siridb_fifo_t * fifo)
     assert (fifo->out != NULL);
 #endif
 
+    FIFO_write_cursor(fifo);
+
     return siri_err;
 }
 
@@ -287,13 +327,146 @@ void siridb_fifo_free(siridb_fifo_t * fifo)
     /* we only need to free fifo->out because fido->in is either in the
      * list or the same as fifo->out. (fifo->out is never in the list)
      */
-    siridb_ffile_free(fifo->out);
+    if (fifo->out != NULL)
+    {
+        siridb_ffile_free(fifo->out);
+    }
+
+    if (fifo->cursor_fd != -1 && close(fifo->cursor_fd))
+    {
+        ERR_FILE
+    }
 
     llist_free_cb(fifo->fifos, (llist_cb) FIFO_walk_free, NULL);
+    llist_free_cb(fifo->done, (llist_cb) FIFO_walk_free, NULL);
     free(fifo->path);
     free(fifo);
 }
 
+/*
+ * Remove packages which are send to the replica and have a log sequence
+ * number lower than 'lsn'. Packages which are not send are never removed.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ * (signal can be set in case of an error)
+ */
+int siridb_fifo_truncate(siridb_fifo_t * fifo, uint64_t lsn)
+{
+    uint64_t cursor = siridb_fifo_cursor(fifo);
+    siridb_ffile_t * ffile;
+    uint64_t id;
+    long int end;
+
+    if (lsn > cursor)
+    {
+        lsn = cursor;
+    }
+
+    id = lsn >> 32;
+    end = UINT32_MAX - (uint32_t) lsn;
+
+    while ( fifo->done->len &&
+            ((siridb_ffile_t *) fifo->done->first->data)->id < id)
+    {
+        /* signal can be set in unlink */
+        siridb_ffile_unlink((siridb_ffile_t *) llist_shift(fifo->done));
+    }
+
+    ffile = (fifo->done->len) ?
+            (siridb_ffile_t *) fifo->done->first->data : fifo->out;
+
+    return (ffile->id == id && end < ffile->size) ?
+            siridb_ffile_truncate(ffile, end) : 0;
+}
+
+/*
+ * Start or stop keeping packages which are send to the replica. When
+ * stopped, kept packages are removed.
+ *
+ * (signal can be set in case of an error)
+ */
+void siridb_fifo_set_retain(siridb_fifo_t * fifo, int retain)
+{
+    if (retain)
+    {
+        fifo->retain = 1;
+        FIFO_write_cursor(fifo);
+        return;
+    }
+
+    siridb_fifo_truncate(fifo, UINT64_MAX);
+    fifo->retain = 0;
+}
+
+/*
+ * Call 'cb' for each package in the fifo buffer for 'replica' which has a
+ * log sequence number equal to or higher than 'lsn'. Packages are read in
+ * order directly from the fifo files so this function can be used before
+ * the fifo buffer is created. Walking stops when the call-back returns a
+ * non zero value.
+ *
+ * A package is written in a fifo file before its size, so a package which
+ * was written while the process stopped is found as a corrupt package. Such
+ * package and the packages after it in the same file are skipped and
+ * walking continues with the next file.
+ *
+ * Returns 0 if successful or -1 in case of an error or when stopped by the
+ * call-back. (signal can be set in case of an error)
+ */
+int siridb_fifo_walk(
+        siridb_t * siridb,
+        siridb_server_t * replica,
+        uint64_t lsn,
+        siridb_fifo_walk_cb cb,
+        void * data)
+{
+    struct dirent ** fifo_list;
+    char * path = FIFO_path(siridb, replica);
+    char * fn;
+    int rc = 0;
+    int total;
+
+    if (path == NULL)
+    {
+        return -1;  /* signal is raised */
+    }
+
+    total = scandir(path, &fifo_list, NULL, alphasort);
+    if (total < 0)
+    {
+        /* no need to free fifo_list when total < 0 */
+        log_error("Cannot read fifo directory '%s'.", path);
+        free(path);
+        return -1;
+    }
+
+    for (int n = 0; n < total; n++)
+    {
+        if (!rc && siridb_ffile_check_fn(fifo_list[n]->d_name))
+        {
+            uint64_t id = strtoull(fifo_list[n]->d_name, NULL, 10);
+            if (id >= lsn >> 32)
+            {
+                if (asprintf(&fn, "%s%s", path, fifo_list[n]->d_name) < 0)
+                {
+                    ERR_ALLOC
+                    rc = -1;
+                }
+                else
+                {
+                    rc = FIFO_walk_file(fn, id, lsn, cb, data);
+                    free(fn);
+                }
+            }
+        }
+        free(fifo_list[n]);
+    }
+    free(fifo_list);
+    free(path);
+
+    return rc;
+}
+
 /*
  * returns 1 and a signal can be set if a file close has failed
  */
@@ -306,10 +479,15 @@ static int FIFO_walk_free(siridb_ffile_t * ffile, void * args)
 /*
  * returns 0 when successful or any other value when not.
  * (in case of an error a signal is set too)
+ *
+ * Files with packages which are already send to the replica are removed,
+ * these are left behind when packages were kept for the write-ahead log.
  */
 static int FIFO_init(siridb_fifo_t * fifo)
 {
     struct stat st = {0};
+    uint64_t cursor = 0;
+    char * fn;
 
     siridb_ffile_t * ffile;
 
@@ -322,45 +500,241 @@ static int FIFO_init(siridb_fifo_t * fifo)
         {
             log_critical("Cannot create directory '%s'.", fifo->path);
             ERR_C
+            return siri_err;
         }
     }
+
+    if (asprintf(&fn, "%s%s", fifo->path, FIFO_CURSOR_FN) < 0)
+    {
+        ERR_ALLOC
+        return siri_err;
+    }
+
+    fifo->cursor_fd = open(fn, O_RDWR | O_CREAT, 0600);
+    if (fifo->cursor_fd == -1)
+    {
+        log_critical("Cannot open file: '%s'", fn);
+        free(fn);
+        ERR_FILE
+        return siri_err;
+    }
+    free(fn);
+
+    if (pread(fifo->cursor_fd, &cursor, sizeof(uint64_t), 0) !=
+            sizeof(uint64_t))
+    {
+        cursor = 0;
+    }
     else
     {
-        struct dirent ** fifo_list;
-        char * fn;
-        int total = scandir(fifo->path, &fifo_list, NULL, alphasort);
+        /* new fifo files must get an id after the cursor */
+        fifo->max_id = cursor >> 32;
+    }
 
-        if (total < 0)
-        {
-            /* no need to free fifo_list when total < 0 */
-            log_critical("Cannot read fifo directory '%s'.", fifo->path);
-            ERR_C
-        }
+    struct dirent ** fifo_list;
+    int total = scandir(fifo->path, &fifo_list, NULL, alphasort);
 
-        for (int n = 0; n < total; n++)
+    if (total < 0)
+    {
+        /* no need to free fifo_list when total < 0 */
+        log_critical("Cannot read fifo directory '%s'.", fifo->path);
+        ERR_C
+        return siri_err;
+    }
+
+    for (int n = 0; n < total; n++)
+    {
+        if (siridb_ffile_check_fn(fifo_list[n]->d_name))
         {
-            if (siridb_ffile_check_fn(fifo_list[n]->d_name))
+            if (asprintf(&fn, "%s%s", fifo->path, fifo_list[n]->d_name) < 0)
+            {
+                ERR_ALLOC
+            }
+            else
             {
-                if (asprintf(&fn, "%s%s", fifo->path, fifo_list[n]->d_name) < 0)
+                uint64_t id = strtoull(fifo_list[n]->d_name, NULL, 10);
+                if (id < cursor >> 32)
                 {
-                    ERR_ALLOC
+                    log_debug("Removing send fifo: '%s'", fn);
+                    if (unlink(fn))
+                    {
+                        log_critical("Cannot remove fifo file: '%s'", fn);
+                    }
                 }
                 else
                 {
-                    uint64_t id = strtoull(fifo_list[n]->d_name, NULL, 10);
+                    long int end = UINT32_MAX - (uint32_t) cursor;
+                    if (    id == cursor >> 32 &&
+                            stat(fn, &st) == 0 &&
+                            st.st_size > end &&
+                            truncate(fn, end))
+                    {
+                        log_critical("Cannot truncate fifo file: '%s'", fn);
+                    }
                     ffile = siridb_ffile_new(id, fifo->path, NULL);
                     if (ffile != NULL)
                     {
                         llist_append(fifo->fifos, ffile);
                     }
-                    free(fn);
                 }
+                free(fn);
             }
-            free(fifo_list[n]);
         }
-        free(fifo_list);
+        free(fifo_list[n]);
     }
+    free(fifo_list);
+
     return siri_err;
 }
 
+/*
+ * Returns the path for the fifo buffer of 'replica' or NULL and a SIGNAL
+ * is raised in case of an error.
+ */
+static char * FIFO_path(siridb_t * siridb, siridb_server_t * replica)
+{
+    char * path;
+    char str_uuid[37];
+    uuid_unparse_lower(replica->uuid, str_uuid);
+
+    if (asprintf(&path, "%s.%s/", siridb->dbpath, str_uuid) < 0)
+    {
+        ERR_ALLOC
+        return NULL;
+    }
+    return path;
+}
+
+/*
+ * Called when all packages in a file are send to the replica. The file is
+ * removed unless packages are kept for the write-ahead log.
+ *
+ * (signal can be set in case of an error)
+ */
+static void FIFO_done(siridb_fifo_t * fifo, siridb_ffile_t * ffile)
+{
+    if (!fifo->retain)
+    {
+        siridb_ffile_unlink(ffile);
+        return;
+    }
+
+    if (ffile->fp != NULL)
+    {
+        if (fclose(ffile->fp))
+        {
+            ERR_FILE
+        }
+        ffile->fp = NULL;
+    }
 
+    if (llist_append(fifo->done, ffile))
+    {
+        siridb_ffile_free(ffile);  /* signal is raised */
+    }
+}
+
+/*
+ * Save the position of the replica. This is only required while packages
+ * are kept since otherwise send packages are removed from the fifo files.
+ */
+static void FIFO_write_cursor(siridb_fifo_t * fifo)
+{
+    uint64_t cursor;
+
+    if (!fifo->retain)
+    {
+        return;
+    }
+
+    cursor = siridb_fifo_cursor(fifo);
+    if (pwrite(fifo->cursor_fd, &cursor, sizeof(uint64_t), 0) !=
+            sizeof(uint64_t))
+    {
+        log_error("Cannot write fifo cursor in '%s'", fifo->path);
+    }
+}
+
+/*
+ * Read packages from a fifo file which is not opened by the fifo buffer.
+ * Reading the file stops at a corrupt package.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ */
+static int FIFO_walk_file(
+        const char * fn,
+        uint64_t id,
+        uint64_t lsn,
+        siridb_fifo_walk_cb cb,
+        void * data)
+{
+    sirinet_pkg_t * pkg;
+    uint32_t size;
+    long int pos;
+    uint64_t pkg_lsn;
+    int rc = 0;
+    FILE * fp = fopen(fn, "r");
+
+    if (fp == NULL)
+    {
+        log_error("Cannot open fifo file: '%s'", fn);
+        return -1;
+    }
+
+    if (fseeko(fp, 0, SEEK_END) || (pos = ftello(fp)) < 0)
+    {
+        log_error("Cannot read fifo file: '%s'", fn);
+        fclose(fp);
+        return -1;
+    }
+
+    while ( !rc &&
+            pos >= (long int) sizeof(uint32_t) &&
+            fseeko(fp, pos - sizeof(uint32_t), SEEK_SET) == 0 &&
+            fread(&size, sizeof(uint32_t), 1, fp) == 1 &&
+            size)
+    {
+        if (    size < sizeof(sirinet_pkg_t) ||
+                pos < (long int) (size + sizeof(uint32_t)))
+        {
+            log_error(
+                    "Corrupt package in fifo: '%s', skip the remaining "
+                    "packages in this file", fn);
+            break;
+        }
+
+        pkg_lsn = ((uint64_t) id << 32) | (UINT32_MAX - (uint32_t) pos);
+        pos -= size + sizeof(uint32_t);
+
+        if (pkg_lsn < lsn)
+        {
+            continue;
+        }
+
+        pkg = (sirinet_pkg_t *) malloc(size);
+        if (pkg == NULL)
+        {
+            ERR_ALLOC
+            rc = -1;
+            break;
+        }
+
+        if (    fseeko(fp, pos, SEEK_SET) ||
+                fread(pkg, size, 1, fp) != 1 ||
+                pkg->len != size - sizeof(sirinet_pkg_t))
+        {
+            log_error(
+                    "Corrupt package in fifo: '%s', skip the remaining "
+                    "packages in this file", fn);
+            free(pkg);
+            break;
+        }
+
+        rc = cb(pkg, pkg_lsn, data);
+        free(pkg);
+    }
+
+    fclose(fp);
+
+    return rc;
+}
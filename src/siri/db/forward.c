@@ -7,11 +7,13 @@
  *
  * changes
  *  - initial version, 31-07-2016
+ *  - forward points using the pool pipeline, 18-10-2026
  *
  */
 #include <qpack/qpack.h>
 #include <siri/async.h>
 #include <siri/db/forward.h>
+#include <siri/db/pipeline.h>
 #include <siri/err.h>
 #include <siri/net/promises.h>
 #include <siri/net/protocol.h>
@@ -136,13 +138,13 @@ void siridb_forward_points_to_pools(uv_async_t * handle)
         /* the packer is destroyed, set to NULL */
         forward->packer[n] = NULL;
 
-        if (siridb_pool_send_pkg(
-                forward->siridb->pools->pool + n,
+        if (siridb_pipeline_send_pkg(
+                forward->siridb,
+                n,
                 pkg,
                 0,
                 sirinet_promises_on_response,
-                promises,
-                0))
+                promises))
         {
             log_critical("One pool is unreachable while re-indexing!");
             free(pkg);
@@ -47,23 +47,22 @@ siridb_group_t * siridb_group_new(
         group->name = NULL;
         group->source = strndup(source, source_len);
         group->series = slist_new(SLIST_DEFAULT_SIZE);
-        group->regex = NULL;
-        group->regex_extra = NULL;
+        group->ids = roaring_new();
+        group->re = NULL;
 
         if (    group->source == NULL ||
-                group->series == NULL)
+                group->series == NULL ||
+                group->ids == NULL)
         {
             ERR_ALLOC
             sprintf(err_msg, "Memory allocation error.");
             siridb__group_free(group);
             group = NULL;
         }
-        else if (siridb_re_compile(
-                &group->regex,
-                &group->regex_extra,
+        else if ((group->re = siridb_re_get(
                 source,
                 source_len,
-                err_msg))
+                err_msg)) == NULL)
         {
             /* not critical, err_msg is set */
             siridb__group_free(group);
@@ -175,6 +174,7 @@ void siridb_group_cleanup(siridb_group_t * group)
 
         if (series->flags & SIRIDB_SERIES_IS_DROPPED)
         {
+            roaring_remove(group->ids, series->id);
             siridb_series_decref(series);
             dropped++;
         }
@@ -195,20 +195,17 @@ void siridb_group_cleanup(siridb_group_t * group)
 int siridb_group_test_series(siridb_group_t * group, siridb_series_t * series)
 {
     /* skip if group has flags set. (DROPPED or INIT) */
-    int rc = (group->flags) ? -2 : pcre_exec(
-            group->regex,
-            group->regex_extra,
+    int rc = (group->flags) ? -2 : siridb_re_exec(
+            group->re,
             series->name,
-            series->name_len,
-            0,                     // start looking at this point
-            0,                     // OPTIONS
-            NULL,
-            0);                    // length of sub_str_vec
+            series->name_len);
 
     if (!rc)
     {
-        if (slist_append_safe(&group->series, series))
+        if (roaring_add(group->ids, series->id) < 0 ||
+            slist_append_safe(&group->series, series))
         {
+            roaring_remove(group->ids, series->id);
             log_critical(
                     "Cannot append series '%s' to group '%s'",
                     series->name,
@@ -238,8 +235,7 @@ int siridb_group_update_expression(
         char * err_msg)
 {
     char * new_source = strndup(source, source_len);
-    pcre * new_regex;
-    pcre_extra * new_regex_extra;
+    siridb_re_t * new_re;
     siridb_series_t * series;
 
     if (new_source == NULL)
@@ -249,12 +245,7 @@ int siridb_group_update_expression(
         return -1;
     }
 
-    if (siridb_re_compile(
-            &new_regex,
-            &new_regex_extra,
-            source,
-            source_len,
-            err_msg))
+    if ((new_re = siridb_re_get(source, source_len, err_msg)) == NULL)
     {
         free(new_source);
         return -1;  /* err_msg is set */
@@ -264,12 +255,13 @@ int siridb_group_update_expression(
 
     /* replace group expression */
     free(group->source);
-    free(group->regex);
-    free(group->regex_extra);
+    siridb_re_decref(group->re);
 
     group->source = new_source;
-    group->regex = new_regex;
-    group->regex_extra = new_regex_extra;
+    group->re = new_re;
+
+    /* the matcher uses the prefix of the expression */
+    groups->flags |= GROUPS_FLAG_REBUILD_MATCHER;
 
     for (size_t i = 0; i < group->series->len; i++)
     {
@@ -281,6 +273,8 @@ int siridb_group_update_expression(
 
     slist_compact(&group->series);
 
+    roaring_clear(group->ids);
+
     if (~group->flags & GROUP_FLAG_INIT)
     {
         group->flags |= GROUP_FLAG_INIT;
@@ -296,6 +290,7 @@ int siridb_group_update_expression(
         else
         {
             siridb_group_incref(group);
+            uv_cond_signal(&groups->cond);
         }
     }
 
@@ -372,7 +367,15 @@ void siridb__group_free(siridb_group_t * group)
         slist_free(group->series);
     }
 
-    free(group->regex);
-    free(group->regex_extra);
+    if (group->ids != NULL)
+    {
+        roaring_free(group->ids);
+    }
+
+    if (group->re != NULL)
+    {
+        siridb_re_decref(group->re);
+    }
+
     free(group);
 }
@@ -23,23 +23,30 @@
  *
  *  Group thread:
  *      group->series :     read (no lock)      write (lock)
+ *      groups->matcher :   read (no lock)      write (lock)
+ *
+ *  The group thread sleeps on groups->cond and is woken when new series or
+ *  groups are added. (groups->mutex must be locked when signaling)
  *
  *  Note:   One exception to 'not allowed' are the free functions
  *          since they only run when no other references to the object exist.
  */
 #define _GNU_SOURCE
 #include <assert.h>
+#include <ctype.h>
 #include <logger/logger.h>
 #include <siri/db/db.h>
 #include <siri/db/group.h>
 #include <siri/db/groups.h>
 #include <siri/db/misc.h>
+#include <siri/db/re.h>
 #include <siri/db/series.h>
 #include <siri/err.h>
 #include <siri/net/protocol.h>
 #include <siri/siri.h>
 #include <slist/slist.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <xpath/xpath.h>
 
@@ -47,9 +54,40 @@
 #define SIRIDB_GROUPS_FN "groups.dat"
 #define GROUPS_LOOP_SLEEP 2  // 2 seconds
 #define GROUPS_LOOP_DEEP 15  // x times -> 30 seconds (used when re-indexing)
+#define GROUPS_LOOP_TIMEOUT (GROUPS_LOOP_SLEEP * 1000000000ULL)  // nanoseconds
 #define GROUPS_RE_BATCH_SZ 1000
+#define GROUPS_SCAN_THREADS 4
+#define GROUPS_SCAN_CHUNK_SZ 25000  // minimal number of series per thread
 #define CALC_BATCH_SIZE(sz) GROUPS_RE_BATCH_SZ /((sz / 5 ) + 1) + 1;
 
+/*
+ * The matcher is used to test a new series against all groups at once.
+ * Groups are indexed by the literal prefix of their expression so only
+ * groups with a prefix matching the series name and groups without a
+ * prefix need to be tested.
+ */
+struct groups_matcher_s
+{
+    size_t nlens;           /* number of distinct prefix lengths */
+    size_t nilens;          /* number of distinct caseless prefix lengths */
+    uint16_t * lens;        /* ordered distinct prefix lengths */
+    uint16_t * ilens;       /* ordered distinct caseless prefix lengths */
+    ct_t * prefixes;        /* prefix -> slist_t with groups */
+    ct_t * iprefixes;       /* lower case prefix -> slist_t with groups */
+    slist_t * other;        /* groups without a literal prefix */
+};
+
+typedef struct groups_scan_s
+{
+    siridb_re_t * re;
+    slist_t * series_list;
+    slist_t * matches;
+    size_t start;
+    size_t end;
+    int has_thread;
+    uv_thread_t thread;
+} groups_scan_t;
+
 static int GROUPS_load(siridb_groups_t * groups);
 static void GROUPS_free(siridb_groups_t * groups);
 static int GROUPS_pkg(siridb_group_t * group, qp_packer_t * packer);
@@ -61,6 +99,20 @@ static void GROUPS_init_groups(siridb_t * siridb);
 static void GROUPS_init_series(siridb_t * siridb);
 static int GROUPS_2slist(siridb_group_t * group, slist_t * groups_list);
 static void GROUPS_cleanup(siridb_groups_t * groups);
+static groups_matcher_t * GROUPS_matcher_new(siridb_groups_t * groups);
+static int GROUPS_matcher_add(
+        siridb_group_t * group,
+        groups_matcher_t * matcher);
+static void GROUPS_matcher_add_len(uint16_t * lens, size_t * n, uint16_t len);
+static void GROUPS_matcher_free(groups_matcher_t * matcher);
+static void GROUPS_matcher_free_list(slist_t * glist);
+static void GROUPS_match(groups_matcher_t * matcher, siridb_series_t * series);
+static void GROUPS_match_list(slist_t * glist, siridb_series_t * series);
+static void GROUPS_scan_group(
+        siridb_groups_t * groups,
+        siridb_group_t * group,
+        slist_t * series_list);
+static void GROUPS_scan_work(groups_scan_t * scan);
 /*
  * In case of an error the return value is NULL and a SIGNAL is raised.
  */
@@ -81,7 +133,10 @@ siridb_groups_t * siridb_groups_new(siridb_t * siridb)
         groups->groups = ct_new();
         groups->nseries = slist_new(SLIST_DEFAULT_SIZE);
         groups->ngroups = slist_new(SLIST_DEFAULT_SIZE);
+        groups->matcher = NULL;
+        groups->flags = 0;
         uv_mutex_init(&groups->mutex);
+        uv_cond_init(&groups->cond);
         groups->work.data = (siridb_t *) siridb;
 
         if (groups->groups == NULL || groups->nseries == NULL)
@@ -102,8 +157,6 @@ siridb_groups_t * siridb_groups_new(siridb_t * siridb)
         else
         {
             groups->status = GROUPS_RUNNING;
-            groups->flags = 0;
-
         }
     }
 
@@ -123,7 +176,7 @@ void siridb_groups_start(siridb_groups_t * groups)
 }
 
 /*
- * Returns 0 if successful or -1 in case of an error.
+ * Queue a new series for the group thread and wake the thread.
  */
 void siridb_groups_add_series(
         siridb_groups_t * groups,
@@ -134,6 +187,7 @@ void siridb_groups_add_series(
     if (slist_append_safe(&groups->nseries, series) == 0)
     {
         siridb_series_incref(series);
+        uv_cond_signal(&groups->cond);
     }
     else
     {
@@ -193,6 +247,7 @@ int siridb_groups_add_group(
         break;
 
     case CT_OK:
+        groups->flags |= GROUPS_FLAG_REBUILD_MATCHER;
         if (slist_append_safe(&groups->ngroups, group))
         {
             siridb_group_decref(group);
@@ -202,6 +257,7 @@ int siridb_groups_add_group(
         else
         {
             siridb_group_incref(group);
+            uv_cond_signal(&groups->cond);
         }
         break;
 
@@ -215,9 +271,14 @@ int siridb_groups_add_group(
     return rc;
 }
 
-inline void siridb_groups_destroy(siridb_groups_t * groups)
+void siridb_groups_destroy(siridb_groups_t * groups)
 {
+    uv_mutex_lock(&groups->mutex);
+
     groups->status = GROUPS_STOPPING;
+    uv_cond_signal(&groups->cond);
+
+    uv_mutex_unlock(&groups->mutex);
 }
 
 /*
@@ -313,6 +374,13 @@ int siridb_groups_drop_group(
 
     siridb_group_t * group = (siridb_group_t *) ct_pop(groups->groups, name);
 
+    if (group != NULL)
+    {
+        groups->flags |= GROUPS_FLAG_REBUILD_MATCHER;
+        group->flags |= GROUP_FLAG_DROPPED;
+        siridb_group_decref(group);
+    }
+
     uv_mutex_unlock(&groups->mutex);
 
     if (group == NULL)
@@ -324,9 +392,6 @@ int siridb_groups_drop_group(
         return -1;
     }
 
-    group->flags |= GROUP_FLAG_DROPPED;
-    siridb_group_decref(group);
-
     if (siridb_groups_save(groups))
     {
         log_critical("Cannot save groups to file: '%s'", groups->fn);
@@ -398,7 +463,13 @@ static void GROUPS_free(siridb_groups_t * groups)
         slist_free(groups->ngroups);
     }
 
+    if (groups->matcher != NULL)
+    {
+        GROUPS_matcher_free(groups->matcher);
+    }
+
     uv_mutex_destroy(&groups->mutex);
+    uv_cond_destroy(&groups->cond);
 
     free(groups);
 }
@@ -426,10 +497,26 @@ static void GROUPS_loop(uv_work_t * work)
 
     while (groups->status != GROUPS_STOPPING)
     {
-        sleep(GROUPS_LOOP_SLEEP);
+        uv_mutex_lock(&groups->mutex);
+
+        /* wait for new series or groups, or until the timeout is reached
+         * so dropped series are still cleaned up */
+        if (    groups->status != GROUPS_STOPPING &&
+                !groups->nseries->len &&
+                !groups->ngroups->len)
+        {
+            uv_cond_timedwait(
+                    &groups->cond,
+                    &groups->mutex,
+                    GROUPS_LOOP_TIMEOUT);
+        }
+
+        uv_mutex_unlock(&groups->mutex);
 
         if (siridb_is_reindexing(siridb) && (++mod_test % GROUPS_LOOP_DEEP))
         {
+            /* do not compete with re-indexing, handle changes in batches */
+            sleep(GROUPS_LOOP_SLEEP);
             continue;
         }
 
@@ -543,6 +630,21 @@ static void GROUPS_init_series(siridb_t * siridb)
 
     uv_mutex_lock(&groups->mutex);
 
+    if (groups->matcher == NULL ||
+            (groups->flags & GROUPS_FLAG_REBUILD_MATCHER))
+    {
+        if (groups->matcher != NULL)
+        {
+            GROUPS_matcher_free(groups->matcher);
+        }
+        groups->flags &= ~GROUPS_FLAG_REBUILD_MATCHER;
+        groups->matcher = GROUPS_matcher_new(groups);
+        if (groups->matcher == NULL)
+        {
+            log_error("Cannot create group matcher, test each group instead");
+        }
+    }
+
     /* calculate modulo size  [1..1001] */
     int m = CALC_BATCH_SIZE(groups->groups->len);
 
@@ -552,10 +654,17 @@ static void GROUPS_init_series(siridb_t * siridb)
 
         if (~series->flags & SIRIDB_SERIES_IS_DROPPED)
         {
-            ct_values(
-                    groups->groups,
-                    (ct_val_cb) siridb_group_test_series,
-                    series);
+            if (groups->matcher != NULL)
+            {
+                GROUPS_match(groups->matcher, series);
+            }
+            else
+            {
+                ct_values(
+                        groups->groups,
+                        (ct_val_cb) siridb_group_test_series,
+                        series);
+            }
         }
 
         siridb_series_decref(series);
@@ -594,7 +703,7 @@ static void GROUPS_init_groups(siridb_t * siridb)
     uv_mutex_lock(&siridb->series_mutex);
 
     series_list = (groups->nseries->len) ?
-            NULL : imap_2slist_ref(siridb->series_map);
+            NULL : idmap_2slist_ref(siridb->series_map);
 
     uv_mutex_unlock(&siridb->series_mutex);
 
@@ -620,21 +729,8 @@ static void GROUPS_init_groups(siridb_t * siridb)
             /* remove INIT flag from group */
             group->flags &= ~GROUP_FLAG_INIT;
 
-            for (size_t i = 0; i < series_list->len; i++)
-            {
-                series = (siridb_series_t *) series_list->data[i];
-
-                siridb_group_test_series(group, series);
-
-                if (i % GROUPS_RE_BATCH_SZ == 0)
-                {
-                    uv_mutex_unlock(&groups->mutex);
-
-                    usleep(10000);  // 10ms
-
-                    uv_mutex_lock(&groups->mutex);
-                }
-            }
+            /* releases the lock while scanning */
+            GROUPS_scan_group(groups, group, series_list);
         }
 
         siridb_group_decref(group);
@@ -694,3 +790,361 @@ static void GROUPS_cleanup(siridb_groups_t * groups)
 
     slist_free(groups_list);
 }
+
+/*
+ * Group thread. (groups->mutex must be locked)
+ *
+ * Test all series in the list against a new group. The list is split in
+ * chunks which are tested in parallel without holding the lock. Matching
+ * series are added to the group when all chunks are finished, unless the
+ * group is dropped or changed in the meantime.
+ */
+static void GROUPS_scan_group(
+        siridb_groups_t * groups,
+        siridb_group_t * group,
+        slist_t * series_list)
+{
+    groups_scan_t scans[GROUPS_SCAN_THREADS];
+    siridb_re_t * re = group->re;
+    siridb_series_t * series;
+    size_t nthreads = series_list->len / GROUPS_SCAN_CHUNK_SZ + 1;
+    size_t chunk_sz, i, j;
+
+    if (nthreads > GROUPS_SCAN_THREADS)
+    {
+        nthreads = GROUPS_SCAN_THREADS;
+    }
+
+    chunk_sz = series_list->len / nthreads + 1;
+
+    siridb_re_incref(re);
+
+    uv_mutex_unlock(&groups->mutex);
+
+    for (i = 0; i < nthreads; i++)
+    {
+        scans[i].re = re;
+        scans[i].series_list = series_list;
+        scans[i].matches = slist_new(SLIST_DEFAULT_SIZE);
+        scans[i].start = i * chunk_sz;
+        scans[i].end = scans[i].start + chunk_sz;
+        if (scans[i].end > series_list->len)
+        {
+            scans[i].end = series_list->len;
+        }
+
+        /* the last chunk is tested by this thread, like the ones which
+         * cannot be started in a new thread */
+        scans[i].has_thread = (i < nthreads - 1 && uv_thread_create(
+                &scans[i].thread,
+                (uv_thread_cb) GROUPS_scan_work,
+                &scans[i]) == 0);
+
+        if (!scans[i].has_thread)
+        {
+            GROUPS_scan_work(&scans[i]);
+        }
+    }
+
+    for (i = 0; i < nthreads; i++)
+    {
+        if (scans[i].has_thread)
+        {
+            uv_thread_join(&scans[i].thread);
+        }
+    }
+
+    uv_mutex_lock(&groups->mutex);
+
+    for (i = 0; i < nthreads; i++)
+    {
+        if (scans[i].matches == NULL)
+        {
+            continue;
+        }
+
+        /* skip when the group is dropped or has a new expression */
+        if (group->re == re && !group->flags)
+        {
+            for (j = 0; j < scans[i].matches->len; j++)
+            {
+                series = (siridb_series_t *) scans[i].matches->data[j];
+                if (roaring_add(group->ids, series->id) < 0 ||
+                    slist_append_safe(&group->series, series))
+                {
+                    roaring_remove(group->ids, series->id);
+                    log_critical(
+                            "Cannot append series '%s' to group '%s'",
+                            series->name,
+                            group->name);
+                    break;
+                }
+                siridb_series_incref(series);
+            }
+        }
+
+        slist_free(scans[i].matches);
+    }
+
+    siridb_re_decref(re);
+}
+
+/*
+ * Runs in a group scan thread or in the group thread. No locks are used
+ * since both the list and the expression are not changed while scanning.
+ */
+static void GROUPS_scan_work(groups_scan_t * scan)
+{
+    siridb_series_t * series;
+
+    if (scan->matches == NULL)
+    {
+        log_critical("Cannot allocate a list for testing a new group");
+        return;
+    }
+
+    for (size_t i = scan->start; i < scan->end; i++)
+    {
+        series = (siridb_series_t *) scan->series_list->data[i];
+
+        if (    (~series->flags & SIRIDB_SERIES_IS_DROPPED) &&
+                siridb_re_exec(scan->re, series->name, series->name_len) == 0 &&
+                slist_append_safe(&scan->matches, series))
+        {
+            log_critical("Cannot append series '%s' while testing a group",
+                    series->name);
+            return;
+        }
+    }
+}
+
+/*
+ * Group thread. (groups->mutex must be locked)
+ *
+ * Returns the matcher for all groups or NULL in case of an error.
+ */
+static groups_matcher_t * GROUPS_matcher_new(siridb_groups_t * groups)
+{
+    groups_matcher_t * matcher =
+            (groups_matcher_t *) malloc(sizeof(groups_matcher_t));
+
+    if (matcher == NULL)
+    {
+        return NULL;
+    }
+
+    matcher->nlens = 0;
+    matcher->nilens = 0;
+    matcher->lens = (uint16_t *) malloc(
+            sizeof(uint16_t) * (groups->groups->len + 1));
+    matcher->ilens = (uint16_t *) malloc(
+            sizeof(uint16_t) * (groups->groups->len + 1));
+    matcher->prefixes = ct_new();
+    matcher->iprefixes = ct_new();
+    matcher->other = slist_new(SLIST_DEFAULT_SIZE);
+
+    if (    matcher->lens == NULL ||
+            matcher->ilens == NULL ||
+            matcher->prefixes == NULL ||
+            matcher->iprefixes == NULL ||
+            matcher->other == NULL ||
+            ct_values(
+                groups->groups,
+                (ct_val_cb) GROUPS_matcher_add,
+                matcher))
+    {
+        GROUPS_matcher_free(matcher);
+        return NULL;
+    }
+
+    return matcher;
+}
+
+/*
+ * Group thread. (groups->mutex must be locked)
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ */
+static int GROUPS_matcher_add(
+        siridb_group_t * group,
+        groups_matcher_t * matcher)
+{
+    siridb_re_t * re = group->re;
+    slist_t ** glist;
+
+    if (!re->prefix_len)
+    {
+        glist = &matcher->other;
+    }
+    else if (re->flags & SIRIDB_RE_FLAG_CASELESS)
+    {
+        char prefix[re->prefix_len + 1];
+
+        for (size_t i = 0; i <= re->prefix_len; i++)
+        {
+            prefix[i] = tolower(re->prefix[i]);
+        }
+
+        glist = (slist_t **) ct_get_sure(matcher->iprefixes, prefix);
+
+        GROUPS_matcher_add_len(
+                matcher->ilens,
+                &matcher->nilens,
+                re->prefix_len);
+    }
+    else
+    {
+        glist = (slist_t **) ct_get_sure(matcher->prefixes, re->prefix);
+
+        GROUPS_matcher_add_len(
+                matcher->lens,
+                &matcher->nlens,
+                re->prefix_len);
+    }
+
+    if (glist == NULL)
+    {
+        return -1;
+    }
+
+    if (ct_is_empty(*glist) &&
+            (*glist = slist_new(SLIST_DEFAULT_SIZE)) == NULL)
+    {
+        return -1;
+    }
+
+    if (slist_append_safe(glist, group))
+    {
+        return -1;
+    }
+
+    siridb_group_incref(group);
+
+    return 0;
+}
+
+/*
+ * Add a prefix length to the ordered lengths when not yet included.
+ */
+static void GROUPS_matcher_add_len(uint16_t * lens, size_t * n, uint16_t len)
+{
+    size_t i = *n;
+
+    for (; i && lens[i - 1] >= len; i--)
+    {
+        if (lens[i - 1] == len)
+        {
+            return;
+        }
+    }
+
+    memmove(lens + i + 1, lens + i, (*n - i) * sizeof(uint16_t));
+    lens[i] = len;
+    (*n)++;
+}
+
+/*
+ * Destroy a matcher. Parsing NULL is NOT allowed.
+ */
+static void GROUPS_matcher_free(groups_matcher_t * matcher)
+{
+    if (matcher->prefixes != NULL)
+    {
+        ct_free(matcher->prefixes, (ct_free_cb) GROUPS_matcher_free_list);
+    }
+
+    if (matcher->iprefixes != NULL)
+    {
+        ct_free(matcher->iprefixes, (ct_free_cb) GROUPS_matcher_free_list);
+    }
+
+    if (matcher->other != NULL)
+    {
+        GROUPS_matcher_free_list(matcher->other);
+    }
+
+    free(matcher->lens);
+    free(matcher->ilens);
+    free(matcher);
+}
+
+static void GROUPS_matcher_free_list(slist_t * glist)
+{
+    siridb_group_t * group;
+
+    if (ct_is_empty(glist))
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < glist->len; i++)
+    {
+        group = (siridb_group_t *) glist->data[i];
+        siridb_group_decref(group);
+    }
+
+    slist_free(glist);
+}
+
+/*
+ * Group thread. (groups->mutex must be locked)
+ *
+ * Test a series against all groups in one pass.
+ */
+static void GROUPS_match(groups_matcher_t * matcher, siridb_series_t * series)
+{
+    size_t i;
+    slist_t * glist;
+
+    for (i = 0; i < matcher->nlens && matcher->lens[i] <= series->name_len; i++)
+    {
+        glist = (slist_t *) ct_getn(
+                matcher->prefixes,
+                series->name,
+                matcher->lens[i]);
+
+        if (glist != NULL)
+        {
+            GROUPS_match_list(glist, series);
+        }
+    }
+
+    if (matcher->nilens && matcher->ilens[0] <= series->name_len)
+    {
+        size_t n = matcher->ilens[matcher->nilens - 1];
+        if (n > series->name_len)
+        {
+            n = series->name_len;
+        }
+
+        char lname[n];
+
+        for (i = 0; i < n; i++)
+        {
+            lname[i] = tolower(series->name[i]);
+        }
+
+        for (i = 0; i < matcher->nilens && matcher->ilens[i] <= n; i++)
+        {
+            glist = (slist_t *) ct_getn(
+                    matcher->iprefixes,
+                    lname,
+                    matcher->ilens[i]);
+
+            if (glist != NULL)
+            {
+                GROUPS_match_list(glist, series);
+            }
+        }
+    }
+
+    GROUPS_match_list(matcher->other, series);
+}
+
+static void GROUPS_match_list(slist_t * glist, siridb_series_t * series)
+{
+    for (size_t i = 0; i < glist->len; i++)
+    {
+        siridb_group_test_series((siridb_group_t *) glist->data[i], series);
+    }
+}
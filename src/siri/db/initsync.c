@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 22-07-2016
+ *  - points are packed while reading the series, 18-10-2026
  *
  */
 #define _GNU_SOURCE
@@ -88,9 +89,9 @@ siridb_initsync_t * siridb_initsync_open(siridb_t * siridb, int create_new)
                 }
                 else if (create_new)
                 {
-                    if (imap_walk(
+                    if (idmap_walk(
                                 siridb->series_map,
-                                (imap_cb) INITSYNC_create_cb,
+                                (idmap_cb) INITSYNC_create_cb,
                                 initsync->fp) || fflush(initsync->fp))
                     {
                         ERR_FILE
@@ -107,7 +108,7 @@ siridb_initsync_t * siridb_initsync_open(siridb_t * siridb, int create_new)
                             1,
                             initsync->fp) == 1)
                     {
-                        series = imap_get(
+                        series = idmap_get(
                                 siridb->series_map,
                                 series_id);
 
@@ -373,51 +374,48 @@ static void INITSYNC_work(uv_timer_t * timer)
     siridb_initsync_t * initsync = siridb->replicate->initsync;
     siridb_series_t * series;
 
-    series = imap_get(siridb->series_map, *initsync->next_series_id);
+    series = idmap_get(siridb->series_map, *initsync->next_series_id);
 
     if (series != NULL)
     {
-        uv_mutex_lock(&siridb->series_mutex);
-
-        siridb_points_t * points = siridb_series_get_points(
-                series,
-                NULL,
-                NULL);
-
-        uv_mutex_unlock(&siridb->series_mutex);
-
-        if (points != NULL)
+        qp_packer_t * packer = sirinet_packer_new(QP_SUGGESTED_SIZE);
+        if (packer != NULL)
         {
-            qp_packer_t * packer = sirinet_packer_new(QP_SUGGESTED_SIZE);
-            if (packer != NULL)
-            {
-                qp_add_type(packer, QP_MAP1);
+            int rc;
 
-                /* add name including string terminator */
-                qp_add_raw(packer, series->name, series->name_len + 1);
+            qp_add_type(packer, QP_MAP1);
 
-                if (siridb_points_pack(points, packer) == 0)
-                {
-                    series->flags &= ~SIRIDB_SERIES_INIT_REPL;
+            /* add name including string terminator */
+            qp_add_raw(packer, series->name, series->name_len + 1);
 
-                    initsync->pkg = sirinet_packer2pkg(
-                            packer,
-                            0,
-                            BPROTO_INSERT_SERVER);
+            /* points are packed while reading so no copy is needed */
+            uv_mutex_lock(siridb_series_stripe(siridb, series));
+            uv_mutex_lock(&siridb->series_mutex);
 
-                    uv_timer_start(
-                            siridb->replicate->timer,
-                            INITSYNC_send,
-                            0,
-                            0);
+            rc = siridb_series_pack_points(series, packer);
 
-                }
-                else
-                {
-                    qp_packer_free(packer);  /* signal is raised */
-                }
+            uv_mutex_unlock(&siridb->series_mutex);
+            uv_mutex_unlock(siridb_series_stripe(siridb, series));
+
+            if (rc == 0)
+            {
+                series->flags &= ~SIRIDB_SERIES_INIT_REPL;
+
+                initsync->pkg = sirinet_packer2pkg(
+                        packer,
+                        0,
+                        BPROTO_INSERT_SERVER);
+
+                uv_timer_start(
+                        siridb->replicate->timer,
+                        INITSYNC_send,
+                        0,
+                        0);
+            }
+            else
+            {
+                qp_packer_free(packer);  /* signal is raised */
             }
-            siridb_points_free(points);
         }
     }
     else
@@ -487,7 +485,7 @@ static void INITSYNC_on_insert_response(
 
 
 /*
- * Typedef: imap_cb
+ * Typedef: idmap_cb
  *
  * Returns 0 if successful
  */
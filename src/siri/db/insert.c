@@ -7,18 +7,29 @@
  *
  * changes
  *  - initial version, 24-03-2016
+ *  - points for local series are applied by worker threads, 18-10-2026
+ *  - columnar bulk insert package, 18-10-2026
+ *  - inserts without a client for the line protocol listeners, 18-10-2026
+ *  - insert queue for admission control, 18-10-2026
+ *  - points for other pools are send using the pool pipeline, 18-10-2026
+ *  - insert tasks wait for a checkpoint of the write-ahead log, 18-10-2026
+ *  - finished inserts resume paused line protocol connections, 18-10-2026
  *
  */
 #include <assert.h>
+#include <endian.h>
 #include <logger/logger.h>
 #include <qpack/qpack.h>
 #include <siri/async.h>
 #include <siri/db/forward.h>
 #include <siri/db/insert.h>
+#include <siri/db/pipeline.h>
 #include <siri/db/points.h>
 #include <siri/db/replicate.h>
 #include <siri/db/series.h>
+#include <siri/db/wal.h>
 #include <siri/err.h>
+#include <siri/net/lnserver.h>
 #include <siri/net/promises.h>
 #include <siri/net/protocol.h>
 #include <siri/net/socket.h>
@@ -31,6 +42,12 @@
 #define INSERT_AT_ONCE 3000    // one point counts as 1, a series as 100
 #define WEIGHT_SERIES 50
 #define WEIGHT_NEW_SERIES 100
+#define INSERT_JOB_DEFAULT_SIZE 8
+
+#define INSERT_LOCAL_HAS_SERIES(ilocal)                     \
+(((ilocal)->batch == NULL) ?                                \
+        qp_is_raw_term(&(ilocal)->qp_series_name) :         \
+        (ilocal)->next < (ilocal)->batch->len)
 
 #define SERIES_UPDATE_TS(series)    \
 if (*ts < series->start)            \
@@ -43,22 +60,47 @@ if (*ts > series->end)              \
 }
 
 static void INSERT_free(uv_handle_t * handle);
+static void INSERT_dequeue(siridb_insert_t * insert);
+static int INSERT_async(siridb_insert_t * insert);
+static int INSERT_coalesce(siridb_insert_t * insert);
+static int INSERT_merge(siridb_insert_t * dest, siridb_insert_t * insert);
+static void INSERT_group_flush(siridb_insert_group_t * group);
+static void INSERT_group_on_timer(uv_timer_t * timer);
+static void INSERT_respond(
+        siridb_insert_t * insert,
+        cproto_server_t tp,
+        const char * err_msg);
 static void INSERT_points_to_pools(uv_async_t * handle);
 static void INSERT_on_response(slist_t * promises, uv_async_t * handle);
 static uint16_t INSERT_get_pool(siridb_t * siridb, qp_obj_t * qp_series_name);
 
 static void INSERT_local_free_cb(uv_async_t * handle);
-static int8_t INSERT_local_work(
+static int INSERT_local_points(
         siridb_t * siridb,
+        siridb_series_t * series,
         qp_unpacker_t * unpacker,
-        qp_obj_t * qp_series_name,
+        qp_obj_t * qp_obj,
         siridb_pcache_t ** pcache);
+static int INSERT_local_pcache(
+        siridb_t * siridb,
+        siridb_series_t * series,
+        siridb_pcache_t * pcache);
+static int8_t INSERT_local_work(siridb_insert_local_t * ilocal);
+static int8_t INSERT_local_work_batch(siridb_insert_local_t * ilocal, int test);
 static int INSERT_local_work_test(
         siridb_t * siridb,
         qp_unpacker_t * unpacker,
         qp_obj_t * qp_series_name,
         siridb_pcache_t ** pcache,
         siridb_forward_t ** forward);
+static int INSERT_local_jobs_append(
+        siridb_insert_local_t * ilocal,
+        siridb_series_t * series,
+        char * pt,
+        siridb_pcache_t * pcache);
+static void INSERT_local_jobs_queue(uv_async_t * handle);
+static void INSERT_local_jobs_free(siridb_insert_local_t * ilocal);
+static void INSERT_local_job(siridb_insert_job_t * job);
 static void INSERT_local_task(uv_async_t * handle);
 static void INSERT_local_promise_cb(
         sirinet_promise_t * promise,
@@ -72,26 +114,60 @@ static int INSERT_init_local(
         siridb_t * siridb,
         sirinet_promises_t * promises,
         sirinet_pkg_t * pkg,
+        slist_t * batch,
         uint8_t flags);
 
 static ssize_t INSERT_assign_by_map(
         siridb_t * siridb,
         qp_unpacker_t * unpacker,
-        qp_packer_t * packer[]);
+        siridb_insert_t * insert);
 
 static ssize_t INSERT_assign_by_array(
         siridb_t * siridb,
         qp_unpacker_t * unpacker,
-        qp_packer_t * packer[],
+        siridb_insert_t * insert,
         qp_packer_t * tmp_packer);
 
 static int INSERT_read_points(
         siridb_t * siridb,
         qp_packer_t * packer,
+        siridb_pcache_t * pcache,
+        qp_unpacker_t * unpacker,
+        qp_obj_t * qp_obj,
+        ssize_t * count);
+
+static int INSERT_batch_read(
+        siridb_t * siridb,
+        siridb_insert_t * insert,
+        const char * name,
+        size_t len,
         qp_unpacker_t * unpacker,
         qp_obj_t * qp_obj,
         ssize_t * count);
 
+static siridb_insert_batch_t * INSERT_batch_new(
+        siridb_insert_t * insert,
+        const char * name,
+        size_t len,
+        siridb_pcache_t * pcache);
+
+static void INSERT_batch_free(slist_t * batch);
+
+static int INSERT_bulk_series(
+        siridb_t * siridb,
+        siridb_insert_t * insert,
+        const char * name,
+        uint16_t len,
+        points_tp tp,
+        const char * data,
+        uint32_t count);
+
+#define INSERT_BULK_INT 0
+#define INSERT_BULK_DOUBLE 1
+
+#define INSERT_BULK_LEFT(unpacker) \
+    ((size_t) ((unpacker)->end - (unpacker)->pt))
+
 
 
 /*
@@ -101,6 +177,8 @@ const char * siridb_insert_err_msg(siridb_insert_err_t err)
 {
     switch (err)
     {
+    case ERR_INVALID_BULK:
+        return  "Invalid bulk insert package.";
     case ERR_EXPECTING_ARRAY:
         return  "Expecting an array with points.";
     case ERR_EXPECTING_SERIES_NAME:
@@ -130,7 +208,8 @@ const char * siridb_insert_err_msg(siridb_insert_err_t err)
 }
 
 /*
- * Destroy insert.
+ * Destroy insert. The client, if any, must still be valid since the insert
+ * queue of the client is updated.
  */
 void siridb_insert_free(siridb_insert_t * insert)
 {
@@ -143,6 +222,39 @@ void siridb_insert_free(siridb_insert_t * insert)
         }
     }
 
+    if (insert->batch != NULL)
+    {
+        INSERT_batch_free(insert->batch);
+    }
+
+    if (insert->merged != NULL)
+    {
+        siridb_insert_t * merged;
+        uv_stream_t * client;
+
+        for (size_t i = 0; i < insert->merged->len; i++)
+        {
+            merged = (siridb_insert_t *) insert->merged->data[i];
+            client = merged->client;
+
+            siridb_insert_free(merged);
+
+            /* a merged insert holds a reference to its client */
+            if (client != NULL)
+            {
+                sirinet_socket_decref(client);
+            }
+        }
+        slist_free(insert->merged);
+    }
+
+    if (insert->size)
+    {
+        INSERT_dequeue(insert);
+    }
+
+    siridb_decref(insert->siridb);
+
     /* free insert */
     free(insert);
 
@@ -162,7 +274,7 @@ void siridb_insert_free(siridb_insert_t * insert)
 ssize_t siridb_insert_assign_pools(
         siridb_t * siridb,
         qp_unpacker_t * unpacker,
-        qp_packer_t * packer[])
+        siridb_insert_t * insert)
 {
     ssize_t rc = 0;
     qp_types_t tp;
@@ -170,7 +282,7 @@ ssize_t siridb_insert_assign_pools(
 
     if (qp_is_map(tp))
     {
-        rc = INSERT_assign_by_map(siridb, unpacker, packer);
+        rc = INSERT_assign_by_map(siridb, unpacker, insert);
     }
     else if (qp_is_array(tp))
     {
@@ -184,7 +296,7 @@ ssize_t siridb_insert_assign_pools(
             rc = INSERT_assign_by_array(
                     siridb,
                     unpacker,
-                    packer,
+                    insert,
                     tmp_packer);
             qp_packer_free(tmp_packer);
         }
@@ -196,8 +308,202 @@ ssize_t siridb_insert_assign_pools(
     return (siri_err) ? ERR_MEM_ALLOC : rc;
 }
 
+/*
+ * Assign points from a CPROTO_REQ_INSERT_BULK package. The package has a
+ * columnar layout where all numbers are little-endian with a fixed width:
+ *
+ *      uint32      number of series (n)
+ *      n times:    uint16 name length, name (without terminator)
+ *      n times:    uint8 value type (0: integer, 1: float), uint32 count,
+ *                  count x int64 time-stamp, count x int64 or double value
+ *
+ * The unpacker is only used as a cursor so the position can be reported in
+ * case of an error.
+ *
+ * Returns a negative value in case of an error or a value equal to zero or
+ * higher representing the number of points processed.
+ *
+ * This function can set a SIGNAL and ERR_MEM_ALLOC will be the return value
+ * if this is the case.
+ */
+ssize_t siridb_insert_assign_bulk(
+        siridb_t * siridb,
+        qp_unpacker_t * unpacker,
+        siridb_insert_t * insert)
+{
+    const char * names;
+    const char * name;
+    uint32_t n, count;
+    uint16_t len;
+    uint8_t tp;
+    ssize_t total = 0;
+    int rc;
+
+    if (INSERT_BULK_LEFT(unpacker) < sizeof(uint32_t))
+    {
+        return ERR_INVALID_BULK;
+    }
+    memcpy(&n, unpacker->pt, sizeof(uint32_t));
+    n = le32toh(n);
+    unpacker->pt += sizeof(uint32_t);
+
+    /* validate the name table */
+    names = unpacker->pt;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (INSERT_BULK_LEFT(unpacker) < sizeof(uint16_t))
+        {
+            return ERR_INVALID_BULK;
+        }
+        memcpy(&len, unpacker->pt, sizeof(uint16_t));
+        len = le16toh(len);
+        unpacker->pt += sizeof(uint16_t);
+
+        if (    !len ||
+                len >= SIRIDB_SERIES_NAME_LEN_MAX ||
+                INSERT_BULK_LEFT(unpacker) < len)
+        {
+            return ERR_EXPECTING_SERIES_NAME;
+        }
+        unpacker->pt += len;
+    }
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        memcpy(&len, names, sizeof(uint16_t));
+        len = le16toh(len);
+        name = names + sizeof(uint16_t);
+        names = name + len;
+
+        if (INSERT_BULK_LEFT(unpacker) < sizeof(uint8_t) + sizeof(uint32_t))
+        {
+            return ERR_INVALID_BULK;
+        }
+        tp = (uint8_t) *unpacker->pt;
+        memcpy(&count, unpacker->pt + sizeof(uint8_t), sizeof(uint32_t));
+        count = le32toh(count);
+        unpacker->pt += sizeof(uint8_t) + sizeof(uint32_t);
+
+        if (tp != INSERT_BULK_INT && tp != INSERT_BULK_DOUBLE)
+        {
+            return ERR_UNSUPPORTED_VALUE;
+        }
+
+        if (!count)
+        {
+            return ERR_EXPECTING_AT_LEAST_ONE_POINT;
+        }
+
+        if (INSERT_BULK_LEFT(unpacker) / (2 * sizeof(int64_t)) < count)
+        {
+            return ERR_INVALID_BULK;
+        }
+
+        if ((rc = INSERT_bulk_series(
+                siridb,
+                insert,
+                name,
+                len,
+                (tp == INSERT_BULK_INT) ? TP_INT : TP_DOUBLE,
+                unpacker->pt,
+                count)))
+        {
+            return rc;
+        }
+
+        unpacker->pt += (size_t) count * 2 * sizeof(int64_t);
+        total += count;
+    }
+
+    if (unpacker->pt != unpacker->end)
+    {
+        return ERR_INVALID_BULK;
+    }
+
+    return (siri_err) ? ERR_MEM_ALLOC : total;
+}
+
+/*
+ * Assign points for one series from a pcache. This is used when points are
+ * not received as a package, for example by the line protocol listeners.
+ * The pcache is always consumed; it is either handed to a batch for the
+ * local pool or packed and destroyed.
+ *
+ * Returns 0 if successful or ERR_MEM_ALLOC and a signal is raised in case
+ * of an error.
+ */
+int siridb_insert_assign_pcache(
+        siridb_t * siridb,
+        siridb_insert_t * insert,
+        const char * name,
+        size_t len,
+        siridb_pcache_t * pcache)
+{
+    siridb_insert_batch_t * batch = NULL;
+    qp_packer_t * packer;
+    siridb_point_t * point;
+    qp_obj_t qp_name;
+    uint16_t pool;
+
+    qp_name.tp = QP_RAW;
+    qp_name.len = len;
+    qp_name.via.raw = (char *) name;
+
+    pool = INSERT_get_pool(siridb, &qp_name);
+
+    if (pool == siridb->server->pool && insert->batch != NULL)
+    {
+        if (    siridb_points_sort((siridb_points_t *) pcache) ||
+                (batch = INSERT_batch_new(insert, name, len, pcache)) == NULL)
+        {
+            siridb_pcache_free(pcache);
+            return ERR_MEM_ALLOC;  /* signal is raised */
+        }
+
+        packer = (siridb->replica != NULL) ?
+                insert->packer[siridb->server->pool] : NULL;
+    }
+    else
+    {
+        packer = insert->packer[pool];
+    }
+
+    if (packer != NULL)
+    {
+        qp_add_raw_term(packer, name, len);
+        qp_add_type(packer, QP_ARRAY_OPEN);
+
+        for (size_t i = 0; i < pcache->len; i++)
+        {
+            point = pcache->data + i;
+            qp_add_type(packer, QP_ARRAY2);
+            qp_add_int64(packer, (int64_t) point->ts);
+
+            if (pcache->tp == TP_INT)
+            {
+                qp_add_int64(packer, point->val.int64);
+            }
+            else
+            {
+                qp_add_double(packer, point->val.real);
+            }
+        }
+
+        qp_add_type(packer, QP_ARRAY_CLOSE);
+    }
+
+    if (batch == NULL)
+    {
+        siridb_pcache_free(pcache);
+    }
+
+    return (siri_err) ? ERR_MEM_ALLOC : 0;
+}
+
 /*
  * Returns NULL and raises a SIGNAL in case an error has occurred.
+ *
+ * The client may be NULL in which case the result is only logged.
  */
 siridb_insert_t * siridb_insert_new(
         siridb_t * siridb,
@@ -222,10 +528,27 @@ siridb_insert_t * siridb_insert_new(
 
         /* n-points will be set later to the correct value */
         insert->npoints = 0;
+        insert->size = 0;
 
         /* save PID and client so we can respond to the client */
         insert->pid = pid;
         insert->client = client;
+        insert->siridb = siridb;
+        insert->merged = NULL;
+        siridb_incref(siridb);
+
+        /*
+         * Points for the local pool are read in a batch, except when
+         * re-indexing since these points must be tested.
+         */
+        insert->batch = NULL;
+        if (    (~insert->flags & INSERT_FLAG_TEST) &&
+                (insert->batch = slist_new(SLIST_DEFAULT_SIZE)) == NULL)
+        {
+            siridb_decref(siridb);
+            free(insert);
+            return NULL;  /* a signal is raised */
+        }
 
         /*
          * we keep the packer size because the number of pools might change and
@@ -260,26 +583,67 @@ siridb_insert_t * siridb_insert_new(
  */
 int siridb_insert_points_to_pools(siridb_insert_t * insert, size_t npoints)
 {
-    uv_async_t * handle = (uv_async_t *) malloc(sizeof(uv_async_t));
-    if (handle == NULL)
+    /* bind the number of points to insert object */
+    insert->npoints= npoints;
+
+    if (siri.cfg->insert_coalesce_window)
     {
-        ERR_ALLOC
-        return -1;
+        return INSERT_coalesce(insert);
     }
 
-    /* bind the number of points to insert object */
-    insert->npoints= npoints;
+    if (INSERT_async(insert))
+    {
+        return -1;  /* signal is raised */
+    }
 
     /* increment the client reference counter */
-    sirinet_socket_incref(insert->client);
-
-    uv_async_init(siri.loop, handle, INSERT_points_to_pools);
-    handle->data = (void *) insert;
+    if (insert->client != NULL)
+    {
+        sirinet_socket_incref(insert->client);
+    }
 
-    uv_async_send(handle);
     return 0;
 }
 
+/*
+ * Add an insert with a package of 'size' bytes to the insert queue of the
+ * database and the client. Reading from the client is stopped when the
+ * client reaches 'max_insert_queue_client' and is started again as soon as
+ * enough of its inserts are finished. An insert without a client is only
+ * added to the queue of the database. The insert is removed from the queue
+ * when the insert is destroyed.
+ */
+void siridb_insert_enqueue(siridb_insert_t * insert, size_t size)
+{
+#ifdef DEBUG
+    assert (insert->size == 0 && size);
+#endif
+    sirinet_socket_t * ssocket;
+    size_t limit = (size_t) siri.cfg->max_insert_queue_client * 1024;
+
+    insert->size = size;
+    insert->siridb->insert_queue++;
+    insert->siridb->insert_queue_size += size;
+
+    if (insert->client == NULL)
+    {
+        return;
+    }
+
+    ssocket = (sirinet_socket_t *) insert->client->data;
+    ssocket->insert_size += size;
+
+    if (limit && !ssocket->paused && ssocket->insert_size >= limit)
+    {
+        log_debug(
+                "Client has %zu bytes in the insert queue, "
+                "stop reading until inserts are finished",
+                ssocket->insert_size);
+        uv_read_stop(insert->client);
+        ssocket->paused = 1;
+    }
+}
+
 int insert_init_backend_local(
         siridb_t * siridb,
         uv_stream_t * client,
@@ -320,6 +684,10 @@ int insert_init_backend_local(
     ilocal->status = INSERT_LOCAL_CANCELLED;
     ilocal->forward = NULL;
     ilocal->pcache = NULL;
+    ilocal->pending = 0;
+    ilocal->jobs = NULL;
+    ilocal->batch = NULL;
+    ilocal->next = 0;
 
     promise->pkg = sirinet_pkg_dup(pkg);
     if (promise->pkg == NULL)
@@ -330,6 +698,7 @@ int insert_init_backend_local(
         ERR_ALLOC
         return -1;
     }
+    uv_mutex_init(&ilocal->mutex);
     qp_unpacker_init(&ilocal->unpacker, promise->pkg->data, promise->pkg->len);
 
     sirinet_socket_incref(client);
@@ -349,8 +718,11 @@ int insert_init_backend_local(
     siridb->active_tasks++;
     siridb->insert_tasks++;
 
+    /* this package is the last one which is written to the fifo buffer */
+    ilocal->lsn = (siridb_wal_enabled(siridb)) ? siridb->fifo->lsn : 0;
+
     uv_async_init(siri.loop, handle, INSERT_local_task);
-    uv_async_send(handle);
+    siridb_wal_insert_start(siridb, handle);
 
     return 0;
 }
@@ -367,74 +739,48 @@ static void INSERT_on_response(slist_t * promises, uv_async_t * handle)
         sirinet_pkg_t * pkg;
         sirinet_promise_t * promise;
         siridb_insert_t * insert = (siridb_insert_t *) handle->data;
-        siridb_t * siridb =
-                ((sirinet_socket_t *) insert->client->data)->siridb;
-
+        siridb_t * siridb = insert->siridb;
+        cproto_server_t tp = CPROTO_RES_INSERT;
         char msg[MAX_INSERT_MSG];
 
-        /* the packer size is big enough to hold MAX_INSERT_MSG + some overhead
-         * for creating the QPack message */
-        qp_packer_t * packer = sirinet_packer_new(256);
-
-        if (packer != NULL)
+        for (size_t i = 0; i < promises->len; i++)
         {
-            cproto_server_t tp = CPROTO_RES_INSERT;
-
-            for (size_t i = 0; i < promises->len; i++)
+            promise = promises->data[i];
+            if (siri_err || promise == NULL)
             {
-                promise = promises->data[i];
-                if (siri_err || promise == NULL)
-                {
-                    snprintf(msg,
-                            MAX_INSERT_MSG,
-                            "Critical error occurred on '%s'",
-                            siridb->server->name);
-                    tp = CPROTO_ERR_INSERT;
-                    continue;
-                }
-                pkg = (sirinet_pkg_t *) promise->data;
-
-                if (pkg == NULL || pkg->tp != BPROTO_ACK_INSERT)
-                {
-                    snprintf(msg,
-                            MAX_INSERT_MSG,
-                            "Error occurred while sending points to at "
-                            "least '%s'",
-                            promise->server->name);
-                    tp = CPROTO_ERR_INSERT;
-                }
-
-                /* make sure we free the promise and data */
-                free(promise->data);
-                sirinet_promise_decref(promise);
+                snprintf(msg,
+                        MAX_INSERT_MSG,
+                        "Critical error occurred on '%s'",
+                        siridb->server->name);
+                tp = CPROTO_ERR_INSERT;
+                continue;
             }
+            pkg = (sirinet_pkg_t *) promise->data;
 
-            /* this will fit for sure */
-            qp_add_type(packer, QP_MAP_OPEN);
-
-            if (tp == CPROTO_ERR_INSERT)
-            {
-                qp_add_raw(packer, "error_msg", 9);
-            }
-            else
+            if (pkg == NULL || pkg->tp != BPROTO_ACK_INSERT)
             {
-                qp_add_raw(packer, "success_msg", 11);
                 snprintf(msg,
                         MAX_INSERT_MSG,
-                        "Successfully inserted %zd point(s).",
-                        insert->npoints);
-                log_info(msg);
-                siridb->received_points += insert->npoints;
+                        "Error occurred while sending points to at "
+                        "least '%s'",
+                        promise->server->name);
+                tp = CPROTO_ERR_INSERT;
             }
 
-            qp_add_string(packer, msg);
+            /* make sure we free the promise and data */
+            free(promise->data);
+            sirinet_promise_decref(promise);
+        }
 
-            sirinet_pkg_t * response_pkg = sirinet_packer2pkg(
-                    packer,
-                    insert->pid,
-                    tp);
+        INSERT_respond(insert, tp, msg);
 
-            sirinet_pkg_send((uv_stream_t *) insert->client, response_pkg);
+        /* coalesced inserts share the result */
+        if (insert->merged != NULL)
+        {
+            for (size_t i = 0; i < insert->merged->len; i++)
+            {
+                INSERT_respond(insert->merged->data[i], tp, msg);
+            }
         }
     }
 
@@ -444,6 +790,17 @@ static void INSERT_on_response(slist_t * promises, uv_async_t * handle)
 static void INSERT_local_free_cb(uv_async_t * handle)
 {
     siridb_insert_local_t * ilocal = (siridb_insert_local_t *) handle->data;
+    siridb_t * siridb = ilocal->siridb;
+
+    if (ilocal->jobs != NULL)
+    {
+        INSERT_local_jobs_free(ilocal);
+    }
+
+    if (ilocal->batch != NULL)
+    {
+        INSERT_batch_free(ilocal->batch);
+    }
 
     /* this destroys the pkg and unpacker */
     free(ilocal->promise->pkg);
@@ -476,36 +833,137 @@ static void INSERT_local_free_cb(uv_async_t * handle)
     {
         siridb_pcache_free(ilocal->pcache);
     }
+    uv_mutex_destroy(&ilocal->mutex);
     free(ilocal);
     free(handle);
+
+    siridb_wal_insert_done(siridb);
 }
 
 /*
- * Returns insert->status
+ * Add points from the unpacker to a series. This is used to replay the
+ * write-ahead log, see INSERT_local_points() for details.
  */
-static int8_t INSERT_local_work(
+int siridb_insert_local_points(
         siridb_t * siridb,
+        siridb_series_t * series,
         qp_unpacker_t * unpacker,
-        qp_obj_t * qp_series_name,
+        qp_obj_t * qp_obj,
+        siridb_pcache_t ** pcache)
+{
+    return INSERT_local_points(siridb, series, unpacker, qp_obj, pcache);
+}
+
+/*
+ * Add points from the unpacker to a series. The unpacker must be at the
+ * array with points for the series and the object following the points is
+ * read into 'qp_obj'. (QP_ARRAY_CLOSE or the next series name)
+ *
+ * The series stripe must be locked.
+ *
+ * Returns the number of points or -1 and a SIGNAL is raised in case of an
+ * error.
+ */
+static int INSERT_local_points(
+        siridb_t * siridb,
+        siridb_series_t * series,
+        qp_unpacker_t * unpacker,
+        qp_obj_t * qp_obj,
         siridb_pcache_t ** pcache)
 {
-    qp_types_t tp;
-    siridb_series_t ** series;
     qp_obj_t qp_series_ts;
     qp_obj_t qp_series_val;
     uint64_t * ts;
+    int n = 1;
+
+    qp_next(unpacker, NULL); // array open
+    qp_next(unpacker, NULL); // first point array2
+    qp_next(unpacker, &qp_series_ts); // first ts
+    qp_next(unpacker, &qp_series_val); // first val
+
+    ts = (uint64_t *) &qp_series_ts.via.int64;
+    SERIES_UPDATE_TS(series)
+
+    if (siridb_series_add_point(
+            siridb,
+            series,
+            ts,
+            &qp_series_val.via))
+    {
+        return -1;  /* signal is raised */
+    }
+
+    if (qp_next(unpacker, qp_obj) == QP_ARRAY2)
+    {
+        if (*pcache == NULL)
+        {
+            *pcache = siridb_pcache_new(series->tp);
+            if (*pcache == NULL)
+            {
+                return -1;  /* signal is raised */
+            }
+        }
+        else
+        {
+            (*pcache)->tp = series->tp;
+            (*pcache)->len = 0;
+        }
+
+        do
+        {
+            qp_next(unpacker, &qp_series_ts); // ts
+            qp_next(unpacker, &qp_series_val); // val
+
+            ts = (uint64_t *) &qp_series_ts.via.int64;
+            SERIES_UPDATE_TS(series)
+
+            if (siridb_pcache_append_point(
+                    *pcache,
+                    ts,
+                    &qp_series_val.via))
+            {
+                return -1;  /* signal is raised */
+            }
+
+            n++;
+        }
+        while (qp_next(unpacker, qp_obj) == QP_ARRAY2);
+
+        if (siridb_points_sort((siridb_points_t *) *pcache) ||
+            siridb_series_add_pcache(
+                siridb,
+                series,
+                *pcache))
+        {
+            return -1;  /* signal is raised */
+        }
+    }
+
+    return n;
+}
+
+/*
+ * Read series from the package and add each series with the position of
+ * its points to the job for the series stripe. Series are created if they
+ * do not exist. The points are added later by the worker threads.
+ *
+ * Returns insert->status
+ */
+static int8_t INSERT_local_work(siridb_insert_local_t * ilocal)
+{
+    siridb_t * siridb = ilocal->siridb;
+    qp_unpacker_t * unpacker = &ilocal->unpacker;
+    qp_obj_t * qp_series_name = &ilocal->qp_series_name;
+    siridb_series_t ** series;
+    qp_obj_t qp_series_val;
+    char * pt;
     int n = INSERT_AT_ONCE;
 
-    /*
-     * we check for siri_err because siridb_series_add_point()
-     * should never be called twice on the same series after an
-     * error has occurred.
-     */
     while ( !siri_err &&
             qp_is_raw_term(qp_series_name) &&
             (n -= WEIGHT_SERIES) > 0)
     {
-        series = (siridb_series_t **) ct_get_sure(
+        series = (siridb_series_t **) art_get_sure(
                 siridb->series,
                 qp_series_name->via.raw);
 
@@ -517,13 +975,19 @@ static int8_t INSERT_local_work(
             return INSERT_LOCAL_ERROR;  /* signal is raised */
         }
 
-        qp_next(unpacker, NULL); // array open
-        qp_next(unpacker, NULL); // first point array2
-        qp_next(unpacker, &qp_series_ts); // first ts
-        qp_next(unpacker, &qp_series_val); // first val
+        /* save pointer position, the points are read by a worker thread */
+        pt = unpacker->pt;
 
-        if (ct_is_empty(*series))
+        if (art_is_empty(*series))
         {
+            qp_next(unpacker, NULL); // array open
+            qp_next(unpacker, NULL); // first point array2
+            qp_next(unpacker, NULL); // first ts
+            qp_next(unpacker, &qp_series_val); // first val
+
+            /* restore pointer position */
+            unpacker->pt = pt;
+
             *series = siridb_series_new(
                     siridb,
                     qp_series_name->via.raw,
@@ -540,67 +1004,125 @@ static int8_t INSERT_local_work(
             n -= WEIGHT_NEW_SERIES;
         }
 
-        ts = (uint64_t *) &qp_series_ts.via.int64;
-        SERIES_UPDATE_TS((*series))
-
-        if (siridb_series_add_point(
-                siridb,
-                *series,
-                ts,
-                &qp_series_val.via))
+        if (INSERT_local_jobs_append(ilocal, *series, pt, NULL))
         {
             return INSERT_LOCAL_ERROR;  /* signal is raised */
         }
 
-        if ((tp = qp_next(unpacker, qp_series_name)) == QP_ARRAY2)
-        {
-            if (*pcache == NULL)
-            {
-                *pcache = siridb_pcache_new((*series)->tp);
-                if (*pcache == NULL)
-                {
-                    return INSERT_LOCAL_ERROR;  /* signal is raised */
-                }
-            }
-            else
-            {
-                (*pcache)->tp = (*series)->tp;
-                (*pcache)->len = 0;
-            }
+        qp_skip_next(unpacker);  // array
+        qp_next(unpacker, qp_series_name);
+    }
 
-            do
-            {
-                qp_next(unpacker, &qp_series_ts); // ts
-                qp_next(unpacker, &qp_series_val); // val
+    return siri_err;  /* expected to be 0 */
+}
+
+/*
+ * Add points from a batch to a series. Points in a pcache are sorted so only
+ * the first and last point can change the series start and end.
+ *
+ * The series stripe must be locked.
+ *
+ * Returns the number of points or -1 and a SIGNAL is raised in case of an
+ * error.
+ */
+static int INSERT_local_pcache(
+        siridb_t * siridb,
+        siridb_series_t * series,
+        siridb_pcache_t * pcache)
+{
+    int n = (int) pcache->len;
+    uint64_t * ts;
+
+    ts = &pcache->data[0].ts;
+    SERIES_UPDATE_TS(series)
+
+    ts = &pcache->data[pcache->len - 1].ts;
+    SERIES_UPDATE_TS(series)
+
+    pcache->tp = series->tp;
+
+    return (siridb_series_add_pcache(siridb, series, pcache)) ? -1 : n;
+}
+
+/*
+ * Same as INSERT_local_work() but series are read from ilocal->batch. When
+ * 'test' is true, series which do not exist are checked against the new
+ * lookup and forwarded to the correct pool if required.
+ *
+ * Returns insert->status
+ */
+static int8_t INSERT_local_work_batch(siridb_insert_local_t * ilocal, int test)
+{
+    siridb_t * siridb = ilocal->siridb;
+    slist_t * batch = ilocal->batch;
+    siridb_insert_batch_t * b;
+    siridb_series_t ** series;
+    qp_packer_t * packer;
+    uint16_t pool;
+    int n = INSERT_AT_ONCE;
+
+    while ( !siri_err &&
+            ilocal->next < batch->len &&
+            (n -= WEIGHT_SERIES) > 0)
+    {
+        b = (siridb_insert_batch_t *) batch->data[ilocal->next++];
 
-                ts = (uint64_t *) &qp_series_ts.via.int64;
-                SERIES_UPDATE_TS((*series))
+        if (test && art_get(siridb->series, b->name) == NULL)
+        {
+            pool = siridb_lookup_sn(siridb->pools->lookup, b->name);
 
-                if (siridb_pcache_add_point(
-                        *pcache,
-                        ts,
-                        &qp_series_val.via))
+            if (pool != siridb->server->pool)
+            {
+                if (siridb->replica == NULL ||
+                    siridb_series_server_id_by_name(b->name) ==
+                            siridb->server->id)
                 {
-                    return INSERT_LOCAL_ERROR;  /* signal is raised */
-                }
+                    /*
+                     * Forward the series to the correct pool because 'this'
+                     * server is responsible for the series.
+                     */
+                    if (ilocal->forward == NULL)
+                    {
+                        ilocal->forward = siridb_forward_new(siridb);
+                        if (ilocal->forward == NULL)
+                        {
+                            return INSERT_LOCAL_ERROR;  /* signal is raised */
+                        }
+                    }
+                    packer = ilocal->forward->packer[pool];
 
-                n--;
+                    /* testing is not needed since we check for siri_err */
+                    qp_add_raw(packer, b->name, b->len);
+                    siridb_points_pack((siridb_points_t *) b->pcache, packer);
+                }
+                continue;
             }
-            while ((tp = qp_next(unpacker, qp_series_name)) == QP_ARRAY2);
+        }
 
-            if (siridb_series_add_pcache(
-                    siridb,
-                    *series,
-                    *pcache))
+        series = (siridb_series_t **) art_get_sure(siridb->series, b->name);
+
+        if (series == NULL)
+        {
+            log_critical("Error getting or create series: '%s'", b->name);
+            return INSERT_LOCAL_ERROR;  /* signal is raised */
+        }
+
+        if (art_is_empty(*series))
+        {
+            *series = siridb_series_new(siridb, b->name, b->pcache->tp);
+
+            if (*series == NULL)
             {
+                log_critical("Error creating series: '%s'", b->name);
                 return INSERT_LOCAL_ERROR;  /* signal is raised */
             }
-        }
 
+            n -= WEIGHT_NEW_SERIES;
+        }
 
-        if (tp == QP_ARRAY_CLOSE)
+        if (INSERT_local_jobs_append(ilocal, *series, NULL, b->pcache))
         {
-            qp_next(unpacker, qp_series_name);
+            return INSERT_LOCAL_ERROR;  /* signal is raised */
         }
     }
 
@@ -617,15 +1139,12 @@ static int INSERT_local_work_test(
         siridb_pcache_t ** pcache,
         siridb_forward_t ** forward)
 {
-    qp_types_t tp;
     siridb_series_t * series;
     uint16_t pool;
-    uint64_t * ts;
     const char * series_name;
     char * pt;
-    qp_obj_t qp_series_ts;
     qp_obj_t qp_series_val;
-    int n = INSERT_AT_ONCE;
+    int rc, n = INSERT_AT_ONCE;
 
     /*
      * we check for siri_err because siridb_series_add_point()
@@ -637,7 +1156,7 @@ static int INSERT_local_work_test(
             (n -= WEIGHT_SERIES) > 0)
     {
         series_name = qp_series_name->via.raw;
-        series = (siridb_series_t *) ct_get(siridb->series, series_name);
+        series = (siridb_series_t *) art_get(siridb->series, series_name);
         if (series == NULL)
         {
             /* the series does not exist so check what to do... */
@@ -660,13 +1179,19 @@ static int INSERT_local_work_test(
                 /* restore pointer position */
                 unpacker->pt = pt;
 
+                uv_mutex_lock(&siridb->series_mutex);
+
                 series = siridb_series_new(
                         siridb,
                         series_name,
                         SIRIDB_QP_MAP2_TP(qp_series_val.tp));
 
-                if (series == NULL ||
-                    ct_add(siridb->series, series->name, series))
+                rc = (  series == NULL ||
+                        art_add(siridb->series, series->name, series));
+
+                uv_mutex_unlock(&siridb->series_mutex);
+
+                if (rc)
                 {
                     log_critical("Error creating series: '%s'", series_name);
                     return INSERT_LOCAL_ERROR;  /* signal is raised */
@@ -710,83 +1235,274 @@ static int INSERT_local_work_test(
             }
         }
 
-        qp_next(unpacker, NULL); // array open
-        qp_next(unpacker, NULL); // first point array2
-        qp_next(unpacker, &qp_series_ts); // first ts
-        qp_next(unpacker, &qp_series_val); // first val
-
-        ts = (uint64_t *) &qp_series_ts.via.int64;
-        SERIES_UPDATE_TS(series)
+        uv_mutex_lock(siridb_series_stripe(siridb, series));
 
-        if (siridb_series_add_point(
+        rc = INSERT_local_points(
                 siridb,
                 series,
-                ts,
-                &qp_series_val.via))
+                unpacker,
+                qp_series_name,
+                pcache);
+
+        uv_mutex_unlock(siridb_series_stripe(siridb, series));
+
+        if (rc < 0)
         {
             return INSERT_LOCAL_ERROR;  /* signal is raised */
         }
 
-        if ((tp = qp_next(unpacker, qp_series_name)) == QP_ARRAY2)
+        n -= rc;
+
+        if (qp_series_name->tp == QP_ARRAY_CLOSE)
         {
-            if (*pcache == NULL)
-            {
-                *pcache = siridb_pcache_new(series->tp);
-                if (*pcache == NULL)
-                {
-                    return INSERT_LOCAL_ERROR;  /* signal is raised */
-                }
-            }
-            else
-            {
-                (*pcache)->tp = series->tp;
-                (*pcache)->len = 0;
-            }
+            qp_next(unpacker, qp_series_name);
+        }
+    }
 
-            do
-            {
-                qp_next(unpacker, &qp_series_ts); // ts
-                qp_next(unpacker, &qp_series_val); // val
+    return siri_err;  /* expected to be 0 */
+}
 
-                ts = (uint64_t *) &qp_series_ts.via.int64;
-                SERIES_UPDATE_TS(series)
+/*
+ * Add a series with the position of its points, or a pcache with the points,
+ * to the job for the series stripe. The reference counter for the series is incremented and will be
+ * decremented by INSERT_local_jobs_free().
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+static int INSERT_local_jobs_append(
+        siridb_insert_local_t * ilocal,
+        siridb_series_t * series,
+        char * pt,
+        siridb_pcache_t * pcache)
+{
+    siridb_insert_job_t * job;
 
-                if (siridb_pcache_add_point(
-                        *pcache,
-                        ts,
-                        &qp_series_val.via))
-                {
-                    return INSERT_LOCAL_ERROR;  /* signal is raised */
-                }
+    if (ilocal->jobs == NULL)
+    {
+        ilocal->jobs = (siridb_insert_job_t *) calloc(
+                SIRIDB_SERIES_STRIPES,
+                sizeof(siridb_insert_job_t));
 
-                n--;
-            }
-            while ((tp = qp_next(unpacker, qp_series_name)) == QP_ARRAY2);
+        if (ilocal->jobs == NULL)
+        {
+            ERR_ALLOC
+            return -1;
+        }
+
+        for (uint32_t i = 0; i < SIRIDB_SERIES_STRIPES; i++)
+        {
+            job = ilocal->jobs + i;
+            job->job.cb = (siri_ingest_cb) INSERT_local_job;
+            job->ilocal = ilocal;
+            job->stripe = i;
+            job->status = INSERT_LOCAL_SUCESS;
+        }
+    }
+
+    job = ilocal->jobs + series->id % SIRIDB_SERIES_STRIPES;
+
+    if (job->len == job->size)
+    {
+        size_t size = (job->size) ? job->size * 2 : INSERT_JOB_DEFAULT_SIZE;
+        siridb_insert_item_t * tmp = (siridb_insert_item_t *) realloc(
+                job->items,
+                size * sizeof(siridb_insert_item_t));
+
+        if (tmp == NULL)
+        {
+            ERR_ALLOC
+            return -1;
+        }
+
+        job->items = tmp;
+        job->size = size;
+    }
+
+    job->items[job->len].series = series;
+    job->items[job->len].pt = pt;
+    job->items[job->len].pcache = pcache;
+    job->len++;
+
+    siridb_series_incref(series);
+
+    return 0;
+}
+
+/*
+ * Queue the jobs on the worker threads. All jobs for one stripe are handled
+ * by the same worker thread.
+ */
+static void INSERT_local_jobs_queue(uv_async_t * handle)
+{
+    siridb_insert_local_t * ilocal = (siridb_insert_local_t *) handle->data;
+    siridb_insert_job_t * job;
+
+    ilocal->flags |= INSERT_FLAG_JOBS;
+
+    /* set pending before queueing since a job can finish immediately */
+    for (uint32_t i = 0; i < SIRIDB_SERIES_STRIPES; i++)
+    {
+        ilocal->pending += (ilocal->jobs[i].len != 0);
+    }
+
+    for (uint32_t i = 0; i < SIRIDB_SERIES_STRIPES; i++)
+    {
+        job = ilocal->jobs + i;
+        if (job->len)
+        {
+            job->handle = handle;
+            siri_ingest_queue(job->stripe, &job->job);
+        }
+    }
+}
+
+/*
+ * Decrement the series references and destroy the jobs.
+ * (must be called from the main thread)
+ */
+static void INSERT_local_jobs_free(siridb_insert_local_t * ilocal)
+{
+    siridb_insert_job_t * job;
+
+    for (uint32_t i = 0; i < SIRIDB_SERIES_STRIPES; i++)
+    {
+        job = ilocal->jobs + i;
+
+        for (size_t j = 0; j < job->len; j++)
+        {
+            siridb_series_decref(job->items[j].series);
+        }
+
+        free(job->items);
+    }
+
+    free(ilocal->jobs);
+    ilocal->jobs = NULL;
+}
+
+/*
+ * This function runs in a worker thread.
+ *
+ * All series in a job share the same stripe so the stripe is locked while
+ * points are added. The lock is released after INSERT_AT_ONCE points to give
+ * queries and other jobs a chance to use the stripe.
+ */
+static void INSERT_local_job(siridb_insert_job_t * job)
+{
+    siridb_insert_local_t * ilocal = job->ilocal;
+    siridb_t * siridb = ilocal->siridb;
+    uv_mutex_t * stripe = siridb->series_stripes + job->stripe;
+    siridb_pcache_t * pcache = NULL;
+    siridb_insert_item_t * item;
+    qp_unpacker_t unpacker;
+    qp_obj_t qp_obj;
+    int rc, n = INSERT_AT_ONCE;
+
+    uv_mutex_lock(stripe);
+
+    for (size_t i = 0; i < job->len; i++)
+    {
+        /*
+         * we check for siri_err because siridb_series_add_point()
+         * should never be called twice on the same series after an
+         * error has occurred.
+         */
+        if (siri_err)
+        {
+            job->status = INSERT_LOCAL_ERROR;
+            break;
+        }
+
+        if (n <= 0)
+        {
+            uv_mutex_unlock(stripe);
+            uv_mutex_lock(stripe);
+            n = INSERT_AT_ONCE;
+        }
+
+        item = job->items + i;
+
+        if (item->series->flags & SIRIDB_SERIES_IS_DROPPED)
+        {
+            continue;
+        }
+
+        if (item->pcache != NULL)
+        {
+            rc = INSERT_local_pcache(siridb, item->series, item->pcache);
+        }
+        else
+        {
+            qp_unpacker_init(
+                    &unpacker,
+                    item->pt,
+                    ilocal->unpacker.end - item->pt);
 
-            if (siridb_series_add_pcache(
+            rc = INSERT_local_points(
                     siridb,
-                    series,
-                    *pcache))
-            {
-                return INSERT_LOCAL_ERROR;  /* signal is raised */
-            }
+                    item->series,
+                    &unpacker,
+                    &qp_obj,
+                    &pcache);
         }
 
-        if (tp == QP_ARRAY_CLOSE)
+        if (rc < 0)
         {
-            qp_next(unpacker, qp_series_name);
+            job->status = INSERT_LOCAL_ERROR;  /* signal is raised */
+            break;
         }
+
+        n -= WEIGHT_SERIES + rc;
     }
 
-    return siri_err;  /* expected to be 0 */
+    uv_mutex_unlock(stripe);
+
+    if (pcache != NULL)
+    {
+        siridb_pcache_free(pcache);
+    }
+
+    /* the main thread cannot close the handle while we hold the mutex */
+    uv_mutex_lock(&ilocal->mutex);
+
+    ilocal->pending--;
+    uv_async_send(job->handle);
+
+    uv_mutex_unlock(&ilocal->mutex);
 }
 
 static void INSERT_local_task(uv_async_t * handle)
 {
-
     siridb_insert_local_t * ilocal = (siridb_insert_local_t *) handle->data;
     qp_unpacker_t * unpacker = &ilocal->unpacker;
 
+    if (ilocal->flags & INSERT_FLAG_JOBS)
+    {
+        uint16_t pending;
+
+        uv_mutex_lock(&ilocal->mutex);
+        pending = ilocal->pending;
+        uv_mutex_unlock(&ilocal->mutex);
+
+        if (pending)
+        {
+            return;  /* wait for the remaining jobs */
+        }
+
+        ilocal->status = INSERT_LOCAL_SUCESS;
+
+        for (uint32_t i = 0; i < SIRIDB_SERIES_STRIPES; i++)
+        {
+            if (ilocal->jobs[i].status == INSERT_LOCAL_ERROR)
+            {
+                ilocal->status = INSERT_LOCAL_ERROR;
+            }
+        }
+
+        uv_close((uv_handle_t *) handle, siri_async_close);
+        return;
+    }
+
     /*
      * we check for siri_err because siridb_series_add_point()
      * should never be called twice on the same series after an
@@ -798,16 +1514,24 @@ static void INSERT_local_task(uv_async_t * handle)
         return;
     }
 
-    if (!qp_is_raw_term(&ilocal->qp_series_name))
+    if (!INSERT_LOCAL_HAS_SERIES(ilocal))
     {
-        ilocal->status = INSERT_LOCAL_SUCESS;
+        if (ilocal->jobs != NULL && !siri_err)
+        {
+            /* all series are read, the worker threads add the points */
+            INSERT_local_jobs_queue(handle);
+            return;
+        }
+
+        ilocal->status = (siri_err) ?
+                INSERT_LOCAL_ERROR : INSERT_LOCAL_SUCESS;
         uv_close((uv_handle_t *) handle, siri_async_close);
         return;
     }
 
     siridb_t * siridb = ilocal->siridb;
 
-    if (siridb->buffer_fp == NULL && siridb_buffer_open(siridb))
+    if (siridb->store == NULL && siridb_series_open_store(siridb))
     {
         ERR_FILE
         ilocal->status = INSERT_LOCAL_ERROR;
@@ -815,20 +1539,24 @@ static void INSERT_local_task(uv_async_t * handle)
         return;
     }
 
-    if (siridb->store == NULL && siridb_series_open_store(siridb))
+    int test = (ilocal->flags & INSERT_FLAG_TEST) || (
+            (siridb->flags & SIRIDB_FLAG_REINDEXING) &&
+            (~ilocal->flags & INSERT_FLAG_TESTED));
+
+    if (ilocal->batch != NULL)
     {
-        ERR_FILE
-        ilocal->status = INSERT_LOCAL_ERROR;
-        uv_close((uv_handle_t *) handle, siri_async_close);
-        return;
-    }
+        /* the series_mutex is required for creating series */
+        uv_mutex_lock(&siridb->series_mutex);
 
-    uv_mutex_lock(&siridb->series_mutex);
-    uv_mutex_lock(&siridb->shards_mutex);
+        /* siri_err is raised in case of an error */
+        if (INSERT_local_work_batch(ilocal, test))
+        {
+            ilocal->status = INSERT_LOCAL_ERROR;
+        }
 
-    if ((ilocal->flags & INSERT_FLAG_TEST) || (
-            (siridb->flags & SIRIDB_FLAG_REINDEXING) &&
-            (~ilocal->flags & INSERT_FLAG_TESTED)))
+        uv_mutex_unlock(&siridb->series_mutex);
+    }
+    else if (test)
     {
         /*
          * We can use INSERT_local_work_test even if 'this' server has not set
@@ -846,18 +1574,17 @@ static void INSERT_local_task(uv_async_t * handle)
     }
     else
     {
+        /* the series_mutex is required for creating series */
+        uv_mutex_lock(&siridb->series_mutex);
+
         /* siri_err is raised in case of an error */
-        if (INSERT_local_work(
-                siridb,
-                unpacker,
-                &ilocal->qp_series_name,
-                &ilocal->pcache))
+        if (INSERT_local_work(ilocal))
         {
             ilocal->status = INSERT_LOCAL_ERROR;
         }
+
+        uv_mutex_unlock(&siridb->series_mutex);
     }
-    uv_mutex_unlock(&siridb->series_mutex);
-    uv_mutex_unlock(&siridb->shards_mutex);
 
     uv_async_send(handle);
 }
@@ -907,40 +1634,35 @@ static void INSERT_local_promise_backend_cb(
 }
 
 /*
- * Start async insert task.
+ * Start async insert task. Points are read from either 'pkg' or 'batch',
+ * the other one must be NULL.
  *
- * This function is responsible for calling free on pkg.
+ * This function is responsible for calling free on pkg and batch.
  */
 static int INSERT_init_local(
         siridb_t * siridb,
         sirinet_promises_t * promises,
         sirinet_pkg_t * pkg,
+        slist_t * batch,
         uint8_t flags)
 {
     sirinet_promise_t * promise =
             (sirinet_promise_t *) malloc(sizeof(sirinet_promise_t));
-    if (promise == NULL)
-    {
-        free(pkg);
-        ERR_ALLOC
-        return -1;
-    }
-    siridb_insert_local_t * ilocal =
-            (siridb_insert_local_t *) malloc(sizeof(siridb_insert_local_t));
-    if (ilocal == NULL)
-    {
-        free(pkg);
-        free(promise);
-        ERR_ALLOC
-        return -1;
-    }
+    siridb_insert_local_t * ilocal = NULL;
+    uv_async_t * handle = NULL;
 
-    uv_async_t * handle = (uv_async_t *) malloc(sizeof(uv_async_t));
-    if (handle == NULL)
+    if (    promise == NULL ||
+            (ilocal = (siridb_insert_local_t *) malloc(
+                    sizeof(siridb_insert_local_t))) == NULL ||
+            (handle = (uv_async_t *) malloc(sizeof(uv_async_t))) == NULL)
     {
         free(pkg);
         free(promise);
         free(ilocal);
+        if (batch != NULL)
+        {
+            INSERT_batch_free(batch);
+        }
         ERR_ALLOC
         return -1;
     }
@@ -949,11 +1671,22 @@ static int INSERT_init_local(
     ilocal->ref = 1;
     ilocal->promise = promise;
     ilocal->siridb = siridb;
-    qp_unpacker_init(&ilocal->unpacker, pkg->data, pkg->len);
     ilocal->flags = flags;
     ilocal->status = INSERT_LOCAL_CANCELLED;
     ilocal->forward = NULL;
     ilocal->pcache = NULL;
+    ilocal->pending = 0;
+    ilocal->jobs = NULL;
+    ilocal->batch = batch;
+    ilocal->next = 0;
+    uv_mutex_init(&ilocal->mutex);
+
+    if (pkg != NULL)
+    {
+        qp_unpacker_init(&ilocal->unpacker, pkg->data, pkg->len);
+        qp_next(&ilocal->unpacker, NULL); // map
+        qp_next(&ilocal->unpacker, &ilocal->qp_series_name); // first or end
+    }
 
     promise->pkg = pkg;
     promise->data = promises;
@@ -966,13 +1699,14 @@ static int INSERT_init_local(
 
     handle->data = ilocal;
 
-    qp_next(&ilocal->unpacker, NULL); // map
-    qp_next(&ilocal->unpacker, &ilocal->qp_series_name); // first series or end
-
     siridb->active_tasks++;
     siridb->insert_tasks++;
+
+    /* the package for the replica is written right before this task */
+    ilocal->lsn = (siridb_wal_enabled(siridb)) ? siridb->fifo->lsn : 0;
+
     uv_async_init(siri.loop, handle, INSERT_local_task);
-    uv_async_send(handle);
+    siridb_wal_insert_start(siridb, handle);
 
     return 0;
 }
@@ -988,7 +1722,7 @@ static int INSERT_init_local(
 static void INSERT_points_to_pools(uv_async_t * handle)
 {
     siridb_insert_t * insert = (siridb_insert_t *) handle->data;
-    siridb_t * siridb = ((sirinet_socket_t *) insert->client->data)->siridb;
+    siridb_t * siridb = insert->siridb;
     uint16_t pool = siridb->server->pool;
     sirinet_pkg_t * pkg, * repl_pkg;
     sirinet_promises_t * promises = sirinet_promises_new(
@@ -1046,10 +1780,17 @@ static void INSERT_points_to_pools(uv_async_t * handle)
                 pkg = sirinet_packer2pkg(insert->packer[n], 0, 0);
             }
 
-            if (INSERT_init_local(
+            if (insert->batch != NULL)
+            {
+                /* local points are in the batch, the package was only
+                 * required for the replica */
+                free(pkg);
+            }
+            else if (INSERT_init_local(
                     siridb,
                     promises,
                     pkg,
+                    NULL,
                     insert->flags) == 0)
             {
                 pool_count++;
@@ -1062,13 +1803,13 @@ static void INSERT_points_to_pools(uv_async_t * handle)
                     0,
                     (insert->flags & INSERT_FLAG_TEST) ?
                             BPROTO_INSERT_TEST_POOL : BPROTO_INSERT_POOL);
-            if (siridb_pool_send_pkg(
-                    siridb->pools->pool + n,
+            if (siridb_pipeline_send_pkg(
+                    siridb,
+                    n,
                     pkg,
                     INSERT_TIMEOUT,
                     sirinet_promises_on_response,
-                    promises,
-                    0))
+                    promises))
             {
                 free(pkg);
                 log_error(
@@ -1085,6 +1826,21 @@ static void INSERT_points_to_pools(uv_async_t * handle)
         insert->packer[n] = NULL;
     }
 
+    if (insert->batch != NULL && insert->batch->len)
+    {
+        /* INSERT_init_local() is responsible for the batch */
+        if (INSERT_init_local(
+                siridb,
+                promises,
+                NULL,
+                insert->batch,
+                insert->flags) == 0)
+        {
+            pool_count++;
+        }
+        insert->batch = NULL;
+    }
+
     /* pool_count is always smaller than the initial promises->size */
     promises->promises->size = pool_count;
 
@@ -1108,7 +1864,7 @@ static uint16_t INSERT_get_pool(siridb_t * siridb, qp_obj_t * qp_series_name)
     }
     else
     {
-        if (ct_getn(
+        if (art_getn(
                 siridb->series,
                 qp_series_name->via.raw,
                 qp_series_name->len) != NULL)
@@ -1158,7 +1914,7 @@ static uint16_t INSERT_get_pool(siridb_t * siridb, qp_obj_t * qp_series_name)
 static ssize_t INSERT_assign_by_map(
         siridb_t * siridb,
         qp_unpacker_t * unpacker,
-        qp_packer_t * packer[])
+        siridb_insert_t * insert)
 {
     int tp;  /* use int instead of qp_types_t for negative values */
     uint16_t pool;
@@ -1173,16 +1929,33 @@ static ssize_t INSERT_assign_by_map(
     {
         pool = INSERT_get_pool(siridb, &qp_obj);
 
-        qp_add_raw_term(packer[pool],
-                qp_obj.via.raw,
-                qp_obj.len);
+        if (pool == siridb->server->pool && insert->batch != NULL)
+        {
+            tp = INSERT_batch_read(
+                    siridb,
+                    insert,
+                    qp_obj.via.raw,
+                    qp_obj.len,
+                    unpacker,
+                    &qp_obj,
+                    &count);
+        }
+        else
+        {
+            qp_add_raw_term(insert->packer[pool],
+                    qp_obj.via.raw,
+                    qp_obj.len);
 
-        if ((tp = INSERT_read_points(
-                siridb,
-                packer[pool],
-                unpacker,
-                &qp_obj,
-                &count)) < 0)
+            tp = INSERT_read_points(
+                    siridb,
+                    insert->packer[pool],
+                    NULL,
+                    unpacker,
+                    &qp_obj,
+                    &count);
+        }
+
+        if (tp < 0)
         {
             return tp;
         }
@@ -1206,13 +1979,16 @@ static ssize_t INSERT_assign_by_map(
 static ssize_t INSERT_assign_by_array(
         siridb_t * siridb,
         qp_unpacker_t * unpacker,
-        qp_packer_t * packer[],
+        siridb_insert_t * insert,
         qp_packer_t * tmp_packer)
 {
     int tp;  /* use int instead of qp_types_t for negative values */
     uint16_t pool;
     ssize_t count = 0;
     qp_obj_t qp_obj;
+    const char * name;
+    size_t len;
+    int is_batch;
     tp = qp_next(unpacker, &qp_obj);
 
     while (tp == QP_MAP2)
@@ -1227,6 +2003,7 @@ static ssize_t INSERT_assign_by_array(
             if ((tp = INSERT_read_points(
                     siridb,
                     tmp_packer,
+                    NULL,
                     unpacker,
                     &qp_obj,
                     &count)) < 0 || tp != QP_RAW)
@@ -1245,10 +2022,15 @@ static ssize_t INSERT_assign_by_array(
             }
 
             pool = INSERT_get_pool(siridb, &qp_obj);
+            name = qp_obj.via.raw;
+            len = qp_obj.len;
+            is_batch = (
+                    pool == siridb->server->pool && insert->batch != NULL);
 
-            qp_add_raw_term(packer[pool],
-                    qp_obj.via.raw,
-                    qp_obj.len);
+            if (!is_batch)
+            {
+                qp_add_raw_term(insert->packer[pool], name, len);
+            }
         }
         else
         {
@@ -1257,7 +2039,35 @@ static ssize_t INSERT_assign_by_array(
 
         if (tmp_packer->len)
         {
-            qp_packer_extend(packer[pool], tmp_packer);
+            if (is_batch)
+            {
+                /* points are validated and counted so this cannot fail,
+                 * except for an allocation error */
+                qp_unpacker_t tmp_unpacker;
+                qp_obj_t tmp_obj;
+                ssize_t tmp_count = 0;
+
+                qp_unpacker_init(
+                        &tmp_unpacker,
+                        tmp_packer->buffer,
+                        tmp_packer->len);
+
+                if ((tp = INSERT_batch_read(
+                        siridb,
+                        insert,
+                        name,
+                        len,
+                        &tmp_unpacker,
+                        &tmp_obj,
+                        &tmp_count)) < 0)
+                {
+                    return tp;
+                }
+            }
+            else
+            {
+                qp_packer_extend(insert->packer[pool], tmp_packer);
+            }
             tmp_packer->len = 0;
             tp = qp_next(unpacker, &qp_obj);
         }
@@ -1269,12 +2079,24 @@ static ssize_t INSERT_assign_by_array(
                 return ERR_EXPECTING_NAME_AND_POINTS;
             }
 
-            if ((tp = INSERT_read_points(
-                    siridb,
-                    packer[pool],
-                    unpacker,
-                    &qp_obj,
-                    &count)) < 0)
+            tp = (is_batch) ?
+                    INSERT_batch_read(
+                        siridb,
+                        insert,
+                        name,
+                        len,
+                        unpacker,
+                        &qp_obj,
+                        &count) :
+                    INSERT_read_points(
+                        siridb,
+                        insert->packer[pool],
+                        NULL,
+                        unpacker,
+                        &qp_obj,
+                        &count);
+
+            if (tp < 0)
             {
                 return tp;
             }
@@ -1293,24 +2115,32 @@ static ssize_t INSERT_assign_by_array(
  * Returns a negative value in case of an error or a value equal to zero or
  * higher representing the next qpack type in the unpaker.
  *
+ * Points are packed when 'packer' is not NULL and added to 'pcache' when
+ * 'pcache' is not NULL.
+ *
  * This function can set a SIGNAL when not enough space in the packer can be
  * allocated for the points.
  */
 static int INSERT_read_points(
         siridb_t * siridb,
         qp_packer_t * packer,
+        siridb_pcache_t * pcache,
         qp_unpacker_t * unpacker,
         qp_obj_t * qp_obj,
         ssize_t * count)
 {
     qp_types_t tp;
+    uint64_t ts;
 
     if (!qp_is_array(qp_next(unpacker, NULL)))
     {
         return ERR_EXPECTING_ARRAY;
     }
 
-    qp_add_type(packer, QP_ARRAY_OPEN);
+    if (packer != NULL)
+    {
+        qp_add_type(packer, QP_ARRAY_OPEN);
+    }
 
     if ((tp = qp_next(unpacker, NULL)) != QP_ARRAY2)
     {
@@ -1319,8 +2149,6 @@ static int INSERT_read_points(
 
     for (; tp == QP_ARRAY2; (*count)++, tp = qp_next(unpacker, qp_obj))
     {
-        qp_add_type(packer, QP_ARRAY2);
-
         if (qp_next(unpacker, qp_obj) != QP_INT64)
         {
             return ERR_EXPECTING_INTEGER_TS;
@@ -1331,7 +2159,7 @@ static int INSERT_read_points(
             return ERR_TIMESTAMP_OUT_OF_RANGE;
         }
 
-        qp_add_int64(packer, qp_obj->via.int64);
+        ts = (uint64_t) qp_obj->via.int64;
 
         switch (qp_next(unpacker, qp_obj))
         {
@@ -1342,16 +2170,47 @@ static int INSERT_read_points(
 //            break;
 
         case QP_INT64:
-            qp_add_int64(packer, qp_obj->via.int64);
-            break;
-
         case QP_DOUBLE:
-            qp_add_double(packer, qp_obj->via.real);
             break;
 
         default:
             return ERR_UNSUPPORTED_VALUE;
         }
+
+        if (packer != NULL)
+        {
+            qp_add_type(packer, QP_ARRAY2);
+            qp_add_int64(packer, (int64_t) ts);
+
+            if (qp_obj->tp == QP_INT64)
+            {
+                qp_add_int64(packer, qp_obj->via.int64);
+            }
+            else
+            {
+                qp_add_double(packer, qp_obj->via.real);
+            }
+        }
+
+        if (pcache != NULL)
+        {
+            if (!pcache->len)
+            {
+                /* the first value sets the type, like a new series */
+                pcache->tp = SIRIDB_QP_MAP2_TP(qp_obj->tp);
+            }
+
+            /* points are sorted once when all points are read */
+            if (siridb_pcache_append_point(pcache, &ts, &qp_obj->via))
+            {
+                return ERR_MEM_ALLOC;  /* signal is raised */
+            }
+        }
+    }
+
+    if (pcache != NULL && siridb_points_sort((siridb_points_t *) pcache))
+    {
+        return ERR_MEM_ALLOC;  /* signal is raised */
     }
 
     if (tp == QP_ARRAY_CLOSE)
@@ -1359,24 +2218,557 @@ static int INSERT_read_points(
         tp = qp_next(unpacker, qp_obj);
     }
 
-    qp_add_type(packer, QP_ARRAY_CLOSE);
+    if (packer != NULL)
+    {
+        qp_add_type(packer, QP_ARRAY_CLOSE);
+    }
 
     return tp;
 }
 
+/*
+ * Read points for a series in the local pool into a new batch. The points
+ * are packed as well when we have a replica server since the replica still
+ * needs a package.
+ *
+ * Returns a negative value in case of an error or a value equal to zero or
+ * higher representing the next qpack type in the unpaker.
+ *
+ * This function can set a SIGNAL when not enough space can be allocated.
+ */
+static int INSERT_batch_read(
+        siridb_t * siridb,
+        siridb_insert_t * insert,
+        const char * name,
+        size_t len,
+        qp_unpacker_t * unpacker,
+        qp_obj_t * qp_obj,
+        ssize_t * count)
+{
+    qp_packer_t * packer = NULL;
+    siridb_insert_batch_t * batch = INSERT_batch_new(insert, name, len, NULL);
+
+    if (batch == NULL)
+    {
+        return ERR_MEM_ALLOC;  /* signal is raised */
+    }
+
+    if (siridb->replica != NULL)
+    {
+        packer = insert->packer[siridb->server->pool];
+        qp_add_raw_term(packer, name, len);
+    }
+
+    return INSERT_read_points(
+            siridb,
+            packer,
+            batch->pcache,
+            unpacker,
+            qp_obj,
+            count);
+}
+
+/*
+ * Append a new batch for a series to the insert. The batch takes ownership
+ * of 'pcache' when successful, a new and empty pcache is used when 'pcache'
+ * is NULL.
+ *
+ * Returns the batch or NULL and a signal is raised in case of an error.
+ */
+static siridb_insert_batch_t * INSERT_batch_new(
+        siridb_insert_t * insert,
+        const char * name,
+        size_t len,
+        siridb_pcache_t * pcache)
+{
+    siridb_insert_batch_t * batch = (siridb_insert_batch_t *) malloc(
+            sizeof(siridb_insert_batch_t) + len + 1);
+
+    if (batch == NULL)
+    {
+        ERR_ALLOC
+        return NULL;
+    }
+
+    batch->pcache = (pcache != NULL) ? pcache : siridb_pcache_new(TP_INT);
+    if (batch->pcache == NULL)
+    {
+        free(batch);
+        return NULL;  /* signal is raised */
+    }
+
+    memcpy(batch->name, name, len);
+    batch->name[len] = '\0';
+    batch->len = len + 1;
+
+    if (slist_append_safe(&insert->batch, batch))
+    {
+        if (pcache == NULL)
+        {
+            siridb_pcache_free(batch->pcache);
+        }
+        free(batch);
+        return NULL;  /* signal is raised */
+    }
+
+    return batch;
+}
+
+/*
+ * Destroy a list with batches.
+ */
+static void INSERT_batch_free(slist_t * batch)
+{
+    siridb_insert_batch_t * b;
+
+    for (size_t i = 0; i < batch->len; i++)
+    {
+        b = (siridb_insert_batch_t *) batch->data[i];
+        siridb_pcache_free(b->pcache);
+        free(b);
+    }
+
+    slist_free(batch);
+}
+
+/*
+ * Assign the columns of one series in a bulk package. Both columns are read
+ * with memcpy() since they are not aligned within the package and are
+ * converted from little-endian to the byte order of the host. Points for the
+ * local pool are written to a new batch which is allocated for all points at
+ * once (and packed for a replica) while points for other pools are packed
+ * like points from a qpack insert. The batch is only sorted when the
+ * time-stamps are not ascending already.
+ *
+ * Returns 0 if successful or a negative insert error. In case of
+ * ERR_MEM_ALLOC a signal is raised.
+ */
+static int INSERT_bulk_series(
+        siridb_t * siridb,
+        siridb_insert_t * insert,
+        const char * name,
+        uint16_t len,
+        points_tp tp,
+        const char * data,
+        uint32_t count)
+{
+    const char * vals = data + (size_t) count * sizeof(int64_t);
+    siridb_insert_batch_t * batch = NULL;
+    siridb_point_t * point = NULL;
+    qp_packer_t * packer;
+    qp_obj_t qp_name;
+    uint16_t pool;
+    uint64_t u;
+    int64_t ts, prev = INT64_MIN;
+    qp_via_t val;
+    int sorted = 1;
+
+    qp_name.tp = QP_RAW;
+    qp_name.len = len;
+    qp_name.via.raw = (char *) name;
+
+    pool = INSERT_get_pool(siridb, &qp_name);
+
+    if (pool == siridb->server->pool && insert->batch != NULL)
+    {
+        batch = INSERT_batch_new(insert, name, len, NULL);
+        if (batch == NULL)
+        {
+            return ERR_MEM_ALLOC;  /* signal is raised */
+        }
+        batch->pcache->tp = tp;
+
+        if (siridb_pcache_reserve(batch->pcache, count))
+        {
+            return ERR_MEM_ALLOC;  /* signal is raised */
+        }
+        point = batch->pcache->data;
+
+        packer = (siridb->replica != NULL) ?
+                insert->packer[siridb->server->pool] : NULL;
+    }
+    else
+    {
+        packer = insert->packer[pool];
+    }
+
+    if (packer != NULL)
+    {
+        qp_add_raw_term(packer, name, len);
+        qp_add_type(packer, QP_ARRAY_OPEN);
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        memcpy(&u, data + (size_t) i * sizeof(int64_t), sizeof(int64_t));
+        ts = (int64_t) le64toh(u);
+
+        /* a double is read using the bits of an integer */
+        memcpy(&u, vals + (size_t) i * sizeof(int64_t), sizeof(int64_t));
+        val.int64 = (int64_t) le64toh(u);
+
+        if (!siridb_int64_valid_ts(siridb, ts))
+        {
+            return ERR_TIMESTAMP_OUT_OF_RANGE;
+        }
+
+        if (packer != NULL)
+        {
+            qp_add_type(packer, QP_ARRAY2);
+            qp_add_int64(packer, ts);
+
+            if (tp == TP_INT)
+            {
+                qp_add_int64(packer, val.int64);
+            }
+            else
+            {
+                qp_add_double(packer, val.real);
+            }
+        }
+
+        if (point != NULL)
+        {
+            point->ts = (uint64_t) ts;
+            point->val = val;
+            point++;
+
+            if (ts < prev)
+            {
+                sorted = 0;
+            }
+            prev = ts;
+        }
+    }
+
+    if (packer != NULL)
+    {
+        qp_add_type(packer, QP_ARRAY_CLOSE);
+    }
+
+    if (batch != NULL)
+    {
+        batch->pcache->len = count;
+
+        if (!sorted && siridb_points_sort((siridb_points_t *) batch->pcache))
+        {
+            return ERR_MEM_ALLOC;  /* signal is raised */
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Send the result of an insert to the client, or log the result when the
+ * insert has no client.
+ */
+static void INSERT_respond(
+        siridb_insert_t * insert,
+        cproto_server_t tp,
+        const char * err_msg)
+{
+    char msg[MAX_INSERT_MSG];
+
+    if (tp == CPROTO_ERR_INSERT)
+    {
+        if (insert->client == NULL)
+        {
+            log_error("%s", err_msg);
+            return;
+        }
+    }
+    else
+    {
+        snprintf(msg,
+                MAX_INSERT_MSG,
+                "Successfully inserted %zd point(s).",
+                insert->npoints);
+        log_info(msg);
+        insert->siridb->received_points += insert->npoints;
+
+        if (insert->client == NULL)
+        {
+            return;
+        }
+    }
+
+    /* the packer size is big enough to hold MAX_INSERT_MSG + some overhead
+     * for creating the QPack message */
+    qp_packer_t * packer = sirinet_packer_new(256);
+
+    if (packer != NULL)
+    {
+        /* this will fit for sure */
+        qp_add_type(packer, QP_MAP_OPEN);
+
+        if (tp == CPROTO_ERR_INSERT)
+        {
+            qp_add_raw(packer, "error_msg", 9);
+            qp_add_string(packer, err_msg);
+        }
+        else
+        {
+            qp_add_raw(packer, "success_msg", 11);
+            qp_add_string(packer, msg);
+        }
+
+        sirinet_pkg_t * response_pkg = sirinet_packer2pkg(
+                packer,
+                insert->pid,
+                tp);
+
+        sirinet_pkg_send((uv_stream_t *) insert->client, response_pkg);
+    }
+}
+
+/*
+ * Start the async task which sends the points to the pools.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+static int INSERT_async(siridb_insert_t * insert)
+{
+    uv_async_t * handle = (uv_async_t *) malloc(sizeof(uv_async_t));
+    if (handle == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    uv_async_init(siri.loop, handle, INSERT_points_to_pools);
+    handle->data = (void *) insert;
+
+    uv_async_send(handle);
+    return 0;
+}
+
+/*
+ * Add an insert to the coalescing group of the database. A new group is
+ * started when there is no group or when the insert cannot be combined with
+ * the current group. The group is sent when the window has passed or when
+ * enough points are collected.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ * The group is responsible for the insert when 0 is returned.
+ */
+static int INSERT_coalesce(siridb_insert_t * insert)
+{
+    siridb_t * siridb = insert->siridb;
+    siridb_insert_group_t * group = siridb->insert_group;
+
+    if (group != NULL && (
+            group->insert->flags != insert->flags ||
+            group->insert->packer_size != insert->packer_size))
+    {
+        /* for example re-indexing has started or a pool is added */
+        INSERT_group_flush(group);
+        group = NULL;
+    }
+
+    if (group == NULL)
+    {
+        if (insert->npoints >= siri.cfg->insert_coalesce_points)
+        {
+            /* nothing to gain, send this insert right away */
+            if (INSERT_async(insert))
+            {
+                return -1;  /* signal is raised */
+            }
+        }
+        else
+        {
+            group = (siridb_insert_group_t *) malloc(
+                    sizeof(siridb_insert_group_t));
+            if (group == NULL)
+            {
+                ERR_ALLOC
+                return -1;
+            }
+
+            group->insert = insert;
+            group->npoints = insert->npoints;
+
+            uv_timer_init(siri.loop, &group->timer);
+            group->timer.data = group;
+            uv_timer_start(
+                    &group->timer,
+                    INSERT_group_on_timer,
+                    siri.cfg->insert_coalesce_window,
+                    0);
+
+            siridb->insert_group = group;
+        }
+    }
+    else
+    {
+        if (INSERT_merge(group->insert, insert))
+        {
+            return -1;  /* signal is raised */
+        }
+
+        group->npoints += insert->npoints;
+
+        if (group->npoints >= siri.cfg->insert_coalesce_points)
+        {
+            INSERT_group_flush(group);
+        }
+    }
+
+    /* increment the client reference counter */
+    if (insert->client != NULL)
+    {
+        sirinet_socket_incref(insert->client);
+    }
+
+    return 0;
+}
+
+/*
+ * Move the points of 'insert' to 'dest' and keep 'insert' in the merged list
+ * of 'dest' so the client can be informed.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ * In case of an error 'insert' is not changed.
+ */
+static int INSERT_merge(siridb_insert_t * dest, siridb_insert_t * insert)
+{
+    /* skip the package header and QP_MAP_OPEN */
+    const size_t offset = sizeof(sirinet_pkg_t) + 1;
+
+    if (dest->merged == NULL &&
+            (dest->merged = slist_new(SLIST_DEFAULT_SIZE)) == NULL)
+    {
+        return -1;  /* signal is raised */
+    }
+
+    if (slist_append_safe(&dest->merged, insert))
+    {
+        return -1;  /* signal is raised */
+    }
+
+    /*
+     * From here on 'dest' is responsible for 'insert'. An allocation error
+     * raises a signal so the points do not need to be restored.
+     */
+    for (uint16_t n = 0; n < insert->packer_size; n++)
+    {
+        qp_packer_extend_data(
+                dest->packer[n],
+                insert->packer[n]->buffer + offset,
+                insert->packer[n]->len - offset);
+        qp_packer_free(insert->packer[n]);
+        insert->packer[n] = NULL;
+    }
+
+    if (insert->batch != NULL)
+    {
+        for (size_t i = 0; i < insert->batch->len; i++)
+        {
+            if (slist_append_safe(&dest->batch, insert->batch->data[i]))
+            {
+                /* the rest of the batch is destroyed with 'insert' */
+                memmove(insert->batch->data,
+                        insert->batch->data + i,
+                        (insert->batch->len - i) * sizeof(void *));
+                insert->batch->len -= i;
+                return 0;  /* signal is raised */
+            }
+        }
+        slist_free(insert->batch);
+        insert->batch = NULL;
+    }
+
+    return 0;
+}
+
+/*
+ * Send a coalescing group and destroy the group.
+ */
+static void INSERT_group_flush(siridb_insert_group_t * group)
+{
+    siridb_insert_t * insert = group->insert;
+
+    insert->siridb->insert_group = NULL;
+
+    uv_timer_stop(&group->timer);
+    uv_close((uv_handle_t *) &group->timer, (uv_close_cb) free);
+
+    if (INSERT_async(insert))
+    {
+        /* signal is raised */
+        uv_stream_t * client = insert->client;
+
+        siridb_insert_free(insert);
+
+        if (client != NULL)
+        {
+            sirinet_socket_decref(client);
+        }
+    }
+}
+
+static void INSERT_group_on_timer(uv_timer_t * timer)
+{
+    INSERT_group_flush((siridb_insert_group_t *) timer->data);
+}
+
+/*
+ * Remove an insert from the insert queue and start reading from the client
+ * again when the client was stopped and is below the limit.
+ */
+static void INSERT_dequeue(siridb_insert_t * insert)
+{
+    uv_stream_t * client = insert->client;
+    sirinet_socket_t * ssocket;
+
+    insert->siridb->insert_queue--;
+    insert->siridb->insert_queue_size -= insert->size;
+
+    /* line protocol connections might wait for room in the queue */
+    sirinet_lnserver_resume(insert->siridb);
+
+    if (client == NULL)
+    {
+        return;
+    }
+
+    ssocket = (sirinet_socket_t *) client->data;
+    ssocket->insert_size -= insert->size;
+
+    if (    ssocket->paused &&
+            ssocket->insert_size <
+                (size_t) siri.cfg->max_insert_queue_client * 1024 &&
+            !uv_is_closing((uv_handle_t *) client))
+    {
+        log_debug(
+                "Client has %zu bytes in the insert queue, start reading",
+                ssocket->insert_size);
+        ssocket->paused = 0;
+        uv_read_start(
+                client,
+                sirinet_socket_alloc_buffer,
+                sirinet_socket_on_data);
+    }
+}
+
 /*
  * Used as uv_close_cb.
  */
 static void INSERT_free(uv_handle_t * handle)
 {
     siridb_insert_t * insert = (siridb_insert_t *) handle->data;
-
-    /* decrement the client reference counter */
-    sirinet_socket_decref(insert->client);
+    uv_stream_t * client = insert->client;
 
     /* free insert */
     siridb_insert_free(insert);
 
+    /* decrement the client reference counter */
+    if (client != NULL)
+    {
+        sirinet_socket_decref(client);
+    }
+
     /* free handle */
     free((uv_async_t *) handle);
 
@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 29-07-2016
+ *  - versioned lookup with a wyhash based version, 18-10-2026
  *
  */
 #include <siri/db/lookup.h>
@@ -14,33 +15,59 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* secrets as used by wyhash */
+#define LOOKUP_S0 0x2d358dccaa6c78a5ULL
+#define LOOKUP_S1 0x8bb84b93962eacc9ULL
+#define LOOKUP_S2 0x4b33a62ed433d4a3ULL
+#define LOOKUP_S3 0x4d5a2da51de1aa47ULL
+
+static uint64_t LOOKUP_wyhash(const uint8_t * p, size_t len);
+
 /*
  * Returns a pool id based on a terminated string.
  */
 uint16_t siridb_lookup_sn(siridb_lookup_t * lookup, const char * sn)
 {
-    uint32_t n = 0;
-    for (; *sn; sn++)
+    if (lookup->version == SIRIDB_LOOKUP_V0)
     {
-        n += *sn;
+        uint32_t n = 0;
+        for (; *sn; sn++)
+        {
+            n += *sn;
+        }
+        return lookup->pool[n % SIRIDB_LOOKUP_SZ];
     }
-    return (*lookup)[n % SIRIDB_LOOKUP_SZ];
+
+    return lookup->pool[
+        LOOKUP_wyhash((const uint8_t *) sn, strlen(sn)) % SIRIDB_LOOKUP_SZ];
 }
 
 /*
- * Returns a pool id based on a raw string.
+ * Returns a pool id based on a raw string. The length may include a
+ * terminator character which is then ignored.
  */
 uint16_t siridb_lookup_sn_raw(
         siridb_lookup_t * lookup,
         const char * sn,
         size_t len)
 {
-    uint32_t n = 0;
-    while (len--)
+    if (lookup->version == SIRIDB_LOOKUP_V0)
     {
-        n += sn[len];
+        uint32_t n = 0;
+        while (len--)
+        {
+            n += sn[len];
+        }
+        return lookup->pool[n % SIRIDB_LOOKUP_SZ];
     }
-    return (*lookup)[n % SIRIDB_LOOKUP_SZ];
+
+    if (len && sn[len - 1] == '\0')
+    {
+        len--;
+    }
+
+    return lookup->pool[
+        LOOKUP_wyhash((const uint8_t *) sn, len) % SIRIDB_LOOKUP_SZ];
 }
 
 /*
@@ -48,7 +75,7 @@ uint16_t siridb_lookup_sn_raw(
  *
  * (Algorithm to create pools lookup array.)
  */
-siridb_lookup_t * siridb_lookup_new(uint_fast16_t num_pools)
+siridb_lookup_t * siridb_lookup_new(uint_fast16_t num_pools, uint8_t version)
 {
     siridb_lookup_t * lookup =
             (siridb_lookup_t *) calloc(1, sizeof(siridb_lookup_t));
@@ -62,6 +89,8 @@ siridb_lookup_t * siridb_lookup_new(uint_fast16_t num_pools)
         uint_fast16_t n, i, m;
         uint_fast16_t counters[num_pools - 1];
 
+        lookup->version = version;
+
         for (n = 1, m = 2; n < num_pools; n++, m++)
         {
             for (i = 0; i < n; i++)
@@ -71,9 +100,9 @@ siridb_lookup_t * siridb_lookup_new(uint_fast16_t num_pools)
 
             for (i = 0; i < SIRIDB_LOOKUP_SZ; i++)
             {
-                if (++counters[ (*lookup)[i] ] % m == 0)
+                if (++counters[ lookup->pool[i] ] % m == 0)
                 {
-                    (*lookup)[i] = n;
+                    lookup->pool[i] = n;
                 }
             }
         }
@@ -89,4 +118,108 @@ inline void siridb_lookup_free(siridb_lookup_t * lookup)
     free(lookup);
 }
 
+/*
+ * Read 8, 4 or 3 bytes as a little endian number so the hash is equal on
+ * every platform.
+ */
+static inline uint64_t LOOKUP_r8(const uint8_t * p)
+{
+    return  (uint64_t) p[0] |
+            (uint64_t) p[1] << 8 |
+            (uint64_t) p[2] << 16 |
+            (uint64_t) p[3] << 24 |
+            (uint64_t) p[4] << 32 |
+            (uint64_t) p[5] << 40 |
+            (uint64_t) p[6] << 48 |
+            (uint64_t) p[7] << 56;
+}
+
+static inline uint64_t LOOKUP_r4(const uint8_t * p)
+{
+    return  (uint64_t) p[0] |
+            (uint64_t) p[1] << 8 |
+            (uint64_t) p[2] << 16 |
+            (uint64_t) p[3] << 24;
+}
+
+static inline uint64_t LOOKUP_r3(const uint8_t * p, size_t k)
+{
+    return ((uint64_t) p[0] << 16) | ((uint64_t) p[k >> 1] << 8) | p[k - 1];
+}
+
+static inline uint64_t LOOKUP_mix(uint64_t a, uint64_t b)
+{
+    __uint128_t r = (__uint128_t) a * b;
+    return (uint64_t) r ^ (uint64_t) (r >> 64);
+}
+
+/*
+ * Based on version 4 of wyhash, using seed 0 and the default secret.
+ */
+static uint64_t LOOKUP_wyhash(const uint8_t * p, size_t len)
+{
+    uint64_t seed = LOOKUP_mix(LOOKUP_S0, LOOKUP_S1);
+    uint64_t a, b;
 
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            a = (LOOKUP_r4(p) << 32) | LOOKUP_r4(p + ((len >> 3) << 2));
+            b = (LOOKUP_r4(p + len - 4) << 32) |
+                    LOOKUP_r4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0)
+        {
+            a = LOOKUP_r3(p, len);
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        size_t i = len;
+        if (i > 48)
+        {
+            uint64_t see1 = seed, see2 = seed;
+            do
+            {
+                seed = LOOKUP_mix(
+                        LOOKUP_r8(p) ^ LOOKUP_S1,
+                        LOOKUP_r8(p + 8) ^ seed);
+                see1 = LOOKUP_mix(
+                        LOOKUP_r8(p + 16) ^ LOOKUP_S2,
+                        LOOKUP_r8(p + 24) ^ see1);
+                see2 = LOOKUP_mix(
+                        LOOKUP_r8(p + 32) ^ LOOKUP_S3,
+                        LOOKUP_r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            }
+            while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16)
+        {
+            seed = LOOKUP_mix(
+                    LOOKUP_r8(p) ^ LOOKUP_S1,
+                    LOOKUP_r8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = LOOKUP_r8(p + i - 16);
+        b = LOOKUP_r8(p + i - 8);
+    }
+
+    a ^= LOOKUP_S1;
+    b ^= seed;
+
+    __uint128_t r = (__uint128_t) a * b;
+    a = (uint64_t) r;
+    b = (uint64_t) (r >> 64);
+
+    return LOOKUP_mix(a ^ LOOKUP_S0 ^ len, b ^ LOOKUP_S1);
+}
@@ -7,177 +7,92 @@
  *
  * changes
  *  - initial version, 16-04-2016
+ *  - in-place introselect on a scratch buffer per thread, 18-10-2026
  *
+ * Values are copied to a scratch buffer which is kept for each thread so
+ * the points are not changed and no memory is allocated for each group. The
+ * n-th value is found with quickselect using a median of three pivot. When
+ * too many partitions are needed, the median of medians is used as pivot so
+ * the worst case stays linear.
+ *
+ * A NaN is greater than all other values, so the result does not depend on
+ * the order of the values.
  */
-
-
-#include <siri/db/median.h>
-#include <siri/db/points.h>
-#include <stdbool.h>
 #include <assert.h>
 #include <logger/logger.h>
+#include <siri/db/median.h>
+#include <siri/db/points.h>
+#include <stdlib.h>
+#include <uv.h>
+
+/* ranges with at most this number of values are sorted */
+#define MEDIAN_SORT_SZ 16
+
+/* larger scratch buffers are released after use */
+#define MEDIAN_SCRATCH_KEEP 65536
 
-static int64_t find_n_int64(
-        int64_t * seq,
-        uint64_t size,
-        int64_t * other,
-        uint64_t n);
-
-static double find_n_double(
-        double * seq,
-        uint64_t size,
-        double * other,
-        uint64_t n);
-
-static double find_median_real_int64(
-        int64_t * seq,
-        uint64_t size,
-        int64_t * other,
-        uint64_t n,
-        int64_t a,
-        int64_t b,
-        bool found_a,
-        bool found_b);
-
-static double find_median_real_double(
-        double * seq,
-        uint64_t size,
-        double * other,
-        uint64_t n,
-        double a,
-        double b,
-        bool found_a,
-        bool found_b);
+/* less than, a NaN is greater than all other values and equal to a NaN */
+#define MEDIAN_LT_INT64(a, b) ((a) < (b))
+#define MEDIAN_LT_DOUBLE(a, b) ((a) < (b) || ((b) != (b) && (a) == (a)))
+
+typedef struct median_scratch_s
+{
+    size_t sz;                  /* number of values */
+    void * data;                /* int64_t or double values */
+} median_scratch_t;
 
+static void MEDIAN_init(void);
+static void * MEDIAN_scratch(siridb_points_t * points);
+static void MEDIAN_release(void * data);
+static int64_t MEDIAN_select_int64(int64_t * arr, size_t len, size_t k);
+static double MEDIAN_select_double(double * arr, size_t len, size_t k);
+
+static uv_once_t MEDIAN_once = UV_ONCE_INIT;
+static uv_key_t MEDIAN_key;
+static int MEDIAN_use_key = 0;
+
+/*
+ * Set the int64 or real value of point to the n-th smallest value of the
+ * points. (n starts at 0)
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ */
 int siridb_median_find_n(
         siridb_point_t * point,
         siridb_points_t * points,
         uint64_t n)
 {
 #ifdef DEBUG
-    assert (points->len >= 2);
+    assert (points->len >= 2 && n < points->len);
 #endif
-    int rc = 0;
-    uint64_t i, npivot, size_l, size_r;
+    void * data = MEDIAN_scratch(points);
 
-    size_l = size_r = 0;
-    npivot = points->len / 2;
+    if (data == NULL)
+    {
+        return -1;
+    }
 
     if (points->tp == TP_INT)
     {
-        int64_t pivot, v;
-
-        int64_t * arr_l =
-                (int64_t *) malloc(sizeof(int64_t) * 2 * (points->len - 1));
-
-        if (arr_l == NULL)
-        {
-            log_critical("Memory allocation error occurred.");
-            rc = -1;
-        }
-        else
-        {
-            int64_t * arr_r = arr_l + points->len - 1;
-            int64_t * equal = arr_l;
-            uint64_t * equal_size = &size_l;
-
-            pivot = points->data[npivot].val.int64;
-
-            for (i = 0; i < points->len; i++)
-            {
-                if (i == npivot)
-                {
-                    continue;
-                }
-                v = points->data[i].val.int64;
-                if (v == pivot)
-                {
-                    equal[(*equal_size)++] = v;
-                    if (equal == arr_l)
-                    {
-                        equal = arr_r;
-                        equal_size = &size_r;
-                    }
-                    else
-                    {
-                        equal = arr_l;
-                        equal_size = &size_l;
-                    }
-                }
-                else if (v > pivot)
-                {
-                    arr_r[size_r++] = v;
-                }
-                else
-                {
-                    arr_l[size_l++] = v;
-                }
-            }
-            point->val.int64 = (size_l == n) ? pivot : ((size_l > n) ?
-                    find_n_int64(arr_l, size_l, arr_r, n) :
-                    find_n_int64(arr_r, size_r, arr_l, n - size_l - 1));
-        }
-        free(arr_l);
+        point->val.int64 = MEDIAN_select_int64(data, points->len, n);
     }
     else
     {
-        double pivot, v;
-
-        double * arr_l =
-                (double *) malloc(sizeof(double) * 2 * (points->len - 1));
-
-        if (arr_l == NULL)
-        {
-            log_critical("Memory allocation error occurred.");
-            rc = -1;
-        }
-        else
-        {
-            double * arr_r = arr_l + points->len - 1;
-            double * equal = arr_l;
-            uint64_t * equal_size = &size_l;
+        point->val.real = MEDIAN_select_double(data, points->len, n);
+    }
 
-            pivot = points->data[npivot].val.real;
-            for (i = 0; i < points->len; i++)
-            {
-                if (i == npivot)
-                {
-                    continue;
-                }
-                v = points->data[i].val.real;
-                if (v == pivot)
-                {
-                    equal[(*equal_size)++] = v;
-                    if (equal == arr_l)
-                    {
-                        equal = arr_r;
-                        equal_size = &size_r;
-                    }
-                    else
-                    {
-                        equal = arr_l;
-                        equal_size = &size_l;
-                    }
-                }
-                else if (v > pivot)
-                {
-                    arr_r[size_r++] = v;
-                }
-                else
-                {
-                    arr_l[size_l++] = v;
-                }
-            }
+    MEDIAN_release(data);
 
-            point->val.real = (size_l == n) ? pivot : (size_l > n) ?
-                    find_n_double(arr_l, size_l, arr_r, n) :
-                    find_n_double(arr_r, size_r, arr_l, n - size_l - 1);
-        }
-        free(arr_l);
-    }
-    return rc;
+    return 0;
 }
 
+/*
+ * Set the real value of point to the mean of the values at position n - 1
+ * and n, where n = len * percentage. Point real is set, even when the points
+ * are integer type.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ */
 int siridb_median_real(
         siridb_point_t * point,
         siridb_points_t * points,
@@ -186,437 +101,267 @@ int siridb_median_real(
 #ifdef DEBUG
     assert (points->len >= 2);
 #endif
-    int rc = 0;
-    uint64_t i, npivot, size_l, size_r, n;
-    bool found_a, found_b;
+    size_t n = points->len * percentage;
+    void * data;
 
-    n = points->len * percentage;
+#ifdef DEBUG
+    assert (n >= 1 && n < points->len);
+#endif
 
-    size_l = size_r = 0;
-    found_a = found_b = false;
-    npivot = points->len / 2;
+    data = MEDIAN_scratch(points);
 
-    if (points->tp == TP_INT)
+    if (data == NULL)
     {
-        int64_t pivot, v, a, b;
+        return -1;
+    }
 
-        int64_t * arr_l =
-                (int64_t *) malloc(sizeof(int64_t) * 2 * (points->len - 1));
+    /*
+     * After selecting n - 1, all values after position n - 1 are greater or
+     * equal so value n is the smallest of them.
+     */
+    if (points->tp == TP_INT)
+    {
+        int64_t * arr = (int64_t *) data;
+        int64_t a = MEDIAN_select_int64(arr, points->len, n - 1);
+        int64_t b = arr[n];
 
-        if (arr_l == NULL)
+        for (size_t i = n + 1; i < points->len; i++)
         {
-            log_critical("Memory allocation error occurred.");
-            rc = -1;
-        }
-        else
-        {
-            int64_t * arr_r = arr_l + points->len - 1;
-            int64_t * equal = arr_l;
-            uint64_t * equal_size = &size_l;
-
-            a = b = 0;
-            pivot = points->data[npivot].val.int64;
-            for (i = 0; i < points->len; i++)
+            if (arr[i] < b)
             {
-                if (i == npivot)
-                {
-                    continue;
-                }
-                v = points->data[i].val.int64;
-                if (v == pivot)
-                {
-                    equal[(*equal_size)++] = v;
-                    if (equal == arr_l)
-                    {
-                        equal = arr_r;
-                        equal_size = &size_r;
-                    }
-                    else
-                    {
-                        equal = arr_l;
-                        equal_size = &size_l;
-                    }
-                }
-                else if (v > pivot)
-                {
-                    arr_r[size_r++] = v;
-                }
-                else
-                {
-                    arr_l[size_l++] = v;
-                }
+                b = arr[i];
             }
-
-            if (size_l == n - 1)
-            {
-                a = pivot;
-                found_a = true;
-            }
-            else if (size_l == n)
-            {
-                b = pivot;
-                found_b = true;
-            }
-
-            point->val.real = ((!found_b && size_l > n) || size_l > n - 1) ?
-                find_median_real_int64(
-                        arr_l, size_l, arr_r, n, a, b, found_a, found_b) :
-                find_median_real_int64(
-                        arr_r,
-                        size_r,
-                        arr_l,
-                        n - size_l - 1,
-                        a,
-                        b,
-                        found_a,
-                        found_b);
         }
-        free(arr_l);
+        point->val.real = ((double) a + (double) b) / 2.0;
     }
     else
     {
-        double pivot, v, a, b;
-
-        double * arr_l =
-                (double *) malloc(sizeof(double) * 2 * (points->len - 1));
+        double * arr = (double *) data;
+        double a = MEDIAN_select_double(arr, points->len, n - 1);
+        double b = arr[n];
 
-        if (arr_l == NULL)
+        for (size_t i = n + 1; i < points->len; i++)
         {
-            log_critical("Memory allocation error occurred.");
-            rc = -1;
-        }
-        else
-        {
-            double * arr_r = arr_l + points->len - 1;
-            double * equal = arr_l;
-            uint64_t * equal_size = &size_l;
-
-            a = b = 0.0;
-            pivot = points->data[npivot].val.real;
-            for (i = 0; i < points->len; i++)
+            if (MEDIAN_LT_DOUBLE(arr[i], b))
             {
-                if (i == npivot)
-                {
-                    continue;
-                }
-                v = points->data[i].val.real;
-                if (v == pivot)
-                {
-                    equal[(*equal_size)++] = v;
-                    if (equal == arr_l)
-                    {
-                        equal = arr_r;
-                        equal_size = &size_r;
-                    }
-                    else
-                    {
-                        equal = arr_l;
-                        equal_size = &size_l;
-                    }
-                }
-                else if (v > pivot)
-                {
-                    arr_r[size_r++] = v;
-                }
-                else
-                {
-                    arr_l[size_l++] = v;
-                }
+                b = arr[i];
             }
-            if (size_l == n - 1)
-            {
-                a = pivot;
-                found_a = true;
-            }
-            else if (size_l == n)
-            {
-                b = pivot;
-                found_b = true;
-            }
-            point->val.real = ((!found_b && size_l > n) || size_l > n - 1) ?
-                find_median_real_double(
-                        arr_l, size_l, arr_r, n, a, b, found_a, found_b) :
-                find_median_real_double(
-                        arr_r,
-                        size_r,
-                        arr_l,
-                        n - size_l - 1,
-                        a,
-                        b,
-                        found_a,
-                        found_b);
         }
-        free(arr_l);
+        point->val.real = (a + b) / 2.0;
     }
-    return rc;
-}
 
-static double find_median_real_int64(
-        int64_t * seq,
-        uint64_t size,
-        int64_t * other,
-        uint64_t n,
-        int64_t a,
-        int64_t b,
-        bool found_a,
-        bool found_b)
-{
-    uint64_t i, size_l, size_r;
-    size_l = size_r = 0;
-    int64_t pivot, v;
-    int64_t * equal = seq;
-    uint64_t * equal_size = &size_l;
-    uint64_t npivot = size / 2;
-
-    pivot = seq[npivot];
+    MEDIAN_release(data);
 
-    for (i = 0; i < size; i++)
-    {
-        if (i == npivot)
-        {
-            continue;
-        }
-        v = seq[i];
-        if (v == pivot)
-        {
-            equal[(*equal_size)++] = v;
-            if (equal == seq)
-            {
-                equal = other;
-                equal_size = &size_r;
-            }
-            else
-            {
-                equal = seq;
-                equal_size = &size_l;
-            }
-        }
-        else if (v > pivot)
-        {
-            other[size_r++] = v;
-        }
-        else
-        {
-            seq[size_l++] = v;
-        }
-    }
-
-    if (size_l == n - 1)
-    {
-        a = pivot;
-        found_a = true;
-    }
-    else if (size_l == n)
-    {
-        b = pivot;
-        found_b = true;
-    }
-
-    if (found_a && found_b)
-    {
-        return ((double) a + (double) b) / 2.0f;
-    }
+    return 0;
+}
 
-    if ((!found_b && size_l > n) || size_l > n - 1)
+/*
+ * Called once, by the first thread calculating a median.
+ */
+static void MEDIAN_init(void)
+{
+    if (uv_key_create(&MEDIAN_key))
     {
-        return find_median_real_int64(
-                seq, size_l, other, n, a, b, found_a, found_b);
+        log_error("Cannot create median scratch key, a buffer is allocated "
+                "for each median");
+        return;
     }
-
-    return find_median_real_int64(
-            other, size_r, seq, n - size_l - 1, a, b, found_a, found_b);
-
+    MEDIAN_use_key = 1;
 }
 
-static double find_median_real_double(
-        double * seq,
-        uint64_t size,
-        double * other,
-        uint64_t n,
-        double a,
-        double b,
-        bool found_a,
-        bool found_b)
+/*
+ * Returns the scratch buffer of the calling thread filled with the values of
+ * the points, or NULL in case of an allocation error.
+ */
+static void * MEDIAN_scratch(siridb_points_t * points)
 {
-    uint64_t i, size_l, size_r;
-    size_l = size_r = 0;
-    double pivot, v;
-    double * equal = seq;
-    uint64_t * equal_size = &size_l;
-    uint64_t npivot = size / 2;
+    median_scratch_t * scratch = NULL;
+    size_t len = points->len;
+    void * data;
 
-    pivot = seq[npivot];
+    uv_once(&MEDIAN_once, MEDIAN_init);
 
-    for (i = 0; i < size; i++)
+    if (MEDIAN_use_key &&
+        (scratch = (median_scratch_t *) uv_key_get(&MEDIAN_key)) == NULL)
     {
-        if (i == npivot)
-        {
-            continue;
-        }
-        v = seq[i];
-        if (v == pivot)
-        {
-            equal[(*equal_size)++] = v;
-            if (equal == seq)
-            {
-                equal = other;
-                equal_size = &size_r;
-            }
-            else
-            {
-                equal = seq;
-                equal_size = &size_l;
-            }
-        }
-        else if (v > pivot)
+        scratch = (median_scratch_t *) calloc(1, sizeof(median_scratch_t));
+        if (scratch != NULL)
         {
-            other[size_r++] = v;
-        }
-        else
-        {
-            seq[size_l++] = v;
+            uv_key_set(&MEDIAN_key, scratch);
         }
     }
-    if (size_l == n - 1)
+
+    if (scratch == NULL)
     {
-        a = pivot;
-        found_a = true;
+        data = malloc(len * sizeof(int64_t));
     }
-    else if (size_l == n)
+    else if (scratch->sz < len)
     {
-        b = pivot;
-        found_b = true;
+        data = realloc(scratch->data, len * sizeof(int64_t));
+        if (data != NULL)
+        {
+            scratch->data = data;
+            scratch->sz = len;
+        }
     }
-
-    if (found_a && found_b)
+    else
     {
-        return (a + b) / 2.0;
+        data = scratch->data;
     }
 
-    if ((!found_b && size_l > n) || size_l > n - 1)
+    if (data == NULL)
     {
-        return find_median_real_double(
-                seq, size_l, other, n, a, b, found_a, found_b);
+        log_critical("Memory allocation error occurred.");
+        return NULL;
     }
 
-    return find_median_real_double(
-            other, size_r, seq, n - size_l - 1, a, b, found_a, found_b);
-
-}
-
-static int64_t find_n_int64(
-        int64_t * seq,
-        uint64_t size,
-        int64_t * other,
-        uint64_t n)
-{
-    uint64_t i, size_l, size_r;
-    size_l = size_r = 0;
-    int64_t pivot, v;
-    int64_t * equal = seq;
-    uint64_t * equal_size = &size_l;
-    uint64_t npivot = size / 2;
-
-    pivot = seq[npivot];
-
-    for (i = 0; i < size; i++)
+    if (points->tp == TP_INT)
     {
-        if (i == npivot)
+        int64_t * arr = (int64_t *) data;
+        for (size_t i = 0; i < len; i++)
         {
-            continue;
-        }
-        v = seq[i];
-        if (v == pivot)
-        {
-            equal[(*equal_size)++] = v;
-            if (equal == seq)
-            {
-                equal = other;
-                equal_size = &size_r;
-            }
-            else
-            {
-                equal = seq;
-                equal_size = &size_l;
-            }
-        }
-        else if (v > pivot)
-        {
-            other[size_r++] = v;
-        }
-        else
-        {
-            seq[size_l++] = v;
+            arr[i] = points->data[i].val.int64;
         }
     }
-
-    if (size_l == n)
-    {
-        return pivot;
-    }
-
-    if (size_l > n)
+    else
     {
-        return find_n_int64(seq, size_l, other, n);
+        double * arr = (double *) data;
+        for (size_t i = 0; i < len; i++)
+        {
+            arr[i] = points->data[i].val.real;
+        }
     }
 
-    return find_n_int64(other, size_r, seq, n - size_l - 1);
+    return data;
 }
 
-static double find_n_double(
-        double * seq,
-        uint64_t size,
-        double * other,
-        uint64_t n)
+/*
+ * Release a scratch buffer. Small buffers are kept for the next call.
+ */
+static void MEDIAN_release(void * data)
 {
-    uint64_t i, size_l, size_r;
-    size_l = size_r = 0;
-    double pivot, v;
-    double * equal = seq;
-    uint64_t * equal_size = &size_l;
-    uint64_t npivot = size / 2;
+    median_scratch_t * scratch = (MEDIAN_use_key) ?
+            (median_scratch_t *) uv_key_get(&MEDIAN_key) : NULL;
 
-    pivot = seq[npivot];
-
-    for (i = 0; i < size; i++)
-    {
-        if (i == npivot)
-        {
-            continue;
-        }
-        v = seq[i];
-        if (v == pivot)
-        {
-            equal[(*equal_size)++] = v;
-            if (equal == seq)
-            {
-                equal = other;
-                equal_size = &size_r;
-            }
-            else
-            {
-                equal = seq;
-                equal_size = &size_l;
-            }
-        }
-        else if (v > pivot)
-        {
-            other[size_r++] = v;
-        }
-        else
-        {
-            seq[size_l++] = v;
-        }
-    }
-    if (size_l == n)
+    if (scratch == NULL || scratch->data != data)
     {
-        return pivot;
+        /* not kept for this thread */
+        free(data);
     }
-
-    if (size_l > n)
+    else if (scratch->sz > MEDIAN_SCRATCH_KEEP)
     {
-        return find_n_double(seq, size_l, other, n);
+        free(scratch->data);
+        scratch->data = NULL;
+        scratch->sz = 0;
     }
+}
 
-    return find_n_double(other, size_r, seq, n - size_l - 1);
+/*
+ * Introselect for an array of a given type, LT is the less than function
+ * used for both selecting the pivot and partitioning.
+ */
+#define MEDIAN_SELECT(T, NAME, LT)                                          \
+static T NAME(T * arr, size_t len, size_t k);                               \
+                                                                            \
+static void NAME##_sort(T * arr, size_t lo, size_t hi)                      \
+{                                                                           \
+    T v;                                                                    \
+    size_t j;                                                               \
+    for (size_t i = lo + 1; i < hi; i++)                                    \
+    {                                                                       \
+        v = arr[i];                                                         \
+        for (j = i; j > lo && LT(v, arr[j - 1]); j--)                       \
+        {                                                                   \
+            arr[j] = arr[j - 1];                                            \
+        }                                                                   \
+        arr[j] = v;                                                         \
+    }                                                                       \
+}                                                                           \
+                                                                            \
+/* median of medians of five, the medians are moved to the start */         \
+static T NAME##_mom(T * arr, size_t lo, size_t hi)                          \
+{                                                                           \
+    T tmp;                                                                  \
+    size_t m = 0, end;                                                      \
+    for (size_t i = lo; i < hi; i += 5)                                     \
+    {                                                                       \
+        end = (i + 5 < hi) ? i + 5 : hi;                                    \
+        NAME##_sort(arr, i, end);                                           \
+        tmp = arr[lo + m];                                                  \
+        arr[lo + m] = arr[i + (end - i) / 2];                               \
+        arr[i + (end - i) / 2] = tmp;                                       \
+        m++;                                                                \
+    }                                                                       \
+    return NAME(arr + lo, m, m / 2);                                        \
+}                                                                           \
+                                                                            \
+static T NAME(T * arr, size_t len, size_t k)                                \
+{                                                                           \
+    size_t lo = 0, hi = len, lt, gt, i;                                     \
+    unsigned int depth = 0;                                                 \
+    T p, a, b, c, tmp;                                                      \
+                                                                            \
+    /* allow two times the number of partitions for good pivots */          \
+    for (i = len; i > 1; i >>= 1)                                           \
+    {                                                                       \
+        depth += 2;                                                         \
+    }                                                                       \
+                                                                            \
+    while (hi - lo > MEDIAN_SORT_SZ)                                        \
+    {                                                                       \
+        if (depth)                                                          \
+        {                                                                   \
+            depth--;                                                        \
+            a = arr[lo];                                                    \
+            b = arr[lo + (hi - lo) / 2];                                    \
+            c = arr[hi - 1];                                                \
+            p = LT(a, b) ?                                                  \
+                    (LT(b, c) ? b : LT(a, c) ? c : a) :                     \
+                    (LT(a, c) ? a : LT(b, c) ? c : b);                      \
+        }                                                                   \
+        else                                                                \
+        {                                                                   \
+            p = NAME##_mom(arr, lo, hi);                                    \
+        }                                                                   \
+                                                                            \
+        /* [lo, lt) < p, [lt, gt) == p and [gt, hi) > p */                  \
+        for (lt = i = lo, gt = hi; i < gt;)                                 \
+        {                                                                   \
+            if (LT(arr[i], p))                                              \
+            {                                                               \
+                tmp = arr[lt];                                              \
+                arr[lt++] = arr[i];                                         \
+                arr[i++] = tmp;                                             \
+            }                                                               \
+            else if (LT(p, arr[i]))                                         \
+            {                                                               \
+                tmp = arr[--gt];                                            \
+                arr[gt] = arr[i];                                           \
+                arr[i] = tmp;                                               \
+            }                                                               \
+            else                                                            \
+            {                                                               \
+                i++;                                                        \
+            }                                                               \
+        }                                                                   \
+                                                                            \
+        if (k < lt)                                                         \
+        {                                                                   \
+            hi = lt;                                                        \
+        }                                                                   \
+        else if (k >= gt)                                                   \
+        {                                                                   \
+            lo = gt;                                                        \
+        }                                                                   \
+        else                                                                \
+        {                                                                   \
+            return p;                                                       \
+        }                                                                   \
+    }                                                                       \
+                                                                            \
+    NAME##_sort(arr, lo, hi);                                               \
+    return arr[k];                                                          \
 }
+
+MEDIAN_SELECT(int64_t, MEDIAN_select_int64, MEDIAN_LT_INT64)
+MEDIAN_SELECT(double, MEDIAN_select_double, MEDIAN_LT_DOUBLE)
@@ -0,0 +1,795 @@
+/*
+ * partial.c - Partial aggregates which can be merged.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * For each window the number of values is kept together with the sum, min
+ * or max value. Mean keeps a double sum and variance keeps the mean and the
+ * sum of squared deviations, which are combined using the parallel algorithm
+ * of Chan et al. Percentile and approx_median use sketches.
+ *
+ * Windows are grouped the same way as a group_by aggregate so the merged
+ * result is the same as when the aggregate would run on all merged points,
+ * except for rounding differences of double values.
+ *
+ * Packed partials use host byte order and are only exchanged between servers
+ * within one database.
+ */
+#include <assert.h>
+#include <limits.h>
+#include <logger/logger.h>
+#include <siri/db/partial.h>
+#include <siri/db/simd.h>
+#include <siri/err.h>
+#include <siri/grammar/grammar.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PARTIAL_MAGIC 0x31504453     /* "SDP1" */
+
+typedef struct partial_head_s
+{
+    uint32_t magic;
+    uint32_t tp;
+    uint64_t len;
+} partial_head_t;
+
+static int PARTIAL_window(
+        siridb_partials_t * partials,
+        size_t * pos,
+        uint64_t ts);
+static int PARTIAL_add_range(
+        siridb_partials_t * partials,
+        siridb_partial_t * window,
+        siridb_point_t * pts,
+        size_t n,
+        points_tp tp,
+        char * err_msg);
+static int PARTIAL_combine(
+        siridb_partials_t * partials,
+        siridb_partial_t * window,
+        siridb_partial_t * other,
+        points_tp tp,
+        char * err_msg);
+static void PARTIAL_moments(
+        siridb_partial_t * window,
+        uint64_t n,
+        double mean,
+        double m2);
+static void PARTIAL_to_double(siridb_partials_t * partials);
+static const char * PARTIAL_name(uint32_t gid);
+
+/*
+ * Returns 1 when the aggregate can be calculated from partial results or 0
+ * when this is not possible.
+ */
+int siridb_partials_supported(uint32_t gid)
+{
+    switch (gid)
+    {
+    case CLERI_GID_F_APPROX_MEDIAN:
+    case CLERI_GID_F_COUNT:
+    case CLERI_GID_F_MAX:
+    case CLERI_GID_F_MEAN:
+    case CLERI_GID_F_MIN:
+    case CLERI_GID_F_PERCENTILE:
+    case CLERI_GID_F_PVARIANCE:
+    case CLERI_GID_F_SUM:
+    case CLERI_GID_F_VARIANCE:
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Returns new partials for an aggregate with group_by, or NULL in case of an
+ * allocation error. The quantile is only used for percentile and
+ * approx_median.
+ */
+siridb_partials_t * siridb_partials_new(
+        uint32_t gid,
+        uint64_t group_by,
+        double quantile)
+{
+#ifdef DEBUG
+    assert (group_by && siridb_partials_supported(gid));
+#endif
+    siridb_partials_t * partials =
+            (siridb_partials_t *) malloc(sizeof(siridb_partials_t));
+    if (partials == NULL)
+    {
+        ERR_ALLOC
+        return NULL;
+    }
+
+    partials->gid = gid;
+    partials->tp = TP_INT;
+    partials->group_by = group_by;
+    partials->quantile = quantile;
+    partials->sketches = NULL;
+    partials->len = 0;
+    partials->size = 0;
+    partials->windows = NULL;
+
+    if (gid == CLERI_GID_F_PERCENTILE || gid == CLERI_GID_F_APPROX_MEDIAN)
+    {
+        partials->sketches = siridb_sketches_new(group_by);
+        if (partials->sketches == NULL)
+        {
+            free(partials);
+            return NULL;  /* signal is raised */
+        }
+    }
+
+    return partials;
+}
+
+void siridb_partials_free(siridb_partials_t * partials)
+{
+    if (partials->sketches != NULL)
+    {
+        siridb_sketches_free(partials->sketches);
+    }
+    free(partials->windows);
+    free(partials);
+}
+
+/*
+ * Add points to the partial results.
+ *
+ * Returns 0 if successful or -1 in case of an error. In case of an error
+ * err_msg is set. (a signal might be raised in case of an allocation error)
+ */
+int siridb_partials_add_points(
+        siridb_partials_t * partials,
+        siridb_points_t * points,
+        char * err_msg)
+{
+    uint64_t group_by = partials->group_by;
+    siridb_point_t * pts = points->data;
+    size_t n = points->len, end, pos = 0;
+    uint64_t ts;
+
+    if (partials->sketches != NULL)
+    {
+        return siridb_sketches_add_points(
+                partials->sketches,
+                points,
+                err_msg);
+    }
+
+    if (points->tp == TP_STRING && partials->gid != CLERI_GID_F_COUNT)
+    {
+        sprintf(err_msg,
+                "Cannot use %s() on string type.",
+                PARTIAL_name(partials->gid));
+        return -1;
+    }
+
+    if (points->tp == TP_DOUBLE && partials->tp == TP_INT)
+    {
+        PARTIAL_to_double(partials);
+    }
+
+    while (n)
+    {
+        ts = (pts->ts + group_by - 1) / group_by * group_by;
+        end = siridb_simd->bucket_end(pts, n, ts);
+
+        if (PARTIAL_window(partials, &pos, ts))
+        {
+            sprintf(err_msg, "Memory allocation error.");
+            return -1;
+        }
+
+        if (PARTIAL_add_range(
+                partials,
+                partials->windows + pos,
+                pts,
+                end,
+                points->tp,
+                err_msg))
+        {
+            return -1;
+        }
+
+        pts += end;
+        n -= end;
+    }
+
+    return 0;
+}
+
+/*
+ * Merge packed partial results from another server.
+ *
+ * Returns 0 if successful or -1 when the data is invalid, when an integer
+ * sum overflows or in case of an allocation error. In case of an error
+ * err_msg is set. (a signal might be raised in case of an allocation error)
+ */
+int siridb_partials_merge_packed(
+        siridb_partials_t * partials,
+        const char * data,
+        size_t len,
+        char * err_msg)
+{
+    partial_head_t head;
+    siridb_partial_t other;
+    uint64_t prev = 0;
+    size_t pos = 0;
+
+    if (partials->sketches != NULL)
+    {
+        siridb_sketches_t * sketches = siridb_sketches_unpack(
+                data,
+                len,
+                partials->group_by);
+        int rc;
+
+        if (sketches == NULL)
+        {
+            sprintf(err_msg, "Cannot read sketches.");
+            return -1;
+        }
+
+        rc = siridb_sketches_merge(partials->sketches, sketches);
+        siridb_sketches_free(sketches);
+
+        if (rc)
+        {
+            sprintf(err_msg, "Memory allocation error.");
+            return -1;
+        }
+
+        return 0;
+    }
+
+    if (len < sizeof(partial_head_t))
+    {
+        sprintf(err_msg, "Cannot read partial aggregates.");
+        return -1;
+    }
+
+    memcpy(&head, data, sizeof(partial_head_t));
+    data += sizeof(partial_head_t);
+    len -= sizeof(partial_head_t);
+
+    if (head.magic != PARTIAL_MAGIC ||
+        (head.tp != TP_INT && head.tp != TP_DOUBLE) ||
+        head.len != len / sizeof(siridb_partial_t) ||
+        len % sizeof(siridb_partial_t))
+    {
+        sprintf(err_msg, "Cannot read partial aggregates.");
+        return -1;
+    }
+
+    if (head.tp == TP_DOUBLE && partials->tp == TP_INT)
+    {
+        PARTIAL_to_double(partials);
+    }
+
+    for (uint64_t i = 0; i < head.len; i++, data += sizeof(siridb_partial_t))
+    {
+        memcpy(&other, data, sizeof(siridb_partial_t));
+
+        if (!other.n || (i && other.ts <= prev))
+        {
+            sprintf(err_msg, "Cannot read partial aggregates.");
+            return -1;
+        }
+        prev = other.ts;
+
+        if (PARTIAL_window(partials, &pos, other.ts))
+        {
+            sprintf(err_msg, "Memory allocation error.");
+            return -1;
+        }
+
+        if (PARTIAL_combine(
+                partials,
+                partials->windows + pos,
+                &other,
+                (points_tp) head.tp,
+                err_msg))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Returns the aggregated points for each window or NULL in case of an error,
+ * in which case err_msg is set. (a signal is raised in case of an allocation
+ * error)
+ */
+siridb_points_t * siridb_partials_points(
+        siridb_partials_t * partials,
+        char * err_msg)
+{
+    siridb_points_t * points;
+    siridb_partial_t * window;
+    siridb_point_t * point;
+    points_tp tp;
+
+    if (partials->sketches != NULL)
+    {
+        points = siridb_sketches_quantile(
+                partials->sketches,
+                partials->quantile);
+        if (points == NULL)
+        {
+            sprintf(err_msg, "Memory allocation error.");
+        }
+        return points;
+    }
+
+    switch (partials->gid)
+    {
+    case CLERI_GID_F_COUNT:
+        tp = TP_INT;
+        break;
+    case CLERI_GID_F_MEAN:
+    case CLERI_GID_F_PVARIANCE:
+    case CLERI_GID_F_VARIANCE:
+        tp = TP_DOUBLE;
+        break;
+    default:
+        tp = partials->tp;
+        break;
+    }
+
+    points = siridb_points_new(partials->len, tp);
+    if (points == NULL)
+    {
+        sprintf(err_msg, "Memory allocation error.");
+        return NULL;  /* signal is raised */
+    }
+
+    for (size_t i = 0; i < partials->len; i++)
+    {
+        window = partials->windows + i;
+        point = points->data + i;
+        point->ts = window->ts;
+
+        switch (partials->gid)
+        {
+        case CLERI_GID_F_COUNT:
+            point->val.int64 = (int64_t) window->n;
+            break;
+        case CLERI_GID_F_MEAN:
+            point->val.real = window->acc.real / window->n;
+            break;
+        case CLERI_GID_F_PVARIANCE:
+            point->val.real = window->m2 / window->n;
+            break;
+        case CLERI_GID_F_VARIANCE:
+            point->val.real = (window->n > 1) ?
+                    window->m2 / (window->n - 1) : 0.0;
+            break;
+        default:
+            point->val = window->acc;
+            break;
+        }
+    }
+
+    points->len = partials->len;
+
+    return points;
+}
+
+/*
+ * Pack the partial results as one raw value.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ * (a signal is raised in case of an allocation error)
+ */
+int siridb_partials_pack(siridb_partials_t * partials, qp_packer_t * packer)
+{
+    size_t size;
+    partial_head_t head;
+    char * data;
+    int rc;
+
+    if (partials->sketches != NULL)
+    {
+        return siridb_sketches_pack(partials->sketches, packer);
+    }
+
+    size = sizeof(partial_head_t) + partials->len * sizeof(siridb_partial_t);
+
+    data = (char *) malloc(size);
+    if (data == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    head.magic = PARTIAL_MAGIC;
+    head.tp = partials->tp;
+    head.len = partials->len;
+
+    memcpy(data, &head, sizeof(partial_head_t));
+    if (partials->len)
+    {
+        memcpy(
+            data + sizeof(partial_head_t),
+            partials->windows,
+            partials->len * sizeof(siridb_partial_t));
+    }
+
+    rc = qp_add_raw(packer, data, size);
+    free(data);
+
+    return rc;
+}
+
+/*
+ * Set pos to the window for ts, a new window is inserted when required.
+ * Windows are searched from pos so pos should be 0 or the position of a
+ * window with a lower timestamp.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ * (a signal is raised in case of an allocation error)
+ */
+static int PARTIAL_window(
+        siridb_partials_t * partials,
+        size_t * pos,
+        uint64_t ts)
+{
+    size_t i = *pos;
+    siridb_partial_t * windows;
+
+    while (i < partials->len && partials->windows[i].ts < ts)
+    {
+        i++;
+    }
+
+    *pos = i;
+
+    if (i < partials->len && partials->windows[i].ts == ts)
+    {
+        return 0;
+    }
+
+    if (partials->len == partials->size)
+    {
+        size_t size = (partials->size) ? partials->size * 2 : 8;
+        windows = (siridb_partial_t *) realloc(
+                partials->windows,
+                size * sizeof(siridb_partial_t));
+        if (windows == NULL)
+        {
+            ERR_ALLOC
+            return -1;
+        }
+        partials->windows = windows;
+        partials->size = size;
+    }
+
+    memmove(
+        partials->windows + i + 1,
+        partials->windows + i,
+        (partials->len - i) * sizeof(siridb_partial_t));
+
+    windows = partials->windows + i;
+    windows->ts = ts;
+    windows->n = 0;
+    if (partials->tp == TP_INT)
+    {
+        windows->acc.int64 = 0;
+    }
+    else
+    {
+        windows->acc.real = 0.0;
+    }
+    if (partials->gid == CLERI_GID_F_MEAN)
+    {
+        windows->acc.real = 0.0;
+    }
+    windows->mean = 0.0;
+    windows->m2 = 0.0;
+    partials->len++;
+
+    return 0;
+}
+
+/*
+ * Add n points to a window. All points must be part of the window and tp
+ * must be TP_INT when partials->tp is TP_INT. (only count accepts strings)
+ *
+ * Returns 0 if successful or -1 in case of an integer overflow, in which
+ * case err_msg is set.
+ */
+static int PARTIAL_add_range(
+        siridb_partials_t * partials,
+        siridb_partial_t * window,
+        siridb_point_t * pts,
+        size_t n,
+        points_tp tp,
+        char * err_msg)
+{
+    const siridb_simd_t * simd = siridb_simd;
+    siridb_points_t group;
+    int64_t isum, ival;
+    double rval;
+
+    switch (partials->gid)
+    {
+    case CLERI_GID_F_COUNT:
+        break;
+
+    case CLERI_GID_F_SUM:
+        if (tp == TP_DOUBLE)
+        {
+            window->acc.real += (*simd->sum_real)(pts, n);
+            break;
+        }
+        if ((*simd->sum_int)(pts, n, &isum))
+        {
+            if (partials->tp == TP_INT)
+            {
+                sprintf(err_msg, "Overflow detected while using sum().");
+                return -1;
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                window->acc.real += pts[i].val.int64;
+            }
+            break;
+        }
+        if (partials->tp == TP_DOUBLE)
+        {
+            window->acc.real += (double) isum;
+            break;
+        }
+        if ((isum > 0 && window->acc.int64 > LLONG_MAX - isum) ||
+            (isum < 0 && window->acc.int64 < LLONG_MIN - isum))
+        {
+            sprintf(err_msg, "Overflow detected while using sum().");
+            return -1;
+        }
+        window->acc.int64 += isum;
+        break;
+
+    case CLERI_GID_F_MIN:
+        if (tp == TP_INT)
+        {
+            ival = (*simd->min_int)(pts, n);
+            if (partials->tp == TP_INT)
+            {
+                if (!window->n || ival < window->acc.int64)
+                {
+                    window->acc.int64 = ival;
+                }
+                break;
+            }
+            rval = (double) ival;
+        }
+        else
+        {
+            rval = (*simd->min_real)(pts, n);
+        }
+        if (!window->n || rval < window->acc.real)
+        {
+            window->acc.real = rval;
+        }
+        break;
+
+    case CLERI_GID_F_MAX:
+        if (tp == TP_INT)
+        {
+            ival = (*simd->max_int)(pts, n);
+            if (partials->tp == TP_INT)
+            {
+                if (!window->n || ival > window->acc.int64)
+                {
+                    window->acc.int64 = ival;
+                }
+                break;
+            }
+            rval = (double) ival;
+        }
+        else
+        {
+            rval = (*simd->max_real)(pts, n);
+        }
+        if (!window->n || rval > window->acc.real)
+        {
+            window->acc.real = rval;
+        }
+        break;
+
+    case CLERI_GID_F_MEAN:
+        if (tp == TP_DOUBLE)
+        {
+            window->acc.real += (*simd->sum_real)(pts, n);
+        }
+        else if ((*simd->sum_int)(pts, n, &isum) == 0)
+        {
+            window->acc.real += (double) isum;
+        }
+        else
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                window->acc.real += pts[i].val.int64;
+            }
+        }
+        break;
+
+    case CLERI_GID_F_PVARIANCE:
+    case CLERI_GID_F_VARIANCE:
+        group.len = n;
+        group.tp = tp;
+        group.content = NULL;
+        group.data = pts;
+        rval = siridb_simd_mean(&group);
+        PARTIAL_moments(
+                window,
+                n,
+                rval,
+                (tp == TP_INT) ?
+                        (*simd->sqdev_int)(pts, n, rval) :
+                        (*simd->sqdev_real)(pts, n, rval));
+        return 0;  /* n is updated by PARTIAL_moments() */
+
+    default:
+        assert (0);
+        break;
+    }
+
+    window->n += n;
+
+    return 0;
+}
+
+/*
+ * Combine a window from other partial results of type tp with a window.
+ *
+ * Returns 0 if successful or -1 in case of an integer overflow, in which
+ * case err_msg is set.
+ */
+static int PARTIAL_combine(
+        siridb_partials_t * partials,
+        siridb_partial_t * window,
+        siridb_partial_t * other,
+        points_tp tp,
+        char * err_msg)
+{
+    double rval;
+
+    switch (partials->gid)
+    {
+    case CLERI_GID_F_COUNT:
+        break;
+
+    case CLERI_GID_F_SUM:
+        if (partials->tp == TP_DOUBLE)
+        {
+            window->acc.real += (tp == TP_INT) ?
+                    (double) other->acc.int64 : other->acc.real;
+            break;
+        }
+        if ((other->acc.int64 > 0 &&
+                window->acc.int64 > LLONG_MAX - other->acc.int64) ||
+            (other->acc.int64 < 0 &&
+                window->acc.int64 < LLONG_MIN - other->acc.int64))
+        {
+            sprintf(err_msg, "Overflow detected while using sum().");
+            return -1;
+        }
+        window->acc.int64 += other->acc.int64;
+        break;
+
+    case CLERI_GID_F_MIN:
+        if (partials->tp == TP_INT)
+        {
+            if (!window->n || other->acc.int64 < window->acc.int64)
+            {
+                window->acc.int64 = other->acc.int64;
+            }
+            break;
+        }
+        rval = (tp == TP_INT) ? (double) other->acc.int64 : other->acc.real;
+        if (!window->n || rval < window->acc.real)
+        {
+            window->acc.real = rval;
+        }
+        break;
+
+    case CLERI_GID_F_MAX:
+        if (partials->tp == TP_INT)
+        {
+            if (!window->n || other->acc.int64 > window->acc.int64)
+            {
+                window->acc.int64 = other->acc.int64;
+            }
+            break;
+        }
+        rval = (tp == TP_INT) ? (double) other->acc.int64 : other->acc.real;
+        if (!window->n || rval > window->acc.real)
+        {
+            window->acc.real = rval;
+        }
+        break;
+
+    case CLERI_GID_F_MEAN:
+        window->acc.real += other->acc.real;
+        break;
+
+    case CLERI_GID_F_PVARIANCE:
+    case CLERI_GID_F_VARIANCE:
+        PARTIAL_moments(window, other->n, other->mean, other->m2);
+        return 0;  /* n is updated by PARTIAL_moments() */
+
+    default:
+        assert (0);
+        break;
+    }
+
+    window->n += other->n;
+
+    return 0;
+}
+
+/*
+ * Combine the mean and sum of squared deviations of n values with a window.
+ */
+static void PARTIAL_moments(
+        siridb_partial_t * window,
+        uint64_t n,
+        double mean,
+        double m2)
+{
+    double total = (double) (window->n + n);
+    double delta = mean - window->mean;
+
+    window->m2 += m2 + delta * delta * window->n * n / total;
+    window->mean += delta * n / total;
+    window->n += n;
+}
+
+/*
+ * Promote integer sum, min and max values to double.
+ */
+static void PARTIAL_to_double(siridb_partials_t * partials)
+{
+    siridb_partial_t * window;
+
+    switch (partials->gid)
+    {
+    case CLERI_GID_F_SUM:
+    case CLERI_GID_F_MIN:
+    case CLERI_GID_F_MAX:
+        for (size_t i = 0; i < partials->len; i++)
+        {
+            window = partials->windows + i;
+            window->acc.real = (double) window->acc.int64;
+        }
+        break;
+    }
+
+    partials->tp = TP_DOUBLE;
+}
+
+static const char * PARTIAL_name(uint32_t gid)
+{
+    switch (gid)
+    {
+    case CLERI_GID_F_COUNT: return "count";
+    case CLERI_GID_F_MAX: return "max";
+    case CLERI_GID_F_MEAN: return "mean";
+    case CLERI_GID_F_MIN: return "min";
+    case CLERI_GID_F_PVARIANCE: return "pvariance";
+    case CLERI_GID_F_SUM: return "sum";
+    case CLERI_GID_F_VARIANCE: return "variance";
+    }
+    return "unknown";
+}
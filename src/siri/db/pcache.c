@@ -7,6 +7,8 @@
  *
  * changes
  *  - initial version, 08-10-2016
+ *  - added functions for adding points in batches, 18-10-2026
+ *  - added siridb_pcache_reserve(), 18-10-2026
  *
  */
 
@@ -17,6 +19,8 @@
 
 #define PCACHE_DEFAULT_SIZE 64
 
+static int PCACHE_grow(siridb_pcache_t * pcache, size_t n);
+
 /*
  * Returns NULL and raises a SIGNAL in case an error has occurred.
  *
@@ -35,6 +39,7 @@ siridb_pcache_t * siridb_pcache_new(points_tp tp)
         pcache->size = PCACHE_DEFAULT_SIZE;
         pcache->len = 0;
         pcache->tp = tp;
+        pcache->flags = 0;
         pcache->content = NULL;
         pcache->data = (siridb_point_t *) malloc(
                 sizeof(siridb_point_t) * PCACHE_DEFAULT_SIZE);
@@ -60,24 +65,9 @@ int siridb_pcache_add_point(
         uint64_t * ts,
         qp_via_t * val)
 {
-    if (pcache->len == pcache->size)
+    if (pcache->len == pcache->size && PCACHE_grow(pcache, 1))
     {
-        pcache->size *= 2;
-        siridb_point_t * tmp = (siridb_point_t *) realloc(
-                        pcache->data,
-                        sizeof(siridb_point_t) * pcache->size);
-        if (tmp == NULL)
-        {
-            log_error(
-                    "Cannot re-allocate memory for %lu points",
-                    pcache->size);
-
-            ERR_ALLOC
-            /* restore original size */
-            pcache->size /= 2;
-            return -1;
-        }
-        pcache->data = tmp;
+        return -1;  /* signal is raised */
     }
 
     siridb_points_add_point((siridb_points_t *) pcache, ts, val);
@@ -85,3 +75,109 @@ int siridb_pcache_add_point(
     return 0;
 }
 
+/*
+ * Append a point without keeping the points sorted. This is used when
+ * reading a batch of points; siridb_points_sort() must be called on the
+ * pcache before the points are used.
+ *
+ * Returns 0 if successful or -1 and a signal is raised in case of an error.
+ */
+int siridb_pcache_append_point(
+        siridb_pcache_t * pcache,
+        uint64_t * ts,
+        qp_via_t * val)
+{
+    siridb_point_t * point;
+
+    if (pcache->len == pcache->size && PCACHE_grow(pcache, 1))
+    {
+        return -1;  /* signal is raised */
+    }
+
+    point = pcache->data + pcache->len++;
+    point->ts = *ts;
+    point->val = *val;
+
+    return 0;
+}
+
+/*
+ * Add 'n' points to the pcache. (see siridb_points_add_points())
+ *
+ * Returns 0 if successful or -1 and a signal is raised in case of an error.
+ */
+int siridb_pcache_add_points(
+        siridb_pcache_t * pcache,
+        siridb_point_t * pts,
+        size_t n)
+{
+    if (pcache->len + n > pcache->size && PCACHE_grow(pcache, n))
+    {
+        return -1;  /* signal is raised */
+    }
+
+    return siridb_points_add_points((siridb_points_t *) pcache, pts, n);
+}
+
+/*
+ * Make room for exactly 'n' more points when the pcache is too small. This
+ * can be used before writing 'n' points to 'data' directly, in which case
+ * 'len' must be updated by the caller.
+ *
+ * Returns 0 if successful or -1 and a signal is raised in case of an error.
+ */
+int siridb_pcache_reserve(siridb_pcache_t * pcache, size_t n)
+{
+    siridb_point_t * tmp;
+    size_t size = pcache->len + n;
+
+    if (size <= pcache->size)
+    {
+        return 0;
+    }
+
+    tmp = (siridb_point_t *) realloc(
+            pcache->data,
+            sizeof(siridb_point_t) * size);
+    if (tmp == NULL)
+    {
+        log_error("Cannot re-allocate memory for %lu points", size);
+        ERR_ALLOC
+        return -1;
+    }
+
+    pcache->data = tmp;
+    pcache->size = size;
+
+    return 0;
+}
+
+/*
+ * Make room for at least 'n' more points.
+ *
+ * Returns 0 if successful or -1 and a signal is raised in case of an error.
+ */
+static int PCACHE_grow(siridb_pcache_t * pcache, size_t n)
+{
+    size_t size = pcache->size * 2;
+
+    while (size < pcache->len + n)
+    {
+        size *= 2;
+    }
+
+    siridb_point_t * tmp = (siridb_point_t *) realloc(
+                    pcache->data,
+                    sizeof(siridb_point_t) * size);
+    if (tmp == NULL)
+    {
+        log_error("Cannot re-allocate memory for %lu points", size);
+        ERR_ALLOC
+        return -1;
+    }
+
+    pcache->data = tmp;
+    pcache->size = size;
+
+    return 0;
+}
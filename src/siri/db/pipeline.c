@@ -0,0 +1,440 @@
+/*
+ * pipeline.c - Outbound insert pipeline for a pool.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *  - cancel queued batches when the pipeline is closed, 18-10-2026
+ *
+ */
+#include <assert.h>
+#include <logger/logger.h>
+#include <qpack/qpack.h>
+#include <siri/db/pipeline.h>
+#include <siri/db/pool.h>
+#include <siri/db/pools.h>
+#include <siri/err.h>
+#include <siri/siri.h>
+#include <slist/slist.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct pipeline_batch_s
+{
+    siridb_pipeline_t * pipeline;
+    sirinet_pkg_t * pkg;
+    uint32_t size;          /* allocated size for pkg->data */
+    uint64_t timeout;
+    slist_t * promises;     /* one promise for each package in the batch */
+} pipeline_batch_t;
+
+static siridb_pipeline_t * PIPELINE_new(siridb_t * siridb, uint16_t pool);
+static void PIPELINE_decref(siridb_pipeline_t * pipeline);
+static pipeline_batch_t * PIPELINE_batch_new(
+        siridb_pipeline_t * pipeline,
+        sirinet_pkg_t * pkg,
+        uint64_t timeout);
+static int PIPELINE_batch_extend(pipeline_batch_t * batch, sirinet_pkg_t * pkg);
+static void PIPELINE_batch_done(
+        pipeline_batch_t * batch,
+        siridb_server_t * server,
+        sirinet_pkg_t * pkg,
+        int status);
+static int PIPELINE_batch_free(pipeline_batch_t * batch, void * args);
+static void PIPELINE_flush(siridb_pipeline_t * pipeline);
+static void PIPELINE_cancel(
+        siridb_pipeline_t * pipeline,
+        siridb_server_t * server);
+static void PIPELINE_on_response(
+        sirinet_promise_t * promise,
+        sirinet_pkg_t * pkg,
+        int status);
+
+/*
+ * Queue an insert package for a pool. The package is send right away when
+ * the pool has a free slot, otherwise the points are appended to the last
+ * queued batch when possible.
+ *
+ * Returns 0 if the package is accepted. In this case the package will be
+ * destroyed and the call-back function will be called exactly once, which
+ * might happen before this function returns.
+ *
+ * Returns -1 when no server in the pool is accessible or when an error has
+ * occurred. (a signal might be raised) The call-back function is not called
+ * and the package is not destroyed in this case.
+ *
+ * The package must be a map with series and points since packages in one
+ * batch are merged into a single map.
+ */
+int siridb_pipeline_send_pkg(
+        siridb_t * siridb,
+        uint16_t pool,
+        sirinet_pkg_t * pkg,
+        uint64_t timeout,
+        sirinet_promise_cb cb,
+        void * data)
+{
+#ifdef DEBUG
+    assert (pool != siridb->server->pool);
+    assert (pkg->len && (uint8_t) pkg->data[0] == QP_MAP_OPEN);
+#endif
+    siridb_pool_t * spool = siridb->pools->pool + pool;
+    siridb_pipeline_t * pipeline = spool->pipeline;
+    pipeline_batch_t * batch;
+    sirinet_promise_t * promise;
+    uint32_t max_size = siri.cfg->insert_pipeline_batch_size * 1024;
+
+    if (!siridb_pool_accessible(spool))
+    {
+        return -1;
+    }
+
+    if (pipeline == NULL &&
+            (pipeline = spool->pipeline = PIPELINE_new(siridb, pool)) == NULL)
+    {
+        return -1;  /* signal is raised */
+    }
+
+    promise = (sirinet_promise_t *) malloc(sizeof(sirinet_promise_t));
+    if (promise == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    /* the server is set when the response on the batch is received */
+    promise->pid = 0;
+    promise->ref = 1;
+    promise->timer = NULL;
+    promise->cb = cb;
+    promise->server = NULL;
+    promise->pkg = NULL;
+    promise->data = data;
+
+    if (!timeout)
+    {
+        timeout = PROMISE_DEFAULT_TIMEOUT;
+    }
+
+    batch = (pipeline->queue->last == NULL) ?
+            NULL : (pipeline_batch_t *) pipeline->queue->last->data;
+
+    if (    batch != NULL &&
+            batch->pkg->tp == pkg->tp &&
+            batch->pkg->len + pkg->len <= max_size)
+    {
+        if (slist_append_safe(&batch->promises, promise))
+        {
+            free(promise);
+            return -1;  /* signal is raised */
+        }
+
+        if (PIPELINE_batch_extend(batch, pkg))
+        {
+            /* remove the promise which we have just added */
+            batch->promises->len--;
+            free(promise);
+            return -1;  /* signal is raised */
+        }
+
+        if (timeout > batch->timeout)
+        {
+            batch->timeout = timeout;
+        }
+
+        free(pkg);
+    }
+    else
+    {
+        batch = PIPELINE_batch_new(pipeline, pkg, timeout);
+        if (batch == NULL)
+        {
+            free(promise);
+            return -1;  /* signal is raised */
+        }
+
+        if (    slist_append_safe(&batch->promises, promise) ||
+                llist_append(pipeline->queue, batch))
+        {
+            slist_free(batch->promises);
+            free(batch);
+            free(promise);
+            return -1;  /* signal is raised */
+        }
+    }
+
+    PIPELINE_flush(pipeline);
+
+    return 0;
+}
+
+/*
+ * Close the pipeline. This is called when the pools are closed, before the
+ * servers are destroyed. Queued batches are cancelled and batches which are
+ * still in flight will not send queued batches.
+ *
+ * This function can raise a SIGNAL.
+ */
+void siridb_pipeline_close(siridb_pipeline_t * pipeline)
+{
+    siridb_pool_t * pool = pipeline->siridb->pools->pool + pipeline->pool;
+
+    if (pipeline->queue->len)
+    {
+        log_warning(
+                "Cancel %zu queued insert batch(es) for pool %u",
+                pipeline->queue->len,
+                pipeline->pool);
+        PIPELINE_cancel(pipeline, pool->server[0]);
+    }
+
+    pipeline->siridb = NULL;
+    PIPELINE_decref(pipeline);
+}
+
+/*
+ * Returns NULL and raises a SIGNAL in case an error has occurred.
+ */
+static siridb_pipeline_t * PIPELINE_new(siridb_t * siridb, uint16_t pool)
+{
+    siridb_pipeline_t * pipeline =
+            (siridb_pipeline_t *) malloc(sizeof(siridb_pipeline_t));
+    if (pipeline == NULL)
+    {
+        ERR_ALLOC
+        return NULL;
+    }
+
+    pipeline->pool = pool;
+    pipeline->inflight = 0;
+    pipeline->ref = 1;
+    pipeline->siridb = siridb;
+    pipeline->queue = llist_new();
+
+    if (pipeline->queue == NULL)
+    {
+        free(pipeline);
+        return NULL;  /* signal is raised */
+    }
+
+    return pipeline;
+}
+
+static void PIPELINE_decref(siridb_pipeline_t * pipeline)
+{
+    if (!--pipeline->ref)
+    {
+        llist_free_cb(pipeline->queue, (llist_cb) PIPELINE_batch_free, NULL);
+        free(pipeline);
+    }
+}
+
+/*
+ * Returns NULL and raises a SIGNAL in case an error has occurred.
+ *
+ * The batch takes ownership of 'pkg' when successful.
+ */
+static pipeline_batch_t * PIPELINE_batch_new(
+        siridb_pipeline_t * pipeline,
+        sirinet_pkg_t * pkg,
+        uint64_t timeout)
+{
+    pipeline_batch_t * batch =
+            (pipeline_batch_t *) malloc(sizeof(pipeline_batch_t));
+    if (batch == NULL)
+    {
+        ERR_ALLOC
+        return NULL;
+    }
+
+    batch->promises = slist_new(SLIST_DEFAULT_SIZE);
+    if (batch->promises == NULL)
+    {
+        free(batch);
+        return NULL;  /* signal is raised */
+    }
+
+    batch->pipeline = pipeline;
+    batch->pkg = pkg;
+    batch->size = pkg->len;
+    batch->timeout = timeout;
+
+    return batch;
+}
+
+/*
+ * Append the series and points from 'pkg' to the batch. The package itself
+ * is not destroyed.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ * The batch is not changed in case of an error.
+ */
+static int PIPELINE_batch_extend(pipeline_batch_t * batch, sirinet_pkg_t * pkg)
+{
+    /* skip QP_MAP_OPEN, the batch already starts with a map */
+    uint32_t len = pkg->len - 1;
+
+    if (batch->pkg->len + len > batch->size)
+    {
+        uint32_t size = batch->size * 2;
+        sirinet_pkg_t * tmp;
+
+        if (size < batch->pkg->len + len)
+        {
+            size = batch->pkg->len + len;
+        }
+
+        tmp = (sirinet_pkg_t *) realloc(
+                batch->pkg,
+                sizeof(sirinet_pkg_t) + size);
+        if (tmp == NULL)
+        {
+            ERR_ALLOC
+            return -1;
+        }
+        batch->pkg = tmp;
+        batch->size = size;
+    }
+
+    memcpy(batch->pkg->data + batch->pkg->len, pkg->data + 1, len);
+    batch->pkg->len += len;
+
+    return 0;
+}
+
+/*
+ * Pass the response on a batch to each package in the batch and destroy the
+ * batch. The batch package must be destroyed or send before calling this
+ * function.
+ */
+static void PIPELINE_batch_done(
+        pipeline_batch_t * batch,
+        siridb_server_t * server,
+        sirinet_pkg_t * pkg,
+        int status)
+{
+    sirinet_promise_t * promise;
+
+    for (size_t i = 0; i < batch->promises->len; i++)
+    {
+        promise = (sirinet_promise_t *) batch->promises->data[i];
+        promise->server = server;
+        promise->cb(promise, pkg, status);
+    }
+
+    slist_free(batch->promises);
+    free(batch);
+}
+
+/*
+ * Destroy a batch without calling the call-back functions. This is only used
+ * when the pipeline is destroyed and should never happen since queued
+ * batches are cancelled when the pipeline is closed.
+ */
+static int PIPELINE_batch_free(pipeline_batch_t * batch, void * args)
+{
+    for (size_t i = 0; i < batch->promises->len; i++)
+    {
+        free(batch->promises->data[i]);
+    }
+    slist_free(batch->promises);
+    free(batch->pkg);
+    free(batch);
+    return 0;
+}
+
+/*
+ * Send queued batches while the pool has free slots.
+ *
+ * This function can raise a SIGNAL.
+ */
+static void PIPELINE_flush(siridb_pipeline_t * pipeline)
+{
+    siridb_pool_t * pool = pipeline->siridb->pools->pool + pipeline->pool;
+    pipeline_batch_t * batch;
+
+    while ( pipeline->inflight < siri.cfg->insert_pipeline_depth &&
+            pipeline->queue->len)
+    {
+        batch = (pipeline_batch_t *) llist_shift(pipeline->queue);
+
+        if (siridb_pool_send_pkg(
+                pool,
+                batch->pkg,
+                batch->timeout,
+                PIPELINE_on_response,
+                batch,
+                0))
+        {
+            log_error(
+                    "Cannot send %zu insert package(s) to pool %u",
+                    batch->promises->len,
+                    pipeline->pool);
+            free(batch->pkg);
+            PIPELINE_batch_done(
+                    batch,
+                    pool->server[0],
+                    NULL,
+                    PROMISE_WRITE_ERROR);
+        }
+        else
+        {
+            /* the package is destroyed by the promise */
+            pipeline->inflight++;
+            pipeline->ref++;
+        }
+    }
+}
+
+/*
+ * Fail all queued batches.
+ */
+static void PIPELINE_cancel(
+        siridb_pipeline_t * pipeline,
+        siridb_server_t * server)
+{
+    pipeline_batch_t * batch;
+
+    while ((batch = (pipeline_batch_t *) llist_shift(pipeline->queue)) != NULL)
+    {
+        free(batch->pkg);
+        PIPELINE_batch_done(batch, server, NULL, PROMISE_CANCELLED_ERROR);
+    }
+}
+
+/*
+ * Call-back function: sirinet_promise_cb
+ *
+ * This function can raise a SIGNAL.
+ */
+static void PIPELINE_on_response(
+        sirinet_promise_t * promise,
+        sirinet_pkg_t * pkg,
+        int status)
+{
+    pipeline_batch_t * batch = (pipeline_batch_t *) promise->data;
+    siridb_pipeline_t * pipeline = batch->pipeline;
+
+    pipeline->inflight--;
+
+    PIPELINE_batch_done(batch, promise->server, pkg, status);
+
+    if (pipeline->siridb != NULL)
+    {
+        if (status == PROMISE_CANCELLED_ERROR)
+        {
+            /* the server is destroyed, queued batches cannot be send */
+            PIPELINE_cancel(pipeline, promise->server);
+        }
+        else
+        {
+            PIPELINE_flush(pipeline);
+        }
+    }
+
+    sirinet_promise_decref(promise);
+    PIPELINE_decref(pipeline);
+}
@@ -7,32 +7,99 @@
  *
  * changes
  *  - initial version, 04-04-2016
+ *  - batch functions for adding, sorting and merging points, 18-10-2026
+ *  - pack points which are read in chunks, 18-10-2026
+ *  - merge series using a loser tree, 18-10-2026
+ *  - allocate points in the arena of the calling thread, 18-10-2026
+ *  - keep the order of series when empty points are removed, 18-10-2026
+ *  - allocate the merge heap for a large number of runs, 18-10-2026
  *
  */
+#include <siri/db/arena.h>
 #include <siri/db/points.h>
 #include <logger/logger.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
 #include <siri/err.h>
-#include <unistd.h>
+#include <string.h>
+#include <uv.h>
 
-#define MAX_ITERATE_MERGE_COUNT 1000
-#define POINTS_MAX_QSORT 250000
+#define POINTS_RADIX_MIN 64  /* use insertion sort for less points */
+#define POINTS_MERGE_THREADS 4
+#define POINTS_MERGE_CHUNK_SZ 1000000  // minimal number of points per thread
+#define POINTS_HEAP_SZ 64  /* runs merged without allocating the heap */
 
-static void POINTS_sort_while_merge(slist_t * plist, siridb_points_t * points);
-static void POINTS_merge_and_sort(slist_t * plist, siridb_points_t * points);
-static void POINTS_simple_sort(siridb_points_t * points);
-static int POINTS_compare(const void * a, const void * b);
-static void POINTS_highest_and_merge(slist_t * plist, siridb_points_t * points);
+typedef struct points_run_s
+{
+    siridb_point_t * pt;
+    siridb_point_t * end;
+    size_t run;
+    uint8_t int2double;     /* only used by siridb_points_merge() */
+} points_run_t;
+
+/* part of the points which is merged by one thread */
+typedef struct points_part_s
+{
+    points_run_t * runs;
+    size_t k;               /* number of runs */
+    size_t n;               /* number of points */
+    siridb_point_t * dest;
+    int rc;
+    int has_thread;
+    uv_thread_t thread;
+} points_part_t;
+
+typedef struct points_sample_s
+{
+    uint64_t ts;
+    size_t n;               /* number of points for this sample */
+} points_sample_t;
+
+#define POINTS_RUN_LT(a, b) \
+    ((a)->pt->ts < (b)->pt->ts || \
+    ((a)->pt->ts == (b)->pt->ts && (a)->run < (b)->run))
+
+static siridb_points_t * POINTS_arena_new(
+        siridb_arena_t * arena,
+        size_t size,
+        points_tp tp);
+static int POINTS_merge_splits(
+        slist_t * plist,
+        uint64_t * splits,
+        size_t nparts,
+        size_t n);
+static int POINTS_sample_cmp(const void * a, const void * b);
+static size_t POINTS_lower_bound(
+        siridb_point_t * pts,
+        size_t n,
+        uint64_t ts);
+static void POINTS_merge_part(points_part_t * part);
+static inline int POINTS_run_lt(points_run_t * a, points_run_t * b);
+static int POINTS_radix_sort(siridb_points_t * points);
+static void POINTS_merge_sorted(
+        siridb_points_t *__restrict points,
+        siridb_point_t *__restrict pts,
+        size_t n);
+static void POINTS_heap_down(points_run_t * heap, size_t n, size_t i);
 
 /*
  * Returns NULL and raises a SIGNAL in case an error has occurred.
+ *
+ * The points are allocated in the arena of the calling thread when the
+ * thread uses an arena, see siridb_arena_enter().
  */
 siridb_points_t * siridb_points_new(size_t size, points_tp tp)
 {
-    siridb_points_t * points =
-            (siridb_points_t *) malloc(sizeof(siridb_points_t));
+    siridb_arena_t * arena = siridb_arena_current();
+    siridb_points_t * points;
+
+    if (arena != NULL)
+    {
+        return POINTS_arena_new(arena, size, tp);
+    }
+
+    points = (siridb_points_t *) malloc(sizeof(siridb_points_t));
     if (points == NULL)
     {
         ERR_ALLOC
@@ -41,6 +108,7 @@ siridb_points_t * siridb_points_new(size_t size, points_tp tp)
     {
         points->len = 0;
         points->tp = tp;
+        points->flags = 0;
         points->content = NULL;
         points->data = (siridb_point_t *) malloc(sizeof(siridb_point_t) * size);
         if (points->data == NULL)
@@ -59,10 +127,44 @@ siridb_points_t * siridb_points_new(size_t size, points_tp tp)
 void siridb_points_free(siridb_points_t * points)
 {
     free(points->content);
+
+    if (points->flags & SIRIDB_POINTS_FLAG_ARENA)
+    {
+        siridb_arena_free(points->data);
+        siridb_arena_free(points);
+        return;
+    }
+
     free(points->data);
     free(points);
 }
 
+/*
+ * Change the allocation of points to 'size' points. Space for at least one
+ * point is kept.
+ *
+ * Returns 0 if successful or -1 when the allocation has failed, in which
+ * case the points are not changed. (no signal is raised)
+ */
+int siridb_points_resize(siridb_points_t * points, size_t size)
+{
+    siridb_point_t * data;
+
+    size = sizeof(siridb_point_t) * (size ? size : 1);
+
+    data = (siridb_point_t *) ((points->flags & SIRIDB_POINTS_FLAG_ARENA) ?
+            siridb_arena_realloc(points->data, size) :
+            realloc(points->data, size));
+
+    if (data == NULL)
+    {
+        return -1;
+    }
+
+    points->data = data;
+    return 0;
+}
+
 /*
  * Add a point to points. (points are sorted by timestamp so the new point
  * will be inserted at the correct position.
@@ -92,44 +194,259 @@ void siridb_points_add_point(
 }
 
 /*
- * Returns siri_err and raises a SIGNAL in case an error has occurred.
+ * Sort points by timestamp. Points which are already sorted are detected
+ * with a single scan and left alone. Small arrays are sorted with insertion
+ * sort and larger ones with a stable LSD radix sort on the timestamp which
+ * skips bytes that are equal for all timestamps. (only the lower bytes are
+ * likely to differ in a batch)
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
  */
-int siridb_points_pack(siridb_points_t * points, qp_packer_t * packer)
+int siridb_points_sort(siridb_points_t * points)
 {
-    qp_add_type(packer, QP_ARRAY_OPEN);
-    if (points->len)
+    size_t i;
+    siridb_point_t *__restrict data = points->data;
+
+    for (i = 1; i < points->len && data[i - 1].ts <= data[i].ts; i++);
+
+    if (i >= points->len)
+    {
+        return 0;  /* already sorted */
+    }
+
+    if (points->len < POINTS_RADIX_MIN)
     {
-        siridb_point_t * point;
-        point = points->data;
-        switch (points->tp)
+        siridb_point_t tmp;
+        size_t j;
+
+        for (; i < points->len; i++)
         {
-        case TP_INT:
-            for (size_t i = 0; i < points->len; i++, point++)
-            {
-                qp_add_type(packer, QP_ARRAY2);
-                qp_add_int64(packer, (int64_t) point->ts);
-                qp_add_int64(packer, point->val.int64);
-            }
-            break;
-        case TP_DOUBLE:
-            for (size_t i = 0; i < points->len; i++, point++)
+            tmp = data[i];
+            for (j = i; j && data[j - 1].ts > tmp.ts; j--)
             {
-                qp_add_type(packer, QP_ARRAY2);
-                qp_add_int64(packer, (int64_t) point->ts);
-                qp_add_double(packer, point->val.real);
+                data[j] = data[j - 1];
             }
+            data[j] = tmp;
+        }
+        return 0;
+    }
+
+    return POINTS_radix_sort(points);
+}
+
+/*
+ * Add 'n' points to points which are sorted by timestamp. The new points do
+ * not need to be sorted; when they are they are appended with a single
+ * memcpy() in case they all follow the existing points, otherwise both
+ * arrays are merged from the back. Points with an equal timestamp are placed
+ * after the existing points, like siridb_points_add_point() does.
+ *
+ * Warning:
+ *      this functions assumes points to be large enough to hold the new
+ *      points and is therefore not safe. 'pts' may not point to data inside
+ *      'points'.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+int siridb_points_add_points(
+        siridb_points_t *__restrict points,
+        siridb_point_t *__restrict pts,
+        size_t n)
+{
+    siridb_points_t tmp = {
+            .len=n,
+            .tp=points->tp,
+            .flags=0,
+            .content=NULL,
+            .data=pts
+    };
+    size_t i;
+
+    if (!n)
+    {
+        return 0;
+    }
+
+    for (i = 1; i < n && pts[i - 1].ts <= pts[i].ts; i++);
+
+    if (i < n)
+    {
+        /* the new points are not sorted, sort a copy */
+        tmp.data = (siridb_point_t *) malloc(sizeof(siridb_point_t) * n);
+        if (tmp.data == NULL)
+        {
+            ERR_ALLOC
+            return -1;
+        }
+        memcpy(tmp.data, pts, sizeof(siridb_point_t) * n);
+
+        if (siridb_points_sort(&tmp))
+        {
+            free(tmp.data);
+            return -1;  /* signal is raised */
+        }
+    }
+
+    POINTS_merge_sorted(points, tmp.data, n);
+
+    if (tmp.data != pts)
+    {
+        free(tmp.data);
+    }
+    return 0;
+}
+
+/*
+ * Merge 'n' sorted runs in points into one sorted array. Run 'i' is located
+ * at points->data[runs[i]] till points->data[runs[i + 1]] so 'runs' must
+ * contain n + 1 offsets and runs[n] must be equal to points->len.
+ *
+ * Nothing is done when each run starts after the previous one ends, which is
+ * the case for series without overlapping shards. Otherwise a k-way merge
+ * using a heap on the head of each run is used so each point is moved only
+ * once. For equal timestamps the point from the lower run comes first.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+int siridb_points_merge_runs(
+        siridb_points_t * points,
+        size_t * runs,
+        size_t n)
+{
+    siridb_point_t *__restrict data = points->data;
+    siridb_point_t *__restrict dest;
+    points_run_t buf[POINTS_HEAP_SZ];
+    points_run_t * heap;
+    size_t i, k, pos;
+
+    /* skip empty runs and check if we need to merge at all */
+    for (i = 0, k = 0; i < n; i++)
+    {
+        if (runs[i] == runs[i + 1])
+        {
+            continue;
+        }
+        if (k && data[runs[i] - 1].ts > data[runs[i]].ts)
+        {
             break;
-        case TP_STRING:
-            /* TODO: handle string type */
-            assert (0);
-            break;
+        }
+        k++;
+    }
+
+    if (i == n)
+    {
+        return 0;  /* already sorted */
+    }
+
+    /* the number of runs depends on the data so the heap might not fit */
+    heap = (n <= POINTS_HEAP_SZ) ?
+            buf : (points_run_t *) malloc(sizeof(points_run_t) * n);
+
+    dest = (siridb_point_t *) malloc(sizeof(siridb_point_t) * points->len);
+    if (dest == NULL || heap == NULL)
+    {
+        ERR_ALLOC
+        free(dest);
+        if (heap != buf)
+        {
+            free(heap);
+        }
+        return -1;
+    }
+
+    for (i = 0, k = 0; i < n; i++)
+    {
+        if (runs[i] < runs[i + 1])
+        {
+            heap[k].pt = data + runs[i];
+            heap[k].end = data + runs[i + 1];
+            heap[k].run = i;
+            k++;
         }
     }
+
+    for (i = k / 2; i--;)
+    {
+        POINTS_heap_down(heap, k, i);
+    }
+
+    for (pos = 0; k; pos++)
+    {
+        dest[pos] = *heap->pt;
+
+        if (++heap->pt == heap->end)
+        {
+            heap[0] = heap[--k];
+        }
+
+        POINTS_heap_down(heap, k, 0);
+    }
+
+#ifdef DEBUG
+    assert (pos == points->len);
+#endif
+
+    /* copy back so the allocated size of points->data does not change */
+    memcpy(data, dest, sizeof(siridb_point_t) * points->len);
+    free(dest);
+
+    if (heap != buf)
+    {
+        free(heap);
+    }
+
+    return 0;
+}
+
+/*
+ * Returns siri_err and raises a SIGNAL in case an error has occurred.
+ */
+int siridb_points_pack(siridb_points_t * points, qp_packer_t * packer)
+{
+    qp_add_type(packer, QP_ARRAY_OPEN);
+    siridb_points_pack_items(points, packer);
     qp_add_type(packer, QP_ARRAY_CLOSE);
 
     return siri_err;
 }
 
+/*
+ * Pack the points without opening and closing the array so points which
+ * are read in chunks can be packed as one array.
+ *
+ * Returns siri_err and raises a SIGNAL in case an error has occurred.
+ */
+int siridb_points_pack_items(siridb_points_t * points, qp_packer_t * packer)
+{
+    siridb_point_t * point = points->data;
+
+    switch (points->tp)
+    {
+    case TP_INT:
+        for (size_t i = 0; i < points->len; i++, point++)
+        {
+            qp_add_type(packer, QP_ARRAY2);
+            qp_add_int64(packer, (int64_t) point->ts);
+            qp_add_int64(packer, point->val.int64);
+        }
+        break;
+    case TP_DOUBLE:
+        for (size_t i = 0; i < points->len; i++, point++)
+        {
+            qp_add_type(packer, QP_ARRAY2);
+            qp_add_int64(packer, (int64_t) point->ts);
+            qp_add_double(packer, point->val.real);
+        }
+        break;
+    case TP_STRING:
+        /* TODO: handle string type */
+        assert (!points->len);
+        break;
+    }
+
+    return siri_err;
+}
+
 /*
  * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
  */
@@ -148,6 +465,17 @@ inline int siridb_points_raw_pack(
 }
 
 /*
+ * Merge all points in plist into new points. The points in plist are
+ * destroyed and plist is empty when successful.
+ *
+ * Each series is sorted so a k-way merge using a loser tree is used which
+ * costs O(n log k) for n points in k series. Integer values are promoted to
+ * double while merging when both types are merged. For equal timestamps the
+ * point from the series with the lower position in plist comes first.
+ *
+ * A large number of points is split by timestamp in parts which are merged
+ * in parallel, see POINTS_merge_splits().
+ *
  * Returns NULL and raises a SIGNAL in case an error has occurred.
  * (err_msg is set when an error has occurred)
  * Use this function only when having at least two 'series' in the list.
@@ -157,11 +485,16 @@ siridb_points_t * siridb_points_merge(slist_t * plist, char * err_msg)
 #ifdef DEBUG
     assert (plist->len >= 2);
 #endif
+    points_part_t parts[POINTS_MERGE_THREADS];
+    uint64_t splits[POINTS_MERGE_THREADS - 1];
     siridb_points_t * points;
     siridb_points_t * tpts = NULL;
+    siridb_point_t * dest;
+    points_run_t * runs;
     size_t n = 0;
-    size_t i;
+    size_t i, p, nparts, start, end;
     uint8_t int2double = 0;
+    int rc = 0;
 
     for (i = 0; i < plist->len; )
     {
@@ -177,8 +510,11 @@ siridb_points_t * siridb_points_merge(slist_t * plist, char * err_msg)
             /* cleanup empty points */
             siridb_points_free(plist->data[i]);
 
-            /* shrink plist length and fill gap */
-            plist->data[i] = plist->data[plist->len];
+            /* shrink plist length and keep the order of the other series */
+            memmove(
+                plist->data + i,
+                plist->data + i + 1,
+                (plist->len - i) * sizeof(void *));
 
             continue;
         }
@@ -195,11 +531,6 @@ siridb_points_t * siridb_points_merge(slist_t * plist, char * err_msg)
             int2double = 1;
         }
 
-        /*
-         * Decrement the points->len so we can use this not truly as length
-         * property but as position of the last element.
-         */
-        points->len--;
         tpts = points;
         i++;
     }
@@ -211,280 +542,462 @@ siridb_points_t * siridb_points_merge(slist_t * plist, char * err_msg)
 
     if (plist->len == 1)
     {
-        /*
-         * Return the only left points since there is nothing to merge as set
-         * list length to 0. We do have to restore the points length since
-         * this is decremented by one.
-         */
-        points = (siridb_points_t *) slist_pop(plist);
-        points->len++;
-        return points;
+        /* return the only left points since there is nothing to merge */
+        return (siridb_points_t *) slist_pop(plist);
     }
 
     points = siridb_points_new(n, (int2double) ? TP_DOUBLE : tpts->tp);
+    if (points == NULL)
+    {
+        sprintf(err_msg, "Memory allocation error.");
+        return NULL;  /* signal is raised */
+    }
+
+    nparts = n / POINTS_MERGE_CHUNK_SZ + 1;
+    if (nparts > POINTS_MERGE_THREADS)
+    {
+        nparts = POINTS_MERGE_THREADS;
+    }
 
+    runs = (points_run_t *) malloc(
+            sizeof(points_run_t) * plist->len * nparts);
 
-    if (points == NULL)
+    if (runs == NULL || (nparts > 1 && POINTS_merge_splits(
+            plist,
+            splits,
+            nparts,
+            n)))
     {
+        if (runs == NULL)
+        {
+            ERR_ALLOC
+        }
+        free(runs);
+        siridb_points_free(points);
         sprintf(err_msg, "Memory allocation error.");
+        return NULL;  /* signal is raised */
     }
-    else
+
+    for (p = 0; p < nparts; p++)
     {
-        usleep(1000);
+        parts[p].runs = runs + p * plist->len;
+        parts[p].k = 0;
+        parts[p].n = 0;
+    }
 
-        /*
-         * When both series from type double and type integer are merged
-         * we need to promote the integer series to double.
-         */
-        if (int2double)
+    for (i = 0; i < plist->len; i++)
+    {
+        tpts = (siridb_points_t *) plist->data[i];
+
+        for (p = 0, start = 0; p < nparts; p++, start = end)
         {
-            size_t j;
-            for (i = 0; i < plist->len; i++)
+            end = (p == nparts - 1) ?
+                    tpts->len :
+                    start + POINTS_lower_bound(
+                            tpts->data + start,
+                            tpts->len - start,
+                            splits[p]);
+
+            if (start < end)
             {
-                tpts = (siridb_points_t *) plist->data[i];
-                if (tpts->tp == TP_INT)
-                {
-                    for (j = 0; j <= tpts->len; j++)
-                    {
-                        tpts->data[j].val.real =
-                                (double) tpts->data[j].val.int64;
-                    }
-                    usleep(100);
-                }
+                points_run_t * run = parts[p].runs + parts[p].k++;
+                run->pt = tpts->data + start;
+                run->end = tpts->data + end;
+                run->run = i;
+                run->int2double = int2double && tpts->tp == TP_INT;
+                parts[p].n += end - start;
             }
         }
+    }
+
+    for (p = 0, dest = points->data; p < nparts; p++)
+    {
+        parts[p].dest = dest;
+        dest += parts[p].n;
 
-        points->len = n;
+        /* the last part is merged by this thread, like the ones which
+         * cannot be started in a new thread */
+        parts[p].has_thread = (p < nparts - 1 && uv_thread_create(
+                &parts[p].thread,
+                (uv_thread_cb) POINTS_merge_part,
+                &parts[p]) == 0);
 
-        /*
-         * Select a merge method depending on the ratio series and points.
-         */
-        if (plist->len < 4)
-        {
-            POINTS_sort_while_merge(plist, points);
-        }
-        else if (n == plist->len || n < POINTS_MAX_QSORT)
+        if (!parts[p].has_thread)
         {
-            POINTS_merge_and_sort(plist, points);
+            POINTS_merge_part(&parts[p]);
         }
-        else
+    }
+
+    for (p = 0; p < nparts; p++)
+    {
+        if (parts[p].has_thread)
         {
-            POINTS_highest_and_merge(plist, points);
+            uv_thread_join(&parts[p].thread);
         }
+        rc |= parts[p].rc;
     }
+
+    free(runs);
+
+    if (rc)
+    {
+        /* the points in plist are cleared by the caller */
+        siridb_points_free(points);
+        sprintf(err_msg, "Memory allocation error.");
+        return NULL;  /* signal is raised */
+    }
+
+    points->len = n;
+
+    while (plist->len)
+    {
+        siridb_points_free((siridb_points_t *) slist_pop(plist));
+    }
+
     return points;
 }
 
 /*
- * This merge method works best when having both a lot of series and having
- * any number of points for each series.
+ * Returns points allocated in an arena or NULL and raises a SIGNAL in case
+ * an error has occurred.
  */
-static void POINTS_highest_and_merge(slist_t * plist, siridb_points_t * points)
+static siridb_points_t * POINTS_arena_new(
+        siridb_arena_t * arena,
+        size_t size,
+        points_tp tp)
 {
-    siridb_points_t ** m = NULL;
-    size_t i, n, l = 0;
-    siridb_points_t ** tpts;
-    uint64_t highest = 0;
-    n = points->len;
+    siridb_points_t * points = (siridb_points_t *) siridb_arena_malloc(
+            arena,
+            sizeof(siridb_points_t));
+    if (points == NULL)
+    {
+        ERR_ALLOC
+        return NULL;
+    }
 
-    while (plist->len)
+    points->len = 0;
+    points->tp = tp;
+    points->flags = SIRIDB_POINTS_FLAG_ARENA;
+    points->content = NULL;
+    points->data = (siridb_point_t *) siridb_arena_malloc(
+            arena,
+            sizeof(siridb_point_t) * size);
+    if (points->data == NULL)
+    {
+        ERR_ALLOC
+        siridb_arena_free(points);
+        return NULL;
+    }
+
+    return points;
+}
+
+/*
+ * Set 'nparts - 1' timestamps in splits which divide the merged points in
+ * parts of about equal size. Each series is sampled at 'nparts' evenly
+ * spaced positions and each sample counts for the points up to the next
+ * sample.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+static int POINTS_merge_splits(
+        slist_t * plist,
+        uint64_t * splits,
+        size_t nparts,
+        size_t n)
+{
+    siridb_points_t * points;
+    points_sample_t * samples = (points_sample_t *) malloc(
+            sizeof(points_sample_t) * plist->len * nparts);
+    size_t i, j, ns = 0, p = 1, count = 0;
+
+    if (samples == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    for (i = 0; i < plist->len; i++)
     {
-        if (m != NULL)
+        points = (siridb_points_t *) plist->data[i];
+        for (j = 0; j < nparts; j++, ns++)
         {
-            tpts = m;
-            m = NULL;
-            for (; l < plist->len; l++, tpts++)
-            {
-                if (((*tpts)->data + (*tpts)->len)->ts == highest)
-                {
-                    m = tpts;
-                    break;
-                }
-            }
+            samples[ns].ts = points->data[points->len * j / nparts].ts;
+            samples[ns].n =
+                    points->len * (j + 1) / nparts - points->len * j / nparts;
         }
+    }
 
-        if (m == NULL)
-        {
-            m = (siridb_points_t **) plist->data;
+    qsort(samples, ns, sizeof(points_sample_t), &POINTS_sample_cmp);
 
-            for (i = 1, tpts = m + 1; i < plist->len; i++, tpts++)
-            {
-                if (((*tpts)->data + (*tpts)->len)->ts >
-                    ((*m)->data + (*m)->len)->ts)
-                {
-                    m = tpts;
-                    l = i;
-                    highest = ((*m)->data + (*m)->len)->ts;
-                }
-            }
+    for (i = 0; i < ns; i++)
+    {
+        for (; p < nparts && count >= n * p / nparts; p++)
+        {
+            splits[p - 1] = samples[i].ts;
         }
+        count += samples[i].n;
+    }
+
+    for (; p < nparts; p++)
+    {
+        splits[p - 1] = samples[ns - 1].ts;
+    }
 
-        points->data[--n] = (*m)->data[(*m)->len];
+    free(samples);
+
+    return 0;
+}
+
+static int POINTS_sample_cmp(const void * a, const void * b)
+{
+    uint64_t ta = ((const points_sample_t *) a)->ts;
+    uint64_t tb = ((const points_sample_t *) b)->ts;
+    return (ta > tb) - (ta < tb);
+}
 
-        if ((*m)->len--)
+/*
+ * Returns the position of the first point with a timestamp equal to or
+ * higher than ts, or n when there is no such point.
+ */
+static size_t POINTS_lower_bound(
+        siridb_point_t * pts,
+        size_t n,
+        uint64_t ts)
+{
+    size_t lo = 0, hi = n, mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (pts[mid].ts < ts)
         {
-            m++;
-            l++;
+            lo = mid + 1;
         }
         else
         {
-            siridb_points_free(*m);
-
-            if (--plist->len)
-            {
-                *m = (siridb_points_t *) plist->data[plist->len];
-            }
-        }
-
-        if (!(n % MAX_ITERATE_MERGE_COUNT))
-        {
-            usleep(3000);
+            hi = mid;
         }
     }
-#ifdef DEBUG
-    /* size should be exactly zero */
-    assert (n == 0);
-#endif
-}
 
+    return lo;
+}
 
 /*
- * This merge method works best for only a few series with possible a lot
- * of points.
+ * Merge the runs of a part using a loser tree. Leaf 'i' is stored at
+ * position 'k + i' and each inner node holds the run which lost the match
+ * at that node, so only the path from the winning leaf to the root is
+ * played again after a point is taken. An exhausted run loses each match.
+ *
+ * part->rc is set to 0 if successful or -1 and a SIGNAL is raised in case
+ * of an error.
  */
-static void POINTS_sort_while_merge(slist_t * plist, siridb_points_t * points)
+static void POINTS_merge_part(points_part_t * part)
 {
-    siridb_points_t ** m;
-    size_t i, n;
-    siridb_points_t ** tpts;
-    n = points->len;
+    points_run_t * runs = part->runs;
+    siridb_point_t * dest = part->dest;
+    size_t k = part->k;
+    size_t * tree;
+    size_t i, w, tmp;
 
-    while (plist->len)
+    part->rc = 0;
+
+    if (!k)
     {
-        m = (siridb_points_t **) plist->data;
+        return;
+    }
 
-        for (i = 1, tpts = m + 1; i < plist->len; i++, tpts++)
+    tree = (size_t *) malloc(sizeof(size_t) * 2 * k);
+    if (tree == NULL)
+    {
+        ERR_ALLOC
+        part->rc = -1;
+        return;
+    }
+
+    for (i = 0; i < k; i++)
+    {
+        tree[k + i] = i;
+    }
+
+    /* first store the winner of each match, bottom up... */
+    for (i = k; --i;)
+    {
+        tree[i] = POINTS_run_lt(runs + tree[2 * i + 1], runs + tree[2 * i]) ?
+                tree[2 * i + 1] : tree[2 * i];
+    }
+
+    w = (k > 1) ? tree[1] : 0;
+
+    /* ...and replace them with the loser, top down */
+    for (i = 1; i < k; i++)
+    {
+        tree[i] = (tree[i] == tree[2 * i]) ? tree[2 * i + 1] : tree[2 * i];
+    }
+
+    for (i = part->n; i--; dest++)
+    {
+        if (runs[w].int2double)
         {
-            if (((*tpts)->data + (*tpts)->len)->ts >
-                ((*m)->data + (*m)->len)->ts)
-            {
-                m = tpts;
-            }
+            dest->ts = runs[w].pt->ts;
+            dest->val.real = (double) runs[w].pt->val.int64;
+        }
+        else
+        {
+            *dest = *runs[w].pt;
         }
 
-        points->data[--n] = (*m)->data[(*m)->len];
+        runs[w].pt++;
 
-        if (!(*m)->len--)
+        for (tmp = (k + w) / 2; tmp; tmp /= 2)
         {
-            siridb_points_free(*m);
-
-            if (--plist->len)
+            if (POINTS_run_lt(runs + tree[tmp], runs + w))
             {
-                *m = (siridb_points_t *) plist->data[plist->len];
+                size_t loser = w;
+                w = tree[tmp];
+                tree[tmp] = loser;
             }
         }
-
-        if (!(n % MAX_ITERATE_MERGE_COUNT))
-        {
-            usleep(3000);
-        }
     }
-#ifdef DEBUG
-    /* size should be exactly zero */
-    assert (n == 0);
-#endif
+
+    free(tree);
 }
 
 /*
- * This merge method works best when having a lot of series with only one point
- * or when the total number of points it not so high.
+ * Returns 1 when run 'a' should go before run 'b'. Runs are ordered by the
+ * timestamp of their current point and next by run number, exhausted runs
+ * go last.
  */
-static void POINTS_merge_and_sort(slist_t * plist, siridb_points_t * points)
+static inline int POINTS_run_lt(points_run_t * a, points_run_t * b)
 {
-    siridb_points_t ** m;
-    size_t i, n;
-    n = points->len;
-    uint8_t use_simple_sort = n == plist->len;
+    return a->pt != a->end && (b->pt == b->end || POINTS_RUN_LT(a, b));
+}
 
-    while (plist->len)
+/*
+ * Stable LSD radix sort on the timestamp using one byte per pass. A pass is
+ * skipped when all timestamps have the same value for that byte.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+static int POINTS_radix_sort(siridb_points_t * points)
+{
+    size_t counts[8][256];
+    size_t i, n = points->len;
+    uint_fast8_t b;
+    siridb_point_t * src = points->data;
+    siridb_point_t * dest, * tmp;
+    siridb_point_t * buf =
+            (siridb_point_t *) malloc(sizeof(siridb_point_t) * n);
+
+    if (buf == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    memset(counts, 0, sizeof(counts));
+
+    for (i = 0; i < n; i++)
     {
-        for (i = 0; i < plist->len; i++)
+        uint64_t ts = src[i].ts;
+        for (b = 0; b < 8; b++, ts >>= 8)
         {
-            m = (siridb_points_t **) &plist->data[i];
+            counts[b][ts & 0xff]++;
+        }
+    }
 
-            points->data[--n] = (*m)->data[(*m)->len];
+    dest = buf;
 
-            if (!(*m)->len--)
-            {
-                siridb_points_free(*m);
-                if (--plist->len)
-                {
-                    *m = (siridb_points_t *) plist->data[plist->len];
-                }
-            }
+    for (b = 0; b < 8; b++)
+    {
+        size_t * count = counts[b];
+        size_t offset, c;
+        uint_fast8_t shift = b * 8;
 
-            if (!(n % MAX_ITERATE_MERGE_COUNT))
-            {
-                usleep(3000);
-            }
+        if (count[(src->ts >> shift) & 0xff] == n)
+        {
+            continue;  /* all timestamps share this byte */
         }
-    }
 
-#ifdef DEBUG
-    /* size should be exactly zero */
-    assert (n == 0);
-#endif
+        for (i = 0, offset = 0; i < 256; i++)
+        {
+            c = count[i];
+            count[i] = offset;
+            offset += c;
+        }
 
-    usleep(5000);
+        for (i = 0; i < n; i++)
+        {
+            dest[count[(src[i].ts >> shift) & 0xff]++] = src[i];
+        }
 
-    if (use_simple_sort)
-    {
-        POINTS_simple_sort(points);
+        tmp = src;
+        src = dest;
+        dest = tmp;
     }
-    else
+
+    if (src != points->data)
     {
-        qsort(  points->data,
-                points->len,
-                sizeof(siridb_point_t),
-                &POINTS_compare);
+        memcpy(points->data, src, sizeof(siridb_point_t) * n);
     }
-}
 
-inline static int POINTS_compare(const void * a, const void * b)
-{
-    return (((siridb_point_t *) a)->ts - ((siridb_point_t *) b)->ts);
+    free(buf);
+
+    return 0;
 }
+
 /*
- * Sort points by time-stamp.
- *
- * Warning: this function should only be used in another thread.
+ * Merge sorted 'pts' into sorted points, see siridb_points_add_points().
  */
-static void POINTS_simple_sort(siridb_points_t * points)
+static void POINTS_merge_sorted(
+        siridb_points_t *__restrict points,
+        siridb_point_t *__restrict pts,
+        size_t n)
 {
-    if (points->len < 2)
+    siridb_point_t *__restrict data = points->data;
+    size_t i = points->len;
+    size_t k = i + n;
+
+    points->len = k;
+
+    if (!i || data[i - 1].ts <= pts->ts)
     {
-        return;  /* nothing to do... */
+        /* append, the most common case */
+        memcpy(data + i, pts, sizeof(siridb_point_t) * n);
+        return;
     }
-    size_t n = 0;
-    size_t i;
-    siridb_point_t * pa, * pb;
-    siridb_point_t tmp;
-    while(++n < points->len)
+
+    while (n)
+    {
+        data[--k] = (i && data[i - 1].ts > pts[n - 1].ts) ?
+                data[--i] : pts[--n];
+    }
+}
+
+/*
+ * Restore the heap property for the run at position 'i'. Runs are ordered
+ * by the timestamp of their current point and next by run number.
+ */
+static void POINTS_heap_down(points_run_t * heap, size_t n, size_t i)
+{
+    points_run_t tmp;
+    size_t c;
+
+    while ((c = 2 * i + 1) < n)
     {
-        pa = points->data + n - 1;
-        pb = points->data + n;
-        if (pa->ts > pb->ts)
+        if (c + 1 < n && POINTS_RUN_LT(heap + c + 1, heap + c))
         {
-            tmp = points->data[n];
-            i = n;
-            do
-            {
-                points->data[i] = points->data[i - 1];
-            }
-            while (--i && points->data[i - 1].ts > tmp.ts);
-            points->data[i] = tmp;
+            c++;
+        }
 
-            usleep(100);
+        if (!POINTS_RUN_LT(heap + c, heap + i))
+        {
+            break;
         }
+
+        tmp = heap[i];
+        heap[i] = heap[c];
+        heap[c] = tmp;
+        i = c;
     }
 }
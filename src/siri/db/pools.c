@@ -7,11 +7,14 @@
  *
  * changes
  *  - initial version, 04-05-2016
+ *  - the lookup uses the lookup version of the database, 18-10-2026
+ *  - close the insert pipelines, 18-10-2026
  */
 
 #include <assert.h>
 #include <llist/llist.h>
 #include <logger/logger.h>
+#include <siri/db/pipeline.h>
 #include <siri/db/pools.h>
 #include <siri/db/server.h>
 #include <siri/net/promises.h>
@@ -65,6 +68,7 @@ void siridb_pools_init(siridb_t * siridb)
     for (n = 0; n < siridb->pools->len; n++)
     {
         siridb->pools->pool[n].len = 0;
+        siridb->pools->pool[n].pipeline = NULL;
     }
 
     /* signal can be raised if creating a fifo buffer fails */
@@ -73,7 +77,9 @@ void siridb_pools_init(siridb_t * siridb)
     siridb->pools->prev_lookup = NULL;
 
     /* generate pool lookup for series */
-    siridb->pools->lookup = siridb_lookup_new(siridb->pools->len);
+    siridb->pools->lookup = siridb_lookup_new(
+            siridb->pools->len,
+            siridb->lookup_version);
     if (siridb->pools->lookup == NULL)
     {
         siridb_pools_free(siridb->pools);
@@ -82,11 +88,35 @@ void siridb_pools_init(siridb_t * siridb)
     }
 }
 
+/*
+ * Close the insert pipelines. Queued inserts are cancelled so this must be
+ * called before the servers are destroyed.
+ */
+void siridb_pools_close(siridb_pools_t * pools)
+{
+    for (uint16_t n = 0; n < pools->len; n++)
+    {
+        if (pools->pool[n].pipeline != NULL)
+        {
+            siridb_pipeline_close(pools->pool[n].pipeline);
+            pools->pool[n].pipeline = NULL;
+        }
+    }
+}
+
 /*
  * Destroy pools. (parsing NULL is NOT allowed)
+ *
+ * The insert pipelines must be closed using siridb_pools_close().
  */
 void siridb_pools_free(siridb_pools_t * pools)
 {
+#ifdef DEBUG
+    for (uint16_t n = 0; n < pools->len; n++)
+    {
+        assert (pools->pool[n].pipeline == NULL);
+    }
+#endif
     free(pools->pool);
     siridb_lookup_free(pools->lookup);
     siridb_lookup_free(pools->prev_lookup);
@@ -107,7 +137,9 @@ siridb_pool_t * siridb_pools_append(
         siridb_server_t * server)
 {
     siridb_pool_t * pool = NULL;
-    siridb_lookup_t * lookup = siridb_lookup_new(pools->len + 1);
+    siridb_lookup_t * lookup = siridb_lookup_new(
+            pools->len + 1,
+            pools->lookup->version);
     if (lookup != NULL)
     {
         pool = (siridb_pool_t *)
@@ -122,6 +154,7 @@ siridb_pool_t * siridb_pools_append(
             pools->pool = pool;
             pool = &pools->pool[pools->len];
             pool->len = 0;
+            pool->pipeline = NULL;
             siridb_pool_add_server(pool, server);
             pools->len++;
 #ifdef DEBUG
@@ -7,6 +7,9 @@
  *
  * changes
  *  - initial version, 17-03-2016
+ *  - added insert_queue and insert_queue_size, 18-10-2026
+ *  - added lookup_version, 18-10-2026
+ *  - added dropped_points, 18-10-2026
  *
  */
 #include <assert.h>
@@ -57,6 +60,10 @@ static void prop_drop_threshold(
         siridb_t * siridb,
         qp_packer_t * packer,
         int map);
+static void prop_dropped_points(
+        siridb_t * siridb,
+        qp_packer_t * packer,
+        int map);
 static void prop_duration_log(
         siridb_t * siridb,
         qp_packer_t * packer,
@@ -65,6 +72,14 @@ static void prop_duration_num(
         siridb_t * siridb,
         qp_packer_t * packer,
         int map);
+static void prop_insert_queue(
+        siridb_t * siridb,
+        qp_packer_t * packer,
+        int map);
+static void prop_insert_queue_size(
+        siridb_t * siridb,
+        qp_packer_t * packer,
+        int map);
 static void prop_ip_support(
         siridb_t * siridb,
         qp_packer_t * packer,
@@ -77,6 +92,10 @@ static void prop_log_level(
         siridb_t * siridb,
         qp_packer_t * packer,
         int map);
+static void prop_lookup_version(
+        siridb_t * siridb,
+        qp_packer_t * packer,
+        int map);
 static void prop_max_open_files(
         siridb_t * siridb,
         qp_packer_t * packer,
@@ -161,10 +180,16 @@ void siridb_init_props(void)
             prop_dbpath;
     siridb_props[CLERI_GID_K_DROP_THRESHOLD - KW_OFFSET] =
             prop_drop_threshold;
+    siridb_props[CLERI_GID_K_DROPPED_POINTS - KW_OFFSET] =
+            prop_dropped_points;
     siridb_props[CLERI_GID_K_DURATION_LOG - KW_OFFSET] =
             prop_duration_log;
     siridb_props[CLERI_GID_K_DURATION_NUM - KW_OFFSET] =
             prop_duration_num;
+    siridb_props[CLERI_GID_K_INSERT_QUEUE - KW_OFFSET] =
+            prop_insert_queue;
+    siridb_props[CLERI_GID_K_INSERT_QUEUE_SIZE - KW_OFFSET] =
+            prop_insert_queue_size;
     siridb_props[CLERI_GID_K_IP_SUPPORT - KW_OFFSET] =
             prop_ip_support;
     siridb_props[CLERI_GID_K_LIBUV - KW_OFFSET] =
@@ -175,6 +200,8 @@ void siridb_init_props(void)
             prop_mem_usage;
     siridb_props[CLERI_GID_K_LOG_LEVEL - KW_OFFSET] =
             prop_log_level;
+    siridb_props[CLERI_GID_K_LOOKUP_VERSION - KW_OFFSET] =
+            prop_lookup_version;
     siridb_props[CLERI_GID_K_OPEN_FILES - KW_OFFSET] =
             prop_open_files;
     siridb_props[CLERI_GID_K_POOL - KW_OFFSET] =
@@ -259,6 +286,15 @@ static void prop_drop_threshold(
     qp_add_double(packer, siridb->drop_threshold);
 }
 
+static void prop_dropped_points(
+        siridb_t * siridb,
+        qp_packer_t * packer,
+        int map)
+{
+    SIRIDB_PROP_MAP("dropped_points", 14)
+    qp_add_int64(packer, (int64_t) siridb->dropped_points);
+}
+
 static void prop_duration_log(
         siridb_t * siridb,
         qp_packer_t * packer,
@@ -277,6 +313,24 @@ static void prop_duration_num(
     qp_add_int64(packer, (int64_t) siridb->duration_num);
 }
 
+static void prop_insert_queue(
+        siridb_t * siridb,
+        qp_packer_t * packer,
+        int map)
+{
+    SIRIDB_PROP_MAP("insert_queue", 12)
+    qp_add_int64(packer, (int64_t) siridb->insert_queue);
+}
+
+static void prop_insert_queue_size(
+        siridb_t * siridb,
+        qp_packer_t * packer,
+        int map)
+{
+    SIRIDB_PROP_MAP("insert_queue_size", 17)
+    qp_add_int64(packer, (int64_t) siridb->insert_queue_size);
+}
+
 static void prop_ip_support(
         siridb_t * siridb,
         qp_packer_t * packer,
@@ -304,6 +358,15 @@ static void prop_log_level(
     qp_add_string(packer, Logger.level_name);
 }
 
+static void prop_lookup_version(
+        siridb_t * siridb,
+        qp_packer_t * packer,
+        int map)
+{
+    SIRIDB_PROP_MAP("lookup_version", 14)
+    qp_add_int64(packer, (int64_t) siridb->lookup_version);
+}
+
 static void prop_max_open_files(
         siridb_t * siridb,
         qp_packer_t * packer,
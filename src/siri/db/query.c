@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 10-03-2016
+ *  - added an arena for memory used by the query, 18-10-2026
  *
  */
 #include <assert.h>
@@ -94,6 +95,15 @@ void siridb_query_run(
         return;
     }
 
+    if (siridb_arena_init(&query->arena))
+    {
+        log_critical("Cannot initialize the arena for a query");
+        free(query->q);
+        free(query);
+        free(handle);
+        return;
+    }
+
     /*
      * Set start time.
      * (must be real time since we translate now with this value)
@@ -174,6 +184,9 @@ void siridb_query_free(uv_handle_t * handle)
     /* decrement client reference counter */
     sirinet_socket_decref(query->client);
 
+    /* release all memory in the arena, the query data is freed already */
+    siridb_arena_destroy(&query->arena);
+
     /* free query */
     free(query);
 
@@ -7,20 +7,76 @@
  *
  * changes
  *  - initial version, 04-08-2016
+ *  - added JIT compilation and a compiled expression cache, 18-10-2026
  *
+ * Info RE_mutex:
+ *
+ *  All threads:
+ *      cache and re->ref :     read (lock)         write (lock)
+ *
+ *  A compiled expression itself is read-only once it is created and can be
+ *  used by multiple threads at the same time. Each thread uses its own JIT
+ *  stack.
  */
 #include <assert.h>
+#include <ctree/ctree.h>
+#include <logger/logger.h>
 #include <siri/db/db.h>
 #include <siri/db/re.h>
+#include <ctype.h>
+#include <siri/err.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <uv.h>
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+#define RE_STUDY_OPTIONS PCRE_STUDY_JIT_COMPILE
+#else
+#define RE_STUDY_OPTIONS 0
+#endif
+
+typedef struct re_cache_s
+{
+    size_t len;
+    ct_t * ct;
+    siridb_re_t * first;    /* most recently used */
+    siridb_re_t * last;     /* least recently used */
+} re_cache_t;
+
+static void RE_init(void);
+static void RE_unlink(siridb_re_t * re);
+static void RE_push(siridb_re_t * re);
+static void RE_free(siridb_re_t * re);
+static int RE_set_prefix(siridb_re_t * re);
+static int RE_has_alternation(const char * pt, const char * end);
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+static pcre_jit_stack * RE_jit_stack_cb(void * data);
+static int RE_use_jit = 0;
+static uv_key_t RE_jit_key;
+#endif
+
+static uv_once_t RE_once = UV_ONCE_INIT;
+static uv_mutex_t RE_mutex;
+static re_cache_t RE_cache = {
+        .len=0,
+        .ct=NULL,
+        .first=NULL,
+        .last=NULL
+};
 
 /*
  * Compiles both a 'pcre' regular expression and 'pcre_extra' optimization if
- * the expression could be optimized.
+ * the expression could be optimized. When PCRE is build with JIT support the
+ * expression is JIT compiled too.
  *
  * When successful, 0 is returned. In case of an error, -1 is returned and
  * the 'err_msg' is set to an appropriate error message. Both 'regex' and
  * 'regex_extra' are NULL when an error is returned.
  *
+ * Use siridb_re_free_compiled() for destroying the result.
+ *
  * (SIRIDB_MAX_SIZE_ERR_MSG is honored for the error message)
  */
 int siridb_re_compile(
@@ -37,6 +93,8 @@ int siridb_re_compile(
     memcpy(pattern, source, len);
     pattern[0] = '^';
 
+    uv_once(&RE_once, RE_init);
+
     switch (pattern[--len])
     {
     case 'i':
@@ -53,6 +111,7 @@ int siridb_re_compile(
         break;
     }
 
+    *regex_extra = NULL;
     *regex = pcre_compile(
                 pattern,
                 options,
@@ -71,7 +130,14 @@ int siridb_re_compile(
         return -1;
     }
 
-    *regex_extra = pcre_study(*regex, 0, &pcre_error_str);
+#ifdef PCRE_STUDY_JIT_COMPILE
+    *regex_extra = pcre_study(
+            *regex,
+            RE_use_jit ? RE_STUDY_OPTIONS : 0,
+            &pcre_error_str);
+#else
+    *regex_extra = pcre_study(*regex, RE_STUDY_OPTIONS, &pcre_error_str);
+#endif
 
     /*
      * pcre_study() returns NULL for both errors and when it can not
@@ -88,11 +154,559 @@ int siridb_re_compile(
                 pcre_error_str);
 
         /* free and set regex back to NULL */
-        free(*regex);
+        siridb_re_free_compiled(*regex, *regex_extra);
         *regex = NULL;
+        *regex_extra = NULL;
 
         return -1;
     }
 
+#ifdef PCRE_STUDY_JIT_COMPILE
+    if (*regex_extra != NULL && RE_use_jit)
+    {
+        /* the call-back makes pcre use the JIT stack of the calling thread */
+        pcre_assign_jit_stack(*regex_extra, RE_jit_stack_cb, NULL);
+    }
+#endif
+
     return 0;
 }
+
+/*
+ * Destroy a compiled expression and the optional optimization.
+ */
+void siridb_re_free_compiled(pcre * regex, pcre_extra * regex_extra)
+{
+    if (regex_extra != NULL)
+    {
+#ifdef PCRE_STUDY_JIT_COMPILE
+        pcre_free_study(regex_extra);
+#else
+        pcre_free(regex_extra);
+#endif
+    }
+    if (regex != NULL)
+    {
+        pcre_free(regex);
+    }
+}
+
+/*
+ * Returns a compiled regular expression for the given source. The source
+ * must be in the 'pattern/flags' representation as used by the grammar, for
+ * example /^series/i. The source is used as key so the same expression
+ * with other flags is stored separately.
+ *
+ * The returned object has a reference which should be released with
+ * siridb_re_decref(). Recently used expressions are kept in the cache so
+ * they do not need to be compiled again.
+ *
+ * In case of an error NULL is returned and err_msg is set. (a SIGNAL might
+ * be raised in case of an allocation error)
+ */
+siridb_re_t * siridb_re_get(
+        const char * source,
+        size_t len,
+        char * err_msg)
+{
+    siridb_re_t * re;
+    char key[len + 1];
+
+    uv_once(&RE_once, RE_init);
+
+    memcpy(key, source, len);
+    key[len] = '\0';
+
+    uv_mutex_lock(&RE_mutex);
+
+    re = (RE_cache.ct == NULL) ?
+            NULL : (siridb_re_t *) ct_get(RE_cache.ct, key);
+
+    if (re != NULL)
+    {
+        /* move to the front since this is now the most recently used */
+        RE_unlink(re);
+        RE_push(re);
+        re->ref++;
+
+        uv_mutex_unlock(&RE_mutex);
+
+        return re;
+    }
+
+    uv_mutex_unlock(&RE_mutex);
+
+    /* compile without holding the lock */
+    re = (siridb_re_t *) malloc(sizeof(siridb_re_t));
+    if (re == NULL)
+    {
+        ERR_ALLOC
+        sprintf(err_msg, "Memory allocation error.");
+        return NULL;
+    }
+
+    re->ref = 1;
+    re->flags = 0;
+    re->prefix_len = 0;
+    re->prefix = NULL;
+    re->prev = NULL;
+    re->next = NULL;
+    re->regex = NULL;
+    re->regex_extra = NULL;
+    re->source_len = (uint32_t) len;
+    re->source = strndup(source, len);
+
+    if (re->source == NULL || RE_set_prefix(re))
+    {
+        ERR_ALLOC
+        sprintf(err_msg, "Memory allocation error.");
+        RE_free(re);
+        return NULL;
+    }
+
+    if (siridb_re_compile(
+            &re->regex,
+            &re->regex_extra,
+            source,
+            len,
+            err_msg))
+    {
+        RE_free(re);
+        return NULL;  /* err_msg is set */
+    }
+
+    uv_mutex_lock(&RE_mutex);
+
+    if (RE_cache.ct != NULL)
+    {
+        siridb_re_t * other;
+        void ** data = ct_get_sure(RE_cache.ct, key);
+
+        if (data == NULL)
+        {
+            /* not critical, we can use the expression without caching */
+            log_error("Cannot add regular expression to cache: '%s'", key);
+        }
+        else if (ct_is_empty(*data))
+        {
+            /* the cache holds a reference too */
+            re->ref++;
+            *data = re;
+            RE_push(re);
+            RE_cache.len++;
+
+            /* drop least recently used expressions */
+            while (RE_cache.len > SIRIDB_RE_CACHE_SZ)
+            {
+                other = RE_cache.last;
+                RE_unlink(other);
+                RE_cache.len--;
+                ct_pop(RE_cache.ct, other->source);
+                if (!--other->ref)
+                {
+                    RE_free(other);
+                }
+            }
+        }
+        else
+        {
+            /* another thread has compiled the same expression, use that one
+             * and destroy ours */
+            other = (siridb_re_t *) *data;
+            other->ref++;
+            RE_unlink(other);
+            RE_push(other);
+            RE_free(re);
+            re = other;
+        }
+    }
+
+    uv_mutex_unlock(&RE_mutex);
+
+    return re;
+}
+
+/*
+ * Returns 0 when the string matches the expression. (PCRE_ERROR_NOMATCH or
+ * another negative value when the string does not match)
+ *
+ * The literal prefix is used to reject most strings without calling pcre and
+ * a literal expression does not need pcre at all.
+ */
+int siridb_re_exec(siridb_re_t * re, const char * str, size_t len)
+{
+    if (re->prefix_len && (len < re->prefix_len || (
+            (re->flags & SIRIDB_RE_FLAG_CASELESS) ?
+                    strncasecmp(str, re->prefix, re->prefix_len) :
+                    memcmp(str, re->prefix, re->prefix_len))))
+    {
+        return PCRE_ERROR_NOMATCH;
+    }
+
+    if (re->flags & SIRIDB_RE_FLAG_LITERAL)
+    {
+        /* '$' matches at the end or before a final new line */
+        return (len == re->prefix_len || (
+                len == re->prefix_len + 1U &&
+                str[re->prefix_len] == '\n')) ? 0 : PCRE_ERROR_NOMATCH;
+    }
+
+    return pcre_exec(
+            re->regex,
+            re->regex_extra,
+            str,
+            (int) len,
+            0,                     // start looking at this point
+            0,                     // OPTIONS
+            NULL,
+            0);                    // length of sub_str_vec
+}
+
+/*
+ * Can be called from any thread.
+ */
+void siridb_re_incref(siridb_re_t * re)
+{
+    uv_mutex_lock(&RE_mutex);
+
+    re->ref++;
+
+    uv_mutex_unlock(&RE_mutex);
+}
+
+/*
+ * Can be called from any thread.
+ */
+void siridb_re_decref(siridb_re_t * re)
+{
+    uv_mutex_lock(&RE_mutex);
+
+    if (!--re->ref)
+    {
+        RE_free(re);
+    }
+
+    uv_mutex_unlock(&RE_mutex);
+}
+
+/*
+ * Destroy the cache. Expressions which are still in use stay valid until
+ * their last reference is released.
+ *
+ * Main thread. (should only be called while closing SiriDB)
+ */
+void siridb_re_cache_free(void)
+{
+    siridb_re_t * re;
+
+    uv_once(&RE_once, RE_init);
+
+    uv_mutex_lock(&RE_mutex);
+
+    while ((re = RE_cache.first) != NULL)
+    {
+        RE_unlink(re);
+        if (!--re->ref)
+        {
+            RE_free(re);
+        }
+    }
+
+    RE_cache.len = 0;
+
+    if (RE_cache.ct != NULL)
+    {
+        ct_free(RE_cache.ct, NULL);
+        RE_cache.ct = NULL;
+    }
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+    /* other threads keep their stack until the process exits */
+    pcre_jit_stack * jit_stack = (pcre_jit_stack *) uv_key_get(&RE_jit_key);
+    if (jit_stack != NULL)
+    {
+        uv_key_set(&RE_jit_key, NULL);
+        pcre_jit_stack_free(jit_stack);
+    }
+#endif
+
+    uv_mutex_unlock(&RE_mutex);
+}
+
+/*
+ * Called once, by the first thread using regular expressions.
+ */
+static void RE_init(void)
+{
+    uv_mutex_init(&RE_mutex);
+
+    RE_cache.ct = ct_new();  /* a signal is raised in case of failure */
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+    if (pcre_config(PCRE_CONFIG_JIT, &RE_use_jit) || !RE_use_jit)
+    {
+        log_info("PCRE has no JIT support, regular expressions are not "
+                "JIT compiled");
+        RE_use_jit = 0;
+    }
+    else if (uv_key_create(&RE_jit_key))
+    {
+        log_error("Cannot create JIT stack key, regular expressions are not "
+                "JIT compiled");
+        RE_use_jit = 0;
+    }
+#endif
+}
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+/*
+ * Returns the JIT stack for the calling thread. The stack is created on first
+ * use. When the stack cannot be created NULL is returned which makes pcre
+ * fall back to the (small) machine stack.
+ */
+static pcre_jit_stack * RE_jit_stack_cb(void * data)
+{
+    pcre_jit_stack * jit_stack = (pcre_jit_stack *) uv_key_get(&RE_jit_key);
+
+    if (jit_stack == NULL)
+    {
+        jit_stack = pcre_jit_stack_alloc(
+                SIRIDB_RE_JIT_STACK_START,
+                SIRIDB_RE_JIT_STACK_MAX);
+        if (jit_stack == NULL)
+        {
+            log_error("Cannot allocate JIT stack for regular expressions");
+        }
+        else
+        {
+            uv_key_set(&RE_jit_key, jit_stack);
+        }
+    }
+
+    return jit_stack;
+}
+#endif
+
+/*
+ * Remove an expression from the least recently used chain.
+ * (RE_mutex must be locked)
+ */
+static void RE_unlink(siridb_re_t * re)
+{
+    if (re->prev == NULL)
+    {
+        RE_cache.first = re->next;
+    }
+    else
+    {
+        re->prev->next = re->next;
+    }
+
+    if (re->next == NULL)
+    {
+        RE_cache.last = re->prev;
+    }
+    else
+    {
+        re->next->prev = re->prev;
+    }
+
+    re->prev = NULL;
+    re->next = NULL;
+}
+
+/*
+ * Add an expression in front of the least recently used chain.
+ * (RE_mutex must be locked)
+ */
+static void RE_push(siridb_re_t * re)
+{
+    re->prev = NULL;
+    re->next = RE_cache.first;
+
+    if (RE_cache.first == NULL)
+    {
+        RE_cache.last = re;
+    }
+    else
+    {
+        RE_cache.first->prev = re;
+    }
+
+    RE_cache.first = re;
+}
+
+static void RE_free(siridb_re_t * re)
+{
+    siridb_re_free_compiled(re->regex, re->regex_extra);
+    free(re->source);
+    free(re->prefix);
+    free(re);
+}
+
+/*
+ * Set the literal prefix which each match must start with. The expression
+ * is always anchored (see siridb_re_compile) so we can use the leading
+ * literal characters until the first meta character. When the expression
+ * has an alternation at top level there is no prefix.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ */
+static int RE_set_prefix(siridb_re_t * re)
+{
+    int caseless = (re->source[re->source_len - 1] == 'i');
+    const char * pt = re->source + 1;
+    const char * end = re->source + re->source_len - ((caseless) ? 2 : 1);
+    size_t n = 0;
+    size_t last = 0;
+    int literal = 0;
+    char c;
+
+    if (caseless)
+    {
+        re->flags |= SIRIDB_RE_FLAG_CASELESS;
+    }
+
+    if (pt > end || RE_has_alternation(pt, end))
+    {
+        return 0;
+    }
+
+    re->prefix = (char *) malloc(end - pt + 1);
+    if (re->prefix == NULL)
+    {
+        return -1;
+    }
+
+    /* a leading ^ is allowed since the expression is anchored anyway */
+    if (pt < end && *pt == '^')
+    {
+        pt++;
+    }
+
+    for (; n < UINT16_MAX; pt++)
+    {
+        if (pt == end)
+        {
+            literal = 1;
+            break;
+        }
+
+        c = *pt;
+
+        if (c == '\\')
+        {
+            /* only escaped non alpha-numeric characters are literals */
+            if (pt + 1 == end || isalnum((unsigned char) pt[1]))
+            {
+                break;
+            }
+            c = *(++pt);
+        }
+        else if (c == '?' || c == '*' || c == '{')
+        {
+            /* quantifier on the last literal so exclude that literal */
+            n = last;
+            break;
+        }
+        else if (strchr("+.[]()|^$}", c) != NULL)
+        {
+            break;
+        }
+
+        if (caseless && (c & 0x80))
+        {
+            /* case folding of non-ascii characters depends on the locale */
+            break;
+        }
+
+        last = n;
+        re->prefix[n++] = c;
+    }
+
+    re->prefix[n] = '\0';
+    re->prefix_len = (uint16_t) n;
+
+    if (literal)
+    {
+        re->flags |= SIRIDB_RE_FLAG_LITERAL;
+    }
+    else if (!n)
+    {
+        free(re->prefix);
+        re->prefix = NULL;
+    }
+
+    return 0;
+}
+
+/*
+ * Returns 1 when the pattern contains an alternation (|) at top level, or
+ * when the pattern cannot be checked. In other cases 0 is returned.
+ */
+static int RE_has_alternation(const char * pt, const char * end)
+{
+    int depth = 0;
+
+    for (; pt < end; pt++)
+    {
+        switch (*pt)
+        {
+        case '\\':
+            if (++pt == end)
+            {
+                return 1;
+            }
+            if (*pt == 'Q')
+            {
+                /* quoted sequences are not parsed */
+                return 1;
+            }
+            break;
+
+        case '[':
+            /* skip character class, a ] at the first position is literal */
+            pt++;
+            if (pt < end && *pt == '^')
+            {
+                pt++;
+            }
+            if (pt < end && *pt == ']')
+            {
+                pt++;
+            }
+            for (; pt < end && *pt != ']'; pt++)
+            {
+                if (*pt == '\\' && ++pt == end)
+                {
+                    return 1;
+                }
+            }
+            if (pt == end)
+            {
+                return 1;
+            }
+            break;
+
+        case '(':
+            depth++;
+            break;
+
+        case ')':
+            if (--depth < 0)
+            {
+                return 1;
+            }
+            break;
+
+        case '|':
+            if (!depth)
+            {
+                return 1;
+            }
+            break;
+        }
+    }
+
+    return depth != 0;
+}
@@ -7,6 +7,13 @@
  *
  * changes
  *  - initial version, 27-07-2016
+ *  - series are sent to their pool in the new lookup, 18-10-2026
+ *  - points are packed while reading the series, 18-10-2026
+ *
+ * A re-index is started when a pool is added or when the lookup version of
+ * the database is changed. In both cases 'pools->prev_lookup' is the lookup
+ * before the re-index and each series which has another pool in the new
+ * lookup is sent to that pool.
  *
  * Differences while re-indexing:
  *
@@ -27,6 +34,9 @@
 #include <logger/logger.h>
 #include <qpack/qpack.h>
 #include <siri/db/db.h>
+#include <siri/db/lookup.h>
+#include <siri/db/pool.h>
+#include <siri/db/pools.h>
 #include <siri/db/reindex.h>
 #include <siri/db/server.h>
 #include <siri/db/servers.h>
@@ -85,7 +95,7 @@ siridb_reindex_t * siridb_reindex_open(siridb_t * siridb, int create_new)
         reindex->next_series_id = NULL;
         reindex->pkg = NULL;
         reindex->timer = NULL;
-        reindex->server = NULL;
+        reindex->pool = 0;
         if (REINDEX_fn(siridb, reindex) < 0)
         {
             ERR_ALLOC
@@ -104,9 +114,9 @@ siridb_reindex_t * siridb_reindex_open(siridb_t * siridb, int create_new)
 
                 if (create_new)
                 {
-                    if (imap_walk(
+                    if (idmap_walk(
                                 siridb->series_map,
-                                (imap_cb) REINDEX_create_cb,
+                                (idmap_cb) REINDEX_create_cb,
                                 reindex->fp) || fflush(reindex->fp))
                     {
                         ERR_FILE
@@ -115,8 +125,19 @@ siridb_reindex_t * siridb_reindex_open(siridb_t * siridb, int create_new)
                 }
                 else
                 {
+                    /*
+                     * Restore the lookup before the re-index, the lookup
+                     * version differs when the lookup is migrated, otherwise
+                     * the last pool is new.
+                     */
                     siridb->pools->prev_lookup =
-                            siridb_lookup_new(siridb->pools->len - 1);
+                        (siridb->prev_lookup_version != siridb->lookup_version)
+                        ? siridb_lookup_new(
+                                siridb->pools->len,
+                                siridb->prev_lookup_version)
+                        : siridb_lookup_new(
+                                siridb->pools->len - 1,
+                                siridb->lookup_version);
                     if (siridb->pools->prev_lookup == NULL)
                     {
                         siridb_reindex_free(&reindex);  /* signal is raised */
@@ -125,7 +146,9 @@ siridb_reindex_t * siridb_reindex_open(siridb_t * siridb, int create_new)
 
                 if (reindex != NULL)
                 {
-                    reindex->size = ftello(reindex->fp);
+                    /* an existing file is opened at the start */
+                    reindex->size = fseeko(reindex->fp, 0, SEEK_END) ?
+                            -1 : ftello(reindex->fp);
                     if (reindex->size == -1)
                     {
                         ERR_FILE
@@ -162,8 +185,6 @@ siridb_reindex_t * siridb_reindex_open(siridb_t * siridb, int create_new)
                             }
                             else
                             {
-                                reindex->server = siridb->pools->pool[
-                                          siridb->pools->len -1].server[0];
                                 siridb->server->flags |= SERVER_FLAG_REINDEXING;
                                 reindex->timer->data = siridb;
                                 siri_optimize_pause();
@@ -188,6 +209,61 @@ siridb_reindex_t * siridb_reindex_open(siridb_t * siridb, int create_new)
     return reindex;
 }
 
+/*
+ * Change the lookup version and start a re-index which moves each series to
+ * its pool in the new lookup. This function must be called on all servers.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+int siridb_reindex_lookup(siridb_t * siridb, uint8_t version)
+{
+#ifdef DEBUG
+    assert (siridb->reindex == NULL);
+    assert (siridb->pools->prev_lookup == NULL);
+    assert (version < SIRIDB_LOOKUP_END);
+#endif
+    siridb_lookup_t * lookup = siridb_lookup_new(siridb->pools->len, version);
+
+    if (lookup == NULL)
+    {
+        return -1;  /* signal is raised */
+    }
+
+    siridb->pools->prev_lookup = siridb->pools->lookup;
+    siridb->pools->lookup = lookup;
+
+    siridb->prev_lookup_version = siridb->lookup_version;
+    siridb->lookup_version = version;
+
+    if (siridb_save(siridb))
+    {
+        log_critical("Could not save database changes (database: '%s')",
+                siridb->dbname);
+    }
+
+    log_info("Start migrating series in database '%s' to lookup version %u",
+            siridb->dbname,
+            version);
+
+    siridb->reindex = siridb_reindex_open(siridb, 1);
+    if (siridb->reindex == NULL)
+    {
+        return -1;  /* signal is raised */
+    }
+
+    if (siridb->reindex->timer == NULL)
+    {
+        /* no series on this server, check if the other servers are done */
+        siridb_reindex_status_update(siridb);
+    }
+    else
+    {
+        siridb_reindex_start(siridb->reindex->timer);
+    }
+
+    return 0;
+}
+
 /*
  * Returns a human readable re-index progress status
  */
@@ -293,6 +369,17 @@ void siridb_reindex_status_update(siridb_t * siridb)
         siridb_lookup_free(siridb->pools->prev_lookup);
         siridb->pools->prev_lookup = NULL;
 
+        if (siridb->prev_lookup_version != siridb->lookup_version)
+        {
+            siridb->prev_lookup_version = siridb->lookup_version;
+            if (siridb_save(siridb))
+            {
+                log_critical(
+                        "Could not save database changes (database: '%s')",
+                        siridb->dbname);
+            }
+        }
+
         REINDEX_unlink(siridb->reindex);
         siridb_reindex_free(&siridb->reindex);
         log_info("Finished re-indexing database '%s'", siridb->dbname);
@@ -340,24 +427,21 @@ static void REINDEX_send(uv_timer_t * timer)
 #ifdef DEBUG
     assert (siridb->reindex->pkg != NULL);
 #endif
-    /* actually 'available' is sufficient since the destination server has
-     * never status 're-indexing' unless one day we support down-scaling.
+    /*
+     * The package is sent as a pool package so the receiving server sends
+     * the series to its replica as well.
      */
-    if (siridb_server_is_accessible(siridb->reindex->server))
-    {
-        siridb_server_send_pkg(
-                siridb->reindex->server,
+    if (siridb_pool_send_pkg(
+                siridb->pools->pool + siridb->reindex->pool,
                 siridb->reindex->pkg,
                 REINDEX_TIMEOUT,
                 REINDEX_on_insert_response,
                 siridb,
-                FLAG_KEEP_PKG);
-    }
-    else
+                FLAG_KEEP_PKG))
     {
-        log_info("Cannot send re-index package to '%s' "
+        log_info("Cannot send re-index package to pool %u "
                 "(try again in %d seconds)",
-                siridb->reindex->server->name,
+                siridb->reindex->pool,
                 REINDEX_RETRY / 1000);
         uv_timer_start(
                 siridb->reindex->timer,
@@ -463,12 +547,17 @@ static void REINDEX_work(uv_timer_t * timer)
     assert (siridb->reindex->pkg == NULL);
 #endif
 
-    reindex->series = imap_get(siridb->series_map, *reindex->next_series_id);
+    reindex->series = idmap_get(siridb->series_map, *reindex->next_series_id);
+
+    if (reindex->series != NULL)
+    {
+        reindex->pool = siridb_lookup_sn(
+                siridb->pools->lookup,
+                reindex->series->name);
+    }
 
     if (    reindex->series == NULL ||
-            siridb_lookup_sn(
-                    siridb->pools->lookup,
-                    reindex->series->name) == siridb->server->pool ||
+            reindex->pool == siridb->server->pool ||
             (siridb->replica != NULL &&
              siridb_series_server_id(reindex->series) != siridb->server->id))
     {
@@ -477,59 +566,61 @@ static void REINDEX_work(uv_timer_t * timer)
     else
     {
         /*
-         * lock is not needed since we are sure the optimize task is
-         * not running
+         * The optimize task is not running but an insert worker thread might
+         * still add points to this series so we need both locks.
          */
 #ifdef DEBUG
         assert (siridb_lookup_sn(
                     siridb->pools->prev_lookup,
                     reindex->series->name) == siridb->server->pool);
 #endif
-        siridb_points_t * points = siridb_series_get_points(
-                reindex->series,
-                NULL,
-                NULL);
-
-        if (points != NULL)  /* signal is raised in case NULL */
+        qp_packer_t * packer = sirinet_packer_new(QP_SUGGESTED_SIZE);
+        if (packer != NULL)  /* signal is raised in case NULL */
         {
-            /*
-             * Prepare drop, increasing the reference counter is not needed
-             * since the series can only be decremented when dropped. since
-             * the series is not member of the siridb->series_map it will not
-             * be decremented there either.
-             */
+            int rc;
 
-            siridb_series_drop_prepare(siridb, reindex->series);
+            qp_add_type(packer, QP_MAP1);
 
-            qp_packer_t * packer = sirinet_packer_new(QP_SUGGESTED_SIZE);
-            if (packer != NULL)
-            {
-                qp_add_type(packer, QP_MAP1);
+            /* add series name including terminator char */
+            qp_add_raw(
+                    packer,
+                    reindex->series->name,
+                    reindex->series->name_len + 1);
 
-                /* add series name including terminator char */
-                qp_add_raw(
-                        packer,
-                        reindex->series->name,
-                        reindex->series->name_len + 1);
+            /* points are packed while reading so no copy is needed */
+            uv_mutex_lock(siridb_series_stripe(siridb, reindex->series));
+            uv_mutex_lock(&siridb->series_mutex);
 
-                if (siridb_points_pack(points, packer) == 0)
-                {
-                    reindex->pkg = sirinet_packer2pkg(
-                            packer,
-                            0,
-                            BPROTO_INSERT_TESTED_SERVER);
-                    uv_timer_start(
-                            reindex->timer,
-                            REINDEX_send,
-                            0,
-                            0);
-                }
-                else
-                {
-                    qp_packer_free(packer);  /* signal raised */
-                }
+            rc = siridb_series_pack_points(reindex->series, packer);
+
+            uv_mutex_unlock(&siridb->series_mutex);
+            uv_mutex_unlock(siridb_series_stripe(siridb, reindex->series));
+
+            if (rc == 0)
+            {
+                /*
+                 * Prepare drop, increasing the reference counter is not
+                 * needed since the series can only be decremented when
+                 * dropped. since the series is not member of the
+                 * siridb->series_map it will not be decremented there
+                 * either.
+                 */
+                siridb_series_drop_prepare(siridb, reindex->series);
+
+                reindex->pkg = sirinet_packer2pkg(
+                        packer,
+                        0,
+                        BPROTO_INSERT_TESTED_POOL);
+                uv_timer_start(
+                        reindex->timer,
+                        REINDEX_send,
+                        0,
+                        0);
+            }
+            else
+            {
+                qp_packer_free(packer);  /* signal raised */
             }
-            siridb_points_free(points);
         }
     }
 }
@@ -632,7 +723,7 @@ static void REINDEX_on_insert_response(
 }
 
 /*
- * Typedef: imap_cb
+ * Typedef: idmap_cb
  *
  * Returns 0 if successful
  */
@@ -8,6 +8,7 @@
  *
  * changes
  *  - initial version, 11-07-2016
+ *  - skip packages which are only kept for the write-ahead log, 18-10-2026
  *
  */
 #define _GNU_SOURCE
@@ -227,7 +228,20 @@ static void REPLICATE_work(uv_timer_t * handle)
                 siridb_server_is_synchronizing(siridb->replica)) &&
             (pkg = siridb_fifo_pop(siridb->fifo)) != NULL)
     {
-        if (siridb_server_send_pkg(
+        if (pkg->tp == BPROTO_INSERT_LOCAL)
+        {
+            /* points received from the replica, see siridb_wal_t */
+            free(pkg);
+            if (!siridb_fifo_commit(siridb->fifo))
+            {
+                uv_timer_start(
+                        siridb->replicate->timer,
+                        REPLICATE_work,
+                        0,
+                        0);
+            }
+        }
+        else if (siridb_server_send_pkg(
                 siridb->replica,
                 pkg,
                 REPLICATE_TIMEOUT,
@@ -291,7 +305,7 @@ sirinet_pkg_t * siridb_replicate_pkg_filter(
     qp_next(&unpacker, &qp_series_name); // first series or end
     while (qp_is_raw_term(&qp_series_name))
     {
-        series = (siridb_series_t *) ct_get(
+        series = (siridb_series_t *) art_get(
                 siridb->series,
                 qp_series_name.via.raw);
         if (series == NULL || (~series->flags & SIRIDB_SERIES_INIT_REPL))
@@ -7,6 +7,11 @@
  *
  * changes
  *  - initial version, 29-03-2016
+ *  - overlapping chunks are combined with a k-way merge, 18-10-2026
+ *  - points are kept in memory while the write-ahead log is on, 18-10-2026
+ *  - iterator for reading points in chunks, 18-10-2026
+ *  - resize points with siridb_points_resize(), 18-10-2026
+ *  - runs for optimizing a shard are allocated on the heap, 18-10-2026
  *
  * Info siridb->series_mutex:
  *
@@ -20,6 +25,24 @@
  *
  *  Note:   One exception to 'not allowed' are the free functions
  *          since they only run when no other references to the object exist.
+ *
+ * Info siridb_series_stripe(siridb, series):
+ *
+ *  All threads:
+ *      series->buffer :        read (lock)         write (lock)
+ *      series->length/start/end :                  write (lock)
+ *      series->idx :           read (lock)         write (lock)
+ *
+ *  Note:   The main thread may read length, start and end without a lock
+ *          and accepts the values to be outdated.
+ *
+ *  The index is written while holding both the stripe and series_mutex,
+ *  so reading the index requires only one of them. Shard files are read
+ *  while holding siri.fh->lock which is always locked last.
+ *
+ *  When both are required, the stripe must be locked before the
+ *  series_mutex. Adding points to a series locks the series_mutex and
+ *  shards_mutex only when points are written to shards.
  */
 #include <assert.h>
 #include <logger/logger.h>
@@ -28,6 +51,7 @@
 #include <siri/db/series.h>
 #include <siri/db/shard.h>
 #include <siri/db/shards.h>
+#include <siri/db/wal.h>
 #include <siri/err.h>
 #include <siri/siri.h>
 #include <stdio.h>
@@ -41,6 +65,30 @@
 #define SIRIDB_SERIES_SCHEMA 1
 #define BEND series->buffer->points->data[series->buffer->points->len - 1].ts
 #define DROPPED_DUMMY 1
+#define SERIES_ITER_RUNS 4
+
+#define SERIES_IDX_IN_RANGE(idx, start, end)                        \
+    ((start == NULL || idx->end_ts >= *start) &&                    \
+     (end == NULL || idx->start_ts < *end))
+
+/* compare two points by timestamp and the order of the runs */
+#define SERIES_RUN_LT(ts_a, order_a, ts_b, order_b)                 \
+    ((ts_a) < (ts_b) || ((ts_a) == (ts_b) && (order_a) < (order_b)))
+
+typedef struct series_slist_s
+{
+    siridb_t * siridb;
+    slist_t * slist;
+} series_slist_t;
+
+struct siridb_series_run_s
+{
+    siridb_point_t * pt;        /* next point */
+    siridb_point_t * end;
+    uint32_t order;             /* index position, UINT32_MAX for buffer */
+    uint32_t sz;                /* allocated size for points */
+    siridb_points_t * points;   /* read points, reused for a next run */
+};
 
 #define SERIES_GET_POINTS_CB(get_points_cb, series)       \
     siridb_shard_get_points_cb get_points_cb =          \
@@ -73,6 +121,17 @@ static siridb_series_t * SERIES_new(
         uint8_t tp,
         uint16_t pool,
         const char * name);
+static int SERIES_slist_ref_cb(uint32_t id, series_slist_t * w);
+static siridb_series_run_t * SERIES_iter_first(siridb_series_iter_t * iter);
+static int SERIES_iter_read(siridb_series_iter_t * iter, idx_t * idx);
+static int SERIES_buffer_reserve(
+        siridb_t *__restrict siridb,
+        siridb_series_t *__restrict series,
+        size_t n);
+static int SERIES_add_to_shards(
+        siridb_t * siridb,
+        siridb_series_t * series,
+        siridb_points_t * points);
 
 const char series_type_map[3][8] = {
         "integer",
@@ -118,6 +177,9 @@ int siridb_series_cexpr_cb(siridb_series_t * series, cexpr_condition_t * cond)
  *
  * -    This method will update the series->length but updating the time-stamps
  *      (series->start and series->end) should be done outside this function.
+ *
+ * -    The series stripe must be locked and the series_mutex and shards_mutex
+ *      must not be locked by the caller.
  */
 int siridb_series_add_point(
         siridb_t *__restrict siridb,
@@ -132,7 +194,20 @@ int siridb_series_add_point(
 
     series->length++;
 
-    if (series->buffer != NULL)
+    if (series->buffer != NULL && siridb_wal_is_on(siridb))
+    {
+        /* points are written at the next checkpoint */
+        if (SERIES_buffer_reserve(siridb, series, 1) ||
+            siridb_wal_dirty(siridb, series))
+        {
+            rc = -1;  /* signal is raised */
+        }
+        else
+        {
+            siridb_points_add_point(series->buffer, ts, val);
+        }
+    }
+    else if (series->buffer != NULL)
     {
         /* add point in memory
          * (memory can hold 1 more point than we can hold on disk)
@@ -141,10 +216,7 @@ int siridb_series_add_point(
 
         if (series->buffer->len == siridb->buffer_len)
         {
-            if (siridb_shards_add_points(
-                    siridb,
-                    series,
-                    series->buffer))
+            if (SERIES_add_to_shards(siridb, series, series->buffer))
             {
                 rc = -1;  /* signal is raised */
             }
@@ -181,17 +253,36 @@ int siridb_series_add_point(
  *
  * -    This method will update the series->length but updating the time-stamps
  *      (series->start and series->end) should be done outside this function.
+ *
+ * -    The series stripe must be locked and the series_mutex and shards_mutex
+ *      must not be locked by the caller.
+ *
+ * -    Points in the pcache must be sorted. (see siridb_points_sort())
  */
 int siridb_series_add_pcache(
         siridb_t *__restrict siridb,
         siridb_series_t *__restrict series,
         siridb_pcache_t *__restrict pcache)
 {
-    if (pcache->len > siridb->buffer_len)
+    if (series->buffer != NULL && siridb_wal_is_on(siridb))
+    {
+        /* points are written at the next checkpoint */
+        if (SERIES_buffer_reserve(siridb, series, pcache->len) ||
+            siridb_wal_dirty(siridb, series) ||
+            siridb_points_add_points(
+                    series->buffer,
+                    pcache->data,
+                    pcache->len))
+        {
+            return -1;  /* signal is raised */
+        }
+        series->length += pcache->len;
+    }
+    else if (pcache->len > siridb->buffer_len)
     {
         series->length += pcache->len;
 
-        if (siridb_shards_add_points(
+        if (SERIES_add_to_shards(
                 siridb,
                 series,
                 (siridb_points_t *) pcache))
@@ -203,20 +294,15 @@ int siridb_series_add_pcache(
     {
         series->length += pcache->len;
 
-        siridb_points_t *__restrict points = series->buffer;
-        size_t i = points->len;
-        siridb_point_t *__restrict point;
-
-        while (i--)
+        if (siridb_pcache_add_points(
+                pcache,
+                series->buffer->data,
+                series->buffer->len))
         {
-            point = points->data + i;
-            if (siridb_pcache_add_point(pcache, &point->ts, &point->val))
-            {
-                return -1;  /* signal is raised */
-            }
+            return -1;  /* signal is raised */
         }
 
-        if (siridb_shards_add_points(
+        if (SERIES_add_to_shards(
                 siridb,
                 series,
                 (siridb_points_t *) pcache))
@@ -254,11 +340,57 @@ int siridb_series_add_pcache(
     return 0;
 }
 
+/*
+ * Write points which are kept in memory while the write-ahead log is on.
+ * When the buffer is full, points are written to shards and the buffer is
+ * written with the given checkpoint.
+ *
+ * Returns 0 if successful; -1 and a SIGNAL is raised in case an error occurred.
+ *
+ * Warning: the series stripe must be locked and the series_mutex and
+ *          shards_mutex must not be locked by the caller.
+ */
+int siridb_series_flush_buffer(
+        siridb_t *__restrict siridb,
+        siridb_series_t *__restrict series,
+        uint32_t checkpoint)
+{
+    if (series->buffer->len >= siridb->buffer_len)
+    {
+        siridb_point_t * data;
+
+        if (SERIES_add_to_shards(siridb, series, series->buffer))
+        {
+            return -1;  /* signal is raised */
+        }
+
+        series->buffer->len = 0;
+
+        /* a smaller allocation cannot fail but we keep the old one if so */
+        data = (siridb_point_t *) realloc(
+                series->buffer->data,
+                sizeof(siridb_point_t) * siridb->buffer_len);
+        if (data != NULL)
+        {
+            series->buffer->data = data;
+        }
+    }
+
+    if (siridb_buffer_write_series(siridb, series, checkpoint))
+    {
+        ERR_FILE
+        log_critical("Cannot write buffer for series id %u", series->id);
+        return -1;
+    }
+
+    return 0;
+}
+
 /*
  * Returns NULL and raises a SIGNAL in case an error has occurred.
  *
  * This function adds the new series to siridb->series_map but not to
- * the compact tree: siridb->series.
+ * the radix tree: siridb->series.
  */
 siridb_series_t * siridb_series_new(
         siridb_t * siridb,
@@ -311,7 +443,7 @@ siridb_series_t * siridb_series_new(
          */
         else
         {
-            imap_add(siridb->series_map, series->id, series);
+            idmap_add(siridb->series_map, series->id, series);
             siridb_groups_add_series(siridb->groups, series);
         }
     }
@@ -483,12 +615,15 @@ int siridb_series_add_idx(
 void siridb_series_drop_prepare(siridb_t * siridb, siridb_series_t * series)
 {
     /* remove series from map */
-    imap_pop(siridb->series_map, series->id);
+    idmap_pop(siridb->series_map, series->id);
 
     /* remove series from tree */
-    ct_pop(siridb->series, series->name);
+    art_pop(siridb->series, series->name);
 
     series->flags |= SIRIDB_SERIES_IS_DROPPED;
+
+    /* a new series with the same name must not replay older points */
+    siridb_wal_drop(siridb);
 }
 
 /*
@@ -695,46 +830,111 @@ siridb_points_t * siridb_series_get_points(
         uint64_t *__restrict start_ts,
         uint64_t *__restrict end_ts)
 {
-    idx_t *__restrict idx;
+    siridb_series_iter_t iter;
+    siridb_points_t chunk;
     siridb_points_t *__restrict points;
-    siridb_point_t *__restrict point;
-    size_t len, size;
+    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
+    idx_t *__restrict idx;
+    size_t size;
     uint32_t i;
-    uint32_t indexes[series->idx_len];
-    len = i = size = 0;
+    int rc;
 
-    for (   idx = series->idx;
-            i < series->idx_len;
-            i++, idx++)
+    size = series->buffer->len;
+
+    for (idx = series->idx, i = 0; i < series->idx_len; i++, idx++)
     {
-        if (    (start_ts == NULL || idx->end_ts >= *start_ts) &&
-                (end_ts == NULL || idx->start_ts < *end_ts))
+        if (SERIES_IDX_IN_RANGE(idx, start_ts, end_ts))
         {
             size += idx->len;
-            indexes[len] = i;
-            len++;
         }
     }
 
-    size += series->buffer->len;
     points = siridb_points_new(size, series->tp);
-
     if (points == NULL)
     {
         return NULL;  /* signal is raised */
     }
 
-    SERIES_GET_POINTS_CB(get_points_cb, series)
+    if (siridb_series_iter_init(&iter, series, start_ts, end_ts))
+    {
+        siridb_points_free(points);
+        return NULL;  /* signal is raised */
+    }
 
-    for (i = 0; i < len; i++)
+    while ((rc = siridb_series_iter_next(&iter, &chunk, err_msg)) == 1)
     {
-        get_points_cb(
-                points,
-                series->idx + indexes[i],
-                start_ts,
-                end_ts,
-                series->flags & SIRIDB_SERIES_HAS_OVERLAP);
-        /* errors can be ignored here */
+        memcpy(
+            points->data + points->len,
+            chunk.data,
+            chunk.len * sizeof(siridb_point_t));
+        points->len += chunk.len;
+    }
+
+    siridb_series_iter_destroy(&iter);
+
+    if (rc)
+    {
+        siridb_points_free(points);
+        return NULL;  /* signal is raised */
+    }
+
+    if (points->len < size)
+    {
+        /* shrink allocation size */
+        if (siridb_points_resize(points, points->len))
+        {
+            log_error("Re-allocation points has failed");
+        }
+    }
+#ifdef DEBUG
+    else
+    {
+        /* size must be equal if not smaller */
+        assert (points->len == size);
+    }
+#endif
+
+    return points;
+}
+
+/*
+ * Initialize an iterator for reading the points of a series between
+ * start_ts and end_ts. (both may be NULL) The iterator must be destroyed
+ * using siridb_series_iter_destroy() when successful.
+ *
+ * (series stripe or series_mutex must be locked till destroyed)
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+int siridb_series_iter_init(
+        siridb_series_iter_t *__restrict iter,
+        siridb_series_t *__restrict series,
+        uint64_t *__restrict start_ts,
+        uint64_t *__restrict end_ts)
+{
+    siridb_series_run_t * run;
+    siridb_point_t * point;
+    size_t len;
+
+    iter->runs = (siridb_series_run_t *)
+            malloc(SERIES_ITER_RUNS * sizeof(siridb_series_run_t));
+    if (iter->runs == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    iter->series = series;
+    iter->start_ts = start_ts;
+    iter->end_ts = end_ts;
+    iter->pos = 0;
+    iter->n = 0;
+    iter->sz = SERIES_ITER_RUNS;
+
+    for (uint32_t i = 0; i < iter->sz; i++)
+    {
+        iter->runs[i].points = NULL;
+        iter->runs[i].sz = 0;
     }
 
     /* create pointer to buffer and get current length */
@@ -757,35 +957,244 @@ siridb_points_t * siridb_series_get_points(
                 p--, len--);
     }
 
-    /* add buffer points */
-    for (; len; point++, len--)
+    /* the buffer is the last run, points at equal timestamps come last */
+    if (len)
     {
-        siridb_points_add_point(points, &point->ts, &point->val);
+        run = iter->runs + iter->n++;
+        run->pt = point;
+        run->end = point + len;
+        run->order = UINT32_MAX;
     }
 
-    if (points->len < size)
+    return 0;
+}
+
+/*
+ * Call-back function: siridb_aggr_next_cb
+ *
+ * Sets chunk to the next points in time order. Shard chunks are read when
+ * they might contain a next point. When shard chunks overlap, the returned
+ * chunk ends where a point from another chunk should be next, so points
+ * are never copied. For equal timestamps the point from the chunk with the
+ * lower index comes first and points in the buffer come last, which is the
+ * same as siridb_points_merge_runs(). Read errors are logged and the shard
+ * chunk is skipped.
+ *
+ * The data in chunk is valid until the next call.
+ *
+ * Returns 1 if a chunk is set, 0 if all points are read or -1 and a SIGNAL
+ * is raised in case of an error.
+ */
+int siridb_series_iter_next(
+        siridb_series_iter_t *__restrict iter,
+        siridb_points_t *__restrict chunk,
+        char * err_msg)
+{
+    siridb_series_t * series = iter->series;
+    siridb_series_run_t * run, * first;
+    siridb_series_run_t tmp;
+    idx_t * idx;
+    uint64_t ts;
+    uint32_t i, order;
+
+    /* runs which are read are moved to the end so the points are reused */
+    for (i = 0; i < iter->n;)
     {
-        /* shrink allocation size */
-        point = (siridb_point_t *)
-                realloc(points->data, points->len * sizeof(siridb_point_t));
-        if (point == NULL && points->len)
+        run = iter->runs + i;
+        if (run->pt == run->end)
         {
-            log_error("Re-allocation points has failed");
+            tmp = *run;
+            *run = iter->runs[--iter->n];
+            iter->runs[iter->n] = tmp;
         }
         else
         {
-            points->data = point;
+            i++;
         }
     }
-#ifdef DEBUG
+
+    /* read shard chunks which start before the next point */
+    for (; iter->pos < series->idx_len; iter->pos++)
+    {
+        idx = series->idx + iter->pos;
+
+        if (iter->end_ts != NULL && idx->start_ts >= *iter->end_ts)
+        {
+            /* the index is sorted by start_ts */
+            iter->pos = series->idx_len;
+            break;
+        }
+
+        if (!SERIES_IDX_IN_RANGE(idx, iter->start_ts, iter->end_ts))
+        {
+            continue;
+        }
+
+        if (iter->n)
+        {
+            first = SERIES_iter_first(iter);
+            if (    idx->start_ts > first->pt->ts ||
+                    (idx->start_ts == first->pt->ts &&
+                     iter->pos > first->order))
+            {
+                break;
+            }
+        }
+
+        if (SERIES_iter_read(iter, idx))
+        {
+            sprintf(err_msg, "Memory allocation error.");
+            return -1;  /* signal is raised */
+        }
+    }
+
+    if (!iter->n)
+    {
+        return 0;
+    }
+
+    first = SERIES_iter_first(iter);
+
+    chunk->tp = series->tp;
+    chunk->content = NULL;
+    chunk->data = first->pt;
+
+    /* find the point which should follow the first run */
+    ts = UINT64_MAX;
+    order = UINT32_MAX;
+
+    for (i = 0; i < iter->n; i++)
+    {
+        run = iter->runs + i;
+        if (run != first && SERIES_RUN_LT(run->pt->ts, run->order, ts, order))
+        {
+            ts = run->pt->ts;
+            order = run->order;
+        }
+    }
+
+    if (iter->pos < series->idx_len)
+    {
+        idx = series->idx + iter->pos;
+        if (SERIES_RUN_LT(idx->start_ts, iter->pos, ts, order))
+        {
+            ts = idx->start_ts;
+            order = iter->pos;
+        }
+    }
+
+    if (    (ts == UINT64_MAX && order == UINT32_MAX) ||
+            SERIES_RUN_LT((first->end - 1)->ts, first->order, ts, order))
+    {
+        /* nothing in between, which is the case without overlap */
+        first->pt = first->end;
+    }
     else
     {
-        /* size must be equal if not smaller */
-        assert (points->len == size);
+        do
+        {
+            first->pt++;
+        }
+        while ( first->pt < first->end &&
+                SERIES_RUN_LT(first->pt->ts, first->order, ts, order));
     }
-#endif
 
-    return points;
+    chunk->len = first->pt - chunk->data;
+
+    return 1;
+}
+
+/*
+ * Destroy an iterator. (the iterator itself is not freed)
+ */
+void siridb_series_iter_destroy(siridb_series_iter_t * iter)
+{
+    for (uint32_t i = 0; i < iter->sz; i++)
+    {
+        if (iter->runs[i].points != NULL)
+        {
+            siridb_points_free(iter->runs[i].points);
+        }
+    }
+    free(iter->runs);
+}
+
+/*
+ * Pack all points for a series as one array without a copy of all points.
+ *
+ * (series stripe and series_mutex must be locked)
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ */
+int siridb_series_pack_points(
+        siridb_series_t *__restrict series,
+        qp_packer_t *__restrict packer)
+{
+    siridb_series_iter_t iter;
+    siridb_points_t chunk;
+    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
+    int rc;
+
+    if (siridb_series_iter_init(&iter, series, NULL, NULL))
+    {
+        return -1;  /* signal is raised */
+    }
+
+    qp_add_type(packer, QP_ARRAY_OPEN);
+
+    while ( (rc = siridb_series_iter_next(&iter, &chunk, err_msg)) == 1 &&
+            siridb_points_pack_items(&chunk, packer) == 0);
+
+    qp_add_type(packer, QP_ARRAY_CLOSE);
+
+    siridb_series_iter_destroy(&iter);
+
+    return (rc || siri_err) ? -1 : 0;
+}
+
+/*
+ * Returns a NEW list with the series for the id's in 'ids', ordered by id.
+ * The reference counter for each series is incremented. Id's for series
+ * which do not exist (anymore) are skipped.
+ *
+ * Returns NULL and raises a SIGNAL in case an error has occurred.
+ *
+ * (series_mutex must be locked when not called from the main thread)
+ */
+slist_t * siridb_series_slist_ref(siridb_t * siridb, roaring_t * ids)
+{
+    series_slist_t w = {
+            .siridb=siridb,
+            .slist=slist_new(ids->len)
+    };
+
+    if (w.slist != NULL)
+    {
+        roaring_walk(ids, (roaring_cb) SERIES_slist_ref_cb, &w);
+    }
+
+    return w.slist;
+}
+
+/*
+ * Lock all series stripes. Use this function when series data for all series
+ * might be changed, for example when a shard is dropped. Must be called
+ * before locking the series_mutex.
+ */
+void siridb_series_lock_stripes(siridb_t * siridb)
+{
+    for (int i = 0; i < SIRIDB_SERIES_STRIPES; i++)
+    {
+        uv_mutex_lock(&siridb->series_stripes[i]);
+    }
+}
+
+void siridb_series_unlock_stripes(siridb_t * siridb)
+{
+    for (int i = SIRIDB_SERIES_STRIPES; i--;)
+    {
+        uv_mutex_unlock(&siridb->series_stripes[i]);
+    }
 }
 
 /*
@@ -892,22 +1301,43 @@ int siridb_series_optimize_shard(
         return -1;  /* signal is raised */
     }
 
+    /* each chunk is a sorted run, chunks might overlap */
+    size_t * runs = (size_t *) malloc(sizeof(size_t) * (end - start + 1));
+    size_t nruns = 0;
+
+    if (runs == NULL)
+    {
+        ERR_ALLOC
+        siridb_points_free(points);
+        return -1;
+    }
+
+    runs[0] = 0;
+
     for (i = start; i < end; i++)
     {
         idx = series->idx + i;
         /* we can have indexes for this 'new' shard which we should skip */
-        if (idx->shard == shard->replacing && get_points_cb(
-                    points,
-                    idx,
-                    NULL,
-                    NULL,
-                    series->flags & SIRIDB_SERIES_HAS_OVERLAP))
+        if (idx->shard == shard->replacing)
         {
-            /* an error occurred while reading points, logging is done */
-            size -= idx->len;
+            if (get_points_cb(points, idx, NULL, NULL))
+            {
+                /* an error occurred while reading points, logging is done */
+                size -= idx->len;
+            }
+            runs[++nruns] = points->len;
         }
     }
 
+    rc = siridb_points_merge_runs(points, runs, nruns);
+    free(runs);
+
+    if (rc)
+    {
+        siridb_points_free(points);
+        return -1;  /* signal is raised */
+    }
+
     num_chunks = (size - 1) / shard->max_chunk_sz + 1;
     chunk_sz = size / num_chunks + (size % num_chunks != 0);
     i = start;
@@ -1045,6 +1475,103 @@ int siridb_series_open_store(siridb_t * siridb)
     return 0;
 }
 
+/*
+ * Returns the run with the next point.
+ */
+static siridb_series_run_t * SERIES_iter_first(siridb_series_iter_t * iter)
+{
+    siridb_series_run_t * first = iter->runs;
+    siridb_series_run_t * run = first + 1;
+
+    for (uint32_t i = 1; i < iter->n; i++, run++)
+    {
+        if (SERIES_RUN_LT(
+                run->pt->ts,
+                run->order,
+                first->pt->ts,
+                first->order))
+        {
+            first = run;
+        }
+    }
+
+    return first;
+}
+
+/*
+ * Read the points for an index as a new run. Points of a previous run are
+ * reused when possible.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ * Errors while reading are logged and are not returned.
+ */
+static int SERIES_iter_read(siridb_series_iter_t * iter, idx_t * idx)
+{
+    siridb_series_t * series = iter->series;
+    siridb_series_run_t * run;
+
+    if (iter->n == iter->sz)
+    {
+        uint32_t sz = iter->sz * 2;
+
+        run = (siridb_series_run_t *) realloc(
+                iter->runs,
+                sz * sizeof(siridb_series_run_t));
+        if (run == NULL)
+        {
+            ERR_ALLOC
+            return -1;
+        }
+
+        iter->runs = run;
+
+        for (; iter->sz < sz; iter->sz++)
+        {
+            iter->runs[iter->sz].points = NULL;
+            iter->runs[iter->sz].sz = 0;
+        }
+    }
+
+    run = iter->runs + iter->n;
+
+    if (run->points == NULL)
+    {
+        run->points = siridb_points_new(idx->len, series->tp);
+        if (run->points == NULL)
+        {
+            return -1;  /* signal is raised */
+        }
+        run->sz = idx->len;
+    }
+    else if (run->sz < idx->len)
+    {
+        if (siridb_points_resize(run->points, idx->len))
+        {
+            ERR_ALLOC
+            return -1;
+        }
+        run->sz = idx->len;
+    }
+
+    run->points->len = 0;
+
+    SERIES_GET_POINTS_CB(get_points_cb, series)
+
+    if (    get_points_cb(run->points, idx, iter->start_ts, iter->end_ts) ||
+            !run->points->len)
+    {
+        /* an error is logged or no points are in range */
+        return 0;
+    }
+
+    run->pt = run->points->data;
+    run->end = run->pt + run->points->len;
+    run->order = iter->pos;
+    iter->n++;
+
+    return 0;
+}
+
 /*
  * Will sort an index to its correct order. The start of idx should be correct
  * with a valid shard. All replaced shard indexes are sorted towards the end.
@@ -1237,7 +1764,7 @@ static int SERIES_save(siridb_t * siridb)
     }
     else
     {
-        if (imap_walk(siridb->series_map, (imap_cb) &SERIES_pack, fpacker))
+        if (idmap_walk(siridb->series_map, (idmap_cb) &SERIES_pack, fpacker))
         {
             ERR_FILE
         }
@@ -1375,10 +1902,10 @@ static int SERIES_load(siridb_t * siridb, imap_t * dropped)
             if (series != NULL)
             {
                 /* add series to c-tree */
-                ct_add(siridb->series, series->name, series);
+                art_add(siridb->series, series->name, series);
 
                 /* add series to imap32 */
-                imap_add(siridb->series_map, series->id, series);
+                idmap_add(siridb->series_map, series->id, series);
             }
         }
     }
@@ -1571,4 +2098,86 @@ static void SERIES_update_end(siridb_series_t *__restrict series)
     }
 }
 
+/*
+ * Call-back used by siridb_series_slist_ref().
+ */
+static int SERIES_slist_ref_cb(uint32_t id, series_slist_t * w)
+{
+    siridb_series_t * series = idmap_get(w->siridb->series_map, id);
+
+    if (series != NULL)
+    {
+        slist_append(w->slist, series);
+        siridb_series_incref(series);
+    }
+
+    return 0;
+}
+
+/*
+ * Write points to shards while holding the series_mutex and shards_mutex.
+ * The series stripe is expected to be locked by the caller.
+ *
+ * Returns 0 if successful; -1 and a SIGNAL is raised in case an error occurred.
+ */
+/*
+ * Make room for 'n' new points in the buffer of a series while the
+ * write-ahead log is on. The buffer grows in steps of buffer_len times a
+ * power of two so the allocated size follows from the number of points.
+ *
+ * Returns 0 if successful; -1 and a SIGNAL is raised in case an error occurred.
+ */
+static int SERIES_buffer_reserve(
+        siridb_t *__restrict siridb,
+        siridb_series_t *__restrict series,
+        size_t n)
+{
+    size_t size = siridb->buffer_len;
+    size_t len = series->buffer->len;
+    siridb_point_t * data;
+
+    while (size < len)
+    {
+        size <<= 1;
+    }
+
+    if (len + n <= size)
+    {
+        return 0;
+    }
+
+    while (size < len + n)
+    {
+        size <<= 1;
+    }
+
+    data = (siridb_point_t *) realloc(
+            series->buffer->data,
+            sizeof(siridb_point_t) * size);
+    if (data == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+    series->buffer->data = data;
+
+    return 0;
+}
+
+static int SERIES_add_to_shards(
+        siridb_t * siridb,
+        siridb_series_t * series,
+        siridb_points_t * points)
+{
+    int rc;
 
+    uv_mutex_lock(&siridb->series_mutex);
+    uv_mutex_lock(&siridb->shards_mutex);
+
+    rc = siridb_shards_add_points(siridb, series, points);
+
+    uv_mutex_unlock(&siridb->shards_mutex);
+    uv_mutex_unlock(&siridb->series_mutex);
+
+    return rc;
+}
@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 17-03-2016
+ *  - stop the write-ahead log when the replica is dropped, 18-10-2026
  *
  */
 #include <assert.h>
@@ -15,6 +16,7 @@
 #include <siri/db/query.h>
 #include <siri/db/server.h>
 #include <siri/db/servers.h>
+#include <siri/db/wal.h>
 #include <siri/err.h>
 #include <siri/net/promise.h>
 #include <siri/net/socket.h>
@@ -855,6 +857,9 @@ int siridb_server_drop(siridb_t * siridb, siridb_server_t * server)
 
     if (server == siridb->replica)
     {
+        /* the fifo buffer can no longer be used as write-ahead log */
+        siridb_wal_stop(siridb);
+
         if (siridb->replicate != NULL)
         {
             siridb_replicate_close(siridb->replicate);
@@ -8,6 +8,9 @@
  *
  * changes
  *  - initial version, 04-04-2016
+ *  - reading points appends chunks, overlap is merged by the caller,
+ *    18-10-2026
+ *  - files are used while the file handler is locked, 18-10-2026
  *
  */
 #define _GNU_SOURCE
@@ -102,6 +105,12 @@ sprintf(fn, "%s%s%" PRIu64 "%s", siridb->dbpath,                            \
  */
 #define DEFAULT_MAX_CHUNK_SZ_NUM 800
 
+/*
+ * Number of series we take from siridb->series_map at once while optimizing
+ * a shard.
+ */
+#define SHARD_OPTIMIZE_BATCH_SZ 1024
+
 static const siridb_shard_flags_repr_t flags_map[SHARD_STATUS_SIZE] = {
         {.repr="optimize-scheduled", .flag=SIRIDB_SHARD_MANUAL_OPTIMIZE},
         {.repr="overlap", .flag=SIRIDB_SHARD_HAS_OVERLAP},
@@ -127,6 +136,14 @@ static int SHARD_load_idx_num64(
         FILE * fp);
 static int SHARD_init_fn(siridb_t * siridb, siridb_shard_t * shard);
 static int SHARD_truncate(siridb_shard_t * shard);
+static long int SHARD_write_points(
+        siridb_t * siridb,
+        siridb_series_t * series,
+        siridb_shard_t * shard,
+        siridb_points_t * points,
+        uint_fast32_t start,
+        uint_fast32_t end);
+static int SHARD_read_idx(idx_t * idx, void * temp, size_t point_sz);
 
 /*
  * Returns 0 if successful or -1 in case of an error.
@@ -340,7 +357,9 @@ siridb_shard_t *  siridb_shard_create(
      * This is not critical at this point and it's hard to imagine this
      * fails if all the above was successful
      */
+    uv_mutex_lock(&siri.fh->lock);
     siri_fopen(siri.fh, shard->fp, shard->fn, "r+");
+    uv_mutex_unlock(&siri.fh->lock);
 
     return shard;
 }
@@ -427,105 +446,19 @@ long int siridb_shard_write_points(
         uint_fast32_t start,
         uint_fast32_t end)
 {
-    FILE * fp;
-    uint16_t len = end - start;
-    uint_fast32_t i;
-    long int pos = EOF;
-
-    if (shard->fp->fp == NULL)
-    {
-        if (siri_fopen(siri.fh, shard->fp, shard->fn, "r+"))
-        {
-            ERR_FILE
-            log_critical("Cannot open file '%s'", shard->fn);
-            return EOF;
-        }
-    }
-    fp = shard->fp->fp;
-
-    if (fseeko(fp, 0, SEEK_END) ||
-        fwrite(&series->id, sizeof(uint32_t), 1, fp) != 1)
-    {
-        ERR_FILE
-        log_critical("Cannot write index header to file '%s'", shard->fn);
-        return EOF;
-    }
-
-    switch (siridb->time->ts_sz)
-    {
-    case sizeof(uint32_t):
-        {
-            uint32_t start_ts = (uint32_t) points->data[start].ts;
-            uint32_t end_ts = (uint32_t) points->data[end - 1].ts;
-            if (fwrite(&start_ts, sizeof(uint32_t), 1, fp) != 1 ||
-                fwrite(&end_ts, sizeof(uint32_t), 1, fp) != 1)
-            {
-                ERR_FILE
-                log_critical("Cannot write index header to file '%s'",
-                        shard->fn);
-                return EOF;
-            }
-        }
-        /* TODO: this is not LOG compatible */
-        pos = shard->size + IDX_NUM32_SZ;
-        break;
-
-    case sizeof(uint64_t):
-        if (fwrite(&points->data[start].ts, sizeof(uint64_t), 1, fp) != 1 ||
-            fwrite(&points->data[end - 1].ts, sizeof(uint64_t), 1, fp) != 1)
-        {
-            ERR_FILE
-            log_critical("Cannot write index header to file '%s'",
-                    shard->fn);
-            return EOF;
-        }
-        /* TODO: this is not LOG compatible */
-        pos = shard->size + IDX_NUM64_SZ;
-        break;
-
-    default:
-        assert (0);
-        break;
-    }
-
-    if (fwrite(&len, sizeof(uint16_t), 1, fp) != 1)
-    {
-        ERR_FILE
-        log_critical("Cannot write index header to file '%s'", shard->fn);
-        return EOF;
-    }
-
-    /* TODO: this works for both double and integer.
-     * Add size values for strings and write string using 'old' way
-     */
-    for (i = start; i < end; i++)
-    {
-        if (fwrite(&points->data[i].ts, siridb->time->ts_sz, 1, fp) != 1 ||
-            fwrite(&points->data[i].val, 8, 1, fp) != 1)
-        {
-            ERR_FILE
-            log_critical("Cannot write points to file '%s'", shard->fn);
-            return EOF;
-        }
-    }
-
-    if (fflush(fp))
-    {
-        ERR_FILE
-        log_critical("Cannot write flush file '%s'", shard->fn);
-        return EOF;
-    }
-
-    shard->size = pos + (siridb->time->ts_sz + 8) * len;
+    long int pos;
 
-#ifdef DEBUG
-    assert (shard->size == ftello(fp));
-#endif
+    uv_mutex_lock(&siri.fh->lock);
+    pos = SHARD_write_points(siridb, series, shard, points, start, end);
+    uv_mutex_unlock(&siri.fh->lock);
 
     return pos;
 }
 
 /*
+ * Points are appended to 'points' so when chunks can overlap the caller is
+ * responsible for merging them, see siridb_points_merge_runs().
+ *
  * Returns 0 if successful or -1 in case of an error. SiriDB might recover
  * from this error so we do not consider this critical.
  */
@@ -533,8 +466,7 @@ int siridb_shard_get_points_num32(
         siridb_points_t * points,
         idx_t * idx,
         uint64_t * start_ts,
-        uint64_t * end_ts,
-        uint8_t has_overlap)
+        uint64_t * end_ts)
 {
     size_t len = points->len + idx->len;
     /*
@@ -544,37 +476,8 @@ int siridb_shard_get_points_num32(
     uint32_t temp[idx->len * 3];
     uint32_t * pt;
 
-    if (idx->shard->fp->fp == NULL)
+    if (SHARD_read_idx(idx, temp, 12))  // NUM32 point size
     {
-        if (siri_fopen(siri.fh, idx->shard->fp, idx->shard->fn, "r+"))
-        {
-            log_critical(
-                    "Cannot open file '%s', skip reading points",
-                    idx->shard->fn);
-            return -1;
-        }
-    }
-
-    if (fseeko(idx->shard->fp->fp, idx->pos, SEEK_SET) ||
-        fread(
-            temp,
-            12,  // NUM32 point size
-            idx->len,
-            idx->shard->fp->fp) != idx->len)
-    {
-        if (idx->shard->flags & SIRIDB_SHARD_IS_CORRUPT)
-        {
-            log_error("Cannot read from shard id %" PRIu64, idx->shard->id);
-        }
-        else
-        {
-            log_critical(
-                    "Cannot read from shard id %" PRIu64
-                    ". The next optimize cycle "
-                    "will fix this shard but you might loose some data.",
-                    idx->shard->id);
-            idx->shard->flags |= SIRIDB_SHARD_IS_CORRUPT;
-        }
         return -1;
     }
 
@@ -595,23 +498,10 @@ int siridb_shard_get_points_num32(
                 p -= 3, len--);
     }
 
-    if (    has_overlap &&
-            points->len &&
-            (idx->shard->flags & SIRIDB_SHARD_HAS_OVERLAP))
-    {
-        for (uint64_t ts; points->len < len; pt += 3)
-        {
-            ts = (uint64_t) *pt;
-            siridb_points_add_point(points, &ts, ((qp_via_t *) (pt + 1)));
-        }
-    }
-    else
+    for (; points->len < len; points->len++, pt += 3)
     {
-        for (; points->len < len; points->len++, pt += 3)
-        {
-            points->data[points->len].ts = (uint64_t) *pt;
-            points->data[points->len].val = *((qp_via_t *) (pt + 1));
-        }
+        points->data[points->len].ts = (uint64_t) *pt;
+        points->data[points->len].val = *((qp_via_t *) (pt + 1));
     }
 
     return 0;
@@ -624,8 +514,7 @@ int siridb_shard_get_points_num64(
         siridb_points_t * points,
         idx_t * idx,
         uint64_t * start_ts,
-        uint64_t * end_ts,
-        uint8_t has_overlap)
+        uint64_t * end_ts)
 {
     size_t len = points->len + idx->len;
     /*
@@ -635,37 +524,8 @@ int siridb_shard_get_points_num64(
     uint64_t temp[idx->len * 2];  // CHANGED
     uint64_t * pt;                // CHANGED
 
-    if (idx->shard->fp->fp == NULL)
-    {
-        if (siri_fopen(siri.fh, idx->shard->fp, idx->shard->fn, "r+"))
-        {
-            log_critical(
-                    "Cannot open file '%s', skip reading points",
-                    idx->shard->fn);
-            return -1;
-        }
-    }
-
-    if (fseeko(idx->shard->fp->fp, idx->pos, SEEK_SET) ||
-        fread(
-            temp,
-            16,  // NUM64 point size   CHANGED
-            idx->len,
-            idx->shard->fp->fp) != idx->len)
+    if (SHARD_read_idx(idx, temp, 16))  // NUM64 point size   CHANGED
     {
-        if (idx->shard->flags & SIRIDB_SHARD_IS_CORRUPT)
-        {
-            log_error("Cannot read from shard id %" PRIu64, idx->shard->id);
-        }
-        else
-        {
-            log_critical(
-                    "Cannot read from shard id %" PRIu64
-                    ". The next optimize cycle "
-                    "will fix this shard but you might loose some data.",
-                    idx->shard->id);
-            idx->shard->flags |= SIRIDB_SHARD_IS_CORRUPT;
-        }
         return -1;
     }
 
@@ -686,23 +546,10 @@ int siridb_shard_get_points_num64(
                 p -= 2, len--);    // CHANGED
     }
 
-    if (    has_overlap &&
-            points->len &&
-            (idx->shard->flags & SIRIDB_SHARD_HAS_OVERLAP))
-    {
-        for (; points->len < len; pt += 2)   // CHANGED
-        {
-            // CHANGED
-            siridb_points_add_point(points, pt, ((qp_via_t *) (pt + 1)));
-        }
-    }
-    else
+    for (; points->len < len; points->len++, pt += 2)  // CHANGED
     {
-        for (; points->len < len; points->len++, pt += 2)  // CHANGED
-        {
-            points->data[points->len].ts = *pt;  //CHANGED
-            points->data[points->len].val = *((qp_via_t *) (pt + 1));
-        }
+        points->data[points->len].ts = *pt;  //CHANGED
+        points->data[points->len].val = *((qp_via_t *) (pt + 1));
     }
 
     return 0;
@@ -715,8 +562,7 @@ int siridb_shard_get_points_log32(
         siridb_points_t * points,
         idx_t * idx,
         uint64_t * start_ts,
-        uint64_t * end_ts,
-        uint8_t has_overlap)
+        uint64_t * end_ts)
 {
     return -1;  /* dummy function */
 }
@@ -728,8 +574,7 @@ int siridb_shard_get_points_log64(
         siridb_points_t * points,
         idx_t * idx,
         uint64_t * start_ts,
-        uint64_t * end_ts,
-        uint8_t has_overlap)
+        uint64_t * end_ts)
 {
     return -1;  /* dummy function */
 }
@@ -745,6 +590,7 @@ int siridb_shard_optimize(siridb_shard_t * shard, siridb_t * siridb)
     siridb_shard_t * new_shard = NULL;
     uint64_t duration = (shard->tp == SIRIDB_SHARD_TP_NUMBER) ?
             siridb->duration_num : siridb->duration_log;
+    siridb_shard_t * replaced = NULL;
     siridb_series_t * series;
 
     uv_mutex_lock(&siridb->shards_mutex);
@@ -800,61 +646,77 @@ int siridb_shard_optimize(siridb_shard_t * shard, siridb_t * siridb)
 
     sleep(1);
 
-    uv_mutex_lock(&siridb->series_mutex);
-
-    slist_t * slist = imap_2slist_ref(siridb->series_map);
-
-    uv_mutex_unlock(&siridb->series_mutex);
+    /*
+     * Walk over the series in batches so we only hold the series mutex for
+     * a short time and do not need a copy of all series at once.
+     */
+    uint64_t series_id = 0;
+    slist_t * slist;
+    size_t n;
 
-    if (slist == NULL)
+    do
     {
-        return -1;  /* signal is raised */
-    }
+        uv_mutex_lock(&siridb->series_mutex);
 
-    sleep(1);
+        slist = idmap_slice_ref(
+                siridb->series_map,
+                &series_id,
+                SHARD_OPTIMIZE_BATCH_SZ);
 
-    for (size_t i = 0; i < slist->len; i++)
-    {
-        /* its possible that another database is paused, but we wait anyway */
-        if (siri.optimize->pause)
+        uv_mutex_unlock(&siridb->series_mutex);
+
+        if (slist == NULL)
         {
-            siri_optimize_wait();
+            return -1;  /* signal is raised */
         }
 
-        series = slist->data[i];
+        for (size_t i = 0; i < slist->len; i++)
+        {
+            /* its possible that another database is paused, but we wait
+             * anyway */
+            if (siri.optimize->pause)
+            {
+                siri_optimize_wait();
+            }
 
+            series = slist->data[i];
 
+            if (    !siri_err &&
+                    siri.optimize->status != SIRI_OPTIMIZE_CANCELLED &&
+                    shard->id % siridb->duration_num == series->mask &&
+                    (~series->flags & SIRIDB_SERIES_IS_DROPPED) &&
+                    (~new_shard->flags & SIRIDB_SHARD_IS_REMOVED))
+            {
+                /* the index of the series is changed */
+                uv_mutex_lock(siridb_series_stripe(siridb, series));
+                uv_mutex_lock(&siridb->series_mutex);
+
+                if (    (~new_shard->flags & SIRIDB_SHARD_IS_REMOVED) &&
+                        siridb_series_optimize_shard(
+                            siridb,
+                            series,
+                            new_shard))
+                {
+                    log_critical(
+                            "Optimizing shard '%s' has failed due to a "
+                            "critical error", shard->fn);
+                }
 
-        if (    !siri_err &&
-                siri.optimize->status != SIRI_OPTIMIZE_CANCELLED &&
-                shard->id % siridb->duration_num == series->mask &&
-                (~series->flags & SIRIDB_SERIES_IS_DROPPED) &&
-                (~new_shard->flags & SIRIDB_SHARD_IS_REMOVED))
-        {
-            uv_mutex_lock(&siridb->series_mutex);
+                uv_mutex_unlock(&siridb->series_mutex);
+                uv_mutex_unlock(siridb_series_stripe(siridb, series));
 
-            if (    (~new_shard->flags & SIRIDB_SHARD_IS_REMOVED) &&
-                    siridb_series_optimize_shard(
-                        siridb,
-                        series,
-                        new_shard))
-            {
-                log_critical(
-                        "Optimizing shard '%s' has failed due to a critical "
-                        "error", shard->fn);
+                /* make this sleep depending on the active_tasks
+                 * (50ms per active task) */
+                usleep( 50000 * siridb->active_tasks + 100 );
             }
 
-            uv_mutex_unlock(&siridb->series_mutex);
-
-            /* make this sleep depending on the active_tasks
-             * (50ms per active task) */
-            usleep( 50000 * siridb->active_tasks + 100 );
+            siridb_series_decref(series);
         }
 
-        siridb_series_decref(series);
+        n = slist->len;
+        slist_free(slist);
     }
-
-    slist_free(slist);
+    while (n);
 
     if (new_shard->flags & SIRIDB_SHARD_IS_REMOVED)
     {
@@ -889,6 +751,12 @@ int siridb_shard_optimize(siridb_shard_t * shard, siridb_t * siridb)
 
     uv_mutex_lock(&siridb->series_mutex);
 
+    /*
+     * Queries read shard files while holding only the file handler lock so
+     * this lock is required for replacing the file.
+     */
+    uv_mutex_lock(&siri.fh->lock);
+
     /* make sure both shards files are closed */
     siri_fp_close(new_shard->replacing->fp);
     siri_fp_close(new_shard->fp);
@@ -928,14 +796,20 @@ int siridb_shard_optimize(siridb_shard_t * shard, siridb_t * siridb)
             free(new_shard->fn);
             new_shard->fn = tmp;
 
-            /* decrement reference to old shard and set
-             * new_shard->replacing to NULL
-             */
-            siridb_shard_decref(new_shard->replacing);
+            /* the reference to the old shard is decremented below since
+             * this closes the file */
+            replaced = new_shard->replacing;
             new_shard->replacing = NULL;
         }
     }
 
+    uv_mutex_unlock(&siri.fh->lock);
+
+    if (replaced != NULL)
+    {
+        siridb_shard_decref(replaced);
+    }
+
     uv_mutex_unlock(&siridb->series_mutex);
 
     /* can raise an error only if the shard is dropped, in any other case we
@@ -953,19 +827,28 @@ int siridb_shard_optimize(siridb_shard_t * shard, siridb_t * siridb)
  */
 int siridb_shard_write_flags(siridb_shard_t * shard)
 {
-    if (shard->fp->fp == NULL)
+    int rc;
+
+    uv_mutex_lock(&siri.fh->lock);
+
+    if (shard->fp->fp == NULL &&
+        siri_fopen(siri.fh, shard->fp, shard->fn, "r+"))
     {
-        if (siri_fopen(siri.fh, shard->fp, shard->fn, "r+"))
-        {
-            log_critical(
-                    "Cannot open file '%s', skip writing status",
-                    shard->fn);
-            return EOF;
-        }
+        log_critical(
+                "Cannot open file '%s', skip writing status",
+                shard->fn);
+        rc = EOF;
     }
-    return (fseeko(shard->fp->fp, HEADER_FLAGS, SEEK_SET) ||
-            fputc(shard->flags, shard->fp->fp) == EOF ||
-            fflush(shard->fp->fp)) ? EOF : 0;
+    else
+    {
+        rc = (  fseeko(shard->fp->fp, HEADER_FLAGS, SEEK_SET) ||
+                fputc(shard->flags, shard->fp->fp) == EOF ||
+                fflush(shard->fp->fp)) ? EOF : 0;
+    }
+
+    uv_mutex_unlock(&siri.fh->lock);
+
+    return rc;
 }
 
 
@@ -994,6 +877,8 @@ void siridb_shard_drop(siridb_shard_t * shard, siridb_t * siridb)
     siridb_shard_t * pop_shard;
     int optimizing = 0;
 
+    /* removing the shard changes the length, start and end of series */
+    siridb_series_lock_stripes(siridb);
     uv_mutex_lock(&siridb->series_mutex);
     uv_mutex_lock(&siridb->shards_mutex);
 
@@ -1039,7 +924,7 @@ void siridb_shard_drop(siridb_shard_t * shard, siridb_t * siridb)
      */
     if (optimizing)
     {
-        slist_t * slist = imap_2slist_ref(siridb->series_map);
+        slist_t * slist = idmap_2slist_ref(siridb->series_map);
 
         if (slist != NULL)
         {
@@ -1058,7 +943,7 @@ void siridb_shard_drop(siridb_shard_t * shard, siridb_t * siridb)
     }
     else
     {
-        slist_t * slist = imap_2slist(siridb->series_map);
+        slist_t * slist = idmap_2slist(siridb->series_map);
 
         if (slist != NULL)
         {
@@ -1080,6 +965,7 @@ void siridb_shard_drop(siridb_shard_t * shard, siridb_t * siridb)
     }
 
     uv_mutex_unlock(&siridb->series_mutex);
+    siridb_series_unlock_stripes(siridb);
 }
 
 /*
@@ -1094,7 +980,9 @@ int siridb_shard_remove(siridb_shard_t * shard)
         rc = siridb_shard_remove(shard->replacing);
     }
 
+    uv_mutex_lock(&siri.fh->lock);
     siri_fp_close(shard->fp);
+    uv_mutex_unlock(&siri.fh->lock);
 
     rc += unlink(shard->fn);
 
@@ -1130,7 +1018,9 @@ void siridb__shard_free(siridb_shard_t * shard)
     }
 
     /* this will close the file, even when other references exist */
+    uv_mutex_lock(&siri.fh->lock);
     siri_fp_decref(shard->fp);
+    uv_mutex_unlock(&siri.fh->lock);
 
 #ifdef DEBUG
     log_debug("Free shard id: %" PRIu64, shard->id);
@@ -1147,35 +1037,36 @@ void siridb__shard_free(siridb_shard_t * shard)
  */
 static int SHARD_truncate(siridb_shard_t * shard)
 {
-    if (shard->fp->fp == NULL)
-    {
-        if (siri_fopen(siri.fh, shard->fp, shard->fn, "r+"))
-        {
-            log_critical(
-                    "Cannot open file '%s', skip reading points",
-                    shard->fn);
-            return -1;
-        }
-    }
+    int buffer_fd;
+    int rc = -1;
 
-    int buffer_fd = fileno(shard->fp->fp);
+    uv_mutex_lock(&siri.fh->lock);
 
-    if (buffer_fd == -1)
+    if (shard->fp->fp == NULL &&
+        siri_fopen(siri.fh, shard->fp, shard->fn, "r+"))
+    {
+        log_critical(
+                "Cannot open file '%s', skip reading points",
+                shard->fn);
+    }
+    else if ((buffer_fd = fileno(shard->fp->fp)) == -1)
     {
         log_critical("Cannot get file descriptor for '%s'", shard->fn);
-        return -1;
     }
-
-    if (ftruncate(buffer_fd, shard->size))
+    else if (ftruncate(buffer_fd, shard->size))
     {
         log_critical("Cannot truncate shard file: '%s'", shard->fn);
-        return -1;
+    }
+    else
+    {
+        log_warning("Truncated shard file '%s' to %zu bytes",
+                shard->fn, shard->size);
+        rc = fsync(buffer_fd);
     }
 
-    log_warning("Truncated shard file '%s' to %zu bytes",
-            shard->fn, shard->size);
+    uv_mutex_unlock(&siri.fh->lock);
 
-    return fsync(buffer_fd);
+    return rc;
 }
 
 /*
@@ -1206,7 +1097,7 @@ static int SHARD_load_idx_num32(
         len = *((uint16_t *) (idx + 12));  // LEN POS IN INDEX
         pos = shard->size + IDX_NUM32_SZ;
 
-        series = imap_get(siridb->series_map, series_id);
+        series = idmap_get(siridb->series_map, series_id);
 
         if (series == NULL)
         {
@@ -1317,7 +1208,7 @@ static int SHARD_load_idx_num64(
         len = *((uint16_t *) (idx + 20));  // LEN POS IN INDEX
         pos = shard->size + IDX_NUM64_SZ;
 
-        series = imap_get(siridb->series_map, series_id);
+        series = idmap_get(siridb->series_map, series_id);
 
         if (series == NULL)
         {
@@ -1420,3 +1311,161 @@ inline static int SHARD_init_fn(siridb_t * siridb, siridb_shard_t * shard)
              shard->id,
              ".sdb");
 }
+
+/*
+ * Writes an index and points to a shard. (siri.fh->lock must be locked)
+ *
+ * If an error has occurred, EOF will be returned and a SIGNAL will be raised.
+ */
+static long int SHARD_write_points(
+        siridb_t * siridb,
+        siridb_series_t * series,
+        siridb_shard_t * shard,
+        siridb_points_t * points,
+        uint_fast32_t start,
+        uint_fast32_t end)
+{
+    FILE * fp;
+
+    uint16_t len = end - start;
+    uint_fast32_t i;
+    long int pos = EOF;
+
+    if (shard->fp->fp == NULL)
+    {
+        if (siri_fopen(siri.fh, shard->fp, shard->fn, "r+"))
+        {
+            ERR_FILE
+            log_critical("Cannot open file '%s'", shard->fn);
+            return EOF;
+        }
+    }
+    fp = shard->fp->fp;
+
+    if (fseeko(fp, 0, SEEK_END) ||
+        fwrite(&series->id, sizeof(uint32_t), 1, fp) != 1)
+    {
+        ERR_FILE
+        log_critical("Cannot write index header to file '%s'", shard->fn);
+        return EOF;
+    }
+
+    switch (siridb->time->ts_sz)
+    {
+    case sizeof(uint32_t):
+        {
+            uint32_t start_ts = (uint32_t) points->data[start].ts;
+            uint32_t end_ts = (uint32_t) points->data[end - 1].ts;
+            if (fwrite(&start_ts, sizeof(uint32_t), 1, fp) != 1 ||
+                fwrite(&end_ts, sizeof(uint32_t), 1, fp) != 1)
+            {
+                ERR_FILE
+                log_critical("Cannot write index header to file '%s'",
+                        shard->fn);
+                return EOF;
+            }
+        }
+        /* TODO: this is not LOG compatible */
+        pos = shard->size + IDX_NUM32_SZ;
+        break;
+
+    case sizeof(uint64_t):
+        if (fwrite(&points->data[start].ts, sizeof(uint64_t), 1, fp) != 1 ||
+            fwrite(&points->data[end - 1].ts, sizeof(uint64_t), 1, fp) != 1)
+        {
+            ERR_FILE
+            log_critical("Cannot write index header to file '%s'",
+                    shard->fn);
+            return EOF;
+        }
+        /* TODO: this is not LOG compatible */
+        pos = shard->size + IDX_NUM64_SZ;
+        break;
+
+    default:
+        assert (0);
+        break;
+    }
+
+    if (fwrite(&len, sizeof(uint16_t), 1, fp) != 1)
+    {
+        ERR_FILE
+        log_critical("Cannot write index header to file '%s'", shard->fn);
+        return EOF;
+    }
+
+    /* TODO: this works for both double and integer.
+     * Add size values for strings and write string using 'old' way
+     */
+    for (i = start; i < end; i++)
+    {
+        if (fwrite(&points->data[i].ts, siridb->time->ts_sz, 1, fp) != 1 ||
+            fwrite(&points->data[i].val, 8, 1, fp) != 1)
+        {
+            ERR_FILE
+            log_critical("Cannot write points to file '%s'", shard->fn);
+            return EOF;
+        }
+    }
+
+    if (fflush(fp))
+    {
+        ERR_FILE
+        log_critical("Cannot write flush file '%s'", shard->fn);
+        return EOF;
+    }
+
+    shard->size = pos + (siridb->time->ts_sz + 8) * len;
+
+#ifdef DEBUG
+    assert (shard->size == ftello(fp));
+#endif
+
+    return pos;
+}
+
+
+/*
+ * Read the points for an index from the shard file in temp. The file handler
+ * is locked while reading since the file might be closed or moved by other
+ * threads.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ */
+static int SHARD_read_idx(idx_t * idx, void * temp, size_t point_sz)
+{
+    siridb_shard_t * shard = idx->shard;
+    int rc = 0;
+
+    uv_mutex_lock(&siri.fh->lock);
+
+    if (shard->fp->fp == NULL &&
+        siri_fopen(siri.fh, shard->fp, shard->fn, "r+"))
+    {
+        log_critical("Cannot open file '%s', skip reading points", shard->fn);
+        rc = -1;
+    }
+    else if (
+        fseeko(shard->fp->fp, idx->pos, SEEK_SET) ||
+        fread(temp, point_sz, idx->len, shard->fp->fp) != idx->len)
+    {
+        if (shard->flags & SIRIDB_SHARD_IS_CORRUPT)
+        {
+            log_error("Cannot read from shard id %" PRIu64, shard->id);
+        }
+        else
+        {
+            log_critical(
+                    "Cannot read from shard id %" PRIu64
+                    ". The next optimize cycle "
+                    "will fix this shard but you might loose some data.",
+                    shard->id);
+            shard->flags |= SIRIDB_SHARD_IS_CORRUPT;
+        }
+        rc = -1;
+    }
+
+    uv_mutex_unlock(&siri.fh->lock);
+
+    return rc;
+}
@@ -0,0 +1,1363 @@
+/*
+ * simd.c - Vector kernels for aggregating points.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * A point is a 64bit timestamp followed by a 64bit value. SSE4.2 kernels
+ * load two points in two registers and unpack them to one register with
+ * timestamps and one with values. AVX2 kernels do the same for four points
+ * but the lanes are in order 0, 2, 1, 3 after unpacking. This order is only
+ * restored where it matters. (bucket_end and filters)
+ *
+ * The instruction sets are enabled per function using the target attribute
+ * so no special compiler flags are required.
+ */
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <siri/db/simd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <timeit/timeit.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#define SIMD_BENCH_POINTS 1000000
+#define SIMD_BENCH_LOOPS 20
+
+/* same check as used by sum() */
+#define SIMD_ADD_INT(sum, tmp)                                      \
+    (((tmp) > 0 && (sum) > LLONG_MAX - (tmp)) ||                    \
+     ((tmp) < 0 && (sum) < LLONG_MIN - (tmp)))
+
+static size_t SIMD_bucket_end(siridb_point_t * pts, size_t n, uint64_t ts);
+static int SIMD_sum_int(siridb_point_t * pts, size_t n, int64_t * sum);
+static double SIMD_sum_real(siridb_point_t * pts, size_t n);
+static int64_t SIMD_min_int(siridb_point_t * pts, size_t n);
+static int64_t SIMD_max_int(siridb_point_t * pts, size_t n);
+static double SIMD_min_real(siridb_point_t * pts, size_t n);
+static double SIMD_max_real(siridb_point_t * pts, size_t n);
+static double SIMD_sqdev_int(siridb_point_t * pts, size_t n, double mean);
+static double SIMD_sqdev_real(siridb_point_t * pts, size_t n, double mean);
+static size_t SIMD_filter_int(
+        siridb_point_t * pts,
+        size_t n,
+        cexpr_operator_t opr,
+        int64_t val,
+        siridb_point_t * dest);
+static size_t SIMD_filter_real(
+        siridb_point_t * pts,
+        size_t n,
+        cexpr_operator_t opr,
+        double val,
+        siridb_point_t * dest);
+
+static const siridb_simd_t SIMD_scalar = {
+        .name="scalar",
+        .bucket_end=SIMD_bucket_end,
+        .sum_int=SIMD_sum_int,
+        .sum_real=SIMD_sum_real,
+        .min_int=SIMD_min_int,
+        .max_int=SIMD_max_int,
+        .min_real=SIMD_min_real,
+        .max_real=SIMD_max_real,
+        .sqdev_int=SIMD_sqdev_int,
+        .sqdev_real=SIMD_sqdev_real,
+        .filter_int=SIMD_filter_int,
+        .filter_real=SIMD_filter_real
+};
+
+#ifdef SIMD_X86
+
+#define SIMD_SSE42 __attribute__((target("sse4.2")))
+#define SIMD_AVX2 __attribute__((target("avx2")))
+
+static size_t SIMD_SSE42 SIMD_sse42_bucket_end(
+        siridb_point_t * pts,
+        size_t n,
+        uint64_t ts);
+static int SIMD_SSE42 SIMD_sse42_sum_int(
+        siridb_point_t * pts,
+        size_t n,
+        int64_t * sum);
+static double SIMD_SSE42 SIMD_sse42_sum_real(siridb_point_t * pts, size_t n);
+static int64_t SIMD_SSE42 SIMD_sse42_min_int(siridb_point_t * pts, size_t n);
+static int64_t SIMD_SSE42 SIMD_sse42_max_int(siridb_point_t * pts, size_t n);
+static double SIMD_SSE42 SIMD_sse42_min_real(siridb_point_t * pts, size_t n);
+static double SIMD_SSE42 SIMD_sse42_max_real(siridb_point_t * pts, size_t n);
+static double SIMD_SSE42 SIMD_sse42_sqdev_int(
+        siridb_point_t * pts,
+        size_t n,
+        double mean);
+static double SIMD_SSE42 SIMD_sse42_sqdev_real(
+        siridb_point_t * pts,
+        size_t n,
+        double mean);
+static size_t SIMD_SSE42 SIMD_sse42_filter_int(
+        siridb_point_t * pts,
+        size_t n,
+        cexpr_operator_t opr,
+        int64_t val,
+        siridb_point_t * dest);
+static size_t SIMD_SSE42 SIMD_sse42_filter_real(
+        siridb_point_t * pts,
+        size_t n,
+        cexpr_operator_t opr,
+        double val,
+        siridb_point_t * dest);
+
+static size_t SIMD_AVX2 SIMD_avx2_bucket_end(
+        siridb_point_t * pts,
+        size_t n,
+        uint64_t ts);
+static int SIMD_AVX2 SIMD_avx2_sum_int(
+        siridb_point_t * pts,
+        size_t n,
+        int64_t * sum);
+static double SIMD_AVX2 SIMD_avx2_sum_real(siridb_point_t * pts, size_t n);
+static int64_t SIMD_AVX2 SIMD_avx2_min_int(siridb_point_t * pts, size_t n);
+static int64_t SIMD_AVX2 SIMD_avx2_max_int(siridb_point_t * pts, size_t n);
+static double SIMD_AVX2 SIMD_avx2_min_real(siridb_point_t * pts, size_t n);
+static double SIMD_AVX2 SIMD_avx2_max_real(siridb_point_t * pts, size_t n);
+static double SIMD_AVX2 SIMD_avx2_sqdev_int(
+        siridb_point_t * pts,
+        size_t n,
+        double mean);
+static double SIMD_AVX2 SIMD_avx2_sqdev_real(
+        siridb_point_t * pts,
+        size_t n,
+        double mean);
+static size_t SIMD_AVX2 SIMD_avx2_filter_int(
+        siridb_point_t * pts,
+        size_t n,
+        cexpr_operator_t opr,
+        int64_t val,
+        siridb_point_t * dest);
+static size_t SIMD_AVX2 SIMD_avx2_filter_real(
+        siridb_point_t * pts,
+        size_t n,
+        cexpr_operator_t opr,
+        double val,
+        siridb_point_t * dest);
+
+static const siridb_simd_t SIMD_sse42 = {
+        .name="sse4.2",
+        .bucket_end=SIMD_sse42_bucket_end,
+        .sum_int=SIMD_sse42_sum_int,
+        .sum_real=SIMD_sse42_sum_real,
+        .min_int=SIMD_sse42_min_int,
+        .max_int=SIMD_sse42_max_int,
+        .min_real=SIMD_sse42_min_real,
+        .max_real=SIMD_sse42_max_real,
+        .sqdev_int=SIMD_sse42_sqdev_int,
+        .sqdev_real=SIMD_sse42_sqdev_real,
+        .filter_int=SIMD_sse42_filter_int,
+        .filter_real=SIMD_sse42_filter_real
+};
+
+static const siridb_simd_t SIMD_avx2 = {
+        .name="avx2",
+        .bucket_end=SIMD_avx2_bucket_end,
+        .sum_int=SIMD_avx2_sum_int,
+        .sum_real=SIMD_avx2_sum_real,
+        .min_int=SIMD_avx2_min_int,
+        .max_int=SIMD_avx2_max_int,
+        .min_real=SIMD_avx2_min_real,
+        .max_real=SIMD_avx2_max_real,
+        .sqdev_int=SIMD_avx2_sqdev_int,
+        .sqdev_real=SIMD_avx2_sqdev_real,
+        .filter_int=SIMD_avx2_filter_int,
+        .filter_real=SIMD_avx2_filter_real
+};
+
+#endif  /* SIMD_X86 */
+
+const siridb_simd_t * siridb_simd = &SIMD_scalar;
+
+/*
+ * Select the kernels for the CPU. This function should be called once at
+ * startup, before queries are handled.
+ */
+void siridb_simd_init(void)
+{
+    const siridb_simd_t * simd;
+
+    if (    (simd = siridb_simd_get("avx2")) != NULL ||
+            (simd = siridb_simd_get("sse4.2")) != NULL)
+    {
+        siridb_simd = simd;
+    }
+}
+
+/*
+ * Returns the kernels for an instruction set ("scalar", "sse4.2" or "avx2")
+ * or NULL when not supported by the CPU.
+ */
+const siridb_simd_t * siridb_simd_get(const char * name)
+{
+    if (strcmp(name, SIMD_scalar.name) == 0)
+    {
+        return &SIMD_scalar;
+    }
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+
+    if (strcmp(name, SIMD_avx2.name) == 0 && __builtin_cpu_supports("avx2"))
+    {
+        return &SIMD_avx2;
+    }
+
+    if (    strcmp(name, SIMD_sse42.name) == 0 &&
+            __builtin_cpu_supports("sse4.2"))
+    {
+        return &SIMD_sse42;
+    }
+#endif
+    return NULL;
+}
+
+/*
+ * Returns the mean value for number points. (at least one point is required)
+ *
+ * Integer values are added as integers which is exact. Only on an overflow
+ * the values are added as doubles, like the sequential sum does.
+ */
+double siridb_simd_mean(siridb_points_t * points)
+{
+    int64_t isum;
+    double sum = 0.0;
+
+    switch (points->tp)
+    {
+    case TP_INT:
+        if ((*siridb_simd->sum_int)(points->data, points->len, &isum) == 0)
+        {
+            return (double) isum / points->len;
+        }
+        for (size_t i = 0; i < points->len; i++)
+        {
+            sum += (points->data + i)->val.int64;
+        }
+        break;
+
+    case TP_DOUBLE:
+        sum = (*siridb_simd->sum_real)(points->data, points->len);
+        break;
+
+    default:
+        assert (0);
+        break;
+    }
+
+    return sum / points->len;
+}
+
+/*
+ * Scalar kernels.
+ */
+static size_t SIMD_bucket_end(siridb_point_t * pts, size_t n, uint64_t ts)
+{
+    size_t i;
+    for (i = 0; i < n && pts[i].ts <= ts; i++);
+    return i;
+}
+
+static int SIMD_sum_int(siridb_point_t * pts, size_t n, int64_t * sum)
+{
+    int64_t s = 0;
+    int64_t tmp;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        tmp = pts[i].val.int64;
+        if (SIMD_ADD_INT(s, tmp))
+        {
+            return -1;
+        }
+        s += tmp;
+    }
+
+    *sum = s;
+
+    return 0;
+}
+
+static double SIMD_sum_real(siridb_point_t * pts, size_t n)
+{
+    double sum = 0.0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        sum += pts[i].val.real;
+    }
+
+    return sum;
+}
+
+static int64_t SIMD_min_int(siridb_point_t * pts, size_t n)
+{
+    int64_t min = pts->val.int64;
+
+    for (size_t i = 1; i < n; i++)
+    {
+        if (pts[i].val.int64 < min)
+        {
+            min = pts[i].val.int64;
+        }
+    }
+
+    return min;
+}
+
+static int64_t SIMD_max_int(siridb_point_t * pts, size_t n)
+{
+    int64_t max = pts->val.int64;
+
+    for (size_t i = 1; i < n; i++)
+    {
+        if (pts[i].val.int64 > max)
+        {
+            max = pts[i].val.int64;
+        }
+    }
+
+    return max;
+}
+
+static double SIMD_min_real(siridb_point_t * pts, size_t n)
+{
+    double min = pts->val.real;
+
+    for (size_t i = 1; i < n; i++)
+    {
+        if (pts[i].val.real < min)
+        {
+            min = pts[i].val.real;
+        }
+    }
+
+    return min;
+}
+
+static double SIMD_max_real(siridb_point_t * pts, size_t n)
+{
+    double max = pts->val.real;
+
+    for (size_t i = 1; i < n; i++)
+    {
+        if (pts[i].val.real > max)
+        {
+            max = pts[i].val.real;
+        }
+    }
+
+    return max;
+}
+
+static double SIMD_sqdev_int(siridb_point_t * pts, size_t n, double mean)
+{
+    double sqdev = 0.0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        sqdev += pow((double) pts[i].val.int64 - mean, 2);
+    }
+
+    return sqdev;
+}
+
+static double SIMD_sqdev_real(siridb_point_t * pts, size_t n, double mean)
+{
+    double sqdev = 0.0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        sqdev += pow(pts[i].val.real - mean, 2);
+    }
+
+    return sqdev;
+}
+
+static size_t SIMD_filter_int(
+        siridb_point_t * pts,
+        size_t n,
+        cexpr_operator_t opr,
+        int64_t val,
+        siridb_point_t * dest)
+{
+    siridb_point_t * dpt = dest;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (cexpr_int_cmp(opr, pts[i].val.int64, val))
+        {
+            *dpt++ = pts[i];
+        }
+    }
+
+    return dpt - dest;
+}
+
+static size_t SIMD_filter_real(
+        siridb_point_t * pts,
+        size_t n,
+        cexpr_operator_t opr,
+        double val,
+        siridb_point_t * dest)
+{
+    siridb_point_t * dpt = dest;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (cexpr_double_cmp(opr, pts[i].val.real, val))
+        {
+            *dpt++ = pts[i];
+        }
+    }
+
+    return dpt - dest;
+}
+
+#ifdef SIMD_X86
+
+/*
+ * Copy points for each bit set in a mask.
+ */
+#define SIMD_COPY_MASK(dpt, pts, mask, all)                         \
+if ((mask) == (all))                                                \
+{                                                                   \
+    memcpy(dpt, pts, sizeof(siridb_point_t) * __builtin_popcount(all)); \
+    dpt += __builtin_popcount(all);                                 \
+}                                                                   \
+else                                                                \
+{                                                                   \
+    for (int m__ = (mask); m__; m__ &= m__ - 1)                     \
+    {                                                               \
+        *dpt++ = pts[__builtin_ctz(m__)];                           \
+    }                                                               \
+}
+
+/*
+ * SSE4.2 kernels, two points at a time.
+ */
+#define SSE42_LOAD(pts, i, a, b)                                    \
+    a = _mm_loadu_si128((__m128i *) (pts + i));                     \
+    b = _mm_loadu_si128((__m128i *) (pts + i + 1));
+
+static size_t SIMD_SSE42 SIMD_sse42_bucket_end(
+        siridb_point_t * pts,
+        size_t n,
+        uint64_t ts)
+{
+    const __m128i sign = _mm_set1_epi64x(LLONG_MIN);
+    const __m128i lim = _mm_set1_epi64x((int64_t) ts ^ LLONG_MIN);
+    __m128i a, b, t;
+    size_t i;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        SSE42_LOAD(pts, i, a, b)
+        /* unsigned compare using a signed compare with flipped sign bits */
+        t = _mm_xor_si128(_mm_unpacklo_epi64(a, b), sign);
+        if (!_mm_testz_si128(_mm_cmpgt_epi64(t, lim), _mm_set1_epi8(-1)))
+        {
+            break;
+        }
+    }
+
+    return i + SIMD_bucket_end(pts + i, n - i, ts);
+}
+
+static int SIMD_SSE42 SIMD_sse42_sum_int(
+        siridb_point_t * pts,
+        size_t n,
+        int64_t * sum)
+{
+    __m128i a, b, v, r;
+    __m128i acc = _mm_setzero_si128();
+    __m128i ovf = _mm_setzero_si128();
+    int64_t lanes[2];
+    int64_t s;
+    size_t i;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        SSE42_LOAD(pts, i, a, b)
+        v = _mm_unpackhi_epi64(a, b);
+        r = _mm_add_epi64(acc, v);
+        /* overflow when the sign of the result differs from both inputs */
+        ovf = _mm_or_si128(ovf, _mm_and_si128(
+                _mm_xor_si128(acc, r),
+                _mm_xor_si128(v, r)));
+        acc = r;
+    }
+
+    _mm_storeu_si128((__m128i *) lanes, acc);
+
+    if (_mm_movemask_pd(_mm_castsi128_pd(ovf)) || SIMD_ADD_INT(lanes[0], lanes[1]))
+    {
+        /* let the sequential sum decide */
+        return SIMD_sum_int(pts, n, sum);
+    }
+
+    s = lanes[0] + lanes[1];
+
+    for (; i < n; i++)
+    {
+        if (SIMD_ADD_INT(s, pts[i].val.int64))
+        {
+            return SIMD_sum_int(pts, n, sum);
+        }
+        s += pts[i].val.int64;
+    }
+
+    *sum = s;
+
+    return 0;
+}
+
+static double SIMD_SSE42 SIMD_sse42_sum_real(siridb_point_t * pts, size_t n)
+{
+    __m128d acc = _mm_setzero_pd();
+    double lanes[2];
+    double sum;
+    size_t i;
+
+    if (n < SIRIDB_SIMD_REAL_MIN)
+    {
+        return SIMD_sum_real(pts, n);
+    }
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        acc = _mm_add_pd(acc, _mm_unpackhi_pd(
+                _mm_loadu_pd((double *) (pts + i)),
+                _mm_loadu_pd((double *) (pts + i + 1))));
+    }
+
+    _mm_storeu_pd(lanes, acc);
+    sum = lanes[0] + lanes[1];
+
+    for (; i < n; i++)
+    {
+        sum += pts[i].val.real;
+    }
+
+    return sum;
+}
+
+static int64_t SIMD_SSE42 SIMD_sse42_min_int(siridb_point_t * pts, size_t n)
+{
+    int64_t lanes[2];
+    __m128i a, b, v;
+    __m128i m = _mm_set1_epi64x(pts->val.int64);
+    size_t i;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        SSE42_LOAD(pts, i, a, b)
+        v = _mm_unpackhi_epi64(a, b);
+        m = _mm_blendv_epi8(m, v, _mm_cmpgt_epi64(m, v));
+    }
+
+    _mm_storeu_si128((__m128i *) lanes, m);
+
+    if (lanes[1] < lanes[0])
+    {
+        lanes[0] = lanes[1];
+    }
+
+    for (; i < n; i++)
+    {
+        if (pts[i].val.int64 < lanes[0])
+        {
+            lanes[0] = pts[i].val.int64;
+        }
+    }
+
+    return lanes[0];
+}
+
+static int64_t SIMD_SSE42 SIMD_sse42_max_int(siridb_point_t * pts, size_t n)
+{
+    int64_t lanes[2];
+    __m128i a, b, v;
+    __m128i m = _mm_set1_epi64x(pts->val.int64);
+    size_t i;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        SSE42_LOAD(pts, i, a, b)
+        v = _mm_unpackhi_epi64(a, b);
+        m = _mm_blendv_epi8(m, v, _mm_cmpgt_epi64(v, m));
+    }
+
+    _mm_storeu_si128((__m128i *) lanes, m);
+
+    if (lanes[1] > lanes[0])
+    {
+        lanes[0] = lanes[1];
+    }
+
+    for (; i < n; i++)
+    {
+        if (pts[i].val.int64 > lanes[0])
+        {
+            lanes[0] = pts[i].val.int64;
+        }
+    }
+
+    return lanes[0];
+}
+
+static double SIMD_SSE42 SIMD_sse42_min_real(siridb_point_t * pts, size_t n)
+{
+    double lanes[2];
+    __m128d m = _mm_set1_pd(pts->val.real);
+    size_t i;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        /* takes the value when smaller, like the scalar compare */
+        m = _mm_min_pd(_mm_unpackhi_pd(
+                _mm_loadu_pd((double *) (pts + i)),
+                _mm_loadu_pd((double *) (pts + i + 1))), m);
+    }
+
+    _mm_storeu_pd(lanes, m);
+
+    if (lanes[1] < lanes[0])
+    {
+        lanes[0] = lanes[1];
+    }
+
+    for (; i < n; i++)
+    {
+        if (pts[i].val.real < lanes[0])
+        {
+            lanes[0] = pts[i].val.real;
+        }
+    }
+
+    return lanes[0];
+}
+
+static double SIMD_SSE42 SIMD_sse42_max_real(siridb_point_t * pts, size_t n)
+{
+    double lanes[2];
+    __m128d m = _mm_set1_pd(pts->val.real);
+    size_t i;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        m = _mm_max_pd(_mm_unpackhi_pd(
+                _mm_loadu_pd((double *) (pts + i)),
+                _mm_loadu_pd((double *) (pts + i + 1))), m);
+    }
+
+    _mm_storeu_pd(lanes, m);
+
+    if (lanes[1] > lanes[0])
+    {
+        lanes[0] = lanes[1];
+    }
+
+    for (; i < n; i++)
+    {
+        if (pts[i].val.real > lanes[0])
+        {
+            lanes[0] = pts[i].val.real;
+        }
+    }
+
+    return lanes[0];
+}
+
+static double SIMD_SSE42 SIMD_sse42_sqdev_int(
+        siridb_point_t * pts,
+        size_t n,
+        double mean)
+{
+    const __m128d mv = _mm_set1_pd(mean);
+    __m128d acc = _mm_setzero_pd();
+    __m128d d;
+    double lanes[2];
+    double sqdev;
+    size_t i;
+
+    if (n < SIRIDB_SIMD_REAL_MIN)
+    {
+        return SIMD_sqdev_int(pts, n, mean);
+    }
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        /* there is no instruction for converting 64bit integers */
+        d = _mm_sub_pd(_mm_set_pd(
+                (double) pts[i + 1].val.int64,
+                (double) pts[i].val.int64), mv);
+        acc = _mm_add_pd(acc, _mm_mul_pd(d, d));
+    }
+
+    _mm_storeu_pd(lanes, acc);
+    sqdev = lanes[0] + lanes[1];
+
+    return sqdev + SIMD_sqdev_int(pts + i, n - i, mean);
+}
+
+static double SIMD_SSE42 SIMD_sse42_sqdev_real(
+        siridb_point_t * pts,
+        size_t n,
+        double mean)
+{
+    const __m128d mv = _mm_set1_pd(mean);
+    __m128d acc = _mm_setzero_pd();
+    __m128d d;
+    double lanes[2];
+    double sqdev;
+    size_t i;
+
+    if (n < SIRIDB_SIMD_REAL_MIN)
+    {
+        return SIMD_sqdev_real(pts, n, mean);
+    }
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        d = _mm_sub_pd(_mm_unpackhi_pd(
+                _mm_loadu_pd((double *) (pts + i)),
+                _mm_loadu_pd((double *) (pts + i + 1))), mv);
+        acc = _mm_add_pd(acc, _mm_mul_pd(d, d));
+    }
+
+    _mm_storeu_pd(lanes, acc);
+    sqdev = lanes[0] + lanes[1];
+
+    return sqdev + SIMD_sqdev_real(pts + i, n - i, mean);
+}
+
+static size_t SIMD_SSE42 SIMD_sse42_filter_int(
+        siridb_point_t * pts,
+        size_t n,
+        cexpr_operator_t opr,
+        int64_t val,
+        siridb_point_t * dest)
+{
+    const __m128i c = _mm_set1_epi64x(val);
+    siridb_point_t * dpt = dest;
+    __m128i a, b, v, m;
+    int mask, inv;
+    size_t i;
+
+    /* not equal, greater or equal and less or equal are inverted masks */
+    inv = (opr == CEXPR_NE || opr == CEXPR_GE || opr == CEXPR_LE) ? 3 : 0;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        SSE42_LOAD(pts, i, a, b)
+        v = _mm_unpackhi_epi64(a, b);
+
+        switch (opr)
+        {
+        case CEXPR_EQ:
+        case CEXPR_NE:
+            m = _mm_cmpeq_epi64(v, c);
+            break;
+        case CEXPR_GT:
+        case CEXPR_LE:
+            m = _mm_cmpgt_epi64(v, c);
+            break;
+        case CEXPR_LT:
+        case CEXPR_GE:
+            m = _mm_cmpgt_epi64(c, v);
+            break;
+        default:
+            return SIMD_filter_int(pts, n, opr, val, dest);
+        }
+
+        mask = _mm_movemask_pd(_mm_castsi128_pd(m)) ^ inv;
+        SIMD_COPY_MASK(dpt, (pts + i), mask, 3)
+    }
+
+    dpt += SIMD_filter_int(pts + i, n - i, opr, val, dpt);
+
+    return dpt - dest;
+}
+
+#define SSE42_FILTER_REAL(CMP)                                      \
+    for (i = 0; i + 2 <= n; i += 2)                                 \
+    {                                                               \
+        v = _mm_unpackhi_pd(                                        \
+                _mm_loadu_pd((double *) (pts + i)),                 \
+                _mm_loadu_pd((double *) (pts + i + 1)));            \
+        mask = _mm_movemask_pd(CMP(v, c));                          \
+        SIMD_COPY_MASK(dpt, (pts + i), mask, 3)                     \
+    }                                                               \
+    break;
+
+static size_t SIMD_SSE42 SIMD_sse42_filter_real(
+        siridb_point_t * pts,
+        size_t n,
+        cexpr_operator_t opr,
+        double val,
+        siridb_point_t * dest)
+{
+    const __m128d c = _mm_set1_pd(val);
+    siridb_point_t * dpt = dest;
+    __m128d v;
+    int mask;
+    size_t i = 0;
+
+    switch (opr)
+    {
+    case CEXPR_EQ:
+        SSE42_FILTER_REAL(_mm_cmpeq_pd)
+    case CEXPR_NE:
+        SSE42_FILTER_REAL(_mm_cmpneq_pd)
+    case CEXPR_GT:
+        SSE42_FILTER_REAL(_mm_cmpgt_pd)
+    case CEXPR_LT:
+        SSE42_FILTER_REAL(_mm_cmplt_pd)
+    case CEXPR_GE:
+        SSE42_FILTER_REAL(_mm_cmpge_pd)
+    case CEXPR_LE:
+        SSE42_FILTER_REAL(_mm_cmple_pd)
+    default:
+        break;
+    }
+
+    dpt += SIMD_filter_real(pts + i, n - i, opr, val, dpt);
+
+    return dpt - dest;
+}
+
+/*
+ * AVX2 kernels, four points at a time. After unpacking, the lanes contain
+ * points 0, 2, 1, 3. AVX2_ORDER restores the order of the points.
+ */
+#define AVX2_LOAD(pts, i, a, b)                                     \
+    a = _mm256_loadu_si256((__m256i *) (pts + i));                  \
+    b = _mm256_loadu_si256((__m256i *) (pts + i + 2));
+
+#define AVX2_LOAD_PD(pts, i)                                        \
+    _mm256_unpackhi_pd(                                             \
+            _mm256_loadu_pd((double *) (pts + i)),                  \
+            _mm256_loadu_pd((double *) (pts + i + 2)))
+
+#define AVX2_ORDER(v) _mm256_permute4x64_epi64(v, 0xD8)
+#define AVX2_ORDER_PD(v) _mm256_permute4x64_pd(v, 0xD8)
+
+static size_t SIMD_AVX2 SIMD_avx2_bucket_end(
+        siridb_point_t * pts,
+        size_t n,
+        uint64_t ts)
+{
+    const __m256i sign = _mm256_set1_epi64x(LLONG_MIN);
+    const __m256i lim = _mm256_set1_epi64x((int64_t) ts ^ LLONG_MIN);
+    __m256i a, b, m;
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        AVX2_LOAD(pts, i, a, b)
+        /* the order of lanes does not matter, only if one is greater */
+        m = _mm256_cmpgt_epi64(
+                _mm256_xor_si256(_mm256_unpacklo_epi64(a, b), sign),
+                lim);
+        if (!_mm256_testz_si256(m, m))
+        {
+            break;
+        }
+    }
+
+    return i + SIMD_bucket_end(pts + i, n - i, ts);
+}
+
+static int SIMD_AVX2 SIMD_avx2_sum_int(
+        siridb_point_t * pts,
+        size_t n,
+        int64_t * sum)
+{
+    __m256i a, b, v, r;
+    __m256i acc = _mm256_setzero_si256();
+    __m256i ovf = _mm256_setzero_si256();
+    int64_t lanes[4];
+    int64_t s = 0;
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        AVX2_LOAD(pts, i, a, b)
+        v = _mm256_unpackhi_epi64(a, b);
+        r = _mm256_add_epi64(acc, v);
+        ovf = _mm256_or_si256(ovf, _mm256_and_si256(
+                _mm256_xor_si256(acc, r),
+                _mm256_xor_si256(v, r)));
+        acc = r;
+    }
+
+    if (_mm256_movemask_pd(_mm256_castsi256_pd(ovf)))
+    {
+        return SIMD_sum_int(pts, n, sum);
+    }
+
+    _mm256_storeu_si256((__m256i *) lanes, acc);
+
+    for (int l = 0; l < 4; l++)
+    {
+        if (SIMD_ADD_INT(s, lanes[l]))
+        {
+            return SIMD_sum_int(pts, n, sum);
+        }
+        s += lanes[l];
+    }
+
+    for (; i < n; i++)
+    {
+        if (SIMD_ADD_INT(s, pts[i].val.int64))
+        {
+            return SIMD_sum_int(pts, n, sum);
+        }
+        s += pts[i].val.int64;
+    }
+
+    *sum = s;
+
+    return 0;
+}
+
+static double SIMD_AVX2 SIMD_avx2_sum_real(siridb_point_t * pts, size_t n)
+{
+    __m256d acc = _mm256_setzero_pd();
+    double lanes[4];
+    double sum;
+    size_t i;
+
+    if (n < SIRIDB_SIMD_REAL_MIN)
+    {
+        return SIMD_sum_real(pts, n);
+    }
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        acc = _mm256_add_pd(acc, AVX2_LOAD_PD(pts, i));
+    }
+
+    _mm256_storeu_pd(lanes, acc);
+    sum = (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+
+    for (; i < n; i++)
+    {
+        sum += pts[i].val.real;
+    }
+
+    return sum;
+}
+
+static int64_t SIMD_AVX2 SIMD_avx2_min_int(siridb_point_t * pts, size_t n)
+{
+    int64_t lanes[4];
+    __m256i a, b, v, w;
+    __m256i m = _mm256_set1_epi64x(pts->val.int64);
+    __m256i k = m;
+    size_t i;
+
+    /* two independent lanes so the blend latency is hidden */
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        AVX2_LOAD(pts, i, a, b)
+        v = _mm256_unpackhi_epi64(a, b);
+        m = _mm256_blendv_epi8(m, v, _mm256_cmpgt_epi64(m, v));
+        AVX2_LOAD(pts, i + 4, a, b)
+        w = _mm256_unpackhi_epi64(a, b);
+        k = _mm256_blendv_epi8(k, w, _mm256_cmpgt_epi64(k, w));
+    }
+
+    m = _mm256_blendv_epi8(m, k, _mm256_cmpgt_epi64(m, k));
+    _mm256_storeu_si256((__m256i *) lanes, m);
+
+    for (int l = 1; l < 4; l++)
+    {
+        if (lanes[l] < lanes[0])
+        {
+            lanes[0] = lanes[l];
+        }
+    }
+
+    for (; i < n; i++)
+    {
+        if (pts[i].val.int64 < lanes[0])
+        {
+            lanes[0] = pts[i].val.int64;
+        }
+    }
+
+    return lanes[0];
+}
+
+static int64_t SIMD_AVX2 SIMD_avx2_max_int(siridb_point_t * pts, size_t n)
+{
+    int64_t lanes[4];
+    __m256i a, b, v, w;
+    __m256i m = _mm256_set1_epi64x(pts->val.int64);
+    __m256i k = m;
+    size_t i;
+
+    /* two independent lanes so the blend latency is hidden */
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        AVX2_LOAD(pts, i, a, b)
+        v = _mm256_unpackhi_epi64(a, b);
+        m = _mm256_blendv_epi8(m, v, _mm256_cmpgt_epi64(v, m));
+        AVX2_LOAD(pts, i + 4, a, b)
+        w = _mm256_unpackhi_epi64(a, b);
+        k = _mm256_blendv_epi8(k, w, _mm256_cmpgt_epi64(w, k));
+    }
+
+    m = _mm256_blendv_epi8(m, k, _mm256_cmpgt_epi64(k, m));
+    _mm256_storeu_si256((__m256i *) lanes, m);
+
+    for (int l = 1; l < 4; l++)
+    {
+        if (lanes[l] > lanes[0])
+        {
+            lanes[0] = lanes[l];
+        }
+    }
+
+    for (; i < n; i++)
+    {
+        if (pts[i].val.int64 > lanes[0])
+        {
+            lanes[0] = pts[i].val.int64;
+        }
+    }
+
+    return lanes[0];
+}
+
+static double SIMD_AVX2 SIMD_avx2_min_real(siridb_point_t * pts, size_t n)
+{
+    double lanes[4];
+    __m256d m = _mm256_set1_pd(pts->val.real);
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        m = _mm256_min_pd(AVX2_LOAD_PD(pts, i), m);
+    }
+
+    _mm256_storeu_pd(lanes, m);
+
+    for (int l = 1; l < 4; l++)
+    {
+        if (lanes[l] < lanes[0])
+        {
+            lanes[0] = lanes[l];
+        }
+    }
+
+    for (; i < n; i++)
+    {
+        if (pts[i].val.real < lanes[0])
+        {
+            lanes[0] = pts[i].val.real;
+        }
+    }
+
+    return lanes[0];
+}
+
+static double SIMD_AVX2 SIMD_avx2_max_real(siridb_point_t * pts, size_t n)
+{
+    double lanes[4];
+    __m256d m = _mm256_set1_pd(pts->val.real);
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        m = _mm256_max_pd(AVX2_LOAD_PD(pts, i), m);
+    }
+
+    _mm256_storeu_pd(lanes, m);
+
+    for (int l = 1; l < 4; l++)
+    {
+        if (lanes[l] > lanes[0])
+        {
+            lanes[0] = lanes[l];
+        }
+    }
+
+    for (; i < n; i++)
+    {
+        if (pts[i].val.real > lanes[0])
+        {
+            lanes[0] = pts[i].val.real;
+        }
+    }
+
+    return lanes[0];
+}
+
+static double SIMD_AVX2 SIMD_avx2_sqdev_int(
+        siridb_point_t * pts,
+        size_t n,
+        double mean)
+{
+    const __m256d mv = _mm256_set1_pd(mean);
+    __m256d acc = _mm256_setzero_pd();
+    __m256d d;
+    double lanes[4];
+    double sqdev;
+    size_t i;
+
+    if (n < SIRIDB_SIMD_REAL_MIN)
+    {
+        return SIMD_sqdev_int(pts, n, mean);
+    }
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        /* there is no instruction for converting 64bit integers */
+        d = _mm256_sub_pd(_mm256_set_pd(
+                (double) pts[i + 3].val.int64,
+                (double) pts[i + 2].val.int64,
+                (double) pts[i + 1].val.int64,
+                (double) pts[i].val.int64), mv);
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+    }
+
+    _mm256_storeu_pd(lanes, acc);
+    sqdev = (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+
+    return sqdev + SIMD_sqdev_int(pts + i, n - i, mean);
+}
+
+static double SIMD_AVX2 SIMD_avx2_sqdev_real(
+        siridb_point_t * pts,
+        size_t n,
+        double mean)
+{
+    const __m256d mv = _mm256_set1_pd(mean);
+    __m256d acc = _mm256_setzero_pd();
+    __m256d d;
+    double lanes[4];
+    double sqdev;
+    size_t i;
+
+    if (n < SIRIDB_SIMD_REAL_MIN)
+    {
+        return SIMD_sqdev_real(pts, n, mean);
+    }
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        d = _mm256_sub_pd(AVX2_LOAD_PD(pts, i), mv);
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+    }
+
+    _mm256_storeu_pd(lanes, acc);
+    sqdev = (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+
+    return sqdev + SIMD_sqdev_real(pts + i, n - i, mean);
+}
+
+static size_t SIMD_AVX2 SIMD_avx2_filter_int(
+        siridb_point_t * pts,
+        size_t n,
+        cexpr_operator_t opr,
+        int64_t val,
+        siridb_point_t * dest)
+{
+    const __m256i c = _mm256_set1_epi64x(val);
+    siridb_point_t * dpt = dest;
+    __m256i a, b, v, m;
+    int mask, inv;
+    size_t i;
+
+    /* not equal, greater or equal and less or equal are inverted masks */
+    inv = (opr == CEXPR_NE || opr == CEXPR_GE || opr == CEXPR_LE) ? 15 : 0;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        AVX2_LOAD(pts, i, a, b)
+        v = AVX2_ORDER(_mm256_unpackhi_epi64(a, b));
+
+        switch (opr)
+        {
+        case CEXPR_EQ:
+        case CEXPR_NE:
+            m = _mm256_cmpeq_epi64(v, c);
+            break;
+        case CEXPR_GT:
+        case CEXPR_LE:
+            m = _mm256_cmpgt_epi64(v, c);
+            break;
+        case CEXPR_LT:
+        case CEXPR_GE:
+            m = _mm256_cmpgt_epi64(c, v);
+            break;
+        default:
+            return SIMD_filter_int(pts, n, opr, val, dest);
+        }
+
+        mask = _mm256_movemask_pd(_mm256_castsi256_pd(m)) ^ inv;
+        SIMD_COPY_MASK(dpt, (pts + i), mask, 15)
+    }
+
+    dpt += SIMD_filter_int(pts + i, n - i, opr, val, dpt);
+
+    return dpt - dest;
+}
+
+#define AVX2_FILTER_REAL(PRED)                                      \
+    for (i = 0; i + 4 <= n; i += 4)                                 \
+    {                                                               \
+        v = AVX2_ORDER_PD(AVX2_LOAD_PD(pts, i));                    \
+        mask = _mm256_movemask_pd(_mm256_cmp_pd(v, c, PRED));       \
+        SIMD_COPY_MASK(dpt, (pts + i), mask, 15)                    \
+    }                                                               \
+    break;
+
+static size_t SIMD_AVX2 SIMD_avx2_filter_real(
+        siridb_point_t * pts,
+        size_t n,
+        cexpr_operator_t opr,
+        double val,
+        siridb_point_t * dest)
+{
+    const __m256d c = _mm256_set1_pd(val);
+    siridb_point_t * dpt = dest;
+    __m256d v;
+    int mask;
+    size_t i = 0;
+
+    /* predicates are equal to the C compare operators, also for NaN */
+    switch (opr)
+    {
+    case CEXPR_EQ:
+        AVX2_FILTER_REAL(_CMP_EQ_OQ)
+    case CEXPR_NE:
+        AVX2_FILTER_REAL(_CMP_NEQ_UQ)
+    case CEXPR_GT:
+        AVX2_FILTER_REAL(_CMP_GT_OQ)
+    case CEXPR_LT:
+        AVX2_FILTER_REAL(_CMP_LT_OQ)
+    case CEXPR_GE:
+        AVX2_FILTER_REAL(_CMP_GE_OQ)
+    case CEXPR_LE:
+        AVX2_FILTER_REAL(_CMP_LE_OQ)
+    default:
+        break;
+    }
+
+    dpt += SIMD_filter_real(pts + i, n - i, opr, val, dpt);
+
+    return dpt - dest;
+}
+
+#endif  /* SIMD_X86 */
+
+/*
+ * Micro benchmark for the kernels, started with --bench-aggregates.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ */
+int siridb_simd_bench(void)
+{
+    static const char * names[3] = {"scalar", "sse4.2", "avx2"};
+    const siridb_simd_t * simd;
+    siridb_point_t * ipts, * rpts, * dest;
+    volatile double rsink = 0.0;
+    volatile int64_t isink = 0;
+    volatile size_t ssink = 0;
+    int64_t isum;
+    timeit_t start;
+    size_t n = SIMD_BENCH_POINTS;
+
+    siridb_simd_init();
+
+    ipts = (siridb_point_t *) malloc(n * sizeof(siridb_point_t));
+    rpts = (siridb_point_t *) malloc(n * sizeof(siridb_point_t));
+    dest = (siridb_point_t *) malloc(n * sizeof(siridb_point_t));
+
+    if (ipts == NULL || rpts == NULL || dest == NULL)
+    {
+        free(ipts);
+        free(rpts);
+        free(dest);
+        return -1;
+    }
+
+    srand(42);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        ipts[i].ts = rpts[i].ts = 1000000 + i * 10;
+        ipts[i].val.int64 = rand() % 2001 - 1000;
+        rpts[i].val.real = (double) (rand() % 2001 - 1000) / 7.0;
+    }
+
+    printf("Aggregation kernels, %zu points, %d loops (ms per loop)\n\n",
+            n, SIMD_BENCH_LOOPS);
+    printf("%-14s", "kernel");
+    for (int k = 0; k < 3; k++)
+    {
+        printf("%12s", names[k]);
+    }
+    printf("\n");
+
+#define SIMD_BENCH(title, expr)                                     \
+    printf("%-14s", title);                                         \
+    for (int k = 0; k < 3; k++)                                     \
+    {                                                               \
+        if ((simd = siridb_simd_get(names[k])) == NULL)             \
+        {                                                           \
+            printf("%12s", "n/a");                                  \
+            continue;                                               \
+        }                                                           \
+        timeit_start(&start);                                       \
+        for (int l = 0; l < SIMD_BENCH_LOOPS; l++)                  \
+        {                                                           \
+            expr;                                                   \
+        }                                                           \
+        printf("%12.3f", timeit_stop(&start) / SIMD_BENCH_LOOPS);   \
+    }                                                               \
+    printf("\n");
+
+    SIMD_BENCH("bucket_end", ssink += simd->bucket_end(
+            ipts, n, ipts[n - 1].ts - 5))
+    SIMD_BENCH("sum_int",
+            simd->sum_int(ipts, n, &isum); isink += isum)
+    SIMD_BENCH("sum_real", rsink += simd->sum_real(rpts, n))
+    SIMD_BENCH("min_int", isink += simd->min_int(ipts, n))
+    SIMD_BENCH("max_int", isink += simd->max_int(ipts, n))
+    SIMD_BENCH("min_real", rsink += simd->min_real(rpts, n))
+    SIMD_BENCH("max_real", rsink += simd->max_real(rpts, n))
+    SIMD_BENCH("sqdev_int", rsink += simd->sqdev_int(ipts, n, 0.5))
+    SIMD_BENCH("sqdev_real", rsink += simd->sqdev_real(rpts, n, 0.5))
+    SIMD_BENCH("filter_int", ssink += simd->filter_int(
+            ipts, n, CEXPR_GT, 0, dest))
+    SIMD_BENCH("filter_real", ssink += simd->filter_real(
+            rpts, n, CEXPR_LE, 0.0, dest))
+
+#undef SIMD_BENCH
+
+    printf("\nSelected kernels: %s\n", siridb_simd->name);
+
+    free(ipts);
+    free(rpts);
+    free(dest);
+
+    return 0;
+}
@@ -0,0 +1,895 @@
+/*
+ * sketch.c - Mergeable sketch for approximate percentiles.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * A value x > 0 is counted in bucket i = ceil(log_gamma(x)) with
+ * gamma = (1 + alpha) / (1 - alpha). Every value in bucket i is between
+ * gamma^(i-1) and gamma^i so the bucket value 2 * gamma^i / (gamma + 1) is
+ * within alpha of each of them. Negative values are counted in a second store
+ * using the absolute value.
+ *
+ * The number of buckets is limited to SKETCH_MAX_BINS for each store. When
+ * more are required, the buckets closest to zero are collapsed into one so
+ * only the accuracy of the lowest (absolute) values is lost.
+ *
+ * Packed sketches use host byte order and are only exchanged between servers
+ * within one database.
+ */
+#include <assert.h>
+#include <logger/logger.h>
+#include <math.h>
+#include <siri/db/simd.h>
+#include <siri/db/sketch.h>
+#include <siri/err.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SKETCH_GAMMA \
+    ((1.0 + SIRIDB_SKETCH_ALPHA) / (1.0 - SIRIDB_SKETCH_ALPHA))
+#define SKETCH_LN_GAMMA log(SKETCH_GAMMA)
+
+/* absolute values below this value are counted as zero */
+#define SKETCH_MIN_VALUE 1e-9
+
+/* buckets for each store, 4096 buckets cover a range of about 1e36 */
+#define SKETCH_MAX_BINS 4096
+
+/* extra buckets allocated when a store grows */
+#define SKETCH_PAD 16
+
+#define SKETCH_MAGIC 0x31534453     /* "SDS1" */
+
+typedef struct sketch_head_s
+{
+    uint64_t ts;
+    uint64_t count;
+    uint64_t zero;
+    double min;
+    double max;
+    int32_t pos_offset;
+    uint32_t pos_len;
+    int32_t neg_offset;
+    uint32_t neg_len;
+} sketch_head_t;
+
+static int SKETCH_store_add(
+        siridb_sketch_store_t * store,
+        int32_t idx,
+        uint64_t n);
+static int SKETCH_store_extend(
+        siridb_sketch_store_t * store,
+        int32_t lo,
+        int32_t hi);
+static int SKETCH_store_merge(
+        siridb_sketch_store_t * store,
+        siridb_sketch_store_t * other);
+static void SKETCH_store_trim(
+        siridb_sketch_store_t * store,
+        uint32_t * start,
+        uint32_t * len);
+static inline int32_t SKETCH_index(double val);
+static inline double SKETCH_value(int32_t idx);
+static int SKETCH_window(
+        siridb_sketches_t * sketches,
+        size_t * pos,
+        uint64_t ts);
+
+void siridb_sketch_init(siridb_sketch_t * sketch)
+{
+    memset(sketch, 0, sizeof(siridb_sketch_t));
+}
+
+/*
+ * Clear all counts but keep the allocated buckets.
+ */
+void siridb_sketch_reset(siridb_sketch_t * sketch)
+{
+    sketch->count = 0;
+    sketch->zero = 0;
+    if (sketch->pos.len)
+    {
+        memset(sketch->pos.counts, 0, sketch->pos.len * sizeof(uint64_t));
+    }
+    if (sketch->neg.len)
+    {
+        memset(sketch->neg.counts, 0, sketch->neg.len * sizeof(uint64_t));
+    }
+}
+
+void siridb_sketch_destroy(siridb_sketch_t * sketch)
+{
+    free(sketch->pos.counts);
+    free(sketch->neg.counts);
+    siridb_sketch_init(sketch);
+}
+
+/*
+ * Add a value to the sketch. NaN and infinite values are ignored.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ * (a signal is raised in case of an allocation error)
+ */
+int siridb_sketch_add(siridb_sketch_t * sketch, double val)
+{
+    if (!isfinite(val))
+    {
+        return 0;
+    }
+
+    if (val >= SKETCH_MIN_VALUE)
+    {
+        if (SKETCH_store_add(&sketch->pos, SKETCH_index(val), 1))
+        {
+            return -1;
+        }
+    }
+    else if (val <= -SKETCH_MIN_VALUE)
+    {
+        if (SKETCH_store_add(&sketch->neg, SKETCH_index(-val), 1))
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        sketch->zero++;
+    }
+
+    if (!sketch->count++)
+    {
+        sketch->min = sketch->max = val;
+    }
+    else if (val < sketch->min)
+    {
+        sketch->min = val;
+    }
+    else if (val > sketch->max)
+    {
+        sketch->max = val;
+    }
+
+    return 0;
+}
+
+/*
+ * Add the values of n points to the sketch. The points must be integer or
+ * double type.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ */
+int siridb_sketch_add_points(
+        siridb_sketch_t * sketch,
+        siridb_point_t * pts,
+        size_t n,
+        points_tp tp)
+{
+#ifdef DEBUG
+    assert (tp != TP_STRING);
+#endif
+    size_t i;
+
+    if (tp == TP_INT)
+    {
+        for (i = 0; i < n; i++)
+        {
+            if (siridb_sketch_add(sketch, (double) pts[i].val.int64))
+            {
+                return -1;
+            }
+        }
+    }
+    else
+    {
+        for (i = 0; i < n; i++)
+        {
+            if (siridb_sketch_add(sketch, pts[i].val.real))
+            {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Add the counts of other to the sketch. The other sketch is not changed.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ */
+int siridb_sketch_merge(siridb_sketch_t * sketch, siridb_sketch_t * other)
+{
+    if (!other->count)
+    {
+        return 0;
+    }
+
+    if (SKETCH_store_merge(&sketch->pos, &other->pos) ||
+        SKETCH_store_merge(&sketch->neg, &other->neg))
+    {
+        return -1;
+    }
+
+    if (!sketch->count)
+    {
+        sketch->min = other->min;
+        sketch->max = other->max;
+    }
+    else
+    {
+        if (other->min < sketch->min)
+        {
+            sketch->min = other->min;
+        }
+        if (other->max > sketch->max)
+        {
+            sketch->max = other->max;
+        }
+    }
+
+    sketch->count += other->count;
+    sketch->zero += other->zero;
+
+    return 0;
+}
+
+/*
+ * Returns the approximate value at quantile q (0.0 - 1.0) or NaN when the
+ * sketch is empty. The value at rank q * (count - 1) is returned, which
+ * matches how the exact percentile is found.
+ */
+double siridb_sketch_quantile(siridb_sketch_t * sketch, double q)
+{
+    uint64_t rank, seen = 0;
+    double val;
+    uint32_t i;
+
+    if (!sketch->count)
+    {
+        return NAN;
+    }
+
+    if (q <= 0.0)
+    {
+        return sketch->min;
+    }
+
+    if (q >= 1.0)
+    {
+        return sketch->max;
+    }
+
+    rank = (uint64_t) (q * (sketch->count - 1));
+
+    /* negative values, from the highest absolute value */
+    for (i = sketch->neg.len; i--;)
+    {
+        seen += sketch->neg.counts[i];
+        if (seen > rank)
+        {
+            val = -SKETCH_value(sketch->neg.offset + (int32_t) i);
+            goto found;
+        }
+    }
+
+    seen += sketch->zero;
+    if (seen > rank)
+    {
+        val = 0.0;
+        goto found;
+    }
+
+    for (i = 0; i < sketch->pos.len; i++)
+    {
+        seen += sketch->pos.counts[i];
+        if (seen > rank)
+        {
+            val = SKETCH_value(sketch->pos.offset + (int32_t) i);
+            goto found;
+        }
+    }
+
+    /* not reached, the counts add up to sketch->count */
+    return sketch->max;
+
+found:
+    return (val < sketch->min) ?
+            sketch->min : (val > sketch->max) ? sketch->max : val;
+}
+
+/*
+ * Returns a new sketches object for windows of group_by, or NULL in case of
+ * an allocation error.
+ */
+siridb_sketches_t * siridb_sketches_new(uint64_t group_by)
+{
+#ifdef DEBUG
+    assert (group_by);
+#endif
+    siridb_sketches_t * sketches =
+            (siridb_sketches_t *) malloc(sizeof(siridb_sketches_t));
+    if (sketches == NULL)
+    {
+        ERR_ALLOC
+        return NULL;
+    }
+    sketches->len = 0;
+    sketches->size = 0;
+    sketches->group_by = group_by;
+    sketches->windows = NULL;
+    return sketches;
+}
+
+void siridb_sketches_free(siridb_sketches_t * sketches)
+{
+    for (size_t i = 0; i < sketches->len; i++)
+    {
+        siridb_sketch_destroy(&sketches->windows[i].sketch);
+    }
+    free(sketches->windows);
+    free(sketches);
+}
+
+/*
+ * Add points to the window sketches. Points are grouped the same way as by
+ * a group_by aggregate.
+ *
+ * Returns 0 if successful or -1 in case of an error. In case of an error
+ * err_msg is set. (a signal might be raised in case of an allocation error)
+ */
+int siridb_sketches_add_points(
+        siridb_sketches_t * sketches,
+        siridb_points_t * points,
+        char * err_msg)
+{
+    uint64_t group_by = sketches->group_by;
+    siridb_point_t * pts = points->data;
+    size_t n = points->len, end, pos = 0;
+    uint64_t ts;
+
+    if (points->tp == TP_STRING)
+    {
+        sprintf(err_msg, "Cannot use a percentile on string type.");
+        return -1;
+    }
+
+    while (n)
+    {
+        ts = (pts->ts + group_by - 1) / group_by * group_by;
+        end = siridb_simd->bucket_end(pts, n, ts);
+
+        if (SKETCH_window(sketches, &pos, ts) ||
+            siridb_sketch_add_points(
+                    &sketches->windows[pos].sketch,
+                    pts,
+                    end,
+                    points->tp))
+        {
+            sprintf(err_msg, "Memory allocation error.");
+            return -1;
+        }
+
+        pts += end;
+        n -= end;
+    }
+
+    return 0;
+}
+
+/*
+ * Merge the windows of other into sketches. Both must use the same group_by
+ * value. The other sketches are not changed.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ * (a signal is raised in case of an allocation error)
+ */
+int siridb_sketches_merge(
+        siridb_sketches_t * sketches,
+        siridb_sketches_t * other)
+{
+    size_t pos = 0;
+
+    for (size_t i = 0; i < other->len; i++)
+    {
+        if (SKETCH_window(sketches, &pos, other->windows[i].ts))
+        {
+            return -1;
+        }
+        if (siridb_sketch_merge(
+                &sketches->windows[pos].sketch,
+                &other->windows[i].sketch))
+        {
+            return -1;  /* signal is raised */
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Returns double type points with the value at quantile q for each window
+ * or NULL in case of an allocation error. Windows without values are
+ * skipped. (a signal is raised in case of an allocation error)
+ */
+siridb_points_t * siridb_sketches_quantile(
+        siridb_sketches_t * sketches,
+        double q)
+{
+    siridb_points_t * points = siridb_points_new(sketches->len, TP_DOUBLE);
+    siridb_point_t * point;
+
+    if (points == NULL)
+    {
+        return NULL;  /* signal is raised */
+    }
+
+    for (size_t i = 0; i < sketches->len; i++)
+    {
+        if (!sketches->windows[i].sketch.count)
+        {
+            continue;
+        }
+        point = points->data + points->len;
+        point->ts = sketches->windows[i].ts;
+        point->val.real = siridb_sketch_quantile(
+                &sketches->windows[i].sketch,
+                q);
+        points->len++;
+    }
+
+    return points;
+}
+
+/*
+ * Pack the sketches as one raw value. Only buckets between the first and
+ * last bucket with a count are included.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ * (a signal is raised in case of an allocation error)
+ */
+int siridb_sketches_pack(siridb_sketches_t * sketches, qp_packer_t * packer)
+{
+    size_t i, size = 2 * sizeof(uint32_t);
+    uint32_t pos_start, neg_start, magic = SKETCH_MAGIC;
+    uint32_t n = (uint32_t) sketches->len;
+    siridb_sketch_t * sketch;
+    sketch_head_t head;
+    char * data, * pt;
+    int rc;
+
+    for (i = 0; i < sketches->len; i++)
+    {
+        sketch = &sketches->windows[i].sketch;
+        SKETCH_store_trim(&sketch->pos, &pos_start, &head.pos_len);
+        SKETCH_store_trim(&sketch->neg, &neg_start, &head.neg_len);
+        size += sizeof(sketch_head_t) +
+                (head.pos_len + head.neg_len) * sizeof(uint64_t);
+    }
+
+    data = pt = (char *) malloc(size);
+    if (data == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    memcpy(pt, &magic, sizeof(uint32_t));
+    pt += sizeof(uint32_t);
+    memcpy(pt, &n, sizeof(uint32_t));
+    pt += sizeof(uint32_t);
+
+    for (i = 0; i < sketches->len; i++)
+    {
+        sketch = &sketches->windows[i].sketch;
+        SKETCH_store_trim(&sketch->pos, &pos_start, &head.pos_len);
+        SKETCH_store_trim(&sketch->neg, &neg_start, &head.neg_len);
+
+        head.ts = sketches->windows[i].ts;
+        head.count = sketch->count;
+        head.zero = sketch->zero;
+        head.min = sketch->min;
+        head.max = sketch->max;
+        head.pos_offset = sketch->pos.offset + (int32_t) pos_start;
+        head.neg_offset = sketch->neg.offset + (int32_t) neg_start;
+
+        memcpy(pt, &head, sizeof(sketch_head_t));
+        pt += sizeof(sketch_head_t);
+
+        if (head.pos_len)
+        {
+            memcpy(
+                pt,
+                sketch->pos.counts + pos_start,
+                head.pos_len * sizeof(uint64_t));
+            pt += head.pos_len * sizeof(uint64_t);
+        }
+        if (head.neg_len)
+        {
+            memcpy(
+                pt,
+                sketch->neg.counts + neg_start,
+                head.neg_len * sizeof(uint64_t));
+            pt += head.neg_len * sizeof(uint64_t);
+        }
+    }
+
+    rc = qp_add_raw(packer, data, size);
+    free(data);
+
+    return rc;
+}
+
+/*
+ * Returns sketches from packed data or NULL when the data is invalid or in
+ * case of an allocation error.
+ */
+siridb_sketches_t * siridb_sketches_unpack(
+        const char * data,
+        size_t len,
+        uint64_t group_by)
+{
+    const char * end = data + len;
+    siridb_sketches_t * sketches;
+    siridb_sketch_t * sketch;
+    sketch_head_t head;
+    uint32_t magic, n;
+    size_t sz;
+
+    if (len < 2 * sizeof(uint32_t))
+    {
+        return NULL;
+    }
+
+    memcpy(&magic, data, sizeof(uint32_t));
+    data += sizeof(uint32_t);
+    memcpy(&n, data, sizeof(uint32_t));
+    data += sizeof(uint32_t);
+
+    if (magic != SKETCH_MAGIC ||
+        n > (size_t) (end - data) / sizeof(sketch_head_t))
+    {
+        return NULL;
+    }
+
+    sketches = siridb_sketches_new(group_by);
+    if (sketches == NULL)
+    {
+        return NULL;
+    }
+
+    if (n)
+    {
+        sketches->windows = (siridb_sketch_window_t *)
+                malloc(n * sizeof(siridb_sketch_window_t));
+        if (sketches->windows == NULL)
+        {
+            ERR_ALLOC
+            goto failed;
+        }
+        sketches->size = n;
+    }
+
+    for (; sketches->len < n;)
+    {
+        if ((size_t) (end - data) < sizeof(sketch_head_t))
+        {
+            goto failed;
+        }
+        memcpy(&head, data, sizeof(sketch_head_t));
+        data += sizeof(sketch_head_t);
+
+        if (head.pos_len > SKETCH_MAX_BINS ||
+            head.neg_len > SKETCH_MAX_BINS ||
+            (sketches->len &&
+                head.ts <= sketches->windows[sketches->len - 1].ts))
+        {
+            goto failed;
+        }
+
+        sz = (head.pos_len + head.neg_len) * sizeof(uint64_t);
+        if ((size_t) (end - data) < sz)
+        {
+            goto failed;
+        }
+
+        sketches->windows[sketches->len].ts = head.ts;
+        sketch = &sketches->windows[sketches->len].sketch;
+        siridb_sketch_init(sketch);
+        sketches->len++;
+
+        sketch->count = head.count;
+        sketch->zero = head.zero;
+        sketch->min = head.min;
+        sketch->max = head.max;
+
+        if (head.pos_len)
+        {
+            sketch->pos.counts = (uint64_t *)
+                    malloc(head.pos_len * sizeof(uint64_t));
+            if (sketch->pos.counts == NULL)
+            {
+                ERR_ALLOC
+                goto failed;
+            }
+            memcpy(sketch->pos.counts, data, head.pos_len * sizeof(uint64_t));
+            sketch->pos.offset = head.pos_offset;
+            sketch->pos.len = head.pos_len;
+            data += head.pos_len * sizeof(uint64_t);
+        }
+
+        if (head.neg_len)
+        {
+            sketch->neg.counts = (uint64_t *)
+                    malloc(head.neg_len * sizeof(uint64_t));
+            if (sketch->neg.counts == NULL)
+            {
+                ERR_ALLOC
+                goto failed;
+            }
+            memcpy(sketch->neg.counts, data, head.neg_len * sizeof(uint64_t));
+            sketch->neg.offset = head.neg_offset;
+            sketch->neg.len = head.neg_len;
+            data += head.neg_len * sizeof(uint64_t);
+        }
+    }
+
+    if (data != end)
+    {
+        goto failed;
+    }
+
+    return sketches;
+
+failed:
+    siridb_sketches_free(sketches);
+    return NULL;
+}
+
+static inline int32_t SKETCH_index(double val)
+{
+    return (int32_t) ceil(log(val) / SKETCH_LN_GAMMA);
+}
+
+static inline double SKETCH_value(int32_t idx)
+{
+    return 2.0 * exp(idx * SKETCH_LN_GAMMA) / (1.0 + SKETCH_GAMMA);
+}
+
+/*
+ * Add n to bucket idx.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ */
+static int SKETCH_store_add(
+        siridb_sketch_store_t * store,
+        int32_t idx,
+        uint64_t n)
+{
+    if (!store->len ||
+        idx < store->offset ||
+        (int64_t) idx >= (int64_t) store->offset + store->len)
+    {
+        if (SKETCH_store_extend(store, idx, idx))
+        {
+            return -1;
+        }
+        if (idx < store->offset)
+        {
+            /* collapsed with the lowest bucket */
+            idx = store->offset;
+        }
+    }
+
+    store->counts[idx - store->offset] += n;
+
+    return 0;
+}
+
+/*
+ * Make sure buckets lo until hi (inclusive) fit in the store. Buckets are
+ * padded at the side where the store grows so adding values in order does
+ * not allocate for each new bucket. When the range does not fit in
+ * SKETCH_MAX_BINS, the lowest buckets are collapsed.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ */
+static int SKETCH_store_extend(
+        siridb_sketch_store_t * store,
+        int32_t lo,
+        int32_t hi)
+{
+    int64_t start, stop, pad, j;
+    uint64_t * counts;
+
+    start = lo;
+    stop = hi;
+
+    if (store->len)
+    {
+        if (store->offset < start)
+        {
+            start = store->offset;
+        }
+        if ((int64_t) store->offset + store->len - 1 > stop)
+        {
+            stop = (int64_t) store->offset + store->len - 1;
+        }
+    }
+
+    if (stop - start + 1 > SKETCH_MAX_BINS)
+    {
+        start = stop - SKETCH_MAX_BINS + 1;
+    }
+    else
+    {
+        pad = (stop - start + 1) / 2 + SKETCH_PAD;
+
+        if (!store->len || lo < store->offset)
+        {
+            start -= pad;
+        }
+        if (!store->len || hi > (int64_t) store->offset + store->len - 1)
+        {
+            stop += pad;
+        }
+
+        /* remove padding which does not fit */
+        if (stop - start + 1 > SKETCH_MAX_BINS)
+        {
+            if (store->len && hi > (int64_t) store->offset + store->len - 1)
+            {
+                stop = start + SKETCH_MAX_BINS - 1;
+            }
+            else
+            {
+                start = stop - SKETCH_MAX_BINS + 1;
+            }
+        }
+    }
+
+    counts = (uint64_t *) calloc(stop - start + 1, sizeof(uint64_t));
+    if (counts == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < store->len; i++)
+    {
+        j = (int64_t) store->offset + i;
+        counts[((j < start) ? start : j) - start] += store->counts[i];
+    }
+
+    free(store->counts);
+    store->counts = counts;
+    store->offset = (int32_t) start;
+    store->len = (uint32_t) (stop - start + 1);
+
+    return 0;
+}
+
+/*
+ * Add the counts of other to store.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ */
+static int SKETCH_store_merge(
+        siridb_sketch_store_t * store,
+        siridb_sketch_store_t * other)
+{
+    uint32_t start, len;
+    int32_t lo, hi, idx;
+
+    SKETCH_store_trim(other, &start, &len);
+
+    if (!len)
+    {
+        return 0;
+    }
+
+    lo = other->offset + (int32_t) start;
+    hi = lo + (int32_t) len - 1;
+
+    if ((!store->len ||
+            lo < store->offset ||
+            (int64_t) hi >= (int64_t) store->offset + store->len) &&
+        SKETCH_store_extend(store, lo, hi))
+    {
+        return -1;
+    }
+
+    for (uint32_t i = start; i < start + len; i++)
+    {
+        idx = other->offset + (int32_t) i;
+        store->counts[((idx < store->offset) ? store->offset : idx) -
+                      store->offset] += other->counts[i];
+    }
+
+    return 0;
+}
+
+/*
+ * Set start and len to the range of buckets from the first until the last
+ * bucket with a count.
+ */
+static void SKETCH_store_trim(
+        siridb_sketch_store_t * store,
+        uint32_t * start,
+        uint32_t * len)
+{
+    uint32_t lo = 0, hi = store->len;
+
+    while (lo < hi && !store->counts[lo])
+    {
+        lo++;
+    }
+
+    while (hi > lo && !store->counts[hi - 1])
+    {
+        hi--;
+    }
+
+    *start = lo;
+    *len = hi - lo;
+}
+
+/*
+ * Set pos to the window for ts, a new window is inserted when required.
+ * Windows are searched from pos so pos should be 0 or the position of a
+ * window with a lower timestamp.
+ *
+ * Returns 0 if successful or -1 in case of an allocation error.
+ * (a signal is raised in case of an allocation error)
+ */
+static int SKETCH_window(
+        siridb_sketches_t * sketches,
+        size_t * pos,
+        uint64_t ts)
+{
+    size_t i = *pos;
+    siridb_sketch_window_t * windows;
+
+    while (i < sketches->len && sketches->windows[i].ts < ts)
+    {
+        i++;
+    }
+
+    *pos = i;
+
+    if (i < sketches->len && sketches->windows[i].ts == ts)
+    {
+        return 0;
+    }
+
+    if (sketches->len == sketches->size)
+    {
+        size_t size = (sketches->size) ? sketches->size * 2 : 8;
+        windows = (siridb_sketch_window_t *) realloc(
+                sketches->windows,
+                size * sizeof(siridb_sketch_window_t));
+        if (windows == NULL)
+        {
+            ERR_ALLOC
+            return -1;
+        }
+        sketches->windows = windows;
+        sketches->size = size;
+    }
+
+    memmove(
+        sketches->windows + i + 1,
+        sketches->windows + i,
+        (sketches->len - i) * sizeof(siridb_sketch_window_t));
+
+    sketches->windows[i].ts = ts;
+    siridb_sketch_init(&sketches->windows[i].sketch);
+    sketches->len++;
+
+    return 0;
+}
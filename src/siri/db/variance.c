@@ -7,54 +7,28 @@
  *
  * changes
  *  - initial version, 10-08-2016
+ *  - use vector kernels, 18-10-2026
  *
  */
 #include <assert.h>
-#include <math.h>
 #include <siri/db/points.h>
+#include <siri/db/simd.h>
 #include <siri/db/variance.h>
 
 double siridb_variance(siridb_points_t * points)
 {
-    double mean = 0.0;
-    double variance = 0.0;
+    double mean = siridb_simd_mean(points);
 
     switch (points->tp)
     {
     case TP_INT:
-        for (size_t i = 0; i < points->len; i++)
-        {
-           mean += (points->data + i)->val.int64;
-        }
-
-        mean /= points->len;
-
-        for (size_t i = 0; i < points->len; i++)
-        {
-            variance += pow(
-                   (double) (points->data + i)->val.int64 - mean,
-                   2);
-        }
-        break;\
+        return (*siridb_simd->sqdev_int)(points->data, points->len, mean);
     case TP_DOUBLE:
-        for (size_t i = 0; i < points->len; i++)
-        {
-           mean += (points->data + i)->val.real;
-        }
-
-        mean /= points->len;
-
-        for (size_t i = 0; i < points->len; i++)
-        {
-            variance += pow(
-                   (points->data + i)->val.real - mean,
-                   2);
-        }
-        break;
+        return (*siridb_simd->sqdev_real)(points->data, points->len, mean);
     default:
         assert (0);
         break;
     }
 
-    return variance;
+    return 0.0;
 }
@@ -0,0 +1,937 @@
+/*
+ * wal.c - Write-ahead log for a server with a replica.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * The write-ahead log file has the following layout:
+ *
+ *  [checkpoint (uint32)][base (uint64)][lsn (uint64)]
+ *  [epoch lsn (uint64)][epoch max series id (uint32)]...
+ *
+ * A series replays packages starting at 'lsn' when the buffer was written
+ * by 'checkpoint', at 'base' when the buffer was written by an older
+ * checkpoint and does not replay at all when the buffer was written by a
+ * newer checkpoint. An 'lsn' equal to 0 means there is nothing to replay.
+ */
+#include <assert.h>
+#include <logger/logger.h>
+#include <siri/db/buffer.h>
+#include <siri/db/fifo.h>
+#include <siri/db/insert.h>
+#include <siri/db/series.h>
+#include <siri/db/wal.h>
+#include <siri/err.h>
+#include <siri/net/protocol.h>
+#include <siri/siri.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define SIRIDB_WAL_FN "wal.dat"
+#define WAL_HEADER_SIZE \
+    (sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint64_t))
+#define WAL_EPOCH_SIZE (sizeof(uint64_t) + sizeof(uint32_t))
+
+/* replay start for a series, stored in wal_replay_t->start */
+#define WAL_REPLAY_SKIP 1
+#define WAL_REPLAY_FROM_LSN 2
+#define WAL_REPLAY_FROM_BASE 3
+
+typedef struct wal_replay_s
+{
+    siridb_t * siridb;
+    imap_t * start;
+    siridb_pcache_t * pcache;
+    size_t npkgs;
+} wal_replay_t;
+
+typedef struct wal_flush_s
+{
+    siridb_t * siridb;
+    uint32_t checkpoint;
+} wal_flush_t;
+
+static siridb_wal_t * WAL_new(void);
+static int WAL_read(siridb_wal_t * wal, const char * fn);
+static int WAL_save(
+        siridb_wal_t * wal,
+        uint32_t checkpoint,
+        uint64_t base,
+        uint64_t lsn);
+static int WAL_flush(siridb_t * siridb, uint32_t checkpoint);
+static int WAL_flush_series(void * data, wal_flush_t * w);
+static int WAL_replay(siridb_t * siridb);
+static int WAL_replay_pkg(
+        sirinet_pkg_t * pkg,
+        uint64_t lsn,
+        wal_replay_t * replay);
+static int WAL_replay_skip(
+        wal_replay_t * replay,
+        siridb_series_t * series,
+        uint64_t lsn);
+static void WAL_on_timer(uv_timer_t * timer);
+static void WAL_checkpoint(siridb_t * siridb);
+static void WAL_release(siridb_wal_t * wal);
+
+/*
+ * Create the write-ahead log and apply packages which are inserted after
+ * the last checkpoint. This must be called after the buffer and shards are
+ * loaded and before series properties are updated.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ * (a signal might be raised)
+ */
+int siridb_wal_load(siridb_t * siridb)
+{
+    siridb->wal = WAL_new();
+    if (siridb->wal == NULL)
+    {
+        return -1;  /* signal is raised */
+    }
+
+    SIRIDB_GET_FN(fn, siridb->dbpath, SIRIDB_WAL_FN)
+
+    if (WAL_read(siridb->wal, fn))
+    {
+        log_critical("Cannot read write-ahead log: '%s'", fn);
+        return -1;
+    }
+
+    return (siridb->wal->lsn) ? WAL_replay(siridb) : 0;
+}
+
+/*
+ * Start the checkpoint timer. The write-ahead log is switched on at the
+ * first checkpoint when siridb_wal_enabled() is true.
+ */
+void siridb_wal_start(siridb_t * siridb)
+{
+    siridb_wal_t * wal = siridb->wal;
+
+    if (!siri.cfg->wal_checkpoint_interval)
+    {
+        return;
+    }
+
+    wal->timer = (uv_timer_t *) malloc(sizeof(uv_timer_t));
+    if (wal->timer == NULL)
+    {
+        ERR_ALLOC
+        return;
+    }
+
+    wal->timer->data = siridb;
+    uv_timer_init(siri.loop, wal->timer);
+    uv_timer_start(
+            wal->timer,
+            WAL_on_timer,
+            siri.cfg->wal_checkpoint_interval,
+            siri.cfg->wal_checkpoint_interval);
+}
+
+/*
+ * Stop the checkpoint timer and release insert tasks which are waiting for
+ * a checkpoint. This is called when SiriDB is closing.
+ */
+void siridb_wal_close(siridb_t * siridb)
+{
+    siridb_wal_t * wal = siridb->wal;
+
+    if (wal->timer != NULL)
+    {
+        uv_timer_stop(wal->timer);
+        uv_close((uv_handle_t *) wal->timer, (uv_close_cb) free);
+        wal->timer = NULL;
+    }
+
+    WAL_release(wal);
+}
+
+/*
+ * Write buffers which are only in memory and destroy the write-ahead log.
+ * This must be called before the buffer file and fifo buffer are closed.
+ *
+ * (a signal might be raised)
+ */
+void siridb_wal_free(siridb_t * siridb)
+{
+    siridb_wal_t * wal = siridb->wal;
+
+    if (wal->timer != NULL)
+    {
+        siridb_wal_close(siridb);
+    }
+
+    siridb_wal_stop(siridb);
+
+    if (wal->fp != NULL && fclose(wal->fp))
+    {
+        ERR_FILE
+    }
+
+    for (int i = 0; i < SIRIDB_SERIES_STRIPES; i++)
+    {
+        if (wal->dirty[i] != NULL)
+        {
+            imap_free(wal->dirty[i], NULL);
+        }
+    }
+
+    /* held insert tasks are released by siridb_wal_close() */
+    llist_free_cb(wal->held, NULL, NULL);
+    free(wal->epochs);
+    free(wal);
+
+    siridb->wal = NULL;
+}
+
+/*
+ * Returns 1 (true) when the fifo buffer can be used as write-ahead log or
+ * 0 (false) if not.
+ */
+int siridb_wal_enabled(siridb_t * siridb)
+{
+    return (siri.cfg->wal_checkpoint_interval &&
+            siridb->replica != NULL &&
+            siridb->fifo != NULL &&
+            siridb->replicate != NULL &&
+            siridb->replicate->initsync == NULL &&
+            siridb->replicate->status != REPLICATE_CLOSED &&
+            (~siridb->server->flags & SERVER_FLAG_BACKUP_MODE) &&
+            siridb_fifo_is_open(siridb->fifo));
+}
+
+/*
+ * Switch the write-ahead log off. Buffers which are only in memory are
+ * written and packages which are send to the replica are removed from the
+ * fifo buffer. This must be called before the fifo buffer is closed or
+ * destroyed.
+ *
+ * (a signal is raised in case of an error)
+ */
+void siridb_wal_stop(siridb_t * siridb)
+{
+    siridb_wal_t * wal = siridb->wal;
+    int rc;
+
+    if (wal->status == SIRIDB_WAL_OFF)
+    {
+        return;
+    }
+
+    /*
+     * Buffers are written with a newer checkpoint than the one in the log
+     * so these series do not replay when this is interrupted.
+     */
+    siridb_series_lock_stripes(siridb);
+
+    wal->status = SIRIDB_WAL_OFF;
+
+    rc = (  WAL_flush(siridb, wal->checkpoint + 1) ||
+            WAL_save(wal, wal->checkpoint + 1, 0, 0));
+
+    siridb_series_unlock_stripes(siridb);
+
+    if (rc)
+    {
+        log_critical(
+                "Cannot write buffers for the write-ahead log of '%s'",
+                siridb->dbname);
+        if (!siri_err)
+        {
+            ERR_FILE
+        }
+    }
+
+    wal->checkpoint++;
+    wal->base = wal->lsn = 0;
+    wal->n = 0;
+
+    if (siridb->fifo != NULL && siridb_fifo_is_open(siridb->fifo))
+    {
+        siridb_fifo_set_retain(siridb->fifo, 0);
+    }
+
+    WAL_release(wal);
+
+    log_info("Write-ahead log is switched off for '%s'", siridb->dbname);
+}
+
+/*
+ * Start an insert task. The task is held while a checkpoint is waiting for
+ * other insert tasks to finish.
+ */
+void siridb_wal_insert_start(siridb_t * siridb, uv_async_t * handle)
+{
+    siridb_wal_t * wal = siridb->wal;
+
+    if (wal->hold && llist_append(wal->held, handle) == 0)
+    {
+        return;
+    }
+
+    wal->inserts++;
+    uv_async_send(handle);
+}
+
+/*
+ * Must be called when an insert task is finished.
+ *
+ * (a signal might be raised)
+ */
+void siridb_wal_insert_done(siridb_t * siridb)
+{
+    siridb_wal_t * wal = siridb->wal;
+
+    wal->inserts--;
+
+    if (wal->hold && !wal->inserts)
+    {
+        WAL_checkpoint(siridb);
+    }
+}
+
+/*
+ * Mark a series as changed so the buffer is written at the next checkpoint.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ *
+ * Warning: the series stripe must be locked.
+ */
+int siridb_wal_dirty(siridb_t * siridb, siridb_series_t * series)
+{
+    /* series id 0 is never used so the id can be used as value */
+    return (imap_add(
+            siridb->wal->dirty[series->id % SIRIDB_SERIES_STRIPES],
+            series->id,
+            (void *) (uintptr_t) series->id) < 0) ? -1 : 0;
+}
+
+/*
+ * Save an epoch when a series is dropped while the write-ahead log is on.
+ * Packages before the epoch are not replayed for series which are created
+ * after the drop.
+ */
+void siridb_wal_drop(siridb_t * siridb)
+{
+    siridb_wal_t * wal = siridb->wal;
+    siridb_wal_epoch_t * epoch;
+    uint64_t lsn;
+
+    if (wal->status == SIRIDB_WAL_OFF)
+    {
+        return;
+    }
+
+    lsn = siridb_fifo_head(siridb->fifo);
+    epoch = (wal->n) ? wal->epochs + wal->n - 1 : NULL;
+
+    if (epoch != NULL && epoch->lsn == lsn)
+    {
+        if (epoch->max_series_id == siridb->max_series_id)
+        {
+            return;
+        }
+        /* overwrite the last epoch in the file */
+        if (fseeko(wal->fp, -(off_t) WAL_EPOCH_SIZE, SEEK_END))
+        {
+            log_error("Cannot save epoch in the write-ahead log");
+            return;
+        }
+    }
+    else
+    {
+        if (wal->n == wal->sz)
+        {
+            size_t sz = (wal->sz) ? wal->sz * 2 : 8;
+            siridb_wal_epoch_t * tmp = (siridb_wal_epoch_t *) realloc(
+                    wal->epochs,
+                    sz * sizeof(siridb_wal_epoch_t));
+            if (tmp == NULL)
+            {
+                ERR_ALLOC
+                return;
+            }
+            wal->epochs = tmp;
+            wal->sz = sz;
+        }
+        epoch = wal->epochs + wal->n++;
+        epoch->lsn = lsn;
+
+        if (fseeko(wal->fp, 0, SEEK_END))
+        {
+            log_error("Cannot save epoch in the write-ahead log");
+            return;
+        }
+    }
+
+    epoch->max_series_id = siridb->max_series_id;
+
+    if (    fwrite(&epoch->lsn, sizeof(uint64_t), 1, wal->fp) != 1 ||
+            fwrite(&epoch->max_series_id, sizeof(uint32_t), 1, wal->fp) != 1 ||
+            fflush(wal->fp))
+    {
+        log_error("Cannot save epoch in the write-ahead log");
+    }
+}
+
+/*
+ * Returns NULL and raises a SIGNAL in case an error has occurred.
+ */
+static siridb_wal_t * WAL_new(void)
+{
+    siridb_wal_t * wal = (siridb_wal_t *) calloc(1, sizeof(siridb_wal_t));
+    int i;
+
+    if (wal == NULL)
+    {
+        ERR_ALLOC
+        return NULL;
+    }
+
+    wal->status = SIRIDB_WAL_OFF;
+    wal->held = llist_new();
+
+    for (i = 0; wal->held != NULL && i < SIRIDB_SERIES_STRIPES; i++)
+    {
+        if ((wal->dirty[i] = imap_new()) == NULL)
+        {
+            break;  /* signal is raised */
+        }
+    }
+
+    if (i < SIRIDB_SERIES_STRIPES)
+    {
+        while (i--)
+        {
+            imap_free(wal->dirty[i], NULL);
+        }
+        if (wal->held != NULL)
+        {
+            llist_free_cb(wal->held, NULL, NULL);
+        }
+        free(wal);
+        return NULL;  /* signal is raised */
+    }
+
+    return wal;
+}
+
+/*
+ * Open or create the write-ahead log file and read the last checkpoint and
+ * epochs.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ */
+static int WAL_read(siridb_wal_t * wal, const char * fn)
+{
+    siridb_wal_epoch_t epoch;
+
+    wal->fp = fopen(fn, "r+");
+    if (wal->fp == NULL)
+    {
+        wal->fp = fopen(fn, "w+");
+        return (wal->fp == NULL) ? -1 : 0;
+    }
+
+    if (    fread(&wal->checkpoint, sizeof(uint32_t), 1, wal->fp) != 1 ||
+            fread(&wal->base, sizeof(uint64_t), 1, wal->fp) != 1 ||
+            fread(&wal->lsn, sizeof(uint64_t), 1, wal->fp) != 1)
+    {
+        /* an empty or incomplete file has nothing to replay */
+        wal->checkpoint = 0;
+        wal->base = wal->lsn = 0;
+        return 0;
+    }
+
+    while ( fread(&epoch.lsn, sizeof(uint64_t), 1, wal->fp) == 1 &&
+            fread(&epoch.max_series_id, sizeof(uint32_t), 1, wal->fp) == 1)
+    {
+        if (wal->n && wal->epochs[wal->n - 1].lsn == epoch.lsn)
+        {
+            wal->epochs[wal->n - 1].max_series_id = epoch.max_series_id;
+            continue;
+        }
+
+        if (wal->n == wal->sz)
+        {
+            size_t sz = (wal->sz) ? wal->sz * 2 : 8;
+            siridb_wal_epoch_t * tmp = (siridb_wal_epoch_t *) realloc(
+                    wal->epochs,
+                    sz * sizeof(siridb_wal_epoch_t));
+            if (tmp == NULL)
+            {
+                ERR_ALLOC
+                return -1;
+            }
+            wal->epochs = tmp;
+            wal->sz = sz;
+        }
+        wal->epochs[wal->n++] = epoch;
+    }
+
+    return 0;
+}
+
+/*
+ * Write the checkpoint and epochs after 'base' and commit the file to disk.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ */
+static int WAL_save(
+        siridb_wal_t * wal,
+        uint32_t checkpoint,
+        uint64_t base,
+        uint64_t lsn)
+{
+    size_t i = 0;
+    size_t n;
+
+    /* epochs before 'base' are no longer needed */
+    while (i < wal->n && wal->epochs[i].lsn <= base)
+    {
+        i++;
+    }
+
+    n = (lsn) ? wal->n - i : 0;
+    if (i && n)
+    {
+        memmove(wal->epochs, wal->epochs + i, n * sizeof(siridb_wal_epoch_t));
+    }
+    wal->n = n;
+
+    if (    fseeko(wal->fp, 0, SEEK_SET) ||
+            fwrite(&checkpoint, sizeof(uint32_t), 1, wal->fp) != 1 ||
+            fwrite(&base, sizeof(uint64_t), 1, wal->fp) != 1 ||
+            fwrite(&lsn, sizeof(uint64_t), 1, wal->fp) != 1)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        if (fwrite(&wal->epochs[i].lsn, sizeof(uint64_t), 1, wal->fp) != 1 ||
+            fwrite( &wal->epochs[i].max_series_id,
+                    sizeof(uint32_t),
+                    1,
+                    wal->fp) != 1)
+        {
+            return -1;
+        }
+    }
+
+    return (fflush(wal->fp) ||
+            ftruncate(fileno(wal->fp), WAL_HEADER_SIZE + n * WAL_EPOCH_SIZE) ||
+            fsync(fileno(wal->fp))) ? -1 : 0;
+}
+
+/*
+ * Write the buffers of changed series and commit the buffer file to disk.
+ *
+ * Returns 0 if successful or -1 and a SIGNAL is raised in case of an error.
+ *
+ * Warning: all series stripes must be locked.
+ */
+static int WAL_flush(siridb_t * siridb, uint32_t checkpoint)
+{
+    siridb_wal_t * wal = siridb->wal;
+    wal_flush_t w = {
+            .siridb=siridb,
+            .checkpoint=checkpoint
+    };
+    int rc = 0;
+
+    for (int i = 0; i < SIRIDB_SERIES_STRIPES; i++)
+    {
+        if (!wal->dirty[i]->len)
+        {
+            continue;
+        }
+
+        if (imap_walk(wal->dirty[i], (imap_cb) WAL_flush_series, &w))
+        {
+            rc = -1;
+        }
+
+        imap_free(wal->dirty[i], NULL);
+        wal->dirty[i] = imap_new();
+        if (wal->dirty[i] == NULL)
+        {
+            return -1;  /* signal is raised */
+        }
+    }
+
+    if (siridb_buffer_sync(siridb))
+    {
+        ERR_FILE
+        rc = -1;
+    }
+
+    return rc;
+}
+
+/*
+ * Call-back function used to write the buffer of a changed series.
+ */
+static int WAL_flush_series(void * data, wal_flush_t * w)
+{
+    siridb_series_t * series = (siridb_series_t *) idmap_get(
+            w->siridb->series_map,
+            (uint32_t) (uintptr_t) data);
+
+    /* the series might be dropped after it was changed */
+    return (series == NULL || series->buffer == NULL || siri_err) ? 0 :
+            siridb_series_flush_buffer(w->siridb, series, w->checkpoint);
+}
+
+/*
+ * Apply packages from the fifo buffer for the replica which are inserted
+ * after the last checkpoint. Points are only added to series which exist.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ * (a signal might be raised)
+ */
+static int WAL_replay(siridb_t * siridb)
+{
+    siridb_wal_t * wal = siridb->wal;
+    siridb_server_t * replica = NULL;
+    siridb_server_t * server;
+    llist_node_t * node = siridb->servers->first;
+    wal_replay_t replay = {
+            .siridb=siridb,
+            .start=imap_new(),
+            .pcache=NULL,
+            .npkgs=0
+    };
+    int rc;
+
+    if (replay.start == NULL)
+    {
+        return -1;  /* signal is raised */
+    }
+
+    while (node != NULL)
+    {
+        server = (siridb_server_t *) node->data;
+        if (server != siridb->server && server->pool == siridb->server->pool)
+        {
+            replica = server;
+        }
+        node = node->next;
+    }
+
+    if (replica == NULL)
+    {
+        log_critical(
+                "Cannot replay the write-ahead log for '%s' since the "
+                "replica is not found",
+                siridb->dbname);
+        imap_free(replay.start, NULL);
+        return -1;
+    }
+
+    log_info("Replay write-ahead log");
+
+    /* points are added in memory while replaying */
+    wal->status = SIRIDB_WAL_ON;
+
+    rc = siridb_fifo_walk(
+            siridb,
+            replica,
+            wal->base,
+            (siridb_fifo_walk_cb) WAL_replay_pkg,
+            &replay);
+
+    imap_free(replay.start, NULL);
+
+    if (replay.pcache != NULL)
+    {
+        siridb_pcache_free(replay.pcache);
+    }
+
+    if (rc)
+    {
+        /* keep the log so the replay starts again at the next start-up */
+        wal->status = SIRIDB_WAL_OFF;
+        log_critical("Replay of the write-ahead log has failed");
+        return -1;
+    }
+
+    log_debug(
+            "Replayed %zu package(s) from the write-ahead log",
+            replay.npkgs);
+
+    /* write all replayed points and clear the log */
+    siridb_wal_stop(siridb);
+
+    return siri_err ? -1 : 0;
+}
+
+/*
+ * Call-back function: siridb_fifo_walk_cb
+ */
+static int WAL_replay_pkg(
+        sirinet_pkg_t * pkg,
+        uint64_t lsn,
+        wal_replay_t * replay)
+{
+    siridb_t * siridb = replay->siridb;
+    siridb_series_t * series;
+    qp_unpacker_t unpacker;
+    qp_obj_t qp_series_name;
+    int rc;
+
+    switch ((bproto_client_t) pkg->tp)
+    {
+    case BPROTO_INSERT_SERVER:
+    case BPROTO_INSERT_TEST_SERVER:
+    case BPROTO_INSERT_TESTED_SERVER:
+    case BPROTO_INSERT_LOCAL:
+        break;
+    default:
+        return 0;
+    }
+
+    qp_unpacker_init(&unpacker, pkg->data, pkg->len);
+
+    if (!qp_is_map(qp_next(&unpacker, NULL)))
+    {
+        return 0;
+    }
+
+    replay->npkgs++;
+
+    qp_next(&unpacker, &qp_series_name);
+
+    while (qp_is_raw_term(&qp_series_name))
+    {
+        series = (siridb_series_t *) art_get(
+                siridb->series,
+                qp_series_name.via.raw);
+
+        if (    series == NULL ||
+                series->buffer == NULL ||
+                WAL_replay_skip(replay, series, lsn))
+        {
+            qp_skip_next(&unpacker);
+            qp_next(&unpacker, &qp_series_name);
+        }
+        else
+        {
+            uv_mutex_lock(siridb_series_stripe(siridb, series));
+
+            rc = siridb_insert_local_points(
+                    siridb,
+                    series,
+                    &unpacker,
+                    &qp_series_name,
+                    &replay->pcache);
+
+            uv_mutex_unlock(siridb_series_stripe(siridb, series));
+
+            if (rc < 0)
+            {
+                return -1;  /* signal is raised */
+            }
+
+            if (qp_series_name.tp == QP_ARRAY_CLOSE)
+            {
+                qp_next(&unpacker, &qp_series_name);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Returns 1 (true) when the package must not be applied to the series.
+ */
+static int WAL_replay_skip(
+        wal_replay_t * replay,
+        siridb_series_t * series,
+        uint64_t lsn)
+{
+    siridb_wal_t * wal = replay->siridb->wal;
+    uintptr_t start = (uintptr_t) imap_get(replay->start, series->id);
+
+    if (!start)
+    {
+        uint32_t checkpoint = siridb_buffer_read_checkpoint(
+                replay->siridb,
+                series);
+
+        start = (checkpoint > wal->checkpoint) ?
+                    WAL_REPLAY_SKIP :
+                (checkpoint == wal->checkpoint) ?
+                    WAL_REPLAY_FROM_LSN : WAL_REPLAY_FROM_BASE;
+
+        imap_add(replay->start, series->id, (void *) start);
+    }
+
+    if (    start == WAL_REPLAY_SKIP ||
+            lsn < ((start == WAL_REPLAY_FROM_LSN) ? wal->lsn : wal->base))
+    {
+        return 1;
+    }
+
+    /* skip when the series is created after a drop which followed lsn */
+    for (size_t i = 0; i < wal->n; i++)
+    {
+        if (wal->epochs[i].lsn > lsn)
+        {
+            return series->id > wal->epochs[i].max_series_id;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Call-back function: uv_timer_cb
+ *
+ * Hold new insert tasks and start a checkpoint when running insert tasks
+ * are finished.
+ */
+static void WAL_on_timer(uv_timer_t * timer)
+{
+    siridb_t * siridb = (siridb_t *) timer->data;
+    siridb_wal_t * wal = siridb->wal;
+
+    if (wal->hold)
+    {
+        return;  /* a checkpoint is waiting for insert tasks */
+    }
+
+    if (!siridb_wal_enabled(siridb))
+    {
+        siridb_wal_stop(siridb);
+        return;
+    }
+
+    wal->hold = 1;
+
+    if (!wal->inserts)
+    {
+        WAL_checkpoint(siridb);
+    }
+}
+
+/*
+ * Write a checkpoint. No insert task is running when this function is
+ * called so all packages before the first held insert task are applied and
+ * none of the packages after.
+ *
+ * (a signal might be raised)
+ */
+static void WAL_checkpoint(siridb_t * siridb)
+{
+    siridb_wal_t * wal = siridb->wal;
+    siridb_insert_local_t * ilocal;
+    llist_node_t * node;
+    uint64_t lsn = 0;
+    uint64_t base;
+    int rc;
+
+    if (!siridb_wal_enabled(siridb))
+    {
+        siridb_wal_stop(siridb);
+        WAL_release(wal);
+        return;
+    }
+
+    for (node = wal->held->first; node != NULL; node = node->next)
+    {
+        ilocal = (siridb_insert_local_t *) ((uv_async_t *) node->data)->data;
+        if (ilocal->lsn)
+        {
+            lsn = ilocal->lsn;
+            break;
+        }
+        if (wal->status == SIRIDB_WAL_OFF)
+        {
+            /* this insert is not in the log, try again later */
+            WAL_release(wal);
+            return;
+        }
+    }
+
+    if (!lsn)
+    {
+        lsn = siridb_fifo_head(siridb->fifo);
+    }
+
+    if (wal->status == SIRIDB_WAL_OFF)
+    {
+        /* all buffers are written so every series can start at lsn */
+        if (WAL_save(wal, wal->checkpoint + 1, lsn, lsn))
+        {
+            log_error(
+                    "Cannot write write-ahead log for '%s'",
+                    siridb->dbname);
+            WAL_release(wal);
+            return;
+        }
+
+        wal->checkpoint++;
+        wal->base = wal->lsn = lsn;
+        wal->status = SIRIDB_WAL_ON;
+        siridb_fifo_set_retain(siridb->fifo, 1);
+
+        log_info("Write-ahead log is switched on for '%s'", siridb->dbname);
+    }
+    else if (lsn != wal->lsn || wal->base != wal->lsn)
+    {
+        base = wal->lsn;
+
+        siridb_series_lock_stripes(siridb);
+
+        rc = (  WAL_save(wal, wal->checkpoint + 1, base, lsn) ||
+                WAL_flush(siridb, wal->checkpoint + 1));
+
+        siridb_series_unlock_stripes(siridb);
+
+        if (rc)
+        {
+            log_critical(
+                    "Cannot write checkpoint for the write-ahead log of '%s'",
+                    siridb->dbname);
+            if (!siri_err)
+            {
+                ERR_FILE
+            }
+            WAL_release(wal);
+            return;
+        }
+
+        wal->checkpoint++;
+        wal->base = base;
+        wal->lsn = lsn;
+
+        /* packages before 'base' are no longer required for a replay */
+        siridb_fifo_truncate(siridb->fifo, base);
+    }
+
+    WAL_release(wal);
+}
+
+/*
+ * Start insert tasks which are held for a checkpoint.
+ */
+static void WAL_release(siridb_wal_t * wal)
+{
+    uv_async_t * handle;
+
+    wal->hold = 0;
+
+    while ((handle = (uv_async_t *) llist_shift(wal->held)) != NULL)
+    {
+        wal->inserts++;
+        uv_async_send(handle);
+    }
+}
@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 08-04-2016
+ *  - lock for using files from more than one thread, 18-10-2026
  *
  */
 #include <logger/logger.h>
@@ -32,6 +33,10 @@ siri_fh_t * siri_fh_new(uint16_t size)
             free(fh);
             fh = NULL;
         }
+        else
+        {
+            uv_mutex_init(&fh->lock);
+        }
     }
     return fh;
 }
@@ -58,11 +63,15 @@ void siri_fh_free(siri_fh_t * fh)
         }
         siri_fp_decref(*fp);
     }
+    uv_mutex_destroy(&fh->lock);
     free(fh->fpointers);
     free(fh);
 }
 
 /*
+ * Opening a file might close a file of another file pointer, so fh->lock
+ * must be locked while opening and using files of the file handler.
+ *
  * Returns 0 if successful or -1 in case of an error.
  */
 int siri_fopen(
@@ -33,6 +33,7 @@ cleri_grammar_t * compile_grammar(void)
     cleri_object_t * k_after = cleri_keyword(CLERI_GID_K_AFTER, "after", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_alter = cleri_keyword(CLERI_GID_K_ALTER, "alter", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_and = cleri_keyword(CLERI_GID_K_AND, "and", CLERI_CASE_INSENSITIVE);
+    cleri_object_t * k_approx_median = cleri_keyword(CLERI_GID_K_APPROX_MEDIAN, "approx_median", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_as = cleri_keyword(CLERI_GID_K_AS, "as", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_backup_mode = cleri_keyword(CLERI_GID_K_BACKUP_MODE, "backup_mode", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_before = cleri_keyword(CLERI_GID_K_BEFORE, "before", CLERI_CASE_INSENSITIVE);
@@ -50,6 +51,7 @@ cleri_grammar_t * compile_grammar(void)
     cleri_object_t * k_difference = cleri_keyword(CLERI_GID_K_DIFFERENCE, "difference", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_drop = cleri_keyword(CLERI_GID_K_DROP, "drop", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_drop_threshold = cleri_keyword(CLERI_GID_K_DROP_THRESHOLD, "drop_threshold", CLERI_CASE_INSENSITIVE);
+    cleri_object_t * k_dropped_points = cleri_keyword(CLERI_GID_K_DROPPED_POINTS, "dropped_points", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_duration_log = cleri_keyword(CLERI_GID_K_DURATION_LOG, "duration_log", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_duration_num = cleri_keyword(CLERI_GID_K_DURATION_NUM, "duration_num", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_end = cleri_keyword(CLERI_GID_K_END, "end", CLERI_CASE_INSENSITIVE);
@@ -74,6 +76,8 @@ cleri_grammar_t * compile_grammar(void)
     cleri_object_t * k_info = cleri_keyword(CLERI_GID_K_INFO, "info", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_ignore_threshold = cleri_keyword(CLERI_GID_K_IGNORE_THRESHOLD, "ignore_threshold", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_insert = cleri_keyword(CLERI_GID_K_INSERT, "insert", CLERI_CASE_INSENSITIVE);
+    cleri_object_t * k_insert_queue = cleri_keyword(CLERI_GID_K_INSERT_QUEUE, "insert_queue", CLERI_CASE_INSENSITIVE);
+    cleri_object_t * k_insert_queue_size = cleri_keyword(CLERI_GID_K_INSERT_QUEUE_SIZE, "insert_queue_size", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_integer = cleri_keyword(CLERI_GID_K_INTEGER, "integer", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_intersection = cleri_choice(
         CLERI_GID_K_INTERSECTION,
@@ -89,6 +93,7 @@ cleri_grammar_t * compile_grammar(void)
     cleri_object_t * k_list = cleri_keyword(CLERI_GID_K_LIST, "list", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_log = cleri_keyword(CLERI_GID_K_LOG, "log", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_log_level = cleri_keyword(CLERI_GID_K_LOG_LEVEL, "log_level", CLERI_CASE_INSENSITIVE);
+    cleri_object_t * k_lookup_version = cleri_keyword(CLERI_GID_K_LOOKUP_VERSION, "lookup_version", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_max = cleri_keyword(CLERI_GID_K_MAX, "max", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_max_open_files = cleri_keyword(CLERI_GID_K_MAX_OPEN_FILES, "max_open_files", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_mean = cleri_keyword(CLERI_GID_K_MEAN, "mean", CLERI_CASE_INSENSITIVE);
@@ -106,6 +111,7 @@ cleri_grammar_t * compile_grammar(void)
     cleri_object_t * k_open_files = cleri_keyword(CLERI_GID_K_OPEN_FILES, "open_files", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_or = cleri_keyword(CLERI_GID_K_OR, "or", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_password = cleri_keyword(CLERI_GID_K_PASSWORD, "password", CLERI_CASE_INSENSITIVE);
+    cleri_object_t * k_percentile = cleri_keyword(CLERI_GID_K_PERCENTILE, "percentile", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_points = cleri_keyword(CLERI_GID_K_POINTS, "points", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_pool = cleri_keyword(CLERI_GID_K_POOL, "pool", CLERI_CASE_INSENSITIVE);
     cleri_object_t * k_pools = cleri_keyword(CLERI_GID_K_POOLS, "pools", CLERI_CASE_INSENSITIVE);
@@ -833,6 +839,24 @@ cleri_grammar_t * compile_grammar(void)
         time_expr,
         cleri_token(CLERI_NONE, ")")
     );
+    cleri_object_t * f_approx_median = cleri_sequence(
+        CLERI_GID_F_APPROX_MEDIAN,
+        4,
+        k_approx_median,
+        cleri_token(CLERI_NONE, "("),
+        time_expr,
+        cleri_token(CLERI_NONE, ")")
+    );
+    cleri_object_t * f_percentile = cleri_sequence(
+        CLERI_GID_F_PERCENTILE,
+        6,
+        k_percentile,
+        cleri_token(CLERI_NONE, "("),
+        r_float,
+        cleri_token(CLERI_NONE, ","),
+        time_expr,
+        cleri_token(CLERI_NONE, ")")
+    );
     cleri_object_t * f_sum = cleri_sequence(
         CLERI_GID_F_SUM,
         4,
@@ -924,7 +948,7 @@ cleri_grammar_t * compile_grammar(void)
     cleri_object_t * aggregate_functions = cleri_list(CLERI_GID_AGGREGATE_FUNCTIONS, cleri_choice(
         CLERI_NONE,
         CLERI_FIRST_MATCH,
-        15,
+        17,
         f_points,
         f_limit,
         f_mean,
@@ -932,6 +956,8 @@ cleri_grammar_t * compile_grammar(void)
         f_median,
         f_median_low,
         f_median_high,
+        f_approx_median,
+        f_percentile,
         f_min,
         f_max,
         f_count,
@@ -1003,6 +1029,13 @@ cleri_grammar_t * compile_grammar(void)
         k_log_level,
         log_keywords
     );
+    cleri_object_t * set_lookup_version = cleri_sequence(
+        CLERI_GID_SET_LOOKUP_VERSION,
+        3,
+        k_set,
+        k_lookup_version,
+        r_uinteger
+    );
     cleri_object_t * set_name = cleri_sequence(
         CLERI_GID_SET_NAME,
         3,
@@ -1038,8 +1071,9 @@ cleri_grammar_t * compile_grammar(void)
         cleri_choice(
             CLERI_NONE,
             CLERI_FIRST_MATCH,
-            2,
+            3,
             set_drop_threshold,
+            set_lookup_version,
             set_timezone
         )
     );
@@ -1384,18 +1418,22 @@ cleri_grammar_t * compile_grammar(void)
         cleri_list(CLERI_NONE, cleri_choice(
             CLERI_NONE,
             CLERI_FIRST_MATCH,
-            27,
+            31,
             k_active_handles,
             k_buffer_path,
             k_buffer_size,
             k_dbname,
             k_dbpath,
             k_drop_threshold,
+            k_dropped_points,
             k_duration_log,
             k_duration_num,
+            k_insert_queue,
+            k_insert_queue_size,
             k_ip_support,
             k_libuv,
             k_log_level,
+            k_lookup_version,
             k_max_open_files,
             k_mem_usage,
             k_open_files,
@@ -0,0 +1,187 @@
+/*
+ * ingest.c - Worker threads for applying points to local series.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *  - start ingest_threads worker threads, 18-10-2026
+ *
+ */
+#include <logger/logger.h>
+#include <siri/err.h>
+#include <siri/ingest.h>
+#include <siri/siri.h>
+#include <stdlib.h>
+
+static void INGEST_work(siri_ingest_worker_t * worker);
+
+/*
+ * Start ingest_threads worker threads and bind siri.ingest.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ * (a SIGNAL might be raised)
+ */
+int siri_ingest_init(siri_t * siri)
+{
+    siri_ingest_worker_t * worker;
+    size_t n = siri->cfg->ingest_threads;
+
+    siri->ingest = (siri_ingest_t *) malloc(sizeof(siri_ingest_t));
+    if (siri->ingest == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    siri->ingest->workers = (siri_ingest_worker_t *)
+            malloc(sizeof(siri_ingest_worker_t) * n);
+    if (siri->ingest->workers == NULL)
+    {
+        ERR_ALLOC
+        free(siri->ingest);
+        siri->ingest = NULL;
+        return -1;
+    }
+
+    for (siri->ingest->n = 0; siri->ingest->n < n;)
+    {
+        worker = siri->ingest->workers + siri->ingest->n;
+        worker->stop = 0;
+        worker->first = NULL;
+        worker->last = NULL;
+
+        uv_mutex_init(&worker->mutex);
+        uv_cond_init(&worker->cond);
+
+        if (uv_thread_create(
+                &worker->thread,
+                (uv_thread_cb) INGEST_work,
+                worker))
+        {
+            uv_cond_destroy(&worker->cond);
+            uv_mutex_destroy(&worker->mutex);
+            break;
+        }
+
+        siri->ingest->n++;
+    }
+
+    if (!siri->ingest->n)
+    {
+        log_critical("Cannot start insert worker threads");
+        free(siri->ingest->workers);
+        free(siri->ingest);
+        siri->ingest = NULL;
+        return -1;
+    }
+
+    if (siri->ingest->n < n)
+    {
+        log_warning(
+                "Only %zu of %zu insert worker threads are started",
+                siri->ingest->n,
+                n);
+    }
+
+    return 0;
+}
+
+/*
+ * Stop and join the worker threads. Jobs which are already queued will
+ * still be handled before a thread stops.
+ */
+void siri_ingest_destroy(siri_t * siri)
+{
+    siri_ingest_worker_t * worker;
+
+    if (siri->ingest == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < siri->ingest->n; i++)
+    {
+        worker = siri->ingest->workers + i;
+
+        uv_mutex_lock(&worker->mutex);
+        worker->stop = 1;
+        uv_cond_signal(&worker->cond);
+        uv_mutex_unlock(&worker->mutex);
+    }
+
+    for (size_t i = 0; i < siri->ingest->n; i++)
+    {
+        worker = siri->ingest->workers + i;
+
+        uv_thread_join(&worker->thread);
+        uv_cond_destroy(&worker->cond);
+        uv_mutex_destroy(&worker->mutex);
+    }
+
+    free(siri->ingest->workers);
+    free(siri->ingest);
+    siri->ingest = NULL;
+}
+
+/*
+ * Queue a job on a partition. The partition can be any number; jobs queued
+ * on the same partition are handled by the same worker thread.
+ */
+void siri_ingest_queue(uint32_t partition, siri_ingest_job_t * job)
+{
+    siri_ingest_worker_t * worker =
+            siri.ingest->workers + partition % siri.ingest->n;
+
+    job->next = NULL;
+
+    uv_mutex_lock(&worker->mutex);
+
+    if (worker->last == NULL)
+    {
+        worker->first = job;
+    }
+    else
+    {
+        worker->last->next = job;
+    }
+    worker->last = job;
+
+    uv_cond_signal(&worker->cond);
+    uv_mutex_unlock(&worker->mutex);
+}
+
+/*
+ * Worker thread. Note that 'job->next' may not be used once the call-back is
+ * called since the job might be destroyed by the call-back.
+ */
+static void INGEST_work(siri_ingest_worker_t * worker)
+{
+    siri_ingest_job_t * job;
+
+    uv_mutex_lock(&worker->mutex);
+
+    while (worker->first != NULL || !worker->stop)
+    {
+        if ((job = worker->first) == NULL)
+        {
+            uv_cond_wait(&worker->cond, &worker->mutex);
+            continue;
+        }
+
+        if ((worker->first = job->next) == NULL)
+        {
+            worker->last = NULL;
+        }
+
+        uv_mutex_unlock(&worker->mutex);
+
+        (*job->cb)(job);
+
+        uv_mutex_lock(&worker->mutex);
+    }
+
+    uv_mutex_unlock(&worker->mutex);
+}
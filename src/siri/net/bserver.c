@@ -8,6 +8,8 @@
  *
  * changes
  *  - initial version, 18-06-2016
+ *  - points from the replica are written to the write-ahead log,
+ *    18-10-2026
  *
  */
 #include <assert.h>
@@ -19,6 +21,7 @@
 #include <siri/db/replicate.h>
 #include <siri/db/server.h>
 #include <siri/db/servers.h>
+#include <siri/db/wal.h>
 #include <siri/net/bserver.h>
 #include <siri/net/pkg.h>
 #include <siri/net/protocol.h>
@@ -249,6 +252,9 @@ static void on_data(uv_stream_t * client, sirinet_pkg_t * pkg)
     case BPROTO_DISABLE_BACKUP_MODE:
         on_disable_backup_mode(client, pkg);
         break;
+    case BPROTO_INSERT_LOCAL:
+        /* only written to the fifo buffer and never send to a server */
+        break;
     }
 
 }
@@ -519,6 +525,27 @@ static void on_insert(uv_stream_t * client, sirinet_pkg_t * pkg, int flags)
             free(repl_pkg);
         }
     }
+    else if (   siridb->replica != NULL &&
+                (siridb->server->flags & SERVER_FLAG_RUNNING) &&
+                siridb_wal_enabled(siridb))
+    {
+        /*
+         * Points from the replica are written to the fifo buffer since the
+         * fifo buffer is also the write-ahead log. These packages are not
+         * send back to the replica.
+         */
+        pkg->tp = BPROTO_INSERT_LOCAL;
+        if (siridb_replicate_pkg(siridb, pkg))
+        {
+            /* signal is raised */
+            sirinet_pkg_t * package =
+                    sirinet_pkg_new(pkg->pid, 0, BPROTO_ERR_INSERT, NULL);
+            if (package != NULL)
+            {
+                sirinet_pkg_send(client, package);
+            }
+        }
+    }
 
     if (!siri_err)
     {
@@ -610,7 +637,7 @@ static void on_drop_series(uv_stream_t * client, sirinet_pkg_t * pkg)
         if (qp_is_raw_term(&qp_series_name))
         {
             siridb_series_t * series;
-            series = ct_get(siridb->series, qp_series_name.via.raw);
+            series = art_get(siridb->series, qp_series_name.via.raw);
             if (series != NULL)
             {
                 uv_mutex_lock(&siridb->series_mutex);
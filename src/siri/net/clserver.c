@@ -7,6 +7,8 @@
  *
  * changes
  *  - initial version, 09-03-2016
+ *  - admission control for inserts, 18-10-2026
+ *  - streaming select results, 18-10-2026
  *
  */
 #define _GNU_SOURCE
@@ -83,6 +85,9 @@ static void CLSERVER_send_server_error(
 static void CLSERVER_send_pool_error(
         uv_stream_t * stream,
         sirinet_pkg_t * pkg);
+static void CLSERVER_send_insert_queue_error(
+        uv_stream_t * stream,
+        sirinet_pkg_t * pkg);
 static int CLSERVER_on_info_cb(siridb_t * siridb, qp_packer_t * packer);
 static void CLSERVER_on_register_server_response(
         slist_t * promises,
@@ -93,6 +98,11 @@ static void CLSERVER_on_register_server_response(
 
 #define POOL_ERR_LEN 64  // exact length of POOL_ERR_MSG
 
+#define INSERT_QUEUE_ERR_MSG \
+    "Too many pending inserts, please try again later"
+
+#define INSERT_QUEUE_ERR_LEN 48  // exact length of INSERT_QUEUE_ERR_MSG
+
 
 int sirinet_clserver_init(siri_t * siri)
 {
@@ -215,9 +225,11 @@ static void on_data(uv_stream_t * client, sirinet_pkg_t * pkg)
         switch ((cproto_client_t) pkg->tp)
         {
         case CPROTO_REQ_QUERY:
+        case CPROTO_REQ_QUERY_STREAM:
             on_query(client, pkg);
             break;
         case CPROTO_REQ_INSERT:
+        case CPROTO_REQ_INSERT_BULK:
             on_insert(client, pkg);
             break;
         case CPROTO_REQ_AUTH:
@@ -355,6 +367,25 @@ static void CLSERVER_send_pool_error(
     }
 }
 
+static void CLSERVER_send_insert_queue_error(
+        uv_stream_t * stream,
+        sirinet_pkg_t * pkg)
+{
+    log_debug(INSERT_QUEUE_ERR_MSG);
+
+    sirinet_pkg_t * package = sirinet_pkg_err(
+            pkg->pid,
+            INSERT_QUEUE_ERR_LEN,
+            CPROTO_ERR_INSERT,
+            INSERT_QUEUE_ERR_MSG);
+
+    if (package != NULL)
+    {
+        /* ignore result code, signal can be raised */
+        sirinet_pkg_send(stream, package);
+    }
+}
+
 static void on_query(uv_stream_t * client, sirinet_pkg_t * pkg)
 {
     CHECK_SIRIDB(ssocket)
@@ -407,7 +438,9 @@ static void on_query(uv_stream_t * client, sirinet_pkg_t * pkg)
                 qp_query.via.raw,
                 qp_query.len,
                 tp,
-                SIRIDB_QUERY_FLAG_MASTER);
+                (pkg->tp == CPROTO_REQ_QUERY_STREAM) ?
+                        SIRIDB_QUERY_FLAG_MASTER | SIRIDB_QUERY_FLAG_STREAM :
+                        SIRIDB_QUERY_FLAG_MASTER);
     }
     else
     {
@@ -461,6 +494,15 @@ static void on_insert(uv_stream_t * client, sirinet_pkg_t * pkg)
         return;
     }
 
+    /* refuse the insert when the database has too many pending inserts */
+    if (    siri.cfg->max_insert_queue &&
+            siridb->insert_queue_size >=
+                (size_t) siri.cfg->max_insert_queue * 1024)
+    {
+        CLSERVER_send_insert_queue_error(client, pkg);
+        return;
+    }
+
     qp_unpacker_t unpacker;
     qp_unpacker_init(&unpacker, pkg->data, pkg->len);
 
@@ -471,13 +513,13 @@ static void on_insert(uv_stream_t * client, sirinet_pkg_t * pkg)
 
     if (insert != NULL)
     {
-        ssize_t rc = siridb_insert_assign_pools(
-                siridb,
-                &unpacker,
-                insert->packer);
+        ssize_t rc = (pkg->tp == CPROTO_REQ_INSERT_BULK) ?
+                siridb_insert_assign_bulk(siridb, &unpacker, insert) :
+                siridb_insert_assign_pools(siridb, &unpacker, insert);
 
         switch ((siridb_insert_err_t) rc)
         {
+        case ERR_INVALID_BULK:
         case ERR_EXPECTING_ARRAY:
         case ERR_EXPECTING_SERIES_NAME:
         case ERR_EXPECTING_MAP_OR_ARRAY:
@@ -513,6 +555,8 @@ static void on_insert(uv_stream_t * client, sirinet_pkg_t * pkg)
             break;
 
         default:
+            siridb_insert_enqueue(insert, sizeof(sirinet_pkg_t) + pkg->len);
+
             if (siridb_insert_points_to_pools(insert, (size_t) rc))
             {
                 siridb_insert_free(insert);  /* signal is raised */
@@ -0,0 +1,1138 @@
+/*
+ * lnserver.c - TCP and UDP listeners for Graphite and InfluxDB line protocol.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *  - inserts are added to the insert queue of the database, 18-10-2026
+ *  - TCP connections are paused while the insert queue is full, 18-10-2026
+ *
+ * Graphite plaintext:
+ *
+ *      <series name> <value> [<time-stamp in seconds>]
+ *
+ * InfluxDB line protocol (one point for each field):
+ *
+ *      <measurement>[,<tag>=<value>...] <field>=<value>[,...] [<time-stamp>]
+ *
+ *  InfluxDB time-stamps are in nanoseconds and the series name for a field
+ *  is the measurement and tags (as received), a space and the field key.
+ *  Integer fields (i or u suffix) and booleans are stored as integer values,
+ *  other numbers as float values. String fields are not supported.
+ *
+ *  A missing time-stamp is replaced with the current time.
+ *
+ *  When the database cannot accept the points of a TCP connection, reading
+ *  from the connection is stopped and the points are kept until the insert
+ *  queue drains (or a retry succeeds). Points received by UDP cannot wait
+ *  and are dropped, which is counted in 'dropped_points'.
+ */
+#include <assert.h>
+#include <ctree/ctree.h>
+#include <logger/logger.h>
+#include <siri/db/db.h>
+#include <siri/db/insert.h>
+#include <siri/db/pcache.h>
+#include <siri/db/pools.h>
+#include <siri/db/series.h>
+#include <siri/db/server.h>
+#include <siri/db/time.h>
+#include <siri/err.h>
+#include <siri/net/lnserver.h>
+#include <siri/net/socket.h>
+#include <siri/siri.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_BACKLOG 128
+#define LNSERVER_WINDOW 100         /* batch window in milliseconds */
+#define LNSERVER_MAX_POINTS 10000   /* insert when this many points are read */
+#define LNSERVER_MAX_LINE 65536     /* longer incomplete lines are dropped */
+#define LNSERVER_BUFFER_SIZE 65536
+#define LNSERVER_RETRY 1000         /* retry paused connections (ms) */
+
+enum
+{
+    LNSERVER_GRAPHITE,
+    LNSERVER_INFLUX
+};
+
+enum
+{
+    LNSERVER_TCP_LISTEN,
+    LNSERVER_TCP,
+    LNSERVER_UDP
+};
+
+typedef struct lnserver_conn_s lnserver_conn_t;
+
+typedef struct lnserver_conn_s
+{
+    uint8_t proto;          /* LNSERVER_GRAPHITE or LNSERVER_INFLUX */
+    uint8_t tp;             /* LNSERVER_TCP_LISTEN, LNSERVER_TCP or UDP */
+    uint8_t skip;           /* drop data until the next new line */
+    uint8_t paused;         /* reading is stopped (TCP only) */
+    lnserver_conn_t * prev;
+    lnserver_conn_t * next;
+    uv_timer_t * timer;     /* only set while points are pending */
+    ct_t * series;          /* series name -> siridb_pcache_t */
+    size_t npoints;
+    char * buf;             /* incomplete line (TCP only) */
+    size_t len;
+    union
+    {
+        uv_handle_t handle;
+        uv_tcp_t tcp;
+        uv_udp_t udp;
+    } via;
+} lnserver_conn_t;
+
+typedef struct lnserver_flush_s
+{
+    siridb_t * siridb;
+    siridb_insert_t * insert;
+    int rc;
+} lnserver_flush_t;
+
+static int LNSERVER_listen(siri_t * siri, uint8_t proto, uint16_t port);
+static lnserver_conn_t * LNSERVER_conn_new(uint8_t proto, uint8_t tp);
+static void LNSERVER_conn_link(lnserver_conn_t * conn);
+static void LNSERVER_close(lnserver_conn_t * conn);
+static void LNSERVER_free(uv_handle_t * handle);
+static void LNSERVER_alloc_buffer(
+        uv_handle_t * handle,
+        size_t suggested_size,
+        uv_buf_t * buf);
+static void LNSERVER_on_connection(uv_stream_t * server, int status);
+static void LNSERVER_on_read(
+        uv_stream_t * stream,
+        ssize_t nread,
+        const uv_buf_t * buf);
+static void LNSERVER_on_recv(
+        uv_udp_t * udp,
+        ssize_t nread,
+        const uv_buf_t * buf,
+        const struct sockaddr * addr,
+        unsigned flags);
+static void LNSERVER_feed(
+        lnserver_conn_t * conn,
+        const char * data,
+        size_t n,
+        int complete);
+static int LNSERVER_line(
+        lnserver_conn_t * conn,
+        siridb_t * siridb,
+        char * line,
+        size_t len);
+static int LNSERVER_graphite(
+        lnserver_conn_t * conn,
+        siridb_t * siridb,
+        char * line);
+static int LNSERVER_influx(
+        lnserver_conn_t * conn,
+        siridb_t * siridb,
+        char * line);
+static char * LNSERVER_influx_next(char * s, char c);
+static int LNSERVER_influx_value(char * s, qp_via_t * via, points_tp * tp);
+static int LNSERVER_add_point(
+        lnserver_conn_t * conn,
+        const char * name,
+        int64_t ts,
+        qp_via_t * val,
+        points_tp tp);
+static void LNSERVER_on_timer(uv_timer_t * timer);
+static void LNSERVER_flush(lnserver_conn_t * conn, int can_pause);
+static void LNSERVER_pause(lnserver_conn_t * conn);
+static void LNSERVER_resume(lnserver_conn_t * conn);
+static void LNSERVER_on_retry(uv_timer_t * timer);
+static int LNSERVER_assign_cb(
+        const char * name,
+        siridb_pcache_t * pcache,
+        lnserver_flush_t * flush);
+static siridb_t * LNSERVER_get_siridb(void);
+static int LNSERVER_can_insert(siridb_t * siridb);
+static int LNSERVER_queue_full(siridb_t * siridb);
+static int64_t LNSERVER_now(siridb_t * siridb);
+
+#define LNSERVER_proto_str(proto) \
+    (((proto) == LNSERVER_GRAPHITE) ? "Graphite" : "InfluxDB")
+
+/* all listeners and open connections */
+static lnserver_conn_t * conns = NULL;
+
+/* number of connections which are paused */
+static size_t npaused = 0;
+
+/*
+ * Start the enabled listeners.
+ *
+ * Returns 0 if successful or another value in case of an error.
+ */
+int sirinet_lnserver_init(siri_t * siri)
+{
+    if (    siri->cfg->listen_graphite_port &&
+            LNSERVER_listen(
+                    siri,
+                    LNSERVER_GRAPHITE,
+                    siri->cfg->listen_graphite_port))
+    {
+        return 1;
+    }
+
+    if (    siri->cfg->listen_influx_port &&
+            LNSERVER_listen(
+                    siri,
+                    LNSERVER_INFLUX,
+                    siri->cfg->listen_influx_port))
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Insert pending points and close all listeners and connections. This
+ * function can be called more than once.
+ */
+void sirinet_lnserver_stop(siri_t * siri)
+{
+    while (conns != NULL)
+    {
+        LNSERVER_close(conns);
+    }
+}
+
+/*
+ * Resume paused connections while 'siridb' has room in the insert queue.
+ * This function is called each time an insert of a database is finished.
+ */
+void sirinet_lnserver_resume(siridb_t * siridb)
+{
+    static int resuming = 0;
+    lnserver_conn_t * conn;
+
+    if (!npaused || resuming || siridb != LNSERVER_get_siridb())
+    {
+        return;
+    }
+
+    /* inserts which are finished while resuming must not start a loop */
+    resuming = 1;
+
+    for (   conn = conns;
+            conn != NULL && npaused && !LNSERVER_queue_full(siridb);
+            conn = conn->next)
+    {
+        if (conn->paused)
+        {
+            LNSERVER_resume(conn);
+        }
+    }
+
+    resuming = 0;
+}
+
+/*
+ * Start a TCP and UDP listener on 'port'.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ */
+static int LNSERVER_listen(siri_t * siri, uint8_t proto, uint16_t port)
+{
+    struct sockaddr_storage addr;
+    lnserver_conn_t * conn;
+    int ipv6only = siri->cfg->ip_support == IP_SUPPORT_IPV6ONLY;
+    int rc;
+
+    if (siri->cfg->ip_support == IP_SUPPORT_IPV4ONLY)
+    {
+        uv_ip4_addr("0.0.0.0", port, (struct sockaddr_in *) &addr);
+    }
+    else
+    {
+        uv_ip6_addr("::", port, (struct sockaddr_in6 *) &addr);
+    }
+
+    if ((conn = LNSERVER_conn_new(proto, LNSERVER_TCP_LISTEN)) == NULL)
+    {
+        return -1;  /* signal is raised */
+    }
+
+    uv_tcp_init(siri->loop, &conn->via.tcp);
+    LNSERVER_conn_link(conn);
+
+    if ((rc = uv_tcp_bind(
+                &conn->via.tcp,
+                (const struct sockaddr *) &addr,
+                ipv6only ? UV_TCP_IPV6ONLY : 0)) ||
+        (rc = uv_listen(
+                (uv_stream_t *) &conn->via.tcp,
+                DEFAULT_BACKLOG,
+                LNSERVER_on_connection)))
+    {
+        log_error("Error listening for %s on TCP port %u: %s",
+                LNSERVER_proto_str(proto),
+                port,
+                uv_strerror(rc));
+        return -1;
+    }
+
+    if ((conn = LNSERVER_conn_new(proto, LNSERVER_UDP)) == NULL)
+    {
+        return -1;  /* signal is raised */
+    }
+
+    uv_udp_init(siri->loop, &conn->via.udp);
+    LNSERVER_conn_link(conn);
+
+    if ((rc = uv_udp_bind(
+                &conn->via.udp,
+                (const struct sockaddr *) &addr,
+                ipv6only ? UV_UDP_IPV6ONLY : 0)) ||
+        (rc = uv_udp_recv_start(
+                &conn->via.udp,
+                LNSERVER_alloc_buffer,
+                LNSERVER_on_recv)))
+    {
+        log_error("Error listening for %s on UDP port %u: %s",
+                LNSERVER_proto_str(proto),
+                port,
+                uv_strerror(rc));
+        return -1;
+    }
+
+    log_info("Start listening for %s line protocol on TCP and UDP port %u",
+            LNSERVER_proto_str(proto),
+            port);
+
+    return 0;
+}
+
+/*
+ * Returns NULL and raises a signal in case of an error.
+ */
+static lnserver_conn_t * LNSERVER_conn_new(uint8_t proto, uint8_t tp)
+{
+    lnserver_conn_t * conn =
+            (lnserver_conn_t *) malloc(sizeof(lnserver_conn_t));
+
+    if (conn == NULL)
+    {
+        ERR_ALLOC
+        return NULL;
+    }
+
+    conn->proto = proto;
+    conn->tp = tp;
+    conn->skip = 0;
+    conn->paused = 0;
+    conn->prev = NULL;
+    conn->next = NULL;
+    conn->timer = NULL;
+    conn->series = NULL;
+    conn->npoints = 0;
+    conn->buf = NULL;
+    conn->len = 0;
+
+    return conn;
+}
+
+/*
+ * Add a connection to the list. Must be called once the handle is
+ * initialized.
+ */
+static void LNSERVER_conn_link(lnserver_conn_t * conn)
+{
+    conn->via.handle.data = conn;
+    conn->next = conns;
+
+    if (conns != NULL)
+    {
+        conns->prev = conn;
+    }
+    conns = conn;
+}
+
+/*
+ * Insert pending points, remove the connection from the list and close the
+ * handle. The connection will be destroyed by the close call-back.
+ */
+static void LNSERVER_close(lnserver_conn_t * conn)
+{
+    if (conn->paused)
+    {
+        conn->paused = 0;
+        npaused--;
+    }
+
+    LNSERVER_flush(conn, 0);
+
+    if (conn->prev != NULL)
+    {
+        conn->prev->next = conn->next;
+    }
+    else
+    {
+        conns = conn->next;
+    }
+
+    if (conn->next != NULL)
+    {
+        conn->next->prev = conn->prev;
+    }
+
+    uv_close(&conn->via.handle, LNSERVER_free);
+}
+
+/*
+ * Used as uv_close_cb.
+ */
+static void LNSERVER_free(uv_handle_t * handle)
+{
+    lnserver_conn_t * conn = (lnserver_conn_t *) handle->data;
+    free(conn->buf);
+    free(conn);
+}
+
+static void LNSERVER_alloc_buffer(
+        uv_handle_t * handle,
+        size_t suggested_size,
+        uv_buf_t * buf)
+{
+    buf->base = (char *) malloc(LNSERVER_BUFFER_SIZE);
+    if (buf->base == NULL)
+    {
+        ERR_ALLOC
+        buf->len = 0;
+    }
+    else
+    {
+        buf->len = LNSERVER_BUFFER_SIZE;
+    }
+}
+
+static void LNSERVER_on_connection(uv_stream_t * server, int status)
+{
+    lnserver_conn_t * listener = (lnserver_conn_t *) server->data;
+    lnserver_conn_t * conn;
+
+    if (status < 0)
+    {
+        log_error("%s connection error: %s",
+                LNSERVER_proto_str(listener->proto),
+                uv_strerror(status));
+        return;
+    }
+
+    if ((conn = LNSERVER_conn_new(listener->proto, LNSERVER_TCP)) == NULL)
+    {
+        return;  /* signal is raised */
+    }
+
+    uv_tcp_init(server->loop, &conn->via.tcp);
+    LNSERVER_conn_link(conn);
+
+    if (uv_accept(server, (uv_stream_t *) &conn->via.tcp) == 0)
+    {
+        uv_read_start(
+                (uv_stream_t *) &conn->via.tcp,
+                LNSERVER_alloc_buffer,
+                LNSERVER_on_read);
+    }
+    else
+    {
+        LNSERVER_close(conn);
+    }
+}
+
+static void LNSERVER_on_read(
+        uv_stream_t * stream,
+        ssize_t nread,
+        const uv_buf_t * buf)
+{
+    lnserver_conn_t * conn = (lnserver_conn_t *) stream->data;
+
+    if (nread < 0)
+    {
+        if (nread != UV_EOF)
+        {
+            log_error("Read error: %s", uv_err_name(nread));
+        }
+
+        free(buf->base);
+
+        /* lines without a new line are not inserted */
+        conn->len = 0;
+        LNSERVER_close(conn);
+        return;
+    }
+
+    LNSERVER_feed(conn, buf->base, (size_t) nread, 0);
+    free(buf->base);
+}
+
+/*
+ * Each datagram must contain complete lines only.
+ */
+static void LNSERVER_on_recv(
+        uv_udp_t * udp,
+        ssize_t nread,
+        const uv_buf_t * buf,
+        const struct sockaddr * addr,
+        unsigned flags)
+{
+    if (nread > 0)
+    {
+        LNSERVER_feed((lnserver_conn_t *) udp->data, buf->base, nread, 1);
+    }
+    else if (nread < 0)
+    {
+        log_error("Read error: %s", uv_err_name(nread));
+    }
+
+    free(buf->base);
+}
+
+/*
+ * Parse all complete lines in 'data' (combined with an incomplete line from
+ * a previous read). When 'complete' is true the data is expected to end with
+ * a complete line, even without a trailing new line. The rest of a line
+ * which is dropped for being too long is skipped.
+ */
+static void LNSERVER_feed(
+        lnserver_conn_t * conn,
+        const char * data,
+        size_t n,
+        int complete)
+{
+    siridb_t * siridb = LNSERVER_get_siridb();
+    size_t dropped = 0;
+    char * line, * end, * nl;
+    char * tmp;
+
+    if (siridb == NULL)
+    {
+        log_error(
+                "Cannot insert %s data since database '%s' is not loaded",
+                LNSERVER_proto_str(conn->proto),
+                siri.cfg->line_protocol_db);
+        conn->len = 0;
+        return;
+    }
+
+    if (conn->skip)
+    {
+        if ((nl = memchr(data, '\n', n)) == NULL)
+        {
+            return;
+        }
+        conn->skip = 0;
+        n -= nl + 1 - data;
+        data = nl + 1;
+    }
+
+    tmp = (char *) realloc(conn->buf, conn->len + n + 1);
+    if (tmp == NULL)
+    {
+        ERR_ALLOC
+        return;
+    }
+
+    conn->buf = tmp;
+    memcpy(conn->buf + conn->len, data, n);
+    conn->len += n;
+    conn->buf[conn->len] = '\0';
+
+    line = conn->buf;
+    end = conn->buf + conn->len;
+
+    while ((nl = memchr(line, '\n', end - line)) != NULL || complete)
+    {
+        if (nl == NULL)
+        {
+            /* the rest of a datagram */
+            nl = end;
+            complete = 0;
+        }
+
+        *nl = '\0';
+
+        if (LNSERVER_line(conn, siridb, line, nl - line))
+        {
+            dropped++;
+        }
+
+        if (conn->npoints >= LNSERVER_MAX_POINTS)
+        {
+            LNSERVER_flush(conn, 1);
+        }
+
+        line = (nl == end) ? end : nl + 1;
+    }
+
+    conn->len = end - line;
+
+    if (conn->len > LNSERVER_MAX_LINE)
+    {
+        dropped++;
+        conn->len = 0;
+        conn->skip = 1;
+    }
+
+    if (conn->len)
+    {
+        memmove(conn->buf, line, conn->len);
+    }
+    else
+    {
+        free(conn->buf);
+        conn->buf = NULL;
+    }
+
+    if (dropped)
+    {
+        log_warning("Dropped %zu invalid %s line(s)",
+                dropped,
+                LNSERVER_proto_str(conn->proto));
+    }
+}
+
+/*
+ * Returns 0 if successful or -1 when the line is invalid. (or in case of an
+ * allocation error, in which case a signal is raised)
+ */
+static int LNSERVER_line(
+        lnserver_conn_t * conn,
+        siridb_t * siridb,
+        char * line,
+        size_t len)
+{
+    /* remove a carriage return and ignore empty lines */
+    if (len && line[len - 1] == '\r')
+    {
+        line[--len] = '\0';
+    }
+
+    if (!len)
+    {
+        return 0;
+    }
+
+    return (conn->proto == LNSERVER_GRAPHITE) ?
+            LNSERVER_graphite(conn, siridb, line) :
+            LNSERVER_influx(conn, siridb, line);
+}
+
+static int LNSERVER_graphite(
+        lnserver_conn_t * conn,
+        siridb_t * siridb,
+        char * line)
+{
+    char * name = line;
+    char * val, * ts, * end;
+    double seconds;
+    int64_t t;
+    qp_via_t via;
+
+    if ((val = strpbrk(name, " \t")) == NULL)
+    {
+        return -1;
+    }
+    *val++ = '\0';
+    val += strspn(val, " \t");
+
+    if ((ts = strpbrk(val, " \t")) != NULL)
+    {
+        *ts++ = '\0';
+        ts += strspn(ts, " \t");
+    }
+
+    via.real = strtod(val, &end);
+    if (end == val || *end)
+    {
+        return -1;
+    }
+
+    if (ts == NULL || !*ts || strcmp(ts, "-1") == 0)
+    {
+        t = LNSERVER_now(siridb);
+    }
+    else
+    {
+        seconds = strtod(ts, &end);
+        if (end == ts || end[strspn(end, " \t")])
+        {
+            return -1;
+        }
+        t = (int64_t) (seconds * siridb->time->factor);
+    }
+
+    if (!siridb_int64_valid_ts(siridb, t))
+    {
+        return -1;
+    }
+
+    return LNSERVER_add_point(conn, name, t, &via, TP_DOUBLE);
+}
+
+static int LNSERVER_influx(
+        lnserver_conn_t * conn,
+        siridb_t * siridb,
+        char * line)
+{
+    char name[SIRIDB_SERIES_NAME_LEN_MAX];
+    char * key = line;
+    char * fields, * field, * next, * val, * ts, * end;
+    size_t klen, flen;
+    int64_t t;
+    qp_via_t via;
+    points_tp tp;
+    int rc = 0;
+
+    if (*line == '#')
+    {
+        return 0;  /* comment */
+    }
+
+    if ((fields = LNSERVER_influx_next(key, ' ')) == NULL)
+    {
+        return -1;
+    }
+
+    if ((ts = LNSERVER_influx_next(fields, ' ')) == NULL || !*ts)
+    {
+        t = LNSERVER_now(siridb);
+    }
+    else
+    {
+        t = strtoll(ts, &end, 10);
+        if (end == ts || *end)
+        {
+            return -1;
+        }
+        t /= 1000000000 / siridb->time->factor;
+    }
+
+    if (!siridb_int64_valid_ts(siridb, t))
+    {
+        return -1;
+    }
+
+    klen = strlen(key);
+
+    for (field = fields; field != NULL; field = next)
+    {
+        next = LNSERVER_influx_next(field, ',');
+
+        if (    (val = LNSERVER_influx_next(field, '=')) == NULL ||
+                !*field ||
+                LNSERVER_influx_value(val, &via, &tp))
+        {
+            rc = -1;
+            continue;
+        }
+
+        flen = strlen(field);
+
+        if (klen + flen + 1 >= SIRIDB_SERIES_NAME_LEN_MAX)
+        {
+            rc = -1;
+            continue;
+        }
+
+        memcpy(name, key, klen);
+        name[klen] = ' ';
+        memcpy(name + klen + 1, field, flen + 1);
+
+        if (LNSERVER_add_point(conn, name, t, &via, tp))
+        {
+            return -1;
+        }
+    }
+
+    return rc;
+}
+
+/*
+ * Terminate 's' at the first 'c' which is not escaped and not quoted.
+ *
+ * Returns a pointer to the character after 'c' or NULL if 'c' is not found.
+ */
+static char * LNSERVER_influx_next(char * s, char c)
+{
+    int quoted = 0;
+
+    for (; *s; s++)
+    {
+        if (*s == '\\' && s[1])
+        {
+            s++;
+        }
+        else if (*s == '"')
+        {
+            quoted = !quoted;
+        }
+        else if (*s == c && !quoted)
+        {
+            *s = '\0';
+            return s + 1;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Returns 0 if successful or -1 when the value is not supported.
+ */
+static int LNSERVER_influx_value(char * s, qp_via_t * via, points_tp * tp)
+{
+    size_t n = strlen(s);
+    char * end;
+
+    if (!n || *s == '"')
+    {
+        return -1;  /* string values are not supported */
+    }
+
+    *tp = TP_INT;
+
+    if (s[n - 1] == 'i' || s[n - 1] == 'u')
+    {
+        via->int64 = strtoll(s, &end, 10);
+        return (end == s + n - 1) ? 0 : -1;
+    }
+
+    if (    strcmp(s, "t") == 0 || strcmp(s, "T") == 0 ||
+            strcmp(s, "true") == 0 || strcmp(s, "True") == 0 ||
+            strcmp(s, "TRUE") == 0)
+    {
+        via->int64 = 1;
+        return 0;
+    }
+
+    if (    strcmp(s, "f") == 0 || strcmp(s, "F") == 0 ||
+            strcmp(s, "false") == 0 || strcmp(s, "False") == 0 ||
+            strcmp(s, "FALSE") == 0)
+    {
+        via->int64 = 0;
+        return 0;
+    }
+
+    *tp = TP_DOUBLE;
+    via->real = strtod(s, &end);
+    return (end == s + n) ? 0 : -1;
+}
+
+/*
+ * Add a point to the batch of the connection. The value is converted when
+ * the series in the batch already has another type.
+ *
+ * Returns 0 if successful or -1 when the name is invalid or in case of an
+ * allocation error, in which case a signal is raised.
+ */
+static int LNSERVER_add_point(
+        lnserver_conn_t * conn,
+        const char * name,
+        int64_t ts,
+        qp_via_t * val,
+        points_tp tp)
+{
+    siridb_pcache_t ** pcache;
+    size_t len = strlen(name);
+    uint64_t uts = (uint64_t) ts;
+    qp_via_t conv;
+
+    if (!len || len >= SIRIDB_SERIES_NAME_LEN_MAX)
+    {
+        return -1;
+    }
+
+    if (conn->series == NULL && (conn->series = ct_new()) == NULL)
+    {
+        return -1;  /* signal is raised */
+    }
+
+    pcache = (siridb_pcache_t **) ct_get_sure(conn->series, name);
+    if (pcache == NULL)
+    {
+        return -1;  /* signal is raised */
+    }
+
+    if (ct_is_empty(*pcache))
+    {
+        siridb_pcache_t * new_pcache = siridb_pcache_new(tp);
+        if (new_pcache == NULL)
+        {
+            ct_pop(conn->series, name);
+            return -1;  /* signal is raised */
+        }
+        *pcache = new_pcache;
+    }
+
+    if ((*pcache)->tp != tp)
+    {
+        if ((*pcache)->tp == TP_INT)
+        {
+            conv.int64 = (int64_t) val->real;
+        }
+        else
+        {
+            conv.real = (double) val->int64;
+        }
+        val = &conv;
+    }
+
+    if (siridb_pcache_append_point(*pcache, &uts, val))
+    {
+        return -1;  /* signal is raised */
+    }
+
+    conn->npoints++;
+
+    if (conn->timer == NULL)
+    {
+        conn->timer = (uv_timer_t *) malloc(sizeof(uv_timer_t));
+        if (conn->timer == NULL)
+        {
+            ERR_ALLOC
+            return -1;
+        }
+
+        uv_timer_init(siri.loop, conn->timer);
+        conn->timer->data = conn;
+        uv_timer_start(conn->timer, LNSERVER_on_timer, LNSERVER_WINDOW, 0);
+    }
+
+    return 0;
+}
+
+static void LNSERVER_on_timer(uv_timer_t * timer)
+{
+    LNSERVER_flush((lnserver_conn_t *) timer->data, 1);
+}
+
+/*
+ * Insert the pending points of a connection. When the database cannot accept
+ * inserts or has reached 'max_insert_queue', a TCP connection is paused if
+ * 'can_pause' is true and keeps the points. In any other case the points are
+ * dropped and counted in 'dropped_points'.
+ */
+static void LNSERVER_flush(lnserver_conn_t * conn, int can_pause)
+{
+    ct_t * series = conn->series;
+    size_t npoints = conn->npoints;
+    lnserver_flush_t flush;
+
+    if (conn->paused)
+    {
+        return;  /* points are kept until the connection is resumed */
+    }
+
+    if (conn->timer != NULL)
+    {
+        uv_timer_stop(conn->timer);
+        uv_close((uv_handle_t *) conn->timer, (uv_close_cb) free);
+        conn->timer = NULL;
+    }
+
+    if (series == NULL)
+    {
+        return;
+    }
+
+    flush.siridb = LNSERVER_get_siridb();
+    flush.insert = NULL;
+    flush.rc = 0;
+
+    if (    flush.siridb != NULL &&
+            can_pause &&
+            conn->tp == LNSERVER_TCP && (
+                !LNSERVER_can_insert(flush.siridb) ||
+                LNSERVER_queue_full(flush.siridb)))
+    {
+        LNSERVER_pause(conn);
+        return;
+    }
+
+    conn->series = NULL;
+    conn->npoints = 0;
+
+    if (flush.siridb == NULL)
+    {
+        log_warning(
+                "Dropped %zu %s point(s) since database '%s' is not loaded",
+                npoints,
+                LNSERVER_proto_str(conn->proto),
+                siri.cfg->line_protocol_db);
+        flush.rc = -1;
+    }
+    else if (!LNSERVER_can_insert(flush.siridb))
+    {
+        log_warning(
+                "Dropped %zu %s point(s) since database '%s' cannot accept "
+                "inserts at the moment",
+                npoints,
+                LNSERVER_proto_str(conn->proto),
+                siri.cfg->line_protocol_db);
+        flush.siridb->dropped_points += npoints;
+        flush.rc = -1;
+    }
+    else if (LNSERVER_queue_full(flush.siridb))
+    {
+        log_warning(
+                "Dropped %zu %s point(s) since database '%s' has too many "
+                "pending inserts",
+                npoints,
+                LNSERVER_proto_str(conn->proto),
+                siri.cfg->line_protocol_db);
+        flush.siridb->dropped_points += npoints;
+        flush.rc = -1;
+    }
+    else if ((flush.insert = siridb_insert_new(
+            flush.siridb,
+            0,
+            NULL)) == NULL)
+    {
+        flush.rc = -1;  /* signal is raised */
+    }
+
+    /* the call-back consumes all pcaches, also when an error occurs */
+    ct_items(series, (ct_item_cb) LNSERVER_assign_cb, &flush);
+    ct_free(series, NULL);
+
+    if (flush.insert == NULL)
+    {
+        return;
+    }
+
+    if (flush.rc)
+    {
+        siridb_insert_free(flush.insert);  /* signal is raised */
+        return;
+    }
+
+    /* count the points like a client package in the insert queue */
+    siridb_insert_enqueue(flush.insert, npoints * sizeof(siridb_point_t));
+
+    if (siridb_insert_points_to_pools(flush.insert, npoints))
+    {
+        siridb_insert_free(flush.insert);  /* signal is raised */
+    }
+}
+
+/*
+ * Stop reading from a TCP connection. The pending points are kept and the
+ * connection is resumed by sirinet_lnserver_resume() or by a retry timer when
+ * the database cannot accept inserts for another reason.
+ */
+static void LNSERVER_pause(lnserver_conn_t * conn)
+{
+    assert (conn->tp == LNSERVER_TCP && conn->timer == NULL);
+
+    uv_read_stop((uv_stream_t *) &conn->via.tcp);
+    conn->paused = 1;
+    npaused++;
+
+    log_debug(
+            "Stop reading %s data with %zu pending point(s)",
+            LNSERVER_proto_str(conn->proto),
+            conn->npoints);
+
+    conn->timer = (uv_timer_t *) malloc(sizeof(uv_timer_t));
+    if (conn->timer == NULL)
+    {
+        ERR_ALLOC
+        return;
+    }
+
+    uv_timer_init(siri.loop, conn->timer);
+    conn->timer->data = conn;
+    uv_timer_start(conn->timer, LNSERVER_on_retry, LNSERVER_RETRY, 0);
+}
+
+/*
+ * Try to insert the pending points of a paused connection and start reading
+ * again if successful. Otherwise the connection is paused again.
+ */
+static void LNSERVER_resume(lnserver_conn_t * conn)
+{
+    conn->paused = 0;
+    npaused--;
+
+    LNSERVER_flush(conn, 1);
+
+    if (!conn->paused)
+    {
+        log_debug("Start reading %s data", LNSERVER_proto_str(conn->proto));
+        uv_read_start(
+                (uv_stream_t *) &conn->via.tcp,
+                LNSERVER_alloc_buffer,
+                LNSERVER_on_read);
+    }
+}
+
+static void LNSERVER_on_retry(uv_timer_t * timer)
+{
+    LNSERVER_resume((lnserver_conn_t *) timer->data);
+}
+
+static int LNSERVER_assign_cb(
+        const char * name,
+        siridb_pcache_t * pcache,
+        lnserver_flush_t * flush)
+{
+    if (flush->rc)
+    {
+        siridb_pcache_free(pcache);
+    }
+    else
+    {
+        flush->rc = siridb_insert_assign_pcache(
+                flush->siridb,
+                flush->insert,
+                name,
+                strlen(name),
+                pcache);
+    }
+    return 0;
+}
+
+static siridb_t * LNSERVER_get_siridb(void)
+{
+    return siridb_get(siri.siridb_list, siri.cfg->line_protocol_db);
+}
+
+/*
+ * Same rules as for client inserts: the server must be running (and might
+ * be re-indexing) and all pools must be accessible.
+ */
+static int LNSERVER_can_insert(siridb_t * siridb)
+{
+    return (
+        siri.status == SIRI_STATUS_RUNNING && (
+            siridb->server->flags == SERVER_FLAG_RUNNING ||
+            siridb->server->flags ==
+                    (SERVER_FLAG_RUNNING | SERVER_FLAG_REINDEXING)) &&
+        siridb_pools_accessible(siridb));
+}
+
+static int LNSERVER_queue_full(siridb_t * siridb)
+{
+    return (
+        siri.cfg->max_insert_queue &&
+        siridb->insert_queue_size >=
+            (size_t) siri.cfg->max_insert_queue * 1024);
+}
+
+static int64_t LNSERVER_now(siridb_t * siridb)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t) siridb_time_now(siridb, now);
+}
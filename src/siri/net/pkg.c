@@ -7,6 +7,8 @@
  *
  * changes
  *  - initial version, 18-06-2016
+ *  - sending returns an error when the package cannot be written,
+ *    18-10-2026
  *
  */
 #include <assert.h>
@@ -172,8 +174,9 @@ sirinet_pkg_t * sirinet_pkg_err(
 }
 
 /*
- * Returns 0 if successful or -1 when an error has occurred.
- * (signal is raised in case of an error)
+ * Returns 0 if successful or -1 when an error has occurred. A signal is
+ * raised in case of an allocation error but not when the package cannot be
+ * written to the client, for example because the client is closing.
  *
  * Note: pkg will be freed after calling this function.
  */
@@ -212,7 +215,18 @@ int sirinet_pkg_send(uv_stream_t * client, sirinet_pkg_t * pkg)
             (char *) pkg,
             sizeof(sirinet_pkg_t) + pkg->len);
 
-    uv_write(req, client, &wrbuf, 1, PKG_write_cb);
+    int rc = uv_write(req, client, &wrbuf, 1, PKG_write_cb);
+
+    if (rc)
+    {
+        /* the call-back is not called so we clean up here */
+        log_error("Cannot write package: %s", uv_strerror(rc));
+        sirinet_socket_decref(client);
+        free(pkg);
+        free(data);
+        free(req);
+        return -1;
+    }
 
     return 0;
 }
@@ -7,6 +7,8 @@
  *
  * changes
  *  - initial version, 01-08-2016
+ *  - added BPROTO_INSERT_LOCAL, 18-10-2026
+ *  - added CPROTO_REQ_QUERY_STREAM, 18-10-2026
  *
  */
 #include <siri/net/protocol.h>
@@ -28,6 +30,8 @@ const char * sirinet_cproto_client_str(cproto_client_t n)
     case CPROTO_REQ_FILE_SERVERS: return "CPROTO_REQ_FILE_SERVERS";
     case CPROTO_REQ_FILE_USERS: return "CPROTO_REQ_FILE_USERS";
     case CPROTO_REQ_FILE_GROUPS: return "CPROTO_REQ_FILE_GROUPS";
+    case CPROTO_REQ_INSERT_BULK: return "CPROTO_REQ_INSERT_BULK";
+    case CPROTO_REQ_QUERY_STREAM: return "CPROTO_REQ_QUERY_STREAM";
     default:
         sprintf(protocol_str, "CPROTO_CLIENT_TYPE_UNKNOWN (%d)", n);
         return protocol_str;
@@ -44,6 +48,7 @@ const char * sirinet_cproto_server_str(cproto_server_t n)
     case CPROTO_RES_ACK: return "CPROTO_RES_ACK";
     case CPROTO_RES_INFO: return "CPROTO_RES_INFO";
     case CPROTO_RES_FILE: return "CPROTO_RES_FILE";
+    case CPROTO_RES_QUERY_CHUNK: return "CPROTO_RES_QUERY_CHUNK";
     case CPROTO_ERR_MSG: return "CPROTO_ERR_MSG";
     case CPROTO_ERR_QUERY: return "CPROTO_ERR_QUERY";
     case CPROTO_ERR_INSERT: return "CPROTO_ERR_INSERT";
@@ -83,6 +88,7 @@ const char * sirinet_bproto_client_str(bproto_client_t n)
     case BPROTO_REQ_GROUPS: return "BPROTO_REQ_GROUPS";
     case BPROTO_ENABLE_BACKUP_MODE: return "BPROTO_ENABLE_BACKUP_MODE";
     case BPROTO_DISABLE_BACKUP_MODE: return "BPROTO_DISABLE_BACKUP_MODE";
+    case BPROTO_INSERT_LOCAL: return "BPROTO_INSERT_LOCAL";
     default:
         sprintf(protocol_str, "BPROTO_CLIENT_TYPE_UNKNOWN (%d)", n);
         return protocol_str;
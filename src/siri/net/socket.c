@@ -7,6 +7,7 @@
  *
  * changes
  *  - initial version, 09-03-2016
+ *  - initialize insert queue size and paused flag, 18-10-2026
  *
  */
 #include <assert.h>
@@ -399,6 +400,8 @@ uv_tcp_t * sirinet_socket_new(sirinet_socket_tp_t tp, on_data_cb_t cb)
     ssocket->origin = NULL;
     ssocket->siridb = NULL;
     ssocket->ref = 1;
+    ssocket->paused = 0;
+    ssocket->insert_size = 0;
     ssocket->tcp.data = ssocket;
 
     return &ssocket->tcp;
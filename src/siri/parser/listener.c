@@ -7,6 +7,19 @@
  *
  * changes
  *  - initial version, 10-03-2016
+ *  - alter database set lookup_version, 18-10-2026
+ *  - the lookup version is changed on the master after all other servers,
+ *    18-10-2026
+ *  - select series on the query worker threads, 18-10-2026
+ *  - streaming select results, 18-10-2026
+ *  - specific error when other pools exceed the maximum points in stream
+ *    mode, 18-10-2026
+ *  - aggregate while reading series, 18-10-2026
+ *  - merge percentiles using sketches, 18-10-2026
+ *  - partial aggregates for merged results, 18-10-2026
+ *  - select points are allocated in the query arena, 18-10-2026
+ *  - aggregate selected points after the series lock is released,
+ *    18-10-2026
  *
  */
 #include <assert.h>
@@ -19,12 +32,14 @@
 #include <siri/db/aggregate.h>
 #include <siri/db/group.h>
 #include <siri/db/groups.h>
+#include <siri/db/lookup.h>
 #include <siri/db/nodes.h>
 #include <siri/db/presuf.h>
 #include <siri/db/props.h>
 #include <siri/db/props.h>
 #include <siri/db/query.h>
 #include <siri/db/re.h>
+#include <siri/db/reindex.h>
 #include <siri/db/series.h>
 #include <siri/db/server.h>
 #include <siri/db/servers.h>
@@ -39,6 +54,7 @@
 #include <siri/net/socket.h>
 #include <siri/parser/listener.h>
 #include <siri/parser/queries.h>
+#include <siri/qpool.h>
 #include <siri/siri.h>
 #include <strextra/strextra.h>
 #include <sys/time.h>
@@ -47,6 +63,16 @@
 #define MAX_ITERATE_COUNT 1000      // thousand
 #define MAX_SELECT_POINTS 1000000   // one million
 #define MAX_LIST_LIMIT 10000        // ten thousand
+#define SELECT_STREAM_CHUNK_POINTS 100000   // points in one chunk package
+#define SELECT_STREAM_MAX_QUEUE 16777216    // pause at 16 MB for the client
+#define SELECT_STREAM_WAIT 20               // milliseconds
+#define SELECT_STREAM_LOST_MSG \
+    "Query is cancelled since the connection to the client is lost."
+
+/* the client is closing or has closed the connection */
+#define select_stream_lost(query)                                           \
+    (uv_is_closing((uv_handle_t *) (query)->client) ||                      \
+    ((sirinet_socket_t *) (query)->client->data)->on_data == NULL)
 
 #define QP_ADD_SUCCESS qp_add_raw(query->packer, "success_msg", 11);
 #define DEFAULT_ALLOC_COLUMNS 6
@@ -155,12 +181,41 @@ if (IS_MASTER && siridb_is_reindexing(siridb))                              \
     "shards which are dropped on replica servers)"
 #define MSG_SUCCES_SET_BACKUP_MODE \
     "Successfully %s backup mode on '%s'."
+#define MSG_SUCCES_SET_LOOKUP_VERSION \
+    "Successfully changed lookup version from %u to %u. Series are moved " \
+    "to their new pool in the background, see 'show reindex_progress'."
 #define MSG_SUCCES_SET_TIMEZONE \
     "Successfully changed timezone from '%s' to '%s'."
 #define MSG_ERR_SERVER_ADDRESS \
     "Its only possible to change a servers address or port when the server " \
     "is not connected."
 
+/*
+ * A select job reads and aggregates the points for one series on a query
+ * worker thread. At most max_query_parallelism jobs are started at once for
+ * a query and the last finished job wakes the query on the main thread
+ * where the points are added to the result in the order of the series list.
+ */
+typedef struct select_job_s
+{
+    siri_qpool_job_t job;           /* must be the first member */
+    query_select_jobs_t * jobs;
+    siridb_series_t * series;
+    siridb_points_t * points;       /* NULL when failed or no points */
+    int failed;
+    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
+} select_job_t;
+
+struct query_select_jobs_s
+{
+    uv_mutex_t mutex;               /* protects pending */
+    size_t pending;
+    size_t n;
+    uv_async_t * handle;
+    siridb_t * siridb;
+    query_select_t * q_select;
+    select_job_t job[];
+};
 
 static void enter_access_expr(uv_async_t * handle);
 static void enter_alter_group(uv_async_t * handle);
@@ -229,6 +284,7 @@ static void exit_set_address(uv_async_t * handle);
 static void exit_set_backup_mode(uv_async_t * handle);
 static void exit_set_drop_threshold(uv_async_t * handle);
 static void exit_set_log_level(uv_async_t * handle);
+static void exit_set_lookup_version(uv_async_t * handle);
 static void exit_set_port(uv_async_t * handle);
 static void exit_set_timezone(uv_async_t * handle);
 static void exit_show_stmt(uv_async_t * handle);
@@ -242,6 +298,7 @@ static void async_drop_shards(uv_async_t * handle);
 static void async_filter_series(uv_async_t * handle);
 static void async_list_series(uv_async_t * handle);
 static void async_select_aggregate(uv_async_t * handle);
+static void async_select_jobs(uv_async_t * handle);
 static void async_series_re(uv_async_t * handle);
 
 /* on response functions */
@@ -257,8 +314,12 @@ static void on_groups_response(slist_t * promises, uv_async_t * handle);
 static void on_list_xxx_response(slist_t * promises, uv_async_t * handle);
 static void on_select_response(slist_t * promises, uv_async_t * handle);
 static void on_update_xxx_response(slist_t * promises, uv_async_t * handle);
+static void on_set_lookup_version_response(
+        slist_t * promises,
+        uv_async_t * handle);
 
 /* helper functions */
+static void set_lookup_version(uv_async_t * handle, uint8_t version);
 static void master_select_work(uv_work_t * handle);
 static void master_select_work_finish(uv_work_t * work, int status);
 static int items_select_master(
@@ -277,6 +338,14 @@ int items_select_other_merge(
         const char * name,
         slist_t * plist,
         uv_async_t * handle);
+static int items_select_master_partials(
+        const char * name,
+        siridb_partials_t * partials,
+        uv_async_t * handle);
+static int items_select_other_partials(
+        const char * name,
+        siridb_partials_t * partials,
+        uv_async_t * handle);
 static void on_select_unpack_points(
         qp_unpacker_t * unpacker,
         query_select_t * q_select,
@@ -291,11 +360,28 @@ static void on_select_unpack_merged_points(
         qp_obj_t * qp_tp,
         qp_obj_t * qp_len,
         qp_obj_t * qp_points);
+static int on_select_unpack_partials(
+        qp_unpacker_t * unpacker,
+        query_select_t * q_select,
+        qp_obj_t * qp_name,
+        qp_obj_t * qp_partials,
+        char * err_msg);
 
 static int values_list_groups(siridb_group_t * group, uv_async_t * handle);
 static int values_count_groups(siridb_group_t * group, uv_async_t * handle);
 static void finish_list_groups(uv_async_t * handle);
 static void finish_count_groups(uv_async_t * handle);
+static int select_add_points(
+        siridb_query_t * query,
+        siridb_series_t * series,
+        siridb_points_t * points);
+static int select_check_max_points(siridb_query_t * query);
+static query_select_jobs_t * select_jobs_start(uv_async_t * handle);
+static void select_jobs_work(select_job_t * job);
+static int select_jobs_finish(query_select_jobs_t * jobs);
+static int select_stream_flush(siridb_query_t * query);
+static int select_stream_wait(uv_async_t * handle);
+static void select_stream_wake(uv_timer_t * timer);
 
 /* address bindings for default list properties */
 static uint32_t GID_K_NAME = CLERI_GID_K_NAME;
@@ -447,6 +533,8 @@ void siriparser_init_listener(void)
     siriparser_listen_exit[CLERI_GID_SET_BACKUP_MODE] = exit_set_backup_mode;
     siriparser_listen_exit[CLERI_GID_SET_DROP_THRESHOLD] = exit_set_drop_threshold;
     siriparser_listen_exit[CLERI_GID_SET_LOG_LEVEL] = exit_set_log_level;
+    siriparser_listen_exit[CLERI_GID_SET_LOOKUP_VERSION] =
+            exit_set_lookup_version;
     siriparser_listen_exit[CLERI_GID_SET_PORT] = exit_set_port;
     siriparser_listen_exit[CLERI_GID_SET_TIMEZONE] = exit_set_timezone;
     siriparser_listen_exit[CLERI_GID_SHOW_STMT] = exit_show_stmt;
@@ -768,36 +856,23 @@ static void enter_group_match(uv_async_t * handle)
     }
     else
     {
-        siridb_series_t * series;
-
-        q_wrapper->series_tmp = (q_wrapper->update_cb == NULL) ?
-                q_wrapper->series_map : imap_new();
-
-        if (q_wrapper->series_tmp != NULL)
-        {
-            uv_mutex_lock(&siridb->groups->mutex);
-
-            for (size_t i = 0; i < group->series->len; i++)
-            {
-                series = (siridb_series_t *) group->series->data[i];
-                siridb_series_incref(series);
-                imap_add(q_wrapper->series_tmp, series->id, series);
-            }
+        int rc;
 
-            uv_mutex_unlock(&siridb->groups->mutex);
+        /* the group id's can be used directly, no copy is needed */
+        uv_mutex_lock(&siridb->groups->mutex);
 
-            if (q_wrapper->update_cb != NULL)
-            {
-                (*q_wrapper->update_cb)(
-                        q_wrapper->series_map,
-                        q_wrapper->series_tmp,
-                        (imap_free_cb) &siridb__series_decref);
-            }
+        rc = (q_wrapper->update_cb == NULL) ?
+                roaring_union(q_wrapper->series_map, group->ids) :
+                (*q_wrapper->update_cb)(q_wrapper->series_map, group->ids);
 
-            q_wrapper->series_tmp = NULL;
+        uv_mutex_unlock(&siridb->groups->mutex);
 
-            SIRIPARSER_ASYNC_NEXT_NODE
+        if (rc)
+        {
+            MEM_ERR_RET
         }
+
+        SIRIPARSER_ASYNC_NEXT_NODE
     }
 }
 
@@ -890,12 +965,24 @@ static void enter_merge_as(uv_async_t * handle)
 
     strx_extract_string(q_select->merge_as, node->str, node->len);
 
-    if (IS_MASTER && query->nodes->node->children->next->next->next != NULL)
+    /*
+     * Pools need the merge aggregation list as well since they send partial
+     * results instead of points when the first aggregate allows this.
+     */
+    if (query->nodes->node->children->next->next->next != NULL)
     {
         q_select->mlist = siridb_aggregate_list(
                 query->nodes->node->children->next->next->next->node->
                     children->node->children->next->node->children,
                 query->err_msg);
+
+        if (q_select->mlist == NULL)
+        {
+            siridb_query_send_error(handle, CPROTO_ERR_QUERY);
+            return;
+        }
+
+        q_select->partial = siridb_aggregate_partial(q_select->mlist);
     }
 
     SIRIPARSER_ASYNC_NEXT_NODE
@@ -1100,7 +1187,7 @@ static void enter_series_name(uv_async_t * handle)
 
     if (siridb_is_reindexing(siridb))
     {
-        series = ct_get(siridb->series, series_name);
+        series = art_get(siridb->series, series_name);
     }
     else
     {
@@ -1110,7 +1197,7 @@ static void enter_series_name(uv_async_t * handle)
         /* check if this series belongs to 'this' pool and if so get the series */
         if (pool == siridb->server->pool)
         {
-            series = (siridb_series_t *) ct_get(
+            series = (siridb_series_t *) art_get(
                                 siridb->series,
                                 series_name);
             if (series == NULL)
@@ -1135,82 +1222,41 @@ static void enter_series_name(uv_async_t * handle)
 
     if (series == NULL)
     {
-        if (q_wrapper->update_cb == &imap_intersection_ref)
+        if (q_wrapper->update_cb == &roaring_intersection)
         {
-            imap_free(
-                    q_wrapper->series_map,
-                    (imap_free_cb) &siridb__series_decref);
-
-            q_wrapper->series_map = imap_new();
-
-            if (q_wrapper->series_map == NULL)
-            {
-                MEM_ERR_RET
-            }
+            roaring_clear(q_wrapper->series_map);
         }
     }
     else
     {
         if (    q_wrapper->update_cb == NULL ||
-                q_wrapper->update_cb == &imap_union_ref)
+                q_wrapper->update_cb == &roaring_union)
         {
-            if (imap_add(q_wrapper->series_map, series->id, series) == 1)
+            if (roaring_add(q_wrapper->series_map, series->id) < 0)
             {
-                siridb_series_incref(series);
+                MEM_ERR_RET  // signal is raised
             }
         }
-        else if (q_wrapper->update_cb == &imap_difference_ref)
+        else if (q_wrapper->update_cb == &roaring_difference)
         {
-            series = (siridb_series_t *) imap_pop(
-                    q_wrapper->series_map,
-                    series->id);
-            if (series != NULL)
-            {
-                siridb_series_decref(series);
-            }
+            roaring_remove(q_wrapper->series_map, series->id);
         }
-        else if (q_wrapper->update_cb == &imap_intersection_ref)
+        else if (q_wrapper->update_cb == &roaring_intersection)
         {
-            series = (siridb_series_t *) imap_get(
-                    q_wrapper->series_map,
-                    series->id);
-
-            if (series != NULL)
-            {
-                siridb_series_incref(series);
-            }
-
-            imap_free(
-                    q_wrapper->series_map,
-                    (imap_free_cb) &siridb__series_decref);
+            int found = roaring_contains(q_wrapper->series_map, series->id);
 
-            q_wrapper->series_map = imap_new();
+            roaring_clear(q_wrapper->series_map);
 
-            if (q_wrapper->series_map != NULL && series != NULL)
+            if (found && roaring_add(q_wrapper->series_map, series->id) < 0)
             {
-                if (imap_add(q_wrapper->series_map, series->id, series) != 1)
-                {
-                    siridb_series_decref(series);
-                    MEM_ERR_RET
-                }
+                MEM_ERR_RET  // signal is raised
             }
         }
-        else if (q_wrapper->update_cb == &imap_symmetric_difference_ref)
+        else if (q_wrapper->update_cb == &roaring_symmetric_difference)
         {
-            switch (imap_add(q_wrapper->series_map, series->id, series))
+            if (    !roaring_remove(q_wrapper->series_map, series->id) &&
+                    roaring_add(q_wrapper->series_map, series->id) < 0)
             {
-            case 0:
-                series = (siridb_series_t *) imap_pop(
-                        q_wrapper->series_map,
-                        series->id);
-                siridb_series_decref(series);
-                break;
-
-            case 1:
-                siridb_series_incref(series);
-                break;
-
-            default:
                 MEM_ERR_RET  // signal is raised
             }
         }
@@ -1228,7 +1274,7 @@ static void enter_series_match(uv_async_t * handle)
 {
     siridb_query_t * query = (siridb_query_t *) handle->data;
 
-    if ((((query_wrapper_t *) query->data)->series_map = imap_new()) == NULL)
+    if ((((query_wrapper_t *) query->data)->series_map = roaring_new()) == NULL)
     {
         MEM_ERR_RET
     }
@@ -1250,13 +1296,11 @@ static void enter_series_re(uv_async_t * handle)
         q_wrapper->pmap = NULL;
     }
 
-    /* extract and compile regular expression */
-    if (siridb_re_compile(
-            &q_wrapper->regex,
-            &q_wrapper->regex_extra,
+    /* extract and compile regular expression (or get it from the cache) */
+    if ((q_wrapper->re = siridb_re_get(
             node->str,
             node->len,
-            query->err_msg))
+            query->err_msg)) == NULL)
     {
         siridb_query_send_error(handle, CPROTO_ERR_QUERY);
     }
@@ -1264,16 +1308,19 @@ static void enter_series_re(uv_async_t * handle)
     {
         uv_mutex_lock(&siridb->series_mutex);
 
-        q_wrapper->slist = imap_2slist_ref(
-                (   q_wrapper->update_cb == NULL ||
-                    q_wrapper->update_cb == &imap_union_ref ||
-                    q_wrapper->update_cb == &imap_symmetric_difference_ref) ?
-                        siridb->series_map : q_wrapper->series_map);
+        q_wrapper->slist = (
+                q_wrapper->update_cb == NULL ||
+                q_wrapper->update_cb == &roaring_union ||
+                q_wrapper->update_cb == &roaring_symmetric_difference) ?
+                        idmap_2slist_ref(siridb->series_map) :
+                        siridb_series_slist_ref(
+                                siridb,
+                                q_wrapper->series_map);
 
         uv_mutex_unlock(&siridb->series_mutex);
 
         q_wrapper->series_tmp = (q_wrapper->update_cb == NULL) ?
-                q_wrapper->series_map : imap_new();
+                q_wrapper->series_map : roaring_new();
 
         if (q_wrapper->slist == NULL || q_wrapper->series_tmp == NULL)
         {
@@ -1310,16 +1357,16 @@ static void enter_series_sep(uv_async_t * handle)
     switch (query->nodes->node->children->node->cl_obj->via.dummy->gid)
     {
     case CLERI_GID_K_UNION:
-        q_wrapper->update_cb = &imap_union_ref;
+        q_wrapper->update_cb = &roaring_union;
         break;
     case CLERI_GID_K_INTERSECTION:
-        q_wrapper->update_cb = &imap_intersection_ref;
+        q_wrapper->update_cb = &roaring_intersection;
         break;
     case CLERI_GID_C_DIFFERENCE:
-        q_wrapper->update_cb = &imap_difference_ref;
+        q_wrapper->update_cb = &roaring_difference;
         break;
     case CLERI_GID_K_SYMMETRIC_DIFFERENCE:
-        q_wrapper->update_cb = &imap_symmetric_difference_ref;
+        q_wrapper->update_cb = &roaring_symmetric_difference;
         break;
     default:
         assert (0);
@@ -1651,9 +1698,9 @@ static void exit_count_series(uv_async_t * handle)
     {
         uv_mutex_lock(&siridb->series_mutex);
 
-        q_count->slist = imap_2slist_ref(
-                (q_count->series_map == NULL) ?
-                        siridb->series_map : q_count->series_map);
+        q_count->slist = (q_count->series_map == NULL) ?
+                idmap_2slist_ref(siridb->series_map) :
+                siridb_series_slist_ref(siridb, q_count->series_map);
 
         uv_mutex_unlock(&siridb->series_mutex);
 
@@ -1695,17 +1742,27 @@ static void exit_count_series_length(uv_async_t * handle)
     {
         uv_mutex_lock(&siridb->series_mutex);
 
-        slist_t * slist = imap_2slist((q_count->series_map == NULL) ?
-                siridb->series_map : q_count->series_map);
+        slist_t * slist = (q_count->series_map == NULL) ?
+                idmap_2slist(siridb->series_map) :
+                siridb_series_slist_ref(siridb, q_count->series_map);
 
         uv_mutex_unlock(&siridb->series_mutex);
 
+        if (slist == NULL)
+        {
+            MEM_ERR_RET
+        }
+
         siridb_series_t * series;
 
         for (size_t i = 0; i < slist->len; i++)
         {
             series = (siridb_series_t *) slist->data[i];
             q_count->n += series->length;
+            if (q_count->series_map != NULL)
+            {
+                siridb_series_decref(series);
+            }
         }
 
         slist_free(slist);
@@ -1729,9 +1786,9 @@ static void exit_count_series_length(uv_async_t * handle)
     {
         uv_mutex_lock(&siridb->series_mutex);
 
-        q_count->slist = imap_2slist_ref(
-                (q_count->series_map == NULL) ?
-                        siridb->series_map : q_count->series_map);
+        q_count->slist = (q_count->series_map == NULL) ?
+                idmap_2slist_ref(siridb->series_map) :
+                siridb_series_slist_ref(siridb, q_count->series_map);
 
         uv_mutex_unlock(&siridb->series_mutex);
 
@@ -2177,14 +2234,14 @@ static void exit_drop_series(uv_async_t * handle)
     MASTER_CHECK_ACCESSIBLE(siridb)
 
     /*
-     * We transform or copy the references from imap to slist because we need
+     * We resolve the series id's to a list with references because we need
      * this list for both filtering or performing the actual drop.
      */
     uv_mutex_lock(&siridb->series_mutex);
 
     q_drop->slist = (q_drop->series_map == NULL) ?
-        imap_2slist_ref(siridb->series_map) :
-        imap_slist_pop(q_drop->series_map);
+        idmap_2slist_ref(siridb->series_map) :
+        siridb_series_slist_ref(siridb, q_drop->series_map);
 
     uv_mutex_unlock(&siridb->series_mutex);
 
@@ -2195,8 +2252,8 @@ static void exit_drop_series(uv_async_t * handle)
 
     if (q_drop->series_map != NULL)
     {
-        /* now we can simply destroy the imap in case we had one */
-        imap_free(q_drop->series_map, NULL);
+        /* now we can simply destroy the id's in case we had them */
+        roaring_free(q_drop->series_map);
         q_drop->series_map = NULL;
     }
 
@@ -2208,7 +2265,7 @@ static void exit_drop_series(uv_async_t * handle)
     if (q_drop->where_expr != NULL)
     {
         /* create a new one */
-        q_drop->series_map = imap_new();
+        q_drop->series_map = roaring_new();
 
         if (q_drop->series_map == NULL)
         {
@@ -2728,8 +2785,9 @@ static void exit_list_series(uv_async_t * handle)
 
     uv_mutex_lock(&siridb->series_mutex);
 
-    q_list->slist = imap_2slist_ref((q_list->series_map == NULL) ?
-                    siridb->series_map : q_list->series_map);
+    q_list->slist = (q_list->series_map == NULL) ?
+            idmap_2slist_ref(siridb->series_map) :
+            siridb_series_slist_ref(siridb, q_list->series_map);
 
     uv_mutex_unlock(&siridb->series_mutex);
 
@@ -3070,25 +3128,24 @@ static void exit_revoke_user(uv_async_t * handle)
 static void exit_select_aggregate(uv_async_t * handle)
 {
     siridb_query_t * query = (siridb_query_t *) handle->data;
+    siridb_t * siridb = ((sirinet_socket_t *) query->client->data)->siridb;
     query_select_t * q_select = (query_select_t *) query->data;
 
     if (q_select->where_expr != NULL)
     {
-        /* we transform the references from imap to slist */
-        q_select->slist = imap_slist_pop(q_select->series_map);
+        /* we resolve the series id's to a list with references */
+        uv_mutex_lock(&siridb->series_mutex);
 
-        if (q_select->slist != NULL)
-        {
-            /* now we can simply destroy the imap */
-            imap_free(q_select->series_map, NULL);
+        q_select->slist = siridb_series_slist_ref(
+                siridb,
+                q_select->series_map);
 
-            /* create a new one */
-            q_select->series_map = imap_new();
+        uv_mutex_unlock(&siridb->series_mutex);
 
-            if (q_select->series_map == NULL)
-            {
-                MEM_ERR_RET
-            }
+        if (q_select->slist != NULL)
+        {
+            /* the filtered series will be added to an empty set */
+            roaring_clear(q_select->series_map);
 
             uv_async_t * next =
                     (uv_async_t *) malloc(sizeof(uv_async_t));
@@ -3126,7 +3183,31 @@ static void exit_select_aggregate(uv_async_t * handle)
         }
         else
         {
-            if (q_select->merge_as != NULL)
+            if (q_select->merge_as != NULL && q_select->partial != NULL)
+            {
+                siridb_partials_t * partials =
+                        siridb_aggregate_partials_new(q_select->partial);
+
+                if (partials == NULL || ct_add(
+                        q_select->result,
+                        siridb_presuf_name(
+                                q_select->presuf,
+                                q_select->merge_as,
+                                strlen(q_select->merge_as)),
+                        partials))
+                {
+                    sprintf(query->err_msg,
+                            "Critical error while adding partial aggregates "
+                            "to map.");
+                    if (partials != NULL)
+                    {
+                        siridb_partials_free(partials);
+                    }
+                    siridb_query_send_error(handle, CPROTO_ERR_QUERY);
+                    return;
+                }
+            }
+            else if (q_select->merge_as != NULL)
             {
                 slist_t * plist = slist_new(SLIST_DEFAULT_SIZE);
 
@@ -3157,7 +3238,13 @@ static void exit_select_aggregate(uv_async_t * handle)
                 }
                 else
                 {
-                    q_select->slist = imap_2slist_ref(q_select->series_map);
+                    uv_mutex_lock(&siridb->series_mutex);
+
+                    q_select->slist = siridb_series_slist_ref(
+                            siridb,
+                            q_select->series_map);
+
+                    uv_mutex_unlock(&siridb->series_mutex);
 
                     if (q_select->slist == NULL)
                     {
@@ -3177,7 +3264,9 @@ static void exit_select_aggregate(uv_async_t * handle)
                     uv_async_init(
                             siri.loop,
                             next,
-                            (uv_async_cb) async_select_aggregate);
+                            (siri.qpool == NULL) ?
+                                    (uv_async_cb) async_select_aggregate :
+                                    (uv_async_cb) async_select_jobs);
                     uv_async_send(next);
 
                     uv_close((uv_handle_t *) handle, (uv_close_cb) free);
@@ -3255,7 +3344,10 @@ static void exit_select_stmt(uv_async_t * handle)
                         (q_select->merge_as == NULL) ?
                                 (ct_item_cb) &items_select_other
                                 :
-                                (ct_item_cb) &items_select_other_merge,
+                        (q_select->partial == NULL) ?
+                                (ct_item_cb) &items_select_other_merge
+                                :
+                                (ct_item_cb) &items_select_other_partials,
                         handle) ||
                 qp_add_type(query->packer, QP_MAP_CLOSE))
         {
@@ -3617,6 +3709,70 @@ static void exit_set_log_level(uv_async_t * handle)
     }
 }
 
+static void exit_set_lookup_version(uv_async_t * handle)
+{
+    siridb_query_t * query = (siridb_query_t *) handle->data;
+    siridb_t * siridb = ((sirinet_socket_t *) query->client->data)->siridb;
+    cleri_node_t * node = query->nodes->node->children->next->next->node;
+
+    MASTER_CHECK_ONLINE(siridb)
+
+    uint64_t version = strx_to_uint64(node->str, node->len);
+
+    if (version >= SIRIDB_LOOKUP_END)
+    {
+        snprintf(query->err_msg,
+                SIRIDB_MAX_SIZE_ERR_MSG,
+                "Unknown lookup version: %" PRIu64 ". (the latest version "
+                "is %d)",
+                version,
+                SIRIDB_LOOKUP_END - 1);
+        siridb_query_send_error(handle, CPROTO_ERR_QUERY);
+    }
+    else if (siridb->lookup_version == version && !IS_MASTER)
+    {
+        /*
+         * The master changes its own version last, so this is a retry of a
+         * change which did not reach every server the first time.
+         */
+        set_lookup_version(handle, (uint8_t) version);
+    }
+    else if (siridb->lookup_version == version)
+    {
+        snprintf(query->err_msg,
+                SIRIDB_MAX_SIZE_ERR_MSG,
+                "Database '%s' is already using lookup version %u.",
+                siridb->dbname,
+                siridb->lookup_version);
+        siridb_query_send_error(handle, CPROTO_ERR_QUERY);
+    }
+    else if (siridb_is_reindexing(siridb))
+    {
+        snprintf(query->err_msg,
+                SIRIDB_MAX_SIZE_ERR_MSG,
+                "SiriDB cannot change the lookup version because the "
+                "database is currently re-indexing");
+        siridb_query_send_error(handle, CPROTO_ERR_POOL);
+    }
+    else if (IS_MASTER)
+    {
+        /*
+         * Change the version on the other servers first. This server only
+         * changes when all servers have accepted the change so the version
+         * on this server is never ahead of the others.
+         */
+        siridb_query_forward(
+                handle,
+                SIRIDB_QUERY_FWD_UPDATE,
+                (sirinet_promises_cb) on_set_lookup_version_response,
+                0);
+    }
+    else
+    {
+        set_lookup_version(handle, (uint8_t) version);
+    }
+}
+
 static void exit_set_port(uv_async_t * handle)
 {
     siridb_query_t * query = (siridb_query_t *) handle->data;
@@ -3814,7 +3970,7 @@ static void exit_timeit_stmt(uv_async_t * handle)
 
     clock_gettime(CLOCK_REALTIME, &end);
 
-    qp_add_type(query->timeit, QP_MAP2);
+    qp_add_type(query->timeit, QP_MAP3);
     qp_add_raw(query->timeit, "server", 6);
     qp_add_string(
             query->timeit,
@@ -3823,6 +3979,10 @@ static void exit_timeit_stmt(uv_async_t * handle)
     qp_add_double(query->timeit,
             (double) (end.tv_sec - query->start.tv_sec) +
             (double) (end.tv_nsec - query->start.tv_nsec) / 1000000000.0f);
+    qp_add_raw(query->timeit, "memory", 6);
+    qp_add_int64(
+            query->timeit,
+            (int64_t) siridb_arena_peak(&query->arena));
 
     if (query->packer == NULL)
     {
@@ -4072,12 +4232,11 @@ static void async_filter_series(uv_async_t * handle)
                 (cexpr_cb_t) siridb_series_cexpr_cb,
                 series))
         {
-            imap_add(q_wrapper->series_map, series->id, series);
-        }
-        else
-        {
-            siridb_series_decref(series);
+            /* on failure a signal is raised */
+            roaring_add(q_wrapper->series_map, series->id);
         }
+
+        siridb_series_decref(series);
     }
 
     if (async_more)
@@ -4208,119 +4367,85 @@ static void async_select_aggregate(uv_async_t * handle)
     siridb_t * siridb = ((sirinet_socket_t *) query->client->data)->siridb;
     uint8_t async_more = 0;
     siridb_series_t * series;
-    siridb_points_t * points;
-    siridb_points_t * aggr_points;
+    siridb_points_t * points = NULL;
+    int rc = 0;
 
-    if (q_select->n > MAX_SELECT_POINTS)
+    if (select_check_max_points(query))
     {
-        snprintf(query->err_msg,
-                SIRIDB_MAX_SIZE_ERR_MSG,
-                "Query has reached the maximum number of selected points "
-                "(%u). Please use another time window, an aggregation "
-                "function or select less series to reduce the number of "
-                "points.",
-                MAX_SELECT_POINTS);
-
         siridb_query_send_error(handle, CPROTO_ERR_QUERY);
         return;
     }
 
+    if ((rc = select_stream_wait(handle)))
+    {
+        if (rc < 0)
+        {
+            siridb_query_send_error(handle, CPROTO_ERR_QUERY);
+        }
+        return;
+    }
+
     series = (siridb_series_t *)
             q_select->slist->data[q_select->slist_index];
 
     /*
-     * We must decrement the ref count immediately since we now update the
-     * index by one. The series will not be freed since at least 'series_map'
-     * still has a reference.
+     * The index is updated by one so we must decrement the ref count for
+     * this series when we are done with it, including on errors.
      */
-    siridb_series_decref(series);
-
     if ((++q_select->slist_index) < q_select->slist->len)
     {
         async_more = 1;
     }
 
-    uv_mutex_lock(&siridb->series_mutex);
-
-    points = (series->flags & SIRIDB_SERIES_IS_DROPPED) ?
-            NULL : siridb_series_get_points(
-                    series,
-                    q_select->start_ts,
-                    q_select->end_ts);
+    siridb_arena_enter(&query->arena);
 
-    uv_mutex_unlock(&siridb->series_mutex);
+    uv_mutex_lock(siridb_series_stripe(siridb, series));
 
-    if (points != NULL)
+    if (~series->flags & SIRIDB_SERIES_IS_DROPPED)
     {
-        const char * name;
-
-        for (size_t i = 0; points->len && i < q_select->alist->len; i++)
+        points = siridb_series_get_points(
+                series,
+                q_select->start_ts,
+                q_select->end_ts);
+        if (points == NULL)
         {
-            aggr_points = siridb_aggregate_run(
-                    points,
-                    (siridb_aggr_t *) q_select->alist->data[i],
-                    query->err_msg);
-
-            if (aggr_points != points)
-            {
-                siridb_points_free(points);
-            }
-
-            if (aggr_points == NULL)
-            {
-                siridb_query_send_error(handle, CPROTO_ERR_QUERY);
-                return;
-            }
-
-            points = aggr_points;
+            sprintf(query->err_msg, "Memory allocation error.");
+            rc = -1;  /* signal is raised */
         }
+    }
 
-        q_select->n += points->len;
-
-        if (q_select->merge_as == NULL)
-        {
-            name = siridb_presuf_name(
-                    q_select->presuf,
-                    series->name,
-                    series->name_len);
-
-            if (name == NULL || ct_add(q_select->result, name, points))
-            {
-                sprintf(query->err_msg, "Error adding points to map.");
-                siridb_points_free(points);
-                log_critical("Critical error adding points");
-                siridb_query_send_error(handle, CPROTO_ERR_QUERY);
-                return;
-            }
-        }
-        else
-        {
-            slist_t ** plist;
+    uv_mutex_unlock(siridb_series_stripe(siridb, series));
 
-            name = siridb_presuf_name(
-                    q_select->presuf,
-                    q_select->merge_as,
-                    strlen(q_select->merge_as));
+    /* aggregate after the lock is released so inserts are not blocked */
+    if (points != NULL)
+    {
+        points = siridb_aggregate_list_run(
+                points,
+                q_select->alist,
+                query->err_msg);
+        rc = (points == NULL) ? -1 : select_add_points(query, series, points);
+    }
 
-            plist = (slist_t **) ct_getaddr(q_select->result, name);
+    /* the main thread is shared with other queries */
+    siridb_arena_leave();
 
-            if (    name == NULL ||
-                    plist == NULL ||
-                    slist_append_safe(plist, points))
-            {
-                sprintf(query->err_msg, "Error adding points to map.");
-                siridb_points_free(points);
-                log_critical("Critical error adding points");
-                siridb_query_send_error(handle, CPROTO_ERR_QUERY);
-                return;
-            }
-        }
+    if (rc)
+    {
+        siridb_series_decref(series);
+        siridb_query_send_error(handle, CPROTO_ERR_QUERY);
+        return;
     }
 
+    siridb_series_decref(series);
+
     if (async_more)
     {
         uv_async_send(handle);
     }
+    else if (select_stream_flush(query))
+    {
+        siridb_query_send_error(handle, CPROTO_ERR_QUERY);
+    }
     else
     {
         siridb_aggregate_list_free(q_select->alist);
@@ -4334,71 +4459,123 @@ static void async_select_aggregate(uv_async_t * handle)
     }
 }
 
-static void async_series_re(uv_async_t * handle)
+/*
+ * Like async_select_aggregate() but the series are read and aggregated on
+ * the query worker threads. This call-back runs once to start the first
+ * jobs and again each time all started jobs are finished.
+ */
+static void async_select_jobs(uv_async_t * handle)
 {
     siridb_query_t * query = (siridb_query_t *) handle->data;
-    query_wrapper_t * q_wrapper = (query_wrapper_t *) query->data;
-    uint8_t async_more = 0;
-    siridb_series_t * series;
-    size_t index_end = q_wrapper->slist_index + MAX_ITERATE_COUNT;
+    query_select_t * q_select = (query_select_t *) query->data;
+    query_select_jobs_t * jobs = q_select->jobs;
 
-    if (index_end >= q_wrapper->slist->len)
+    if (jobs != NULL)
     {
-        index_end = q_wrapper->slist->len;
+        q_select->jobs = NULL;
+
+        if (select_jobs_finish(jobs))
+        {
+            siridb_query_send_error(handle, CPROTO_ERR_QUERY);
+            return;
+        }
     }
-    else
+
+    if (select_check_max_points(query))
     {
-        async_more = 1;
+        siridb_query_send_error(handle, CPROTO_ERR_QUERY);
+        return;
     }
 
-    int pcre_exec_ret;
-
-    for (; q_wrapper->slist_index < index_end; q_wrapper->slist_index++)
+    if (q_select->slist_index < q_select->slist->len)
     {
-        series = (siridb_series_t *)
-                q_wrapper->slist->data[q_wrapper->slist_index];
+        int rc = select_stream_wait(handle);
 
-        pcre_exec_ret = pcre_exec(
-                q_wrapper->regex,
-                q_wrapper->regex_extra,
-                series->name,
-                series->name_len,
-                0,                     // start looking at this point
-                0,                     // OPTIONS
-                NULL,
-                0);                    // length of sub_str_vec
+        if (rc)
+        {
+            if (rc < 0)
+            {
+                siridb_query_send_error(handle, CPROTO_ERR_QUERY);
+            }
+            return;
+        }
 
-        if (    pcre_exec_ret ||
-                imap_add(q_wrapper->series_tmp, series->id, series) != 1)
+        if ((q_select->jobs = select_jobs_start(handle)) == NULL)
         {
-            siridb_series_decref(series);
+            MEM_ERR_RET
         }
+        return;
     }
 
-    if (async_more)
+    if (select_stream_flush(query))
     {
-        uv_async_send(handle);
+        siridb_query_send_error(handle, CPROTO_ERR_QUERY);
+        return;
+    }
+
+    siridb_aggregate_list_free(q_select->alist);
+    q_select->alist = NULL;
+
+    slist_free(q_select->slist);
+    q_select->slist = NULL;
+    q_select->slist_index = 0;
+
+    SIRIPARSER_ASYNC_NEXT_NODE
+}
+
+static void async_series_re(uv_async_t * handle)
+{
+    siridb_query_t * query = (siridb_query_t *) handle->data;
+    query_wrapper_t * q_wrapper = (query_wrapper_t *) query->data;
+    uint8_t async_more = 0;
+    siridb_series_t * series;
+    size_t index_end = q_wrapper->slist_index + MAX_ITERATE_COUNT;
+
+    if (index_end >= q_wrapper->slist->len)
+    {
+        index_end = q_wrapper->slist->len;
+    }
+    else
+    {
+        async_more = 1;
+    }
+
+    for (; q_wrapper->slist_index < index_end; q_wrapper->slist_index++)
+    {
+        series = (siridb_series_t *)
+                q_wrapper->slist->data[q_wrapper->slist_index];
+
+        if (!siridb_re_exec(q_wrapper->re, series->name, series->name_len))
+        {
+            /* on failure a signal is raised */
+            roaring_add(q_wrapper->series_tmp, series->id);
+        }
+
+        siridb_series_decref(series);
+    }
+
+    if (async_more)
+    {
+        uv_async_send(handle);
     }
     else
     {
         /* free the s-list object and reset index */
         slist_free(q_wrapper->slist);
 
-        free(q_wrapper->regex);
-        free(q_wrapper->regex_extra);
-
-        q_wrapper->regex = NULL;
-        q_wrapper->regex_extra = NULL;
+        siridb_re_decref(q_wrapper->re);
+        q_wrapper->re = NULL;
 
         q_wrapper->slist = NULL;
         q_wrapper->slist_index = 0;
 
         if (q_wrapper->update_cb != NULL)
         {
+            /* on failure a signal is raised */
             (*q_wrapper->update_cb)(
                     q_wrapper->series_map,
-                    q_wrapper->series_tmp,
-                    (imap_free_cb) &siridb__series_decref);
+                    q_wrapper->series_tmp);
+            roaring_free(q_wrapper->series_tmp);
         }
         q_wrapper->series_tmp = NULL;
 
@@ -4951,7 +5128,7 @@ static void on_select_response(slist_t * promises, uv_async_t * handle)
                                 &qp_len,
                                 &qp_points);
                     }
-                    else
+                    else if (q_select->partial == NULL)
                     {
                         on_select_unpack_merged_points(
                                 &unpacker,
@@ -4961,6 +5138,15 @@ static void on_select_response(slist_t * promises, uv_async_t * handle)
                                 &qp_len,
                                 &qp_points);
                     }
+                    else if (on_select_unpack_partials(
+                                &unpacker,
+                                q_select,
+                                &qp_name,
+                                &qp_points,
+                                query->err_msg))
+                    {
+                        err_count++;
+                    }
 
 
                     /* extract time-it info if needed */
@@ -4979,13 +5165,31 @@ static void on_select_response(slist_t * promises, uv_async_t * handle)
 
     if (q_select->n > MAX_SELECT_POINTS)
     {
-        snprintf(query->err_msg,
-                SIRIDB_MAX_SIZE_ERR_MSG,
-                "Query has reached the maximum number of selected points "
-                "(%u). Please use another time window, an aggregation "
-                "function or select less series to reduce the number of "
-                "points.",
-                MAX_SELECT_POINTS);
+        if (query->flags & SIRIDB_QUERY_FLAG_STREAM)
+        {
+            /*
+             * Only points from this pool are streamed, points from other
+             * pools arrive in one package and are still counted.
+             */
+            snprintf(query->err_msg,
+                    SIRIDB_MAX_SIZE_ERR_MSG,
+                    "Query has reached the maximum number of selected points "
+                    "(%u) received from other pools. In stream mode only "
+                    "points from the pool receiving the query are streamed. "
+                    "Please use another time window, an aggregation function "
+                    "or select less series to reduce the number of points.",
+                    MAX_SELECT_POINTS);
+        }
+        else
+        {
+            snprintf(query->err_msg,
+                    SIRIDB_MAX_SIZE_ERR_MSG,
+                    "Query has reached the maximum number of selected points "
+                    "(%u). Please use another time window, an aggregation "
+                    "function or select less series to reduce the number of "
+                    "points.",
+                    MAX_SELECT_POINTS);
+        }
         siridb_query_send_error(handle, CPROTO_ERR_QUERY);
     }
     else if (err_count)
@@ -5086,24 +5290,134 @@ static void on_update_xxx_response(slist_t * promises, uv_async_t * handle)
     }
 }
 
+/*
+ * Call-back for a lookup version change on the other servers. The version on
+ * this server is only changed when every server has accepted the change.
+ * Servers which did accept are already moving series, so the query must be
+ * repeated to finish the change. These servers simply accept again.
+ */
+static void on_set_lookup_version_response(
+        slist_t * promises,
+        uv_async_t * handle)
+{
+    ON_PROMISES
+
+    sirinet_pkg_t * pkg;
+    sirinet_promise_t * promise;
+    siridb_query_t * query = (siridb_query_t *) handle->data;
+    siridb_t * siridb = ((sirinet_socket_t *) query->client->data)->siridb;
+    cleri_node_t * node = query->nodes->node->children->next->next->node;
+    size_t err_count = 0;
+
+    for (size_t i = 0; i < promises->len; i++)
+    {
+        promise = promises->data[i];
+
+        if (promise == NULL)
+        {
+            err_count++;
+            snprintf(query->err_msg,
+                    SIRIDB_MAX_SIZE_ERR_MSG,
+                    "Lookup version is not changed since at least one server "
+                    "did not accept the change. Please repeat the query to "
+                    "finish the change.");
+        }
+        else
+        {
+            pkg = (sirinet_pkg_t *) promise->data;
+
+            if (pkg == NULL || pkg->tp != BPROTO_RES_QUERY)
+            {
+                err_count++;
+                snprintf(query->err_msg,
+                        SIRIDB_MAX_SIZE_ERR_MSG,
+                        "Lookup version is not changed since '%s' did not "
+                        "accept the change. Please repeat the query to "
+                        "finish the change.",
+                        promise->server->name);
+            }
+
+            /* make sure we free the promise and data */
+            free(promise->data);
+            sirinet_promise_decref(promise);
+        }
+    }
+
+    if (err_count)
+    {
+        siridb_query_send_error(handle, CPROTO_ERR_QUERY);
+    }
+    else if (siridb_is_reindexing(siridb))
+    {
+        snprintf(query->err_msg,
+                SIRIDB_MAX_SIZE_ERR_MSG,
+                "SiriDB cannot change the lookup version on '%s' because the "
+                "database is currently re-indexing. Please repeat the query "
+                "to finish the change.",
+                siridb->server->name);
+        siridb_query_send_error(handle, CPROTO_ERR_POOL);
+    }
+    else
+    {
+        set_lookup_version(
+                handle,
+                (uint8_t) strx_to_uint64(node->str, node->len));
+    }
+}
+
 /******************************************************************************
  * Helper functions
  *****************************************************************************/
 
 
+/*
+ * Change the lookup version on this server and start moving series to their
+ * new pool. Nothing is changed when the version is already in use.
+ */
+static void set_lookup_version(uv_async_t * handle, uint8_t version)
+{
+    siridb_query_t * query = (siridb_query_t *) handle->data;
+    siridb_t * siridb = ((sirinet_socket_t *) query->client->data)->siridb;
+    uint8_t old = siridb->lookup_version;
+
+    if (old != version && siridb_reindex_lookup(siridb, version))
+    {
+        MEM_ERR_RET  /* signal is raised */
+    }
+
+    QP_ADD_SUCCESS
+
+    qp_add_fmt_safe(
+            query->packer,
+            MSG_SUCCES_SET_LOOKUP_VERSION,
+            old,
+            siridb->lookup_version);
+
+    SIRIPARSER_ASYNC_NEXT_NODE
+}
+
 static void master_select_work(uv_work_t * work)
 {
     uv_async_t * handle = (uv_async_t *) work->data;
     siridb_query_t * query = (siridb_query_t *) handle->data;
     query_select_t * q_select = (query_select_t *) query->data;
-    int rc = ct_items(
+    int rc;
+
+    siridb_arena_enter(&query->arena);
+
+    rc = ct_items(
             q_select->result,
             (q_select->merge_as == NULL) ?
                     (ct_item_cb) &items_select_master
                     :
-                    (ct_item_cb) &items_select_master_merge,
+            (q_select->partial == NULL) ?
+                    (ct_item_cb) &items_select_master_merge
+                    :
+                    (ct_item_cb) &items_select_master_partials,
             handle);
 
+    siridb_arena_leave();
+
     switch (rc)
     {
     case -1:
@@ -5201,26 +5515,11 @@ static int items_select_master_merge(
 
     if (q_select->mlist != NULL && points != NULL)
     {
-        siridb_points_t * aggr_points;
-        for (size_t i = 0; points->len && i < q_select->mlist->len; i++)
-        {
-            aggr_points = siridb_aggregate_run(
-                    points,
-                    (siridb_aggr_t *) q_select->mlist->data[i],
-                    query->err_msg);
-
-            if (aggr_points != points)
-            {
-                siridb_points_free(points);
-            }
-
-            if (aggr_points == NULL)
-            {
-                return -1;  // (error message is set)
-            }
-
-            points = aggr_points;
-        }
+        /* the points are destroyed when aggregated (error message is set) */
+        points = siridb_aggregate_list_run(
+                points,
+                q_select->mlist,
+                query->err_msg);
     }
 
     if (points == NULL)
@@ -5277,6 +5576,63 @@ int items_select_other_merge(
     return rc;
 }
 
+/*
+ * Partial results are finished on the master. The first aggregate of the
+ * merge list is calculated from the merged partial results and the other
+ * aggregates of the merge list run on the result.
+ */
+static int items_select_master_partials(
+        const char * name,
+        siridb_partials_t * partials,
+        uv_async_t * handle)
+{
+    siridb_query_t * query = (siridb_query_t *) handle->data;
+    query_select_t * q_select = (query_select_t *) query->data;
+    siridb_points_t * points;
+
+    if (qp_add_string(query->packer, name))
+    {
+        sprintf(query->err_msg, "Memory allocation error.");
+        return -1;
+    }
+
+    points = siridb_aggregate_partials_run(
+            partials,
+            q_select->mlist,
+            query->err_msg);
+
+    if (points == NULL)
+    {
+        return -1;  /* error message is set */
+    }
+
+    if (siridb_points_pack(points, query->packer))
+    {
+        sprintf(query->err_msg, "Memory allocation error.");
+        siridb_points_free(points);
+        return -1;
+    }
+
+    siridb_points_free(points);
+
+    return 0;
+}
+
+/*
+ * Pools send the partial results instead of the points, this is one state
+ * for each window instead of all points for each series.
+ */
+static int items_select_other_partials(
+        const char * name,
+        siridb_partials_t * partials,
+        uv_async_t * handle)
+{
+    siridb_query_t * query = (siridb_query_t *) handle->data;
+
+    return (qp_add_string_term(query->packer, name) ||
+            siridb_partials_pack(partials, query->packer));
+}
+
 static void on_select_unpack_points(
         qp_unpacker_t * unpacker,
         query_select_t * q_select,
@@ -5379,6 +5735,53 @@ static void on_select_unpack_merged_points(
     }
 }
 
+/*
+ * Merge the partial results from a pool with the partial results in the
+ * result.
+ *
+ * Returns 0 if successful or -1 in case of an error, in which case err_msg
+ * is set.
+ */
+static int on_select_unpack_partials(
+        qp_unpacker_t * unpacker,
+        query_select_t * q_select,
+        qp_obj_t * qp_name,
+        qp_obj_t * qp_partials,
+        char * err_msg)
+{
+    siridb_partials_t * partials;
+
+    while ( qp_is_raw(qp_next(unpacker, qp_name)) &&
+#ifdef DEBUG
+            qp_is_raw_term(qp_name) &&
+#endif
+            qp_is_raw(qp_next(unpacker, qp_partials)))
+    {
+        partials = (siridb_partials_t *) ct_get(
+                q_select->result,
+                qp_name->via.raw);
+
+        if (partials == NULL)
+        {
+            log_error("Received partial aggregates for unknown name: '%s'",
+                    qp_name->via.raw);
+            sprintf(err_msg, "Received partial aggregates for unknown name.");
+            return -1;
+        }
+
+        if (siridb_partials_merge_packed(
+                partials,
+                qp_partials->via.raw,
+                qp_partials->len,
+                err_msg))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 static int values_list_groups(siridb_group_t * group, uv_async_t * handle)
 {
     siridb_query_t * query = (siridb_query_t *) handle->data;
@@ -5468,3 +5871,410 @@ static void finish_count_groups(uv_async_t * handle)
 
     SIRIPARSER_ASYNC_NEXT_NODE
 }
+
+/*
+ * Add points for a series to the select result. When the result is streamed
+ * and not merged, the points are added to the next chunk package instead.
+ * The points are destroyed, except when added to the result.
+ *
+ * Returns 0 if successful or -1 in case of an error, in which case
+ * query->err_msg is set.
+ */
+static int select_add_points(
+        siridb_query_t * query,
+        siridb_series_t * series,
+        siridb_points_t * points)
+{
+    query_select_t * q_select = (query_select_t *) query->data;
+    char * err_msg = query->err_msg;
+    const char * name;
+
+    if ((query->flags & SIRIDB_QUERY_FLAG_STREAM) && q_select->merge_as == NULL)
+    {
+        /* streamed points are not counted for the maximum */
+        if (q_select->chunk == NULL)
+        {
+            q_select->chunk = sirinet_packer_new(QP_SUGGESTED_SIZE);
+            if (q_select->chunk == NULL ||
+                qp_add_type(q_select->chunk, QP_MAP_OPEN))
+            {
+                sprintf(err_msg, "Memory allocation error.");
+                siridb_points_free(points);
+                return -1;
+            }
+        }
+
+        name = siridb_presuf_name(
+                q_select->presuf,
+                series->name,
+                series->name_len);
+
+        if (    name == NULL ||
+                qp_add_string(q_select->chunk, name) ||
+                siridb_points_pack(points, q_select->chunk))
+        {
+            sprintf(err_msg, "Error adding points to chunk.");
+            siridb_points_free(points);
+            return -1;
+        }
+
+        q_select->chunk_n += points->len;
+        siridb_points_free(points);
+
+        if (q_select->chunk_n >= SELECT_STREAM_CHUNK_POINTS &&
+            select_stream_flush(query))
+        {
+            return -1;  /* error message is set */
+        }
+
+        return 0;
+    }
+
+    if (q_select->partial != NULL)
+    {
+        siridb_partials_t * partials;
+        int rc;
+
+        /* the points are added to the partial results and are not counted */
+        name = siridb_presuf_name(
+                q_select->presuf,
+                q_select->merge_as,
+                strlen(q_select->merge_as));
+
+        partials = (name == NULL) ?
+                NULL : (siridb_partials_t *) ct_get(q_select->result, name);
+
+        if (partials == NULL)
+        {
+            sprintf(err_msg, "Error adding points to partial aggregates.");
+            siridb_points_free(points);
+            log_critical("Critical error adding points");
+            return -1;
+        }
+
+        rc = siridb_partials_add_points(partials, points, err_msg);
+
+        siridb_points_free(points);
+
+        return rc;
+    }
+
+    q_select->n += points->len;
+
+    if (q_select->merge_as == NULL)
+    {
+        name = siridb_presuf_name(
+                q_select->presuf,
+                series->name,
+                series->name_len);
+
+        if (name == NULL || ct_add(q_select->result, name, points))
+        {
+            sprintf(err_msg, "Error adding points to map.");
+            siridb_points_free(points);
+            log_critical("Critical error adding points");
+            return -1;
+        }
+    }
+    else
+    {
+        slist_t ** plist;
+
+        name = siridb_presuf_name(
+                q_select->presuf,
+                q_select->merge_as,
+                strlen(q_select->merge_as));
+
+        plist = (slist_t **) ct_getaddr(q_select->result, name);
+
+        if (    name == NULL ||
+                plist == NULL ||
+                slist_append_safe(plist, points))
+        {
+            sprintf(err_msg, "Error adding points to map.");
+            siridb_points_free(points);
+            log_critical("Critical error adding points");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Returns 0 when the query is below the maximum number of selected points
+ * or -1 when the maximum is reached, in which case query->err_msg is set.
+ */
+static int select_check_max_points(siridb_query_t * query)
+{
+    query_select_t * q_select = (query_select_t *) query->data;
+
+    if (q_select->n > MAX_SELECT_POINTS)
+    {
+        snprintf(query->err_msg,
+                SIRIDB_MAX_SIZE_ERR_MSG,
+                "Query has reached the maximum number of selected points "
+                "(%u). Please use another time window, an aggregation "
+                "function or select less series to reduce the number of "
+                "points.",
+                MAX_SELECT_POINTS);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Queue jobs for the next series in the series list, at most
+ * max_query_parallelism. The series list index is updated so the jobs now
+ * own a reference to their series.
+ *
+ * Returns the jobs or NULL in case of an allocation error.
+ * (a signal is raised in case of an allocation error)
+ */
+static query_select_jobs_t * select_jobs_start(uv_async_t * handle)
+{
+    siridb_query_t * query = (siridb_query_t *) handle->data;
+    query_select_t * q_select = (query_select_t *) query->data;
+    query_select_jobs_t * jobs;
+    select_job_t * job;
+    size_t n = q_select->slist->len - q_select->slist_index;
+
+    if (n > siri.cfg->max_query_parallelism)
+    {
+        n = siri.cfg->max_query_parallelism;
+    }
+
+    jobs = (query_select_jobs_t *) malloc(
+            sizeof(query_select_jobs_t) + n * sizeof(select_job_t));
+    if (jobs == NULL)
+    {
+        ERR_ALLOC
+        return NULL;
+    }
+
+    uv_mutex_init(&jobs->mutex);
+    jobs->pending = n;
+    jobs->n = n;
+    jobs->handle = handle;
+    jobs->siridb = ((sirinet_socket_t *) query->client->data)->siridb;
+    jobs->q_select = q_select;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        job = jobs->job + i;
+        job->job.cb = (siri_qpool_cb) select_jobs_work;
+        job->jobs = jobs;
+        job->series = (siridb_series_t *)
+                q_select->slist->data[q_select->slist_index++];
+        job->points = NULL;
+        job->failed = 0;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        siri_qpool_queue((siri_qpool_job_t *) (jobs->job + i));
+    }
+
+    return jobs;
+}
+
+/*
+ * Runs on a query worker thread. Points are read while holding only the
+ * series stripe, the aggregation runs without a lock. The last finished job
+ * wakes the query.
+ */
+static void select_jobs_work(select_job_t * job)
+{
+    query_select_jobs_t * jobs = job->jobs;
+    query_select_t * q_select = jobs->q_select;
+    siridb_t * siridb = jobs->siridb;
+    siridb_series_t * series = job->series;
+    siridb_query_t * query = (siridb_query_t *) jobs->handle->data;
+    siridb_points_t * points;
+    size_t pending;
+
+    siridb_arena_enter(&query->arena);
+
+    uv_mutex_lock(siridb_series_stripe(siridb, series));
+
+    points = (series->flags & SIRIDB_SERIES_IS_DROPPED) ?
+            NULL : siridb_series_get_points(
+                    series,
+                    q_select->start_ts,
+                    q_select->end_ts);
+
+    uv_mutex_unlock(siridb_series_stripe(siridb, series));
+
+    if (points != NULL)
+    {
+        job->points = siridb_aggregate_list_run(
+                points,
+                q_select->alist,
+                job->err_msg);
+        job->failed = job->points == NULL;
+    }
+
+    siridb_arena_leave();
+
+    uv_mutex_lock(&jobs->mutex);
+    pending = --jobs->pending;
+    uv_mutex_unlock(&jobs->mutex);
+
+    /* the jobs may be destroyed once the last job has woken the query */
+    if (!pending)
+    {
+        uv_async_send(jobs->handle);
+    }
+}
+
+/*
+ * Add the points of finished jobs to the select result, in the order of the
+ * series list, and destroy the jobs. The series references are decremented
+ * here since this must be done on the main thread.
+ *
+ * Returns 0 if successful or -1 in case of an error, in which case
+ * query->err_msg is set.
+ */
+static int select_jobs_finish(query_select_jobs_t * jobs)
+{
+    siridb_query_t * query = (siridb_query_t *) jobs->handle->data;
+    char * err_msg = query->err_msg;
+    select_job_t * job;
+    int rc = 0;
+
+    for (size_t i = 0; i < jobs->n; i++)
+    {
+        job = jobs->job + i;
+
+        if (rc == 0 && job->failed)
+        {
+            memcpy(err_msg, job->err_msg, SIRIDB_MAX_SIZE_ERR_MSG);
+            rc = -1;
+        }
+        else if (job->points != NULL)
+        {
+            if (rc == 0)
+            {
+                rc = select_add_points(query, job->series, job->points);
+            }
+            else
+            {
+                siridb_points_free(job->points);
+            }
+        }
+
+        siridb_series_decref(job->series);
+    }
+
+    uv_mutex_destroy(&jobs->mutex);
+    free(jobs);
+
+    return rc;
+}
+
+/*
+ * Send the points in the current chunk to the client. Does nothing when the
+ * chunk is empty.
+ *
+ * Returns 0 if successful or -1 in case of an error, in which case the
+ * error message of the query is set.
+ * (a signal is raised in case of an allocation error)
+ */
+static int select_stream_flush(siridb_query_t * query)
+{
+    query_select_t * q_select = (query_select_t *) query->data;
+    sirinet_pkg_t * pkg;
+
+    if (q_select->chunk == NULL)
+    {
+        return 0;
+    }
+
+    if (select_stream_lost(query))
+    {
+        qp_packer_free(q_select->chunk);
+        q_select->chunk = NULL;
+        q_select->chunk_n = 0;
+        sprintf(query->err_msg, SELECT_STREAM_LOST_MSG);
+        return -1;
+    }
+
+    pkg = sirinet_packer2pkg(
+            q_select->chunk,
+            query->pid,
+            CPROTO_RES_QUERY_CHUNK);
+
+    q_select->chunk = NULL;
+    q_select->chunk_n = 0;
+
+    if (sirinet_pkg_send((uv_stream_t *) query->client, pkg))
+    {
+        sprintf(query->err_msg, "Error sending a chunk of the query result.");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Returns 1 when the client has not yet received enough of the streamed
+ * chunks, in which case the handle is woken again after a short wait, 0
+ * when the query can continue or -1 when the connection to the client is
+ * lost, in which case the error message of the query is set. This way no
+ * more than about SELECT_STREAM_MAX_QUEUE bytes are waiting to be written
+ * for a slow client and a query stops when the client is gone.
+ *
+ * The timer holds a reference to the handle and is closed by the call-back.
+ */
+static int select_stream_wait(uv_async_t * handle)
+{
+    siridb_query_t * query = (siridb_query_t *) handle->data;
+    uv_timer_t * timer;
+
+    if (!(query->flags & SIRIDB_QUERY_FLAG_STREAM))
+    {
+        return 0;
+    }
+
+    if (select_stream_lost(query))
+    {
+        sprintf(query->err_msg, SELECT_STREAM_LOST_MSG);
+        return -1;
+    }
+
+    if (query->client->write_queue_size < SELECT_STREAM_MAX_QUEUE)
+    {
+        return 0;
+    }
+
+    timer = (uv_timer_t *) malloc(sizeof(uv_timer_t));
+    if (timer == NULL)
+    {
+        /* not critical, just continue without waiting */
+        return 0;
+    }
+
+    /* increment reference since handle will be bound to a timer */
+    siri_async_incref(handle);
+
+    uv_timer_init(siri.loop, timer);
+    timer->data = handle;
+    uv_timer_start(timer, select_stream_wake, SELECT_STREAM_WAIT, 0);
+
+    return 1;
+}
+
+static void select_stream_wake(uv_timer_t * timer)
+{
+    uv_async_t * handle = (uv_async_t *) timer->data;
+
+    uv_close((uv_handle_t *) timer, (uv_close_cb) free);
+
+    if (!uv_is_closing((uv_handle_t *) handle))
+    {
+        uv_async_send(handle);
+    }
+
+    siri_async_decref(&handle);
+}
@@ -29,22 +29,17 @@ q->slist_index = 0;                 \
 q->pmap = NULL;                     \
 q->update_cb = NULL;                \
 q->where_expr = NULL;               \
-q->regex = NULL;                    \
-q->regex_extra = NULL;
+q->re = NULL;
 
 
 #define QUERIES_FREE(q, handle)                                 \
-if (q->series_map != NULL)                                      \
+if (q->series_tmp != NULL && q->series_tmp != q->series_map)   \
 {                                                               \
-    imap_free(                                                  \
-            q->series_map,                                      \
-            (imap_free_cb) &siridb__series_decref);             \
+    roaring_free(q->series_tmp);                                \
 }                                                               \
-if (q->series_tmp != NULL)                                      \
+if (q->series_map != NULL)                                      \
 {                                                               \
-    imap_free(                                                  \
-            q->series_tmp,                                      \
-            (imap_free_cb) &siridb__series_decref);             \
+    roaring_free(q->series_map);                                \
 }                                                               \
 if (q->slist != NULL)                                           \
 {                                                               \
@@ -64,8 +59,10 @@ if (q->pmap != NULL)                                            \
 {                                                               \
     imap_free(q->pmap, NULL);                                   \
 }                                                               \
-free(q->regex);                                                 \
-free(q->regex_extra);                                           \
+if (q->re != NULL)                                              \
+{                                                               \
+    siridb_re_decref(q->re);                                    \
+}                                                               \
 free(q);                                                        \
 siridb_query_free(handle);
 
@@ -93,6 +90,10 @@ query_select_t * query_select_new(void)
         q_select->points_map = NULL;
         q_select->alist = NULL;
         q_select->mlist = NULL;
+        q_select->partial = NULL;
+        q_select->jobs = NULL;
+        q_select->chunk = NULL;
+        q_select->chunk_n = 0;
         q_select->result = ct_new();  // a signal is raised in case of failure
         if (q_select->result == NULL)
         {
@@ -272,6 +273,10 @@ void query_select_free(uv_handle_t * handle)
         {
             ct_free(q_select->result, (ct_free_cb) &siridb_points_free);
         }
+        else if (q_select->partial != NULL)
+        {
+            ct_free(q_select->result, (ct_free_cb) &siridb_partials_free);
+        }
         else
         {
             ct_free(q_select->result, (ct_free_cb) &QUERIES_free_merge_result);
@@ -280,6 +285,11 @@ void query_select_free(uv_handle_t * handle)
 
     free(q_select->merge_as);
 
+    if (q_select->chunk != NULL)
+    {
+        qp_packer_free(q_select->chunk);
+    }
+
     if (q_select->alist != NULL)
     {
         siridb_aggregate_list_free(q_select->alist);
@@ -0,0 +1,266 @@
+/*
+ * qpool.c - Worker threads for running parts of a query.
+ *
+ * author       : agent
+ * email        : agent@local
+ * copyright    : 2026, Transceptor Technology
+ *
+ * changes
+ *  - initial version, 18-10-2026
+ *
+ * Info qpool->mutex:
+ *
+ *  The pool mutex protects 'pending' and 'stop' and is used for the
+ *  condition on which idle workers wait. A worker mutex only protects the
+ *  job queue of that worker. Both may be locked at the same time but only in
+ *  the order pool mutex -> worker mutex.
+ */
+#include <logger/logger.h>
+#include <siri/cfg/cfg.h>
+#include <siri/err.h>
+#include <siri/qpool.h>
+#include <siri/siri.h>
+#include <stdlib.h>
+
+static void QPOOL_work(siri_qpool_worker_t * worker);
+static siri_qpool_job_t * QPOOL_pop(siri_qpool_worker_t * worker);
+
+/*
+ * Start the worker threads and bind siri.qpool. When query_threads is 0
+ * (zero), no threads are started and siri.qpool remains NULL.
+ *
+ * Returns 0 if successful or -1 in case of an error.
+ * (a SIGNAL might be raised)
+ */
+int siri_qpool_init(siri_t * siri)
+{
+    siri_qpool_t * qpool;
+    siri_qpool_worker_t * worker;
+    size_t n = siri->cfg->query_threads;
+
+    if (!n)
+    {
+        return 0;
+    }
+
+    qpool = (siri_qpool_t *) malloc(sizeof(siri_qpool_t));
+    if (qpool == NULL)
+    {
+        ERR_ALLOC
+        return -1;
+    }
+
+    qpool->workers = (siri_qpool_worker_t *)
+            malloc(sizeof(siri_qpool_worker_t) * n);
+    if (qpool->workers == NULL)
+    {
+        ERR_ALLOC
+        free(qpool);
+        return -1;
+    }
+
+    qpool->n = 0;
+    qpool->next = 0;
+    qpool->pending = 0;
+    qpool->stop = 0;
+
+    uv_mutex_init(&qpool->mutex);
+    uv_cond_init(&qpool->cond);
+
+    /* the worker threads use siri.qpool so bind the pool before starting */
+    siri->qpool = qpool;
+
+    /*
+     * Workers are only counted when started and jobs are only queued on
+     * counted workers. A worker which is started may steal from a worker
+     * which is not counted yet but that queue is still empty.
+     */
+    for (; qpool->n < n;)
+    {
+        worker = qpool->workers + qpool->n;
+        worker->first = NULL;
+        worker->last = NULL;
+
+        uv_mutex_init(&worker->mutex);
+
+        if (uv_thread_create(
+                &worker->thread,
+                (uv_thread_cb) QPOOL_work,
+                worker))
+        {
+            uv_mutex_destroy(&worker->mutex);
+            break;
+        }
+
+        uv_mutex_lock(&qpool->mutex);
+        qpool->n++;
+        uv_mutex_unlock(&qpool->mutex);
+    }
+
+    if (!qpool->n)
+    {
+        log_critical("Cannot start query worker threads");
+        siri->qpool = NULL;
+        uv_cond_destroy(&qpool->cond);
+        uv_mutex_destroy(&qpool->mutex);
+        free(qpool->workers);
+        free(qpool);
+        return -1;
+    }
+
+    if (qpool->n < n)
+    {
+        log_warning(
+                "Only %zu of %zu query worker threads are started",
+                qpool->n,
+                n);
+    }
+
+    return 0;
+}
+
+/*
+ * Stop and join the worker threads. Jobs which are already queued will
+ * still be handled before the threads stop.
+ */
+void siri_qpool_destroy(siri_t * siri)
+{
+    siri_qpool_t * qpool = siri->qpool;
+
+    if (qpool == NULL)
+    {
+        return;
+    }
+
+    uv_mutex_lock(&qpool->mutex);
+    qpool->stop = 1;
+    uv_cond_broadcast(&qpool->cond);
+    uv_mutex_unlock(&qpool->mutex);
+
+    for (size_t i = 0; i < qpool->n; i++)
+    {
+        uv_thread_join(&qpool->workers[i].thread);
+        uv_mutex_destroy(&qpool->workers[i].mutex);
+    }
+
+    siri->qpool = NULL;
+
+    uv_cond_destroy(&qpool->cond);
+    uv_mutex_destroy(&qpool->mutex);
+    free(qpool->workers);
+    free(qpool);
+}
+
+/*
+ * Queue a job. This function should only be called from the main thread and
+ * requires siri.qpool to be set.
+ */
+void siri_qpool_queue(siri_qpool_job_t * job)
+{
+    siri_qpool_t * qpool = siri.qpool;
+    siri_qpool_worker_t * worker = qpool->workers + qpool->next;
+
+    if (++qpool->next == qpool->n)
+    {
+        qpool->next = 0;
+    }
+
+    job->next = NULL;
+
+    /*
+     * The pending counter is updated before the job can be taken so it
+     * never drops below zero.
+     */
+    uv_mutex_lock(&qpool->mutex);
+    qpool->pending++;
+
+    uv_mutex_lock(&worker->mutex);
+    if (worker->last == NULL)
+    {
+        worker->first = job;
+    }
+    else
+    {
+        worker->last->next = job;
+    }
+    worker->last = job;
+    uv_mutex_unlock(&worker->mutex);
+
+    uv_cond_signal(&qpool->cond);
+    uv_mutex_unlock(&qpool->mutex);
+}
+
+/*
+ * Returns the first job from the queue of a worker or NULL when the queue
+ * is empty. The caller should not hold the pool mutex.
+ */
+static siri_qpool_job_t * QPOOL_pop(siri_qpool_worker_t * worker)
+{
+    siri_qpool_job_t * job;
+
+    uv_mutex_lock(&worker->mutex);
+
+    if ((job = worker->first) != NULL &&
+        (worker->first = job->next) == NULL)
+    {
+        worker->last = NULL;
+    }
+
+    uv_mutex_unlock(&worker->mutex);
+
+    return job;
+}
+
+/*
+ * Worker thread. A worker first handles the jobs in its own queue and then
+ * steals jobs from the other workers, starting with its neighbour. Note that
+ * 'job->next' may not be used once the call-back is called since the job
+ * might be destroyed by the call-back.
+ */
+static void QPOOL_work(siri_qpool_worker_t * worker)
+{
+    siri_qpool_t * qpool = siri.qpool;
+    size_t idx = worker - qpool->workers;
+    siri_qpool_job_t * job;
+    size_t n;
+
+    while (1)
+    {
+        uv_mutex_lock(&qpool->mutex);
+
+        while (!qpool->pending && !qpool->stop)
+        {
+            uv_cond_wait(&qpool->cond, &qpool->mutex);
+        }
+
+        if (!qpool->pending)
+        {
+            /* stop is set and no jobs are left */
+            uv_mutex_unlock(&qpool->mutex);
+            break;
+        }
+
+        n = qpool->n;
+
+        uv_mutex_unlock(&qpool->mutex);
+
+        job = QPOOL_pop(worker);
+
+        for (size_t i = 1; job == NULL && i < n; i++)
+        {
+            job = QPOOL_pop(qpool->workers + (idx + i) % n);
+        }
+
+        if (job == NULL)
+        {
+            /* another worker took the pending job, just try again */
+            continue;
+        }
+
+        uv_mutex_lock(&qpool->mutex);
+        qpool->pending--;
+        uv_mutex_unlock(&qpool->mutex);
+
+        (*job->cb)(job);
+    }
+}
@@ -7,6 +7,10 @@
  *
  * changes
  *  - initial version, 08-03-2016
+ *  - start and stop the line protocol listeners, 18-10-2026
+ *  - bind the optimize task before loading databases, 18-10-2026
+ *  - close the write-ahead log timer, 18-10-2026
+ *  - start and stop the query worker threads, 18-10-2026
  *
  * Info siri->siridb_mutex:
  *
@@ -27,16 +31,21 @@
 #include <siri/db/groups.h>
 #include <siri/db/pools.h>
 #include <siri/db/props.h>
+#include <siri/db/re.h>
 #include <siri/db/series.h>
 #include <siri/db/server.h>
 #include <siri/db/servers.h>
 #include <siri/db/users.h>
+#include <siri/db/wal.h>
 #include <siri/err.h>
 #include <siri/help/help.h>
+#include <siri/ingest.h>
 #include <siri/net/bserver.h>
 #include <siri/net/clserver.h>
+#include <siri/net/lnserver.h>
 #include <siri/net/socket.h>
 #include <siri/parser/listener.h>
+#include <siri/qpool.h>
 #include <siri/siri.h>
 #include <siri/version.h>
 #include <stddef.h>
@@ -77,6 +86,8 @@ siri_t siri = {
         .siridb_list=NULL,
         .fh=NULL,
         .optimize=NULL,
+        .ingest=NULL,
+        .qpool=NULL,
         .heartbeat=NULL,
         .cfg=NULL,
         .args=NULL,
@@ -146,9 +157,17 @@ int siri_start(void)
     siri.loop = malloc(sizeof(uv_loop_t));
     uv_loop_init(siri.loop);
 
-    /* initialize the back-end-, client- server and load databases */
-    if (    (rc = sirinet_bserver_init(&siri)) ||
+    /* initialize optimize task (bind siri.optimize), this must be done
+     * before loading the databases since a re-index task might resume */
+    siri_optimize_init(&siri);
+
+    /* initialize insert- and query worker threads, the back-end-, client-,
+     * line protocol- server and load databases */
+    if (    (rc = siri_ingest_init(&siri)) ||
+            (rc = siri_qpool_init(&siri)) ||
+            (rc = sirinet_bserver_init(&siri)) ||
             (rc = sirinet_clserver_init(&siri)) ||
+            (rc = sirinet_lnserver_init(&siri)) ||
             (rc = SIRI_load_databases()))
     {
         SIRI_destroy();
@@ -164,9 +183,6 @@ int siri_start(void)
         uv_signal_start(&sig[i], SIRI_signal_handler, signals[i]);
     }
 
-    /* initialize optimize task (bind siri.optimize) */
-    siri_optimize_init(&siri);
-
     /* initialize heart-beat task (bind siri.heartbeat) */
     siri_heartbeat_init(&siri);
 
@@ -208,6 +224,9 @@ void siri_free(void)
     /* free siridb grammar */
     cleri_grammar_free(siri.grammar);
 
+    /* free the cache with compiled regular expressions */
+    siridb_re_cache_free();
+
     /* free event loop */
     free(siri.loop);
 }
@@ -288,6 +307,15 @@ static void SIRI_destroy(void)
             SIRIDB_VERSION,
             SIRIDB_BUILD_DATE);
 #endif
+    /* close the line protocol listeners in case this is not done yet */
+    sirinet_lnserver_stop(&siri);
+
+    /* wait for the insert worker threads to finish */
+    siri_ingest_destroy(&siri);
+
+    /* wait for the query worker threads to finish */
+    siri_qpool_destroy(&siri);
+
     /* stop the event loop */
     uv_stop(siri.loop);
 
@@ -328,6 +356,10 @@ static void SIRI_set_closing_state(void)
         {
             siridb_groups_destroy(siridb->groups);
         }
+        if (siridb->wal != NULL)
+        {
+            siridb_wal_close(siridb);
+        }
         siridb->server->flags &= ~SERVER_FLAG_RUNNING;
         siridb_servers_send_flags(siridb->servers);
 
@@ -405,6 +437,9 @@ static void SIRI_signal_handler(uv_signal_t * req, int signum)
         /* destroy backup (mode) task */
         siri_backup_destroy(&siri);
 
+        /* insert pending line protocol points and close the listeners */
+        sirinet_lnserver_stop(&siri);
+
         /* mark SiriDB as closing and remove ONLINE flag from servers. */
         SIRI_set_closing_state();
 
@@ -14,26 +14,44 @@
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
+#include <limits.h>
+#include <math.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <qpack/qpack.h>
 #include <motd/motd.h>
 #include <cleri/grammar.h>
 #include <cleri/parse.h>
+#include <art/art.h>
 #include <ctree/ctree.h>
 #include <timeit/timeit.h>
+#include <idmap/idmap.h>
 #include <imap/imap.h>
 #include <iso8601/iso8601.h>
+#include <roaring/roaring.h>
 #include <expr/expr.h>
 #include <siri/grammar/grammar.h>
 #include <siri/grammar/gramp.h>
 #include <siri/db/aggregate.h>
+#include <siri/db/arena.h>
 #include <siri/db/db.h>
+#include <siri/db/fifo.h>
+#include <siri/db/pipeline.h>
 #include <siri/db/pools.h>
 #include <siri/db/points.h>
 #include <siri/db/access.h>
 #include <siri/version.h>
+#include <siri/file/handler.h>
+#include <siri/ingest.h>
+#include <siri/siri.h>
 #include <siri/db/lookup.h>
+#include <siri/db/median.h>
+#include <siri/db/re.h>
+#include <siri/db/series.h>
+#include <siri/db/shard.h>
+#include <siri/db/simd.h>
+#include <siri/db/sketch.h>
 #include <strextra/strextra.h>
 
 #define TEST_OK 1
@@ -222,6 +240,106 @@ static int test_ctree(void)
     return test_end(TEST_OK);
 }
 
+static int test__art_order_cb(const char * key, void * data, char * prev)
+{
+    assert (strcmp(prev, key) < 0);
+    assert (strcmp(key, data) == 0);
+    strcpy(prev, key);
+    return 0;
+}
+
+static int test__art_count_cb(const char * key, void * data, size_t * n)
+{
+    (*n)++;
+    return 0;
+}
+
+static int test_art(void)
+{
+    test_start("Testing art");
+    art_t * art = art_new();
+    char keys[2000][64];
+    char prev[64];
+    size_t i, n;
+
+    // same checks as for ctree
+    assert (art_add(art, "Iris", "is gewoon Iris") == ART_OK);
+    assert (art_add(art, "Iris1", "is gewoon Iris1") == ART_OK);
+    assert (art_add(art, "Iris2", "is gewoon Iris2") == ART_OK);
+    assert (art_add(art, "Iris", "Iris?") == ART_EXISTS);
+    assert (strcmp(*art_get_sure(art, "Iris"), "is gewoon Iris") == 0);
+    assert (art_is_empty(*art_get_sure(art, "Sasha")));
+    assert (art->len == 4);
+    assert (art_get(art, "Dummy") == NULL);
+    assert (art_get(art, "Iri") == NULL);
+    assert (strcmp(art_getn(art, "Iris1!", 5), "is gewoon Iris1") == 0);
+    assert (strcmp(art_pop(art, "Iris"), "is gewoon Iris") == 0);
+    assert (strcmp(art_pop(art, "Iris1"), "is gewoon Iris1") == 0);
+    assert (art_pop(art, "Sasha") == ART_EMPTY);
+    assert (art_pop(art, "Sasha") == NULL);
+    assert (strcmp(art_get(art, "Iris2"), "is gewoon Iris2") == 0);
+    assert (art->len == 1);
+    assert (strcmp(art_pop(art, "Iris2"), "is gewoon Iris2") == 0);
+    assert (art->len == 0 && art->root == NULL);
+
+    // enough keys to grow nodes and with prefixes longer than the prefix
+    // which is stored in a node
+    for (i = 0; i < 2000; i++)
+    {
+        sprintf(keys[i], (i % 2) ?
+                "a-very-long-common-prefix.series-%zu" : "series-%zu", i);
+        assert (art_add(art, keys[i], keys[i]) == ART_OK);
+    }
+    assert (art->len == 2000);
+
+    for (i = 0; i < 2000; i++)
+    {
+        assert (art_get(art, keys[i]) == keys[i]);
+    }
+
+    *prev = '\0';
+    assert (art_items(art, (art_item_cb) test__art_order_cb, prev) == 0);
+
+    n = 0;
+    art_items_prefix(art, "series-1", 8, (art_item_cb) test__art_count_cb, &n);
+    assert (n == 555);  // 10-18, 100-198, 1000-1998 (even numbers only)
+
+    n = 0;
+    art_items_prefix(
+            art,
+            "a-very-long",
+            11,
+            (art_item_cb) test__art_count_cb,
+            &n);
+    assert (n == 1000);
+
+    n = 0;
+    art_items_prefix(art, "a-very-x", 8, (art_item_cb) test__art_count_cb, &n);
+    assert (n == 0);
+
+    // remove most keys so nodes will shrink
+    for (i = 0; i < 2000; i++)
+    {
+        if (i % 7)
+        {
+            assert (art_pop(art, keys[i]) == keys[i]);
+        }
+    }
+    assert (art->len == 286);
+
+    for (i = 0; i < 2000; i++)
+    {
+        assert (art_get(art, keys[i]) == ((i % 7) ? NULL : keys[i]));
+    }
+
+    *prev = '\0';
+    assert (art_items(art, (art_item_cb) test__art_order_cb, prev) == 0);
+
+    art_free(art, NULL);
+
+    return test_end(TEST_OK);
+}
+
 static int test__imap_cb(char * data, char * cmp)
 {
     assert (strcmp(data, cmp) == 0);
@@ -449,22 +567,246 @@ static int test_imap_symmetric_difference(void)
     return test_end(TEST_OK);
 }
 
+static int test__idmap_order_cb(uint32_t * data, uint32_t * prev)
+{
+    assert (*data > *prev);
+    *prev = *data;
+    return 1;
+}
+
+static int test_idmap(void)
+{
+    test_start("Testing idmap");
+    idmap_t * idmap = idmap_new();
+    static uint32_t ids[10000];
+    uint32_t prev = 0;
+    uint64_t next = 0;
+    size_t i, n = 0;
+    slist_t * slist;
+
+    for (i = 0; i < 10000; i++)
+    {
+        ids[i] = 1 + i * 3;
+        assert (idmap_add(idmap, ids[i], &ids[i]) == 1);
+    }
+    assert (idmap->len == 10000);
+    assert (idmap_add(idmap, ids[42], &ids[42]) == 0);
+    assert (idmap_get(idmap, 0) == NULL);
+    assert (idmap_get(idmap, 3) == NULL);
+    assert (idmap_get(idmap, 4) == &ids[1]);
+    assert (idmap_get(idmap, UINT32_MAX) == NULL);
+
+    // items are walked in id order
+    assert (idmap_walk(idmap, (idmap_cb) test__idmap_order_cb, &prev) == 10000);
+
+    // walk over all items in batches
+    while ((slist = idmap_slice_ref(idmap, &next, 999)) != NULL && slist->len)
+    {
+        for (i = 0; i < slist->len; i++, n++)
+        {
+            assert (slist->data[i] == &ids[n]);
+            slist_object_decref(slist->data[i]);
+        }
+        slist_free(slist);
+    }
+    slist_free(slist);
+    assert (n == 10000);
+
+    // popping all items from the first chunk should free the chunk
+    for (i = 0; ids[i] < IDMAP_CHUNK_SZ; i++)
+    {
+        assert (idmap_pop(idmap, ids[i]) == &ids[i]);
+    }
+    assert (idmap->chunks[0] == NULL);
+    assert (idmap_pop(idmap, ids[0]) == NULL);
+    assert (idmap->len == 10000 - i);
+
+    prev = 0;
+    assert (idmap_walk(idmap, (idmap_cb) test__idmap_order_cb, &prev) ==
+            (int) idmap->len);
+
+    assert (idmap_add(idmap, UINT32_MAX, &ids[0]) == 1);
+    assert (idmap_get(idmap, UINT32_MAX) == &ids[0]);
+
+    idmap_free(idmap, NULL);
+
+    return test_end(TEST_OK);
+}
+
+static int test__roaring_order_cb(uint32_t id, int64_t * prev)
+{
+    assert ((int64_t) id > *prev);
+    *prev = id;
+    return 0;
+}
+
+static roaring_t * test__roaring_mod(uint32_t mod, uint32_t n)
+{
+    roaring_t * roaring = roaring_new();
+    for (uint32_t id = 0; id < n; id += mod)
+    {
+        assert (roaring_add(roaring, id) == 1);
+    }
+    /* sparse id's, each in a container of its own */
+    assert (roaring_add(roaring, UINT32_MAX - mod) == 1);
+    return roaring;
+}
+
+static void test__roaring_check(
+        roaring_t * roaring,
+        int (*expect)(uint32_t id))
+{
+    size_t len = 0;
+    for (uint32_t id = 0; id < 200000; id++)
+    {
+        assert (roaring_contains(roaring, id) == expect(id));
+        len += expect(id);
+    }
+    len += expect(UINT32_MAX - 3) + expect(UINT32_MAX - 5);
+    assert (roaring_contains(roaring, UINT32_MAX - 3) ==
+            expect(UINT32_MAX - 3));
+    assert (roaring_contains(roaring, UINT32_MAX - 5) ==
+            expect(UINT32_MAX - 5));
+    assert (roaring->len == len);
+}
+
+static int test__roaring_in3(uint32_t id)
+{
+    return (id < 200000) ? id % 3 == 0 : id == UINT32_MAX - 3;
+}
+
+static int test__roaring_in5(uint32_t id)
+{
+    return (id < 200000) ? id % 5 == 0 : id == UINT32_MAX - 5;
+}
+
+static int test__roaring_union(uint32_t id)
+{
+    return test__roaring_in3(id) || test__roaring_in5(id);
+}
+
+static int test__roaring_intersection(uint32_t id)
+{
+    return test__roaring_in3(id) && test__roaring_in5(id);
+}
+
+static int test__roaring_difference(uint32_t id)
+{
+    return test__roaring_in3(id) && !test__roaring_in5(id);
+}
+
+static int test__roaring_symmetric_difference(uint32_t id)
+{
+    return test__roaring_in3(id) != test__roaring_in5(id);
+}
+
+static int test_roaring(void)
+{
+    test_start("Testing roaring");
+    roaring_t * a = test__roaring_mod(3, 200000);
+    roaring_t * b = test__roaring_mod(5, 200000);
+    roaring_t * c;
+    int64_t prev = -1;
+
+    test__roaring_check(a, test__roaring_in3);
+    assert (roaring_add(a, 3) == 0);
+    assert (roaring_walk(a, (roaring_cb) test__roaring_order_cb, &prev) == 0);
+
+    c = roaring_copy(a);
+    assert (roaring_union(c, b) == 0);
+    test__roaring_check(c, test__roaring_union);
+    roaring_free(c);
+
+    c = roaring_copy(a);
+    assert (roaring_intersection(c, b) == 0);
+    test__roaring_check(c, test__roaring_intersection);
+    roaring_free(c);
+
+    c = roaring_copy(a);
+    assert (roaring_difference(c, b) == 0);
+    test__roaring_check(c, test__roaring_difference);
+    roaring_free(c);
+
+    c = roaring_copy(a);
+    assert (roaring_symmetric_difference(c, b) == 0);
+    test__roaring_check(c, test__roaring_symmetric_difference);
+    roaring_free(c);
+
+    /* the other set is never changed */
+    test__roaring_check(b, test__roaring_in5);
+
+    /* removing id's converts a bitset back to an array */
+    for (uint32_t id = 0; id < 200000; id += 3)
+    {
+        assert (roaring_remove(a, id) == 1);
+    }
+    assert (roaring_remove(a, 3) == 0);
+    assert (a->len == 1);
+    assert (a->n == 1);
+
+    roaring_clear(b);
+    assert (b->len == 0);
+    assert (roaring_contains(b, 0) == 0);
+
+    roaring_free(a);
+    roaring_free(b);
+
+    return test_end(TEST_OK);
+}
+
 static int test_gen_pool_lookup(void)
 {
     test_start("Testing test_gen_pool_lookup");
 
-    siridb_lookup_t * lookup = siridb_lookup_new(4);
+    siridb_lookup_t * lookup = siridb_lookup_new(4, SIRIDB_LOOKUP_V0);
     uint16_t match[30] = {
             0, 1, 0, 2, 3, 1, 0, 3, 3, 2, 2, 1, 0, 1, 0,
             2, 3, 1, 0, 3, 3, 2, 2, 1, 0, 1, 0, 2, 3, 1};
 
     for (int i = 0; i < 30; i++)
-        assert(match[i] == (*lookup)[i]);
+        assert(match[i] == lookup->pool[i]);
 
     free(lookup);
     return test_end(TEST_OK);
 }
 
+static int test_pool_lookup_hash(void)
+{
+    test_start("Testing pool lookup hash");
+
+    siridb_lookup_t * v0 = siridb_lookup_new(4, SIRIDB_LOOKUP_V0);
+    siridb_lookup_t * v1 = siridb_lookup_new(4, SIRIDB_LOOKUP_V1);
+    size_t counters[4] = {0, 0, 0, 0};
+    char name[32];
+    int len;
+
+    /* version 0 ignores the order of characters */
+    assert (siridb_lookup_sn(v0, "host12") == siridb_lookup_sn(v0, "host21"));
+
+    for (int i = 0; i < 4000; i++)
+    {
+        len = sprintf(name, "server%d.cpu.load", i);
+
+        /* a raw name with or without terminator has the same pool */
+        assert (siridb_lookup_sn(v1, name) ==
+                siridb_lookup_sn_raw(v1, name, len));
+        assert (siridb_lookup_sn(v1, name) ==
+                siridb_lookup_sn_raw(v1, name, len + 1));
+
+        counters[siridb_lookup_sn(v1, name)]++;
+    }
+
+    /* each pool should get about 1000 series */
+    for (int i = 0; i < 4; i++)
+    {
+        assert (counters[i] > 900 && counters[i] < 1100);
+    }
+
+    free(v0);
+    free(v1);
+    return test_end(TEST_OK);
+}
+
 static int test_points(void)
 {
     test_start("Testing points");
@@ -492,6 +834,429 @@ static int test_points(void)
     return test_end(TEST_OK);
 }
 
+static int test_points_batch(void)
+{
+    test_start("Testing points batch");
+
+    siridb_points_t * points = siridb_points_new(1000, TP_INT);
+    siridb_point_t pts[400];
+    size_t runs[4] = {0, 300, 300, 600};
+    size_t many[101];
+    size_t i;
+
+    /* large enough for radix sort, timestamps with duplicates */
+    for (i = 0; i < 500; i++)
+    {
+        points->data[i].ts = 1000000000 + (i * 7919) % 250;
+        points->data[i].val.int64 = i;
+    }
+    points->len = 500;
+
+    assert (siridb_points_sort(points) == 0);
+
+    for (i = 1; i < points->len; i++)
+    {
+        assert (points->data[i - 1].ts <= points->data[i].ts);
+        /* sort must be stable */
+        assert (points->data[i - 1].ts < points->data[i].ts ||
+                points->data[i - 1].val.int64 < points->data[i].val.int64);
+    }
+
+    /* append points, merge overlapping and unsorted points */
+    for (i = 0; i < 400; i++)
+    {
+        pts[i].ts = (i < 100) ? 1000000300 + i : 1000000000 + (i * 13) % 400;
+        pts[i].val.int64 = i;
+    }
+
+    assert (siridb_points_add_points(points, pts, 100) == 0);
+    assert (points->len == 600);
+    assert (points->data[599].ts == 1000000399);
+
+    assert (siridb_points_add_points(points, pts + 100, 300) == 0);
+    assert (points->len == 900);
+
+    for (i = 1; i < points->len; i++)
+    {
+        assert (points->data[i - 1].ts <= points->data[i].ts);
+    }
+
+    /* merge three runs, one of them is empty */
+    for (i = 0; i < 600; i++)
+    {
+        points->data[i].ts = (i < 300) ? i * 2 : (i - 300) * 2 + 1;
+        points->data[i].val.int64 = i;
+    }
+    points->len = 600;
+
+    assert (siridb_points_merge_runs(points, runs, 3) == 0);
+
+    for (i = 0; i < points->len; i++)
+    {
+        assert (points->data[i].ts == i);
+    }
+
+    /* more runs than fit in the heap on the stack */
+    for (i = 0; i < 600; i++)
+    {
+        points->data[i].ts = (i % 6) * 100 + i / 6;
+        points->data[i].val.int64 = i;
+    }
+
+    for (i = 0; i <= 100; i++)
+    {
+        many[i] = i * 6;
+    }
+
+    assert (siridb_points_merge_runs(points, many, 100) == 0);
+
+    for (i = 0; i < points->len; i++)
+    {
+        assert (points->data[i].ts == i);
+    }
+
+    siridb_points_free(points);
+
+    return test_end(TEST_OK);
+}
+
+static int test_points_merge(void)
+{
+    test_start("Testing points merge");
+
+    slist_t * plist = slist_new(5);
+    siridb_points_t * points;
+    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
+    double total = 0.0;
+    size_t i, j;
+
+    /* overlapping series with equal timestamps, one empty and one double */
+    for (j = 0; j < 5; j++)
+    {
+        points = siridb_points_new(200, (j == 3) ? TP_DOUBLE : TP_INT);
+        points->len = (j == 2) ? 0 : 200;
+        for (i = 0; i < points->len; i++)
+        {
+            points->data[i].ts = i * (j + 1);
+            if (points->tp == TP_INT)
+            {
+                points->data[i].val.int64 = (int64_t) j;
+            }
+            else
+            {
+                points->data[i].val.real = 0.5;
+            }
+        }
+        slist_append(plist, points);
+    }
+
+    points = siridb_points_merge(plist, err_msg);
+
+    assert (points != NULL && plist->len == 0);
+    assert (points->tp == TP_DOUBLE && points->len == 800);
+    for (i = 0; i < points->len; i++)
+    {
+        assert (!i || points->data[i - 1].ts <= points->data[i].ts);
+        total += points->data[i].val.real;
+    }
+    assert (total == 200 * (0.0 + 1.0 + 0.5 + 4.0));
+
+    siridb_points_free(points);
+
+    /* large enough to be merged in parts by more than one thread */
+    for (j = 0; j < 3; j++)
+    {
+        points = siridb_points_new(400000, TP_INT);
+        points->len = 400000;
+        for (i = 0; i < points->len; i++)
+        {
+            points->data[i].ts = i * 3 + j;
+            points->data[i].val.int64 = (int64_t) j;
+        }
+        slist_append(plist, points);
+    }
+
+    points = siridb_points_merge(plist, err_msg);
+
+    assert (points != NULL && plist->len == 0);
+    assert (points->tp == TP_INT && points->len == 1200000);
+    for (i = 0; i < points->len; i++)
+    {
+        assert (points->data[i].ts == i);
+        assert (points->data[i].val.int64 == (int64_t) (i % 3));
+    }
+
+    siridb_points_free(points);
+
+    /* equal timestamps keep the order in plist after removing empty points */
+    for (j = 0; j < 4; j++)
+    {
+        points = siridb_points_new(3, TP_INT);
+        points->len = (j % 2) ? 3 : 0;
+        for (i = 0; i < points->len; i++)
+        {
+            points->data[i].ts = i;
+            points->data[i].val.int64 = (int64_t) j;
+        }
+        slist_append(plist, points);
+    }
+
+    points = siridb_points_merge(plist, err_msg);
+
+    assert (points != NULL && plist->len == 0 && points->len == 6);
+    for (i = 0; i < points->len; i++)
+    {
+        assert (points->data[i].ts == i / 2);
+        assert (points->data[i].val.int64 == (int64_t) ((i % 2) ? 3 : 1));
+    }
+
+    siridb_points_free(points);
+
+    /* strings and numbers cannot be merged */
+    for (j = 0; j < 2; j++)
+    {
+        points = siridb_points_new(1, (j) ? TP_STRING : TP_INT);
+        points->len = 1;
+        points->data->ts = 1;
+        points->data->val.int64 = 0;
+        slist_append(plist, points);
+    }
+
+    assert (siridb_points_merge(plist, err_msg) == NULL);
+    assert (strcmp(err_msg, "Cannot merge string and number series.") == 0);
+
+    while (plist->len)
+    {
+        siridb_points_free((siridb_points_t *) slist_pop(plist));
+    }
+    slist_free(plist);
+
+    return test_end(TEST_OK);
+}
+
+static int test__series_iter_shard(
+        siridb_shard_t * shard,
+        char * fn,
+        const uint64_t * pts,
+        size_t n)
+{
+    /* shard points are written as (int64) time-stamp, value pairs */
+    int fd = mkstemp(fn);
+    assert (fd != -1);
+    assert (write(fd, pts, n * 2 * sizeof(uint64_t)) ==
+            (ssize_t) (n * 2 * sizeof(uint64_t)));
+    assert (close(fd) == 0);
+
+    memset(shard, 0, sizeof(siridb_shard_t));
+    shard->tp = SIRIDB_SHARD_TP_NUMBER;
+    shard->fn = fn;
+    shard->fp = siri_fp_new();
+    assert (shard->fp != NULL);
+    return 0;
+}
+
+static int test__series_iter_cmp(
+        siridb_series_t * series,
+        uint64_t * start_ts,
+        uint64_t * end_ts,
+        const uint64_t * expect,
+        size_t n)
+{
+    siridb_series_iter_t iter;
+    siridb_points_t chunk;
+    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
+    size_t i = 0;
+    int rc;
+
+    assert (siridb_series_iter_init(&iter, series, start_ts, end_ts) == 0);
+
+    /* each chunk is in order and starts after the previous chunk */
+    while ((rc = siridb_series_iter_next(&iter, &chunk, err_msg)) == 1)
+    {
+        assert (chunk.len && chunk.tp == series->tp);
+        for (size_t j = 0; j < chunk.len; j++, i++)
+        {
+            assert (i < n);
+            assert (chunk.data[j].ts == expect[i * 2]);
+            assert (chunk.data[j].val.int64 == (int64_t) expect[i * 2 + 1]);
+        }
+    }
+
+    assert (rc == 0 && i == n);
+
+    /* the iterator is done */
+    assert (siridb_series_iter_next(&iter, &chunk, err_msg) == 0);
+
+    siridb_series_iter_destroy(&iter);
+
+    return 0;
+}
+
+static int test_series_iter(void)
+{
+    test_start("Testing series iterator");
+
+    char fn_a[] = "/tmp/siridb-test-shard-XXXXXX";
+    char fn_b[] = "/tmp/siridb-test-shard-XXXXXX";
+    siridb_shard_t shard_a, shard_b;
+    siridb_series_t series;
+    siridb_points_t * points;
+    uint64_t start_ts, end_ts;
+
+    /* shard a has two overlapping chunks, shard b a chunk at equal ts */
+    const uint64_t pts_a[] = {
+            10, 1, 20, 2, 30, 3, 40, 4,
+            25, 5, 35, 6, 50, 7};
+    const uint64_t pts_b[] = {
+            40, 8, 60, 9, 70, 10};
+    const uint64_t pts_buffer[] = {
+            70, 11, 80, 12};
+
+    /* equal time-stamps follow the index order and the buffer comes last */
+    const uint64_t expect[] = {
+            10, 1, 20, 2, 25, 5, 30, 3, 35, 6, 40, 4, 40, 8,
+            50, 7, 60, 9, 70, 10, 70, 11, 80, 12};
+
+    idx_t idx[3] = {
+            {.shard=&shard_a, .pos=0, .len=4, .start_ts=10, .end_ts=40},
+            {.shard=&shard_a, .pos=64, .len=3, .start_ts=25, .end_ts=50},
+            {.shard=&shard_b, .pos=0, .len=3, .start_ts=40, .end_ts=70},
+    };
+
+    siri.fh = siri_fh_new(4);
+    assert (siri.fh != NULL);
+
+    test__series_iter_shard(&shard_a, fn_a, pts_a, 7);
+    test__series_iter_shard(&shard_b, fn_b, pts_b, 3);
+
+    memset(&series, 0, sizeof(siridb_series_t));
+    series.tp = TP_INT;
+    series.buffer = siridb_points_new(2, TP_INT);
+    assert (series.buffer != NULL);
+
+    /* empty series */
+    test__series_iter_cmp(&series, NULL, NULL, NULL, 0);
+
+    /* buffer only */
+    for (size_t i = 0; i < 2; i++)
+    {
+        siridb_points_add_point(
+                series.buffer,
+                (uint64_t *) &pts_buffer[i * 2],
+                (qp_via_t *) &pts_buffer[i * 2 + 1]);
+    }
+
+    test__series_iter_cmp(&series, NULL, NULL, expect + 20, 2);
+
+    start_ts = 75;
+    test__series_iter_cmp(&series, &start_ts, NULL, expect + 22, 1);
+
+    end_ts = 70;
+    test__series_iter_cmp(&series, NULL, &end_ts, NULL, 0);
+
+    /* ranges over chunks in more than one shard */
+    series.idx = idx;
+    series.idx_len = 3;
+
+    test__series_iter_cmp(&series, NULL, NULL, expect, 12);
+
+    start_ts = 30;
+    end_ts = 70;
+    test__series_iter_cmp(&series, &start_ts, &end_ts, expect + 6, 6);
+
+    start_ts = 45;
+    test__series_iter_cmp(&series, &start_ts, NULL, expect + 14, 5);
+
+    start_ts = 0;
+    end_ts = 15;
+    test__series_iter_cmp(&series, &start_ts, &end_ts, expect, 1);
+
+    start_ts = 85;
+    test__series_iter_cmp(&series, &start_ts, NULL, NULL, 0);
+
+    /* the iterator is used for reading all points */
+    points = siridb_series_get_points(&series, NULL, NULL);
+    assert (points != NULL && points->len == 12);
+    for (size_t i = 0; i < points->len; i++)
+    {
+        assert (points->data[i].ts == expect[i * 2]);
+        assert (points->data[i].val.int64 == (int64_t) expect[i * 2 + 1]);
+    }
+    siridb_points_free(points);
+
+    siridb_points_free(series.buffer);
+
+    siri_fp_decref(shard_a.fp);
+    siri_fp_decref(shard_b.fp);
+    siri_fh_free(siri.fh);
+    siri.fh = NULL;
+
+    assert (unlink(fn_a) == 0);
+    assert (unlink(fn_b) == 0);
+
+    return test_end(TEST_OK);
+}
+
+static int test_arena(void)
+{
+    test_start("Testing arena");
+
+    siridb_arena_t arena;
+    siridb_points_t * points, * other;
+    char * a, * b, * c;
+    size_t peak;
+
+    assert (siridb_arena_init(&arena) == 0);
+    assert (siridb_arena_peak(&arena) == 0);
+
+    /* small chunks are aligned and the last chunk grows in place */
+    a = (char *) siridb_arena_malloc(&arena, 10);
+    b = (char *) siridb_arena_malloc(&arena, 100);
+    assert (a != NULL && b != NULL);
+    assert (((uintptr_t) a) % 16 == 0 && ((uintptr_t) b) % 16 == 0);
+    memset(b, 'b', 100);
+    assert (siridb_arena_realloc(b, 1000) == b);
+    assert (b[99] == 'b');
+
+    /* not the last chunk, the data is copied */
+    memset(a, 'a', 10);
+    c = (char *) siridb_arena_realloc(a, 200);
+    assert (c != NULL && c != a && c[9] == 'a');
+
+    peak = siridb_arena_peak(&arena);
+    assert (peak >= SIRIDB_ARENA_BLOCK_SZ);
+
+    /* large chunks are released when freed */
+    a = (char *) siridb_arena_malloc(&arena, SIRIDB_ARENA_LARGE_SZ * 4);
+    assert (a != NULL && siridb_arena_peak(&arena) > peak);
+    a = (char *) siridb_arena_realloc(a, SIRIDB_ARENA_LARGE_SZ * 8);
+    assert (a != NULL);
+    peak = siridb_arena_peak(&arena);
+    siridb_arena_free(a);
+    assert (arena.size < peak && siridb_arena_peak(&arena) == peak);
+
+    /* points use the arena of the thread */
+    siridb_arena_enter(&arena);
+    points = siridb_points_new(10, TP_INT);
+    other = siridb_points_new(100000, TP_DOUBLE);
+    siridb_arena_leave();
+
+    assert (points->flags & SIRIDB_POINTS_FLAG_ARENA);
+    assert (other->flags & SIRIDB_POINTS_FLAG_ARENA);
+    assert (siridb_points_resize(points, 20000) == 0);
+    assert (siridb_points_resize(other, 10) == 0);
+    siridb_points_free(points);
+    siridb_points_free(other);
+
+    points = siridb_points_new(10, TP_INT);
+    assert (points->flags == 0);
+    siridb_points_free(points);
+
+    siridb_arena_destroy(&arena);
+
+    return test_end(TEST_OK);
+}
+
 static int test_aggr_count(void)
 {
     test_start("Testing aggregation count");
@@ -666,26 +1431,482 @@ static int test_aggr_median_low(void)
     return test_end(TEST_OK);
 }
 
-static int test_aggr_min(void)
+static int test__median_cmp(const void * a, const void * b)
 {
-    test_start("Testing aggregation min");
+    int64_t va = *((const int64_t *) a);
+    int64_t vb = *((const int64_t *) b);
+    return (va > vb) - (va < vb);
+}
 
-    siridb_aggr_t aggr;
-    siridb_points_t * result;
-    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
-    siridb_points_t * points = prepare_points();
+static int test__sketch_cmp(const void * a, const void * b)
+{
+    double va = *((const double *) a);
+    double vb = *((const double *) b);
+    return (va > vb) - (va < vb);
+}
 
-    aggr.gid = CLERI_GID_F_MIN;
-    aggr.group_by = 2;
-    aggr.limit = 0;
-    aggr.offset = 0;
+static int test_median_select(void)
+{
+    test_start("Testing median select");
 
-    result = siridb_aggregate_run(points, &aggr, err_msg);
+    static const size_t sizes[4] = {2, 17, 1000, 5001};
+    siridb_points_t * points;
+    siridb_point_t point;
+    int64_t sorted[5001];
+    uint64_t ts;
+    qp_via_t val;
+    size_t len, k;
 
-    assert (result != NULL);
-    assert (result->len == 9);
-    assert (result->tp == TP_INT);
-    assert (result->data->ts == 4 && result->data->val.int64 == 1);
+    /* random, sorted, reversed, equal, few values and organ pipe */
+    for (int d = 0; d < 6; d++)
+    {
+        for (int s = 0; s < 4; s++)
+        {
+            len = sizes[s];
+            points = siridb_points_new(len, TP_INT);
+            for (size_t i = 0; i < len; i++)
+            {
+                ts = i;
+                switch (d)
+                {
+                case 0: val.int64 = (int64_t) ((i * 7919) % 1009); break;
+                case 1: val.int64 = i; break;
+                case 2: val.int64 = len - i; break;
+                case 3: val.int64 = 42; break;
+                case 4: val.int64 = i % 3; break;
+                default: val.int64 = (i < len / 2) ? i : len - i; break;
+                }
+                sorted[i] = val.int64;
+                siridb_points_add_point(points, &ts, &val);
+            }
+
+            qsort(sorted, len, sizeof(int64_t), test__median_cmp);
+
+            for (int t = 0; t < 5; t++)
+            {
+                k = (t == 4) ? len - 1 : len * t / 4;
+                assert (siridb_median_find_n(&point, points, k) == 0);
+                assert (point.val.int64 == sorted[k]);
+            }
+
+            assert (siridb_median_real(&point, points, 0.5) == 0);
+            assert (point.val.real == ((double) sorted[len / 2 - 1] +
+                    (double) sorted[len / 2]) / 2.0);
+
+            /* points are not changed */
+            assert (points->data[len - 1].val.int64 ==
+                    ((d == 0) ? (int64_t) (((len - 1) * 7919) % 1009) :
+                     (d == 1) ? (int64_t) len - 1 :
+                     (d == 2) ? 1 :
+                     (d == 3) ? 42 :
+                     (d == 4) ? (int64_t) ((len - 1) % 3) : 1));
+
+            /* the same values as doubles */
+            points->tp = TP_DOUBLE;
+            for (size_t i = 0; i < len; i++)
+            {
+                points->data[i].val.real = (double) sorted[len - 1 - i];
+            }
+
+            assert (siridb_median_find_n(&point, points, len / 2) == 0);
+            assert (point.val.real == (double) sorted[len / 2]);
+
+            siridb_points_free(points);
+        }
+    }
+
+    return test_end(TEST_OK);
+}
+
+static int test_median_nan(void)
+{
+    test_start("Testing median with NaN");
+
+    static const double values[5] = {832.0, NAN, 1.0, 900.0, 5.0};
+    siridb_points_t * points;
+    siridb_point_t point;
+    double sorted[1000];
+    uint64_t ts;
+    qp_via_t val;
+    size_t len = 1000, m;
+
+    /* a NaN is greater than all numbers, at each position */
+    for (size_t r = 0; r < 5; r++)
+    {
+        points = siridb_points_new(5, TP_DOUBLE);
+        for (size_t i = 0; i < 5; i++)
+        {
+            ts = i;
+            val.real = values[(i + r) % 5];
+            siridb_points_add_point(points, &ts, &val);
+        }
+
+        assert (siridb_median_find_n(&point, points, 2) == 0);
+        assert (point.val.real == 832.0);
+
+        assert (siridb_median_find_n(&point, points, 3) == 0);
+        assert (point.val.real == 900.0);
+
+        assert (siridb_median_find_n(&point, points, 4) == 0);
+        assert (isnan(point.val.real));
+
+        assert (siridb_median_real(&point, points, 0.5) == 0);
+        assert (point.val.real == (5.0 + 832.0) / 2.0);
+
+        siridb_points_free(points);
+    }
+
+    /* more values than are sorted, every third value is NaN */
+    for (size_t offset = 0; offset < 3; offset++)
+    {
+        points = siridb_points_new(len, TP_DOUBLE);
+        for (size_t i = 0; i < len; i++)
+        {
+            ts = i;
+            val.real = (i % 3 == offset) ?
+                    NAN : (double) ((i * 7919) % 1009);
+            siridb_points_add_point(points, &ts, &val);
+        }
+
+        for (size_t i = m = 0; i < len; i++)
+        {
+            if (!isnan(points->data[i].val.real))
+            {
+                sorted[m++] = points->data[i].val.real;
+            }
+        }
+
+        qsort(sorted, m, sizeof(double), test__sketch_cmp);
+
+        for (size_t k = 0; k < m; k += m / 7)
+        {
+            assert (siridb_median_find_n(&point, points, k) == 0);
+            assert (point.val.real == sorted[k]);
+        }
+
+        assert (siridb_median_find_n(&point, points, m - 1) == 0);
+        assert (point.val.real == sorted[m - 1]);
+
+        assert (siridb_median_find_n(&point, points, m) == 0);
+        assert (isnan(point.val.real));
+
+        assert (siridb_median_find_n(&point, points, len - 1) == 0);
+        assert (isnan(point.val.real));
+
+        assert (siridb_median_real(&point, points, 0.5) == 0);
+        assert (point.val.real ==
+                (sorted[len / 2 - 1] + sorted[len / 2]) / 2.0);
+
+        siridb_points_free(points);
+    }
+
+    return test_end(TEST_OK);
+}
+
+static int test_sketch(void)
+{
+    test_start("Testing sketch");
+
+    static const double quantiles[5] = {0.0, 0.5, 0.95, 0.99, 1.0};
+    siridb_sketch_t all, odd, even;
+    siridb_sketches_t * sketches, * other;
+    siridb_points_t * points, * result, * copy;
+    qp_packer_t * packer;
+    qp_unpacker_t unpacker;
+    qp_obj_t qp_raw;
+    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
+    double sorted[10000], exact, approx;
+    uint64_t ts;
+    qp_via_t val;
+    size_t k;
+
+    siridb_sketch_init(&all);
+    siridb_sketch_init(&odd);
+    siridb_sketch_init(&even);
+
+    /* values are added in a different order than they are sorted */
+    for (size_t i = 0; i < 10000; i++)
+    {
+        val.real = (i < 1000) ? -1.0 * (i % 97) : (double) ((i * 7919) % 9001);
+        sorted[i] = val.real;
+        assert (siridb_sketch_add(&all, val.real) == 0);
+        assert (siridb_sketch_add((i % 2) ? &odd : &even, val.real) == 0);
+    }
+
+    qsort(sorted, 10000, sizeof(double), test__sketch_cmp);
+
+    assert (siridb_sketch_merge(&odd, &even) == 0);
+    assert (odd.count == 10000 && odd.zero == all.zero);
+
+    for (int t = 0; t < 5; t++)
+    {
+        k = (size_t) (quantiles[t] * 9999);
+        exact = sorted[k];
+        approx = siridb_sketch_quantile(&all, quantiles[t]);
+        assert (fabs(approx - exact) <= SIRIDB_SKETCH_ALPHA * fabs(exact));
+
+        /* a merged sketch is the same as a single sketch */
+        assert (siridb_sketch_quantile(&odd, quantiles[t]) == approx);
+    }
+
+    siridb_sketch_destroy(&all);
+    siridb_sketch_destroy(&odd);
+    siridb_sketch_destroy(&even);
+
+    /* window sketches survive packing */
+    points = siridb_points_new(1000, TP_INT);
+    for (size_t i = 0; i < 1000; i++)
+    {
+        ts = i + 1;
+        val.int64 = (int64_t) ((i * 31) % 211);
+        siridb_points_add_point(points, &ts, &val);
+    }
+
+    sketches = siridb_sketches_new(100);
+    assert (siridb_sketches_add_points(sketches, points, err_msg) == 0);
+    assert (sketches->len == 10);
+
+    packer = qp_packer_new(1024);
+    assert (siridb_sketches_pack(sketches, packer) == 0);
+
+    qp_unpacker_init(&unpacker, packer->buffer, packer->len);
+    assert (qp_is_raw(qp_next(&unpacker, &qp_raw)));
+
+    other = siridb_sketches_unpack(qp_raw.via.raw, qp_raw.len, 100);
+    assert (other != NULL && other->len == 10);
+
+    /* invalid data is refused */
+    assert (siridb_sketches_unpack(qp_raw.via.raw, qp_raw.len - 1, 100) ==
+            NULL);
+
+    result = siridb_sketches_quantile(sketches, 0.95);
+    copy = siridb_sketches_quantile(other, 0.95);
+    assert (result->len == 10 && copy->len == 10);
+    for (size_t i = 0; i < 10; i++)
+    {
+        assert (result->data[i].ts == (i + 1) * 100);
+        assert (result->data[i].ts == copy->data[i].ts);
+        assert (result->data[i].val.real == copy->data[i].val.real);
+    }
+    siridb_points_free(copy);
+
+    /* merge the unpacked sketches, each window has twice the values */
+    assert (siridb_sketches_merge(other, sketches) == 0);
+    assert (other->len == 10 && other->windows[0].sketch.count == 200);
+
+    copy = siridb_sketches_quantile(other, 0.95);
+    assert (copy->data[9].val.real == result->data[9].val.real);
+
+    siridb_points_free(copy);
+    siridb_points_free(result);
+    siridb_sketches_free(other);
+    siridb_sketches_free(sketches);
+    qp_packer_free(packer);
+    siridb_points_free(points);
+
+    return test_end(TEST_OK);
+}
+
+static int test_aggr_percentile(void)
+{
+    test_start("Testing aggregation percentile");
+
+    siridb_aggr_t aggr;
+    siridb_points_t * result;
+    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
+    siridb_points_t * points = prepare_points();
+
+    aggr.gid = CLERI_GID_F_PERCENTILE;
+    aggr.group_by = 7;
+    aggr.limit = 0;
+    aggr.offset = 0;
+    aggr.quantile = 1.0;
+
+    result = siridb_aggregate_run(points, &aggr, err_msg);
+
+    assert (result != NULL);
+    assert (result->len == 4);
+    assert (result->tp == TP_DOUBLE);
+    assert (result->data->ts == 7 && result->data->val.real == 3.0);
+    assert ((result->data + 1)->ts == 14 &&
+            (result->data + 1)->val.real == 8.0);
+
+    siridb_points_free(result);
+
+    aggr.gid = CLERI_GID_F_APPROX_MEDIAN;
+    aggr.quantile = 0.5;
+
+    result = siridb_aggregate_run(points, &aggr, err_msg);
+
+    assert (result != NULL);
+    assert (result->len == 4);
+    assert (fabs(result->data->val.real - 1.0) <= SIRIDB_SKETCH_ALPHA);
+    assert (fabs((result->data + 1)->val.real - 3.0) <=
+            3.0 * SIRIDB_SKETCH_ALPHA);
+
+    siridb_points_free(result);
+    siridb_points_free(points);
+
+    return test_end(TEST_OK);
+}
+
+static int test_partials(void)
+{
+    test_start("Testing partials");
+
+    static const uint32_t gids[7] = {
+            CLERI_GID_F_COUNT,
+            CLERI_GID_F_MAX,
+            CLERI_GID_F_MEAN,
+            CLERI_GID_F_MIN,
+            CLERI_GID_F_PVARIANCE,
+            CLERI_GID_F_SUM,
+            CLERI_GID_F_VARIANCE};
+    siridb_aggr_t aggr;
+    siridb_partials_t * partials, * other;
+    siridb_points_t * points, * odd, * even, * reals, * result, * expect;
+    qp_packer_t * packer;
+    qp_unpacker_t unpacker;
+    qp_obj_t qp_raw;
+    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
+    uint64_t ts;
+    qp_via_t val;
+
+    points = siridb_points_new(1000, TP_INT);
+    odd = siridb_points_new(500, TP_INT);
+    even = siridb_points_new(500, TP_INT);
+    reals = siridb_points_new(500, TP_DOUBLE);
+    for (size_t i = 0; i < 1000; i++)
+    {
+        ts = i + 1;
+        val.int64 = (int64_t) ((i * 37) % 101) - 50;
+        siridb_points_add_point(points, &ts, &val);
+        siridb_points_add_point((i % 2) ? odd : even, &ts, &val);
+    }
+    for (size_t i = 0; i < 500; i++)
+    {
+        ts = i * 2 + 1;
+        val.real = 0.25 * (double) ((i * 13) % 17);
+        siridb_points_add_point(reals, &ts, &val);
+    }
+
+    aggr.group_by = 100;
+    aggr.limit = 0;
+    aggr.offset = 0;
+
+    /* merged partial results equal the aggregate on all points */
+    for (int g = 0; g < 7; g++)
+    {
+        aggr.gid = gids[g];
+        assert (siridb_partials_supported(aggr.gid));
+
+        partials = siridb_partials_new(aggr.gid, aggr.group_by, 0.5);
+        other = siridb_partials_new(aggr.gid, aggr.group_by, 0.5);
+        assert (siridb_partials_add_points(partials, odd, err_msg) == 0);
+        assert (siridb_partials_add_points(other, even, err_msg) == 0);
+
+        packer = qp_packer_new(1024);
+        assert (siridb_partials_pack(other, packer) == 0);
+
+        qp_unpacker_init(&unpacker, packer->buffer, packer->len);
+        assert (qp_is_raw(qp_next(&unpacker, &qp_raw)));
+
+        /* invalid data is refused */
+        assert (siridb_partials_merge_packed(
+                partials,
+                qp_raw.via.raw,
+                qp_raw.len - 1,
+                err_msg) == -1);
+
+        assert (siridb_partials_merge_packed(
+                partials,
+                qp_raw.via.raw,
+                qp_raw.len,
+                err_msg) == 0);
+
+        result = siridb_partials_points(partials, err_msg);
+        expect = siridb_aggregate_run(points, &aggr, err_msg);
+
+        assert (result != NULL && expect != NULL);
+        assert (result->len == 10 && result->len == expect->len);
+        assert (result->tp == expect->tp);
+        for (size_t i = 0; i < result->len; i++)
+        {
+            assert (result->data[i].ts == expect->data[i].ts);
+            if (result->tp == TP_INT)
+            {
+                assert (result->data[i].val.int64 ==
+                        expect->data[i].val.int64);
+            }
+            else
+            {
+                assert (fabs(result->data[i].val.real -
+                        expect->data[i].val.real) < 1e-9);
+            }
+        }
+
+        siridb_points_free(result);
+        siridb_points_free(expect);
+        qp_packer_free(packer);
+        siridb_partials_free(other);
+        siridb_partials_free(partials);
+    }
+
+    /* integer partial results are promoted when merged with doubles */
+    partials = siridb_partials_new(CLERI_GID_F_SUM, 100, 0.5);
+    other = siridb_partials_new(CLERI_GID_F_SUM, 100, 0.5);
+    assert (siridb_partials_add_points(partials, even, err_msg) == 0);
+    assert (siridb_partials_add_points(other, reals, err_msg) == 0);
+    assert (partials->tp == TP_INT && other->tp == TP_DOUBLE);
+
+    packer = qp_packer_new(1024);
+    assert (siridb_partials_pack(partials, packer) == 0);
+
+    qp_unpacker_init(&unpacker, packer->buffer, packer->len);
+    assert (qp_is_raw(qp_next(&unpacker, &qp_raw)));
+    assert (siridb_partials_merge_packed(
+            other,
+            qp_raw.via.raw,
+            qp_raw.len,
+            err_msg) == 0);
+
+    result = siridb_partials_points(other, err_msg);
+    assert (result != NULL && result->tp == TP_DOUBLE && result->len == 10);
+    assert (result->data->ts == 100 && result->data->val.real == 179.0);
+
+    siridb_points_free(result);
+    qp_packer_free(packer);
+    siridb_partials_free(other);
+    siridb_partials_free(partials);
+
+    siridb_points_free(reals);
+    siridb_points_free(even);
+    siridb_points_free(odd);
+    siridb_points_free(points);
+
+    return test_end(TEST_OK);
+}
+
+static int test_aggr_min(void)
+{
+    test_start("Testing aggregation min");
+
+    siridb_aggr_t aggr;
+    siridb_points_t * result;
+    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
+    siridb_points_t * points = prepare_points();
+
+    aggr.gid = CLERI_GID_F_MIN;
+    aggr.group_by = 2;
+    aggr.limit = 0;
+    aggr.offset = 0;
+
+    result = siridb_aggregate_run(points, &aggr, err_msg);
+
+    assert (result != NULL);
+    assert (result->len == 9);
+    assert (result->tp == TP_INT);
+    assert (result->data->ts == 4 && result->data->val.int64 == 1);
     assert ((result->data + 5)->ts == 14 &&
             (result->data + 5)->val.int64 == 3);
 
@@ -782,6 +2003,216 @@ static int test_aggr_variance(void)
     return test_end(TEST_OK);
 }
 
+static siridb_points_t * test__aggr_stream_points(size_t n)
+{
+    siridb_points_t * points = siridb_points_new(n, TP_INT);
+    uint64_t ts;
+    qp_via_t val;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        ts = i * 3 + i % 2;
+        val.int64 = (int64_t) ((i * 7919) % 101) - 50;
+        siridb_points_add_point(points, &ts, &val);
+    }
+
+    return points;
+}
+
+/*
+ * Run the aggregation list one aggregate at a time on points and at once on
+ * a copy of the points and compare the results. Returns the result length.
+ */
+static size_t test__aggr_stream_cmp(
+        slist_t * alist,
+        siridb_points_t * points,
+        siridb_points_t * copy)
+{
+    siridb_points_t * aggr_points, * result;
+    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
+    size_t len;
+
+    for (size_t i = 0; points->len && i < alist->len; i++)
+    {
+        aggr_points = siridb_aggregate_run(
+                points,
+                (siridb_aggr_t *) alist->data[i],
+                err_msg);
+        assert (aggr_points != NULL);
+        if (aggr_points != points)
+        {
+            siridb_points_free(points);
+        }
+        points = aggr_points;
+    }
+
+    result = siridb_aggregate_list_run(copy, alist, err_msg);
+
+    assert (result != NULL);
+    assert (result->tp == points->tp);
+    assert (result->len == points->len);
+    assert (memcmp(
+            result->data,
+            points->data,
+            result->len * sizeof(siridb_point_t)) == 0);
+
+    len = result->len;
+
+    siridb_points_free(result);
+    siridb_points_free(points);
+
+    return len;
+}
+
+static int test_aggr_stream(void)
+{
+    test_start("Testing aggregation stream");
+
+    siridb_aggr_t aggrs[5];
+    slist_t * alist = slist_new(5);
+
+    memset(aggrs, 0, sizeof(aggrs));
+
+    /* filter, difference, mean, variance and count, over many chunks */
+    aggrs[0].gid = CLERI_GID_F_FILTER;
+    aggrs[0].filter_opr = CEXPR_GT;
+    aggrs[0].filter_tp = TP_INT;
+    aggrs[0].filter_via.int64 = -40;
+    aggrs[1].gid = CLERI_GID_F_DIFFERENCE;
+    aggrs[2].gid = CLERI_GID_F_MEAN;
+    aggrs[2].group_by = 20;
+    aggrs[3].gid = CLERI_GID_F_VARIANCE;
+    aggrs[3].group_by = 100;
+    aggrs[4].gid = CLERI_GID_F_COUNT;
+    aggrs[4].group_by = 1000;
+
+    for (int i = 0; i < 5; i++)
+    {
+        slist_append(alist, &aggrs[i]);
+    }
+
+    assert (test__aggr_stream_cmp(
+            alist,
+            test__aggr_stream_points(50000),
+            test__aggr_stream_points(50000)) == 150);
+
+    /* group difference, derivative and median, a limit ends the stages */
+    aggrs[0].gid = CLERI_GID_F_DIFFERENCE;
+    aggrs[0].group_by = 7;
+    aggrs[1].gid = CLERI_GID_F_DERIVATIVE;
+    aggrs[1].timespan = 1.0;
+    aggrs[2].gid = CLERI_GID_F_MEDIAN;
+    aggrs[2].group_by = 14;
+    aggrs[3].gid = CLERI_GID_F_SUM;
+    aggrs[3].limit = 1;
+    alist->len = 4;
+
+    assert (test__aggr_stream_cmp(
+            alist,
+            prepare_points(),
+            prepare_points()) == 1);
+
+    slist_free(alist);
+
+    return test_end(TEST_OK);
+}
+
+static int test_simd(void)
+{
+    test_start("Testing vector kernels");
+
+    static const char * names[2] = {"sse4.2", "avx2"};
+    static const cexpr_operator_t oprs[6] = {
+            CEXPR_EQ, CEXPR_NE, CEXPR_GT, CEXPR_LT, CEXPR_GE, CEXPR_LE};
+    const siridb_simd_t * scalar = siridb_simd_get("scalar");
+    const siridb_simd_t * simd;
+    siridb_point_t pts[1003], dest[1003], sdest[1003];
+    int64_t sum, ssum;
+    size_t n, m;
+    double a, b;
+
+    for (size_t i = 0; i < 1003; i++)
+    {
+        pts[i].ts = i * 5;
+        pts[i].val.int64 = (int64_t) ((i * 7919) % 201) - 100;
+    }
+
+    /* n is chosen so all kernels have a scalar tail */
+    n = 1003;
+
+    for (int k = 0; k < 2; k++)
+    {
+        if ((simd = siridb_simd_get(names[k])) == NULL)
+        {
+            continue;
+        }
+
+        /* timestamps */
+        for (uint64_t ts = 0; ts < 5100; ts += 499)
+        {
+            assert (simd->bucket_end(pts, n, ts) ==
+                    scalar->bucket_end(pts, n, ts));
+        }
+
+        /* integer values */
+        assert (simd->sum_int(pts, n, &sum) == 0);
+        assert (scalar->sum_int(pts, n, &ssum) == 0);
+        assert (sum == ssum);
+        assert (simd->min_int(pts, n) == scalar->min_int(pts, n));
+        assert (simd->max_int(pts, n) == scalar->max_int(pts, n));
+        a = simd->sqdev_int(pts, n, 0.3);
+        b = scalar->sqdev_int(pts, n, 0.3);
+        assert (fabs(a - b) <= fabs(b) * 1e-12);
+
+        for (int o = 0; o < 6; o++)
+        {
+            m = simd->filter_int(pts, n, oprs[o], 7, dest);
+            assert (m == scalar->filter_int(pts, n, oprs[o], 7, sdest));
+            assert (memcmp(dest, sdest, m * sizeof(siridb_point_t)) == 0);
+        }
+
+        pts[500].val.int64 = LLONG_MAX;
+        assert (simd->sum_int(pts, n, &sum) == -1);
+        pts[500].val.int64 = 0;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        pts[i].val.real = (double) pts[i].val.int64 / 3.0;
+    }
+
+    /* a NaN is never taken as minimum or maximum, unless it is first */
+    pts[9].val.real = NAN;
+
+    for (int k = 0; k < 2; k++)
+    {
+        if ((simd = siridb_simd_get(names[k])) == NULL)
+        {
+            continue;
+        }
+
+        a = simd->sum_real(pts + 10, n - 10);
+        b = scalar->sum_real(pts + 10, n - 10);
+        assert (fabs(a - b) <= 1e-9);
+        assert (simd->sum_real(pts + 10, 20) == scalar->sum_real(pts + 10, 20));
+        assert (simd->min_real(pts, n) == scalar->min_real(pts, n));
+        assert (simd->max_real(pts, n) == scalar->max_real(pts, n));
+        assert (isnan(simd->min_real(pts + 9, n - 9)));
+        a = simd->sqdev_real(pts + 10, n - 10, 0.3);
+        b = scalar->sqdev_real(pts + 10, n - 10, 0.3);
+        assert (fabs(a - b) <= fabs(b) * 1e-12);
+
+        for (int o = 0; o < 6; o++)
+        {
+            m = simd->filter_real(pts, n, oprs[o], 2.0, dest);
+            assert (m == scalar->filter_real(pts, n, oprs[o], 2.0, sdest));
+            assert (memcmp(dest, sdest, m * sizeof(siridb_point_t)) == 0);
+        }
+    }
+
+    return test_end(TEST_OK);
+}
+
 static int test_iso8601(void)
 {
     test_start("Testing iso8601");
@@ -901,6 +2332,356 @@ static int test_version(void)
     return test_end(TEST_OK);
 }
 
+static int test__fifo_walk_cb(
+        sirinet_pkg_t * pkg,
+        uint64_t lsn,
+        uint16_t * n)
+{
+    /* packages are walked in the order they are appended */
+    assert (pkg->pid == ++(*n));
+    assert (pkg->len == 4 && memcmp(pkg->data, "walk", 4) == 0);
+    return 0;
+}
+
+static int test_fifo_walk(void)
+{
+    test_start("Testing fifo walk");
+
+    char dbpath[] = "/tmp/siridb-test-fifo-XXXXXX/";
+    siridb_t siridb;
+    siridb_server_t replica;
+    siridb_fifo_t * fifo;
+    sirinet_pkg_t * pkg;
+    uint64_t lsn[4];
+    uint32_t size;
+    uint16_t n;
+    FILE * fp;
+    char * fn;
+
+    dbpath[sizeof(dbpath) - 2] = '\0';
+    assert (mkdtemp(dbpath) != NULL);
+    dbpath[sizeof(dbpath) - 2] = '/';
+
+    memset(&siridb, 0, sizeof(siridb_t));
+    memset(&replica, 0, sizeof(siridb_server_t));
+    siridb.dbpath = dbpath;
+    siridb.replica = &replica;
+
+    fifo = siridb_fifo_new(&siridb);
+    assert (fifo != NULL);
+
+    for (n = 1; n <= 3; n++)
+    {
+        pkg = sirinet_pkg_new(n, 4, 0, "walk");
+        assert (siridb_fifo_append(fifo, pkg) == 0);
+        lsn[n] = fifo->lsn;
+        free(pkg);
+    }
+
+    n = 0;
+    assert (siridb_fifo_walk(&siridb, &replica, 0,
+            (siridb_fifo_walk_cb) test__fifo_walk_cb, &n) == 0 && n == 3);
+
+    n = 1;
+    assert (siridb_fifo_walk(&siridb, &replica, lsn[2],
+            (siridb_fifo_walk_cb) test__fifo_walk_cb, &n) == 0 && n == 3);
+
+    n = 3;
+    assert (siridb_fifo_walk(&siridb, &replica, lsn[3] + 1,
+            (siridb_fifo_walk_cb) test__fifo_walk_cb, &n) == 0 && n == 3);
+
+    /* a torn package after the last package is skipped */
+    fn = strdup(fifo->in->fn);
+    assert (fn != NULL && (fp = fopen(fn, "r+")) != NULL);
+
+    size = 1000;
+    assert (fseeko(fp, fifo->in->free_space - sizeof(uint32_t), SEEK_SET) == 0);
+    assert (fwrite(&size, sizeof(uint32_t), 1, fp) == 1 && fflush(fp) == 0);
+
+    n = 0;
+    assert (siridb_fifo_walk(&siridb, &replica, 0,
+            (siridb_fifo_walk_cb) test__fifo_walk_cb, &n) == 0 && n == 3);
+
+    /* a size which does not fit in the file is skipped as well */
+    size = UINT32_MAX - 16;
+    assert (fseeko(fp, fifo->in->free_space - sizeof(uint32_t), SEEK_SET) == 0);
+    assert (fwrite(&size, sizeof(uint32_t), 1, fp) == 1 && fclose(fp) == 0);
+
+    n = 0;
+    assert (siridb_fifo_walk(&siridb, &replica, 0,
+            (siridb_fifo_walk_cb) test__fifo_walk_cb, &n) == 0 && n == 3);
+
+    siridb_fifo_free(fifo);
+
+    assert (unlink(fn) == 0);
+    strcpy(strrchr(fn, '/') + 1, "cursor.dat");
+    assert (unlink(fn) == 0);
+    *strrchr(fn, '/') = '\0';
+    assert (rmdir(fn) == 0);
+    assert (rmdir(dbpath) == 0);
+    free(fn);
+
+    return test_end(TEST_OK);
+}
+
+static void test__pipeline_cb(
+        sirinet_promise_t * promise,
+        sirinet_pkg_t * pkg,
+        int status)
+{
+    /* queued packages are cancelled using the first server in the pool */
+    assert (pkg == NULL && status == PROMISE_CANCELLED_ERROR);
+    assert (promise->server != NULL && promise->server->pool == 1);
+    (*((uint16_t *) promise->data))++;
+    sirinet_promise_decref(promise);
+}
+
+static int test_pipeline_close(void)
+{
+    test_start("Testing pipeline close");
+
+    siri_cfg_t cfg;
+    siri_cfg_t * prev = siri.cfg;
+    siridb_t siridb;
+    siridb_pools_t pools;
+    siridb_pool_t pool[2];
+    siridb_server_t server[2];
+    sirinet_pkg_t * pkg;
+    const char data[2] = {QP_MAP_OPEN, QP_MAP_CLOSE};
+    uint16_t n = 0;
+
+    memset(&cfg, 0, sizeof(siri_cfg_t));
+    memset(&siridb, 0, sizeof(siridb_t));
+    memset(pool, 0, sizeof(pool));
+    memset(server, 0, sizeof(server));
+
+    /* no batches are sent so all packages stay in the queue */
+    cfg.insert_pipeline_depth = 0;
+    cfg.insert_pipeline_batch_size = 1;
+    siri.cfg = &cfg;
+
+    server[1].pool = 1;
+    server[1].flags = SERVER__IS_ONLINE;
+    pool[0].len = 1;
+    pool[0].server[0] = &server[0];
+    pool[1].len = 1;
+    pool[1].server[0] = &server[1];
+    pools.len = 2;
+    pools.pool = pool;
+    siridb.pools = &pools;
+    siridb.server = &server[0];
+
+    /* packages of the same type are merged into one batch */
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        pkg = sirinet_pkg_new(0, 2, (i == 2) ? 2 : 1, data);
+        assert (pkg != NULL);
+        assert (siridb_pipeline_send_pkg(
+                &siridb,
+                1,
+                pkg,
+                0,
+                (sirinet_promise_cb) test__pipeline_cb,
+                &n) == 0);
+    }
+
+    assert (pool[1].pipeline != NULL);
+    assert (pool[1].pipeline->queue->len == 2 && n == 0);
+
+    /* queued packages are cancelled when the pipeline is closed */
+    siridb_pools_close(&pools);
+
+    assert (pool[1].pipeline == NULL && n == 3);
+
+    siri.cfg = prev;
+
+    return test_end(TEST_OK);
+}
+
+#define TEST_INGEST_PRODUCERS 4
+#define TEST_INGEST_STRIPES 16
+#define TEST_INGEST_POINTS 10000    /* for each producer */
+
+typedef struct
+{
+    siri_ingest_job_t job;  /* must be on top */
+    uint32_t producer;
+    uint32_t seq;
+} test_ingest_job_t;
+
+static uint8_t test_ingest_landed[TEST_INGEST_PRODUCERS][TEST_INGEST_POINTS];
+static int64_t test_ingest_last[TEST_INGEST_PRODUCERS][TEST_INGEST_STRIPES];
+
+static void test__ingest_cb(test_ingest_job_t * job)
+{
+    uint32_t stripe = job->seq % TEST_INGEST_STRIPES;
+
+    /* jobs for the same stripe are handled in the order they are queued */
+    assert (test_ingest_last[job->producer][stripe] < (int64_t) job->seq);
+    test_ingest_last[job->producer][stripe] = job->seq;
+
+    test_ingest_landed[job->producer][job->seq]++;
+}
+
+static void test__ingest_producer(test_ingest_job_t * jobs)
+{
+    for (uint32_t i = 0; i < TEST_INGEST_POINTS; i++)
+    {
+        siri_ingest_queue(i % TEST_INGEST_STRIPES, &jobs[i].job);
+    }
+}
+
+static int test_ingest(void)
+{
+    test_start("Testing ingest workers");
+
+    siri_cfg_t cfg;
+    siri_cfg_t * prev = siri.cfg;
+    siri_ingest_t * prev_ingest = siri.ingest;
+    uv_thread_t threads[TEST_INGEST_PRODUCERS];
+    test_ingest_job_t * jobs, * job;
+    uint32_t p, i;
+
+    jobs = (test_ingest_job_t *) malloc(
+            sizeof(test_ingest_job_t) *
+            TEST_INGEST_PRODUCERS *
+            TEST_INGEST_POINTS);
+    assert (jobs != NULL);
+
+    /* not a divisor of the number of stripes */
+    memset(&cfg, 0, sizeof(siri_cfg_t));
+    cfg.ingest_threads = 3;
+    siri.cfg = &cfg;
+
+    assert (siri_ingest_init(&siri) == 0);
+    assert (siri.ingest->n == 3);
+
+    memset(test_ingest_landed, 0, sizeof(test_ingest_landed));
+
+    for (p = 0; p < TEST_INGEST_PRODUCERS; p++)
+    {
+        for (i = 0; i < TEST_INGEST_STRIPES; i++)
+        {
+            test_ingest_last[p][i] = -1;
+        }
+
+        for (i = 0; i < TEST_INGEST_POINTS; i++)
+        {
+            job = jobs + p * TEST_INGEST_POINTS + i;
+            job->job.cb = (siri_ingest_cb) test__ingest_cb;
+            job->producer = p;
+            job->seq = i;
+        }
+    }
+
+    /* queue jobs on all stripes from more than one thread at once */
+    for (p = 0; p < TEST_INGEST_PRODUCERS; p++)
+    {
+        assert (uv_thread_create(
+                &threads[p],
+                (uv_thread_cb) test__ingest_producer,
+                jobs + p * TEST_INGEST_POINTS) == 0);
+    }
+
+    for (p = 0; p < TEST_INGEST_PRODUCERS; p++)
+    {
+        uv_thread_join(&threads[p]);
+    }
+
+    /* queued jobs are handled before the worker threads stop */
+    siri_ingest_destroy(&siri);
+    assert (siri.ingest == NULL);
+
+    /* every point is handled exactly once */
+    for (p = 0; p < TEST_INGEST_PRODUCERS; p++)
+    {
+        for (i = 0; i < TEST_INGEST_POINTS; i++)
+        {
+            assert (test_ingest_landed[p][i] == 1);
+        }
+    }
+
+    free(jobs);
+    siri.cfg = prev;
+    siri.ingest = prev_ingest;
+
+    return test_end(TEST_OK);
+}
+
+static int test_re_cache(void)
+{
+    test_start("Testing regular expression cache");
+
+    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
+    siridb_re_t * re_a = siridb_re_get("/series-\\d+/", 12, err_msg);
+    siridb_re_t * re_b = siridb_re_get("/series-\\d+/", 12, err_msg);
+    siridb_re_t * re_c = siridb_re_get("/series-\\d+/i", 13, err_msg);
+
+    assert (re_a != NULL && re_c != NULL);
+
+    /* same source must return the cached expression */
+    assert (re_a == re_b);
+    assert (re_a->ref == 3);
+
+    /* flags are part of the cache key */
+    assert (re_a != re_c);
+
+    assert (siridb_re_exec(re_a, "series-42", 9) == 0);
+    assert (siridb_re_exec(re_a, "Series-42", 9) != 0);
+    assert (siridb_re_exec(re_c, "Series-42", 9) == 0);
+    assert (siridb_re_exec(re_a, "series-42x", 10) != 0);
+
+    /* invalid expressions are not cached */
+    assert (siridb_re_get("/(/", 3, err_msg) == NULL);
+
+    siridb_re_decref(re_a);
+    siridb_re_decref(re_b);
+    siridb_re_decref(re_c);
+
+    return test_end(TEST_OK);
+}
+
+static int test_re_prefix(void)
+{
+    test_start("Testing regular expression prefix");
+
+    char err_msg[SIRIDB_MAX_SIZE_ERR_MSG];
+    siridb_re_t * re;
+
+    re = siridb_re_get("/series-\\d+/", 12, err_msg);
+    assert (re->prefix_len == 7 && memcmp(re->prefix, "series-", 7) == 0);
+    assert (~re->flags & SIRIDB_RE_FLAG_LITERAL);
+    siridb_re_decref(re);
+
+    re = siridb_re_get("/cpu\\.load/", 11, err_msg);
+    assert (re->prefix_len == 8 && memcmp(re->prefix, "cpu.load", 8) == 0);
+    assert (re->flags & SIRIDB_RE_FLAG_LITERAL);
+    assert (siridb_re_exec(re, "cpu.load", 8) == 0);
+    assert (siridb_re_exec(re, "cpu.loads", 9) != 0);
+    siridb_re_decref(re);
+
+    /* quantifier on the last literal */
+    re = siridb_re_get("/hosts?.*/i", 11, err_msg);
+    assert (re->prefix_len == 4 && memcmp(re->prefix, "host", 4) == 0);
+    assert (re->flags & SIRIDB_RE_FLAG_CASELESS);
+    assert (siridb_re_exec(re, "HOST-1", 6) == 0);
+    siridb_re_decref(re);
+
+    /* alternation at top level, no prefix */
+    re = siridb_re_get("/ab|cd/", 7, err_msg);
+    assert (re->prefix_len == 0);
+    assert (siridb_re_exec(re, "cd", 2) == 0);
+    siridb_re_decref(re);
+
+    /* alternation inside a group */
+    re = siridb_re_get("/ab(c|d)/", 9, err_msg);
+    assert (re->prefix_len == 2);
+    assert (siridb_re_exec(re, "abd", 3) == 0);
+    siridb_re_decref(re);
+
+    return test_end(TEST_OK);
+}
+
 int test_strx_to_double(void)
 {
     test_start("Testing strx_to_double");
@@ -922,28 +2703,48 @@ int run_tests(int flags)
     rc += test_qpack();
     rc += test_cleri();
     rc += test_ctree();
+    rc += test_art();
     rc += test_imap();
     rc += test_imap_union();
     rc += test_imap_intersection();
     rc += test_imap_difference();
     rc += test_imap_symmetric_difference();
+    rc += test_idmap();
+    rc += test_roaring();
     rc += test_gen_pool_lookup();
+    rc += test_pool_lookup_hash();
     rc += test_points();
+    rc += test_points_batch();
+    rc += test_points_merge();
+    rc += test_series_iter();
+    rc += test_arena();
     rc += test_aggr_count();
     rc += test_aggr_max();
     rc += test_aggr_mean();
     rc += test_aggr_median();
     rc += test_aggr_median_high();
     rc += test_aggr_median_low();
+    rc += test_median_select();
+    rc += test_median_nan();
+    rc += test_sketch();
+    rc += test_aggr_percentile();
+    rc += test_partials();
     rc += test_aggr_min();
     rc += test_aggr_pvariance();
     rc += test_aggr_sum();
     rc += test_aggr_variance();
+    rc += test_aggr_stream();
+    rc += test_simd();
+    rc += test_fifo_walk();
+    rc += test_pipeline_close();
+    rc += test_ingest();
     rc += test_iso8601();
     rc += test_expr();
     rc += test_access();
     rc += test_version();
     rc += test_strx_to_double();
+    rc += test_re_cache();
+    rc += test_re_prefix();
 
     printf("\nSuccesfully performed %d tests in %.3f milliseconds!\n\n",
             rc, timeit_stop(&start));
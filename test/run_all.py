@@ -3,26 +3,46 @@ from testing import run_test
 from testing import Server
 from test_cluster import TestCluster
 from test_group import TestGroup
+from test_group_match import TestGroupMatch
+from test_ingest import TestIngest
 from test_list import TestList
 from test_insert import TestInsert
+from test_insert_bulk import TestInsertBulk
+from test_insert_coalesce import TestInsertCoalesce
+from test_insert_queue import TestInsertQueue
+from test_line_protocol import TestLineProtocol
+from test_lookup_version import TestLookupVersion
 from test_pool import TestPool
+from test_query_threads import TestQueryThreads
 from test_select import TestSelect
+from test_select_stream import TestSelectStream
 from test_series import TestSeries
 from test_server import TestServer
 from test_user import TestUser
+from test_wal import TestWal
 
 Server.BUILDTYPE = 'Release'
 
 if __name__ == '__main__':
     # run_test(TestCluster())
     run_test(TestGroup())
+    run_test(TestGroupMatch())
+    run_test(TestIngest())
     run_test(TestList())
     run_test(TestInsert())
+    run_test(TestInsertBulk())
+    run_test(TestInsertCoalesce())
+    run_test(TestInsertQueue())
+    run_test(TestLineProtocol())
+    run_test(TestLookupVersion())
     run_test(TestPool())
+    run_test(TestQueryThreads())
     run_test(TestSelect())
+    run_test(TestSelectStream())
     run_test(TestSeries())
     run_test(TestServer())
     run_test(TestUser())
+    run_test(TestWal())
 
 
 
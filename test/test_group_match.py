@@ -0,0 +1,80 @@
+import asyncio
+from testing import default_test_setup
+from testing import run_test
+from testing import Server
+from testing import TestBase
+
+
+# group name, expression and the series which should be in the group
+GROUPS = (
+    # literal prefix
+    ('prefix', r'/cpu\.load.*/', ['cpu.load', 'cpu.load.1']),
+    # shorter literal prefix
+    ('short', r'/cp.*/', ['cpu.idle', 'cpu.load', 'cpu.load.1']),
+    # case insensitive prefix
+    ('caseless', r'/CPU\..*/i', [
+        'CPU.Load.2', 'Cpu.idle', 'cpu.idle', 'cpu.load', 'cpu.load.1']),
+    # no literal prefix, tested for each series
+    ('idle', r'/.*\.idle/', ['Cpu.idle', 'cpu.idle', 'mem.idle']),
+    ('alternation', r'/ab|cpu.*/', [
+        'ab', 'cpu.idle', 'cpu.load', 'cpu.load.1']),
+)
+
+SERIES = (
+    'CPU.Load.2',
+    'Cpu.idle',
+    'ab',
+    'c',
+    'cpu.idle',
+    'cpu.load',
+    'cpu.load.1',
+    'mem.idle',
+)
+
+
+class TestGroupMatch(TestBase):
+    title = 'Test matching new series with groups'
+
+    async def list_group(self, name):
+        result = await self.client0.query('list series `{}`'.format(name))
+        return sorted(s for s, in result['series'])
+
+    @default_test_setup(1)
+    async def run(self):
+        await self.client0.connect()
+
+        for name, expression, _ in GROUPS:
+            await self.client0.query(
+                'create group `{}` for {}'.format(name, expression))
+
+        await asyncio.sleep(3)
+
+        # new series are matched with all groups at once
+        await self.client0.insert({name: [[0, 0]] for name in SERIES})
+
+        await asyncio.sleep(3)
+
+        for name, _, series in GROUPS:
+            self.assertEqual(await self.list_group(name), series, msg=name)
+
+        # a new group is tested against each series and must be equal
+        for name, expression, _ in GROUPS:
+            await self.client0.query(
+                'create group `{}-all` for {}'.format(name, expression))
+
+        await asyncio.sleep(3)
+
+        for name, _, series in GROUPS:
+            self.assertEqual(
+                await self.list_group('{}-all'.format(name)),
+                series,
+                msg=name)
+
+        self.client0.close()
+
+
+if __name__ == '__main__':
+    Server.HOLD_TERM = False
+    Server.MEM_CHECK = False
+    Server.BUILDTYPE = 'Debug'
+    run_test(TestGroupMatch())
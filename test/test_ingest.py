@@ -0,0 +1,83 @@
+import asyncio
+from testing import Client
+from testing import default_test_setup
+from testing import run_test
+from testing import Server
+from testing import TestBase
+
+
+TS = 1471254705
+
+NUM_CLIENTS = 4
+NUM_SERIES = 200
+NUM_ROUNDS = 20
+
+
+class TestIngest(TestBase):
+    title = 'Test concurrent inserts on the ingest workers'
+
+    async def insert(self, client, c):
+        '''Each client inserts a point in every series for each round, so all
+        clients write to the same series at the same time.'''
+        for r in range(NUM_ROUNDS):
+            ts = TS + r * NUM_CLIENTS + c
+            result = await client.insert({
+                'ingest-{}'.format(i): [[ts, c]]
+                for i in range(NUM_SERIES)})
+            self.assertEqual(
+                result['success_msg'],
+                'Successfully inserted {} point(s).'.format(NUM_SERIES))
+
+    async def select(self, done):
+        '''Select all series while points are inserted. Each select must
+        return ordered points without duplicates.'''
+        n = 0
+        while not done.is_set():
+            result = await self.client0.query('select * from /ingest-.*/')
+            for name, points in result.items():
+                timestamps = [ts for ts, _ in points]
+                self.assertEqual(
+                    timestamps,
+                    sorted(set(timestamps)),
+                    msg=name)
+            n += 1
+        return n
+
+    @default_test_setup(1)
+    async def run(self):
+        await self.client0.connect()
+
+        clients = [Client(self.db, self.server0) for _ in range(NUM_CLIENTS)]
+        for client in clients:
+            await client.connect()
+
+        done = asyncio.Event()
+        select = asyncio.ensure_future(self.select(done))
+
+        await asyncio.gather(*(
+            self.insert(client, c) for c, client in enumerate(clients)))
+
+        done.set()
+        self.assertGreater(await select, 0)
+
+        # every point is inserted exactly once
+        expected = [
+            [TS + r * NUM_CLIENTS + c, c]
+            for r in range(NUM_ROUNDS)
+            for c in range(NUM_CLIENTS)]
+
+        result = await self.client0.query('select * from /ingest-.*/')
+        self.assertEqual(len(result), NUM_SERIES)
+        for name, points in result.items():
+            self.assertEqual(points, expected, msg=name)
+
+        for client in clients:
+            client.close()
+        self.client0.close()
+
+
+if __name__ == '__main__':
+    Server.HOLD_TERM = False
+    Server.MEM_CHECK = False
+    Server.BUILDTYPE = 'Debug'
+    run_test(TestIngest())
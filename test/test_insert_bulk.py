@@ -0,0 +1,132 @@
+import struct
+from testing import default_test_setup
+from testing import RawClient
+from testing import run_test
+from testing import Server
+from testing import TestBase
+from testing.rawclient import CPROTO_ERR_INSERT
+from testing.rawclient import CPROTO_REQ_INSERT_BULK
+from testing.rawclient import CPROTO_RES_INSERT
+
+
+BULK_INT = 0
+BULK_FLOAT = 1
+
+
+def pack_bulk(series, count=None):
+    '''Returns a bulk insert package for a list with (name, tp, points)
+    tuples. When count is not None it is written instead of the number of
+    points.'''
+    data = [struct.pack('<I', len(series))]
+    for name, tp, points in series:
+        name = name.encode('utf-8')
+        data.append(struct.pack('<H', len(name)) + name)
+    for name, tp, points in series:
+        data.append(struct.pack(
+            '<BI', tp, len(points) if count is None else count))
+        data.append(b''.join(struct.pack('<q', ts) for ts, _ in points))
+        data.append(b''.join(
+            struct.pack('<q' if tp == BULK_INT else '<d', val)
+            for _, val in points))
+    return b''.join(data)
+
+
+class TestInsertBulk(TestBase):
+    title = 'Test bulk insert'
+
+    SERIES = [
+        ('bulk int', BULK_INT, [[1471254705, 5], [1471254707, 1 << 40]]),
+        ('bulk float', BULK_FLOAT, [[1471254705, 1.5], [1471254708, -2.25]]),
+    ]
+
+    async def assertInsertError(self, data, msg):
+        tp, result = await self.bulk.request(CPROTO_REQ_INSERT_BULK, data)
+        self.assertEqual(tp, CPROTO_ERR_INSERT)
+        self.assertEqual(result['error_msg'], msg)
+
+    @default_test_setup(1)
+    async def run(self):
+        await self.client0.connect()
+
+        self.bulk = RawClient(self.db, self.server0)
+        await self.bulk.connect()
+
+        tp, result = await self.bulk.request(
+            CPROTO_REQ_INSERT_BULK,
+            pack_bulk(self.SERIES))
+        self.assertEqual(tp, CPROTO_RES_INSERT)
+        self.assertEqual(
+            result['success_msg'],
+            'Successfully inserted 4 point(s).')
+
+        for name, _, points in self.SERIES:
+            self.assertEqual(
+                await self.client0.query('select * from "{}"'.format(name)),
+                {name: points})
+
+        # time-stamps which are not ascending are sorted
+        unsorted = [('bulk unsorted', BULK_INT, [
+            [1471254707, 3], [1471254705, 1], [1471254706, 2]])]
+        tp, result = await self.bulk.request(
+            CPROTO_REQ_INSERT_BULK,
+            pack_bulk(unsorted))
+        self.assertEqual(tp, CPROTO_RES_INSERT)
+        self.assertEqual(
+            await self.client0.query('select * from "bulk unsorted"'),
+            {'bulk unsorted': [
+                [1471254705, 1], [1471254706, 2], [1471254707, 3]]})
+
+        bad = [('bulk bad', BULK_INT, [[1471254705, 1], [1471254706, 2]])]
+        data = pack_bulk(bad)
+
+        # malformed length
+        await self.assertInsertError(
+            data[:-1],
+            'Invalid bulk insert package.')
+
+        await self.assertInsertError(
+            data + b'\x00',
+            'Invalid bulk insert package.')
+
+        await self.assertInsertError(
+            struct.pack('<I', 2) + data[4:],
+            'Expecting a series name (string value) with an array of points '
+            'where each point should be an integer time-stamp with a value.')
+
+        await self.assertInsertError(
+            data[:4] + struct.pack('<H', 0xffff) + data[6:],
+            'Expecting a series name (string value) with an array of points '
+            'where each point should be an integer time-stamp with a value.')
+
+        # count mismatch
+        await self.assertInsertError(
+            pack_bulk(bad, count=3),
+            'Invalid bulk insert package.')
+
+        await self.assertInsertError(
+            pack_bulk(bad, count=1),
+            'Invalid bulk insert package.')
+
+        await self.assertInsertError(
+            pack_bulk(bad, count=0),
+            'Expecting a series to have at least one point.')
+
+        # out-of-range time-stamp
+        for ts in (-1, 1 << 32):
+            await self.assertInsertError(
+                pack_bulk([('bulk bad', BULK_INT, [[ts, 1]])]),
+                'Received at least one time-stamp which is out-of-range.')
+
+        self.assertEqual(
+            await self.client0.query('count series /bulk bad/'),
+            {'series': 0})
+
+        self.bulk.close()
+        self.client0.close()
+
+
+if __name__ == '__main__':
+    Server.HOLD_TERM = False
+    Server.MEM_CHECK = False
+    Server.BUILDTYPE = 'Debug'
+    run_test(TestInsertBulk())
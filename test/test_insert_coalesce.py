@@ -0,0 +1,113 @@
+import asyncio
+from testing import Client
+from testing import default_test_setup
+from testing import run_test
+from testing import Server
+from testing import TestBase
+
+
+TS = 1471254705
+
+# window in milliseconds and the number of points which sends a group
+WINDOW = 1000
+POINTS = 100
+
+
+def gen_insert(prefix, ts, value, n=20):
+    return {'{}-{}'.format(prefix, i): [[ts, value]] for i in range(n)}
+
+
+class TestInsertCoalesce(TestBase):
+    title = 'Test coalescing client inserts'
+
+    async def restart(self, **config):
+        self.client0.close()
+        result = await self.server0.stop()
+        self.assertTrue(result)
+
+        self.server0.config.update(config)
+        self.server0.create()
+
+        await self.server0.start(sleep=10)
+        await self.client0.connect()
+
+    async def insert_all(self, inserts, delay=0.1):
+        '''Send inserts in order, each using its own client and without
+        waiting for a response. Returns the results and the time it took
+        to receive all responses.'''
+        loop = asyncio.get_event_loop()
+        start = loop.time()
+        tasks = []
+
+        for client, data in zip(self.clients, inserts):
+            tasks.append(asyncio.ensure_future(client.insert(data)))
+            await asyncio.sleep(delay)
+
+        results = await asyncio.gather(*tasks)
+        return results, loop.time() - start
+
+    def assertInserted(self, results, inserts):
+        for result, data in zip(results, inserts):
+            self.assertEqual(
+                result['success_msg'],
+                'Successfully inserted {} point(s).'.format(len(data)))
+
+    @default_test_setup(2)
+    async def run(self):
+        await self.db.add_pool(self.server1, sleep=3)
+        await self.client0.connect()
+        await self.assertIsRunning(self.db, self.client0, timeout=30)
+
+        await self.restart(
+            insert_coalesce_window=WINDOW,
+            insert_coalesce_points=POINTS)
+        await self.assertIsRunning(self.db, self.client0, timeout=30)
+
+        self.clients = [Client(self.db, self.server0) for _ in range(3)]
+        for client in self.clients:
+            await client.connect()
+
+        # small inserts are sent together when the window has passed
+        inserts = [gen_insert('timer', TS, value) for value in range(3)]
+        results, elapsed = await self.insert_all(inserts)
+
+        self.assertInserted(results, inserts)
+        self.assertGreaterEqual(elapsed, WINDOW / 1000)
+
+        # points at equal time-stamps keep the order of the inserts
+        result = await self.client0.query('select * from /timer-.*/')
+        self.assertEqual(len(result), 20)
+        for name, points in result.items():
+            self.assertEqual(points, [[TS, 0], [TS, 1], [TS, 2]], msg=name)
+
+        # a group is sent right away when enough points are collected
+        inserts = [
+            gen_insert('size', TS, value, n=POINTS // 2 + 10)
+            for value in range(2)]
+        results, elapsed = await self.insert_all(inserts)
+
+        self.assertInserted(results, inserts)
+        self.assertLess(elapsed, WINDOW / 2000)
+
+        result = await self.client0.query('select * from /size-.*/')
+        self.assertEqual(len(result), POINTS // 2 + 10)
+        for name, points in result.items():
+            self.assertEqual(points, [[TS, 0], [TS, 1]], msg=name)
+
+        # an insert with enough points is not combined
+        inserts = [gen_insert('large', TS, 0, n=POINTS)]
+        results, elapsed = await self.insert_all(inserts, delay=0)
+
+        self.assertInserted(results, inserts)
+        self.assertLess(elapsed, WINDOW / 2000)
+
+        for client in self.clients:
+            client.close()
+        self.client0.close()
+
+
+if __name__ == '__main__':
+    Server.HOLD_TERM = False
+    Server.MEM_CHECK = False
+    Server.BUILDTYPE = 'Debug'
+    run_test(TestInsertCoalesce())
@@ -0,0 +1,126 @@
+import asyncio
+from testing import Client
+from testing import default_test_setup
+from testing import InsertError
+from testing import run_test
+from testing import Server
+from testing import TestBase
+
+
+TS = 1471254705
+
+# inserts are kept in the queue for the coalesce window (milliseconds)
+WINDOW = 2000
+
+# limits in kilobytes
+MAX_INSERT_QUEUE = 4
+MAX_INSERT_QUEUE_CLIENT = 1
+
+INSERT_QUEUE_ERR_MSG = 'Too many pending inserts, please try again later'
+
+
+def gen_insert(prefix, ts, value, n):
+    return {'{}-{}'.format(prefix, i): [[ts, value]] for i in range(n)}
+
+
+class TestInsertQueue(TestBase):
+    title = 'Test insert queue limits'
+
+    async def restart(self, **config):
+        self.client0.close()
+        result = await self.server0.stop()
+        self.assertTrue(result)
+
+        self.server0.config.update(config)
+        self.server0.create()
+
+        await self.server0.start(sleep=10)
+        await self.client0.connect()
+
+    async def show(self, prop):
+        result = await self.client0.query('show {}'.format(prop))
+        return result['data'][0]['value']
+
+    async def assertQueueEmpty(self):
+        self.assertEqual(await self.show('insert_queue'), 0)
+        self.assertEqual(await self.show('insert_queue_size'), 0)
+
+    def assertInserted(self, result, data):
+        self.assertEqual(
+            result['success_msg'],
+            'Successfully inserted {} point(s).'.format(len(data)))
+
+    @default_test_setup(1)
+    async def run(self):
+        await self.client0.connect()
+
+        # a large coalesce window keeps inserts in the queue for a while
+        await self.restart(
+            insert_coalesce_window=WINDOW,
+            insert_coalesce_points=1000000,
+            max_insert_queue=MAX_INSERT_QUEUE,
+            max_insert_queue_client=MAX_INSERT_QUEUE_CLIENT)
+
+        await self.assertQueueEmpty()
+
+        loop = asyncio.get_event_loop()
+        flood = Client(self.db, self.server0)
+        await flood.connect()
+
+        # each insert is larger than max_insert_queue_client
+        inserts = [gen_insert('paused', TS, value, 100) for value in range(3)]
+        start = loop.time()
+        tasks = [asyncio.ensure_future(flood.insert(data)) for data in inserts]
+
+        await asyncio.sleep(WINDOW / 2000)
+
+        # the connection is paused after the first insert, the other inserts
+        # are not read yet
+        self.assertEqual(await self.show('insert_queue'), 1)
+        self.assertGreaterEqual(
+            await self.show('insert_queue_size'),
+            MAX_INSERT_QUEUE_CLIENT * 1024)
+
+        # the connection is resumed each time its insert is finished
+        results = await asyncio.gather(*tasks)
+        for result, data in zip(results, inserts):
+            self.assertInserted(result, data)
+        self.assertGreaterEqual(loop.time() - start, 3 * WINDOW / 1000)
+
+        result = await self.client0.query('select * from /paused-.*/')
+        self.assertEqual(len(result), 100)
+        for name, points in result.items():
+            self.assertEqual(points, [[TS, 0], [TS, 1], [TS, 2]], msg=name)
+
+        await self.assertQueueEmpty()
+
+        # an insert which fills the queue of the database
+        large = gen_insert('large', TS, 0, 300)
+        task = asyncio.ensure_future(flood.insert(large))
+
+        await asyncio.sleep(WINDOW / 4000)
+
+        self.assertGreaterEqual(
+            await self.show('insert_queue_size'),
+            MAX_INSERT_QUEUE * 1024)
+
+        # other clients are asked to try again later
+        small = gen_insert('small', TS, 0, 1)
+        with self.assertRaisesRegex(InsertError, INSERT_QUEUE_ERR_MSG):
+            await self.client0.insert(small)
+
+        self.assertInserted(await task, large)
+        await self.assertQueueEmpty()
+
+        # a retry is accepted once the queue is drained
+        self.assertInserted(await self.client0.insert(small), small)
+
+        flood.close()
+        self.client0.close()
+
+
+if __name__ == '__main__':
+    Server.HOLD_TERM = False
+    Server.MEM_CHECK = False
+    Server.BUILDTYPE = 'Debug'
+    run_test(TestInsertQueue())
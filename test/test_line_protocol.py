@@ -0,0 +1,221 @@
+import asyncio
+import socket
+from testing import default_test_setup
+from testing import run_test
+from testing import Server
+from testing import TestBase
+
+
+GRAPHITE_PORT = 9020
+INFLUX_PORT = 9021
+
+TS = 1471254705
+TS_NS = TS * 1000000000
+
+# enough points to fill a small insert queue more than once
+PAUSED_SERIES = 50
+PAUSED_POINTS = 50000
+
+
+class TestLineProtocol(TestBase):
+    title = 'Test Graphite and InfluxDB line protocol'
+
+    async def send_tcp(self, port, *chunks):
+        reader, writer = await asyncio.open_connection(
+            self.server0.server_address,
+            port)
+        for chunk in chunks:
+            writer.write(chunk.encode('utf-8'))
+            await writer.drain()
+        writer.close()
+
+        # wait for the batch window and the insert
+        await asyncio.sleep(1)
+
+    async def send_udp(self, port, datagram):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.sendto(
+            datagram.encode('utf-8'),
+            (self.server0.server_address, port))
+        sock.close()
+        await asyncio.sleep(1)
+
+    async def select(self, name):
+        return await self.client0.query('select * from "{}"'.format(
+            name.replace('"', '""')))
+
+    async def show(self, prop):
+        result = await self.client0.query('show {}'.format(prop))
+        return result['data'][0]['value']
+
+    async def count(self, regex):
+        result = await self.client0.query(
+            'count series /{}/'.format(regex))
+        return result['series']
+
+    @default_test_setup(1)
+    async def run(self):
+        await self.client0.connect()
+
+        self.client0.close()
+        result = await self.server0.stop()
+        self.assertTrue(result)
+
+        self.server0.config.update({
+            'listen_graphite_port': GRAPHITE_PORT,
+            'listen_influx_port': INFLUX_PORT,
+            'line_protocol_db': self.db.dbname})
+        self.server0.create()
+
+        await self.server0.start(sleep=10)
+        await self.client0.connect()
+
+        # valid Graphite lines, the time-stamp is optional
+        await self.send_tcp(
+            GRAPHITE_PORT,
+            'graphite.a 1.5 {}\n'.format(TS),
+            'graphite.a 2 {}\r\n'.format(TS + 1),
+            'graphite.b\t-3.25\t{}\n'.format(TS),
+            'graphite.now 4\n')
+
+        self.assertEqual(
+            await self.select('graphite.a'),
+            {'graphite.a': [[TS, 1.5], [TS + 1, 2.0]]})
+        self.assertEqual(
+            await self.select('graphite.b'),
+            {'graphite.b': [[TS, -3.25]]})
+        self.assertEqual(await self.count('graphite\\.now'), 1)
+
+        # invalid Graphite lines are dropped, other lines are inserted
+        await self.send_tcp(
+            GRAPHITE_PORT,
+            'graphite.invalid\n',
+            'graphite.invalid abc {}\n'.format(TS),
+            'graphite.invalid 1 abc\n',
+            'graphite.invalid 1 -5\n',
+            'graphite.valid 1 {}\n'.format(TS))
+
+        self.assertEqual(await self.count('graphite\\.invalid'), 0)
+        self.assertEqual(
+            await self.select('graphite.valid'),
+            {'graphite.valid': [[TS, 1.0]]})
+
+        # a line split over more than one read
+        await self.send_tcp(
+            GRAPHITE_PORT,
+            'graphite.sp',
+            'lit 5 {}'.format(TS),
+            '\n')
+
+        self.assertEqual(
+            await self.select('graphite.split'),
+            {'graphite.split': [[TS, 5.0]]})
+
+        # valid InfluxDB lines, one series for each field
+        await self.send_tcp(
+            INFLUX_PORT,
+            'cpu,host=a value=1i,load=0.5 {}\n'.format(TS_NS),
+            'cpu,host=a value=2u {}\n'.format(TS_NS + 1000000000),
+            '# a comment\n',
+            'flags up=true,down=F {}\n'.format(TS_NS))
+
+        self.assertEqual(
+            await self.select('cpu,host=a value'),
+            {'cpu,host=a value': [[TS, 1], [TS + 1, 2]]})
+        self.assertEqual(
+            await self.select('cpu,host=a load'),
+            {'cpu,host=a load': [[TS, 0.5]]})
+        self.assertEqual(
+            await self.select('flags up'),
+            {'flags up': [[TS, 1]]})
+        self.assertEqual(
+            await self.select('flags down'),
+            {'flags down': [[TS, 0]]})
+
+        # escaped characters are kept in the series name
+        await self.send_tcp(
+            INFLUX_PORT,
+            'disk,path=C:\\ drive free=2i {}\n'.format(TS_NS),
+            'disk,path=a\\,b used\\ pct=7.5 {}\n'.format(TS_NS))
+
+        self.assertEqual(
+            await self.select('disk,path=C:\\ drive free'),
+            {'disk,path=C:\\ drive free': [[TS, 2]]})
+        self.assertEqual(
+            await self.select('disk,path=a\\,b used\\ pct'),
+            {'disk,path=a\\,b used\\ pct': [[TS, 7.5]]})
+
+        # invalid InfluxDB lines and unsupported fields are dropped
+        await self.send_tcp(
+            INFLUX_PORT,
+            'nofields\n',
+            'influx.invalid value= {}\n'.format(TS_NS),
+            'influx.invalid value=1x {}\n'.format(TS_NS),
+            'influx.invalid value=1i abc\n',
+            'influx.string s="a b",v=3i {}\n'.format(TS_NS))
+
+        self.assertEqual(await self.count('nofields'), 0)
+        self.assertEqual(await self.count('influx\\.invalid'), 0)
+        self.assertEqual(await self.count('influx\\.string s'), 0)
+        self.assertEqual(
+            await self.select('influx.string v'),
+            {'influx.string v': [[TS, 3]]})
+
+        # a datagram contains complete lines, the last new line is optional
+        await self.send_udp(
+            INFLUX_PORT,
+            'udp value=1i {}\nudp value=2i {}'.format(
+                TS_NS, TS_NS + 1000000000))
+
+        self.assertEqual(
+            await self.select('udp value'),
+            {'udp value': [[TS, 1], [TS + 1, 2]]})
+
+        # oversized lines are dropped
+        await self.send_tcp(
+            GRAPHITE_PORT,
+            'x' * 70000 + '\n',
+            'y' * 70000 + ' 1 {}\n'.format(TS),
+            'graphite.after 1 {}\n'.format(TS))
+
+        self.assertEqual(await self.count('^x'), 0)
+        self.assertEqual(await self.count('^y'), 0)
+        self.assertEqual(
+            await self.select('graphite.after'),
+            {'graphite.after': [[TS, 1.0]]})
+
+        self.assertEqual(await self.show('dropped_points'), 0)
+
+        # a TCP connection is paused, not dropped, when the queue is full
+        self.client0.close()
+        result = await self.server0.stop()
+        self.assertTrue(result)
+
+        self.server0.config.update({'max_insert_queue': 1})
+        self.server0.create()
+
+        await self.server0.start(sleep=10)
+        await self.client0.connect()
+
+        await self.send_tcp(
+            GRAPHITE_PORT,
+            ''.join(
+                'paused.{} {} {}\n'.format(i % PAUSED_SERIES, i, TS + i)
+                for i in range(PAUSED_POINTS)))
+
+        # give the paused connection time to finish
+        await asyncio.sleep(5)
+
+        result = await self.client0.query(
+            'count series length /paused\\..*/')
+        self.assertEqual(result['series_length'], PAUSED_POINTS)
+        self.assertEqual(await self.show('dropped_points'), 0)
+
+        self.client0.close()
+
+
+if __name__ == '__main__':
+    Server.HOLD_TERM = False
+    Server.MEM_CHECK = False
+    Server.BUILDTYPE = 'Debug'
+    run_test(TestLineProtocol())
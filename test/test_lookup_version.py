@@ -0,0 +1,169 @@
+import asyncio
+from testing import default_test_setup
+from testing import QueryError
+from testing import run_test
+from testing import Server
+from testing import TestBase
+
+
+TS = 1471254705
+
+# number of series and the number of inserts while the version is changed
+NUM_SERIES = 500
+NUM_INSERTS = 20
+
+SIRIDB_LOOKUP_SZ = 8192
+
+_M64 = 0xffffffffffffffff
+_S0 = 0x2d358dccaa6c78a5
+_S1 = 0x8bb84b93962eacc9
+_S2 = 0x4b33a62ed433d4a3
+_S3 = 0x4d5a2da51de1aa47
+
+
+def _mix(a, b):
+    r = a * b
+    return (r & _M64) ^ (r >> 64)
+
+
+def _r8(p, i):
+    return int.from_bytes(p[i:i + 8], 'little')
+
+
+def _r4(p, i):
+    return int.from_bytes(p[i:i + 4], 'little')
+
+
+def _wyhash(p):
+    '''Same as LOOKUP_wyhash() in lookup.c.'''
+    n = len(p)
+    seed = _mix(_S0, _S1)
+
+    if n <= 16:
+        if n >= 4:
+            a = (_r4(p, 0) << 32) | _r4(p, (n >> 3) << 2)
+            b = (_r4(p, n - 4) << 32) | _r4(p, n - 4 - ((n >> 3) << 2))
+        elif n > 0:
+            a = (p[0] << 16) | (p[n >> 1] << 8) | p[n - 1]
+            b = 0
+        else:
+            a = b = 0
+    else:
+        i, off = n, 0
+        if i > 48:
+            see1 = see2 = seed
+            while True:
+                seed = _mix(_r8(p, off) ^ _S1, _r8(p, off + 8) ^ seed)
+                see1 = _mix(_r8(p, off + 16) ^ _S2, _r8(p, off + 24) ^ see1)
+                see2 = _mix(_r8(p, off + 32) ^ _S3, _r8(p, off + 40) ^ see2)
+                off += 48
+                i -= 48
+                if i <= 48:
+                    break
+            seed ^= see1 ^ see2
+        while i > 16:
+            seed = _mix(_r8(p, off) ^ _S1, _r8(p, off + 8) ^ seed)
+            i -= 16
+            off += 16
+        a = _r8(p, off + i - 16)
+        b = _r8(p, off + i - 8)
+
+    a ^= _S1
+    b ^= seed
+    r = a * b
+    return _mix((r & _M64) ^ _S0 ^ n, (r >> 64) ^ _S1)
+
+
+def lookup_pools(num_pools):
+    '''Same as siridb_lookup_new() in lookup.c.'''
+    pool = [0] * SIRIDB_LOOKUP_SZ
+    for n in range(1, num_pools):
+        counters = list(range(n))
+        for i in range(SIRIDB_LOOKUP_SZ):
+            counters[pool[i]] += 1
+            if counters[pool[i]] % (n + 1) == 0:
+                pool[i] = n
+    return pool
+
+
+def lookup_v1(pools, name):
+    return pools[_wyhash(name.encode('utf-8')) % SIRIDB_LOOKUP_SZ]
+
+
+def gen_names():
+    # different lengths to test each part of the hash function
+    return [
+        '{}-{}'.format(prefix, i)
+        for i in range(NUM_SERIES // 4)
+        for prefix in ('a', 'series', 'x' * 20, 'long' * 15)]
+
+
+class TestLookupVersion(TestBase):
+    title = 'Test changing the lookup version'
+
+    async def show(self, client, prop):
+        result = await client.query('show {}'.format(prop))
+        return result['data'][0]['value']
+
+    async def insert(self, names, start, n):
+        clients = (self.client0, self.client1)
+        for i in range(start, start + n):
+            await clients[i % 2].insert(
+                {name: [[TS + i, i]] for name in names})
+            await asyncio.sleep(0.2)
+
+    @default_test_setup(2)
+    async def run(self):
+        await self.client0.connect()
+        await self.db.add_pool(self.server1, sleep=3)
+        await self.assertIsRunning(self.db, self.client0, timeout=30)
+        await self.client1.connect()
+
+        names = gen_names()
+
+        await self.insert(names, 0, 1)
+
+        # change the version while both servers receive inserts
+        task = asyncio.ensure_future(self.insert(names, 1, NUM_INSERTS))
+        await asyncio.sleep(1)
+
+        result = await self.client0.query('alter database set lookup_version 1')
+        self.assertEqual(
+            result['success_msg'],
+            'Successfully changed lookup version from 0 to 1. Series are '
+            'moved to their new pool in the background, see '
+            '\'show reindex_progress\'.')
+
+        await task
+        await self.assertIsRunning(self.db, self.client0, timeout=120)
+
+        for client in (self.client0, self.client1):
+            self.assertEqual(await self.show(client, 'lookup_version'), 1)
+
+        # each series exists once and is on the pool from lookup version 1
+        pools = lookup_pools(2)
+        result = await self.client0.query(
+            'list series name, pool limit {}'.format(len(names) * 2))
+        self.assertEqual(
+            sorted(result['series']),
+            sorted([name, lookup_v1(pools, name)] for name in names))
+
+        # no points are lost while series are moved
+        result = await self.client1.query('count series length')
+        self.assertEqual(
+            result['series_length'],
+            len(names) * (NUM_INSERTS + 1))
+
+        # all servers are using the version so nothing is changed
+        with self.assertRaisesRegex(QueryError, 'already using'):
+            await self.client1.query('alter database set lookup_version 1')
+
+        self.client0.close()
+        self.client1.close()
+
+
+if __name__ == '__main__':
+    Server.HOLD_TERM = False
+    Server.MEM_CHECK = False
+    Server.BUILDTYPE = 'Debug'
+    run_test(TestLookupVersion())
@@ -0,0 +1,75 @@
+import asyncio
+import functools
+from testing import default_test_setup
+from testing import gen_data
+from testing import gen_points
+from testing import run_test
+from testing import Server
+from testing import TestBase
+
+
+QUERIES = (
+    'select * from /.*/',
+    'select * from /.*/ between now - 30d and now - 10d',
+    'select mean(1d) from /.*/',
+    'select count(1w), max(1w), min(1w) from /.*/',
+    'select median(1d) => difference() from /.*/',
+    'select limit(20, mean) from /.*/',
+    'select sum(1w) from /.*/ merge as "merged" using sum(1w)',
+    'select * from /.*/ merge as "merged"',
+)
+
+
+class TestQueryThreads(TestBase):
+    title = 'Test select with and without query threads'
+
+    GEN_INT = functools.partial(gen_points, n=1500, tp=int, ts_gap='1h')
+    GEN_FLOAT = functools.partial(gen_points, n=1500, tp=float, ts_gap='1h')
+
+    async def select_all(self):
+        return [await self.client0.query(q) for q in QUERIES]
+
+    async def restart(self, **config):
+        self.client0.close()
+        result = await self.server0.stop()
+        self.assertTrue(result)
+
+        self.server0.config.update(config)
+        self.server0.create()
+
+        await self.server0.start(sleep=10)
+        await self.client0.connect()
+
+    @default_test_setup(1)
+    async def run(self):
+        await self.client0.connect()
+
+        # points span several shards and the last points are in the buffer
+        data = gen_data(points=self.GEN_INT, n=20)
+        data.update(gen_data(points=self.GEN_FLOAT, n=20))
+
+        await self.client0.insert(data)
+
+        await self.restart(query_threads=4, max_query_parallelism=3)
+        parallel = await self.select_all()
+
+        await self.restart(query_threads=0)
+        single = await self.select_all()
+
+        for q, a, b in zip(QUERIES, parallel, single):
+            self.assertEqual(a, b, msg=q)
+
+        self.assertEqual(
+            sorted(parallel[0]),
+            sorted(data))
+
+        self.client0.close()
+
+        return False
+
+
+if __name__ == '__main__':
+    Server.HOLD_TERM = False
+    Server.MEM_CHECK = False
+    Server.BUILDTYPE = 'Debug'
+    run_test(TestQueryThreads())
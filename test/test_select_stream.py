@@ -0,0 +1,102 @@
+import asyncio
+import functools
+from testing import default_test_setup
+from testing import gen_data
+from testing import gen_points
+from testing import RawClient
+from testing import run_test
+from testing import Server
+from testing import TestBase
+from testing.rawclient import CPROTO_REQ_QUERY_STREAM
+from testing.rawclient import CPROTO_RES_QUERY
+from testing.rawclient import CPROTO_RES_QUERY_CHUNK
+
+
+class TestSelectStream(TestBase):
+    title = 'Test streaming select results'
+
+    # a chunk is sent after at least 100000 points
+    GEN_POINTS = functools.partial(gen_points, n=40000, tp=int)
+
+    async def stream(self, query):
+        '''Returns the number of chunks and the combined result.'''
+        raw = RawClient(self.db, self.server0)
+        await raw.connect()
+
+        pid = raw.send(CPROTO_REQ_QUERY_STREAM, (query, None))
+        chunks = 0
+        result = {}
+
+        while True:
+            rpid, tp, data = await raw.read()
+            self.assertEqual(rpid, pid)
+            if tp != CPROTO_RES_QUERY_CHUNK:
+                break
+            chunks += 1
+            for name, points in data.items():
+                self.assertNotIn(name, result)
+                result[name] = points
+
+        raw.close()
+
+        self.assertEqual(tp, CPROTO_RES_QUERY, msg=data)
+        for name, points in data.items():
+            self.assertNotIn(name, result)
+            result[name] = points
+
+        return chunks, result
+
+    async def active_handles(self):
+        result = await self.client0.query('show active_handles')
+        return result['data'][0]['value']
+
+    @default_test_setup(1)
+    async def run(self):
+        await self.client0.connect()
+
+        data = gen_data(points=self.GEN_POINTS, n=10)
+        await self.client0.insert(data)
+
+        # points are received in more than one chunk
+        chunks, result = await self.stream('select * from /.*/')
+        self.assertGreater(chunks, 1)
+        self.assertEqual(result, data)
+
+        # a result which fits in one chunk is sent with the final package
+        name = sorted(data)[0]
+        chunks, result = await self.stream(
+            'select * from "{}"'.format(name))
+        self.assertEqual(chunks, 0)
+        self.assertEqual(result, {name: data[name]})
+
+        # merged results are sent with the final package
+        chunks, result = await self.stream(
+            'select * from /.*/ merge as "total"')
+        self.assertEqual(chunks, 0)
+        self.assertEqual(list(result), ['total'])
+        self.assertEqual(len(result['total']), 400000)
+
+        # closing the connection cancels a streaming query
+        handles = await self.active_handles()
+
+        for _ in range(5):
+            raw = RawClient(self.db, self.server0)
+            await raw.connect()
+            raw.send(CPROTO_REQ_QUERY_STREAM, ('select * from /.*/', None))
+            raw.close()
+
+        await asyncio.sleep(5)
+
+        self.assertLessEqual(await self.active_handles(), handles)
+        self.assertEqual(
+            await self.client0.query('select * from /.*/'),
+            data)
+
+        self.client0.close()
+
+
+if __name__ == '__main__':
+    Server.HOLD_TERM = False
+    Server.MEM_CHECK = False
+    Server.BUILDTYPE = 'Debug'
+    run_test(TestSelectStream())
@@ -0,0 +1,104 @@
+import asyncio
+import functools
+import glob
+import os
+import struct
+from testing import default_test_setup
+from testing import gen_data
+from testing import gen_points
+from testing import run_test
+from testing import Server
+from testing import TestBase
+
+
+def corrupt_fifo(dbpath, dbname):
+    '''Write a size for a package after the last package in the newest fifo
+    file, like a package which was written while the server was killed.'''
+    fn = max(glob.glob(os.path.join(dbpath, dbname, '.*', '*.fifo')))
+    with open(fn, 'r+b') as f:
+        pos = f.seek(0, os.SEEK_END)
+        while pos >= 4:
+            f.seek(pos - 4)
+            size, = struct.unpack('<I', f.read(4))
+            if not size:
+                break
+            pos -= size + 4
+        assert pos >= 4, 'No free space found in fifo: {}'.format(fn)
+        f.seek(pos - 4)
+        f.write(struct.pack('<I', 1000))
+
+
+class TestWal(TestBase):
+    title = 'Test write-ahead log'
+
+    GEN_POINTS = functools.partial(gen_points, n=100, tp=int)
+
+    async def select_all(self):
+        return await self.client0.query('select * from /.*/')
+
+    async def restart(self, kill=False, **config):
+        self.client0.close()
+        if kill:
+            self.server0.kill()
+        else:
+            result = await self.server0.stop()
+            self.assertTrue(result)
+
+        self.server0.config.update(config)
+        self.server0.create()
+
+        await self.server0.start(sleep=10)
+        await self.client0.connect()
+
+    @default_test_setup(2)
+    async def run(self):
+        await self.db.add_replica(self.server1, 0, sleep=3)
+        await self.client0.connect()
+
+        await self.restart(wal_checkpoint_interval=5000)
+        await self.assertIsRunning(self.db, self.client0, timeout=10)
+
+        # replay packages which are not written by a checkpoint
+        data = gen_data(points=self.GEN_POINTS, n=20)
+        await self.client0.insert(data)
+
+        await self.restart(kill=True)
+        self.assertEqual(await self.select_all(), data)
+
+        # replay only the packages after the last checkpoint
+        more = gen_data(points=self.GEN_POINTS, n=20)
+        await self.client0.insert(more)
+        data.update(more)
+
+        await asyncio.sleep(8)
+
+        more = gen_data(points=self.GEN_POINTS, n=20)
+        await self.client0.insert(more)
+        data.update(more)
+
+        await self.restart(kill=True)
+        self.assertEqual(await self.select_all(), data)
+
+        # a torn package at the end of the log is skipped
+        more = gen_data(points=self.GEN_POINTS, n=20)
+        await self.client0.insert(more)
+        data.update(more)
+
+        self.client0.close()
+        self.server0.kill()
+        corrupt_fifo(self.server0.dbpath, self.db.dbname)
+
+        await self.server0.start(sleep=10)
+        await self.client0.connect()
+        self.assertEqual(await self.select_all(), data)
+
+        self.client0.close()
+
+        return False
+
+
+if __name__ == '__main__':
+    Server.HOLD_TERM = False
+    Server.MEM_CHECK = False
+    Server.BUILDTYPE = 'Debug'
+    run_test(TestWal())
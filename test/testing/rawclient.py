@@ -0,0 +1,67 @@
+import asyncio
+import struct
+import qpack
+
+
+CPROTO_REQ_QUERY = 0
+CPROTO_REQ_AUTH = 2
+CPROTO_REQ_INSERT_BULK = 10
+CPROTO_REQ_QUERY_STREAM = 11
+
+CPROTO_RES_QUERY = 0
+CPROTO_RES_INSERT = 1
+CPROTO_RES_AUTH_SUCCESS = 2
+CPROTO_RES_QUERY_CHUNK = 6
+
+CPROTO_ERR_QUERY = 65
+CPROTO_ERR_INSERT = 66
+
+PKG_HEADER = struct.Struct('<IHBB')
+
+
+class RawClient:
+    '''Client writing raw packages for package types which are not supported
+    by the connector.'''
+
+    def __init__(self, db, server, username='iris', password='siri'):
+        self.db = db
+        self.server = server
+        self.username = username
+        self.password = password
+        self.pid = 0
+
+    async def connect(self):
+        self.reader, self.writer = await asyncio.open_connection(
+            self.server.server_address,
+            self.server.listen_client_port)
+        tp, _ = await self.request(
+            CPROTO_REQ_AUTH,
+            (self.username, self.password, self.db.dbname))
+        assert tp == CPROTO_RES_AUTH_SUCCESS, \
+            'Authentication failed: {}'.format(tp)
+
+    def close(self):
+        self.writer.close()
+
+    def send(self, tp, data):
+        '''Send a package and return the pid. Data which is not bytes is
+        packed with qpack.'''
+        if not isinstance(data, bytes):
+            data = qpack.packb(data)
+        self.pid = (self.pid + 1) % 0x10000
+        self.writer.write(
+            PKG_HEADER.pack(len(data), self.pid, tp, tp ^ 255) + data)
+        return self.pid
+
+    async def read(self):
+        '''Returns a (pid, tp, data) tuple for the next package.'''
+        header = await self.reader.readexactly(PKG_HEADER.size)
+        length, pid, tp, _ = PKG_HEADER.unpack(header)
+        data = await self.reader.readexactly(length)
+        return pid, tp, qpack.unpackb(data, decode='utf-8') if data else None
+
+    async def request(self, tp, data):
+        pid = self.send(tp, data)
+        rpid, tp, data = await self.read()
+        assert rpid == pid, 'Unexpected pid: {}'.format(rpid)
+        return tp, data
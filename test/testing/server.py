@@ -29,7 +29,8 @@ class Server:
     def __init__(self,
                  n,
                  optimize_interval=30,
-                 heartbeat_interval=30):
+                 heartbeat_interval=30,
+                 **config):
         self.n = n
         self.listen_client_port = 9000 + n
         self.listen_backend_port = 9010 + n
@@ -40,6 +41,7 @@ class Server:
         self.ip_support = self.IP_SUPPORT
         self.optimize_interval = optimize_interval
         self.heartbeat_interval = heartbeat_interval
+        self.config = config
         self.cfgfile = os.path.join(TEST_DIR, 'siridb{}.conf'.format(self.n))
         self.dbpath = os.path.join(TEST_DIR, 'dbpath{}'.format(self.n))
         self.name = 'SiriDB:{}'.format(self.listen_backend_port)
@@ -59,6 +61,8 @@ class Server:
         config.set('siridb', 'heartbeat_interval', self.heartbeat_interval)
         config.set('siridb', 'default_db_path', self.dbpath)
         config.set('siridb', 'max_open_files', MAX_OPEN_FILES)
+        for option, value in self.config.items():
+            config.set('siridb', option, value)
 
         with open(self.cfgfile, 'w') as configfile:
             config.write(configfile)